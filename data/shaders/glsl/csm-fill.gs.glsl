@@ -0,0 +1,47 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/**
+ * replicates fullscreen quad to shadow map layers (cascades) selected by c_cascade_mask
+ * used with fsq.vs and csm-fill.ps for clearing/copying cached static cascades
+ */
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices=_MAX_VERTS_) out;
+
+/* input */
+in vec2 vso_coord[];
+
+/* output */
+out vec2 gso_coord;
+flat out int gso_layer;
+
+uniform uint c_cascade_mask;    /* bit i is set if cascade i should be filled */
+
+void main()
+{
+    for (int c = 0; c < _CASCADE_CNT_; c++) {
+        if ((c_cascade_mask & (uint(1) << uint(c))) != uint(0))   {
+            for (int i = 0; i < 3; i++)    {
+                gl_Layer = c;
+                gso_layer = c;
+                gso_coord = vso_coord[i];
+                gl_Position = gl_in[i].gl_Position;
+                EmitVertex();
+            }
+            EndPrimitive();
+        }
+    }
+}
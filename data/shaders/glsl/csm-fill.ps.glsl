@@ -0,0 +1,36 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/**
+ * writes depth into cascades (layers) of the shadow map
+ * _COPY_: copies depth from the same layer of the cached static shadow map
+ * otherwise clears depth to far (1.0)
+ */
+
+in vec2 gso_coord;
+flat in int gso_layer;
+
+#if defined(_COPY_)
+uniform sampler2DArray s_shadowmap;
+#endif
+
+void main()
+{
+#if defined(_COPY_)
+    gl_FragDepth = texture(s_shadowmap, vec3(gso_coord, gso_layer)).x;
+#else
+    gl_FragDepth = 1.0f;
+#endif
+}
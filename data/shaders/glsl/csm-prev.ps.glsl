@@ -17,9 +17,7 @@
 in vec2 vso_coord;
 
 /* outputs */
-layout(location=0) out vec4 pso_cs0;
-layout(location=1) out vec4 pso_cs1;
-layout(location=2) out vec4 pso_cs2;
+layout(location=0) out vec4 pso_cs[_CASCADE_CNT_];    /* one target for each cascade */
 
 /* textures */
 #if !defined(_D3D10_)
@@ -48,15 +46,10 @@ vec4 get_view_depth(vec4 orthoparams, float max_far, vec2 coord, int map_idx)
 
 void main()
 {
-    vec4 colors[_CASCADE_CNT_];
     for (int i = 0; i < _CASCADE_CNT_; i++) {
-        colors[i] = get_view_depth(c_orthoparams[i], c_max_far[i], 
+        pso_cs[i] = get_view_depth(c_orthoparams[i], c_max_far[i], 
             vec2(vso_coord.x, vso_coord.y), i);
     }
-
-    pso_cs0 = colors[0];
-    pso_cs1 = colors[1];
-    pso_cs2 = colors[2];
 }
 
 
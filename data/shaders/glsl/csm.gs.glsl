@@ -15,13 +15,11 @@
 
 
 layout(triangles) in;
-layout(triangle_strip, max_vertices=9) out;
+layout(triangle_strip, max_vertices=_MAX_VERTS_) out;
 
 /* input */
 in vso  {
-    vec4 pos0;
-    vec4 pos1;
-    vec4 pos2;
+    vec4 pos[_CASCADE_CNT_];
 #if defined(_ALPHAMAP_)
     vec2 coord;
 #endif
@@ -37,6 +35,8 @@ layout(std140) uniform cb_frame_gs
     vec4 c_cascade_planes[4*_CASCADE_CNT_];
 };
 
+uniform uint c_cascade_mask;    /* bit i is set if the instances touch cascade i (culled on cpu) */
+
 /* returns false if it's not intersected */
 uint test_tri_singleplane(vec4 v0, vec4 v1, vec4 v2, vec4 plane)
 {
@@ -59,51 +59,22 @@ bool test_tri_planes(vec4 plane1, vec4 plane2, vec4 plane3, vec4 plane4,
 /* */
 void main()
 {
-    /* generate 3 triangles for each input trinagle and send them to 3 views (cascade) */
-    /* tri#1 -> cascade #1 */
-    if (test_tri_planes(c_cascade_planes[0], c_cascade_planes[1], c_cascade_planes[2],
-        c_cascade_planes[3], verts[0].pos0, verts[1].pos0, verts[2].pos0))
-    {
-        gl_Layer = 0;
-        for (int i = 0; i < 3; i++)    {
-            gl_Position = verts[i].pos0;
+    /* generate a triangle for each cascade that the instance touches and send it to its layer */
+    for (int c = 0; c < _CASCADE_CNT_; c++)    {
+        int p = c*4;
+        if ((c_cascade_mask & (uint(1) << uint(c))) != uint(0) &&
+            test_tri_planes(c_cascade_planes[p], c_cascade_planes[p+1], c_cascade_planes[p+2],
+            c_cascade_planes[p+3], verts[0].pos[c], verts[1].pos[c], verts[2].pos[c]))
+        {
+            for (int i = 0; i < 3; i++)    {
+                gl_Layer = c;
+                gl_Position = verts[i].pos[c];
 #if defined(_ALPHAMAP_)
-            gso_coord = verts[i].coord;
+                gso_coord = verts[i].coord;
 #endif
-            EmitVertex();
+                EmitVertex();
+            }
+            EndPrimitive();
         }
-        EndPrimitive();
-    }
-
-    /* tri#2 -> cascade #2 */
-    if (test_tri_planes(c_cascade_planes[4], c_cascade_planes[5], c_cascade_planes[6],
-        c_cascade_planes[7], verts[0].pos1, verts[1].pos1, verts[2].pos1))
-    {
-        gl_Layer = 1;
-        for (int i = 0; i < 3; i++)    {
-            gl_Position = verts[i].pos1;
-#if defined(_ALPHAMAP_)
-            gso_coord = verts[i].coord;
-#endif
-            EmitVertex();
-        }
-        EndPrimitive();
-    }
-
-    /* tri #3 -> cascade #3 */
-    if (test_tri_planes(c_cascade_planes[8], c_cascade_planes[9], c_cascade_planes[10],
-        c_cascade_planes[11], verts[0].pos2, verts[1].pos2, verts[2].pos2))
-    {    
-        gl_Layer = 2;
-        for (int i = 0; i < 3; i++)    {
-            gl_Position = verts[i].pos2;
-#if defined(_ALPHAMAP_)
-            gso_coord = verts[i].coord;
-#endif
-            EmitVertex();
-        }
-        EndPrimitive();
     }
 }
-
-
@@ -13,10 +13,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES_ not defined"
-#endif
-
 /* inputs */
 layout(location = INPUT_ID_POSITION) in vec4 vsi_pos;
 layout(location = INPUT_ID_NORMAL) in vec3 vsi_norm;
@@ -30,9 +26,7 @@ layout(location = INPUT_ID_BLENDWEIGHT) in vec4 vsi_blend_weights;
 
 /* outputs */
 out vso {
-    vec4 pos0;
-    vec4 pos1;
-    vec4 pos2;
+    vec4 pos[_CASCADE_CNT_];    /* clip-space position in each cascade */
 #if defined(_ALPHAMAP_)
     vec2 coord;
 #endif
@@ -47,11 +41,6 @@ layout(std140) uniform cb_frame
     mat4 c_cascade_mats[_CASCADE_CNT_];
 };
 
-layout(std140) uniform cb_xforms
-{
-    mat3x4 c_mats[_MAX_INSTANCES_];
-};
-
 vec4 apply_bias(vec4 pos_ws, vec3 norm_ws, mat3x4 view, float fovfactor)
 {
 	vec3 lv = c_lightdir.xyz;
@@ -70,9 +59,11 @@ vec4 apply_bias(vec4 pos_ws, vec3 norm_ws, mat3x4 view, float fovfactor)
 
 void main()
 {
+    instance_data inst = get_instance(gl_InstanceID);
+
 #if defined(_SKIN_)
-    skin_output_pn pn = skin_vertex_pn(gl_InstanceID, vsi_blend_idxs, vsi_blend_weights, vsi_pos, 
-		vsi_norm);
+    skin_output_pn pn = skin_vertex_pn(inst.skin_offset, vsi_blend_idxs, vsi_blend_weights,
+		vsi_pos, vsi_norm);
 	vec4 pos = pn.pos;
 	vec3 norm = pn.norm;
 #else
@@ -80,12 +71,12 @@ void main()
 	vec3 norm = vsi_norm;
 #endif
 
-    vec4 pos_ws = vec4(pos * c_mats[gl_InstanceID], 1);
-	vec3 norm_ws = vec4(norm, 0) * c_mats[gl_InstanceID];
+    vec4 pos_ws = vec4(pos * inst.xform, 1);
+	vec3 norm_ws = vec4(norm, 0) * inst.xform;
 
-    o.pos0 = apply_bias(pos_ws, norm_ws, c_views[0], c_fovfactors[0]) * c_cascade_mats[0];
-    o.pos1 = apply_bias(pos_ws, norm_ws, c_views[1], c_fovfactors[1]) * c_cascade_mats[1];
-    o.pos2 = apply_bias(pos_ws, norm_ws, c_views[2], c_fovfactors[2]) * c_cascade_mats[2];
+    for (int c = 0; c < _CASCADE_CNT_; c++)    {
+        o.pos[c] = apply_bias(pos_ws, norm_ws, c_views[c], c_fovfactors[c]) * c_cascade_mats[c];
+    }
 
 #if defined(_ALPHAMAP_)
     o.coord = vec2(vsi_coord.x, vsi_coord.y);
@@ -13,10 +13,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES_ not defined"
-#endif
-
 /* input */
 layout(location = INPUT_ID_POSITION) in vec4 vsi_pos;
 layout(location = INPUT_ID_NORMAL) in vec3 vsi_norm;
@@ -47,25 +43,22 @@ layout(std140) uniform cb_frame
     mat4 c_viewproj;
 };
 
-layout(std140) uniform cb_xforms
-{
-    mat3x4 c_mats[_MAX_INSTANCES_];
-};
-
 void main() 
 {
+    instance_data inst = get_instance(gl_InstanceID);
+
     /* skinning */
 #if defined(_SKIN_)
     #if defined(_NORMALMAP_)
-        skin_output_pnt s = skin_vertex_pnt(gl_InstanceID, vsi_blend_idxs, vsi_blend_weights, 
+        skin_output_pnt s = skin_vertex_pnt(inst.skin_offset, vsi_blend_idxs, vsi_blend_weights, 
 			vsi_pos, vsi_norm, vsi_tangent, vsi_binorm);    
         vec4 pos = s.pos;
         vec3 norm = s.norm;
         vec3 tangent = s.tangent;
         vec3 binorm = s.binorm;
     #else
-        skin_output_pn s = skin_vertex_pn(gl_InstanceID, vsi_blend_idxs, vsi_blend_weights, vsi_pos, 
-			vsi_norm);
+        skin_output_pn s = skin_vertex_pn(inst.skin_offset, vsi_blend_idxs, vsi_blend_weights, 
+			vsi_pos, vsi_norm);
         vec4 pos = s.pos;
         vec3 norm = s.norm;
     #endif
@@ -78,10 +71,10 @@ void main()
     #endif
 #endif
     mat3 view3 = mat3(c_view);
-    mat3 m3 = mat3(c_mats[gl_InstanceID]);
+    mat3 m3 = mat3(inst.xform);
 
     /* position */
-    vec4 pos_ws = vec4(pos * c_mats[gl_InstanceID], 1.0f);
+    vec4 pos_ws = vec4(pos * inst.xform, 1.0f);
     gl_Position = pos_ws * c_viewproj;
 
     /* normal */
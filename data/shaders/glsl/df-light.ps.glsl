@@ -18,6 +18,7 @@ in vec2 vso_coord;
 in vec3 vso_viewray;
 #if defined(_LOCAL_LIGHTING_)
 flat in uint vso_tile_id;
+flat in uint vso_tile_gid;
 #endif
 
 /* outputs */
@@ -62,16 +63,15 @@ mtl get_mtl(uint idx)
 struct local_light
 {
     vec4 type;   /* type.x: point=2, spot=3 */
-    vec4 pos_vs; /* position (view-space) */
+    vec4 pos_ws; /* position (world-space) */
     vec4 atten;  /* attenuations (x=near, y=far, z=cos(narrow), w=cos(wide) */
-    vec4 dir_vs; /* direction (view-space) */
+    vec4 dir_ws; /* direction (world-space) */
     vec4 color;  /* linear space color (premultiplied), a=intensity*/
 };
 
 struct local_light_tile
 {
-    uvec4 lightcnt;  /* x = cnt */
-    uvec4 lightidxs[_MAX_LIGHT_INDEXES_/4];
+    uvec4 lightcnt;  /* x = number of lights that touch the tile (all depth slices) */
 };
 
 layout(std140) uniform cb_light
@@ -80,6 +80,12 @@ layout(std140) uniform cb_light
 };
 
 uniform samplerBuffer tb_lights;
+
+/* clusters tbuffer: one header per cluster (x=light count, y=offset of the first index group),
+ * followed by light indexes packed 4 per element */
+uniform samplerBuffer tb_clusters;
+uniform vec4 c_clusterparams;   /* x: slice scale, y: slice bias, z: slice count */
+uniform mat3x4 c_viewinv;   /* lights are kept in world-space, so they survive camera moves */
 #elif defined(_SUN_LIGHTING_)
 uniform vec4 c_ambient_sky;
 uniform vec4 c_ambient_ground;
@@ -127,9 +133,9 @@ local_light get_locallight(uint idx)
     local_light l;
     int offset = int(idx)*5;
     l.type = texelFetch(tb_lights, offset);
-    l.pos_vs = texelFetch(tb_lights, offset + 1);
+    l.pos_ws = texelFetch(tb_lights, offset + 1);
     l.atten = texelFetch(tb_lights, offset + 2);
-    l.dir_vs = texelFetch(tb_lights, offset + 3);
+    l.dir_ws = texelFetch(tb_lights, offset + 3);
     l.color = texelFetch(tb_lights, offset + 4);
     return l;
 }
@@ -147,10 +153,22 @@ float calc_angle_atten(vec3 ldir, vec3 lv, float anarrow, float awide)
 {
     return smoothstep(awide, anarrow, dot(ldir, -lv));
 }
+
+/* depth slices are exponential: slice = log(z)*scale + bias */
+uint calc_depth_slice(float depth_vs)
+{
+    float s = floor(log(depth_vs)*c_clusterparams.x + c_clusterparams.y);
+    return uint(clamp(s, 0, c_clusterparams.z - 1));
+}
 #endif
 
 void main()
 {
+#if defined(_LOCAL_LIGHTING_)
+    if (c_tiles[vso_tile_id].lightcnt.x == uint(0))
+        discard;
+#endif
+
     ivec2 coord2d = ivec2(gl_FragCoord.xy);
 
     /* reconstruct position */
@@ -214,29 +232,34 @@ void main()
     lit_clr += ambient;
 #elif defined(_LOCAL_LIGHTING_)
     vec3 lit_clr = vec3(0, 0, 0);
-
-    local_light_tile tile = c_tiles[vso_tile_id];
-    for (uint i = uint(0); i < tile.lightcnt.x; i++)    {
-        uint vidx = i/uint(4);
-        uint subidx = i % uint(4);
-        uint lightidx = tile.lightidxs[vidx][subidx];
+    vec3 pos_ws = vec4(pos_vs, 1) * c_viewinv;
+    vec3 norm_ws = vec4(norm_vs, 0) * c_viewinv;
+    vec3 vv_ws = vec4(vv, 0) * c_viewinv;
+
+    uint cluster_id = vso_tile_gid*uint(c_clusterparams.z) + calc_depth_slice(depth_vs);
+    vec4 cluster = texelFetch(tb_clusters, int(cluster_id));
+    uint light_cnt = uint(cluster.x);
+    int first = int(cluster.y);
+    for (uint i = uint(0); i < light_cnt; i++)    {
+        vec4 idxs = texelFetch(tb_clusters, first + int(i/uint(4)));
+        uint lightidx = uint(idxs[i % uint(4)]);
         local_light light = get_locallight(lightidx);
 
         /* light-vector */
-        vec3 lv = light.pos_vs.xyz - pos_vs;
+        vec3 lv = light.pos_ws.xyz - pos_ws;
 
         /* attenuation */
         float lv_len;
         float atten = calc_dist_atten(lv, light.atten.x, light.atten.y, light.color.a, lv_len);
 
         if (light.type.x == LIGHT_TYPE_SPOT)
-            atten *= calc_angle_atten(light.dir_vs.xyz, lv, light.atten.z, light.atten.w);
+            atten *= calc_angle_atten(light.dir_ws.xyz, lv, light.atten.z, light.atten.w);
 
         /* lit calc */
         lv /= lv_len;   /* normalize light-vect for light calc */
         lit_clr += atten * calc_lit(diff_clr,
             spec_clr,
-            lv, vv, norm_vs,
+            lv, vv_ws, norm_ws,
             gloss, 
             light.color,
             vis_coeff, 
@@ -22,6 +22,7 @@ layout(location = INPUT_ID_TEXCOORD0) in vec2 vsi_coord;
 out vec2 vso_coord;
 out vec3 vso_viewray;
 flat out uint vso_tile_id;
+flat out uint vso_tile_gid;
 
 /* uniforms */
 uniform vec4 c_projparams;
@@ -55,6 +56,7 @@ void main()
     gl_Position = vec4(pos_prj, 1.0f);
     vso_coord = coord;
     vso_tile_id = uint(gl_InstanceID);
+    vso_tile_gid = tile_id;
 }
 
 
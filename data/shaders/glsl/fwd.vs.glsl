@@ -14,10 +14,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES is not defined"
-#endif
- 
 layout(location = INPUT_ID_POSITION) in vec4 vsi_pos;
 layout(location = INPUT_ID_NORMAL) in vec3 vsi_norm;
 layout(location = INPUT_ID_TEXCOORD0) in vec2 vsi_coord0;
@@ -30,16 +26,12 @@ layout(std140) uniform cb_frame
    mat4 c_viewproj;
 };
 
-layout(std140) uniform cb_xforms
-{
-    mat3x4 c_mats[_MAX_INSTANCES_];
-};
-
 void main()
 {
-   vec4 pos_ws = vec4(vsi_pos * c_mats[gl_InstanceID], 1);
+   instance_data inst = get_instance(gl_InstanceID);
+   vec4 pos_ws = vec4(vsi_pos * inst.xform, 1);
    
-   vso_norm_ws = vsi_norm * mat3(c_mats[gl_InstanceID]);
+   vso_norm_ws = vsi_norm * mat3(inst.xform);
    vso_coord0 = vec2(vsi_coord0.x, -vsi_coord0.y);
    gl_Position = pos_ws * c_viewproj;
 }
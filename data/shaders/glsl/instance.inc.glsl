@@ -0,0 +1,39 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/* instance stream: world matrices of the frame (3 texels each) are shared by all passes
+ * each draw reads its instance records (x: matrix index, y: skin palette offset),
+ * starting from c_instance_offset */
+uniform samplerBuffer tb_xforms;
+uniform samplerBuffer tb_instances;
+uniform uint c_instance_offset;
+
+struct instance_data
+{
+    mat3x4 xform;
+    int skin_offset;    /* palette offset (in bones) for skinned instances */
+};
+
+instance_data get_instance(int inst_idx)
+{
+    instance_data r;
+    vec4 rec = texelFetch(tb_instances, int(c_instance_offset) + inst_idx);
+    int offset = int(rec.x)*3;
+    r.xform[0] = texelFetch(tb_xforms, offset);
+    r.xform[1] = texelFetch(tb_xforms, offset + 1);
+    r.xform[2] = texelFetch(tb_xforms, offset + 2);
+    r.skin_offset = int(rec.y);
+    return r;
+}
@@ -15,6 +15,8 @@
 
 #if defined(_SKIN_)
 
+/* packed skinning palette of the whole frame, instances index into it by their skin_offset
+ * (see instance_data) */
 uniform samplerBuffer tb_skins;
 
 struct skin_output_pnt
@@ -31,28 +33,28 @@ struct skin_output_pn
     vec3 norm;
 };
 
-mat3x4 get_bone(int inst_idx, int bone_idx)
+mat3x4 get_bone(int skin_offset, int bone_idx)
 {
 	mat3x4 r;
-	int offset = (bone_idx + inst_idx*_MAX_BONES_)*3;
+	int offset = (bone_idx + skin_offset)*3;
 	r[0] = texelFetch(tb_skins, offset);
 	r[1] = texelFetch(tb_skins, offset + 1);
 	r[2] = texelFetch(tb_skins, offset + 2);
 	return r;
 }
 
-vec4 skin_vertex_p(int inst_idx, ivec4 blend_idxs, vec4 blend_weights, vec4 pos)
+vec4 skin_vertex_p(int skin_offset, ivec4 blend_idxs, vec4 blend_weights, vec4 pos)
 {
 	vec4 r = vec4(0, 0, 0, 1);
 	for (int i = 0; i < 4; i++)	{
-		mat3x4 m = get_bone(inst_idx, blend_idxs[i]);
+		mat3x4 m = get_bone(skin_offset, blend_idxs[i]);
 		r.xyz += (pos * m) * blend_weights[i];
 	}
 
 	return r;    
 }
 
-skin_output_pn skin_vertex_pn(int inst_idx, ivec4 blend_idxs, vec4 blend_weights, vec4 pos, 
+skin_output_pn skin_vertex_pn(int skin_offset, ivec4 blend_idxs, vec4 blend_weights, vec4 pos, 
 	vec3 norm)
 {
 	skin_output_pn r;
@@ -61,7 +63,7 @@ skin_output_pn skin_vertex_pn(int inst_idx, ivec4 blend_idxs, vec4 blend_weights
     r.norm = vec3(0, 0, 0);
 
 	for (int i = 0; i < 4; i++) {
-		mat3x4 m = get_bone(inst_idx, blend_idxs[i]);
+		mat3x4 m = get_bone(skin_offset, blend_idxs[i]);
 		float w = blend_weights[i];
 
 		r.pos.xyz += (pos * m) * w;
@@ -71,7 +73,7 @@ skin_output_pn skin_vertex_pn(int inst_idx, ivec4 blend_idxs, vec4 blend_weights
 	return r;    
 }
 
-skin_output_pnt skin_vertex_pnt(int inst_idx, ivec4 blend_idxs, vec4 blend_weights, vec4 pos,
+skin_output_pnt skin_vertex_pnt(int skin_offset, ivec4 blend_idxs, vec4 blend_weights, vec4 pos,
     vec3 norm, vec3 tangent, vec3 binorm)
 {
 	skin_output_pnt r;
@@ -82,7 +84,7 @@ skin_output_pnt skin_vertex_pnt(int inst_idx, ivec4 blend_idxs, vec4 blend_weigh
     r.binorm = vec3(0, 0, 0);
 
 	for (int i = 0; i < 4; i++) {
-		mat3x4 m = get_bone(inst_idx, blend_idxs[i]);
+		mat3x4 m = get_bone(skin_offset, blend_idxs[i]);
         mat3 m3 = mat3(m);
 		float w = blend_weights[i];
 
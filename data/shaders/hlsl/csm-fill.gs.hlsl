@@ -0,0 +1,57 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/**
+ * replicates fullscreen quad to shadow map layers (cascades) selected by c_cascade_mask
+ * used with fsq.vs and csm-fill.ps for clearing/copying cached static cascades
+ */
+
+struct vso
+{
+    float4 pos : SV_Position;
+    float2 coord : TEXCOORD0;
+};
+
+struct gso
+{
+    uint rt_idx : SV_RenderTargetArrayIndex;
+    float4 pos : SV_Position;
+    float2 coord : TEXCOORD0;
+};
+
+uint c_cascade_mask;    /* bit i is set if cascade i should be filled */
+
+[maxvertexcount(_MAX_VERTS_)]
+void main(triangle vso i[3], inout TriangleStream<gso> tris)
+{
+    gso o;
+
+    [unroll]
+    for (uint c = 0; c < _CASCADE_CNT_; c++)   {
+        if ((c_cascade_mask & (1u << c)) != 0)   {
+            o.rt_idx = c;
+            o.pos = i[0].pos;
+            o.coord = i[0].coord;
+            tris.Append(o);
+            o.pos = i[1].pos;
+            o.coord = i[1].coord;
+            tris.Append(o);
+            o.pos = i[2].pos;
+            o.coord = i[2].coord;
+            tris.Append(o);
+            tris.RestartStrip();
+        }
+    }
+}
@@ -0,0 +1,41 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/**
+ * writes depth into cascades (layers) of the shadow map
+ * _COPY_: copies depth from the same layer of the cached static shadow map
+ * otherwise clears depth to far (1.0)
+ */
+
+struct gso
+{
+    uint rt_idx : SV_RenderTargetArrayIndex;
+    float4 pos : SV_Position;
+    float2 coord : TEXCOORD0;
+};
+
+#if defined(_COPY_)
+Texture2DArray<float> t_shadowmap;
+SamplerState s_shadowmap;
+#endif
+
+float main(gso i) : SV_Depth
+{
+#if defined(_COPY_)
+    return t_shadowmap.SampleLevel(s_shadowmap, float3(i.coord, i.rt_idx), 0);
+#else
+    return 1.0f;
+#endif
+}
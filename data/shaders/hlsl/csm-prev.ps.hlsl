@@ -21,9 +21,7 @@ struct vso
 
 struct pso
 {
-    float4 cs0 : SV_Target0;
-    float4 cs1 : SV_Target1;
-    float4 cs2 : SV_Target2;
+    float4 cs[_CASCADE_CNT_] : SV_Target0;  /* one target for each cascade */
 };
 
 /* textures */
@@ -55,16 +53,11 @@ float4 get_view_depth(float4 orthoparams, float max_far, float2 coord, int map_i
 
 pso main(vso input)
 {
-    float4 colors[_CASCADE_CNT_];
+    pso o;
     [unroll]
     for (int i = 0; i < _CASCADE_CNT_; i++) {
-        colors[i] = get_view_depth(c_orthoparams[i], c_max_far[i], input.coord, i);
+        o.cs[i] = get_view_depth(c_orthoparams[i], c_max_far[i], input.coord, i);
     }
-
-    pso o;
-    o.cs0 = colors[0];
-    o.cs1 = colors[1];
-    o.cs2 = colors[2];
     return o;
 }
 
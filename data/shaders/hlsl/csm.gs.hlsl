@@ -16,9 +16,7 @@
 
 struct vso
 {
-    float4 pos0 : POSITION0;
-    float4 pos1 : POSITION1;
-    float4 pos2 : POSITION2;
+    float4 pos[_CASCADE_CNT_] : POSITION0;
 
 #if defined(_ALPHAMAP_)
     float2 coord : TEXCOORD0;
@@ -40,6 +38,8 @@ cbuffer cb_frame_gs
     float4 c_cascade_planes[4*_CASCADE_CNT_];
 };
 
+uint c_cascade_mask;    /* bit i is set if the instances touch cascade i (culled on cpu) */
+
 /* returns false if it's not intersected */
 uint test_tri_singleplane(float4 v0, float4 v1, float4 v2, float4 plane)
 {
@@ -59,10 +59,10 @@ uint test_tri_planes(float4 plane1, float4 plane2, float4 plane3, float4 plane4,
     return (t1 & t2 & t3 & t4);
 }
 
-[maxvertexcount(9)]
+[maxvertexcount(_MAX_VERTS_)]
 void main(triangle vso i[3], inout TriangleStream<gso> tris)
 {
-    /* generate 3 triangles for each input trinagle and send them to 3 views (cascade) */
+    /* generate a triangle for each cascade that the instance touches and send it to its layer */
     gso o[3];
 
 #if defined(_ALPHAMAP_)
@@ -71,53 +71,23 @@ void main(triangle vso i[3], inout TriangleStream<gso> tris)
     o[2].coord = i[2].coord;
 #endif
 
-    /* tri #1 -> cascade 1 */
-    if (test_tri_planes(c_cascade_planes[0], c_cascade_planes[1], c_cascade_planes[2],
-        c_cascade_planes[3], i[0].pos0, i[1].pos0, i[2].pos0))
-    {
-        o[0].rt_idx = 0;
-        o[1].rt_idx = 0;
-        o[2].rt_idx = 0;
-        o[0].pos = i[0].pos0;
-        o[1].pos = i[1].pos0;
-        o[2].pos = i[2].pos0;
-        tris.Append(o[0]);
-        tris.Append(o[1]);
-        tris.Append(o[2]);
-        tris.RestartStrip();
-    }
-
-    /* tri #2 -> cascade 2 */
-    if (test_tri_planes(c_cascade_planes[4], c_cascade_planes[5], c_cascade_planes[6],
-        c_cascade_planes[7], i[0].pos1, i[1].pos1, i[2].pos1))
-    {
-        o[0].rt_idx = 1;
-        o[1].rt_idx = 1;
-        o[2].rt_idx = 1;
-        o[0].pos = i[0].pos1;
-        o[1].pos = i[1].pos1;
-        o[2].pos = i[2].pos1;
-        tris.Append(o[0]);
-        tris.Append(o[1]);
-        tris.Append(o[2]);
-        tris.RestartStrip();
-    }
-
-    /* tri #3 -> cascade 3 */
-    if (test_tri_planes(c_cascade_planes[8], c_cascade_planes[9], c_cascade_planes[10],
-        c_cascade_planes[11], i[0].pos2, i[1].pos2, i[2].pos2))
-    {
-        o[0].rt_idx = 2;
-        o[1].rt_idx = 2;
-        o[2].rt_idx = 2;
-        o[0].pos = i[0].pos2;
-        o[1].pos = i[1].pos2;
-        o[2].pos = i[2].pos2;
-        tris.Append(o[0]);
-        tris.Append(o[1]);
-        tris.Append(o[2]);
-        tris.RestartStrip();
+    [unroll]
+    for (uint c = 0; c < _CASCADE_CNT_; c++)   {
+        uint p = c*4;
+        if ((c_cascade_mask & (1u << c)) != 0 &&
+            test_tri_planes(c_cascade_planes[p], c_cascade_planes[p+1], c_cascade_planes[p+2],
+            c_cascade_planes[p+3], i[0].pos[c], i[1].pos[c], i[2].pos[c]))
+        {
+            o[0].rt_idx = c;
+            o[1].rt_idx = c;
+            o[2].rt_idx = c;
+            o[0].pos = i[0].pos[c];
+            o[1].pos = i[1].pos[c];
+            o[2].pos = i[2].pos[c];
+            tris.Append(o[0]);
+            tris.Append(o[1]);
+            tris.Append(o[2]);
+            tris.RestartStrip();
+        }
     }
 }
-
-
@@ -13,10 +13,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES_ not defined"
-#endif
-
 struct vsi
 {
     uint instance_idx : SV_InstanceID;
@@ -35,9 +31,7 @@ struct vsi
 
 struct vso
 {
-    float4 pos0 : POSITION0;
-    float4 pos1 : POSITION1;
-    float4 pos2 : POSITION2;
+    float4 pos[_CASCADE_CNT_] : POSITION0;  /* clip-space position in each cascade */
 
 #if defined(_ALPHAMAP_)
     float2 coord : TEXCOORD0;
@@ -53,11 +47,6 @@ cbuffer cb_frame
     float4x4 c_cascade_mats[_CASCADE_CNT_];
 };
 
-cbuffer cb_xforms
-{
-    float4x3 c_mats[_MAX_INSTANCES_];
-};
-
 float4 apply_bias(float4 pos_ws, float3 norm_ws, float4x3 view, float fovfactor)
 {
 	float3 lv = c_lightdir.xyz;
@@ -77,9 +66,11 @@ float4 apply_bias(float4 pos_ws, float3 norm_ws, float4x3 view, float fovfactor)
 vso main(vsi i)
 {
     vso o;
+    instance_data inst = get_instance(i.instance_idx);
 
 #if defined(_SKIN_)
-    skin_output_pn pn = skin_vertex_pn(i.instance_idx, i.blend_idxs, i.blend_weights, i.pos, i.norm);
+    skin_output_pn pn = skin_vertex_pn(inst.skin_offset, i.blend_idxs, i.blend_weights, i.pos,
+        i.norm);
 	float4 pos = pn.pos;
 	float3 norm = pn.norm;
 #else
@@ -87,12 +78,14 @@ vso main(vsi i)
 	float3 norm = i.norm;
 #endif
 
-    float4 pos_ws = float4(mul(pos, c_mats[i.instance_idx]), 1);
-	float3 norm_ws = mul(float4(norm, 0), c_mats[i.instance_idx]);
+    float4 pos_ws = float4(mul(pos, inst.xform), 1);
+	float3 norm_ws = mul(float4(norm, 0), inst.xform);
 
-    o.pos0 = mul(apply_bias(pos_ws, norm_ws, c_views[0], c_fovfactors[0]), c_cascade_mats[0]);
-    o.pos1 = mul(apply_bias(pos_ws, norm_ws, c_views[1], c_fovfactors[1]), c_cascade_mats[1]);
-    o.pos2 = mul(apply_bias(pos_ws, norm_ws, c_views[2], c_fovfactors[2]), c_cascade_mats[2]);
+    [unroll]
+    for (int c = 0; c < _CASCADE_CNT_; c++)    {
+        o.pos[c] = mul(apply_bias(pos_ws, norm_ws, c_views[c], c_fovfactors[c]),
+            c_cascade_mats[c]);
+    }
 
 #if defined(_ALPHAMAP_)
     o.coord = i.coord;
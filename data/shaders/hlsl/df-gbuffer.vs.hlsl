@@ -13,10 +13,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES_ not defined"
-#endif
-
 /* input */
 struct vsi
 {
@@ -57,28 +53,23 @@ cbuffer cb_frame
     float4x4 c_viewproj;
 };
 
-/* transforms cbuffer */
-cbuffer cb_xforms
-{
-    float4x3 c_mats[_MAX_INSTANCES_];
-};
-
 
 vso main(vsi i)
 {
     vso o;
+    instance_data inst = get_instance(i.instance_idx);
 
     /* skinning */
 #if defined(_SKIN_)
     #if defined(_NORMALMAP_)
-        skin_output_pnt s = skin_vertex_pnt(i.instance_idx, i.blend_idxs, i.blend_weights, i.pos, 
+        skin_output_pnt s = skin_vertex_pnt(inst.skin_offset, i.blend_idxs, i.blend_weights, i.pos, 
 			i.norm, i.tangent, i.binorm);    
         float4 pos = s.pos;
         float3 norm = s.norm;
         float3 tangent = s.tangent;
         float3 binorm = s.binorm;
     #else
-        skin_output_pn s = skin_vertex_pn(i.instance_idx, i.blend_idxs, i.blend_weights, i.pos, 
+        skin_output_pn s = skin_vertex_pn(inst.skin_offset, i.blend_idxs, i.blend_weights, i.pos, 
 			i.norm);
         float4 pos = s.pos;
         float3 norm = s.norm;
@@ -91,11 +82,11 @@ vso main(vsi i)
         float3 binorm = i.binorm;
     #endif
 #endif
-    float3x3 m3 = (float3x3)c_mats[i.instance_idx];
+    float3x3 m3 = (float3x3)inst.xform;
     float3x3 view3 = (float3x3)c_view;
 
     /* position */
-    float4 pos_ws = float4(mul(pos, c_mats[i.instance_idx]), 1.0f);
+    float4 pos_ws = float4(mul(pos, inst.xform), 1.0f);
     o.pos = mul(pos_ws, c_viewproj);
 
     /* normal */
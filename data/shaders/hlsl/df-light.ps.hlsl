@@ -20,6 +20,7 @@ struct vso
     float3 viewray : TEXCOORD1;
 #if defined(_LOCAL_LIGHTING_)
     nointerpolation uint tile_id : TEXCOORD2;
+    nointerpolation uint tile_gid : TEXCOORD3;
 #endif
 };
 
@@ -45,16 +46,15 @@ float4 c_lightcolor;    /* linear space color (premultiplied), a=intensity */
 struct local_light
 {
     float4 type;   /* type.x: point=2, spot=3 */
-    float4 pos_vs; /* position (view-space) */
+    float4 pos_ws; /* position (world-space) */
     float4 atten;  /* attenuations (x=near, y=far, z=cos(narrow), w=cos(wide) */
-    float4 dir_vs; /* direction (view-space) */
+    float4 dir_ws; /* direction (world-space) */
     float4 color;  /* linear space color (pre-multiplied) */
 };
 
 struct local_light_tile
 {
-    uint4 lightcnt;  /* x = cnt */
-    uint4 lightidxs[_MAX_LIGHT_INDEXES_/4];
+    uint4 lightcnt;  /* x = number of lights that touch the tile (all depth slices) */
 };
 
 cbuffer cb_light
@@ -65,15 +65,21 @@ cbuffer cb_light
 /* lights tbuffer (array of local_light) */
 Buffer<float4> tb_lights;
 
+/* clusters tbuffer: one header per cluster (x=light count, y=offset of the first index group),
+ * followed by light indexes packed 4 per element */
+Buffer<float4> tb_clusters;
+float4 c_clusterparams;  /* x: slice scale, y: slice bias, z: slice count */
+float4x3 c_viewinv; /* lights are kept in world-space, so they survive camera moves */
+
 /* local light fetch */
 local_light get_locallight(uint idx)
 {
     local_light l;
     int offset = int(idx)*5;
     l.type = tb_lights.Load(offset);
-    l.pos_vs = tb_lights.Load(offset + 1);
+    l.pos_ws = tb_lights.Load(offset + 1);
     l.atten = tb_lights.Load(offset + 2);
-    l.dir_vs = tb_lights.Load(offset + 3);
+    l.dir_ws = tb_lights.Load(offset + 3);
     l.color = tb_lights.Load(offset + 4);
     return l;
 }
@@ -149,6 +155,13 @@ float calc_angle_atten(float3 ldir, float3 lv, float anarrow, float awide)
 {
     return smoothstep(awide, anarrow, dot(ldir, -lv));
 }
+
+/* depth slices are exponential: slice = log(z)*scale + bias */
+uint calc_depth_slice(float depth_vs)
+{
+    float s = floor(log(depth_vs)*c_clusterparams.x + c_clusterparams.y);
+    return (uint)clamp(s, 0, c_clusterparams.z - 1);
+}
 #endif
 
 float4 main(vso input) : SV_Target0
@@ -221,15 +234,21 @@ float4 main(vso input) : SV_Target0
     lit_clr += ambient;
 #elif defined(_LOCAL_LIGHTING_)
     float3 lit_clr = float3(0, 0, 0);
-
-    for (uint i = 0; i < tile.lightcnt.x; i++)    {
-        uint vidx = i/4;
-        uint subidx = i % 4;
-        uint lightidx = tile.lightidxs[vidx][subidx];
+    float3 pos_ws = mul(float4(pos_vs, 1), c_viewinv);
+    float3 norm_ws = mul(float4(norm_vs, 0), c_viewinv);
+    float3 vv_ws = mul(float4(vv, 0), c_viewinv);
+
+    uint cluster_id = input.tile_gid*(uint)c_clusterparams.z + calc_depth_slice(depth_vs);
+    float4 cluster = tb_clusters.Load(cluster_id);
+    uint light_cnt = (uint)cluster.x;
+    int first = (int)cluster.y;
+    for (uint i = 0; i < light_cnt; i++)    {
+        float4 idxs = tb_clusters.Load(first + int(i/4));
+        uint lightidx = (uint)idxs[i % 4];
         local_light light = get_locallight(lightidx);
 
         /* light-vector */
-        float3 lv = light.pos_vs.xyz - pos_vs;
+        float3 lv = light.pos_ws.xyz - pos_ws;
 
         /* attenuation */
         float lv_len;
@@ -237,13 +256,13 @@ float4 main(vso input) : SV_Target0
 
         [flatten]
         if (light.type.x == LIGHT_TYPE_SPOT)
-            atten *= calc_angle_atten(light.dir_vs.xyz, lv, light.atten.z, light.atten.w);
+            atten *= calc_angle_atten(light.dir_ws.xyz, lv, light.atten.z, light.atten.w);
 
         /* lit calc */
         lv /= lv_len;   /* normalize light-vect for light calc */
         lit_clr += atten * calc_lit(diff_clr,
             spec_clr,
-            lv, vv, norm_vs,
+            lv, vv_ws, norm_ws,
             gloss, 
             light.color,
             vis_coeff, 
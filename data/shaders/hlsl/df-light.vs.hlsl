@@ -28,6 +28,7 @@ struct vso
     float2 coord : TEXCOORD0;
     float3 viewray : TEXCOORD1;
     nointerpolation uint tile_id : TEXCOORD2;
+    nointerpolation uint tile_gid : TEXCOORD3;
 };
 
 /* uniforms */
@@ -64,6 +65,7 @@ vso main(vsi input)
     o.pos = float4(pos_prj, 1.0f);
     o.coord = coord;
     o.tile_id = input.instance_idx;
+    o.tile_gid = tile_id;
     return o;
 }
 
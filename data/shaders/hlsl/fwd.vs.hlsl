@@ -13,10 +13,6 @@
  *
  ***********************************************************************************/
 
-#ifndef _MAX_INSTANCES_
-#error "_MAX_INSTANCES_ not defined"
-#endif
-
 struct vsi
 {
     float4 pos : POSITION;
@@ -37,20 +33,15 @@ cbuffer cb_frame
     float4x4 c_viewproj;
 };
 
-
-cbuffer cb_xforms
-{
-    float4x3 c_mats[_MAX_INSTANCES_];
-};
-
 vso main(vsi input)
 {
     vso output;
+    instance_data inst = get_instance(input.instance_idx);
 
-    float4 pos_ws = float4(mul(input.pos, c_mats[input.instance_idx]), 1);
+    float4 pos_ws = float4(mul(input.pos, inst.xform), 1);
 
     output.pos = mul(pos_ws, c_viewproj);
-    output.norm_ws = mul(input.norm, (float3x3)c_mats[input.instance_idx]);
+    output.norm_ws = mul(input.norm, (float3x3)inst.xform);
     output.coord0 = float2(input.coord0.x, 1 - input.coord0.y);
 
     return output;
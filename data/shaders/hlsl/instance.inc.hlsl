@@ -0,0 +1,44 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, 
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation 
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/* instance stream: world matrices of the frame (3 texels each) are shared by all passes
+ * each draw reads its instance records (x: matrix index, y: skin palette offset),
+ * starting from c_instance_offset */
+Buffer<float4> tb_xforms;
+Buffer<float4> tb_instances;
+uint c_instance_offset;
+
+struct instance_data
+{
+    float4x3 xform;
+    int skin_offset;    /* palette offset (in bones) for skinned instances */
+};
+
+instance_data get_instance(uint inst_idx)
+{
+    instance_data r;
+    float4 rec = tb_instances.Load(c_instance_offset + inst_idx);
+    int offset = int(rec.x)*3;
+    float4 col1 = tb_xforms.Load(offset);
+    float4 col2 = tb_xforms.Load(offset + 1);
+    float4 col3 = tb_xforms.Load(offset + 2);
+    r.xform = float4x3(
+        float3(col1.x, col2.x, col3.x),
+        float3(col1.y, col2.y, col3.y),
+        float3(col1.z, col2.z, col3.z),
+        float3(col1.w, col2.w, col3.w));
+    r.skin_offset = int(rec.y);
+    return r;
+}
@@ -15,7 +15,8 @@
 
 #if defined(_SKIN_)
 
-/* cbuffer for skinning: shared among all skinning shaders */
+/* packed skinning palette of the whole frame, instances index into it by their skin_offset
+ * (see instance_data) */
 Buffer<float4> tb_skins;
 
 struct skin_output_pnt
@@ -32,9 +33,9 @@ struct skin_output_pn
     float3 norm;
 };
 
-float4x3 get_bone(int inst_idx, int bone_idx)
+float4x3 get_bone(int skin_offset, int bone_idx)
 {
-	int offset = (bone_idx + inst_idx*_MAX_BONES_)*3;
+	int offset = (bone_idx + skin_offset)*3;
 	float4 col1 = tb_skins.Load(offset);
 	float4 col2 = tb_skins.Load(offset + 1);
 	float4 col3 = tb_skins.Load(offset + 2);
@@ -45,13 +46,13 @@ float4x3 get_bone(int inst_idx, int bone_idx)
 		float3(col1.w, col2.w, col3.w));
 }
 
-float4 skin_vertex_p(int inst_idx, int4 blend_idxs, float4 blend_weights, float4 pos)
+float4 skin_vertex_p(int skin_offset, int4 blend_idxs, float4 blend_weights, float4 pos)
 {
 	float4 r;
     r = float4(0, 0, 0, 1);
 
 	for (int i = 0; i < 4; i++)	{
-		float4x3 mat = get_bone(inst_idx, blend_idxs[i]);
+		float4x3 mat = get_bone(skin_offset, blend_idxs[i]);
 		r.xyz += mul(pos, mat) * blend_weights[i];
 	}
 
@@ -59,7 +60,7 @@ float4 skin_vertex_p(int inst_idx, int4 blend_idxs, float4 blend_weights, float4
 }
 
 
-skin_output_pn skin_vertex_pn(int inst_idx, int4 blend_idxs, float4 blend_weights, float4 pos, 
+skin_output_pn skin_vertex_pn(int skin_offset, int4 blend_idxs, float4 blend_weights, float4 pos, 
 	float3 norm)
 {
 	skin_output_pn r;
@@ -68,7 +69,7 @@ skin_output_pn skin_vertex_pn(int inst_idx, int4 blend_idxs, float4 blend_weight
     r.norm = float3(0, 0, 0);
 
 	for (int i = 0; i < 4; i++) {
-		float4x3 mat = get_bone(inst_idx, blend_idxs[i]);
+		float4x3 mat = get_bone(skin_offset, blend_idxs[i]);
 		float w = blend_weights[i];
         float3x3 m3 = (float3x3)mat;
 
@@ -79,7 +80,7 @@ skin_output_pn skin_vertex_pn(int inst_idx, int4 blend_idxs, float4 blend_weight
 	return r;    
 }
 
-skin_output_pnt skin_vertex_pnt(int inst_idx, int4 blend_idxs, float4 blend_weights, float4 pos,
+skin_output_pnt skin_vertex_pnt(int skin_offset, int4 blend_idxs, float4 blend_weights, float4 pos,
     float3 norm, float3 tangent, float3 binorm)
 {
 	skin_output_pnt r;
@@ -90,7 +91,7 @@ skin_output_pnt skin_vertex_pnt(int inst_idx, int4 blend_idxs, float4 blend_weig
     r.binorm = float3(0, 0, 0);
 
 	for (int i = 0; i < 4; i++) {
-		float4x3 mat = get_bone(inst_idx, blend_idxs[i]);
+		float4x3 mat = get_bone(skin_offset, blend_idxs[i]);
         float3x3 m3 = (float3x3)mat;
 		float w = blend_weights[i];
 
@@ -190,6 +190,19 @@ struct gfx_params
     uint width; /**< render buffer width in pixels */
     uint height; /**< render buffer height in pixels */
     uint refresh_rate; /**< monitor refresh for given resolution */
+    uint upload_budget; /**< data of background loaded gpu objects that is created per frame (kb),
+                            if =0, default size will be set (4mb) */
+    uint upload_objs_max; /**< background loaded gpu objects that are created per frame,
+                              =0 is unlimited */
+    uint light_slices; /**< depth slices of each screen tile for local lights,
+                           =0 uses default (16) */
+    uint cluster_lights_max; /**< maximum local lights in each light cluster,
+                                 =0 uses default (32) */
+    uint csm_cascades; /**< sun shadow cascades (1..4), =0 uses default (3) */
+    uint csm_size; /**< width/height of each sun shadow cascade in pixels, =0 uses default (1024) */
+    float csm_far; /**< view distance covered by sun shadow cascades, =0 uses default (50) */
+    float csm_lambda; /**< cascade split scheme, from uniform to logarithmic (1),
+                          =0 uses default (0.75), <0 uses uniform splits */
 };
 
 /**
@@ -202,6 +215,7 @@ struct init_params
 {
     uint flags;  /**< combination of eng_flags enum @see eng_flags */
     uint console_lines_max;   /**< maximum console lines */
+    uint load_threads_max;    /**< maximum threads for background loading, =0 uses half of task threads */
 
     struct gfx_params gfx; /**< graphics parameters @see gfx_params*/
     struct dev_params dev; /**< dev paramters @see dev_params*/
@@ -0,0 +1,247 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef __ANIMCTRL_H__
+#define __ANIMCTRL_H__
+
+#include "dhcore/types.h"
+#include "dhcore/vec-math.h"
+#include "dhcore/hash-table.h"
+
+#include "anim.h"
+
+/* animation controller data and state machine
+ * loading (json, h3dc), compiling and state switching only touch controller memory, they don't
+ * use the resource manager, graphics or components, so tools and tests can use them without the
+ * engine. pose evaluation (which needs the animation reel) lives in anim.c */
+
+/* maximum state switches (transitions) that each layer can take in a single update
+ * prevents chained instant transitions from stalling the frame */
+#define ANIM_CTRL_SWITCH_MAX 8
+
+/* layer blend function callbacks */
+typedef const struct mat3f* (*pfn_anim_layerblend)(struct mat3f* result, struct mat3f* src,
+    struct mat3f* dest, float mask);
+
+enum anim_ctrl_sequencetype
+{
+    ANIM_CTRL_SEQUENCE_UNKNOWN = 0,
+    ANIM_CTRL_SEQUENCE_CLIP,
+    ANIM_CTRL_SEQUENCE_BLENDTREE
+};
+
+enum anim_ctrl_layertype
+{
+    ANIM_CTRL_LAYER_OVERRIDE = 0,
+    ANIM_CTRL_LAYER_ADDITIVE
+};
+
+struct anim_ctrl_param
+{
+    char name[32];
+    uint name_hash;
+    enum anim_ctrl_paramtype type;
+    union   {
+        float f;
+        int i;
+        int b;
+    } value;
+};
+
+struct anim_ctrl_layer
+{
+    char name[32];
+    enum anim_ctrl_layertype type;
+    uint state_cnt;
+    uint* states; /* index to states in anim_ctrl */
+    uint default_state_idx;
+    uint bone_mask_cnt;
+    char* bone_mask;    /* array of strings, in form of series of char[32] items */
+};
+
+struct anim_ctrl_sequence
+{
+    enum anim_ctrl_sequencetype type;
+    uint idx;
+};
+
+struct anim_ctrl_state
+{
+    char name[32];
+    float speed;
+    uint transition_cnt;
+    uint* transitions;
+    struct anim_ctrl_sequence seq;
+};
+
+struct anim_ctrl_blendtree
+{
+    char name[32];
+    uint param_idx;
+    uint child_seq_cnt;
+    float child_cnt_f;
+    struct anim_ctrl_sequence* child_seqs;
+};
+
+struct anim_ctrl_clip
+{
+    char name[32];
+    uint name_hash;
+};
+
+enum anim_predicate
+{
+    ANIM_PREDICATE_UNKNOWN = 0,
+    ANIM_PREDICATE_EQUAL,
+    ANIM_PREDICATE_NOT,
+    ANIM_PREDICATE_GREATER,
+    ANIM_PREDICATE_LESS
+};
+
+enum anim_ctrl_tgrouptype
+{
+    ANIM_CTRL_TGROUP_EXIT = 0,
+    ANIM_CTRL_TGROUP_PARAM
+};
+
+struct anim_ctrl_transition_groupitem
+{
+    enum anim_ctrl_tgrouptype type;
+    enum anim_predicate predicate;
+    uint param_idx;
+    union {
+        float f;
+        int b;
+        int i;
+    } value;
+};
+
+struct anim_ctrl_transition_group
+{
+    uint item_cnt;
+    struct anim_ctrl_transition_groupitem* items;  /* conditions */
+};
+
+struct anim_ctrl_transition
+{
+    float duration;
+    uint owner_state_idx;
+    uint target_state_idx;
+    uint group_cnt;
+    struct anim_ctrl_transition_group* groups;
+};
+
+/* controller data is allocated as one contiguous block, starting with anim_ctrl_data
+ * precompiled (h3dc) files store the memory image of this block */
+struct anim_ctrl_data
+{
+    struct allocator* alloc;
+    char reel_filepath[128];
+    uint data_size; /* size of the whole memory block */
+
+    uint transition_cnt;
+    uint clip_cnt;
+    uint blendtree_cnt;
+    uint state_cnt;
+    uint param_cnt;
+    uint layer_cnt;
+
+    struct anim_ctrl_transition* transitions;
+    struct anim_ctrl_clip* clips;
+    struct anim_ctrl_blendtree* blendtrees;
+    struct anim_ctrl_state* states;
+    struct anim_ctrl_param* params;
+    struct anim_ctrl_layer* layers;
+
+    struct hashtable_fixed param_tbl;   /* key: param-name, value: index */
+};
+
+/*************************************************************************************************/
+/* instance for each anim-controller */
+struct anim_ctrl_param_inst
+{
+    enum anim_ctrl_paramtype type;
+    union   {
+        float f;
+        int i;
+        int b;
+    } value;
+};
+
+struct anim_ctrl_layer_inst
+{
+    uint state_idx;   /* active state (=INVALID_INDEX if we are on state) */
+    uint transition_idx;  /* active transition (=INVALID_INDEX if we are not on transition) */
+    pfn_anim_layerblend blend_fn;
+
+    uint8* buff; /* buffer for below allocations */
+    struct anim_pose* poses;    /* temp storing final blended pose (cnt = pose_cnt of reel) */
+    float* bone_mask;    /* bone-mask, multipliers for poses (cnt = pose_cnt of reel) */
+};
+
+struct anim_ctrl_clip_inst
+{
+    float start_tm;  /* global start time */
+    float tm;    /* local time */
+    float progress;  /* normalized progress (*N if looped) */
+    float duration;
+    int looped;
+    uint rclip_idx;
+};
+
+struct anim_ctrl_blendtree_inst
+{
+    uint seq_a;   /* first sequence being played (=INVALID_INDEX if none) */
+    uint seq_b;   /* second sequence being played (=INVALID_INDEX if none) */
+    float blend;
+    float progress;
+};
+
+struct anim_ctrl_transition_inst
+{
+    float start_tm; /* global start time */
+    float blend; /* blend position [0~1] */
+};
+
+/* instance data holds the whole state of each anim-controller */
+struct anim_ctrl_instance_data
+{
+    struct allocator* alloc;
+    anim_ctrl owner;
+    reshandle_t reel_hdl;
+
+    float tm;    /* global time */
+    float playrate;  /* playback rate (default=1) */
+    uint eval_cnt;  /* number of state and transition checks in last update (debugging) */
+
+    uint layer_cnt;
+    struct anim_ctrl_param_inst* params;
+    struct anim_ctrl_layer_inst* layers;
+    struct anim_ctrl_clip_inst* clips;
+    struct anim_ctrl_blendtree_inst* blendtrees;
+    struct anim_ctrl_transition_inst* transitions;
+};
+
+/* allocates instance data of the controller without binding any animation reel
+ * all layers start without state, first 'anim_ctrl_resolve' moves them to their default state */
+anim_ctrl_inst anim_ctrl_allocinstance(struct allocator* alloc, const anim_ctrl ctrl);
+void anim_ctrl_freeinstance(anim_ctrl_inst inst);
+
+/* resolves state switches of a single layer at time 'tm'
+ * each switch (starting or finishing a transition) re-checks the new state of this layer only,
+ * but no more than ANIM_CTRL_SWITCH_MAX times. returns number of switches taken */
+uint anim_ctrl_resolve(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx, float tm);
+
+#endif /* __ANIMCTRL_H__ */
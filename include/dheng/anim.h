@@ -56,11 +56,26 @@ struct anim_clip_desc
     float duration;
 };
 
+struct anim_cache_stats
+{
+    uint hits;
+    uint misses;
+    uint item_cnt;
+    size_t mem_used;
+};
+
 
 /* animation controller API */
 anim_ctrl anim_ctrl_load(struct allocator* alloc, const char* janim_filepath,
                          uint thread_id);
+anim_ctrl anim_ctrl_loadmem(struct allocator* alloc, const char* name, const void* data,
+                            size_t size, uint thread_id);
 void anim_ctrl_unload(anim_ctrl ctrl);
+size_t anim_ctrl_getsize(anim_ctrl ctrl);
+/* precompiled (h3dc) controllers, json remains the authoring format
+ * h3dc files are memory images and only load on the platform (struct layout) that wrote them */
+ENGINE_API result_t anim_ctrl_savebin(anim_ctrl ctrl, const char* h3dc_filepath);
+ENGINE_API result_t anim_ctrl_compile(const char* janim_filepath, const char* h3dc_filepath);
 void anim_ctrl_update(const anim_ctrl ctrl, anim_ctrl_inst inst, float tm,
                       struct allocator* tmp_alloc);
 void anim_ctrl_debug(const anim_ctrl ctrl, anim_ctrl_inst inst);
@@ -79,6 +94,18 @@ ENGINE_API int anim_ctrl_get_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const c
 ENGINE_API void anim_ctrl_set_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name,
   int value);
 
+/* index based parameter access, to avoid name lookups for frequently updated parameters
+ * param_idx is fetched once by 'anim_ctrl_findparam' and remains valid until controller reloads */
+ENGINE_API uint anim_ctrl_findparam(anim_ctrl ctrl, const char* name);
+ENGINE_API enum anim_ctrl_paramtype anim_ctrl_get_paramtype_byidx(anim_ctrl_inst inst,
+  uint param_idx);
+ENGINE_API float anim_ctrl_get_paramf_byidx(anim_ctrl_inst inst, uint param_idx);
+ENGINE_API void anim_ctrl_set_paramf_byidx(anim_ctrl_inst inst, uint param_idx, float value);
+ENGINE_API int anim_ctrl_get_paramb_byidx(anim_ctrl_inst inst, uint param_idx);
+ENGINE_API void anim_ctrl_set_paramb_byidx(anim_ctrl_inst inst, uint param_idx, int value);
+ENGINE_API int anim_ctrl_get_parami_byidx(anim_ctrl_inst inst, uint param_idx);
+ENGINE_API void anim_ctrl_set_parami_byidx(anim_ctrl_inst inst, uint param_idx, int value);
+
 void anim_ctrl_fetchresult_hierarchal(const anim_ctrl_inst inst, const uint* bindmap,
                                       const cmphandle_t* xforms,
                                       const uint* root_idxs, uint root_idx_cnt,
@@ -91,7 +118,10 @@ result_t anim_ctrl_set_reel(anim_ctrl_inst inst, reshandle_t reel_hdl);
 
 /* animation reel API */
 anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thread_id);
+anim_reel anim_loadmem(struct allocator* alloc, const char* name, const void* data, size_t size,
+    uint thread_id);
 void anim_unload(anim_reel reel);
+size_t anim_getsize(anim_reel reel);
 
 void anim_update_clip_hierarchal(const anim_reel reel, uint clip_idx, float t,
     const uint* bindmap, const cmphandle_t* xforms, uint frame_force_idx,
@@ -105,6 +135,15 @@ void anim_get_clipdesc(struct anim_clip_desc* desc, const anim_reel reel, uint c
 void anim_get_desc(struct anim_reel_desc* desc, const anim_reel reel);
 const char* anim_get_posebinding(const anim_reel reel, uint pose_idx);
 
+/* shared sampling cache (opt-in), instances sampling the same clip at the same quantized time
+ * share sampled poses within the frame. time is snapped to 1/4 of the reel frame when enabled */
+result_t anim_cache_init(int dev_mode);
+void anim_cache_release();
+void anim_cache_beginframe();
+ENGINE_API void anim_cache_enable(int enable);
+ENGINE_API int anim_cache_isenabled();
+ENGINE_API void anim_cache_getstats(OUT struct anim_cache_stats* stats);
+
 /* debugging */
 int anim_ctrl_get_curstate(anim_ctrl ctrl, anim_ctrl_inst inst, const char* layer_name, 
   OUT char* state, OUT OPTIONAL float* progress);
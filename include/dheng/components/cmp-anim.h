@@ -43,7 +43,7 @@ struct cmp_anim
     uint root_cnt;
     uint* bindmap;  /* maps animation poses to joints in the target resource (count: reel->pose_cnt) */
     uint* root_idxs;    /* index of the root nodes (in xform_hdls or pose) */
-    uint filepathhash;
+    uint filepathhash;  /* cached path id of filepath (rs_get_pathid), for rs_addref_byid */
     struct allocator* alloc;    /* we have dynamic allocation in this component */
 };
 
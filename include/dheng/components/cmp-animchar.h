@@ -40,7 +40,7 @@ struct cmp_animchar
     const cmphandle_t* xform_hdls; /* xform component handles for hierarchal animation */
     uint xform_cnt;   /* xform_hdls count */
 
-    uint filepathhash;        /* filehash to keep track of possible reloading */
+    uint filepathhash;        /* cached path id of filepath (rs_get_pathid), detects reloads */
     struct allocator* alloc;    /* we have dynamic allocation within this component */
 };
 
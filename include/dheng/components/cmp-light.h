@@ -45,12 +45,15 @@ struct ALIGN16 cmp_light
 	struct vec4f dir;
 	struct color color_lin;
     uint scheme_id;
+    uint version;   /* bumped on every change, renderers compare it to detect dirty lights */
 };
 
 ENGINE_API result_t cmp_light_modifytype(struct cmp_obj* obj, struct allocator* alloc,
 	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl);
 ENGINE_API result_t cmp_light_modifycolor(struct cmp_obj* obj, struct allocator* alloc,
 	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl);
+ENGINE_API result_t cmp_light_modifyintensity(struct cmp_obj* obj, struct allocator* alloc,
+	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl);
 ENGINE_API result_t cmp_light_modifyatten(struct cmp_obj* obj, struct allocator* alloc,
 	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl);
 ENGINE_API result_t cmp_light_modifylod(struct cmp_obj* obj, struct allocator* alloc,
@@ -63,7 +66,7 @@ static const struct cmp_value cmp_light_values[] = {
 	{"color", CMP_VALUE_FLOAT4, offsetof(struct cmp_light, color), sizeof(struct color), 1,
 		cmp_light_modifycolor, "colorpicker;"},
 	{"intensity", CMP_VALUE_FLOAT, offsetof(struct cmp_light, intensity), sizeof(float), 1,
-			NULL, "spinner;min=0;max=10;stride=0.1;"},
+			cmp_light_modifyintensity, "spinner;min=0;max=10;stride=0.1;"},
 	{"atten_near", CMP_VALUE_FLOAT, offsetof(struct cmp_light, atten_near), sizeof(float), 1,
 			cmp_light_modifyatten, "spinner;min=0;max=100;stride=0.5;"},
 	{"atten_far", CMP_VALUE_FLOAT, offsetof(struct cmp_light, atten_far), sizeof(float), 1,
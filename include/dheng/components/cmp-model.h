@@ -41,7 +41,7 @@ struct cmp_model
 	reshandle_t model_hdl;
 	uint xform_cnt;
 	cmphandle_t xforms[CMP_MESH_XFORM_MAX];
-	uint filepath_hash;
+	uint filepath_hash;  /* cached path id of filepath (rs_get_pathid), for rs_addref_byid */
 	struct gfx_model_instance* model_inst; /* instance data is created for each model */
     uint flags;   /* enum CMP_MODEL_FLAGS combination */
 };
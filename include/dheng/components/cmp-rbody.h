@@ -31,7 +31,7 @@ struct cmp_rbody
     /* internal */
     phx_obj rbody;
     reshandle_t prefab_hdl;
-    uint filepath_hash;
+    uint filepath_hash;   /* cached path id of filepath (rs_get_pathid), for rs_addref_byid */
     uint px_sceneid;  /* owner scene */
 };
 
@@ -57,6 +57,8 @@ ENGINE_API void hud_add_graph(const char* alias, pfn_hud_render_graph render_fn,
 ENGINE_API void hud_remove_graph(const char* alias);
 ENGINE_API void hud_add_image(const char* alias, gfx_texture img_tex, int fullscreen,
     uint width, uint height, const char* caption);
+/* replaces texture of an existing image, for images that are rendered into per-frame targets */
+ENGINE_API void hud_set_image(const char* alias, gfx_texture img_tex);
 ENGINE_API void hud_remove_image(const char* alias);
 
 #endif /* DEBUG_HUD_H_ */
@@ -131,6 +131,8 @@ _EXTERN_BEGIN_
 ENGINE_API const struct frame_stats* eng_get_framestats();
 ENGINE_API float eng_get_frametime();
 const struct init_params* eng_get_params();
+uint eng_get_jobthreads(OUT int* thread_idxs, uint max_cnt);
+uint eng_get_threadcnt();
 void eng_get_memstats(struct eng_mem_stats* stats);
 
 _EXTERN_END_
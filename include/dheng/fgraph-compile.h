@@ -0,0 +1,81 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef FGRAPH_COMPILE_H_
+#define FGRAPH_COMPILE_H_
+
+#include "gfx-fgraph.h"
+
+/* declaration and compile step of the frame-graph (see gfx-fgraph.h)
+ * compile culls passes, calculates resource lifetimes and assigns transients to the physical
+ * target pool, gfx-fgraph.c creates the targets and executes the passes.
+ * this is cpu-only logic and doesn't touch the graphics device, graph data is exposed so tests
+ * can inspect a compiled graph */
+
+enum fg_resflag
+{
+    FG_RES_IMPORTED = (1<<0),
+    FG_RES_OUTPUT = (1<<1)
+};
+
+struct fg_resource
+{
+    char name[32];
+    uint flags; /* combination of fg_resflag */
+    struct gfx_fg_texdesc desc;    /* transients only */
+    gfx_texture tex;
+    gfx_rendertarget rt;
+    int first_pass; /* lifetime, index of the first and last living pass that use the resource */
+    int last_pass;
+    uint pool_idx;  /* physical target of transient, INVALID_INDEX if not assigned */
+};
+
+struct fg_pass
+{
+    char name[32];
+    uint flags; /* combination of gfx_fg_passflag */
+    pfn_gfx_fg_exec exec_fn;
+    void* param;
+    uint reads[GFX_FG_PASS_IOMAX];
+    uint writes[GFX_FG_PASS_IOMAX];
+    uint read_cnt;
+    uint write_cnt;
+    int culled;
+};
+
+/* physical transient target, kept between frames */
+struct fg_target
+{
+    struct gfx_fg_texdesc desc;
+    gfx_texture tex;
+    gfx_rendertarget rt;
+    int busy_until; /* last pass that uses the target in current frame, -1 if free */
+    uint used_frame;
+};
+
+struct gfx_fgraph
+{
+    struct fg_pass passes[GFX_FG_PASSES_MAX];
+    struct fg_resource resources[GFX_FG_RESOURCES_MAX];
+    struct fg_target pool[GFX_FG_POOL_MAX];
+    uint pass_cnt;
+    uint res_cnt;
+    uint pool_cnt;
+    uint frame;
+    int overflow;   /* declarations exceeded limits in current frame */
+    int compiled;
+};
+
+#endif /* FGRAPH_COMPILE_H_ */
@@ -0,0 +1,41 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#ifndef FILE_MAP_H_
+#define FILE_MAP_H_
+
+#include "dhcore/types.h"
+
+#define FMAP_DIRS_MAX 8
+
+/* read-only memory mapped view of a loose file (mmap/MapViewOfFile), loaders parse the view in
+ * place instead of reading the file into temp memory first */
+struct file_map
+{
+    const void* data;
+    size_t size;
+    uptr_t file;    /* platform handles */
+    uptr_t mapping;
+};
+
+/* adds a data directory that relative paths are searched in, same as fio_addvdir */
+void fmap_adddir(const char* dir);
+void fmap_cleardirs();
+
+/* maps the whole file, returns FALSE if file is not found on disk (or is empty), in which case the
+ * caller should fall back to file-io */
+int fmap_open(struct file_map* m, const char* filepath);
+void fmap_close(struct file_map* m);
+
+#endif /* FILE_MAP_H_ */
@@ -19,6 +19,9 @@
  * There are two kinds of canvas function, 2D and 3D:\n
  * - 2D functions, No matter where you call them, are executed and batched at the end of the render pipeline
  * - 3D functions are executed immediately, but should come between *gfx_canvas_begin3d* and *gfx_canvas_end3d* functions
+ * - *_mt* functions can be called from any task thread, each thread records into it's own command
+ *   buffer without locking. 2D items are merged on *gfx_canvas_render2d* and 3D lines are drawn on
+ *   *gfx_canvas_end3d*, so producers must be finished (waited on) before rendering begins
  */
 
 #ifndef __GFXCANVAS_H__
@@ -387,4 +390,37 @@ ENGINE_API void gfx_canvas_begin3d(gfx_cmdqueue cmdqueue, float rt_width, float
  */
 ENGINE_API void gfx_canvas_end3d();
 
+/**
+ * Draws text from a task thread, uses default font and no clipping
+ * @param thread_id Id of the calling thread (task-mgr), main thread is 0
+ * @see gfx_canvas_text2dpt
+ * @ingroup gfx-canvas
+ */
+ENGINE_API void gfx_canvas_text2dpt_mt(uint thread_id, const char* text, int x, int y,
+    const struct color* c, uint flags);
+
+/**
+ * Draws rectangle from a task thread, solid rectangles are filled with color *c*
+ * @see gfx_canvas_rect2d
+ * @ingroup gfx-canvas
+ */
+ENGINE_API void gfx_canvas_rect2d_mt(uint thread_id, const struct rect2di* rc, int line_width,
+    const struct color* c, uint flags);
+
+/**
+ * Draws 2D line from a task thread
+ * @see gfx_canvas_line2d
+ * @ingroup gfx-canvas
+ */
+ENGINE_API void gfx_canvas_line2d_mt(uint thread_id, int x0, int y0, int x1, int y1,
+    int line_width, const struct color* c);
+
+/**
+ * Draws 3D line from a task thread, lines are drawn in batches at *gfx_canvas_end3d*
+ * @see gfx_canvas_line3d
+ * @ingroup gfx-canvas
+ */
+ENGINE_API void gfx_canvas_line3d_mt(uint thread_id, const struct vec4f* p0, const struct vec4f* p1,
+    const struct color* c);
+
 #endif /* GFXCANVAS_H */
@@ -103,15 +103,24 @@ const struct gfx_gpu_memstats* gfx_get_memstats();
 int gfx_check_feature(enum gfx_feature ft);
 
 /* Multi-thread (delayed) object creation routines, currently only implemented for GL,
- * D3D11 spec doesn't need these */
+ * D3D11 spec doesn't need these
+ * Init data of buffers/textures that are created in loader threads is not copied, loaders must
+ * keep it valid until they call gfx_delayed_fillobjects */
 /* Creates queued objects, called from main thread */
 void gfx_delayed_createobjects();
-/* Wait for created signal, called from loader thread */
+/* Wait for created signal, called from loader thread, returns immediately if nothing is queued */
 void gfx_delayed_waitforobjects(uint thread_id);
+/* Returns TRUE if loader thread has queued objects that are not signaled yet */
+int gfx_delayed_haspending(uint thread_id);
 /* Perform memory copy to mapped buffers only, called from loader threads */
 void gfx_delayed_fillobjects(uint thread_id);
-void gfx_delayed_finalizeobjects();
+/* Finalizes filled objects, called from main thread, returns FALSE if objects are busy (try later) */
+int gfx_delayed_finalizeobjects();
 void gfx_delayed_release();
+/* Sets per-frame budget of gfx_delayed_createobjects, objs_max=0 is unlimited
+ * GL only, d3d creates objects in loader threads and ignores it */
+void gfx_delayed_setbudget(uint bytes_max, uint objs_max);
+void gfx_delayed_getstats(struct gfx_delayed_stats* stats);
 
 _EXTERN_END_
 
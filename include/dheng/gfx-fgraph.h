@@ -0,0 +1,98 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef __GFXFGRAPH_H__
+#define __GFXFGRAPH_H__
+
+#include "gfx-types.h"
+
+/* frame graph
+ * passes are declared every frame with the resources they read and write, in execution order.
+ * compiling the graph culls passes that don't contribute to graph outputs and assigns transient
+ * render-targets with non-overlapping lifetimes to the same physical target (aliasing).
+ * compile step doesn't touch the device (see fgraph-compile.h), physical targets are created on
+ * execute */
+
+#define GFX_FG_PASSES_MAX 32
+#define GFX_FG_RESOURCES_MAX 32
+#define GFX_FG_PASS_IOMAX 8 /* maximum reads and writes of each pass */
+#define GFX_FG_POOL_MAX 16  /* maximum physical transient targets */
+
+struct gfx_fgraph;
+
+enum gfx_fg_passflag
+{
+    GFX_FG_PASS_NOCULL = (1<<0) /* pass has side effects outside the graph, never culled */
+};
+
+/* transient target description, transients with equal descriptions can share a target */
+struct gfx_fg_texdesc
+{
+    uint width;
+    uint height;
+    enum gfx_format fmt;
+};
+
+struct gfx_fg_stats
+{
+    uint pass_cnt;
+    uint culled_cnt;
+    uint transient_cnt; /* transient resources used by living passes */
+    uint target_cnt;    /* physical targets that transients are mapped to */
+    size_t transient_bytes; /* memory that transients would take without aliasing */
+    size_t target_bytes;    /* memory of physical targets */
+};
+
+typedef void (*pfn_gfx_fg_exec)(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+
+struct gfx_fgraph* gfx_fg_create();
+void gfx_fg_destroy(struct gfx_fgraph* fg);
+/* clears passes and resources for a new frame, physical targets are kept */
+void gfx_fg_reset(struct gfx_fgraph* fg);
+/* destroys all physical targets (on resize) */
+void gfx_fg_releasepool(struct gfx_fgraph* fg);
+
+/* resources: return INVALID_INDEX on failure, passing INVALID_INDEX to read/write is ignored
+ * imported resources are owned outside the graph and can be bound later by producer pass */
+uint gfx_fg_import(struct gfx_fgraph* fg, const char* name, OPTIONAL gfx_texture tex,
+    OPTIONAL gfx_rendertarget rt);
+uint gfx_fg_transient(struct gfx_fgraph* fg, const char* name,
+    const struct gfx_fg_texdesc* desc);
+uint gfx_fg_findres(struct gfx_fgraph* fg, const char* name);
+void gfx_fg_setoutput(struct gfx_fgraph* fg, uint res);
+
+/* passes */
+uint gfx_fg_addpass(struct gfx_fgraph* fg, const char* name, uint flags, pfn_gfx_fg_exec exec_fn,
+    void* param);
+void gfx_fg_read(struct gfx_fgraph* fg, uint pass, uint res);
+void gfx_fg_write(struct gfx_fgraph* fg, uint pass, uint res);
+
+/* compile is cpu-only: culling, lifetimes and aliasing */
+result_t gfx_fg_compile(struct gfx_fgraph* fg);
+void gfx_fg_execute(struct gfx_fgraph* fg, gfx_cmdqueue cmdqueue,
+    const struct gfx_view_params* params);
+
+/* valid while executing */
+gfx_texture gfx_fg_gettexture(struct gfx_fgraph* fg, uint res);
+gfx_rendertarget gfx_fg_getrendertarget(struct gfx_fgraph* fg, uint res);
+void gfx_fg_bindimport(struct gfx_fgraph* fg, uint res, OPTIONAL gfx_texture tex,
+    OPTIONAL gfx_rendertarget rt);
+int gfx_fg_isculled(struct gfx_fgraph* fg, uint pass);
+
+void gfx_fg_getstats(struct gfx_fgraph* fg, OUT struct gfx_fg_stats* stats);
+void gfx_fg_dump(struct gfx_fgraph* fg);
+
+#endif /* __GFXFGRAPH_H__ */
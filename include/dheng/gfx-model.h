@@ -95,6 +95,7 @@ struct gfx_model_map
 {
 	enum gfx_model_maptype type;
 	char filepath[DH_PATH_MAX];
+	uint path_id;	/* interned filepath for resource lookups (see rs_get_pathid) */
 };
 
 enum gfx_model_mtl_flag
@@ -131,6 +132,8 @@ struct gfx_model_posegpu
 	struct mat3f* mats; /* final joint mats */
     struct mat3f* offset_mats; /* will be copied from skeleton data */
     struct mat3f* skin_mats;    /* result of multiplying 'mats' into skeleton's offset_mat */
+    uint palette_idx;   /* offset (in bones) of skin_mats in the frame's packed skin palette */
+    uint palette_frame; /* renderer frame that palette_idx is valid for */
 };
 
 /* instanced for each mesh, used in render pipeline */
@@ -140,6 +143,7 @@ struct gfx_model_mtlgpu
 	struct gfx_cblock* cb; /* mtl cblock */
 	struct gfx_renderpass_item passes[GFX_RENDERPASS_MAX];
 	int invalidate_cb; /* indicates that the data inside 'cb' is changed */
+	uint cb_hash; /* hash of cb contents, renderers use it to share material slots */
 };
 
 struct gfx_model_submesh
@@ -197,6 +201,7 @@ struct gfx_model
 	uint* renderable_idxs;	/* indexes to renderable nodes */
 	struct allocator* alloc;
 	struct aabb bb;
+    uint data_size; /* size of cpu data block (bytes) */
 };
 
 /* instanced for each model (objects in scene), used for rendering */
@@ -208,13 +213,21 @@ struct gfx_model_instance
 	struct gfx_model_posegpu** poses; /* poses for each skinned geo or NULL, count=model->geo_cnt */
 	uint* unique_ids;	/* count=mesh count(x)each mesh submesh count: unique ids r used in batcher for instancing*/
     int* alpha_flags;    /* count = renderable-node-count: indicates that each node has some kind of alpha */
+    uint* xform_idxs;   /* count = node-count: index of each node's matrix in xform stream */
+    uint xform_frame;   /* renderer frame that xform_idxs are valid for */
 	struct allocator* alloc;
 };
 
 /* API */
 struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filepath,
     uint thread_id);
+/* loads model from h3dm file data that is already in memory, 'data' is not modified or freed,
+ * 'name' is only used for error reporting */
+struct gfx_model* gfx_model_loadmem(struct allocator* alloc, const char* name, const void* data,
+    size_t size, uint thread_id);
 void gfx_model_unload(struct gfx_model* model);
+/* total memory used by model (cpu data + gpu buffers) in bytes */
+size_t gfx_model_getsize(const struct gfx_model* model);
 
 struct gfx_model_instance* gfx_model_createinstance(struct allocator* alloc,
 		struct allocator* tmp_alloc, reshandle_t model);
@@ -228,6 +241,13 @@ uint gfx_model_findjoint(const struct gfx_model_skeleton* skeleton, const char*
  */
 void gfx_model_updatemtls(struct gfx_model_instance* inst);
 
+/* textures of color maps are loaded as srgb */
+int gfx_model_map_issrgb(enum gfx_model_maptype type);
+
+/* requests texture mips of instance materials for the projected size of the model (pixels)
+ * mtl_cnt: material count of the model */
+void gfx_model_requestmips(struct gfx_model_instance* inst, uint mtl_cnt, float screen_size);
+
 /* put textures and constant buffers of material into gpu pipeline
  * this function should be called before submitting model to the gpu for draw
  */
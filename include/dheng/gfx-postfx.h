@@ -65,25 +65,24 @@ int gfx_pfx_ssao_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride,
 /**
  * bilateral upsample
  */
-struct gfx_pfx_upsample* gfx_pfx_upsamplebilateral_create(uint width, uint height);
+struct gfx_pfx_upsample* gfx_pfx_upsamplebilateral_create();
 void gfx_pfx_upsamplebilateral_destroy(struct gfx_pfx_upsample* pfx);
-gfx_texture gfx_pfx_upsamplebilateral_render(gfx_cmdqueue cmdqueue,
+void gfx_pfx_upsamplebilateral_render(gfx_cmdqueue cmdqueue,
     struct gfx_pfx_upsample* pfx, const struct gfx_view_params* params,
     gfx_texture src_tex, gfx_texture depth_tex, gfx_texture norm_tex,   /* 1/2 size */
-    gfx_texture upsample_depthtex, gfx_texture upsample_normtex /* full size */);
-result_t gfx_pfx_upsamplebilateral_resize(struct gfx_pfx_upsample* pfx, uint width,
-    uint height);
+    gfx_texture upsample_depthtex, gfx_texture upsample_normtex, /* full size */
+    gfx_rendertarget rt);
 
 /**
  * deferred csm shadow
  * puts rendered csm shadow in .x (red) component of the texture
  */
-struct gfx_pfx_shadow* gfx_pfx_shadowcsm_create(uint width, uint height,
-    OPTIONAL gfx_texture reuse_tex /*=NULL*/);
+struct gfx_pfx_shadow* gfx_pfx_shadowcsm_create();
 void gfx_pfx_shadowcsm_destroy(struct gfx_pfx_shadow* pfx);
-gfx_texture gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue,
-    struct gfx_pfx_shadow* pfx, const struct gfx_view_params* params, gfx_texture depth_tex);
-result_t gfx_pfx_shadowcsm_resize(struct gfx_pfx_shadow* pfx, uint width, uint height);
+void gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_shadow* pfx,
+    const struct gfx_view_params* params, gfx_texture depth_tex, gfx_rendertarget rt);
+/* preview needs the result to stay alive until the end of frame */
+int gfx_pfx_shadowcsm_ispreview(struct gfx_pfx_shadow* pfx);
 
 /**
  * tonemaping postfx
@@ -91,8 +90,9 @@ result_t gfx_pfx_shadowcsm_resize(struct gfx_pfx_shadow* pfx, uint width, uint h
 struct gfx_pfx_tonemap* gfx_pfx_tonemap_create(uint width, uint height, float mid_grey,
     float lum_min, float lum_max, int bloom);
 void gfx_pfx_tonemap_destroy(struct gfx_pfx_tonemap* pfx);
-gfx_texture gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap* pfx,
-    const struct gfx_view_params* params, gfx_texture hdr_tex, OUT gfx_texture* bloom_tex);
+void gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap* pfx,
+    const struct gfx_view_params* params, gfx_texture hdr_tex, gfx_rendertarget rt,
+    OUT gfx_texture* bloom_tex);
 result_t gfx_pfx_tonemap_resize(struct gfx_pfx_tonemap* pfx, uint width, uint height);
 void gfx_pfx_tonemap_setparams(struct gfx_pfx_tonemap* pfx, float midgrey,
     float exposure_min, float exposure_max, int bloom);
@@ -100,11 +100,10 @@ void gfx_pfx_tonemap_setparams(struct gfx_pfx_tonemap* pfx, float midgrey,
 /**
  * fxaa
  */
-struct gfx_pfx_fxaa* gfx_pfx_fxaa_create(uint width, uint height);
+struct gfx_pfx_fxaa* gfx_pfx_fxaa_create();
 void gfx_pfx_fxaa_destroy(struct gfx_pfx_fxaa* pfx);
-result_t gfx_pfx_fxaa_resize(struct gfx_pfx_fxaa* pfx, uint width, uint height);
-gfx_texture gfx_pfx_fxaa_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_fxaa* pfx,
-    gfx_texture rgbl_tex);
+void gfx_pfx_fxaa_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_fxaa* pfx,
+    gfx_texture rgbl_tex, gfx_rendertarget rt);
 
 /**
  * bloom
@@ -40,7 +40,6 @@
 #define GFX_SHADERNAME_s_norm 4200649640 /* s_norm */
 #define GFX_SHADERNAME_c_mtlmax 721890431 /* c_mtlmax */
 #define GFX_SHADERNAME_c_lastmip 2745685943 /* c_lastmip */
-#define GFX_SHADERNAME_c_mats 267559782 /* c_mats */
 #define GFX_SHADERNAME_s_tex 3524135785 /* s_tex */
 #define GFX_SHADERNAME_c_rtvsz 1190044997 /* c_rtvsz */
 #define GFX_SHADERNAME_c_skydir_vs 723502659 /* c_skydir_vs */
@@ -94,3 +93,9 @@
 #define GFX_SHADERNAME_c_elapsedtm 2887808162 /* c_elapsedtm */
 #define GFX_SHADERNAME_c_world 1707161406 /* c_world */
 #define GFX_SHADERNAME_s_noise 2521236077 /* s_noise */
+#define GFX_SHADERNAME_tb_clusters 4271167952 /* tb_clusters */
+#define GFX_SHADERNAME_c_clusterparams 1398636656 /* c_clusterparams */
+#define GFX_SHADERNAME_c_cascade_mask 458647104 /* c_cascade_mask */
+#define GFX_SHADERNAME_tb_xforms 1546126582 /* tb_xforms */
+#define GFX_SHADERNAME_tb_instances 2749435729 /* tb_instances */
+#define GFX_SHADERNAME_c_instance_offset 2397018077 /* c_instance_offset */
@@ -23,6 +23,18 @@
 
 gfx_texture gfx_texture_loaddds(const char* dds_filepath, uint first_mipidx,
 		int srgb, uint thread_id);
+/* loads dds texture without the mips that are larger than size_max (=0 loads all mips)
+ * mip_cnt: returns number of mips in the file, loaded texture has (mip_cnt - first mip) of them */
+gfx_texture gfx_texture_loaddds_mips(const char* dds_filepath, uint first_mipidx, uint size_max,
+    int srgb, uint thread_id, OUT OPTIONAL uint* mip_cnt);
+/* same as gfx_texture_loaddds_mips, but parses dds file data that is already in memory,
+ * 'data' is not modified or freed, 'name' is only used for error reporting */
+gfx_texture gfx_texture_loaddds_mem(const char* name, const void* data, size_t size,
+    uint first_mipidx, uint size_max, int srgb, uint thread_id, OUT OPTIONAL uint* mip_cnt);
+
+/* returns the first (highest detail) mip that is still at least 'size' pixels in it's largest
+ * dimension, used to pick resident mips of streamed textures. cpu only, no gfx calls */
+uint gfx_texture_selectmip(uint width, uint height, uint mip_cnt, float size);
 
 uint gfx_texture_getbpp(enum gfx_format fmt);
 
@@ -162,6 +162,17 @@ struct gfx_gpu_memstats
     size_t buffers;
 };
 
+/* background (delayed) object creation */
+struct gfx_delayed_stats
+{
+    uint pending_cnt;   /* objects waiting to be created */
+    uint deferred_cnt;  /* accumulated creates that are postponed to next frames by the budget */
+    uint bytes_max; /* per-frame budget */
+    uint objs_max;
+    uint staging_size;  /* persistent staging buffer, =0 if not supported */
+    uint staging_used;
+};
+
 struct gfx_framestats
 {
     uint draw_cnt;
@@ -40,11 +40,14 @@ struct gfx_model_posegpu;
 struct scn_render_query;
 struct scn_render_light;
 struct gfx_shader;
+struct gfx_fgraph;
 
 /* global defines */
-#define GFX_INSTANCES_MAX 32
 #define GFX_DEFAULT_RENDER_OBJ_CNT 2000
 #define GFX_SKIN_BONES_MAX 64
+#define GFX_SKIN_PALETTE_MAX (GFX_SKIN_BONES_MAX*256) /* bones of all visible poses in a frame */
+#define GFX_XFORMS_INITCNT (GFX_DEFAULT_RENDER_OBJ_CNT*4)   /* initial world matrices of a frame (grows) */
+#define GFX_INSTANCES_INITCNT (GFX_DEFAULT_RENDER_OBJ_CNT*8) /* initial drawn instances of a frame (grows) */
 
 /* each batch is mainly identified by it's unique_id
  * 'unique_id' represents all the stuff that a sub-object needs for a draw (hashed)
@@ -52,8 +55,8 @@ struct gfx_shader;
  * 	- cast ritem to proper scn_render_XXX structure (see parent gfx_batch_item to identify type)
  * 	- use sub_idx to access the sub-obj (depending on the object)
  * 	- set material constants and textures for each batch_node
- * 	- recurse the 'bll' (batch linked_list) :
- * 		- draw in instanced mode with transform matrices (instance_mats) and count (instance_cnt)
+ * 	- draw in instanced mode with instance count (instance_cnt), shaders fetch transforms ...
+ * 	  from the frame's instance stream, starting at instance_offset (see gfx_get_instancestream)
  */
 struct gfx_batch_node
 {
@@ -61,11 +64,10 @@ struct gfx_batch_node
 	uint sub_idx; /* =INVALID_INDEX if the whole mesh is needed to draw in one call */
 	void* ritem;	/* pointer to scn_render_XXX (see scene-mgr.h), must cast based on obj_type */
 	uint instance_cnt;
-	const struct mat3f* instance_mats[GFX_INSTANCES_MAX];
-    const struct gfx_model_posegpu* poses[GFX_INSTANCES_MAX];
-	struct linked_list lnode; /* items with same unique-ids will be linked together */
-    struct linked_list* bll; /* linked-list connecting batch-nodes: only the first one uses this */
-    uint64 meta_data;
+    uint instance_offset;   /* first instance record of the node in tb_instances */
+    int skinned;    /* instances have skinning poses, palette must be bound for drawing */
+    uint rec_first; /* first/last instance records in frame's record list (gfx.c), packed later */
+    uint rec_last;
 };
 
 /* items presents a full batch, which contains a linked_list to render items (batch nodes) */
@@ -92,7 +94,7 @@ struct gfx_renderpass_lightdata
     struct sphere* bounds;  /* global bounds referenced by lights (see scn_render_query) */
 };
 
-/* callbacks - must be implemented by render-path */
+/* callbacks - must be implemented by render-path (render is optional if setup is implemented) */
 typedef uint (*pfn_gfx_rpath_getshader)(enum cmp_obj_type obj_type, uint rpath_flags);
 typedef result_t (*pfn_gfx_rpath_init)(uint width, uint height);
 typedef void (*pfn_gfx_rpath_release)();
@@ -101,6 +103,23 @@ typedef void (*pfn_gfx_rpath_render)(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
 		void* userdata, OUT struct gfx_rpath_result* result);
 typedef result_t (*pfn_gfx_rpath_resize)(uint width, uint height);
 
+/* frame data of a render-path sub-pass, lives in frame memory and is passed to frame-graph
+ * passes that render-path declares in setup */
+struct gfx_rpath_data
+{
+    const struct gfx_rpath* rpath;
+    struct gfx_batch_item* batch_items;
+    uint batch_cnt;
+    void* userdata;
+    uint output_res;    /* frame-graph resource of the renderpass, must be written by setup */
+    struct gfx_rpath_result* result;
+};
+
+/* optional: declares render-path passes in frame-graph (see gfx-fgraph.h)
+ * render-paths without setup are rendered in a single pass by render_fn */
+typedef void (*pfn_gfx_rpath_setup)(struct gfx_fgraph* fg, const struct gfx_view_params* params,
+    struct gfx_rpath_data* data);
+
 /* render-path: callback functions to render a subset of render data and choose shaders */
 struct gfx_rpath
 {
@@ -110,6 +129,7 @@ struct gfx_rpath
 	pfn_gfx_rpath_release release_fn;
 	pfn_gfx_rpath_render render_fn;
     pfn_gfx_rpath_resize resize_fn;
+    pfn_gfx_rpath_setup setup_fn;
 };
 
 /**
@@ -152,6 +172,9 @@ gfx_sampler gfx_get_globalsampler();
 gfx_sampler gfx_get_globalsampler_low();
 void gfx_draw_fullscreenquad();
 const struct gfx_params* gfx_get_params();
+struct gfx_cblock* gfx_get_skinpalette();
+struct gfx_cblock* gfx_get_xformstream();
+struct gfx_cblock* gfx_get_instancestream();
 void gfx_set_previewrenderflag();
 
 
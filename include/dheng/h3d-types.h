@@ -38,7 +38,9 @@ enum h3d_type
 {
 	H3D_MESH = (1<<0),  /* h3dm files */
 	H3D_ANIM = (1<<1),  /* h3da files */
-    H3D_PHX = (1<<2)    /* h3dp files */
+    H3D_PHX = (1<<2),    /* h3dp files */
+    H3D_ANIMCTRL = (1<<3),   /* h3dc files (precompiled animation controllers) */
+    H3D_BUNDLE = (1<<4) /* h3db files (packed resource bundles) */
 };
 
 enum h3d_texture_type
@@ -231,6 +233,62 @@ struct _GCCPACKED_ h3d_anim
 #endif
 };
 
+/*************************************************************************************************
+ * anim controller (precompiled from json)
+ * data block is a raw memory image of anim_ctrl_data and it's arrays, so it depends on struct
+ * layout, pointer size and endianness of the compiler/platform that wrote it. h3dc controllers are
+ * not portable: compile them per target platform, only ptr_size is verified on load
+ */
+struct _GCCPACKED_ h3d_animctrl
+{
+    uint data_size;   /* size of controller's data block */
+    uint ptr_size;    /* pointer size of the platform that compiled the data */
+    uint param_cnt;
+
+#if 0
+    /* data comes after in the file */
+    /* memory image of the controller data, pointers are stored as offsets from the start of
+     * the block and should be fixed up after loading */
+    uint8* data;
+#endif
+};
+
+/*************************************************************************************************
+ * resource bundle (packed from a recorded resource bundle, see rs_bundle_save)
+ */
+#define H3D_BUNDLE_ALIGN 16 /* alignment of each packed file inside data block */
+
+enum h3d_bundle_flag
+{
+    H3D_BUNDLE_SRGB = (1<<0),   /* texture is loaded as srgb */
+    H3D_BUNDLE_STREAMMIPS = (1<<1)  /* texture mips are streamed */
+};
+
+struct _GCCPACKED_ h3d_bundle_item
+{
+    char filepath[128];
+    uint path_id;   /* hash of filepath */
+    uint type;  /* enum rs_resource_type */
+    uint flags; /* enum h3d_bundle_flag */
+    uint offset;    /* offset of file data, relative to header.data_offset */
+    uint size;  /* size of file data, =0 if the file is not packed and is loaded by path */
+    uint dep_first; /* first index into dependency indexes */
+    uint dep_cnt;   /* number of dependencies (model textures) */
+};
+
+struct _GCCPACKED_ h3d_bundle
+{
+    uint item_cnt;
+    uint dep_cnt;
+
+#if 0
+    /* data comes after in the file */
+    struct h3d_bundle_item* items;  /* count = item_cnt */
+    uint* dep_idxs; /* item indexes of dependencies, count = dep_cnt */
+    /* packed file data starts at header.data_offset */
+#endif
+};
+
 /*************************************************************************************************
  * physics
  */
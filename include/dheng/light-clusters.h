@@ -0,0 +1,90 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#ifndef LIGHT_CLUSTERS_H_
+#define LIGHT_CLUSTERS_H_
+
+#include "dhcore/types.h"
+
+/* screen-space tile range and depth slice range (inclusive) that a light overlaps */
+struct light_range
+{
+    uint x0;
+    uint y0;
+    uint x1;
+    uint y1;
+    uint s0;
+    uint s1;
+    uint idx;   /* index of the light in tb_lights, INVALID_INDEX if it's not visible */
+    float rc[4];    /* screen-space rect (x_min, y_min, x_max, y_max) */
+    float zmin; /* view-space depth range */
+    float zmax;
+};
+
+/* light lists of screen tiles that are split into exponential view-space depth slices
+ * cluster index = tile_idx*slice_cnt + slice, tile_idx = x + y*cnt_x
+ * arrays are owned by the caller, tile counts are written with a stride so they can live inside
+ * the caller's shader data. this is cpu-only logic and doesn't touch the graphics device */
+struct light_clusters
+{
+    uint width;
+    uint height;
+    uint tile_size;
+    uint cnt_x;
+    uint cnt_y;
+    uint slice_cnt;
+    uint cluster_cnt;
+    uint cap;   /* maximum light count per cluster */
+    float slice_scale;  /* slice = log(z)*slice_scale + slice_bias */
+    float slice_bias;
+    uint* cnts; /* light count of each cluster (count = cluster_cnt) */
+    uint16* idxs;   /* light indexes of each cluster (count = cluster_cnt*cap) */
+    uint* tile_cnts;    /* light count of each tile (all depth slices) */
+    uint tile_stride;   /* distance of tile counts (in uints) */
+};
+
+void light_clusters_init(struct light_clusters* lc, uint width, uint height, uint tile_size,
+    uint slice_cnt, uint cap, uint* cnts, uint16* idxs, uint* tile_cnts, uint tile_stride);
+
+/* sets exponential depth slices between camera near and far planes */
+void light_clusters_setdepth(struct light_clusters* lc, float fnear, float ffar);
+
+/* depth slice of view-space depth, must match calc_depth_slice in df-light shader */
+uint light_clusters_depthslice(const struct light_clusters* lc, float z);
+
+/* fills tile and slice ranges of a light from it's rect and depth range
+ * returns FALSE if light doesn't touch any cluster */
+int light_clusters_setrange(const struct light_clusters* lc, struct light_range* lr);
+
+/* bins visible ranges into the clusters of tile rows [row_start, row_end), rows can be binned
+ * in parallel. lights are visited in the same order for every cluster, so lists are deterministic
+ * returns number of cluster/light pairs that are dropped because a cluster was full */
+uint light_clusters_bin(struct light_clusters* lc, const struct light_range* ranges,
+    uint range_cnt, uint row_start, uint row_end);
+
+/* packs cluster lists into 'items' (4 floats each):
+ * [cluster_cnt] headers (x=light count, y=item offset of the first index group),
+ * followed by light indexes, 4 in each item, every cluster starts at a new item
+ * returns number of items written */
+uint light_clusters_pack(const struct light_clusters* lc, float* items);
+
+/* item count of light_clusters_pack with all clusters at full capacity */
+uint light_clusters_getmaxitems(const struct light_clusters* lc);
+
+/* brute-force reference of the binning: every cluster is tested against every light with plain
+ * rect and depth tests. returns number of clusters that don't match the binned result */
+uint light_clusters_check(const struct light_clusters* lc, const struct light_range* ranges,
+    uint range_cnt);
+
+#endif /* LIGHT_CLUSTERS_H_ */
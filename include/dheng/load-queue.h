@@ -0,0 +1,58 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef LOAD_QUEUE_H_
+#define LOAD_QUEUE_H_
+
+#include "dhcore/types.h"
+#include "dhcore/linked-list.h"
+
+#define LOAD_QUEUE_BUCKET_CNT 8
+#define LOAD_QUEUE_PRIORITY_UNIT 8.0f  /* priority range of the first bucket, each next one doubles */
+
+/* queue link, embedded in the load request that owns it */
+struct load_queue_item
+{
+    uint bucket;    /* priority bucket that the item is queued in */
+    struct linked_list lnode;
+};
+
+/* background load queue, requests are kept in FIFO lists per priority bucket, so push, pop,
+ * cancel (remove) and re-prioritize are O(1). lower priority values are loaded first
+ * this is cpu-only logic and doesn't touch the graphics device, res-mgr owns the requests */
+struct load_queue
+{
+    struct linked_list* buckets[LOAD_QUEUE_BUCKET_CNT]; /* data: owner of the item */
+    uint cnts[LOAD_QUEUE_BUCKET_CNT];
+};
+
+void load_queue_init(struct load_queue* q);
+
+/* buckets are log2 ranges of priority, so near objects are sorted finer than far ones */
+uint load_queue_bucket(float priority);
+
+/* queues item at the end (or front) of the bucket, 'owner' is returned by load_queue_pop */
+void load_queue_push(struct load_queue* q, struct load_queue_item* item, void* owner, uint bucket,
+    int front);
+
+/* removes a queued item, used for cancelling and re-prioritizing requests */
+void load_queue_remove(struct load_queue* q, struct load_queue_item* item);
+
+/* pops the oldest request with the highest priority, returns it's owner, NULL if queue is empty */
+void* load_queue_pop(struct load_queue* q);
+
+uint load_queue_getcount(const struct load_queue* q);
+
+#endif /* LOAD_QUEUE_H_ */
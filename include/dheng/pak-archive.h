@@ -0,0 +1,101 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#ifndef PAK_ARCHIVE_H_
+#define PAK_ARCHIVE_H_
+
+#include "dhcore/types.h"
+#include "dhcore/file-io.h"
+#include "dhcore/zip.h"
+
+#define PAK_ARCHIVE_SIGN 0x6b617064 /*dpak*/
+#define PAK_ARCHIVE_VERSION 1
+#define PAK_ARCHIVE_PATH_MAX 256
+
+/* how entry data is kept in the archive */
+enum pak_entry_mode
+{
+    PAK_ENTRY_STORED = 0,   /* raw bytes (already compressed formats, incompressible data) */
+    PAK_ENTRY_DEFLATE = 1   /* zip_compress */
+};
+
+#pragma pack(push, 1)
+struct _GCCPACKED_ pak_archive_header
+{
+    uint sign;
+    uint version;
+    uint compress_mode; /* enum compress_mode of deflated entries */
+    uint entry_cnt;
+    uint table_offset;  /* entries are at the end of file, sorted by alias */
+};
+
+struct _GCCPACKED_ pak_archive_entry
+{
+    char alias[PAK_ARCHIVE_PATH_MAX];
+    uint mode;  /* enum pak_entry_mode */
+    uint hash;  /* hash of uncompressed content, for incremental updates */
+    uint size;  /* uncompressed size */
+    uint stored_size;   /* size inside archive */
+    uint offset;
+};
+#pragma pack(pop)
+
+/* pak files that are written by paki, entries are compressed one by one so they can be
+ * compressed in parallel and copied between archives without recompressing
+ * this is cpu-only logic and doesn't touch the graphics device */
+struct pak_archive
+{
+    file_t f;
+    struct allocator* alloc;
+    struct pak_archive_header header;
+    struct pak_archive_entry* entries;
+    uint entry_max;  /* writing: capacity of entries */
+    int writing;
+};
+
+/* writing, entries must be put in alias order */
+result_t pak_archive_create(struct pak_archive* pak, struct allocator* alloc,
+    const char* filepath, enum compress_mode mode);
+result_t pak_archive_put(struct pak_archive* pak, const char* alias, const void* data,
+    enum pak_entry_mode mode, uint stored_size, uint size, uint hash);
+/* copies an entry of another archive as is */
+result_t pak_archive_copy(struct pak_archive* pak, struct pak_archive* src, uint idx);
+
+/* reading */
+result_t pak_archive_open(struct pak_archive* pak, struct allocator* alloc, const char* filepath);
+void pak_archive_close(struct pak_archive* pak);
+
+/* =INVALID_INDEX if not found */
+uint pak_archive_find(const struct pak_archive* pak, const char* alias);
+/* uncompressed data of the entry, =NULL if failed */
+void* pak_archive_read(struct pak_archive* pak, struct allocator* alloc, uint idx);
+
+/* compresses data for pak_archive_put, can be called from any thread
+ * returns PAK_ENTRY_DEFLATE and a buffer from 'alloc' if data gets smaller,
+ * PAK_ENTRY_STORED if data should be put as is */
+enum pak_entry_mode pak_archive_compress(struct allocator* alloc, const void* data, uint size,
+    enum compress_mode mode, OUT void** compressed, OUT uint* compressed_size);
+
+INLINE uint pak_archive_getcount(const struct pak_archive* pak)
+{
+    return pak->header.entry_cnt;
+}
+
+INLINE const struct pak_archive_entry* pak_archive_getentry(const struct pak_archive* pak,
+    uint idx)
+{
+    return &pak->entries[idx];
+}
+
+#endif /* PAK_ARCHIVE_H_ */
@@ -26,7 +26,10 @@ struct phx_prefab_data;
 typedef struct phx_prefab_data* phx_prefab;
 
 phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, uint thread_id);
+phx_prefab phx_prefab_loadmem(const char* name, const void* data, size_t size,
+    struct allocator* alloc, uint thread_id);
 void phx_prefab_unload(phx_prefab prefab);
+size_t phx_prefab_getsize(phx_prefab prefab);
 
 phx_obj phx_createinstance(phx_prefab prefab, struct xform3d* init_pose);
 
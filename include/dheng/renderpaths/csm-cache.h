@@ -0,0 +1,58 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef CSM_CACHE_H_
+#define CSM_CACHE_H_
+
+#include "dhcore/types.h"
+#include "dhcore/vec-math.h"
+#include "dhcore/prims.h"
+
+#define CSM_CACHE_CASCADES_MAX 4
+
+/* invalidation state of static (cached) shadow cascades
+ * this is cpu-only logic and doesn't touch the graphics device, so it can be driven headless */
+struct csm_cache
+{
+    struct mat4f vps[CSM_CACHE_CASCADES_MAX]; /* snapped view-proj matrices of cached layers */
+    uint sigs[CSM_CACHE_CASCADES_MAX]; /* static caster signatures of cached layers */
+    uint valid_mask; /* bit i is set if layer i holds valid static depth */
+    uint shadow_clean; /* bit i is set if shadow map layer i holds only the static depth */
+};
+
+/* invalidates all cached layers */
+void csm_cache_reset(struct csm_cache* cache);
+
+/* accumulates a static caster into cascade signature (order-independent), returns new signature
+ * id: model (and lod) that the caster is drawn with, so lod switches invalidate the cascade too */
+uint csm_cache_addcaster(uint sig, const struct aabb* bounds, uint id);
+
+/* returns bit-mask of cascades that need their static layer re-rendered
+ * vps: snapped cascade view-proj matrices, sigs: static caster signatures of each cascade */
+uint csm_cache_test(const struct csm_cache* cache, const struct mat4f* vps, const uint* sigs,
+    uint cascade_cnt);
+
+/* marks cascades in 'mask' as re-rendered with given matrices and signatures */
+void csm_cache_commit(struct csm_cache* cache, const struct mat4f* vps, const uint* sigs,
+    uint mask);
+
+/* returns bit-mask of shadow map layers that must be restored from static layers before dynamic
+ * casters are drawn: layers that have dynamic depth from last frame or re-rendered static depth */
+uint csm_cache_copymask(const struct csm_cache* cache, uint dirty, uint cascade_cnt);
+
+/* marks layers in 'copy_mask' as restored, then layers in 'dynamic_mask' as drawn over */
+void csm_cache_setshadow(struct csm_cache* cache, uint copy_mask, uint dynamic_mask);
+
+#endif /* CSM_CACHE_H_ */
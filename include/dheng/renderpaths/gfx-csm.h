@@ -23,6 +23,9 @@
 enum cmp_obj_type;
 struct gfx_rpath_result;
 struct gfx_batch_item;
+struct allocator;
+struct gfx_fgraph;
+struct gfx_rpath_data;
 
 /* callback implementations */
 uint gfx_csm_getshader(enum cmp_obj_type obj_type, uint rpath_flags);
@@ -31,11 +34,35 @@ void gfx_csm_release();
 void gfx_csm_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
         const struct gfx_view_params* params, struct gfx_batch_item* batch_items, uint batch_cnt,
         void* userdata, OUT struct gfx_rpath_result* result);
+void gfx_csm_setup(struct gfx_fgraph* fg, const struct gfx_view_params* params,
+    struct gfx_rpath_data* data);
 result_t gfx_csm_resize(uint width, uint height);
 
 /* internal use */
 void gfx_csm_prepare(const struct gfx_view_params* params, const struct vec3f* light_dir,
     const struct aabb* world_bounds);
+/* set in caster masks for casters that are drawn every frame (not cached with static casters) */
+#define GFX_CSM_CASTER_DYNAMIC (1<<7)
+
+/* static caster caching stats of the last frame */
+struct gfx_csm_cachestats
+{
+    uint static_cnt;    /* static casters (touching any cascade) */
+    uint dynamic_cnt;   /* dynamic casters (touching any cascade) */
+    uint redrawn_mask;  /* static layers that were re-rendered */
+    uint copied_mask;   /* shadow map layers that were restored from static layers */
+    uint draw_cnt;  /* drawn batch nodes, static and dynamic */
+    uint static_draw_cnt;   /* drawn batch nodes of re-rendered static layers */
+};
+
+/* returns cascade bit-mask of each caster (bit i = touches cascade i), NULL if it fails
+ * dynamics (optional): TRUE for casters that move, they get GFX_CSM_CASTER_DYNAMIC in their mask
+ * ids (optional): model and lod of each static caster, part of the cached cascade signature
+ * masks are valid until the end of the frame, must be called after gfx_csm_prepare */
+const uint* gfx_csm_cullcasters(struct allocator* alloc, const struct aabb* bounds,
+    const int* dynamics, const uint* ids, uint cnt);
+const uint* gfx_csm_get_castercnts(OUT uint* culled_cnt);
+void gfx_csm_get_cachestats(OUT struct gfx_csm_cachestats* stats);
 
 uint gfx_csm_get_cascadecnt();
 const struct aabb* gfx_csm_get_frustumbounds();
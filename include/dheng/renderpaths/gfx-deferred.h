@@ -21,6 +21,8 @@
 struct gfx_rpath_result;
 enum cmp_obj_type;
 struct gfx_batch_item;
+struct gfx_fgraph;
+struct gfx_rpath_data;
 
 enum gfx_deferred_preview_mode
 {
@@ -38,9 +40,8 @@ enum gfx_deferred_preview_mode
 uint gfx_deferred_getshader(enum cmp_obj_type obj_type, uint rpath_flags);
 result_t gfx_deferred_init(uint width, uint height);
 void gfx_deferred_release();
-void gfx_deferred_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
-        const struct gfx_view_params* params, struct gfx_batch_item* batch_items, uint batch_cnt,
-        void* userdata, OUT struct gfx_rpath_result* result);
+void gfx_deferred_setup(struct gfx_fgraph* fg, const struct gfx_view_params* params,
+    struct gfx_rpath_data* data);
 result_t gfx_deferred_resize(uint width, uint height);
 
 /* misc */
@@ -48,6 +48,46 @@ typedef struct phx_prefab_data* phx_prefab;
 struct anim_ctrl_data;
 typedef struct anim_ctrl_data* anim_ctrl;
 
+/* priority that background load requests are queued with, @see rs_set_loadpriority */
+#define RS_LOAD_PRIORITY_DEFAULT 100.0f
+
+/**
+ * Resource types, memory budgets are applied per type
+ * @see rs_set_budget
+ * @ingroup res
+ */
+enum rs_resource_type
+{
+    RS_RESOURCE_UNKNOWN = 0,
+    RS_RESOURCE_TEXTURE,
+    RS_RESOURCE_MODEL,
+    RS_RESOURCE_PHXPREFAB,
+    RS_RESOURCE_ANIMREEL,
+    RS_RESOURCE_ANIMCTRL,
+    RS_RESOURCE_SCRIPT,
+    RS_RESOURCE_TYPE_CNT
+};
+
+/* memory usage of resource types (in bytes), used by profiler */
+struct rs_budget_stats
+{
+    size_t used[RS_RESOURCE_TYPE_CNT];  /* loaded resources, referenced or cached */
+    size_t cached[RS_RESOURCE_TYPE_CNT];    /* unreferenced resources that are kept for reuse */
+    size_t budgets[RS_RESOURCE_TYPE_CNT];
+    uint evict_cnt;
+};
+
+/**
+ * Completion status of a resource bundle, @see rs_bundle_isready
+ * @ingroup res
+ */
+struct rs_bundle_status
+{
+    uint total_cnt;  /**< resources that are requested while bundle was recording */
+    uint ready_cnt; /**< resources that are loaded along with their dependencies (or failed) */
+    uint failed_cnt;    /**< ready resources that they (or their dependencies) failed to load */
+};
+
 /* init flags */
 enum rs_init_flags
 {
@@ -62,8 +102,11 @@ enum rs_init_flags
  */
 enum rs_load_flags
 {
-    RS_LOAD_REFRESH = (1<<0) /**< Reloads resource if it already exists,
+    RS_LOAD_REFRESH = (1<<0), /**< Reloads resource if it already exists,
     							  otherwise just loads the resource */
+    RS_LOAD_STREAMMIPS = (1<<1) /**< (textures) Loads smallest mips first, higher detail mips are
+                                  streamed in by the requests of rs_set_texturesize. only
+                                  applies to background loading */
 };
 
 void rs_zero();
@@ -80,6 +123,9 @@ void rs_update();
 /* unloads pointer only, resource data in res-mgr remains intact */
 void rs_unloadptr(reshandle_t hdl);
 
+void rs_get_budgetstats(struct rs_budget_stats* stats);
+const char* rs_get_typestr(enum rs_resource_type type);
+
 /* API */
 /**
  * Loads texture and returns a valid texture resource handle if successful
@@ -205,6 +251,104 @@ ENGINE_API phx_prefab rs_get_phxprefab(reshandle_t prefab_hdl);
  */
 ENGINE_API const char* rs_get_filepath(reshandle_t hdl);
 
+/**
+ * Returns interned path id of the resource file, it should be calculated once and kept by the
+ * owner (when file path is set), so it can be passed to @e rs_addref_byid for every new instance\n
+ * Debug builds report ids that collide with paths of loaded resources, loading functions always
+ * compare paths and fail on collisions
+ * @ingroup res
+ */
+ENGINE_API uint rs_get_pathid(const char* filepath);
+
+/**
+ * Adds reference to an already loaded (or loading) resource by it's interned path id, without
+ * string processing\n
+ * If resource is not in database, caller should fall back to rs_load_XXXX functions
+ * @param path_id path id, returned by @e rs_get_pathid
+ * @param type expected type of the resource, resources of other types are not referenced
+ * @return handle to resource, =INVALID_HANDLE if resource is not loaded (or has another type)
+ * @ingroup res
+ */
+ENGINE_API reshandle_t rs_addref_byid(uint path_id, enum rs_resource_type type);
+
+/**
+ * Starts recording a resource bundle, every resource that is requested by rs_load_XXXX (or
+ * rs_addref_byid) until @e rs_bundle_end is added to the bundle, so a group of loads (a level)
+ * can be waited on with a single handle. only one bundle can be recorded at a time
+ * @return bundle id, =0 if failed
+ * @ingroup res
+ */
+ENGINE_API uint rs_bundle_begin();
+
+/**
+ * Stops recording the current bundle
+ * @ingroup res
+ */
+ENGINE_API void rs_bundle_end();
+
+/**
+ * Checks if every resource of the bundle and their dependencies (textures of models) are loaded
+ * @param status (optional) receives loading progress of the bundle
+ * @return TRUE if bundle is complete (or invalid), failed loads are counted as complete
+ * @ingroup res
+ */
+ENGINE_API int rs_bundle_isready(uint bundle_id, OUT OPTIONAL struct rs_bundle_status* status);
+
+/**
+ * Destroys the bundle, recorded bundles do not hold references so resources are not unloaded\n
+ * Bundles that are loaded by @e rs_load_bundle release the references of their resources
+ * @ingroup res
+ */
+ENGINE_API void rs_bundle_destroy(uint bundle_id);
+
+/**
+ * Loads a packed bundle file (h3db) with a single read and requests all of it's resources\n
+ * Packed files are parsed from bundle memory, which is freed when they are loaded,
+ * textures of models are resolved to bundle items instead of being requested by the model\n
+ * Loading a bundle file doesn't start or end recording, it can be called between
+ * @e rs_bundle_begin and @e rs_bundle_end, its resources are recorded like other requests
+ * @return bundle id that holds a reference to each resource (@see rs_bundle_isready,
+ *         rs_bundle_destroy), =0 if failed
+ * @ingroup res
+ */
+ENGINE_API uint rs_load_bundle(const char* h3db_filepath);
+
+/**
+ * Saves a loaded bundle to a packed bundle file (h3db), that can be loaded by @e rs_load_bundle\n
+ * Every resource (and textures of models) is packed, files that can't be read are saved by path.
+ * Bundle files can also be made offline, see 'paki --bundle'
+ * Bundle must be completely loaded (@see rs_bundle_isready)
+ * @ingroup res
+ */
+ENGINE_API result_t rs_bundle_save(uint bundle_id, const char* h3db_filepath);
+
+/**
+ * Changes the priority of a queued background load request, can be called every frame\n
+ * Requests with lower values are loaded sooner, scene objects use their distance to the viewer\n
+ * Does nothing if resource is not waiting in the load queue (already loaded or loading)
+ * @param priority new priority, new requests are queued with RS_LOAD_PRIORITY_DEFAULT
+ * @ingroup res
+ */
+ENGINE_API void rs_set_loadpriority(reshandle_t hdl, float priority);
+
+/**
+ * Requests mip residency of a streamed texture (loaded with RS_LOAD_STREAMMIPS) for current frame,
+ * largest request of the frame is used to stream in higher detail mips
+ * @param screen_size projected size of the texture on screen (pixels)
+ * @ingroup res
+ */
+ENGINE_API void rs_set_texturesize(reshandle_t tex_hdl, float screen_size);
+
+/**
+ * Sets memory budget for a resource type\n
+ * Unreferenced resources are kept in memory while their type is within budget, so they can be
+ * reused without loading again, least recently used ones are evicted when budget is exceeded\n
+ * Default budget is 0, which unloads resources as soon as they are not referenced
+ * @param bytes budget size in bytes
+ * @ingroup res
+ */
+ENGINE_API void rs_set_budget(enum rs_resource_type type, size_t bytes);
+
 /* change data allocator for loading resources */
 ENGINE_API void rs_set_dataalloc(struct allocator* alloc);
 
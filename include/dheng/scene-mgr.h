@@ -61,11 +61,15 @@ struct scn_render_query
 	uint model_cnt;
     uint mat_cnt;
     uint light_cnt;
+    uint aabb_cnt;
 
 	struct mat3f* mats;	/* transform mats (referenced by 'scn_render_xxx' structures) */
 	struct sphere* bounds;	/* bounding spehres (referenced by 'scn_render_xxx' structures) */
 	struct scn_render_model* models;	/* renderable models (data is extracted from gfx_model) */
     struct scn_render_light* lights;    /* local area lights */
+    struct aabb* aabbs; /* world-space bounds (csm query only, referenced by 'bounds_idx') */
+    int* dynamics;  /* TRUE for casters that move on their own (csm query only, like 'aabbs') */
+    uint* caster_ids;   /* model and lod that casters are drawn with, 0 if not drawn (csm only) */
 	struct allocator* alloc;
 };
 
@@ -63,7 +63,9 @@ void sct_removetrigger_byfuncname(const char* funcname);
 
 void sct_throwerror(const char* fmt, ...);  /* used by wrappers */
 sct_t sct_load(const char* lua_filepath, uint thread_id);   /* used by res-mgr */
+sct_t sct_loadmem(const char* name, const void* data, size_t size, uint thread_id);
 void sct_unload(sct_t s);
+size_t sct_getsize(sct_t s);    /* memory used by script's lua_State (bytes) */
 void sct_reload(const char* filepath, reshandle_t hdl, int manual);
 void sct_getmemstats(struct sct_memstats* stats);
 void sct_setthreshold(int mem_sz);
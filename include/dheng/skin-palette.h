@@ -0,0 +1,50 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef SKIN_PALETTE_H_
+#define SKIN_PALETTE_H_
+
+#include "dhcore/types.h"
+
+/* one bone is stored as 3x4 matrix (3 float4 rows) in the palette buffer */
+#define SKIN_PALETTE_BONE_SIZE (sizeof(float)*12)
+
+struct gfx_model_posegpu;
+
+/* packing state of the per-frame skinning palette, poses of all passes are packed once and
+ * tightly (by their real bone count). this is cpu-only logic and doesn't touch the graphics
+ * device, renderer writes the matrices at offsets returned by skin_palette_addpose */
+struct skin_palette
+{
+    uint frame; /* increments every frame, see gfx_model_posegpu.palette_frame */
+    uint bone_cnt;  /* packed bones in current frame */
+    uint bone_max;  /* capacity of the palette (in bones) */
+    int overflow;   /* a pose didn't fit in current frame */
+};
+
+void skin_palette_init(struct skin_palette* pal, uint bone_max);
+
+/* starts a new frame, offsets of previous frame become invalid */
+void skin_palette_begin(struct skin_palette* pal);
+
+/* reserves pose's bones in current frame and sets pose->palette_idx (INVALID_INDEX if full)
+ * returns offset (in bones) that the caller must write pose's matrices to, or INVALID_INDEX if
+ * there is nothing to write (pose is already packed in this frame, or palette is full) */
+uint skin_palette_addpose(struct skin_palette* pal, struct gfx_model_posegpu* pose);
+
+/* bytes that has to be uploaded for current frame */
+uint skin_palette_getbytes(const struct skin_palette* pal);
+
+#endif /* SKIN_PALETTE_H_ */
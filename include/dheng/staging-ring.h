@@ -0,0 +1,72 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#ifndef STAGING_RING_H_
+#define STAGING_RING_H_
+
+#include "dhcore/types.h"
+
+#define STAGING_RING_ALIGN 256
+#define STAGING_RING_FENCE_MAX 8
+#define STAGING_RING_NONE ((uint64)-1)
+
+struct staging_ring_fence
+{
+    uptr_t sync;    /* api fence object, created by the caller */
+    uint64 end; /* ring position that is free to reuse after fence is signaled */
+};
+
+/* allocation and fence bookkeeping of the staging (upload) buffer, positions are monotonic and
+ * buffer offset = position % size. memory is reclaimed when fences that cover it are signaled
+ * this is cpu-only logic and doesn't touch the graphics device, the device creates and waits
+ * for the fence objects */
+struct staging_ring
+{
+    uint size;  /* =0 if staging is not supported */
+    uint64 head;
+    uint64 tail;
+    struct staging_ring_fence fences[STAGING_RING_FENCE_MAX];
+    uint fence_first;
+    uint fence_cnt;
+};
+
+void staging_ring_init(struct staging_ring* ring, uint size);
+
+/* returns position of the allocated memory, =STAGING_RING_NONE if it doesn't fit */
+uint64 staging_ring_alloc(struct staging_ring* ring, uint size);
+
+/* TRUE if memory up to 'end' is not covered by a fence yet */
+int staging_ring_needfence(const struct staging_ring* ring, uint64 end);
+
+/* adds a fence that covers memory up to 'end', caller fills 'sync' of the returned fence
+ * there must be a free fence slot (see staging_ring_oldestfence) */
+struct staging_ring_fence* staging_ring_pushfence(struct staging_ring* ring, uint64 end);
+
+/* oldest fence, =NULL if there are none */
+struct staging_ring_fence* staging_ring_oldestfence(struct staging_ring* ring);
+
+/* oldest fence is signaled, releases the memory that it covers */
+void staging_ring_popfence(struct staging_ring* ring);
+
+INLINE uint staging_ring_getused(const struct staging_ring* ring)
+{
+    return (uint)(ring->head - ring->tail);
+}
+
+INLINE int staging_ring_fencesfull(const struct staging_ring* ring)
+{
+    return ring->fence_cnt == STAGING_RING_FENCE_MAX;
+}
+
+#endif /* STAGING_RING_H_ */
@@ -0,0 +1,57 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#ifndef TEX_LRU_H_
+#define TEX_LRU_H_
+
+#include "dhcore/types.h"
+
+/* links of an item, embedded in items of a growable array, so they are indexes, not pointers */
+struct tex_lru_link
+{
+    uint prev;
+    uint next;
+};
+
+/* least recently viewed list of streamed textures, most recently viewed is first
+ * items are addressed by index into an array that the caller owns (and passes to each call),
+ * 'link_offset' is the offset of tex_lru_link inside each item of 'stride' bytes
+ * this is cpu-only logic and doesn't touch the graphics device */
+struct tex_lru
+{
+    uint first;
+    uint last;
+    uint cnt;
+    uint stride;
+    uint link_offset;
+};
+
+/* returns memory (bytes) that is released by demoting item 'idx', =0 if it can't be demoted */
+typedef fl64 (*pfn_tex_lru_demote)(uint idx, void* param);
+
+void tex_lru_init(struct tex_lru* lru, uint stride, uint link_offset);
+
+/* adds item to the head of the list (most recently viewed) */
+void tex_lru_add(struct tex_lru* lru, void* items, uint idx);
+void tex_lru_remove(struct tex_lru* lru, void* items, uint idx);
+
+/* moves item to the head of the list, called when texture is viewed */
+void tex_lru_touch(struct tex_lru* lru, void* items, uint idx);
+
+/* walks from the least recently viewed item and calls demote_fn, until released memory covers
+ * 'overflow' bytes. returns number of visited items */
+uint tex_lru_demote(const struct tex_lru* lru, const void* items, fl64 overflow,
+    pfn_tex_lru_demote demote_fn, void* param);
+
+#endif /* TEX_LRU_H_ */
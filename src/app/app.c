@@ -66,6 +66,7 @@ struct init_params* app_config_load(const char* cfg_jsonfile)
         if (json_getb_child(general, "no-bgload", FALSE))
             BIT_ADD(params->flags, ENG_FLAG_DISABLEBGLOAD);
         params->console_lines_max = json_geti_child(general, "console-lines", 1000);
+        params->load_threads_max = json_geti_child(general, "load-threads", 0);
     }	else	{
         params->console_lines_max = 1000;
     }
@@ -249,6 +250,14 @@ void gfx_parseparams(struct gfx_params* params, json_t j)
         params->width = json_geti_child(gfx, "width", 1280);
         params->height = json_geti_child(gfx, "height", 720);
         params->refresh_rate = json_geti_child(gfx, "refresh-rate", 60);
+        params->upload_budget = json_geti_child(gfx, "upload-budget", 0);
+        params->upload_objs_max = json_geti_child(gfx, "upload-objects", 0);
+        params->light_slices = json_geti_child(gfx, "light-slices", 0);
+        params->cluster_lights_max = json_geti_child(gfx, "cluster-lights", 0);
+        params->csm_cascades = json_geti_child(gfx, "csm-cascades", 0);
+        params->csm_size = json_geti_child(gfx, "csm-size", 0);
+        params->csm_far = json_getf_child(gfx, "csm-far", 0.0f);
+        params->csm_lambda = json_getf_child(gfx, "csm-lambda", 0.0f);
     }   else    {
         params->width = 1280;
         params->height = 720;
@@ -0,0 +1,1443 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+
+#include "dhcore/core.h"
+#include "dhcore/str.h"
+#include "dhcore/file-io.h"
+#include "dhcore/json.h"
+#include "dhcore/hash-table.h"
+#include "dhcore/stack-alloc.h"
+#include "dhcore/task-mgr.h"
+#include "dhcore/hash.h"
+
+#include "anim-ctrl.h"
+#include "h3d-types.h"
+#include "mem-ids.h"
+
+/*************************************************************************************************
+ * fwd declarations
+ */
+
+/* loading */
+static anim_ctrl anim_ctrl_loadfile(struct allocator* alloc, file_t f, const char* name,
+                                    struct allocator* tmp_alloc);
+static anim_ctrl anim_ctrl_loadjson(struct allocator* alloc, file_t f, const char* janim_filepath,
+                                    struct allocator* tmp_alloc);
+static anim_ctrl anim_ctrl_loadbin(struct allocator* alloc, file_t f, const char* h3dc_filepath,
+                                   struct allocator* tmp_alloc);
+static void anim_ctrl_relocate(uint8* mem, uptr_t from, uptr_t to);
+static int anim_ctrl_checkbin(const uint8* data, uint data_size);
+static void anim_ctrl_terminatenames(anim_ctrl ctrl);
+static int anim_ctrl_checkindices(const struct anim_ctrl_data* ctrl);
+static void anim_ctrl_load_params(anim_ctrl ctrl, json_t jparams, struct allocator* alloc);
+static void anim_ctrl_load_clips(anim_ctrl ctrl, json_t jclips, struct allocator* alloc);
+static void anim_ctrl_load_states(anim_ctrl ctrl, json_t jstates, struct allocator* alloc);
+static void anim_ctrl_load_layers(anim_ctrl ctrl, json_t jlayers, struct allocator* alloc);
+static void anim_ctrl_load_blendtrees(anim_ctrl ctrl, json_t jblendtrees, struct allocator* alloc);
+static void anim_ctrl_load_transitions(anim_ctrl ctrl, json_t jtransitions, struct allocator* alloc);
+static void anim_ctrl_parse_group(struct allocator* alloc, struct anim_ctrl_transition_group* grp,
+                           json_t jgrp);
+static uint anim_ctrl_getcount(json_t jparent, const char* name);
+static uint anim_ctrl_getcount_2nd(json_t jparent, const char* name0, const char* name1);
+static uint anim_ctrl_getcount_3rd(json_t jparent, const char* name0, const char* name1,
+                              const char* name2);
+
+/* state machine */
+static int anim_ctrl_checkstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                                uint state_idx, float tm);
+static int anim_ctrl_checktransition(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                                     uint transition_idx, float tm);
+static int anim_ctrl_checktgroup(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
+                                 uint layer_idx, const struct anim_ctrl_transition_group* tgroup,
+                                 float tm);
+static void anim_ctrl_starttransition(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                                      uint transition_idx, float tm);
+static float anim_ctrl_progress_state(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx);
+static void anim_ctrl_startstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
+                                 float start_tm);
+static void anim_ctrl_startseq(const anim_ctrl ctrl, anim_ctrl_inst inst,
+                               const struct anim_ctrl_sequence* seq, float start_tm);
+static void anim_ctrl_startclip(const anim_ctrl ctrl, anim_ctrl_inst inst, uint clip_idx,
+                                float start_tm);
+static void anim_ctrl_startblendtree(const anim_ctrl ctrl, anim_ctrl_inst inst,
+                                     uint blendtree_idx, float start_tm);
+
+/*************************************************************************************************
+ * inlines
+ */
+/* relocates pointer from 'from' base address to 'to' base address, NULL pointers stay NULL */
+INLINE void* anim_ctrl_reloc(void* ptr, uptr_t from, uptr_t to)
+{
+    return ptr != NULL ? (void*)((uptr_t)ptr - from + to) : NULL;
+}
+
+/* checks if an array of precompiled block (offset, not relocated yet) fits inside the block */
+INLINE int anim_ctrl_checkrange(const void* offset, uint cnt, size_t item_sz, uint data_size)
+{
+    if (cnt == 0)
+        return TRUE;
+    uint64 start = (uint64)(uptr_t)offset;
+    return start >= sizeof(struct anim_ctrl_data) &&
+        start + (uint64)cnt*(uint64)item_sz <= (uint64)data_size;
+}
+
+/* checks if sequence points to an existing clip or blendtree, unknown sequences are never played */
+INLINE int anim_ctrl_checkseq(const struct anim_ctrl_data* ctrl, const struct anim_ctrl_sequence* seq)
+{
+    switch (seq->type)  {
+    case ANIM_CTRL_SEQUENCE_CLIP:
+        return seq->idx < ctrl->clip_cnt;
+    case ANIM_CTRL_SEQUENCE_BLENDTREE:
+        return seq->idx < ctrl->blendtree_cnt;
+    default:
+        return TRUE;
+    }
+}
+
+INLINE enum anim_ctrl_sequencetype anim_ctrl_parse_seqtype(json_t jseq)
+{
+    char seq_type_s[32];
+    strcpy(seq_type_s, json_gets_child(jseq, "type", ""));
+    if (str_isequal(seq_type_s, "clip"))
+        return ANIM_CTRL_SEQUENCE_CLIP;
+    else if (str_isequal(seq_type_s, "blendtree"))
+        return ANIM_CTRL_SEQUENCE_BLENDTREE;
+    else
+        return ANIM_CTRL_SEQUENCE_UNKNOWN;
+}
+
+INLINE enum anim_ctrl_layertype anim_ctrl_parse_layertype(json_t jtype)
+{
+    const char* layer_type_s = json_gets_child(jtype, "layer", "");
+    if (str_isequal(layer_type_s, "override"))
+        return ANIM_CTRL_LAYER_OVERRIDE;
+    else if (str_isequal(layer_type_s, "additive"))
+        return ANIM_CTRL_LAYER_ADDITIVE;
+    else
+        return ANIM_CTRL_LAYER_OVERRIDE;
+}
+
+INLINE enum anim_ctrl_tgrouptype anim_ctrl_parse_grptype(json_t jgrp)
+{
+    char type_s[32];
+    strcpy(type_s, json_gets_child(jgrp, "type", ""));
+
+    if (str_isequal(type_s, "exit"))
+        return ANIM_CTRL_TGROUP_EXIT;
+    else if (str_isequal(type_s, "param"))
+        return ANIM_CTRL_TGROUP_PARAM;
+    else
+        return ANIM_CTRL_TGROUP_EXIT;
+}
+
+INLINE enum anim_predicate anim_ctrl_parse_grppred(json_t jgrp)
+{
+    char pred_s[32];
+    strcpy(pred_s, json_gets_child(jgrp, "predicate", ""));
+
+    if (str_isequal(pred_s, "=="))
+        return ANIM_PREDICATE_EQUAL;
+    else if (str_isequal(pred_s, "!="))
+        return ANIM_PREDICATE_NOT;
+    else if (str_isequal(pred_s, ">"))
+        return ANIM_PREDICATE_GREATER;
+    else if (str_isequal(pred_s, "<"))
+        return ANIM_PREDICATE_LESS;
+    else
+        return ANIM_PREDICATE_UNKNOWN;
+}
+
+INLINE int anim_ctrl_testpredicate_f(enum anim_predicate pred, float value1, float value2)
+{
+    switch (pred)   {
+    case ANIM_PREDICATE_EQUAL:
+        return math_isequal(value1, value2);
+    case ANIM_PREDICATE_GREATER:
+        return value1 > (value2 + EPSILON);
+    case ANIM_PREDICATE_LESS:
+        return value1 < (value2 - EPSILON);
+    case ANIM_PREDICATE_NOT:
+        return !math_isequal(value1, value2);
+    default:
+        return FALSE;
+    }
+}
+
+INLINE int anim_ctrl_testpredicate_n(enum anim_predicate pred, int value1, int value2)
+{
+    switch (pred)   {
+    case ANIM_PREDICATE_EQUAL:
+        return value1 == value2;
+    case ANIM_PREDICATE_GREATER:
+        return value1 > value2;
+    case ANIM_PREDICATE_LESS:
+        return value1 < value2 - EPSILON;
+    case ANIM_PREDICATE_NOT:
+        return value1 != value2;
+    default:
+        return FALSE;
+    }
+}
+
+INLINE int anim_ctrl_testpredicate_b(int value1, int value2)
+{
+    return value1 == value2;
+}
+
+/*************************************************************************************************/
+uint anim_ctrl_getcount(json_t jparent, const char* name)
+{
+    json_t j = json_getitem(jparent, name);
+    if (j != NULL)
+        return json_getarr_count(j);
+    else
+        return 0;
+}
+
+uint anim_ctrl_getcount_2nd(json_t jparent, const char* name0, const char* name1)
+{
+    json_t j = json_getitem(jparent, name0);
+    if (j != NULL)  {
+        uint cnt = 0;
+        uint l1_cnt = json_getarr_count(j);
+        for (uint i = 0; i < l1_cnt; i++)    {
+            json_t j2 = json_getitem(json_getarr_item(j, i), name1);
+            cnt += (j2 != NULL) ? json_getarr_count(j2) : 0;
+        }
+        return cnt;
+    }   else    {
+        return 0;
+    }
+}
+
+uint anim_ctrl_getcount_3rd(json_t jparent, const char* name0, const char* name1,
+                              const char* name2)
+{
+    json_t j = json_getitem(jparent, name0);
+    if (j != NULL)  {
+        uint cnt = 0;
+        uint l1_cnt = json_getarr_count(j);
+        for (uint i = 0; i < l1_cnt; i++)    {
+            json_t j2 = json_getitem(json_getarr_item(j, i), name1);
+
+            if (j2 != NULL) {
+                uint l2_cnt = json_getarr_count(j2);
+                for (uint k = 0; k < l2_cnt; k++) {
+                    json_t j3 = json_getitem(json_getarr_item(j2, k), name2);
+                    cnt += (j3 != NULL) ? json_getarr_count(j3) : 0;
+                }
+            }
+        }
+        return cnt;
+    }   else    {
+        return 0;
+    }
+}
+
+anim_ctrl anim_ctrl_load(struct allocator* alloc, const char* janim_filepath, uint thread_id)
+{
+    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+    A_SAVE(tmp_alloc);
+
+    file_t f = fio_openmem(tmp_alloc, janim_filepath, FALSE, MID_ANIM);
+    if (f == NULL) {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Could not open file '%s'",
+            janim_filepath);
+        A_LOAD(tmp_alloc);
+        return NULL;
+    }
+
+    anim_ctrl ctrl = anim_ctrl_loadfile(alloc, f, janim_filepath, tmp_alloc);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return ctrl;
+}
+
+/* 'data' is not copied or freed, 'name' extension selects json or h3dc like anim_ctrl_load */
+anim_ctrl anim_ctrl_loadmem(struct allocator* alloc, const char* name, const void* data,
+                            size_t size, uint thread_id)
+{
+    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+    A_SAVE(tmp_alloc);
+
+    file_t f = fio_attachmem(tmp_alloc, (void*)data, size, name, MID_ANIM);
+    if (f == NULL) {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Could not open file '%s'", name);
+        A_LOAD(tmp_alloc);
+        return NULL;
+    }
+
+    anim_ctrl ctrl = anim_ctrl_loadfile(alloc, f, name, tmp_alloc);
+    fio_detachmem(f, &size, NULL);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return ctrl;
+}
+
+anim_ctrl anim_ctrl_loadfile(struct allocator* alloc, file_t f, const char* name,
+                             struct allocator* tmp_alloc)
+{
+    /* json files are source (authoring) format, anything else is treated as precompiled h3dc */
+    char ext[DH_PATH_MAX];
+    path_getfileext(ext, name);
+    if (str_isequal_nocase(ext, "json"))
+        return anim_ctrl_loadjson(alloc, f, name, tmp_alloc);
+    else
+        return anim_ctrl_loadbin(alloc, f, name, tmp_alloc);
+}
+
+anim_ctrl anim_ctrl_loadjson(struct allocator* alloc, file_t f, const char* janim_filepath,
+                             struct allocator* tmp_alloc)
+{
+    /* load JSON ctrl file */
+    json_t jroot = json_parsefilef(f, tmp_alloc);
+    if (jroot == NULL)  {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Invalid json '%s'",
+            janim_filepath);
+        return NULL;
+    }
+
+    /* calculate total size and create memory stack */
+    struct stack_alloc stack_mem;
+    struct allocator stack_alloc;
+
+    uint total_tgroups = anim_ctrl_getcount_2nd(jroot, "transitions", "groups");
+    uint total_tgroupitems = anim_ctrl_getcount_3rd(jroot, "transitions", "groups", "conditions");
+    uint total_seqs = anim_ctrl_getcount_2nd(jroot, "blendtrees", "childs");
+    uint total_idxs = anim_ctrl_getcount_2nd(jroot, "states", "transitions") +
+        anim_ctrl_getcount_2nd(jroot, "layers", "states");
+    uint total_bonemasks = anim_ctrl_getcount_2nd(jroot, "layers", "bone-mask");
+    uint param_cnt = anim_ctrl_getcount(jroot, "params");
+    size_t total_sz =
+        sizeof(struct anim_ctrl_data) +
+        hashtable_fixed_estimate_size(param_cnt) +
+        param_cnt*sizeof(struct anim_ctrl_param) +
+        anim_ctrl_getcount(jroot, "clips")*sizeof(struct anim_ctrl_clip) +
+        anim_ctrl_getcount(jroot, "transitions")*sizeof(struct anim_ctrl_transition) +
+        anim_ctrl_getcount(jroot, "blendtrees")*sizeof(struct anim_ctrl_blendtree) +
+        anim_ctrl_getcount(jroot, "layers")*sizeof(struct anim_ctrl_layer) +
+        anim_ctrl_getcount(jroot, "states")*sizeof(struct anim_ctrl_state) +
+        total_tgroups*sizeof(struct anim_ctrl_transition_group) +
+        total_tgroupitems*sizeof(struct anim_ctrl_transition_groupitem) +
+        total_seqs*sizeof(struct anim_ctrl_sequence) +
+        total_idxs*sizeof(uint) +
+        total_bonemasks*32;
+    if (IS_FAIL(mem_stack_create(alloc, &stack_mem, total_sz, MID_GFX)))    {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        json_destroy(jroot);
+        return NULL;
+    }
+    mem_stack_bindalloc(&stack_mem, &stack_alloc);
+
+    /* create ctrl structure and zero memory */
+    anim_ctrl ctrl = (struct anim_ctrl_data*)A_ALLOC(&stack_alloc, sizeof(struct anim_ctrl_data),
+        MID_ANIM);
+    ASSERT(ctrl);
+    memset(ctrl, 0x00, sizeof(struct anim_ctrl_data));
+    ctrl->alloc = alloc;
+    ctrl->data_size = (uint)total_sz;
+
+    /* animation reel resource */
+    const char* reel_filepath = json_gets_child(jroot, "reel", "");
+    if (reel_filepath[0] == 0)  {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: empty reel file");
+        anim_ctrl_unload(ctrl);
+        json_destroy(jroot);
+        return NULL;
+    }
+    str_safecpy(ctrl->reel_filepath, sizeof(ctrl->reel_filepath), reel_filepath);
+
+    /* */
+    anim_ctrl_load_params(ctrl, json_getitem(jroot, "params"), &stack_alloc);
+    anim_ctrl_load_clips(ctrl, json_getitem(jroot, "clips"), &stack_alloc);
+    anim_ctrl_load_transitions(ctrl, json_getitem(jroot, "transitions"), &stack_alloc);
+    anim_ctrl_load_blendtrees(ctrl, json_getitem(jroot, "blendtrees"), &stack_alloc);
+    anim_ctrl_load_states(ctrl, json_getitem(jroot, "states"), &stack_alloc);
+    anim_ctrl_load_layers(ctrl, json_getitem(jroot, "layers"), &stack_alloc);
+
+    json_destroy(jroot);
+
+    if (!anim_ctrl_checkindices(ctrl))  {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: invalid index in '%s'",
+            janim_filepath);
+        anim_ctrl_unload(ctrl);
+        return NULL;
+    }
+
+    return ctrl;
+}
+
+anim_ctrl anim_ctrl_loadbin(struct allocator* alloc, file_t f, const char* h3dc_filepath,
+                            struct allocator* tmp_alloc)
+{
+    /* check header */
+    struct h3d_header header;
+    if (fio_read(f, &header, sizeof(header), 1) != 1 ||
+        header.sign != H3D_SIGN || header.type != H3D_ANIMCTRL)
+    {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: invalid file format '%s'",
+            h3dc_filepath);
+        return NULL;
+    }
+    if (header.version != H3D_VERSION_13)   {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: invalid file version '%s'",
+            h3dc_filepath);
+        return NULL;
+    }
+
+    struct h3d_animctrl h3dctrl;
+    fio_seek(f, SEEK_MODE_START, header.data_offset);
+    if (fio_read(f, &h3dctrl, sizeof(h3dctrl), 1) != 1 ||
+        h3dctrl.ptr_size != sizeof(void*) || h3dctrl.data_size < sizeof(struct anim_ctrl_data))
+    {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: incompatible data '%s'",
+            h3dc_filepath);
+        return NULL;
+    }
+
+    /* data block and param table are allocated in one stack, like json loader */
+    struct stack_alloc stack_mem;
+    struct allocator stack_alloc;
+    size_t total_sz = h3dctrl.data_size + hashtable_fixed_estimate_size(h3dctrl.param_cnt);
+    if (IS_FAIL(mem_stack_create(alloc, &stack_mem, total_sz, MID_GFX)))    {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        return NULL;
+    }
+    mem_stack_bindalloc(&stack_mem, &stack_alloc);
+
+    /* read the whole block and fix pointers (offsets) */
+    uint8* data = (uint8*)A_ALLOC(&stack_alloc, h3dctrl.data_size, MID_ANIM);
+    ASSERT(data);
+    size_t read_cnt = fio_read(f, data, h3dctrl.data_size, 1);
+
+    /* truncated or corrupt files would turn into wild pointers after relocation */
+    if (read_cnt != 1 || !anim_ctrl_checkbin(data, h3dctrl.data_size) ||
+        ((anim_ctrl)data)->param_cnt != h3dctrl.param_cnt)
+    {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: corrupt data '%s'",
+            h3dc_filepath);
+        mem_stack_destroy(&stack_mem);
+        return NULL;
+    }
+
+    anim_ctrl_relocate(data, 0, (uptr_t)data);
+
+    anim_ctrl ctrl = (anim_ctrl)data;
+    ctrl->alloc = alloc;
+    ctrl->data_size = h3dctrl.data_size;
+    anim_ctrl_terminatenames(ctrl);
+
+    /* arrays are inside the block now, but stored indexes can still point anywhere */
+    if (!anim_ctrl_checkindices(ctrl))  {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: corrupt data '%s'",
+            h3dc_filepath);
+        mem_stack_destroy(&stack_mem);
+        return NULL;
+    }
+
+    /* param names are already hashed */
+    memset(&ctrl->param_tbl, 0x00, sizeof(ctrl->param_tbl));
+    if (ctrl->param_cnt > 0)    {
+        hashtable_fixed_create(&stack_alloc, &ctrl->param_tbl, ctrl->param_cnt, MID_ANIM);
+        for (uint i = 0; i < ctrl->param_cnt; i++)
+            hashtable_fixed_add(&ctrl->param_tbl, ctrl->params[i].name_hash, i);
+    }
+
+    return ctrl;
+}
+
+void anim_ctrl_relocate(uint8* mem, uptr_t from, uptr_t to)
+{
+    anim_ctrl ctrl = (anim_ctrl)mem;
+    uptr_t base = (uptr_t)mem;
+
+    /* child arrays are always accessed through 'mem', because the pointers inside the block may
+     * already be offsets */
+    struct anim_ctrl_transition* transitions = (struct anim_ctrl_transition*)
+        anim_ctrl_reloc(ctrl->transitions, from, base);
+    for (uint i = 0; i < ctrl->transition_cnt; i++)   {
+        struct anim_ctrl_transition* trans = &transitions[i];
+        struct anim_ctrl_transition_group* groups = (struct anim_ctrl_transition_group*)
+            anim_ctrl_reloc(trans->groups, from, base);
+        for (uint k = 0; k < trans->group_cnt; k++) {
+            groups[k].items = (struct anim_ctrl_transition_groupitem*)
+                anim_ctrl_reloc(groups[k].items, from, to);
+        }
+        trans->groups = (struct anim_ctrl_transition_group*)anim_ctrl_reloc(trans->groups, from, to);
+    }
+
+    struct anim_ctrl_blendtree* blendtrees = (struct anim_ctrl_blendtree*)
+        anim_ctrl_reloc(ctrl->blendtrees, from, base);
+    for (uint i = 0; i < ctrl->blendtree_cnt; i++)    {
+        blendtrees[i].child_seqs = (struct anim_ctrl_sequence*)
+            anim_ctrl_reloc(blendtrees[i].child_seqs, from, to);
+    }
+
+    struct anim_ctrl_state* states = (struct anim_ctrl_state*)
+        anim_ctrl_reloc(ctrl->states, from, base);
+    for (uint i = 0; i < ctrl->state_cnt; i++)
+        states[i].transitions = (uint*)anim_ctrl_reloc(states[i].transitions, from, to);
+
+    struct anim_ctrl_layer* layers = (struct anim_ctrl_layer*)
+        anim_ctrl_reloc(ctrl->layers, from, base);
+    for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+        layers[i].states = (uint*)anim_ctrl_reloc(layers[i].states, from, to);
+        layers[i].bone_mask = (char*)anim_ctrl_reloc(layers[i].bone_mask, from, to);
+    }
+
+    ctrl->transitions = (struct anim_ctrl_transition*)anim_ctrl_reloc(ctrl->transitions, from, to);
+    ctrl->clips = (struct anim_ctrl_clip*)anim_ctrl_reloc(ctrl->clips, from, to);
+    ctrl->blendtrees = (struct anim_ctrl_blendtree*)anim_ctrl_reloc(ctrl->blendtrees, from, to);
+    ctrl->states = (struct anim_ctrl_state*)anim_ctrl_reloc(ctrl->states, from, to);
+    ctrl->params = (struct anim_ctrl_param*)anim_ctrl_reloc(ctrl->params, from, to);
+    ctrl->layers = (struct anim_ctrl_layer*)anim_ctrl_reloc(ctrl->layers, from, to);
+}
+
+/* validates all arrays of a precompiled block before relocation, data is still in offsets */
+int anim_ctrl_checkbin(const uint8* data, uint data_size)
+{
+    const struct anim_ctrl_data* ctrl = (const struct anim_ctrl_data*)data;
+
+    if (!anim_ctrl_checkrange(ctrl->transitions, ctrl->transition_cnt,
+            sizeof(struct anim_ctrl_transition), data_size) ||
+        !anim_ctrl_checkrange(ctrl->clips, ctrl->clip_cnt, sizeof(struct anim_ctrl_clip),
+            data_size) ||
+        !anim_ctrl_checkrange(ctrl->blendtrees, ctrl->blendtree_cnt,
+            sizeof(struct anim_ctrl_blendtree), data_size) ||
+        !anim_ctrl_checkrange(ctrl->states, ctrl->state_cnt, sizeof(struct anim_ctrl_state),
+            data_size) ||
+        !anim_ctrl_checkrange(ctrl->params, ctrl->param_cnt, sizeof(struct anim_ctrl_param),
+            data_size) ||
+        !anim_ctrl_checkrange(ctrl->layers, ctrl->layer_cnt, sizeof(struct anim_ctrl_layer),
+            data_size))
+    {
+        return FALSE;
+    }
+
+    /* child arrays, parents are checked above so they can be accessed through offsets */
+    const struct anim_ctrl_transition* transitions = (const struct anim_ctrl_transition*)
+        (data + (uptr_t)ctrl->transitions);
+    for (uint i = 0; i < ctrl->transition_cnt; i++)   {
+        const struct anim_ctrl_transition* trans = &transitions[i];
+        if (!anim_ctrl_checkrange(trans->groups, trans->group_cnt,
+            sizeof(struct anim_ctrl_transition_group), data_size))
+        {
+            return FALSE;
+        }
+
+        const struct anim_ctrl_transition_group* groups =
+            (const struct anim_ctrl_transition_group*)(data + (uptr_t)trans->groups);
+        for (uint k = 0; k < trans->group_cnt; k++) {
+            if (!anim_ctrl_checkrange(groups[k].items, groups[k].item_cnt,
+                sizeof(struct anim_ctrl_transition_groupitem), data_size))
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    const struct anim_ctrl_blendtree* blendtrees = (const struct anim_ctrl_blendtree*)
+        (data + (uptr_t)ctrl->blendtrees);
+    for (uint i = 0; i < ctrl->blendtree_cnt; i++)    {
+        if (!anim_ctrl_checkrange(blendtrees[i].child_seqs, blendtrees[i].child_seq_cnt,
+            sizeof(struct anim_ctrl_sequence), data_size))
+        {
+            return FALSE;
+        }
+    }
+
+    const struct anim_ctrl_state* states = (const struct anim_ctrl_state*)
+        (data + (uptr_t)ctrl->states);
+    for (uint i = 0; i < ctrl->state_cnt; i++)    {
+        if (!anim_ctrl_checkrange(states[i].transitions, states[i].transition_cnt, sizeof(uint),
+            data_size))
+        {
+            return FALSE;
+        }
+    }
+
+    const struct anim_ctrl_layer* layers = (const struct anim_ctrl_layer*)
+        (data + (uptr_t)ctrl->layers);
+    for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+        if (!anim_ctrl_checkrange(layers[i].states, layers[i].state_cnt, sizeof(uint),
+                data_size) ||
+            !anim_ctrl_checkrange(layers[i].bone_mask, layers[i].bone_mask_cnt, 32, data_size))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* validates every stored index against the arrays it points to, so update code can use them
+ * without checking */
+int anim_ctrl_checkindices(const struct anim_ctrl_data* ctrl)
+{
+    for (uint i = 0; i < ctrl->transition_cnt; i++)   {
+        const struct anim_ctrl_transition* trans = &ctrl->transitions[i];
+        if (trans->owner_state_idx >= ctrl->state_cnt ||
+            trans->target_state_idx >= ctrl->state_cnt)
+        {
+            return FALSE;
+        }
+
+        for (uint k = 0; k < trans->group_cnt; k++) {
+            const struct anim_ctrl_transition_group* grp = &trans->groups[k];
+            for (uint j = 0; j < grp->item_cnt; j++)  {
+                if (grp->items[j].type == ANIM_CTRL_TGROUP_PARAM &&
+                    grp->items[j].param_idx >= ctrl->param_cnt)
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    for (uint i = 0; i < ctrl->blendtree_cnt; i++)    {
+        const struct anim_ctrl_blendtree* bt = &ctrl->blendtrees[i];
+        if (bt->child_seq_cnt == 0 || bt->param_idx >= ctrl->param_cnt)
+            return FALSE;
+        for (uint k = 0; k < bt->child_seq_cnt; k++)  {
+            const struct anim_ctrl_sequence* seq = &bt->child_seqs[k];
+            if (!anim_ctrl_checkseq(ctrl, seq) ||
+                (seq->type == ANIM_CTRL_SEQUENCE_BLENDTREE && seq->idx == i))
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    for (uint i = 0; i < ctrl->state_cnt; i++)    {
+        const struct anim_ctrl_state* state = &ctrl->states[i];
+        if (!anim_ctrl_checkseq(ctrl, &state->seq))
+            return FALSE;
+        for (uint k = 0; k < state->transition_cnt; k++)  {
+            if (state->transitions[k] >= ctrl->transition_cnt)
+                return FALSE;
+        }
+    }
+
+    for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+        const struct anim_ctrl_layer* layer = &ctrl->layers[i];
+        if (layer->default_state_idx >= ctrl->state_cnt)
+            return FALSE;
+        for (uint k = 0; k < layer->state_cnt; k++)   {
+            if (layer->states[k] >= ctrl->state_cnt)
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* names are fixed size arrays inside the block, make sure they are terminated */
+void anim_ctrl_terminatenames(anim_ctrl ctrl)
+{
+    ctrl->reel_filepath[sizeof(ctrl->reel_filepath) - 1] = 0;
+    for (uint i = 0; i < ctrl->clip_cnt; i++)
+        ctrl->clips[i].name[sizeof(ctrl->clips[i].name) - 1] = 0;
+    for (uint i = 0; i < ctrl->blendtree_cnt; i++)
+        ctrl->blendtrees[i].name[sizeof(ctrl->blendtrees[i].name) - 1] = 0;
+    for (uint i = 0; i < ctrl->state_cnt; i++)
+        ctrl->states[i].name[sizeof(ctrl->states[i].name) - 1] = 0;
+    for (uint i = 0; i < ctrl->param_cnt; i++)
+        ctrl->params[i].name[sizeof(ctrl->params[i].name) - 1] = 0;
+    for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+        struct anim_ctrl_layer* layer = &ctrl->layers[i];
+        layer->name[sizeof(layer->name) - 1] = 0;
+        for (uint k = 0; k < layer->bone_mask_cnt; k++)
+            layer->bone_mask[32*k + 31] = 0;
+    }
+}
+
+result_t anim_ctrl_savebin(anim_ctrl ctrl, const char* h3dc_filepath)
+{
+    /* make a copy of the data block and convert it's pointers to offsets */
+    uint8* data = (uint8*)ALLOC(ctrl->data_size, MID_ANIM);
+    if (data == NULL)
+        return RET_OUTOFMEMORY;
+    memcpy(data, ctrl, ctrl->data_size);
+
+    anim_ctrl_relocate(data, (uptr_t)ctrl, 0);
+
+    anim_ctrl dctrl = (anim_ctrl)data;
+    dctrl->alloc = NULL;
+    memset(&dctrl->param_tbl, 0x00, sizeof(dctrl->param_tbl));
+
+    file_t f = fio_createdisk(h3dc_filepath);
+    if (f == NULL)  {
+        FREE(data);
+        err_printf(__FILE__, __LINE__, "Saving ctrl-anim failed: Could not create file '%s'",
+            h3dc_filepath);
+        return RET_FILE_ERROR;
+    }
+
+    struct h3d_header header;
+    header.sign = H3D_SIGN;
+    header.type = H3D_ANIMCTRL;
+    header.version = H3D_VERSION_13;
+    header.data_offset = sizeof(struct h3d_header);
+
+    struct h3d_animctrl h3dctrl;
+    h3dctrl.data_size = ctrl->data_size;
+    h3dctrl.ptr_size = sizeof(void*);
+    h3dctrl.param_cnt = ctrl->param_cnt;
+
+    fio_write(f, &header, sizeof(header), 1);
+    fio_write(f, &h3dctrl, sizeof(h3dctrl), 1);
+    fio_write(f, data, ctrl->data_size, 1);
+    fio_close(f);
+
+    FREE(data);
+    return RET_OK;
+}
+
+result_t anim_ctrl_compile(const char* janim_filepath, const char* h3dc_filepath)
+{
+    file_t f = fio_openmem(mem_heap(), janim_filepath, FALSE, MID_ANIM);
+    if (f == NULL) {
+        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Could not open file '%s'",
+            janim_filepath);
+        return RET_FAIL;
+    }
+
+    anim_ctrl ctrl = anim_ctrl_loadjson(mem_heap(), f, janim_filepath, mem_heap());
+    fio_close(f);
+    if (ctrl == NULL)
+        return RET_FAIL;
+
+    result_t r = anim_ctrl_savebin(ctrl, h3dc_filepath);
+    anim_ctrl_unload(ctrl);
+    return r;
+}
+
+void anim_ctrl_load_params(anim_ctrl ctrl, json_t jparams, struct allocator* alloc)
+{
+    if (jparams == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jparams);
+    if (cnt == 0)
+        return;
+    ctrl->params = (struct anim_ctrl_param*)A_ALLOC(alloc, sizeof(struct anim_ctrl_param)*cnt,
+        MID_ANIM);
+    ASSERT(ctrl->params);
+
+    hashtable_fixed_create(alloc, &ctrl->param_tbl, cnt, MID_ANIM);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jparam = json_getarr_item(jparams, i);
+        struct anim_ctrl_param* param = &ctrl->params[i];
+
+        strcpy(param->name, json_gets_child(jparam, "name", ""));
+        param->name_hash = hash_str(param->name);
+        hashtable_fixed_add(&ctrl->param_tbl, param->name_hash, i);
+
+        char type[32];
+        strcpy(type, json_gets_child(jparam, "type", "float"));
+        if (str_isequal_nocase(type, "float")) {
+            param->type = ANIM_CTRL_PARAM_FLOAT;
+            param->value.f = json_getf_child(jparam, "value", 0.0f);
+        }   else if (str_isequal_nocase(type, "int"))  {
+            param->type = ANIM_CTRL_PARAM_INT;
+            param->value.i = json_geti_child(jparam, "value", 0);
+        }   else if (str_isequal_nocase(type, "bool")) {
+            param->type = ANIM_CTRL_PARAM_BOOLEAN;
+            param->value.b = json_getb_child(jparam, "value", FALSE);
+        }   else    {
+            param->type = ANIM_CTRL_PARAM_FLOAT;
+            param->value.f = 0.0f;
+        }
+    }
+
+    ctrl->param_cnt = cnt;
+}
+
+void anim_ctrl_load_clips(anim_ctrl ctrl, json_t jclips, struct allocator* alloc)
+{
+    if (jclips == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jclips);
+    if (cnt == 0)
+        return;
+
+    ctrl->clips = (struct anim_ctrl_clip*)A_ALLOC(alloc, sizeof(struct anim_ctrl_clip)*cnt,
+        MID_ANIM);
+    ASSERT(ctrl->clips);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jclip = json_getarr_item(jclips, i);
+        struct anim_ctrl_clip* clip = &ctrl->clips[i];
+        strcpy(clip->name, json_gets_child(jclip, "name", ""));
+        clip->name_hash = hash_str(clip->name);
+    }
+
+    ctrl->clip_cnt = cnt;
+}
+
+void anim_ctrl_load_transitions(anim_ctrl ctrl, json_t jtransitions, struct allocator* alloc)
+{
+    if (jtransitions == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jtransitions);
+    if (cnt == 0)
+        return;
+
+    ctrl->transitions = (struct anim_ctrl_transition*)
+        A_ALLOC(alloc, sizeof(struct anim_ctrl_transition)*cnt, MID_ANIM);
+    ASSERT(ctrl->transitions);
+    memset(ctrl->transitions, 0x00, sizeof(struct anim_ctrl_transition)*cnt);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jtrans = json_getarr_item(jtransitions, i);
+        struct anim_ctrl_transition* trans = &ctrl->transitions[i];
+
+        trans->duration = json_getf_child(jtrans, "duration", 0.0f);
+        trans->owner_state_idx = json_geti_child(jtrans, "owner", INVALID_INDEX);
+        trans->target_state_idx = json_geti_child(jtrans, "target", INVALID_INDEX);
+
+        /* groups */
+        json_t jgroups = json_getitem(jtrans, "groups");
+        if (jgroups != NULL)    {
+            uint group_cnt = json_getarr_count(jgroups);
+            if (group_cnt > 0)  {
+                trans->groups = (struct anim_ctrl_transition_group*)A_ALLOC(alloc,
+                    sizeof(struct anim_ctrl_transition_group)*group_cnt, MID_GFX);
+                ASSERT(trans->groups);
+                memset(trans->groups, 0x00, sizeof(struct anim_ctrl_transition_group)*group_cnt);
+
+                for (uint k = 0; k < group_cnt; k++)  {
+                    anim_ctrl_parse_group(alloc, &trans->groups[k], json_getarr_item(jgroups, k));
+                    trans->group_cnt ++;
+                }   /* endfor: groups */
+            }
+        }
+
+        ctrl->transition_cnt ++;
+    }
+}
+
+void anim_ctrl_parse_group(struct allocator* alloc, struct anim_ctrl_transition_group* grp,
+                           json_t jgrp)
+{
+    json_t jconds = json_getitem(jgrp, "conditions");
+    if (jconds != NULL) {
+        uint cnt = json_getarr_count(jconds);
+        grp->item_cnt = cnt;
+        if (cnt == 0)
+            return;
+
+        grp->items = (struct anim_ctrl_transition_groupitem*)
+            A_ALLOC(alloc, sizeof(struct anim_ctrl_transition_groupitem)*cnt, MID_ANIM);
+        ASSERT(grp->items);
+
+        for (uint i = 0; i < cnt; i++)    {
+            struct anim_ctrl_transition_groupitem* item = &grp->items[i];
+            json_t jitem = json_getarr_item(jconds, i);
+
+            item->type = anim_ctrl_parse_grptype(jitem);
+            item->param_idx = json_geti_child(jitem, "param", INVALID_INDEX);
+            item->predicate = anim_ctrl_parse_grppred(jitem);
+
+            const char* value_type = json_gets_child(jitem, "value-type", "float");
+            if (str_isequal_nocase(value_type, "bool"))
+                item->value.b = json_getb_child(jitem, "value", FALSE);
+            else if (str_isequal_nocase(value_type, "int"))
+                item->value.i = json_geti_child(jitem, "value", 0);
+            else if (str_isequal_nocase(value_type, "float"))
+                item->value.f = json_getf_child(jitem, "value", 0.0f);
+        }
+    }   else    {
+        grp->item_cnt = 0;
+        grp->items = NULL;
+    }
+}
+
+void anim_ctrl_load_blendtrees(anim_ctrl ctrl, json_t jblendtrees, struct allocator* alloc)
+{
+    if (jblendtrees == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jblendtrees);
+    if (cnt == 0)
+        return;
+
+    ctrl->blendtrees = (struct anim_ctrl_blendtree*)A_ALLOC(alloc,
+        sizeof(struct anim_ctrl_blendtree)*cnt, MID_ANIM);
+    ASSERT(ctrl->blendtrees);
+    memset(ctrl->blendtrees, 0x00, sizeof(struct anim_ctrl_blendtree)*cnt);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jbt = json_getarr_item(jblendtrees, i);
+        struct anim_ctrl_blendtree* bt = &ctrl->blendtrees[i];
+        strcpy(bt->name, json_gets_child(jbt, "name", ""));
+
+        bt->param_idx = json_geti_child(jbt, "param", INVALID_INDEX);
+
+        /* childs */
+        json_t jchilds = json_getitem(jbt, "childs");
+        if (jchilds != NULL)    {
+            uint child_cnt = json_getarr_count(jchilds);
+            if (child_cnt > 0)  {
+                bt->child_seqs = (struct anim_ctrl_sequence*)A_ALLOC(alloc,
+                    sizeof(struct anim_ctrl_sequence)*child_cnt, MID_ANIM);
+                ASSERT(bt->child_seqs);
+
+                for (uint k = 0; k < child_cnt; k++)  {
+                    json_t jseq = json_getarr_item(jchilds, k);
+                    struct anim_ctrl_sequence* seq = &bt->child_seqs[k];
+                    seq->idx = json_geti_child(jseq, "id", INVALID_INDEX);
+                    seq->type = anim_ctrl_parse_seqtype(jseq);
+
+                    bt->child_seq_cnt ++;
+                }
+                bt->child_cnt_f = (float)bt->child_seq_cnt;
+            }
+        }
+
+        ctrl->blendtree_cnt ++;
+    }
+}
+
+void anim_ctrl_load_states(anim_ctrl ctrl, json_t jstates, struct allocator* alloc)
+{
+    if (jstates == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jstates);
+    if (cnt == 0)
+        return;
+    ctrl->states = (struct anim_ctrl_state*)A_ALLOC(alloc, sizeof(struct anim_ctrl_state)*cnt,
+        MID_ANIM);
+    ASSERT(ctrl->states);
+    memset(ctrl->states, 0x00, sizeof(struct anim_ctrl_state)*cnt);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jstate = json_getarr_item(jstates, i);
+        struct anim_ctrl_state* state = &ctrl->states[i];
+
+        strcpy(state->name, json_gets_child(jstate, "name", ""));
+        state->speed = json_getf_child(jstate, "speed", 1.0f);
+
+        /* sequence */
+        json_t jseq = json_getitem(jstate, "sequence");
+        if (jseq != NULL)   {
+            state->seq.type = anim_ctrl_parse_seqtype(jseq);
+            state->seq.idx = json_geti_child(jseq, "id", INVALID_INDEX);
+        }
+
+        /* transitions */
+        json_t jtrans = json_getitem(jstate, "transitions");
+        if (jtrans != NULL) {
+            state->transition_cnt = json_getarr_count(jtrans);
+            if (state->transition_cnt > 0) {
+                state->transitions = (uint*)A_ALLOC(alloc,
+                    sizeof(uint)*state->transition_cnt, MID_ANIM);
+                ASSERT(state->transitions);
+
+                for (uint k = 0; k < state->transition_cnt; k++)
+                    state->transitions[k] = json_geti(json_getarr_item(jtrans, k));
+            }
+        }
+
+        ctrl->state_cnt ++;
+    }
+}
+
+void anim_ctrl_load_layers(anim_ctrl ctrl, json_t jlayers, struct allocator* alloc)
+{
+    if (jlayers == NULL)
+        return;
+
+    uint cnt = json_getarr_count(jlayers);
+    if (cnt == 0)
+        return;
+    ctrl->layers = (struct anim_ctrl_layer*)A_ALLOC(alloc, sizeof(struct anim_ctrl_layer)*cnt,
+        MID_ANIM);
+    ASSERT(ctrl->layers);
+    memset(ctrl->layers, 0x00, sizeof(struct anim_ctrl_layer)*cnt);
+
+    for (uint i = 0; i < cnt; i++)    {
+        json_t jlayer = json_getarr_item(jlayers, i);
+        struct anim_ctrl_layer* layer = &ctrl->layers[i];
+
+        strcpy(layer->name, json_gets_child(jlayer, "name", ""));
+        layer->default_state_idx = json_geti_child(jlayer, "default", INVALID_INDEX);
+
+        layer->type = anim_ctrl_parse_layertype(jlayer);
+
+        /* states */
+        json_t jstates = json_getitem(jlayer, "states");
+        if (jstates != NULL)    {
+            layer->state_cnt = json_getarr_count(jstates);
+            if (layer->state_cnt != 0)  {
+                layer->states = (uint*)A_ALLOC(alloc, sizeof(uint)*layer->state_cnt,
+                    MID_ANIM);
+                ASSERT(layer->states);
+                for (uint k = 0; k < layer->state_cnt; k++)
+                    layer->states[k] = json_geti(json_getarr_item(jstates, k));
+            }
+        }
+
+        /* bone-mask */
+        json_t jbonemask = json_getitem(jlayer, "bone-mask");
+        if (jbonemask != NULL)  {
+            layer->bone_mask_cnt = json_getarr_count(jbonemask);
+            if (layer->bone_mask_cnt != 0)  {
+                layer->bone_mask = (char*)A_ALLOC(alloc, 32*layer->bone_mask_cnt, MID_ANIM);
+                ASSERT(layer->bone_mask);
+                for (uint k = 0; k < layer->bone_mask_cnt; k++)
+                    strcpy(layer->bone_mask + 32*k, json_gets(json_getarr_item(jbonemask, k)));
+            }
+        }
+
+        ctrl->layer_cnt ++;
+    }
+}
+
+void anim_ctrl_unload(anim_ctrl ctrl)
+{
+    A_ALIGNED_FREE(ctrl->alloc, ctrl);
+}
+
+size_t anim_ctrl_getsize(anim_ctrl ctrl)
+{
+    return ctrl->data_size;
+}
+
+/*************************************************************************************************/
+anim_ctrl_inst anim_ctrl_allocinstance(struct allocator* alloc, const anim_ctrl ctrl)
+{
+    /* calculate bytes needed to create the whole instance data */
+    size_t bytes =
+        sizeof(struct anim_ctrl_instance_data) +
+        ctrl->param_cnt*sizeof(struct anim_ctrl_param_inst) +
+        ctrl->blendtree_cnt*sizeof(struct anim_ctrl_blendtree_inst) +
+        ctrl->clip_cnt*sizeof(struct anim_ctrl_clip_inst) +
+        ctrl->layer_cnt*sizeof(struct anim_ctrl_layer_inst) +
+        ctrl->transition_cnt*sizeof(struct anim_ctrl_transition_inst);
+
+    uint8* buff = (uint8*)A_ALIGNED_ALLOC(alloc, bytes, MID_ANIM);
+    if (buff == NULL)   {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        return NULL;
+    }
+    memset(buff, 0x00, bytes);
+    struct anim_ctrl_instance_data* inst = (struct anim_ctrl_instance_data*)buff;
+
+    inst->alloc = alloc;
+    inst->owner = ctrl;
+    inst->playrate = 1.0f;
+    inst->reel_hdl = INVALID_HANDLE;
+    buff += sizeof(struct anim_ctrl_instance_data);
+
+    if (ctrl->param_cnt > 0)    {
+        inst->params = (struct anim_ctrl_param_inst*)buff;
+        for (uint i = 0; i < ctrl->param_cnt; i++)    {
+            struct anim_ctrl_param_inst* param = &inst->params[i];
+            param->type = ctrl->params[i].type;
+            param->value.i = ctrl->params[i].value.i;
+        }
+        buff += sizeof(struct anim_ctrl_param_inst)*ctrl->param_cnt;
+    }
+
+    if (ctrl->layer_cnt > 0)    {
+        inst->layers = (struct anim_ctrl_layer_inst*)buff;
+        for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+            struct anim_ctrl_layer_inst* layer = &inst->layers[i];
+            layer->state_idx = INVALID_INDEX;
+            layer->transition_idx = INVALID_INDEX;
+        }
+        buff += sizeof(struct anim_ctrl_layer_inst)*ctrl->layer_cnt;
+        inst->layer_cnt = ctrl->layer_cnt;
+    }
+
+    if (ctrl->clip_cnt > 0) {
+        inst->clips = (struct anim_ctrl_clip_inst*)buff;
+        for (uint i = 0; i < ctrl->clip_cnt; i++) {
+            struct anim_ctrl_clip_inst* clip = &inst->clips[i];
+            clip->start_tm = 0.0f;
+            clip->tm = 0.0f;
+            clip->rclip_idx = INVALID_INDEX;
+        }
+        buff += sizeof(struct anim_ctrl_clip_inst)*ctrl->clip_cnt;
+    }
+
+    if (ctrl->blendtree_cnt > 0)    {
+        inst->blendtrees = (struct anim_ctrl_blendtree_inst*)buff;
+        for (uint i = 0; i < ctrl->blendtree_cnt; i++)    {
+            struct anim_ctrl_blendtree_inst* bt = &inst->blendtrees[i];
+            bt->seq_a = INVALID_INDEX;
+            bt->seq_b = INVALID_INDEX;
+            bt->blend = 0.0f;
+        }
+        buff += sizeof(struct anim_ctrl_blendtree_inst)*ctrl->blendtree_cnt;
+    }
+
+    if (ctrl->transition_cnt > 0)   {
+        inst->transitions = (struct anim_ctrl_transition_inst*)buff;
+        for (uint i = 0; i < ctrl->transition_cnt; i++)   {
+            struct anim_ctrl_transition_inst* trans = &inst->transitions[i];
+            trans->blend = 0.0f;
+            trans->start_tm = 0.0f;
+        }
+        buff += sizeof(struct anim_ctrl_transition_inst)*ctrl->transition_cnt;
+    }
+
+    return inst;
+}
+
+void anim_ctrl_freeinstance(anim_ctrl_inst inst)
+{
+    A_ALIGNED_FREE(inst->alloc, inst);
+}
+
+uint anim_ctrl_resolve(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx, float tm)
+{
+    struct anim_ctrl_layer_inst* ilayer = &inst->layers[layer_idx];
+
+    /* we have no state, go to default state */
+    if (ilayer->state_idx == INVALID_INDEX && ilayer->transition_idx == INVALID_INDEX)  {
+        ilayer->state_idx = ctrl->layers[layer_idx].default_state_idx;
+        anim_ctrl_startstate(ctrl, inst, ilayer->state_idx, tm);
+    }
+
+    uint switch_cnt = 0;
+    while (switch_cnt < ANIM_CTRL_SWITCH_MAX)    {
+        inst->eval_cnt ++;
+        if (ilayer->state_idx != INVALID_INDEX) {
+            if (!anim_ctrl_checkstate(ctrl, inst, layer_idx, ilayer->state_idx, tm))
+                break;
+        }   else if (!anim_ctrl_checktransition(ctrl, inst, layer_idx, ilayer->transition_idx, tm)) {
+            break;
+        }
+        switch_cnt ++;
+    }
+    return switch_cnt;
+}
+
+/* checks if transition is finished, and moves the layer to the target state
+ * returns TRUE if the layer is switched to the target state */
+int anim_ctrl_checktransition(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                              uint transition_idx, float tm)
+{
+    const struct anim_ctrl_transition* trans = &ctrl->transitions[transition_idx];
+    struct anim_ctrl_transition_inst* itrans = &inst->transitions[transition_idx];
+
+    float elapsed = inst->playrate*(tm - itrans->start_tm);
+    if (elapsed < trans->duration)
+        return FALSE;
+
+    struct anim_ctrl_layer_inst* ilayer = &inst->layers[layer_idx];
+    itrans->blend = 1.0f;
+    ilayer->state_idx = trans->target_state_idx;
+    ilayer->transition_idx = INVALID_INDEX;
+    return TRUE;
+}
+
+int anim_ctrl_checkstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                         uint state_idx, float tm)
+{
+    const struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
+    int condition_meet = FALSE;
+
+    for (uint i = 0, cnt = cstate->transition_cnt; i < cnt; i++)  {
+        struct anim_ctrl_transition* trans = &ctrl->transitions[cstate->transitions[i]];
+        for (uint k = 0; k < trans->group_cnt; k++)   {
+            const struct anim_ctrl_transition_group* tgroup = &trans->groups[k];
+            condition_meet |= anim_ctrl_checktgroup(ctrl, inst, state_idx, layer_idx, tgroup, tm);
+        }
+
+        if (condition_meet) {
+            uint trans_idx = cstate->transitions[i];
+            if (inst->layers[layer_idx].transition_idx != trans_idx)
+                anim_ctrl_starttransition(ctrl, inst, layer_idx, cstate->transitions[i], tm);
+            break;
+        }
+    }
+
+    return condition_meet;
+}
+
+int anim_ctrl_checktgroup(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
+                          uint layer_idx, const struct anim_ctrl_transition_group* tgroup,
+                          float tm)
+{
+    int condition = TRUE;
+    for (uint i = 0; i < tgroup->item_cnt && condition; i++)   {
+        const struct anim_ctrl_transition_groupitem* item = &tgroup->items[i];
+
+        if (item->type == ANIM_CTRL_TGROUP_EXIT)    {
+            float k = anim_ctrl_progress_state(ctrl, inst, state_idx);
+            condition &= anim_ctrl_testpredicate_f(item->predicate, k, item->value.f);
+        }    else if (item->type == ANIM_CTRL_TGROUP_PARAM) {
+            struct anim_ctrl_param_inst* param_i = &inst->params[item->param_idx];
+            switch (param_i->type)    {
+            case ANIM_CTRL_PARAM_BOOLEAN:
+                condition &= anim_ctrl_testpredicate_b(param_i->value.b, item->value.b);
+                break;
+            case ANIM_CTRL_PARAM_FLOAT:
+                condition &= anim_ctrl_testpredicate_f(item->predicate, param_i->value.f,
+                    item->value.f);
+                break;
+            case ANIM_CTRL_PARAM_INT:
+                condition &= anim_ctrl_testpredicate_n(item->predicate, param_i->value.i,
+                    item->value.i);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return condition;
+}
+
+void anim_ctrl_starttransition(const anim_ctrl ctrl, anim_ctrl_inst inst, uint layer_idx,
+                               uint transition_idx, float tm)
+{
+    const struct anim_ctrl_transition* trans = &ctrl->transitions[transition_idx];
+    struct anim_ctrl_transition_inst* itrans = &inst->transitions[transition_idx];
+    struct anim_ctrl_layer_inst* ilayer = &inst->layers[layer_idx];
+
+    ilayer->state_idx = INVALID_INDEX;
+    ilayer->transition_idx = transition_idx;
+
+    itrans->start_tm = tm;
+    itrans->blend = 0.0;
+
+    anim_ctrl_startstate(ctrl, inst, trans->target_state_idx, tm);
+}
+
+float anim_ctrl_progress_state(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx)
+{
+    const struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
+    const struct anim_ctrl_sequence* seq = &cstate->seq;
+
+    if (seq->type == ANIM_CTRL_SEQUENCE_CLIP)
+        return minf(inst->clips[seq->idx].progress, 1.0f);
+    else if (seq->type == ANIM_CTRL_SEQUENCE_BLENDTREE)
+        return minf(inst->blendtrees[seq->idx].progress, 1.0f);
+
+    return 0.0f;
+}
+
+void anim_ctrl_startstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
+                          float start_tm)
+{
+    struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
+    anim_ctrl_startseq(ctrl, inst, &cstate->seq, start_tm);
+}
+
+void anim_ctrl_startseq(const anim_ctrl ctrl, anim_ctrl_inst inst,
+                        const struct anim_ctrl_sequence* seq, float start_tm)
+{
+    if (seq->type == ANIM_CTRL_SEQUENCE_CLIP)
+        anim_ctrl_startclip(ctrl, inst, seq->idx, start_tm);
+    else if (seq->type == ANIM_CTRL_SEQUENCE_BLENDTREE)
+        anim_ctrl_startblendtree(ctrl, inst, seq->idx, start_tm);
+}
+
+void anim_ctrl_startclip(const anim_ctrl ctrl, anim_ctrl_inst inst, uint clip_idx, float start_tm)
+{
+    struct anim_ctrl_clip_inst* iclip = &inst->clips[clip_idx];
+    iclip->start_tm = start_tm;
+    iclip->progress = 0.0f;
+}
+
+void anim_ctrl_startblendtree(const anim_ctrl ctrl, anim_ctrl_inst inst, uint blendtree_idx,
+                              float start_tm)
+{
+    struct anim_ctrl_blendtree_inst* ibt = &inst->blendtrees[blendtree_idx];
+    ibt->seq_a = INVALID_INDEX;
+    ibt->seq_b = INVALID_INDEX;
+    ibt->progress = 0.0f;
+
+    /* recurse for child blendtrees */
+    const struct anim_ctrl_blendtree* bt = &ctrl->blendtrees[blendtree_idx];
+    for (uint i = 0, cnt = bt->child_seq_cnt; i < cnt; i++)
+        anim_ctrl_startseq(ctrl, inst, &bt->child_seqs[i], start_tm);
+}
+
+/*************************************************************************************************/
+uint anim_ctrl_findparam(anim_ctrl ctrl, const char* name)
+{
+    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
+    if (item != NULL)
+        return (uint)item->value;
+    return INVALID_INDEX;
+}
+
+enum anim_ctrl_paramtype anim_ctrl_get_paramtype(anim_ctrl ctrl, anim_ctrl_inst inst,
+    const char* name)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        return inst->params[idx].type;
+    return ANIM_CTRL_PARAM_UNKNOWN;
+}
+
+float anim_ctrl_get_paramf(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        return anim_ctrl_get_paramf_byidx(inst, idx);
+    return 0.0f;
+}
+
+void anim_ctrl_set_paramf(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, float value)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        anim_ctrl_set_paramf_byidx(inst, idx, value);
+}
+
+int anim_ctrl_get_paramb(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        return anim_ctrl_get_paramb_byidx(inst, idx);
+    return FALSE;
+}
+
+void anim_ctrl_set_paramb(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, int value)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        anim_ctrl_set_paramb_byidx(inst, idx, value);
+}
+
+int anim_ctrl_get_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        return anim_ctrl_get_parami_byidx(inst, idx);
+    return FALSE;
+}
+
+void anim_ctrl_set_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, int value)
+{
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx != INVALID_INDEX)
+        anim_ctrl_set_parami_byidx(inst, idx, value);
+}
+
+/* index based parameter access, indexes are fetched once with anim_ctrl_findparam */
+enum anim_ctrl_paramtype anim_ctrl_get_paramtype_byidx(anim_ctrl_inst inst, uint idx)
+{
+    if (idx < inst->owner->param_cnt)
+        return inst->params[idx].type;
+    return ANIM_CTRL_PARAM_UNKNOWN;
+}
+
+float anim_ctrl_get_paramf_byidx(anim_ctrl_inst inst, uint idx)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_FLOAT);
+    return inst->params[idx].value.f;
+}
+
+void anim_ctrl_set_paramf_byidx(anim_ctrl_inst inst, uint idx, float value)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_FLOAT);
+    inst->params[idx].value.f = value;
+}
+
+int anim_ctrl_get_paramb_byidx(anim_ctrl_inst inst, uint idx)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_BOOLEAN);
+    return inst->params[idx].value.b;
+}
+
+void anim_ctrl_set_paramb_byidx(anim_ctrl_inst inst, uint idx, int value)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_BOOLEAN);
+    inst->params[idx].value.b = value;
+}
+
+int anim_ctrl_get_parami_byidx(anim_ctrl_inst inst, uint idx)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_INT);
+    return inst->params[idx].value.i;
+}
+
+void anim_ctrl_set_parami_byidx(anim_ctrl_inst inst, uint idx, int value)
+{
+    ASSERT(idx < inst->owner->param_cnt);
+    ASSERT(inst->params[idx].type == ANIM_CTRL_PARAM_INT);
+    inst->params[idx].value.i = value;
+}
+
+int anim_ctrl_get_curstate(anim_ctrl ctrl, anim_ctrl_inst inst, const char* layer_name, 
+    char* state, float* progress)
+{
+    /* find layer */
+    for (uint i = 0; i < ctrl->layer_cnt; i++)  {
+        if (str_isequal(ctrl->layers[i].name, layer_name))  {
+            struct anim_ctrl_layer_inst* ilayer = &inst->layers[i];
+            if (ilayer->state_idx != INVALID_INDEX) {
+                uint idx = ilayer->state_idx;
+                float p = 0.0f;
+                if (ctrl->states[idx].seq.type == ANIM_CTRL_SEQUENCE_CLIP)
+                    p = inst->clips[ctrl->states[idx].seq.idx].progress;
+                else if (ctrl->states[idx].seq.type == ANIM_CTRL_SEQUENCE_BLENDTREE)
+                    p = inst->blendtrees[ctrl->states[idx].seq.idx].progress;
+
+                if (progress)
+                    *progress = p;
+
+                strcpy(state, ctrl->states[idx].name);
+
+                return TRUE;
+            }
+
+            break;
+        }
+    }
+    return FALSE;
+}
+
+int anim_ctrl_get_curtransition(anim_ctrl ctrl, anim_ctrl_inst inst, const char* layer_name, 
+    char* state_a, char* state_b, OUT OPTIONAL float* progress)
+{
+    for (uint i = 0; i < ctrl->layer_cnt; i++)  {
+        if (str_isequal(ctrl->layers[i].name, layer_name))  {
+            struct anim_ctrl_layer_inst* ilayer = &inst->layers[i];
+            if (ilayer->transition_idx != INVALID_INDEX) {
+                uint idx = ilayer->transition_idx;
+                if (progress)
+                    *progress = inst->transitions[idx].blend;
+
+                if (ctrl->transitions[idx].owner_state_idx != INVALID_INDEX)
+                    strcpy(state_a, ctrl->states[ctrl->transitions[idx].owner_state_idx].name);
+                if (ctrl->transitions[idx].target_state_idx != INVALID_INDEX)
+                    strcpy(state_b, ctrl->states[ctrl->transitions[idx].target_state_idx].name);
+
+                return TRUE;
+            }
+
+            break;
+        }
+    }
+    return FALSE;
+}
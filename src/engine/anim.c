@@ -15,13 +15,14 @@
 
 #include "dhcore/core.h"
 #include "dhcore/file-io.h"
-#include "dhcore/json.h"
 #include "dhcore/vec-math.h"
 #include "dhcore/hash-table.h"
 #include "dhcore/stack-alloc.h"
 #include "dhcore/task-mgr.h"
+#include "dhcore/hash.h"
 
 #include "anim.h"
+#include "anim-ctrl.h"
 #include "h3d-types.h"
 #include "mem-ids.h"
 #include "res-mgr.h"
@@ -30,14 +31,14 @@
 #include "gfx-canvas.h"
 
 #include "components/cmp-xform.h"
+#include "console.h"
+#include "debug-hud.h"
 
 /*************************************************************************************************
  * types
  */
 
 /* layer blend function callbacks */
-typedef const struct mat3f* (*pfn_anim_layerblend)(struct mat3f* result, struct mat3f* src,
-    struct mat3f* dest, float mask);
 const struct mat3f* anim_ctrl_layer_override(struct mat3f* result, struct mat3f* src,
     struct mat3f* dest, float mask);
 const struct mat3f* anim_ctrl_layer_additive(struct mat3f* result, struct mat3f* src,
@@ -89,6 +90,7 @@ struct anim_reel_data
     uint flags;   /* combination of enum anim_flags */
     uint pose_cnt;
     uint clip_cnt;
+    uint data_size; /* size of the whole memory block */
     char* binds;   /* maps each joint/node to binded hierarchy/skeleton nodes. size: char(32)*pose_cnt */
     struct anim_channel* channels;  /* count: frame_cnt */
     struct anim_clip* clips;
@@ -97,262 +99,69 @@ struct anim_reel_data
 };
 
 /*************************************************************************************************
- * animation controller (mainly used for characters)
+ * shared sampling cache
+ * instances that sample the same reel clip at the same (quantized) time within a frame, share the
+ * sampled poses instead of interpolating the reel channels again (crowds, idle npcs, etc.)
+ * cache is cleared at the beginning of each frame and only accessed by the main thread
  */
-enum anim_ctrl_sequencetype
-{
-    ANIM_CTRL_SEQUENCE_UNKNOWN = 0,
-    ANIM_CTRL_SEQUENCE_CLIP,
-    ANIM_CTRL_SEQUENCE_BLENDTREE
-};
-
-enum anim_ctrl_layertype
-{
-    ANIM_CTRL_LAYER_OVERRIDE = 0,
-    ANIM_CTRL_LAYER_ADDITIVE
-};
-
-struct anim_ctrl_param
-{
-    char name[32];
-    enum anim_ctrl_paramtype type;
-    union   {
-        float f;
-        int i;
-        int b;
-    } value;
-};
-
-struct anim_ctrl_layer
-{
-    char name[32];
-    enum anim_ctrl_layertype type;
-    uint state_cnt;
-    uint* states; /* index to states in anim_ctrl */
-    uint default_state_idx;
-    uint bone_mask_cnt;
-    char* bone_mask;    /* array of strings, in form of series of char[32] items */
-};
+#define ANIM_CACHE_SUBFRAMES 4  /* time quantization steps per reel frame */
+#define ANIM_CACHE_BUFFSIZE (512*1024)
+#define ANIM_CACHE_HSEED 3847
 
-struct anim_ctrl_sequence
+struct anim_cache_key
 {
-    enum anim_ctrl_sequencetype type;
-    uint idx;
+    uptr_t reel;
+    uint clip_idx;
+    uint qtm;   /* quantized time (subframe index) */
 };
 
-struct anim_ctrl_state
+struct anim_cache_item
 {
-    char name[32];
-    float speed;
-    uint transition_cnt;
-    uint* transitions;
-    struct anim_ctrl_sequence seq;
-};
-
-struct anim_ctrl_blendtree
-{
-    char name[32];
-    uint param_idx;
-    uint child_seq_cnt;
-    float child_cnt_f;
-    struct anim_ctrl_sequence* child_seqs;
-};
-
-struct anim_ctrl_clip
-{
-    char name[32];
-    uint name_hash;
+    struct anim_cache_key key;
+    struct anim_pose* poses;    /* count: pose_cnt of reel */
 };
 
-enum anim_predicate
+struct anim_cache
 {
-    ANIM_PREDICATE_UNKNOWN = 0,
-    ANIM_PREDICATE_EQUAL,
-    ANIM_PREDICATE_NOT,
-    ANIM_PREDICATE_GREATER,
-    ANIM_PREDICATE_LESS
+    int enable;
+    int debug;
+    struct stack_alloc stack_mem;   /* holds items and poses, reset each frame */
+    struct allocator alloc;
+    struct hashtable_open table;    /* key: hash of anim_cache_key, value: anim_cache_item* */
+    struct anim_cache_stats stats;  /* last frame stats */
+    struct anim_cache_stats frame_stats;    /* current frame stats */
 };
 
-enum anim_ctrl_tgrouptype
-{
-    ANIM_CTRL_TGROUP_EXIT = 0,
-    ANIM_CTRL_TGROUP_PARAM
-};
-
-struct anim_ctrl_transition_groupitem
-{
-    enum anim_ctrl_tgrouptype type;
-    enum anim_predicate predicate;
-    uint param_idx;
-    union {
-        float f;
-        int b;
-        int i;
-    } value;
-};
-
-struct anim_ctrl_transition_group
-{
-    uint item_cnt;
-    struct anim_ctrl_transition_groupitem* items;  /* conditions */
-};
-
-struct anim_ctrl_transition
-{
-    float duration;
-    uint owner_state_idx;
-    uint target_state_idx;
-    uint group_cnt;
-    struct anim_ctrl_transition_group* groups;
-};
-
-struct anim_ctrl_data
-{
-    struct allocator* alloc;
-    char reel_filepath[128];
-
-    uint transition_cnt;
-    uint clip_cnt;
-    uint blendtree_cnt;
-    uint state_cnt;
-    uint param_cnt;
-    uint layer_cnt;
-
-    struct anim_ctrl_transition* transitions;
-    struct anim_ctrl_clip* clips;
-    struct anim_ctrl_blendtree* blendtrees;
-    struct anim_ctrl_state* states;
-    struct anim_ctrl_param* params;
-    struct anim_ctrl_layer* layers;
-
-    struct hashtable_fixed param_tbl;   /* key: param-name, value: index */
-};
-
-/*************************************************************************************************/
-/* instance for each anim-controller */
-struct anim_ctrl_param_inst
-{
-    enum anim_ctrl_paramtype type;
-    union   {
-        float f;
-        int i;
-        int b;
-    } value;
-};
-
-struct anim_ctrl_layer_inst
-{
-    uint state_idx;   /* active state (=INVALID_INDEX if we are on state) */
-    uint transition_idx;  /* active transition (=INVALID_INDEX if we are not on transition) */
-    pfn_anim_layerblend blend_fn;
-
-    uint8* buff; /* buffer for below allocations */
-    struct anim_pose* poses;    /* temp storing final blended pose (cnt = pose_cnt of reel) */
-    float* bone_mask;    /* bone-mask, multipliers for poses (cnt = pose_cnt of reel) */
-};
-
-struct anim_ctrl_clip_inst
-{
-    float start_tm;  /* global start time */
-    float tm;    /* local time */
-    float progress;  /* normalized progress (*N if looped) */
-    float duration;
-    int looped;
-    uint rclip_idx;
-};
-
-struct anim_ctrl_blendtree_inst
-{
-    uint seq_a;   /* first sequence being played (=INVALID_INDEX if none) */
-    uint seq_b;   /* second sequence being played (=INVALID_INDEX if none) */
-    float blend;
-    float progress;
-};
-
-struct anim_ctrl_transition_inst
-{
-    float start_tm; /* global start time */
-    float blend; /* blend position [0~1] */
-};
-
-/* instance data holds the whole state of each anim-controller */
-struct anim_ctrl_instance_data
-{
-    struct allocator* alloc;
-    anim_ctrl owner;
-    reshandle_t reel_hdl;
-
-    float tm;    /* global time */
-    float playrate;  /* playback rate (default=1) */
-
-    uint layer_cnt;
-    struct anim_ctrl_param_inst* params;
-    struct anim_ctrl_layer_inst* layers;
-    struct anim_ctrl_clip_inst* clips;
-    struct anim_ctrl_blendtree_inst* blendtrees;
-    struct anim_ctrl_transition_inst* transitions;
-};
+static struct anim_cache g_anim_cache;
 
 /*************************************************************************************************
  * fwd declarations
  */
 
 /* animation reel */
+static anim_reel anim_loadfile(struct allocator* alloc, file_t f, const char* name,
+    struct allocator* tmp_alloc);
 static void anim_loadchannel(file_t f, anim_reel reel, struct vec4f* tmp_pos_scale,
     struct quat4f* tmp_rot, uint pose_idx, uint frame_cnt);
 static uint anim_findclip_hashed(const anim_reel reel, uint name_hash);
 
-/* animation controller - loading */
-static void anim_ctrl_load_params(anim_ctrl ctrl, json_t jparams, struct allocator* alloc);
-static void anim_ctrl_load_clips(anim_ctrl ctrl, json_t jclips, struct allocator* alloc);
-static void anim_ctrl_load_states(anim_ctrl ctrl, json_t jstates, struct allocator* alloc);
-static void anim_ctrl_load_layers(anim_ctrl ctrl, json_t jlayers, struct allocator* alloc);
-static void anim_ctrl_load_blendtrees(anim_ctrl ctrl, json_t jblendtrees, struct allocator* alloc);
-static void anim_ctrl_load_transitions(anim_ctrl ctrl, json_t jtransitions, struct allocator* alloc);
-static void anim_ctrl_parse_group(struct allocator* alloc, struct anim_ctrl_transition_group* grp,
-                           json_t jgrp);
-static uint anim_ctrl_getcount(json_t jparent, const char* name);
-static uint anim_ctrl_getcount_2nd(json_t jparent, const char* name0, const char* name1);
-static uint anim_ctrl_getcount_3rd(json_t jparent, const char* name0, const char* name1,
-                              const char* name2);
-
 /* animation controller */
-static void anim_ctrl_startstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
-                          float start_tm);
-static int anim_ctrl_checkstate(const anim_ctrl ctrl, anim_ctrl_inst inst, const anim_reel reel,
-                            uint layer_idx, uint state_idx, float tm);
 static void anim_ctrl_updatetransition(struct anim_pose* poses,
                                 const anim_ctrl ctrl, anim_ctrl_inst inst,
                                 const anim_reel reel, uint layer_idx, uint transition_idx,
                                 float tm, struct allocator* tmp_alloc);
-static void anim_ctrl_startstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
-                          float start_tm);
-static int anim_ctrl_checktgroup(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                             const anim_reel reel, uint state_idx, uint layer_idx,
-                             const struct anim_ctrl_transition_group* tgroup, float tm);
 static void anim_ctrl_updatestate(struct anim_pose* poses, const anim_ctrl ctrl, anim_ctrl_inst inst,
                            const anim_reel reel, uint layer_idx, uint state_idx, float tm,
                            struct allocator* tmp_alloc);
-static void anim_ctrl_starttransition(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                               const anim_reel reel, uint layer_idx, uint transition_idx,
-                               float tm);
-static float anim_ctrl_progress_state(const anim_ctrl ctrl, anim_ctrl_inst inst, const anim_reel reel,
-                              uint state_idx);
 static float anim_ctrl_updateseq(struct anim_pose* poses,
                          const anim_ctrl ctrl, anim_ctrl_inst inst, const anim_reel reel,
                          const struct anim_ctrl_sequence* seq, float tm, float playrate,
                          struct allocator* tmp_alloc);
 static void anim_ctrl_calcpose(struct anim_pose* poses, const anim_reel reel, uint clip_idx, float tm);
+static void anim_ctrl_samplepose(struct anim_pose* poses, const anim_reel reel, uint clip_idx,
+                                 float tm);
 static void anim_ctrl_blendpose(struct anim_pose* poses, const struct anim_pose* poses_a,
                          const struct anim_pose* poses_b, uint pose_cnt, float blend);
-static void anim_ctrl_startseq(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                        const struct anim_ctrl_sequence* seq, float start_tm);
-static void anim_ctrl_startclip(const anim_ctrl ctrl, anim_ctrl_inst inst, uint clip_idx, float start_tm);
-static void anim_ctrl_startblendtree(const anim_ctrl ctrl, anim_ctrl_inst inst, uint blendtree_idx,
-                              float start_tm);
-static int anim_ctrl_checktgroup(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                             const anim_reel reel, uint state_idx, uint layer_idx,
-                             const struct anim_ctrl_transition_group* tgroup, float tm);
 static float anim_ctrl_updateclip(struct anim_pose* poses, const anim_ctrl ctrl,
                           anim_ctrl_inst inst, const anim_reel reel, uint clip_idx, float tm,
                           float playrate);
@@ -361,6 +170,12 @@ static float anim_ctrl_updateblendtree(struct anim_pose* poses,
                                const anim_reel reel, uint blendtree_idx, float tm,
                                float playrate, struct allocator* tmp_alloc);
 
+/* sampling cache */
+static void anim_cache_calcpose(struct anim_pose* poses, const anim_reel reel, uint clip_idx,
+                                float tm);
+static result_t anim_console_cache(uint argc, const char** argv, void* param);
+static int anim_cache_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param);
+
 /*************************************************************************************************
  * inlines
  */
@@ -374,123 +189,60 @@ INLINE float anim_calc_duration(float ft, float frame_cnt)
     return ft*frame_cnt;
 }
 
-INLINE enum anim_ctrl_sequencetype anim_ctrl_parse_seqtype(json_t jseq)
-{
-    char seq_type_s[32];
-    strcpy(seq_type_s, json_gets_child(jseq, "type", ""));
-    if (str_isequal(seq_type_s, "clip"))
-        return ANIM_CTRL_SEQUENCE_CLIP;
-    else if (str_isequal(seq_type_s, "blendtree"))
-        return ANIM_CTRL_SEQUENCE_BLENDTREE;
-    else
-        return ANIM_CTRL_SEQUENCE_UNKNOWN;
-}
-
-INLINE enum anim_ctrl_layertype anim_ctrl_parse_layertype(json_t jtype)
-{
-    const char* layer_type_s = json_gets_child(jtype, "layer", "");
-    if (str_isequal(layer_type_s, "override"))
-        return ANIM_CTRL_LAYER_OVERRIDE;
-    else if (str_isequal(layer_type_s, "additive"))
-        return ANIM_CTRL_LAYER_ADDITIVE;
-    else
-        return ANIM_CTRL_LAYER_OVERRIDE;
-}
-
-INLINE enum anim_ctrl_tgrouptype anim_ctrl_parse_grptype(json_t jgrp)
-{
-    char type_s[32];
-    strcpy(type_s, json_gets_child(jgrp, "type", ""));
-
-    if (str_isequal(type_s, "exit"))
-        return ANIM_CTRL_TGROUP_EXIT;
-    else if (str_isequal(type_s, "param"))
-        return ANIM_CTRL_TGROUP_PARAM;
-    else
-        return ANIM_CTRL_TGROUP_EXIT;
-}
-
-INLINE enum anim_predicate anim_ctrl_parse_grppred(json_t jgrp)
-{
-    char pred_s[32];
-    strcpy(pred_s, json_gets_child(jgrp, "predicate", ""));
-
-    if (str_isequal(pred_s, "=="))
-        return ANIM_PREDICATE_EQUAL;
-    else if (str_isequal(pred_s, "!="))
-        return ANIM_PREDICATE_NOT;
-    else if (str_isequal(pred_s, ">"))
-        return ANIM_PREDICATE_GREATER;
-    else if (str_isequal(pred_s, "<"))
-        return ANIM_PREDICATE_LESS;
-    else
-        return ANIM_PREDICATE_UNKNOWN;
-}
-
-INLINE int anim_ctrl_testpredicate_f(enum anim_predicate pred, float value1, float value2)
+/*************************************************************************************************/
+anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thread_id)
 {
-    switch (pred)   {
-    case ANIM_PREDICATE_EQUAL:
-        return math_isequal(value1, value2);
-    case ANIM_PREDICATE_GREATER:
-        return value1 > (value2 + EPSILON);
-    case ANIM_PREDICATE_LESS:
-        return value1 < (value2 - EPSILON);
-    case ANIM_PREDICATE_NOT:
-        return !math_isequal(value1, value2);
-    default:
-        return FALSE;
-    }
-}
+    /* fetch temp allocator (likely it's a stack) */
+    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+    A_SAVE(tmp_alloc);
 
-INLINE int anim_ctrl_testpredicate_n(enum anim_predicate pred, int value1, int value2)
-{
-    switch (pred)   {
-    case ANIM_PREDICATE_EQUAL:
-        return value1 == value2;
-    case ANIM_PREDICATE_GREATER:
-        return value1 > value2;
-    case ANIM_PREDICATE_LESS:
-        return value1 < value2 - EPSILON;
-    case ANIM_PREDICATE_NOT:
-        return value1 != value2;
-    default:
-        return FALSE;
+    file_t f = fio_openmem(alloc, h3da_filepath, FALSE, MID_ANIM);
+    if (f == NULL)  {
+        A_LOAD(tmp_alloc);
+        err_printf(__FILE__, __LINE__, "load anim '%s' failed: could not open file", h3da_filepath);
+        return NULL;
     }
-}
 
-INLINE int anim_ctrl_testpredicate_b(int value1, int value2)
-{
-    return value1 == value2;
+    anim_reel reel = anim_loadfile(alloc, f, h3da_filepath, tmp_alloc);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return reel;
 }
 
-/*************************************************************************************************/
-anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thread_id)
+/* 'data' is not copied or freed, it's usually a blob inside a resource bundle */
+anim_reel anim_loadmem(struct allocator* alloc, const char* name, const void* data, size_t size,
+    uint thread_id)
 {
-    /* fetch temp allocator (likely it's a stack) */
     struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
     A_SAVE(tmp_alloc);
 
-    file_t f = fio_openmem(alloc, h3da_filepath, FALSE, MID_ANIM);
+    file_t f = fio_attachmem(tmp_alloc, (void*)data, size, name, MID_ANIM);
     if (f == NULL)  {
         A_LOAD(tmp_alloc);
-        err_printf(__FILE__, __LINE__, "load anim '%s' failed: could not open file", h3da_filepath);
+        err_printf(__FILE__, __LINE__, "load anim '%s' failed: could not open file", name);
         return NULL;
     }
 
+    anim_reel reel = anim_loadfile(alloc, f, name, tmp_alloc);
+    fio_detachmem(f, &size, NULL);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return reel;
+}
+
+/* reads the reel from an opened file, caller owns 'f' and restores 'tmp_alloc' */
+static anim_reel anim_loadfile(struct allocator* alloc, file_t f, const char* name,
+    struct allocator* tmp_alloc)
+{
     /* check header */
     struct h3d_header header;
     fio_read(f, &header, sizeof(header), 1);
     if (header.sign != H3D_SIGN || header.type != H3D_ANIM) {
-        fio_close(f);
-        err_printf(__FILE__, __LINE__, "load anim '%s' failed: invalid file format", h3da_filepath);
-        A_LOAD(tmp_alloc);
+        err_printf(__FILE__, __LINE__, "load anim '%s' failed: invalid file format", name);
         return NULL;
     }
     if (header.version != H3D_VERSION_11)   {
-        fio_close(f);
-        err_printf(__FILE__, __LINE__, "load anim '%s' failed: invalid file version", h3da_filepath);
-        A_LOAD(tmp_alloc);
+        err_printf(__FILE__, __LINE__, "load anim '%s' failed: invalid file version", name);
         return NULL;
     }
 
@@ -511,8 +263,6 @@ anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thr
         hashtable_fixed_estimate_size(h3danim.clip_cnt);
     if (IS_FAIL(mem_stack_create(alloc, &stack_mem, total_sz, MID_GFX))) {
         err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
-        fio_close(f);
-        A_LOAD(tmp_alloc);
         return NULL;
     }
     mem_stack_bindalloc(&stack_mem, &stack_alloc);
@@ -523,9 +273,10 @@ anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thr
     memset(reel, 0x00, sizeof(struct anim_reel_data));
 
     char filename[32];
-    path_getfilename(filename, h3da_filepath);
+    path_getfilename(filename, name);
     strcpy(reel->name, filename);
     reel->fps = h3danim.fps;
+    reel->data_size = (uint)total_sz;
     reel->frame_cnt = h3danim.frame_cnt;
     reel->ft = 1.0f / ((float)h3danim.fps);
     reel->duration = reel->ft * ((float)h3danim.frame_cnt);
@@ -555,10 +306,8 @@ anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thr
     struct quat4f* rot = (struct quat4f*)A_ALLOC(tmp_alloc, sizeof(struct quat4f)*frame_cnt,
         MID_ANIM);
     if (pos_scale == NULL || rot == NULL)   {
-        fio_close(f);
         anim_unload(reel);
         err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
-        A_LOAD(tmp_alloc);
         return NULL;
     }
 
@@ -599,8 +348,6 @@ anim_reel anim_load(struct allocator* alloc, const char* h3da_filepath, uint thr
         hashtable_fixed_add(&reel->clip_tbl, hash_str(h3dclip.name), i);
     }
 
-    fio_close(f);
-    A_LOAD(tmp_alloc);
     return reel;
 }
 
@@ -625,6 +372,11 @@ void anim_unload(anim_reel reel)
     A_ALIGNED_FREE(reel->alloc, reel);
 }
 
+size_t anim_getsize(anim_reel reel)
+{
+    return reel->data_size;
+}
+
 void anim_update_clip_hierarchal(const anim_reel reel, uint clip_idx, float t,
     const uint* bindmap, const cmphandle_t* xforms, uint frame_force_idx,
     const uint* root_idxs, uint root_idx_cnt, const struct mat3f* root_mat)
@@ -770,432 +522,7 @@ uint anim_find_posebinding(const anim_reel reel, const char* name)
 }
 
 /*************************************************************************************************/
-uint anim_ctrl_getcount(json_t jparent, const char* name)
-{
-    json_t j = json_getitem(jparent, name);
-    if (j != NULL)
-        return json_getarr_count(j);
-    else
-        return 0;
-}
-
-uint anim_ctrl_getcount_2nd(json_t jparent, const char* name0, const char* name1)
-{
-    json_t j = json_getitem(jparent, name0);
-    if (j != NULL)  {
-        uint cnt = 0;
-        uint l1_cnt = json_getarr_count(j);
-        for (uint i = 0; i < l1_cnt; i++)    {
-            json_t j2 = json_getitem(json_getarr_item(j, i), name1);
-            cnt += (j2 != NULL) ? json_getarr_count(j2) : 0;
-        }
-        return cnt;
-    }   else    {
-        return 0;
-    }
-}
-
-uint anim_ctrl_getcount_3rd(json_t jparent, const char* name0, const char* name1,
-                              const char* name2)
-{
-    json_t j = json_getitem(jparent, name0);
-    if (j != NULL)  {
-        uint cnt = 0;
-        uint l1_cnt = json_getarr_count(j);
-        for (uint i = 0; i < l1_cnt; i++)    {
-            json_t j2 = json_getitem(json_getarr_item(j, i), name1);
-
-            if (j2 != NULL) {
-                uint l2_cnt = json_getarr_count(j2);
-                for (uint k = 0; k < l2_cnt; k++) {
-                    json_t j3 = json_getitem(json_getarr_item(j2, k), name2);
-                    cnt += (j3 != NULL) ? json_getarr_count(j3) : 0;
-                }
-            }
-        }
-        return cnt;
-    }   else    {
-        return 0;
-    }
-}
-
-anim_ctrl anim_ctrl_load(struct allocator* alloc, const char* janim_filepath, uint thread_id)
-{
-    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
-    A_SAVE(tmp_alloc);
-
-    /* load JSON ctrl file */
-    file_t f = fio_openmem(tmp_alloc, janim_filepath, FALSE, MID_ANIM);
-    if (f == NULL) {
-        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Could not open file '%s'",
-            janim_filepath);
-        A_LOAD(tmp_alloc);
-        return NULL;
-    }
-
-    json_t jroot = json_parsefilef(f, tmp_alloc);
-    fio_close(f);
-    if (jroot == NULL)  {
-        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: Invalid json '%s'",
-            janim_filepath);
-        A_LOAD(tmp_alloc);
-        return NULL;
-    }
-
-    /* calculate total size and create memory stack */
-    struct stack_alloc stack_mem;
-    struct allocator stack_alloc;
-
-    uint total_tgroups = anim_ctrl_getcount_2nd(jroot, "transitions", "groups");
-    uint total_tgroupitems = anim_ctrl_getcount_3rd(jroot, "transitions", "groups", "conditions");
-    uint total_seqs = anim_ctrl_getcount_2nd(jroot, "blendtrees", "childs");
-    uint total_idxs = anim_ctrl_getcount_2nd(jroot, "states", "transitions") +
-        anim_ctrl_getcount_2nd(jroot, "layers", "states");
-    uint total_bonemasks = anim_ctrl_getcount_2nd(jroot, "layers", "bone-mask");
-    uint param_cnt = anim_ctrl_getcount(jroot, "params");
-    size_t total_sz =
-        sizeof(struct anim_ctrl_data) +
-        hashtable_fixed_estimate_size(param_cnt) +
-        param_cnt*sizeof(struct anim_ctrl_param) +
-        anim_ctrl_getcount(jroot, "clips")*sizeof(struct anim_ctrl_clip) +
-        anim_ctrl_getcount(jroot, "transitions")*sizeof(struct anim_ctrl_transition) +
-        anim_ctrl_getcount(jroot, "blendtrees")*sizeof(struct anim_ctrl_blendtree) +
-        anim_ctrl_getcount(jroot, "layers")*sizeof(struct anim_ctrl_layer) +
-        anim_ctrl_getcount(jroot, "states")*sizeof(struct anim_ctrl_state) +
-        total_tgroups*sizeof(struct anim_ctrl_transition_group) +
-        total_tgroupitems*sizeof(struct anim_ctrl_transition_groupitem) +
-        total_seqs*sizeof(struct anim_ctrl_sequence) +
-        total_idxs*sizeof(uint) +
-        total_bonemasks*32;
-    if (IS_FAIL(mem_stack_create(alloc, &stack_mem, total_sz, MID_GFX)))    {
-        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
-        A_LOAD(tmp_alloc);
-        return NULL;
-    }
-    mem_stack_bindalloc(&stack_mem, &stack_alloc);
-
-    /* create ctrl structure and zero memory */
-    anim_ctrl ctrl = (struct anim_ctrl_data*)A_ALLOC(&stack_alloc, sizeof(struct anim_ctrl_data),
-        MID_ANIM);
-    ASSERT(ctrl);
-    memset(ctrl, 0x00, sizeof(struct anim_ctrl_data));
-    ctrl->alloc = alloc;
-
-    /* animation reel resource */
-    const char* reel_filepath = json_gets_child(jroot, "reel", "");
-    if (reel_filepath[0] == 0)  {
-        err_printf(__FILE__, __LINE__, "Loading ctrl-anim failed: empty reel file");
-        anim_ctrl_unload(ctrl);
-        A_LOAD(tmp_alloc);
-        return NULL;
-    }
-    str_safecpy(ctrl->reel_filepath, sizeof(ctrl->reel_filepath), reel_filepath);
-
-    /* */
-    anim_ctrl_load_params(ctrl, json_getitem(jroot, "params"), &stack_alloc);
-    anim_ctrl_load_clips(ctrl, json_getitem(jroot, "clips"), &stack_alloc);
-    anim_ctrl_load_transitions(ctrl, json_getitem(jroot, "transitions"), &stack_alloc);
-    anim_ctrl_load_blendtrees(ctrl, json_getitem(jroot, "blendtrees"), &stack_alloc);
-    anim_ctrl_load_states(ctrl, json_getitem(jroot, "states"), &stack_alloc);
-    anim_ctrl_load_layers(ctrl, json_getitem(jroot, "layers"), &stack_alloc);
-
-    json_destroy(jroot);
-    A_LOAD(tmp_alloc);
-
-    return ctrl;
-}
-
-void anim_ctrl_load_params(anim_ctrl ctrl, json_t jparams, struct allocator* alloc)
-{
-    if (jparams == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jparams);
-    if (cnt == 0)
-        return;
-    ctrl->params = (struct anim_ctrl_param*)A_ALLOC(alloc, sizeof(struct anim_ctrl_param)*cnt,
-        MID_ANIM);
-    ASSERT(ctrl->params);
-
-    hashtable_fixed_create(alloc, &ctrl->param_tbl, cnt, MID_ANIM);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jparam = json_getarr_item(jparams, i);
-        struct anim_ctrl_param* param = &ctrl->params[i];
-
-        strcpy(param->name, json_gets_child(jparam, "name", ""));
-        hashtable_fixed_add(&ctrl->param_tbl, hash_str(param->name), i);
-
-        char type[32];
-        strcpy(type, json_gets_child(jparam, "type", "float"));
-        if (str_isequal_nocase(type, "float")) {
-            param->type = ANIM_CTRL_PARAM_FLOAT;
-            param->value.f = json_getf_child(jparam, "value", 0.0f);
-        }   else if (str_isequal_nocase(type, "int"))  {
-            param->type = ANIM_CTRL_PARAM_INT;
-            param->value.i = json_geti_child(jparam, "value", 0);
-        }   else if (str_isequal_nocase(type, "bool")) {
-            param->type = ANIM_CTRL_PARAM_BOOLEAN;
-            param->value.b = json_getb_child(jparam, "value", FALSE);
-        }   else    {
-            param->type = ANIM_CTRL_PARAM_FLOAT;
-            param->value.f = 0.0f;
-        }
-    }
-
-    ctrl->param_cnt = cnt;
-}
-
-void anim_ctrl_load_clips(anim_ctrl ctrl, json_t jclips, struct allocator* alloc)
-{
-    if (jclips == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jclips);
-    if (cnt == 0)
-        return;
-
-    ctrl->clips = (struct anim_ctrl_clip*)A_ALLOC(alloc, sizeof(struct anim_ctrl_clip)*cnt,
-        MID_ANIM);
-    ASSERT(ctrl->clips);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jclip = json_getarr_item(jclips, i);
-        struct anim_ctrl_clip* clip = &ctrl->clips[i];
-        strcpy(clip->name, json_gets_child(jclip, "name", ""));
-        clip->name_hash = hash_str(clip->name);
-    }
-
-    ctrl->clip_cnt = cnt;
-}
-
-void anim_ctrl_load_transitions(anim_ctrl ctrl, json_t jtransitions, struct allocator* alloc)
-{
-    if (jtransitions == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jtransitions);
-    if (cnt == 0)
-        return;
-
-    ctrl->transitions = (struct anim_ctrl_transition*)
-        A_ALLOC(alloc, sizeof(struct anim_ctrl_transition)*cnt, MID_ANIM);
-    ASSERT(ctrl->transitions);
-    memset(ctrl->transitions, 0x00, sizeof(struct anim_ctrl_transition)*cnt);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jtrans = json_getarr_item(jtransitions, i);
-        struct anim_ctrl_transition* trans = &ctrl->transitions[i];
-
-        trans->duration = json_getf_child(jtrans, "duration", 0.0f);
-        trans->owner_state_idx = json_geti_child(jtrans, "owner", INVALID_INDEX);
-        trans->target_state_idx = json_geti_child(jtrans, "target", INVALID_INDEX);
-
-        /* groups */
-        json_t jgroups = json_getitem(jtrans, "groups");
-        if (jgroups != NULL)    {
-            uint group_cnt = json_getarr_count(jgroups);
-            if (group_cnt > 0)  {
-                trans->groups = (struct anim_ctrl_transition_group*)A_ALLOC(alloc,
-                    sizeof(struct anim_ctrl_transition_group)*group_cnt, MID_GFX);
-                ASSERT(trans->groups);
-                memset(trans->groups, 0x00, sizeof(struct anim_ctrl_transition_group)*group_cnt);
-
-                for (uint k = 0; k < group_cnt; k++)  {
-                    anim_ctrl_parse_group(alloc, &trans->groups[k], json_getarr_item(jgroups, k));
-                    trans->group_cnt ++;
-                }   /* endfor: groups */
-            }
-        }
-
-        ctrl->transition_cnt ++;
-    }
-}
-
-void anim_ctrl_parse_group(struct allocator* alloc, struct anim_ctrl_transition_group* grp,
-                           json_t jgrp)
-{
-    json_t jconds = json_getitem(jgrp, "conditions");
-    if (jconds != NULL) {
-        uint cnt = json_getarr_count(jconds);
-        grp->item_cnt = cnt;
-        if (cnt == 0)
-            return;
-
-        grp->items = (struct anim_ctrl_transition_groupitem*)
-            A_ALLOC(alloc, sizeof(struct anim_ctrl_transition_groupitem)*cnt, MID_ANIM);
-        ASSERT(grp->items);
-
-        for (uint i = 0; i < cnt; i++)    {
-            struct anim_ctrl_transition_groupitem* item = &grp->items[i];
-            json_t jitem = json_getarr_item(jconds, i);
-
-            item->type = anim_ctrl_parse_grptype(jitem);
-            item->param_idx = json_geti_child(jitem, "param", INVALID_INDEX);
-            item->predicate = anim_ctrl_parse_grppred(jitem);
-
-            const char* value_type = json_gets_child(jitem, "value-type", "float");
-            if (str_isequal_nocase(value_type, "bool"))
-                item->value.b = json_getb_child(jitem, "value", FALSE);
-            else if (str_isequal_nocase(value_type, "int"))
-                item->value.i = json_geti_child(jitem, "value", 0);
-            else if (str_isequal_nocase(value_type, "float"))
-                item->value.f = json_getf_child(jitem, "value", 0.0f);
-        }
-    }   else    {
-        grp->item_cnt = 0;
-        grp->items = NULL;
-    }
-}
-
-
-void anim_ctrl_load_blendtrees(anim_ctrl ctrl, json_t jblendtrees, struct allocator* alloc)
-{
-    if (jblendtrees == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jblendtrees);
-    if (cnt == 0)
-        return;
 
-    ctrl->blendtrees = (struct anim_ctrl_blendtree*)A_ALLOC(alloc,
-        sizeof(struct anim_ctrl_blendtree)*cnt, MID_ANIM);
-    ASSERT(ctrl->blendtrees);
-    memset(ctrl->blendtrees, 0x00, sizeof(struct anim_ctrl_blendtree)*cnt);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jbt = json_getarr_item(jblendtrees, i);
-        struct anim_ctrl_blendtree* bt = &ctrl->blendtrees[i];
-        strcpy(bt->name, json_gets_child(jbt, "name", ""));
-
-        bt->param_idx = json_geti_child(jbt, "param", INVALID_INDEX);
-
-        /* childs */
-        json_t jchilds = json_getitem(jbt, "childs");
-        if (jchilds != NULL)    {
-            uint child_cnt = json_getarr_count(jchilds);
-            if (child_cnt > 0)  {
-                bt->child_seqs = (struct anim_ctrl_sequence*)A_ALLOC(alloc,
-                    sizeof(struct anim_ctrl_sequence)*child_cnt, MID_ANIM);
-                ASSERT(bt->child_seqs);
-
-                for (uint k = 0; k < child_cnt; k++)  {
-                    json_t jseq = json_getarr_item(jchilds, k);
-                    struct anim_ctrl_sequence* seq = &bt->child_seqs[k];
-                    seq->idx = json_geti_child(jseq, "id", INVALID_INDEX);
-                    seq->type = anim_ctrl_parse_seqtype(jseq);
-
-                    bt->child_seq_cnt ++;
-                }
-                bt->child_cnt_f = (float)bt->child_seq_cnt;
-            }
-        }
-
-        ctrl->blendtree_cnt ++;
-    }
-}
-
-
-void anim_ctrl_load_states(anim_ctrl ctrl, json_t jstates, struct allocator* alloc)
-{
-    if (jstates == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jstates);
-    if (cnt == 0)
-        return;
-    ctrl->states = (struct anim_ctrl_state*)A_ALLOC(alloc, sizeof(struct anim_ctrl_state)*cnt,
-        MID_ANIM);
-    ASSERT(ctrl->states);
-    memset(ctrl->states, 0x00, sizeof(struct anim_ctrl_state)*cnt);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jstate = json_getarr_item(jstates, i);
-        struct anim_ctrl_state* state = &ctrl->states[i];
-
-        strcpy(state->name, json_gets_child(jstate, "name", ""));
-        state->speed = json_getf_child(jstate, "speed", 1.0f);
-
-        /* sequence */
-        json_t jseq = json_getitem(jstate, "sequence");
-        if (jseq != NULL)   {
-            state->seq.type = anim_ctrl_parse_seqtype(jseq);
-            state->seq.idx = json_geti_child(jseq, "id", INVALID_INDEX);
-        }
-
-        /* transitions */
-        json_t jtrans = json_getitem(jstate, "transitions");
-        if (jtrans != NULL) {
-            state->transition_cnt = json_getarr_count(jtrans);
-            if (state->transition_cnt > 0) {
-                state->transitions = (uint*)A_ALLOC(alloc,
-                    sizeof(uint)*state->transition_cnt, MID_ANIM);
-                ASSERT(state->transitions);
-
-                for (uint k = 0; k < state->transition_cnt; k++)
-                    state->transitions[k] = json_geti(json_getarr_item(jtrans, k));
-            }
-        }
-
-        ctrl->state_cnt ++;
-    }
-}
-
-void anim_ctrl_load_layers(anim_ctrl ctrl, json_t jlayers, struct allocator* alloc)
-{
-    if (jlayers == NULL)
-        return;
-
-    uint cnt = json_getarr_count(jlayers);
-    if (cnt == 0)
-        return;
-    ctrl->layers = (struct anim_ctrl_layer*)A_ALLOC(alloc, sizeof(struct anim_ctrl_layer)*cnt,
-        MID_ANIM);
-    ASSERT(ctrl->layers);
-    memset(ctrl->layers, 0x00, sizeof(struct anim_ctrl_layer)*cnt);
-
-    for (uint i = 0; i < cnt; i++)    {
-        json_t jlayer = json_getarr_item(jlayers, i);
-        struct anim_ctrl_layer* layer = &ctrl->layers[i];
-
-        strcpy(layer->name, json_gets_child(jlayer, "name", ""));
-        layer->default_state_idx = json_geti_child(jlayer, "default", INVALID_INDEX);
-
-        layer->type = anim_ctrl_parse_layertype(jlayer);
-
-        /* states */
-        json_t jstates = json_getitem(jlayer, "states");
-        if (jstates != NULL)    {
-            layer->state_cnt = json_getarr_count(jstates);
-            if (layer->state_cnt != 0)  {
-                layer->states = (uint*)A_ALLOC(alloc, sizeof(uint)*layer->state_cnt,
-                    MID_ANIM);
-                ASSERT(layer->states);
-                for (uint k = 0; k < layer->state_cnt; k++)
-                    layer->states[k] = json_geti(json_getarr_item(jstates, k));
-            }
-        }
-
-        /* bone-mask */
-        json_t jbonemask = json_getitem(jlayer, "bone-mask");
-        if (jbonemask != NULL)  {
-            layer->bone_mask_cnt = json_getarr_count(jbonemask);
-            if (layer->bone_mask_cnt != 0)  {
-                layer->bone_mask = (char*)A_ALLOC(alloc, 32*layer->bone_mask_cnt, MID_ANIM);
-                ASSERT(layer->bone_mask);
-                for (uint k = 0; k < layer->bone_mask_cnt; k++)
-                    strcpy(layer->bone_mask + 32*k, json_gets(json_getarr_item(jbonemask, k)));
-            }
-        }
-
-        ctrl->layer_cnt ++;
-    }
-}
-
-void anim_ctrl_unload(anim_ctrl ctrl)
-{
-    A_ALIGNED_FREE(ctrl->alloc, ctrl);
-}
 
 /*************************************************************************************************/
 /* note: time (tm) parameter should be global and handled by an external global timer */
@@ -1206,107 +533,26 @@ void anim_ctrl_update(const anim_ctrl ctrl, anim_ctrl_inst inst, float tm,
     if (reel == NULL)
         return;
 
+    inst->eval_cnt = 0;
+
     for (uint i = 0, cnt = ctrl->layer_cnt; i < cnt; i++) {
         struct anim_ctrl_layer_inst* ilayer = &inst->layers[i];
-
-        /* update current state */
         struct anim_pose* rposes = ilayer->poses;
-        if (ilayer->state_idx != INVALID_INDEX)   {
-            if (anim_ctrl_checkstate(ctrl, inst, reel, i, ilayer->state_idx, tm))  {
-                anim_ctrl_update(ctrl, inst, tm, tmp_alloc);
-                return;
-            }
+
+        /* state switches are resolved for this layer only, then the final state is evaluated */
+        anim_ctrl_resolve(ctrl, inst, i, tm);
+
+        /* update current state or transition */
+        if (ilayer->state_idx != INVALID_INDEX)
             anim_ctrl_updatestate(rposes, ctrl, inst, reel, i, ilayer->state_idx, tm, tmp_alloc);
-        }   else if (ilayer->transition_idx != INVALID_INDEX) {
+        else
             anim_ctrl_updatetransition(rposes, ctrl, inst, reel, i, ilayer->transition_idx, tm,
                 tmp_alloc);
-        }   else    {
-            /* we have no state, go to default state */
-            ilayer->state_idx = ctrl->layers[i].default_state_idx;
-            ilayer->transition_idx = INVALID_INDEX;
-            anim_ctrl_startstate(ctrl, inst, ilayer->state_idx, tm);
-            anim_ctrl_updatestate(rposes, ctrl, inst, reel, i, ilayer->state_idx, tm, tmp_alloc);
-        }
     }
 
     inst->tm = tm;
 }
 
-int anim_ctrl_checkstate(const anim_ctrl ctrl, anim_ctrl_inst inst, const anim_reel reel,
-    uint layer_idx, uint state_idx, float tm)
-{
-    const struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
-    int condition_meet = FALSE;
-
-    for (uint i = 0, cnt = cstate->transition_cnt; i < cnt; i++)  {
-        struct anim_ctrl_transition* trans = &ctrl->transitions[cstate->transitions[i]];
-        for (uint k = 0; k < trans->group_cnt; k++)   {
-            const struct anim_ctrl_transition_group* tgroup = &trans->groups[k];
-            condition_meet |= anim_ctrl_checktgroup(ctrl, inst, reel, state_idx, layer_idx, tgroup,
-                tm);
-        }
-
-        if (condition_meet) {
-            uint trans_idx = cstate->transitions[i];
-            if (inst->layers[layer_idx].transition_idx != trans_idx)
-                anim_ctrl_starttransition(ctrl, inst, reel, layer_idx, cstate->transitions[i], tm);
-            break;
-        }
-    }
-
-    return condition_meet;
-}
-
-int anim_ctrl_checktgroup(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                             const anim_reel reel, uint state_idx, uint layer_idx,
-                             const struct anim_ctrl_transition_group* tgroup, float tm)
-{
-    int condition = TRUE;
-    for (uint i = 0; i < tgroup->item_cnt && condition; i++)   {
-        const struct anim_ctrl_transition_groupitem* item = &tgroup->items[i];
-
-        if (item->type == ANIM_CTRL_TGROUP_EXIT)    {
-            float k = anim_ctrl_progress_state(ctrl, inst, reel, state_idx);
-            condition &= anim_ctrl_testpredicate_f(item->predicate, k, item->value.f);
-        }    else if (item->type == ANIM_CTRL_TGROUP_PARAM) {
-            struct anim_ctrl_param_inst* param_i = &inst->params[item->param_idx];
-            switch (param_i->type)    {
-            case ANIM_CTRL_PARAM_BOOLEAN:
-                condition &= anim_ctrl_testpredicate_b(param_i->value.b, item->value.b);
-                break;
-            case ANIM_CTRL_PARAM_FLOAT:
-                condition &= anim_ctrl_testpredicate_f(item->predicate, param_i->value.f,
-                    item->value.f);
-                break;
-            case ANIM_CTRL_PARAM_INT:
-                condition &= anim_ctrl_testpredicate_n(item->predicate, param_i->value.i,
-                    item->value.i);
-                break;
-            default:
-                break;
-            }
-        }
-    }
-    return condition;
-}
-
-void anim_ctrl_starttransition(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                               const anim_reel reel, uint layer_idx, uint transition_idx,
-                               float tm)
-{
-    const struct anim_ctrl_transition* trans = &ctrl->transitions[transition_idx];
-    struct anim_ctrl_transition_inst* itrans = &inst->transitions[transition_idx];
-    struct anim_ctrl_layer_inst* ilayer = &inst->layers[layer_idx];
-
-    ilayer->state_idx = INVALID_INDEX;
-    ilayer->transition_idx = transition_idx;
-
-    itrans->start_tm = tm;
-    itrans->blend = 0.0;
-
-    anim_ctrl_startstate(ctrl, inst, trans->target_state_idx, tm);
-}
-
 void anim_ctrl_updatestate(struct anim_pose* poses, const anim_ctrl ctrl, anim_ctrl_inst inst,
                            const anim_reel reel, uint layer_idx, uint state_idx, float tm,
                            struct allocator* tmp_alloc)
@@ -1360,6 +606,14 @@ float anim_ctrl_updateclip(struct anim_pose* poses, const anim_ctrl ctrl,
 }
 
 void anim_ctrl_calcpose(struct anim_pose* poses, const anim_reel reel, uint clip_idx, float tm)
+{
+    if (g_anim_cache.enable)
+        anim_cache_calcpose(poses, reel, clip_idx, tm);
+    else
+        anim_ctrl_samplepose(poses, reel, clip_idx, tm);
+}
+
+void anim_ctrl_samplepose(struct anim_pose* poses, const anim_reel reel, uint clip_idx, float tm)
 {
     const struct anim_clip* clip = &reel->clips[clip_idx];
     float ft = reel->ft;
@@ -1489,57 +743,6 @@ void anim_ctrl_updatetransition(struct anim_pose* poses,
     }
 }
 
-float anim_ctrl_progress_state(const anim_ctrl ctrl, anim_ctrl_inst inst, const anim_reel reel,
-    uint state_idx)
-{
-    const struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
-    const struct anim_ctrl_sequence* seq = &cstate->seq;
-
-    if (seq->type == ANIM_CTRL_SEQUENCE_CLIP)
-        return minf(inst->clips[seq->idx].progress, 1.0f);
-    else if (seq->type == ANIM_CTRL_SEQUENCE_BLENDTREE)
-        return minf(inst->blendtrees[seq->idx].progress, 1.0f);
-
-    return 0.0f;
-}
-
-void anim_ctrl_startstate(const anim_ctrl ctrl, anim_ctrl_inst inst, uint state_idx,
-                          float start_tm)
-{
-    struct anim_ctrl_state* cstate = &ctrl->states[state_idx];
-    anim_ctrl_startseq(ctrl, inst, &cstate->seq, start_tm);
-}
-
-void anim_ctrl_startseq(const anim_ctrl ctrl, anim_ctrl_inst inst,
-                        const struct anim_ctrl_sequence* seq, float start_tm)
-{
-    if (seq->type == ANIM_CTRL_SEQUENCE_CLIP)
-        anim_ctrl_startclip(ctrl, inst, seq->idx, start_tm);
-    else if (seq->type == ANIM_CTRL_SEQUENCE_BLENDTREE)
-        anim_ctrl_startblendtree(ctrl, inst, seq->idx, start_tm);
-}
-
-void anim_ctrl_startclip(const anim_ctrl ctrl, anim_ctrl_inst inst, uint clip_idx, float start_tm)
-{
-    struct anim_ctrl_clip_inst* iclip = &inst->clips[clip_idx];
-    iclip->start_tm = start_tm;
-    iclip->progress = 0.0f;
-}
-
-void anim_ctrl_startblendtree(const anim_ctrl ctrl, anim_ctrl_inst inst, uint blendtree_idx,
-                              float start_tm)
-{
-    struct anim_ctrl_blendtree_inst* ibt = &inst->blendtrees[blendtree_idx];
-    ibt->seq_a = INVALID_INDEX;
-    ibt->seq_b = INVALID_INDEX;
-    ibt->progress = 0.0f;
-
-    /* recurse for child blendtrees */
-    const struct anim_ctrl_blendtree* bt = &ctrl->blendtrees[blendtree_idx];
-    for (uint i = 0, cnt = bt->child_seq_cnt; i < cnt; i++)
-        anim_ctrl_startseq(ctrl, inst, &bt->child_seqs[i], start_tm);
-}
-
 /*************************************************************************************************/
 void anim_ctrl_debug(anim_ctrl ctrl, anim_ctrl_inst inst)
 {
@@ -1550,6 +753,8 @@ void anim_ctrl_debug(anim_ctrl ctrl, anim_ctrl_inst inst)
 
     sprintf(msg, "time: %.3f", inst->tm);
     gfx_canvas_text2dpt(msg, x, y, 0);  y += lh;
+    sprintf(msg, "evals: %u", inst->eval_cnt);
+    gfx_canvas_text2dpt(msg, x, y, 0);  y += lh;
 
     strcpy(msg, "params:");
     gfx_canvas_text2dpt(msg, x, y, 0);  y += lh;
@@ -1609,72 +814,6 @@ void anim_ctrl_debug(anim_ctrl ctrl, anim_ctrl_inst inst)
     }
 }
 
-enum anim_ctrl_paramtype anim_ctrl_get_paramtype(anim_ctrl ctrl, anim_ctrl_inst inst,
-    const char* name)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)
-        return inst->params[item->value].type;
-    return ANIM_CTRL_PARAM_UNKNOWN;
-}
-
-float anim_ctrl_get_paramf(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_FLOAT);
-        return inst->params[item->value].value.f;
-    }
-    return 0.0f;
-}
-
-void anim_ctrl_set_paramf(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, float value)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_FLOAT);
-        inst->params[item->value].value.f = value;
-    }
-}
-
-int anim_ctrl_get_paramb(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_BOOLEAN);
-        return inst->params[item->value].value.b;
-    }
-    return FALSE;
-}
-
-void anim_ctrl_set_paramb(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, int value)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_BOOLEAN);
-        inst->params[item->value].value.b = value;
-    }
-}
-
-int anim_ctrl_get_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_INT);
-        return inst->params[item->value].value.i;
-    }
-    return FALSE;
-}
-
-void anim_ctrl_set_parami(anim_ctrl ctrl, anim_ctrl_inst inst, const char* name, int value)
-{
-    struct hashtable_item* item = hashtable_fixed_find(&ctrl->param_tbl, hash_str(name));
-    if (item != NULL)   {
-        ASSERT(inst->params[item->value].type == ANIM_CTRL_PARAM_INT);
-        inst->params[item->value].value.i = value;
-    }
-}
-
 void anim_ctrl_setupclip(const anim_ctrl ctrl, const anim_ctrl_inst inst, const anim_reel reel,
                          uint clip_idx)
 {
@@ -1754,95 +893,29 @@ void anim_ctrl_unbindreel(anim_ctrl_inst inst)
 
 anim_ctrl_inst anim_ctrl_createinstance(struct allocator* alloc, const anim_ctrl ctrl)
 {
-    /* calculate bytes needed to create the whole instance data */
-    size_t bytes =
-        sizeof(struct anim_ctrl_instance_data) +
-        ctrl->param_cnt*sizeof(struct anim_ctrl_param_inst) +
-        ctrl->blendtree_cnt*sizeof(struct anim_ctrl_blendtree_inst) +
-        ctrl->clip_cnt*sizeof(struct anim_ctrl_clip_inst) +
-        ctrl->layer_cnt*sizeof(struct anim_ctrl_layer_inst) +
-        ctrl->transition_cnt*sizeof(struct anim_ctrl_transition_inst);
-
-    uint8* buff = (uint8*)A_ALIGNED_ALLOC(alloc, bytes, MID_ANIM);
-    if (buff == NULL)   {
-        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+    anim_ctrl_inst inst = anim_ctrl_allocinstance(alloc, ctrl);
+    if (inst == NULL)
         return NULL;
-    }
-    memset(buff, 0x00, bytes);
-    struct anim_ctrl_instance_data* inst = (struct anim_ctrl_instance_data*)buff;
-
-    inst->alloc = alloc;
-    inst->owner = ctrl;
-    inst->playrate = 1.0f;
-    buff += sizeof(struct anim_ctrl_instance_data);
 
     /* load animation reel */
     inst->reel_hdl = rs_load_animreel(ctrl->reel_filepath, 0);
     if (inst->reel_hdl == INVALID_HANDLE)   {
         err_printf(__FILE__, __LINE__, "Creating anim-ctrl instance failed: could not load resource"
             " '%s'", ctrl->reel_filepath);
-        A_FREE(alloc, inst);
+        anim_ctrl_freeinstance(inst);
         return NULL;
     }
 
-    if (ctrl->param_cnt > 0)    {
-        inst->params = (struct anim_ctrl_param_inst*)buff;
-        for (uint i = 0; i < ctrl->param_cnt; i++)    {
-            struct anim_ctrl_param_inst* param = &inst->params[i];
-            param->type = ctrl->params[i].type;
-            param->value.i = ctrl->params[i].value.i;
-        }
-        buff += sizeof(struct anim_ctrl_param_inst)*ctrl->param_cnt;
-    }
-
-    if (ctrl->layer_cnt > 0)    {
-        inst->layers = (struct anim_ctrl_layer_inst*)buff;
-        for (uint i = 0; i < ctrl->layer_cnt; i++)    {
-            struct anim_ctrl_layer_inst* layer = &inst->layers[i];
-            layer->state_idx = INVALID_INDEX;
-            layer->transition_idx = INVALID_INDEX;
-            switch (ctrl->layers[i].type)   {
-                case ANIM_CTRL_LAYER_OVERRIDE:
-                layer->blend_fn = anim_ctrl_layer_override;
-                break;
-                case ANIM_CTRL_LAYER_ADDITIVE:
-                layer->blend_fn = anim_ctrl_layer_additive;
-                break;
-            }
-        }
-        buff += sizeof(struct anim_ctrl_layer_inst)*ctrl->layer_cnt;
-        inst->layer_cnt = ctrl->layer_cnt;
-    }
-
-    if (ctrl->clip_cnt > 0) {
-        inst->clips = (struct anim_ctrl_clip_inst*)buff;
-        for (uint i = 0; i < ctrl->clip_cnt; i++) {
-            struct anim_ctrl_clip_inst* clip = &inst->clips[i];
-            clip->start_tm = 0.0f;
-            clip->tm = 0.0f;
-        }
-        buff += sizeof(struct anim_ctrl_clip_inst)*ctrl->clip_cnt;
-    }
-
-    if (ctrl->blendtree_cnt > 0)    {
-        inst->blendtrees = (struct anim_ctrl_blendtree_inst*)buff;
-        for (uint i = 0; i < ctrl->blendtree_cnt; i++)    {
-            struct anim_ctrl_blendtree_inst* bt = &inst->blendtrees[i];
-            bt->seq_a = INVALID_INDEX;
-            bt->seq_b = INVALID_INDEX;
-            bt->blend = 0.0f;
-        }
-        buff += sizeof(struct anim_ctrl_blendtree_inst)*ctrl->blendtree_cnt;
-    }
-
-    if (ctrl->transition_cnt > 0)   {
-        inst->transitions = (struct anim_ctrl_transition_inst*)buff;
-        for (uint i = 0; i < ctrl->transition_cnt; i++)   {
-            struct anim_ctrl_transition_inst* trans = &inst->transitions[i];
-            trans->blend = 0.0f;
-            trans->start_tm = 0.0f;
+    for (uint i = 0; i < ctrl->layer_cnt; i++)    {
+        struct anim_ctrl_layer_inst* layer = &inst->layers[i];
+        switch (ctrl->layers[i].type)   {
+            case ANIM_CTRL_LAYER_OVERRIDE:
+            layer->blend_fn = anim_ctrl_layer_override;
+            break;
+            case ANIM_CTRL_LAYER_ADDITIVE:
+            layer->blend_fn = anim_ctrl_layer_additive;
+            break;
         }
-        buff += sizeof(struct anim_ctrl_transition_inst)*ctrl->transition_cnt;
     }
 
     anim_reel reel = rs_get_animreel(inst->reel_hdl);
@@ -1864,7 +937,7 @@ void anim_ctrl_destroyinstance(anim_ctrl_inst inst)
     if (inst->reel_hdl != INVALID_HANDLE)
         rs_unload(inst->reel_hdl);
 
-    A_ALIGNED_FREE(inst->alloc, inst);
+    anim_ctrl_freeinstance(inst);
 }
 
 result_t anim_ctrl_set_reel(anim_ctrl_inst inst, reshandle_t reel_hdl)
@@ -1966,56 +1039,160 @@ reshandle_t anim_ctrl_get_reel(const anim_ctrl_inst inst)
     return inst->reel_hdl;
 }
 
-int anim_ctrl_get_curstate(anim_ctrl ctrl, anim_ctrl_inst inst, const char* layer_name, 
-    char* state, float* progress)
+/*************************************************************************************************
+ * shared sampling cache
+ */
+result_t anim_cache_init(int dev_mode)
 {
-    /* find layer */
-    for (uint i = 0; i < ctrl->layer_cnt; i++)  {
-        if (str_isequal(ctrl->layers[i].name, layer_name))  {
-            struct anim_ctrl_layer_inst* ilayer = &inst->layers[i];
-            if (ilayer->state_idx != INVALID_INDEX) {
-                uint idx = ilayer->state_idx;
-                float p = 0.0f;
-                if (ctrl->states[idx].seq.type == ANIM_CTRL_SEQUENCE_CLIP)
-                    p = inst->clips[ctrl->states[idx].seq.idx].progress;
-                else if (ctrl->states[idx].seq.type == ANIM_CTRL_SEQUENCE_BLENDTREE)
-                    p = inst->blendtrees[ctrl->states[idx].seq.idx].progress;
-
-                if (progress)
-                    *progress = p;
-
-                strcpy(state, ctrl->states[idx].name);
-
-                return TRUE;
-            }
+    memset(&g_anim_cache, 0x00, sizeof(g_anim_cache));
 
-            break;
-        }
+    if (IS_FAIL(mem_stack_create(mem_heap(), &g_anim_cache.stack_mem, ANIM_CACHE_BUFFSIZE,
+        MID_ANIM)))
+    {
+        return RET_OUTOFMEMORY;
     }
-    return FALSE;
+    mem_stack_bindalloc(&g_anim_cache.stack_mem, &g_anim_cache.alloc);
+
+    if (IS_FAIL(hashtable_open_create(mem_heap(), &g_anim_cache.table, 256, 256, MID_ANIM)))
+        return RET_OUTOFMEMORY;
+
+    if (dev_mode)
+        con_register_cmd("anim_cache", anim_console_cache, NULL, "anim_cache [1*/0] [debug]");
+
+    return RET_OK;
 }
 
-int anim_ctrl_get_curtransition(anim_ctrl ctrl, anim_ctrl_inst inst, const char* layer_name, 
-    char* state_a, char* state_b, OUT OPTIONAL float* progress)
+void anim_cache_release()
 {
-    for (uint i = 0; i < ctrl->layer_cnt; i++)  {
-        if (str_isequal(ctrl->layers[i].name, layer_name))  {
-            struct anim_ctrl_layer_inst* ilayer = &inst->layers[i];
-            if (ilayer->transition_idx != INVALID_INDEX) {
-                uint idx = ilayer->transition_idx;
-                if (progress)
-                    *progress = inst->transitions[idx].blend;
-
-                if (ctrl->transitions[idx].owner_state_idx != INVALID_INDEX)
-                    strcpy(state_a, ctrl->states[ctrl->transitions[idx].owner_state_idx].name);
-                if (ctrl->transitions[idx].target_state_idx != INVALID_INDEX)
-                    strcpy(state_b, ctrl->states[ctrl->transitions[idx].target_state_idx].name);
-
-                return TRUE;
-            }
+    if (g_anim_cache.debug)
+        hud_remove_label("anim-cache");
 
-            break;
+    hashtable_open_destroy(&g_anim_cache.table);
+    mem_stack_destroy(&g_anim_cache.stack_mem);
+    memset(&g_anim_cache, 0x00, sizeof(g_anim_cache));
+}
+
+void anim_cache_enable(int enable)
+{
+    if (g_anim_cache.enable == enable)
+        return;
+
+    g_anim_cache.enable = enable;
+    anim_cache_beginframe();
+    memset(&g_anim_cache.stats, 0x00, sizeof(struct anim_cache_stats));
+}
+
+int anim_cache_isenabled()
+{
+    return g_anim_cache.enable;
+}
+
+void anim_cache_beginframe()
+{
+    if (!g_anim_cache.enable)
+        return;
+
+    memcpy(&g_anim_cache.stats, &g_anim_cache.frame_stats, sizeof(struct anim_cache_stats));
+    memset(&g_anim_cache.frame_stats, 0x00, sizeof(struct anim_cache_stats));
+
+    hashtable_open_clear(&g_anim_cache.table);
+    mem_stack_reset(&g_anim_cache.stack_mem);
+}
+
+void anim_cache_getstats(OUT struct anim_cache_stats* stats)
+{
+    memcpy(stats, &g_anim_cache.stats, sizeof(struct anim_cache_stats));
+}
+
+void anim_cache_calcpose(struct anim_pose* poses, const anim_reel reel, uint clip_idx, float tm)
+{
+    struct anim_cache_stats* stats = &g_anim_cache.frame_stats;
+    const struct anim_clip* clip = &reel->clips[clip_idx];
+    uint pose_cnt = reel->pose_cnt;
+
+    /* snap time to subframes, so instances with nearly identical times share the same item */
+    float qft = reel->ft / (float)ANIM_CACHE_SUBFRAMES;
+    struct anim_cache_key key;
+    memset(&key, 0x00, sizeof(key));
+    key.reel = (uptr_t)reel;
+    key.clip_idx = clip_idx;
+    key.qtm = (uint)(tm/qft + 0.5f);
+    float qtm = minf((float)key.qtm*qft, clip->duration);
+
+    uint hash = hash_murmur32(&key, sizeof(key), ANIM_CACHE_HSEED);
+    struct hashtable_item* item = hashtable_open_find(&g_anim_cache.table, hash);
+    if (item != NULL)   {
+        const struct anim_cache_item* citem = (const struct anim_cache_item*)(uptr_t)item->value;
+        if (memcmp(&citem->key, &key, sizeof(key)) == 0)    {
+            memcpy(poses, citem->poses, sizeof(struct anim_pose)*pose_cnt);
+            stats->hits ++;
+            return;
         }
     }
-    return FALSE;
+
+    stats->misses ++;
+    anim_ctrl_samplepose(poses, reel, clip_idx, qtm);
+
+    /* hash collisions are not cached, out of memory just skips caching for the rest of frame */
+    if (item != NULL)
+        return;
+
+    struct anim_cache_item* citem = (struct anim_cache_item*)A_ALLOC(&g_anim_cache.alloc,
+        sizeof(struct anim_cache_item), MID_ANIM);
+    if (citem == NULL)
+        return;
+    citem->poses = (struct anim_pose*)A_ALIGNED_ALLOC(&g_anim_cache.alloc,
+        sizeof(struct anim_pose)*pose_cnt, MID_ANIM);
+    if (citem->poses == NULL)
+        return;
+
+    memcpy(&citem->key, &key, sizeof(key));
+    memcpy(citem->poses, poses, sizeof(struct anim_pose)*pose_cnt);
+    if (IS_FAIL(hashtable_open_add(&g_anim_cache.table, hash, (uint64)(uptr_t)citem)))
+        return;
+
+    stats->item_cnt ++;
+    stats->mem_used = g_anim_cache.stack_mem.offset;
+}
+
+result_t anim_console_cache(uint argc, const char** argv, void* param)
+{
+    int enable = TRUE;
+    int debug = FALSE;
+    if (argc >= 1)
+        enable = str_tobool(argv[0]);
+    if (argc == 2)
+        debug = str_isequal_nocase(argv[1], "debug");
+    else if (argc > 2)
+        return RET_INVALIDARG;
+
+    anim_cache_enable(enable);
+
+    debug &= enable;
+    if (debug && !g_anim_cache.debug)
+        hud_add_label("anim-cache", anim_cache_debugtext, NULL);
+    else if (!debug && g_anim_cache.debug)
+        hud_remove_label("anim-cache");
+    g_anim_cache.debug = debug;
+
+    return RET_OK;
+}
+
+int anim_cache_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param)
+{
+    char text[64];
+    const struct anim_cache_stats* stats = &g_anim_cache.stats;
+    uint total = stats->hits + stats->misses;
+
+    sprintf(text, "[anim-cache] hits: %d, misses: %d (%d%%)", stats->hits, stats->misses,
+        total != 0 ? (stats->hits*100/total) : 0);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    sprintf(text, "[anim-cache] items: %d, mem: %dkb", stats->item_cnt,
+        (uint)(stats->mem_used/1024));
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    return y;
 }
@@ -148,7 +148,7 @@ result_t cmp_anim_modify(struct cmp_obj* obj, struct allocator* alloc, struct al
     result_t r;
     struct cmp_anim* a = (struct cmp_anim*)data;
 
-    uint filehash = hash_str(a->filepath);
+    uint filehash = rs_get_pathid(a->filepath);
     int reload = (a->filepathhash == filehash);
     cmp_anim_destroydata(obj, a, cur_hdl, !reload);
     a->filepathhash = filehash;
@@ -157,8 +157,11 @@ result_t cmp_anim_modify(struct cmp_obj* obj, struct allocator* alloc, struct al
     if (str_isempty(a->filepath))
         return RET_OK;
 
-    if (!reload)
-        a->clip_hdl = rs_load_animreel(a->filepath, 0);
+    if (!reload)    {
+        a->clip_hdl = rs_addref_byid(filehash, RS_RESOURCE_ANIMREEL);
+        if (a->clip_hdl == INVALID_HANDLE)
+            a->clip_hdl = rs_load_animreel(a->filepath, 0);
+    }
 
     if (a->clip_hdl == INVALID_HANDLE)
         return RET_FAIL;
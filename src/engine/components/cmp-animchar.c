@@ -96,6 +96,8 @@ void cmp_animchar_update(cmp_t c, float dt, void* param)
 
     struct allocator* tmp_alloc = tsk_get_tmpalloc(0);
 
+    anim_cache_beginframe();
+
     const struct cmp_instance_desc** updates = cmp_get_updateinstances(c, &cnt);
     for (uint i = 0; i < cnt; i++)    {
         const struct cmp_instance_desc* inst = updates[i];
@@ -127,7 +129,7 @@ result_t cmp_animchar_modify(struct cmp_obj* obj, struct allocator* alloc,
     result_t r;
     struct cmp_animchar* ch = (struct cmp_animchar*)data;
 
-    uint filehash = hash_str(ch->filepath);
+    uint filehash = rs_get_pathid(ch->filepath);
     int reload = (ch->filepathhash == filehash);
     cmp_animchar_destroydata(obj, ch, hdl, !reload);
     ch->filepathhash = filehash;
@@ -136,8 +138,11 @@ result_t cmp_animchar_modify(struct cmp_obj* obj, struct allocator* alloc,
     if (str_isempty(ch->filepath))
         return RET_OK;
 
-    if (!reload)
-        ch->ctrl_hdl = rs_load_animctrl(ch->filepath, 0);
+    if (!reload)    {
+        ch->ctrl_hdl = rs_addref_byid(filehash, RS_RESOURCE_ANIMCTRL);
+        if (ch->ctrl_hdl == INVALID_HANDLE)
+            ch->ctrl_hdl = rs_load_animctrl(ch->filepath, 0);
+    }
 
     if (ch->ctrl_hdl == INVALID_HANDLE)
         return RET_FAIL;
@@ -39,6 +39,12 @@ void cmp_light_debug(struct cmp_obj* obj, void* data, cmphandle_t cur_hdl, float
 void light_calcspotbounds(struct sphere* s, struct cmp_light* light);
 void light_calcpointbounds(struct sphere* s, struct cmp_light* light);
 
+/*************************************************************************************************
+ * globals
+ */
+/* versions are global, so a light that reuses a destroyed light's handle never matches its data */
+static uint g_light_version = 0;
+
 /*************************************************************************************************/
 result_t cmp_light_register(struct allocator* alloc)
 {
@@ -67,6 +73,7 @@ result_t cmp_light_modifytype(struct cmp_obj* obj, struct allocator* alloc,
 	cmp_light_calcbounds(obj, l);
 	ASSERT(obj->bounds_cmp != INVALID_HANDLE);
 	cmp_updateinstance(obj->bounds_cmp);
+	l->version = ++g_light_version;
 	return RET_OK;
 }
 
@@ -75,6 +82,15 @@ result_t cmp_light_modifycolor(struct cmp_obj* obj, struct allocator* alloc,
 {
 	struct cmp_light* l = (struct cmp_light*)data;
 	color_tolinear(&l->color_lin, &l->color);
+	l->version = ++g_light_version;
+	return RET_OK;
+}
+
+result_t cmp_light_modifyintensity(struct cmp_obj* obj, struct allocator* alloc,
+	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl)
+{
+	struct cmp_light* l = (struct cmp_light*)data;
+	l->version = ++g_light_version;
 	return RET_OK;
 }
 
@@ -89,6 +105,7 @@ result_t cmp_light_modifyatten(struct cmp_obj* obj, struct allocator* alloc,
 
 	cmp_light_calcbounds(obj, l);
 	cmp_updateinstance(cur_hdl);
+	l->version = ++g_light_version;
 	return RET_OK;
 }
 
@@ -109,6 +126,7 @@ result_t cmp_light_create(struct cmp_obj* host_obj, void* data, cmphandle_t hdl)
     strcpy(l->lod_scheme_name, "default");
     l->scheme_id = lod_findmodelscheme(l->lod_scheme_name);
     ASSERT(l->scheme_id != 0);
+    l->version = ++g_light_version;
 
 	return RET_OK;
 }
@@ -132,6 +150,7 @@ void cmp_light_update(cmp_t c, float dt, void* param)
 		mat3_get_zaxis(&l->dir, &xf->ws_mat);
 		mat3_get_trans(&l->pos, &xf->ws_mat);
         vec3_norm(&l->dir, &l->dir);
+        l->version = ++g_light_version;
 	}
 }
 
@@ -207,7 +207,7 @@ result_t cmp_model_modify(struct cmp_obj* obj, struct allocator* alloc,
 	    struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl)
 {
 	struct cmp_model* m = (struct cmp_model*)data;
-	uint filehash = hash_str(m->filepath);
+	uint filehash = rs_get_pathid(m->filepath);
 	int reload = (m->filepath_hash == filehash);
     m->filepath_hash = filehash;
 
@@ -221,8 +221,11 @@ result_t cmp_model_modify(struct cmp_obj* obj, struct allocator* alloc,
 		return RET_OK;
     }
 
-    if (!reload)
-	    m->model_hdl = rs_load_model(m->filepath, 0);
+    if (!reload)    {
+        m->model_hdl = rs_addref_byid(filehash, RS_RESOURCE_MODEL);
+        if (m->model_hdl == INVALID_HANDLE)
+	        m->model_hdl = rs_load_model(m->filepath, 0);
+    }
 
 	if (m->model_hdl == INVALID_HANDLE)
 		return RET_FAIL;
@@ -88,7 +88,7 @@ result_t cmp_rbody_modifyfile(struct cmp_obj* obj, struct allocator* alloc,
     struct allocator* tmp_alloc, void* data, cmphandle_t cur_hdl)
 {
     struct cmp_rbody* rb = (struct cmp_rbody*)data;
-    uint filehash = hash_str(rb->filepath);
+    uint filehash = rs_get_pathid(rb->filepath);
     int reload = (rb->filepath_hash == filehash);
     rb->filepath_hash = filehash;
 
@@ -98,8 +98,11 @@ result_t cmp_rbody_modifyfile(struct cmp_obj* obj, struct allocator* alloc,
     if (str_isempty(rb->filepath))
         return RET_OK;
 
-    if (!reload)
-        rb->prefab_hdl = rs_load_phxprefab(rb->filepath, 0);
+    if (!reload)    {
+        rb->prefab_hdl = rs_addref_byid(filehash, RS_RESOURCE_PHXPREFAB);
+        if (rb->prefab_hdl == INVALID_HANDLE)
+            rb->prefab_hdl = rs_load_phxprefab(rb->filepath, 0);
+    }
 
     if (rb->prefab_hdl == INVALID_HANDLE)
         return RET_FAIL;
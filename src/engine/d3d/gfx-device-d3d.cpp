@@ -1559,6 +1559,11 @@ void gfx_delayed_waitforobjects(uint thread_id)
 {
 }
 
+int gfx_delayed_haspending(uint thread_id)
+{
+    return FALSE;
+}
+
 void gfx_delayed_fillobjects(uint thread_id)
 {
 }
@@ -1567,8 +1572,20 @@ void gfx_delayed_release()
 {
 }
 
-void gfx_delayed_finalizeobjects()
+int gfx_delayed_finalizeobjects()
+{
+    return TRUE;
+}
+
+/* GL only: d3d11 device is free-threaded, loaders create objects directly and nothing is delayed,
+ * so there is no per-frame creation to budget */
+void gfx_delayed_setbudget(uint bytes_max, uint objs_max)
+{
+}
+
+void gfx_delayed_getstats(struct gfx_delayed_stats* stats)
 {
+    memset(stats, 0x00, sizeof(struct gfx_delayed_stats));
 }
 
 const char* gfx_get_driverstr()
@@ -727,6 +727,13 @@ void hud_add_image(const char* alias, gfx_texture img_tex, int fullscreen,
     }
 }
 
+void hud_set_image(const char* alias, gfx_texture img_tex)
+{
+    struct linked_list* node = find_image(hash_str(alias));
+    if (node != NULL)
+        ((struct debug_image_item*)node->data)->img_tex = img_tex;
+}
+
 void hud_remove_image(const char* alias)
 {
     struct linked_list* node = find_image(hash_str(alias));
@@ -751,7 +758,7 @@ void hud_render_images(gfx_cmdqueue cmdqueue)
         struct linked_list* node = g_hud.imgs;
         while (node != NULL)	{
             struct debug_image_item* item = (struct debug_image_item*)node->data;
-            if (item->fullscreen)   {
+            if (item->fullscreen && item->img_tex != NULL)   {
                 gfx_canvas_bmp2d(item->img_tex,
                     item->img_tex->desc.tex.width, item->img_tex->desc.tex.height,
                     rect2di_seti(&rc, 0, 0, width, height), 0);
@@ -771,7 +778,7 @@ void hud_render_images(gfx_cmdqueue cmdqueue)
         while (node != NULL)	{
             struct debug_image_item* item = (struct debug_image_item*)node->data;
 
-            if (item->fullscreen)   {
+            if (item->fullscreen || item->img_tex == NULL)   {
                 node = node->next;
                 continue;
             }
@@ -21,7 +21,6 @@
 #include "dhcore/core.h"
 #include "dhcore/timer.h"
 #include "dhcore/json.h"
-#include "dhcore/pak-file.h"
 #include "dhcore/freelist-alloc.h"
 #include "dhcore/task-mgr.h"
 #include "dhcore/hwinfo.h"
@@ -44,7 +43,10 @@
 #include "lod-scheme.h"
 #include "phx.h"
 #include "world-mgr.h"
+#include "anim.h"
 #include "gfx-device.h"
+#include "file-map.h"
+#include "pak-archive.h"
 
 #define GRAPH_WIDTH 250
 #define GRAPH_HEIGHT 100
@@ -58,7 +60,7 @@
  */
 struct engine
 {
-    struct pak_file data_pak;   /* only loaded in release mode */
+    struct pak_archive data_pak;   /* only loaded in release mode */
     char share_dir[DH_PATH_MAX];
 
     struct init_params params;
@@ -68,6 +70,8 @@ struct engine
     int init;
     struct hwinfo hwinfo;
     size_t tmp_sz;  /* temp memory size (for each thread we have one) */
+    uint thread_cnt;    /* task-mgr thread count */
+    uint load_thread_cnt;   /* first N task threads are reserved for background loading */
 
     struct allocator data_alloc;
     struct freelist_alloc data_freelist;
@@ -246,7 +250,7 @@ result_t eng_init(const struct init_params* params)
         char data_path_ext[DH_PATH_MAX];
         path_getfileext(data_path_ext, params->data_path);
         if (str_isequal_nocase(data_path_ext, "pak"))    {
-            if (IS_FAIL(pak_open(&g_eng->data_pak, mem_heap(), params->data_path, 0)))    {
+            if (IS_FAIL(pak_archive_open(&g_eng->data_pak, mem_heap(), params->data_path)))    {
                 err_print(__FILE__, __LINE__, "engine init: could not open data pak");
                 return RET_FAIL;
             }
@@ -256,6 +260,7 @@ result_t eng_init(const struct init_params* params)
                 return RET_FAIL;
             }
             fio_addvdir(params->data_path, FALSE);
+            fmap_adddir(params->data_path);
         }
         /* assume that share directory is same as data dir */
         path_getdir(g_eng->share_dir, params->data_path);
@@ -276,6 +281,7 @@ result_t eng_init(const struct init_params* params)
         }
 
         fio_addvdir(data_path, FALSE);  /* set default (config.h configured on build) data dir */
+        fmap_adddir(data_path);
         strcpy(g_eng->share_dir, share_dir);
     }
 
@@ -289,6 +295,7 @@ result_t eng_init(const struct init_params* params)
     /* task manager */
     uint thread_cnt = maxui(g_eng->hwinfo.cpu_core_cnt - 1, 1);
     r = tsk_initmgr(thread_cnt, 0, tmp_sz, 0);
+    g_eng->thread_cnt = thread_cnt;
     if (IS_FAIL(r)) {
         err_print(__FILE__, __LINE__, "engine init failed: could not init task-mgr");
         return RET_FAIL;
@@ -296,8 +303,11 @@ result_t eng_init(const struct init_params* params)
     struct allocator* tmp_alloc = tsk_get_tmpalloc(0);
     A_SAVE(tmp_alloc);
 
-    /* resource manager (with only 1 thread for multi-thread loading) */
-    r = rs_initmgr(rs_flags, 1);
+    /* resource manager, background loaders run on the first N task threads */
+    uint load_thread_cnt = params->load_threads_max != 0 ?
+        params->load_threads_max : maxui(thread_cnt/2, 1);
+    g_eng->load_thread_cnt = minui(load_thread_cnt, thread_cnt);
+    r = rs_initmgr(rs_flags, g_eng->load_thread_cnt);
     if (IS_FAIL(r)) {
         err_print(__FILE__, __LINE__, "engine init failed: could not init res-mgr");
         return RET_FAIL;
@@ -335,6 +345,13 @@ result_t eng_init(const struct init_params* params)
     }
     cmp_set_globalalloc(&g_eng->data_alloc, tsk_get_tmpalloc(0));
 
+    /* shared animation sampling cache */
+    r = anim_cache_init(BIT_CHECK(params->flags, ENG_FLAG_DEV));
+    if (IS_FAIL(r)) {
+        err_print(__FILE__, __LINE__, "engine init failed: could not init anim-cache");
+        return RET_FAIL;
+    }
+
     /* world manager */
     r = wld_initmgr();
     if (IS_FAIL(r)) {
@@ -416,12 +433,14 @@ void eng_release()
 
     lod_releasemgr();
 #if !defined(_DEBUG_)
-    pak_close(&g_eng->data_pak);
+    pak_archive_close(&g_eng->data_pak);
 #endif
+    fmap_cleardirs();
 	prf_releasemgr();
     sct_release();
     wld_releasemgr();
     scn_releasemgr();
+    anim_cache_release();
     cmp_releasemgr();
     phx_release();
     hud_release();
@@ -557,6 +576,21 @@ const struct init_params* eng_get_params()
 	return &g_eng->params;
 }
 
+uint eng_get_jobthreads(OUT int* thread_idxs, uint max_cnt)
+{
+    /* threads that are not owned by background loaders, so per-frame jobs never wait on loads */
+    uint cnt = 0;
+    for (uint i = g_eng->load_thread_cnt; i < g_eng->thread_cnt && cnt < max_cnt; i++)
+        thread_idxs[cnt++] = (int)i;
+    return cnt;
+}
+
+/* task-mgr thread count, thread ids of task threads are 1..N (main thread is 0) */
+uint eng_get_threadcnt()
+{
+    return g_eng->thread_cnt;
+}
+
 struct allocator* eng_get_lsralloc()
 {
     return &g_eng->lsr_alloc;
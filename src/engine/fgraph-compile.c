@@ -0,0 +1,243 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include "dhcore/core.h"
+#include "dhcore/str.h"
+
+#include "fgraph-compile.h"
+
+INLINE int fg_desc_isequal(const struct gfx_fg_texdesc* d1, const struct gfx_fg_texdesc* d2)
+{
+    return d1->width == d2->width && d1->height == d2->height && d1->fmt == d2->fmt;
+}
+
+/*************************************************************************************************/
+void gfx_fg_reset(struct gfx_fgraph* fg)
+{
+    fg->pass_cnt = 0;
+    fg->res_cnt = 0;
+    fg->overflow = FALSE;
+    fg->compiled = FALSE;
+    fg->frame ++;
+}
+
+INLINE struct fg_resource* fg_addres(struct gfx_fgraph* fg, const char* name, uint* pidx)
+{
+    if (fg->res_cnt == GFX_FG_RESOURCES_MAX)  {
+        fg->overflow = TRUE;
+        *pidx = INVALID_INDEX;
+        return NULL;
+    }
+
+    *pidx = fg->res_cnt;
+    struct fg_resource* r = &fg->resources[fg->res_cnt++];
+    memset(r, 0x00, sizeof(struct fg_resource));
+    str_safecpy(r->name, sizeof(r->name), name);
+    r->first_pass = -1;
+    r->last_pass = -1;
+    r->pool_idx = INVALID_INDEX;
+    return r;
+}
+
+uint gfx_fg_import(struct gfx_fgraph* fg, const char* name, OPTIONAL gfx_texture tex,
+    OPTIONAL gfx_rendertarget rt)
+{
+    uint idx;
+    struct fg_resource* r = fg_addres(fg, name, &idx);
+    if (r != NULL)  {
+        r->flags = FG_RES_IMPORTED;
+        r->tex = tex;
+        r->rt = rt;
+    }
+    return idx;
+}
+
+uint gfx_fg_transient(struct gfx_fgraph* fg, const char* name,
+    const struct gfx_fg_texdesc* desc)
+{
+    uint idx;
+    struct fg_resource* r = fg_addres(fg, name, &idx);
+    if (r != NULL)
+        memcpy(&r->desc, desc, sizeof(struct gfx_fg_texdesc));
+    return idx;
+}
+
+uint gfx_fg_findres(struct gfx_fgraph* fg, const char* name)
+{
+    for (uint i = 0; i < fg->res_cnt; i++)    {
+        if (str_isequal(fg->resources[i].name, name))
+            return i;
+    }
+    return INVALID_INDEX;
+}
+
+void gfx_fg_setoutput(struct gfx_fgraph* fg, uint res)
+{
+    if (res != INVALID_INDEX)
+        BIT_ADD(fg->resources[res].flags, FG_RES_OUTPUT);
+}
+
+uint gfx_fg_addpass(struct gfx_fgraph* fg, const char* name, uint flags, pfn_gfx_fg_exec exec_fn,
+    void* param)
+{
+    if (fg->pass_cnt == GFX_FG_PASSES_MAX)    {
+        fg->overflow = TRUE;
+        return INVALID_INDEX;
+    }
+
+    uint idx = fg->pass_cnt++;
+    struct fg_pass* p = &fg->passes[idx];
+    memset(p, 0x00, sizeof(struct fg_pass));
+    str_safecpy(p->name, sizeof(p->name), name);
+    p->flags = flags;
+    p->exec_fn = exec_fn;
+    p->param = param;
+    return idx;
+}
+
+void gfx_fg_read(struct gfx_fgraph* fg, uint pass, uint res)
+{
+    if (pass == INVALID_INDEX || res == INVALID_INDEX)
+        return;
+
+    struct fg_pass* p = &fg->passes[pass];
+    if (p->read_cnt == GFX_FG_PASS_IOMAX)   {
+        fg->overflow = TRUE;
+        return;
+    }
+    p->reads[p->read_cnt++] = res;
+}
+
+void gfx_fg_write(struct gfx_fgraph* fg, uint pass, uint res)
+{
+    if (pass == INVALID_INDEX || res == INVALID_INDEX)
+        return;
+
+    struct fg_pass* p = &fg->passes[pass];
+    if (p->write_cnt == GFX_FG_PASS_IOMAX)  {
+        fg->overflow = TRUE;
+        return;
+    }
+    p->writes[p->write_cnt++] = res;
+}
+
+INLINE void fg_extendlife(struct fg_resource* r, int pass_idx)
+{
+    if (r->first_pass == -1)
+        r->first_pass = pass_idx;
+    r->last_pass = pass_idx;
+}
+
+/* picks a physical target for transient from it's first to last pass
+ * free targets with the same description are reused, otherwise a new one is added to the pool */
+INLINE uint fg_assign_target(struct gfx_fgraph* fg, struct fg_resource* r)
+{
+    for (uint i = 0; i < fg->pool_cnt; i++)   {
+        struct fg_target* t = &fg->pool[i];
+        if (t->busy_until < r->first_pass && fg_desc_isequal(&t->desc, &r->desc)) {
+            t->busy_until = r->last_pass;
+            t->used_frame = fg->frame;
+            return i;
+        }
+    }
+
+    if (fg->pool_cnt == GFX_FG_POOL_MAX)
+        return INVALID_INDEX;
+
+    struct fg_target* t = &fg->pool[fg->pool_cnt];
+    memset(t, 0x00, sizeof(struct fg_target));
+    memcpy(&t->desc, &r->desc, sizeof(struct gfx_fg_texdesc));
+    t->busy_until = r->last_pass;
+    t->used_frame = fg->frame;
+    return fg->pool_cnt++;
+}
+
+result_t gfx_fg_compile(struct gfx_fgraph* fg)
+{
+    if (fg->overflow)   {
+        err_print(__FILE__, __LINE__, "frame-graph compile failed: too many passes/resources");
+        return RET_FAIL;
+    }
+
+    /* culling: walk backwards, a pass lives if it can't be culled or writes a resource that is
+     * needed later (graph outputs or reads of living passes), then it's reads become needed */
+    int needed[GFX_FG_RESOURCES_MAX];
+    for (uint i = 0; i < fg->res_cnt; i++)
+        needed[i] = BIT_CHECK(fg->resources[i].flags, FG_RES_OUTPUT);
+
+    for (int i = (int)fg->pass_cnt - 1; i >= 0; i--)  {
+        struct fg_pass* p = &fg->passes[i];
+        int alive = BIT_CHECK(p->flags, GFX_FG_PASS_NOCULL);
+        for (uint k = 0; k < p->write_cnt && !alive; k++)
+            alive = needed[p->writes[k]];
+
+        p->culled = !alive;
+        if (alive)  {
+            for (uint k = 0; k < p->read_cnt; k++)
+                needed[p->reads[k]] = TRUE;
+        }
+    }
+
+    /* lifetimes, in declaration order of living passes */
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        struct fg_pass* p = &fg->passes[i];
+        if (p->culled)
+            continue;
+        for (uint k = 0; k < p->read_cnt; k++)
+            fg_extendlife(&fg->resources[p->reads[k]], (int)i);
+        for (uint k = 0; k < p->write_cnt; k++)
+            fg_extendlife(&fg->resources[p->writes[k]], (int)i);
+    }
+
+    /* outputs are kept to the end of the frame */
+    for (uint i = 0; i < fg->res_cnt; i++)    {
+        struct fg_resource* r = &fg->resources[i];
+        if (BIT_CHECK(r->flags, FG_RES_OUTPUT) && r->first_pass != -1)
+            r->last_pass = (int)fg->pass_cnt;
+    }
+
+    /* aliasing: assign transients to physical targets in the order they become alive
+     * (targets that are destroyed or never created are removed from the pool first) */
+    uint cnt = 0;
+    for (uint i = 0; i < fg->pool_cnt; i++)   {
+        if (fg->pool[i].tex != NULL)    {
+            memcpy(&fg->pool[cnt], &fg->pool[i], sizeof(struct fg_target));
+            fg->pool[cnt++].busy_until = -1;
+        }
+    }
+    fg->pool_cnt = cnt;
+
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        for (uint k = 0; k < fg->res_cnt; k++)    {
+            struct fg_resource* r = &fg->resources[k];
+            if (BIT_CHECK(r->flags, FG_RES_IMPORTED) || r->first_pass != (int)i)
+                continue;
+
+            r->pool_idx = fg_assign_target(fg, r);
+            if (r->pool_idx == INVALID_INDEX)   {
+                err_printf(__FILE__, __LINE__, "frame-graph compile failed: no target for '%s'",
+                    r->name);
+                return RET_FAIL;
+            }
+        }
+    }
+
+    fg->compiled = TRUE;
+    return RET_OK;
+}
+
+int gfx_fg_isculled(struct gfx_fgraph* fg, uint pass)
+{
+    return pass == INVALID_INDEX || fg->passes[pass].culled;
+}
@@ -0,0 +1,139 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+
+#if defined(_WIN_)
+#include "dhcore/win.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "file-map.h"
+
+/* directories are only modified at init, mapping happens in loader threads */
+static char g_fmap_dirs[FMAP_DIRS_MAX][DH_PATH_MAX];
+static uint g_fmap_dir_cnt = 0;
+
+void fmap_adddir(const char* dir)
+{
+    if (g_fmap_dir_cnt == FMAP_DIRS_MAX)
+        return;
+    str_safecpy(g_fmap_dirs[g_fmap_dir_cnt], DH_PATH_MAX, dir);
+    g_fmap_dir_cnt ++;
+}
+
+void fmap_cleardirs()
+{
+    g_fmap_dir_cnt = 0;
+}
+
+#if defined(_WIN_)
+static int fmap_openpath(struct file_map* m, const char* filepath)
+{
+    HANDLE file = CreateFile(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)  {
+        CloseHandle(file);
+        return FALSE;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)    {
+        CloseHandle(file);
+        return FALSE;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)   {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return FALSE;
+    }
+
+    m->data = data;
+    m->size = (size_t)size.QuadPart;
+    m->file = (uptr_t)file;
+    m->mapping = (uptr_t)mapping;
+    return TRUE;
+}
+
+void fmap_close(struct file_map* m)
+{
+    if (m->data != NULL)    {
+        UnmapViewOfFile(m->data);
+        CloseHandle((HANDLE)m->mapping);
+        CloseHandle((HANDLE)m->file);
+    }
+    memset(m, 0x00, sizeof(struct file_map));
+}
+#else
+static int fmap_openpath(struct file_map* m, const char* filepath)
+{
+    int fd = open(filepath, O_RDONLY);
+    if (fd == -1)
+        return FALSE;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)  {
+        close(fd);
+        return FALSE;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return FALSE;
+    }
+    /* files are parsed front to back once */
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m->data = data;
+    m->size = (size_t)st.st_size;
+    m->file = (uptr_t)fd;
+    m->mapping = 0;
+    return TRUE;
+}
+
+void fmap_close(struct file_map* m)
+{
+    if (m->data != NULL)    {
+        munmap((void*)m->data, m->size);
+        close((int)m->file);
+    }
+    memset(m, 0x00, sizeof(struct file_map));
+}
+#endif
+
+int fmap_open(struct file_map* m, const char* filepath)
+{
+    memset(m, 0x00, sizeof(struct file_map));
+
+    /* search data directories first, like file-io does for virtual directories */
+    char fullpath[DH_PATH_MAX];
+    for (uint i = 0; i < g_fmap_dir_cnt; i++) {
+        path_join(fullpath, g_fmap_dirs[i], filepath, NULL);
+        if (fmap_openpath(m, fullpath))
+            return TRUE;
+    }
+    return fmap_openpath(m, filepath);
+}
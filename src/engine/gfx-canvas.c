@@ -19,6 +19,8 @@
 #include "dhcore/vec-math.h"
 #include "dhcore/queue.h"
 #include "dhcore/pool-alloc.h"
+#include "dhcore/array.h"
+#include "dhcore/hash.h"
 #include "gfx-shader.h"
 #include "gfx-device.h"
 #include "gfx-cmdqueue.h"
@@ -36,6 +38,13 @@
 #define QUESTION_MARK_ID            63
 #define SPACE_ID                    32
 #define QUAD_COUNT                  5000
+#define LINE3D_BATCH_MAX            500     /* generic buffer holds 1000 vertices */
+#define CMDBUF_POOLSIZE             50      /* initial pool size of task thread buffers */
+#define GLYPHCACHE_SETS             64      /* must be power of two */
+#define GLYPHCACHE_WAYS             4       /* runs in each set, least recently used is replaced */
+#define GLYPHCACHE_SLOTS            (GLYPHCACHE_SETS*GLYPHCACHE_WAYS)
+#define GLYPHCACHE_FRAMES           120     /* runs unused for this many frames are evicted */
+#define GLYPHCACHE_HSEED            7621
 
 /*************************************************************************************************
  * types
@@ -98,6 +107,8 @@ struct canvas_item2d
     fonthandle_t font;
     struct rect2di clip_rc;
     int clip_enable;
+    struct canvas_item2d* next; /* recording order in owner command buffer */
+    struct pool_alloc* pool;    /* owner pool */
 
     union   {
         char text[256];
@@ -107,6 +118,51 @@ struct canvas_item2d
     };
 };
 
+/* crop bounds of each glyph, relative to pen origin */
+struct canvas_glyphcrop
+{
+    float right;    /* pen position after advance, checked against right bound */
+    float left;     /* rtl: pen position of next glyph, checked against left bound */
+};
+
+/* cached text layout: glyph quads are built relative to pen origin and without color
+ * key: (font, flags, text), source text is kept to resolve hash collisions */
+struct canvas_glyphrun
+{
+    uint hash;
+    fonthandle_t font;
+    const struct gfx_font* fontp;
+    uint flags;     /* layout flags (GFX_TEXT_UNICODE, GFX_TEXT_RTL) */
+    uint text_sz;   /* bytes */
+    uint glyph_cnt;
+    uint last_frame;
+    float text_width;
+    float firstchar_width;
+    struct canvas_vertex2d* verts;  /* count = glyph_cnt*4 */
+    struct canvas_glyphcrop* crops; /* count = glyph_cnt */
+    void* text;
+};
+
+struct canvas_line3d
+{
+    struct vec4f p0;
+    struct vec4f p1;
+    struct color c;
+};
+
+/* per-thread recording buffer, only the owner thread writes to it
+ * 2d items are chained in submission order and batched on render2d, item pool is reset by the
+ * owner thread on it's first record after render2d, so items never go back to another thread */
+struct canvas_cmdbuf
+{
+    int init;
+    uint record_frame;  /* g_cvs.record_frame of recorded items */
+    struct pool_alloc item_pool;    /* canvas_item2d */
+    struct canvas_item2d* first;
+    struct canvas_item2d* last;
+    struct array lines3d;   /* canvas_line3d, drawn on end3d */
+};
+
 struct shapes3d
 {
 	/* vertex buffers */
@@ -155,8 +211,13 @@ struct canvas
 {
     struct queue* items2d; /* canvas_item2d.q_node */
     struct canvas_item2d* last_item2d;
-    struct pool_alloc item_pool;    /* canvas_item2d */
+    struct canvas_cmdbuf* cmdbufs; /* index: thread_id, 0 = main (count = cmdbuf_cnt) */
+    uint cmdbuf_cnt;
+    uint record_frame;  /* increments when render2d is done with recorded items */
     struct buffers2d buffers2d;
+    struct canvas_glyphrun* glyph_runs[GLYPHCACHE_SLOTS];   /* set-associative, ways of each set
+                                                               are next to each other */
+    uint frame_id;
     uint shader2d_id;
     fonthandle_t font_hdl;
     fonthandle_t def_font_hdl;
@@ -241,6 +302,17 @@ const struct vec2f* canvas_get_alignpos(struct vec2f* r, const struct gfx_font*
     float text_width, float firstchar_width, const struct vec2i* p0, const struct vec2i* p1,
     uint flags);
 void canvas_put_into_renderlist(struct canvas_item2d* item);
+result_t canvas_init_cmdbuf(struct canvas_cmdbuf* buf, uint pool_size);
+void canvas_release_cmdbuf(struct canvas_cmdbuf* buf);
+struct canvas_cmdbuf* canvas_get_cmdbuf(uint thread_id);
+struct canvas_item2d* canvas_alloc_item(struct canvas_cmdbuf* buf);
+void canvas_record(struct canvas_cmdbuf* buf, struct canvas_item2d* item);
+void canvas_merge_cmdbufs();
+const struct canvas_glyphrun* canvas_get_glyphrun(const struct canvas_item2d* item);
+struct canvas_glyphrun* canvas_build_glyphrun(const struct canvas_item2d* item, uint text_len,
+    uint text_sz, uint hash, uint flags);
+void canvas_evict_glyphruns(int all);
+void canvas_flush_lines3d();
 int canvas_require_batch(const struct canvas_item2d* item1, const struct canvas_item2d* item2);
 
 int canvas_stream_text(struct canvas_vertex2d* verts, uint quad_cnt,
@@ -290,9 +362,15 @@ result_t gfx_canvas_init()
 
     log_print(LOG_INFO, "init gfx-canvas ...");
 
-    /* memory pool for items */
-    r = mem_pool_create(mem_heap(), &g_cvs.item_pool, sizeof(struct canvas_item2d), 200,
-    		MID_GFX);
+    /* command buffers: main thread + task threads, task threads create theirs on first use */
+    g_cvs.cmdbuf_cnt = eng_get_threadcnt() + 1;
+    g_cvs.cmdbufs = (struct canvas_cmdbuf*)ALLOC(sizeof(struct canvas_cmdbuf)*g_cvs.cmdbuf_cnt,
+        MID_GFX);
+    if (g_cvs.cmdbufs == NULL)
+        return RET_OUTOFMEMORY;
+    memset(g_cvs.cmdbufs, 0x00, sizeof(struct canvas_cmdbuf)*g_cvs.cmdbuf_cnt);
+
+    r = canvas_init_cmdbuf(&g_cvs.cmdbufs[0], 200);
     if (IS_FAIL(r))
         return r;
 
@@ -659,16 +737,19 @@ void gfx_canvas_release()
     if (g_cvs.bounds_tex != INVALID_HANDLE)
         rs_unload(g_cvs.bounds_tex);
 
-    mem_pool_destroy(&g_cvs.item_pool);
+    if (g_cvs.cmdbufs != NULL)  {
+        for (uint i = 0; i < g_cvs.cmdbuf_cnt; i++)
+            canvas_release_cmdbuf(&g_cvs.cmdbufs[i]);
+        FREE(g_cvs.cmdbufs);
+    }
+    canvas_evict_glyphruns(TRUE);
     gfx_canvas_zero();
 }
 
 void gfx_canvas_text2dpt(const void* text, int x, int y, uint flags)
 {
     /* create a new text item */
-    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&g_cvs.item_pool);
-    ASSERT(item);
-    memset(item, 0x00, sizeof(struct canvas_item2d));
+    struct canvas_item2d* item = canvas_alloc_item(&g_cvs.cmdbufs[0]);
 
     item->type = ITEM2D_TEXT;
     item->stream_func = canvas_stream_text;
@@ -684,26 +765,24 @@ void gfx_canvas_text2dpt(const void* text, int x, int y, uint flags)
     if (BIT_CHECK(flags, GFX_TEXT_UNICODE))    {
         wcscpy(item->textw, (const wchar*)text);
         if (item->textw[0] == 0)    {
-            mem_pool_free(&g_cvs.item_pool, item);
+            mem_pool_free(item->pool, item);
             return;
         }
     }    else    {
         strcpy(item->text, (const char*)(text));
         if (item->text[0] == 0)    {
-            mem_pool_free(&g_cvs.item_pool, item);
+            mem_pool_free(item->pool, item);
             return;
         }
     }
 
-    canvas_put_into_renderlist(item);
+    canvas_record(&g_cvs.cmdbufs[0], item);
 }
 
 void gfx_canvas_text2drc(const void* text, const struct rect2di* rc, uint flags)
 {
     /* create a new text item */
-    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&g_cvs.item_pool);
-    ASSERT(item);
-    memset(item, 0x00, sizeof(struct canvas_item2d));
+    struct canvas_item2d* item = canvas_alloc_item(&g_cvs.cmdbufs[0]);
 
     item->type = ITEM2D_TEXT;
     item->stream_func = canvas_stream_text;
@@ -719,25 +798,23 @@ void gfx_canvas_text2drc(const void* text, const struct rect2di* rc, uint flags)
     if (BIT_CHECK(flags, GFX_TEXT_UNICODE))    {
         wcscpy(item->textw, (const wchar*)text);
         if (item->textw[0] == 0)    {
-            mem_pool_free(&g_cvs.item_pool, item);
+            mem_pool_free(item->pool, item);
             return;
         }
     }    else    {
         strcpy(item->text, (const char*)text);
         if (item->text[0] == 0)    {
-            mem_pool_free(&g_cvs.item_pool, item);
+            mem_pool_free(item->pool, item);
             return;
         }
     }
 
-    canvas_put_into_renderlist(item);
+    canvas_record(&g_cvs.cmdbufs[0], item);
 }
 
 void gfx_canvas_rect2d(const struct rect2di* rc, int line_width, uint flags)
 {
-    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&g_cvs.item_pool);
-    ASSERT(item);
-    memset(item, 0x00, sizeof(struct canvas_item2d));
+    struct canvas_item2d* item = canvas_alloc_item(&g_cvs.cmdbufs[0]);
 
     item->type = ITEM2D_RECT;
     if (!BIT_CHECK(flags, GFX_RECT2D_HOLLOW))    {
@@ -760,15 +837,13 @@ void gfx_canvas_rect2d(const struct rect2di* rc, int line_width, uint flags)
     item->clip_enable = g_cvs.clip_enable;
     item->clip_rc = g_cvs.clip_rc;
 
-    canvas_put_into_renderlist(item);
+    canvas_record(&g_cvs.cmdbufs[0], item);
 }
 
 void gfx_canvas_bmp2d(gfx_texture tex, uint width, uint height,
 		const struct rect2di* rc, uint flags)
 {
-    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&g_cvs.item_pool);
-    ASSERT(item);
-    memset(item, 0x00, sizeof(struct canvas_item2d));
+    struct canvas_item2d* item = canvas_alloc_item(&g_cvs.cmdbufs[0]);
 
     flags |= GFX_BMP2D_EXTRAFLAG;
 
@@ -796,14 +871,12 @@ void gfx_canvas_bmp2d(gfx_texture tex, uint width, uint height,
     item->clip_enable = g_cvs.clip_enable;
     item->clip_rc = g_cvs.clip_rc;
 
-    canvas_put_into_renderlist(item);
+    canvas_record(&g_cvs.cmdbufs[0], item);
 }
 
 void gfx_canvas_line2d(int x0, int y0, int x1, int y1, int line_width)
 {
-    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&g_cvs.item_pool);
-    ASSERT(item);
-    memset(item, 0x00, sizeof(struct canvas_item2d));
+    struct canvas_item2d* item = canvas_alloc_item(&g_cvs.cmdbufs[0]);
 
     item->type = ITEM2D_LINE;
     item->stream_func = canvas_stream_line;
@@ -816,7 +889,7 @@ void gfx_canvas_line2d(int x0, int y0, int x1, int y1, int line_width)
     item->clip_enable = g_cvs.clip_enable;
     item->clip_rc = g_cvs.clip_rc;
 
-    canvas_put_into_renderlist(item);
+    canvas_record(&g_cvs.cmdbufs[0], item);
 }
 
 int canvas_require_batch(const struct canvas_item2d* item1, const struct canvas_item2d* item2)
@@ -862,10 +935,98 @@ void canvas_put_into_renderlist(struct canvas_item2d* item)
     }
 }
 
+result_t canvas_init_cmdbuf(struct canvas_cmdbuf* buf, uint pool_size)
+{
+    result_t r = mem_pool_create(mem_heap(), &buf->item_pool, sizeof(struct canvas_item2d),
+        pool_size, MID_GFX);
+    if (IS_FAIL(r))
+        return r;
+
+    r = arr_create(mem_heap(), &buf->lines3d, sizeof(struct canvas_line3d), 100, 100, MID_GFX);
+    if (IS_FAIL(r)) {
+        mem_pool_destroy(&buf->item_pool);
+        return r;
+    }
+
+    buf->first = NULL;
+    buf->last = NULL;
+    buf->init = TRUE;
+    return RET_OK;
+}
+
+void canvas_release_cmdbuf(struct canvas_cmdbuf* buf)
+{
+    if (!buf->init)
+        return;
+    arr_destroy(&buf->lines3d);
+    mem_pool_destroy(&buf->item_pool);
+    memset(buf, 0x00, sizeof(struct canvas_cmdbuf));
+}
+
+struct canvas_cmdbuf* canvas_get_cmdbuf(uint thread_id)
+{
+    ASSERT(thread_id < g_cvs.cmdbuf_cnt);
+    if (thread_id >= g_cvs.cmdbuf_cnt)
+        return NULL;
+
+    /* buffer is only touched by it's owner thread, so it's safe to create it here */
+    struct canvas_cmdbuf* buf = &g_cvs.cmdbufs[thread_id];
+    if (!buf->init && IS_FAIL(canvas_init_cmdbuf(buf, CMDBUF_POOLSIZE)))
+        return NULL;
+    return buf;
+}
+
+struct canvas_item2d* canvas_alloc_item(struct canvas_cmdbuf* buf)
+{
+    /* first record after render2d: previous items are drawn, reuse the pool */
+    if (buf->record_frame != g_cvs.record_frame)    {
+        mem_pool_clear(&buf->item_pool);
+        buf->record_frame = g_cvs.record_frame;
+    }
+
+    struct canvas_item2d* item = (struct canvas_item2d*)mem_pool_alloc(&buf->item_pool);
+    ASSERT(item);
+    memset(item, 0x00, sizeof(struct canvas_item2d));
+    item->pool = &buf->item_pool;
+    return item;
+}
+
+void canvas_record(struct canvas_cmdbuf* buf, struct canvas_item2d* item)
+{
+    if (buf->last != NULL)
+        buf->last->next = item;
+    else
+        buf->first = item;
+    buf->last = item;
+}
+
+/* moves recorded items of all threads into the render list (main thread first)
+ * batching runs on the merged list, so items of different threads can share draw calls */
+void canvas_merge_cmdbufs()
+{
+    for (uint i = 0; i < g_cvs.cmdbuf_cnt; i++)   {
+        struct canvas_cmdbuf* buf = &g_cvs.cmdbufs[i];
+        struct canvas_item2d* item = buf->first;
+        while (item != NULL)    {
+            struct canvas_item2d* next = item->next;
+            canvas_put_into_renderlist(item);
+            item = next;
+        }
+        buf->first = NULL;
+        buf->last = NULL;
+    }
+}
+
 void gfx_canvas_render2d(gfx_cmdqueue cmdqueue, gfx_rendertarget rt, float rt_width, float rt_height)
 {
-    if (g_cvs.items2d == NULL)
+    g_cvs.frame_id ++;
+    canvas_evict_glyphruns(FALSE);
+
+    canvas_merge_cmdbufs();
+    if (g_cvs.items2d == NULL)  {
+        g_cvs.record_frame ++;
         return;
+    }
 
     /* global shader */
     struct gfx_shader* cv_shader = gfx_shader_get(g_cvs.shader2d_id);
@@ -982,8 +1143,7 @@ void gfx_canvas_render2d(gfx_cmdqueue cmdqueue, gfx_rendertarget rt, float rt_wi
                 quads_perdraw += written_quads;
             }
 
-            /* get next item and delete the current one */
-            mem_pool_free(&g_cvs.item_pool, cur_item);
+            /* get next item, items are released by their owner thread (see canvas_alloc_item) */
             litem = litem->next;
         } while (litem != NULL);
 
@@ -997,6 +1157,7 @@ void gfx_canvas_render2d(gfx_cmdqueue cmdqueue, gfx_rendertarget rt, float rt_wi
     }
 
     g_cvs.last_item2d = NULL;
+    g_cvs.record_frame ++;
     if (prev_clip)
     	gfx_output_setrasterstate(cmdqueue, NULL);
 }
@@ -1005,129 +1166,235 @@ void gfx_canvas_render2d(gfx_cmdqueue cmdqueue, gfx_rendertarget rt, float rt_wi
 int canvas_stream_text(struct canvas_vertex2d* verts, uint quad_cnt,
     const struct canvas_item2d* item, uint* streamed_cnt)
 {
-    static uint char_offset = 0;
+    static uint glyph_offset = 0;
     static struct vec2f pos;
     static const struct canvas_item2d* prev_item = NULL;
+    static const struct canvas_glyphrun* run = NULL;
+
+    int rect = !vec2i_isequal(&item->p0, &item->p1);
+
+    /* new text item came in, fetch it's glyph run and reset static variables */
+    if (item != prev_item)    {
+        run = canvas_get_glyphrun(item);
+        if (run == NULL)    {
+            *streamed_cnt = 0;
+            return TRUE;
+        }
+
+        glyph_offset = 0;
+        canvas_get_alignpos(&pos, gfx_font_getf(item->font),
+            rect ? run->text_width : 0.0f, rect ? run->firstchar_width : 0.0f,
+            &item->p0, &item->p1, item->flags);
+        prev_item = item;
+    }
+
+    /* Crop if we have rectangle bounds */
+    uint cnt = minui(run->glyph_cnt - glyph_offset, quad_cnt);
+    int cropped = FALSE;
+    if (rect)   {
+        const struct canvas_glyphcrop* crops = &run->crops[glyph_offset];
+        for (uint i = 0; i < cnt; i++)  {
+            if ((pos.x + crops[i].left) < item->p0.x || (pos.x + crops[i].right) > item->p1.x)  {
+                cnt = i;
+                cropped = TRUE;
+                break;
+            }
+        }
+    }
+
+    /* copy cached quads and move them to text position */
+    memcpy(verts, &run->verts[glyph_offset*4], sizeof(struct canvas_vertex2d)*4*cnt);
+    for (uint i = 0, vcnt = cnt*4; i < vcnt; i++)   {
+        verts[i].pos.x += pos.x;
+        verts[i].pos.y += pos.y;
+        color_setc(&verts[i].clr, &item->c);
+    }
 
+    glyph_offset += cnt;
+    *streamed_cnt = cnt;
+
+    /* check if all requested quads are filled, and there is still text remaining */
+    if (!cropped && glyph_offset != run->glyph_cnt)
+        return FALSE;
+
+    /* stramed the whole text
+     * reset static props */
+    glyph_offset = 0;
+    prev_item = NULL;
+
+    return TRUE;
+}
+
+INLINE uint canvas_get_charid(const void* text, int unicode, uint idx)
+{
+    return unicode ? (uint)((const wchar*)text)[idx] : (uint)((const char*)text)[idx];
+}
+
+const struct canvas_glyphrun* canvas_get_glyphrun(const struct canvas_item2d* item)
+{
+    uint flags = item->flags & (GFX_TEXT_UNICODE | GFX_TEXT_RTL);
     uint text_len;
-    uint quad_idx = 0;
-    uint vertex_idx = 0;
-    float direction = BIT_CHECK(item->flags, GFX_TEXT_RTL) ? -1.0f : 1.0f;
-    float text_width = 0;
-    float firstchar_width = 0;
-    struct color color;
-    wchar textw[256];
-    color_setc(&color, &item->c);
+    uint text_sz;
+    if (BIT_CHECK(flags, GFX_TEXT_UNICODE))  {
+        text_len = (uint)wcslen(item->textw);
+        text_sz = text_len*sizeof(wchar);
+    }   else    {
+        text_len = (uint)strlen(item->text);
+        text_sz = text_len;
+    }
 
+    struct hash_incr h;
+    hash_murmurincr_begin(&h, GLYPHCACHE_HSEED);
+    hash_murmurincr_add(&h, &item->font, sizeof(fonthandle_t));
+    hash_murmurincr_add(&h, &flags, sizeof(uint));
+    hash_murmurincr_add(&h, item->text, text_sz);
+    uint hash = hash_murmurincr_end(&h);
+
+    /* search the ways of the set, keep an empty or the least recently used slot for a miss */
+    const struct gfx_font* font = gfx_font_getf(item->font);
+    uint set_idx = hash & (GLYPHCACHE_SETS - 1);
+    struct canvas_glyphrun** set = &g_cvs.glyph_runs[set_idx*GLYPHCACHE_WAYS];
+    struct canvas_glyphrun** slot = NULL;
+    uint slot_age = 0;
+    for (uint i = 0; i < GLYPHCACHE_WAYS; i++)  {
+        struct canvas_glyphrun* run = set[i];
+        if (run == NULL)    {
+            if (slot == NULL || *slot != NULL)
+                slot = &set[i];
+            continue;
+        }
+
+        if (run->hash == hash && run->font == item->font && run->fontp == font &&
+            run->flags == flags && run->text_sz == text_sz &&
+            memcmp(run->text, item->text, text_sz) == 0)
+        {
+            run->last_frame = g_cvs.frame_id;
+            return run;
+        }
+
+        uint age = g_cvs.frame_id - run->last_frame;
+        if (slot == NULL || (*slot != NULL && age > slot_age))  {
+            slot = &set[i];
+            slot_age = age;
+        }
+    }
+
+    /* miss: build and replace */
+    struct canvas_glyphrun* run = canvas_build_glyphrun(item, text_len, text_sz, hash, flags);
+    if (run == NULL)
+        return NULL;
+    if (*slot != NULL)
+        A_ALIGNED_FREE(mem_heap(), *slot);
+    *slot = run;
+    return run;
+}
+
+struct canvas_glyphrun* canvas_build_glyphrun(const struct canvas_item2d* item, uint text_len,
+    uint text_sz, uint hash, uint flags)
+{
     const struct gfx_font* font = gfx_font_getf(item->font);
     gfx_texture texture = rs_get_texture(font->tex_hdl);
     float width = (float)(texture->desc.tex.width);
     float height = (float)(texture->desc.tex.height);
+    int unicode = BIT_CHECK(flags, GFX_TEXT_UNICODE);
+    int rtl = BIT_CHECK(flags, GFX_TEXT_RTL);
+    float direction = rtl ? -1.0f : 1.0f;
+    const void* text = item->text;
+    wchar textw[256];
 
-    /* */
-    if (!BIT_CHECK(item->flags, GFX_TEXT_UNICODE))    {
-        text_len = (uint)strlen(item->text);
-        if (!vec2i_isequal(&item->p0, &item->p1))
-            text_width = canvas_get_textwidth(font, item->text, FALSE, text_len, &firstchar_width);
-    }    else    {
-        text_len = (uint)wcslen(item->textw);
+    if (unicode)    {
         wcscpy(textw, item->textw);
         /* resolve unicode using meta rules */
         if (font->meta_rules != NULL)
             gfx_font_resolveunicode(font, item->textw, textw, text_len);
-
-        if (!vec2i_isequal(&item->p0, &item->p1))
-            text_width = canvas_get_textwidth(font, textw, TRUE, text_len, &firstchar_width);
+        text = textw;
     }
 
-    /* new text item came in, reset static variables */
-    if (item != prev_item)    {
-        char_offset = 0;
-        canvas_get_alignpos(&pos, font, text_width, firstchar_width, &item->p0, &item->p1,
-        		item->flags);
-        prev_item = item;
-    }
+    /* header, quads, crop bounds and source text in a single block */
+    size_t hdr_sz = (sizeof(struct canvas_glyphrun) + 15) & ~((size_t)15);
+    size_t verts_sz = sizeof(struct canvas_vertex2d)*4*text_len;
+    size_t crops_sz = sizeof(struct canvas_glyphcrop)*text_len;
+    uint8* buff = (uint8*)A_ALIGNED_ALLOC(mem_heap(), hdr_sz + verts_sz + crops_sz + text_sz,
+        MID_GFX);
+    if (buff == NULL)
+        return NULL;
 
-    /* stream text quads */
-    while (char_offset < text_len && quad_idx < quad_cnt)        {
-        const struct gfx_font_chardesc* ch;
+    struct canvas_glyphrun* run = (struct canvas_glyphrun*)buff;
+    memset(run, 0x00, sizeof(struct canvas_glyphrun));
+    run->hash = hash;
+    run->font = item->font;
+    run->fontp = font;
+    run->flags = flags;
+    run->text_sz = text_sz;
+    run->last_frame = g_cvs.frame_id;
+    run->verts = (struct canvas_vertex2d*)(buff + hdr_sz);
+    run->crops = (struct canvas_glyphcrop*)(buff + hdr_sz + verts_sz);
+    run->text = buff + hdr_sz + verts_sz + crops_sz;
+    memcpy(run->text, item->text, text_sz);
+
+    run->text_width = canvas_get_textwidth(font, text, unicode, text_len, &run->firstchar_width);
+
+    /* build quads, pen starts at origin */
+    float x = 0.0f;
+    uint glyph_cnt = 0;
+    for (uint i = 0; i < text_len; i++)   {
+        const struct gfx_font_chardesc* ch =
+            canvas_resolve_char(font, canvas_get_charid(text, unicode, i));
         const struct gfx_font_chardesc* next_ch = NULL;
-
-        if (!BIT_CHECK(item->flags, GFX_TEXT_UNICODE))    {
-            ch = canvas_resolve_char(font, item->text[char_offset]);
-            if (char_offset < text_len - 1)
-                next_ch = canvas_resolve_char(font, item->text[char_offset + 1]);
-        }    else    {
-            ch = canvas_resolve_char(font, textw[char_offset]);
-            if (char_offset < text_len - 1)
-                next_ch = canvas_resolve_char(font, textw[char_offset + 1]);
-        }
-
         if (ch == NULL)
             continue;
+        if (i < text_len - 1)
+            next_ch = canvas_resolve_char(font, canvas_get_charid(text, unicode, i + 1));
 
-        /* Crop if we have rectangle bounds */
-        if (!vec2i_isequal(&item->p0, &item->p1))    {
-            if ((BIT_CHECK(item->flags, GFX_TEXT_RTL) &&
-                next_ch != NULL && (pos.x - next_ch->xadvance) < item->p0.x) ||
-                ((pos.x + ch->xadvance) > item->p1.x))
-            {
-                break;
-            }
-        }
+        struct canvas_glyphcrop* crop = &run->crops[glyph_cnt];
+        crop->right = x + ch->xadvance;
+        crop->left = (rtl && next_ch != NULL) ? (x - next_ch->xadvance) : FL32_MAX;
 
-        struct canvas_vertex2d* v0 = &verts[vertex_idx];
-        struct canvas_vertex2d* v1 = &verts[vertex_idx + 1];
-        struct canvas_vertex2d* v2 = &verts[vertex_idx + 2];
-        struct canvas_vertex2d* v3 = &verts[vertex_idx + 3];
+        struct canvas_vertex2d* v = &run->verts[glyph_cnt*4];
 
         /* top-right */
-        vec3_setf(&v0->pos, pos.x + ch->xoffset + ch->width, pos.y + ch->yoffset, 0.0f);
-        vec2f_setf(&v0->coord, (ch->x + ch->width)/width, 1.0f - ch->y/height);
-        color_setc(&v0->clr, &color);
+        vec3_setf(&v[0].pos, x + ch->xoffset + ch->width, ch->yoffset, 0.0f);
+        vec2f_setf(&v[0].coord, (ch->x + ch->width)/width, 1.0f - ch->y/height);
 
         /* top-left */
-        vec3_setf(&v1->pos, pos.x + ch->xoffset, pos.y + ch->yoffset, 0.0f);
-        vec2f_setf(&v1->coord, ch->x/width, 1.0f - ch->y/height);
-        color_setc(&v1->clr, &color);
+        vec3_setf(&v[1].pos, x + ch->xoffset, ch->yoffset, 0.0f);
+        vec2f_setf(&v[1].coord, ch->x/width, 1.0f - ch->y/height);
 
         /* bottom right */
-        vec3_setf(&v2->pos, pos.x + ch->xoffset + ch->width, pos.y + ch->yoffset + ch->height, 0.0f);
-        vec2f_setf(&v2->coord, (ch->x + ch->width)/width, 1.0f - (ch->y + ch->height)/height);
-        color_setc(&v2->clr, &color);
+        vec3_setf(&v[2].pos, x + ch->xoffset + ch->width, ch->yoffset + ch->height, 0.0f);
+        vec2f_setf(&v[2].coord, (ch->x + ch->width)/width, 1.0f - (ch->y + ch->height)/height);
 
         /* bottom left */
-        vec3_setf(&v3->pos, pos.x + ch->xoffset, pos.y + ch->yoffset + ch->height, 0.0f);
-        vec2f_setf(&v3->coord, ch->x/width, 1.0f - (ch->y + ch->height)/height);
-        color_setc(&v3->clr, &color);
+        vec3_setf(&v[3].pos, x + ch->xoffset, ch->yoffset + ch->height, 0.0f);
+        vec2f_setf(&v[3].coord, ch->x/width, 1.0f - (ch->y + ch->height)/height);
 
         /* advance horizontally */
-        if (BIT_CHECK(item->flags, GFX_TEXT_RTL) && next_ch != NULL)
-        	pos.x -= next_ch->xadvance;
+        if (rtl && next_ch != NULL)
+        	x -= next_ch->xadvance;
         else
-        	pos.x += ch->xadvance;
+        	x += ch->xadvance;
 
         /* Apply kerning */
         if (next_ch != NULL)
-            pos.x += canvas_apply_kerning(font, ch, next_ch) * direction;
+            x += canvas_apply_kerning(font, ch, next_ch) * direction;
 
-        quad_idx ++;
-        char_offset ++;
-        vertex_idx += 4;
+        glyph_cnt ++;
     }
+    run->glyph_cnt = glyph_cnt;
 
-    *streamed_cnt = quad_idx;
-
-    /* check if all requested quads are filled, and there is still text remaining */
-    if (quad_idx == quad_cnt && char_offset != text_len)
-        return FALSE;
-
-    /* stramed the whole text
-     * reset static props */
-    char_offset = 0;
-    prev_item = NULL;
+    return run;
+}
 
-    return TRUE;
+/* frees runs that are not used for GLYPHCACHE_FRAMES frames, or all of them */
+void canvas_evict_glyphruns(int all)
+{
+    for (uint i = 0; i < GLYPHCACHE_SLOTS; i++) {
+        struct canvas_glyphrun* run = g_cvs.glyph_runs[i];
+        if (run != NULL && (all || (g_cvs.frame_id - run->last_frame) > GLYPHCACHE_FRAMES))  {
+            A_ALIGNED_FREE(mem_heap(), run);
+            g_cvs.glyph_runs[i] = NULL;
+        }
+    }
 }
 
 float canvas_get_textwidth(const struct gfx_font* font, const void* text,
@@ -2747,6 +3014,7 @@ void canvas_3d_switchnormal()
 
 void gfx_canvas_end3d()
 {
+    canvas_flush_lines3d();
     gfx_output_setrasterstate(g_cvs.cmdqueue, NULL);
     gfx_output_setdepthstencilstate(g_cvs.cmdqueue, NULL, 0);
     gfx_output_setblendstate(g_cvs.cmdqueue, NULL, NULL);
@@ -2779,3 +3047,145 @@ void gfx_canvas_setclip2d(int enable, int x, int y, int w, int h)
 	g_cvs.clip_rc.h = h;
 }
 
+
+void gfx_canvas_text2dpt_mt(uint thread_id, const char* text, int x, int y,
+    const struct color* c, uint flags)
+{
+    struct canvas_cmdbuf* buf = canvas_get_cmdbuf(thread_id);
+    if (buf == NULL || text[0] == 0)
+        return;
+
+    struct canvas_item2d* item = canvas_alloc_item(buf);
+    item->type = ITEM2D_TEXT;
+    item->stream_func = canvas_stream_text;
+    vec2i_seti(&item->p0, x, y);
+    vec2i_seti(&item->p1, x, y);
+    color_setc(&item->c, c);
+    BIT_REMOVE(flags, GFX_TEXT_UNICODE);
+    item->flags = flags;
+    item->font = g_cvs.def_font_hdl;
+    str_safecpy(item->text, sizeof(item->text), text);
+
+    canvas_record(buf, item);
+}
+
+void gfx_canvas_rect2d_mt(uint thread_id, const struct rect2di* rc, int line_width,
+    const struct color* c, uint flags)
+{
+    struct canvas_cmdbuf* buf = canvas_get_cmdbuf(thread_id);
+    if (buf == NULL)
+        return;
+
+    struct canvas_item2d* item = canvas_alloc_item(buf);
+    item->type = ITEM2D_RECT;
+    if (!BIT_CHECK(flags, GFX_RECT2D_HOLLOW))    {
+        item->stream_func = canvas_stream_rect;
+        color_setc(&item->brush.clr0, c);
+        color_setc(&item->brush.clr1, c);
+        item->brush.grad = GFX_GRAD_NULL;
+    }   else    {
+        item->stream_func = canvas_stream_rectborder;
+        color_setc(&item->c, c);
+    }
+
+    vec2i_seti(&item->p0, rc->x, rc->y);
+    vec2i_seti(&item->p1, rc->x + rc->w, rc->y + rc->h);
+    item->flags = flags;
+    item->font = INVALID_HANDLE;
+    item->width = line_width;
+
+    canvas_record(buf, item);
+}
+
+void gfx_canvas_line2d_mt(uint thread_id, int x0, int y0, int x1, int y1,
+    int line_width, const struct color* c)
+{
+    struct canvas_cmdbuf* buf = canvas_get_cmdbuf(thread_id);
+    if (buf == NULL)
+        return;
+
+    struct canvas_item2d* item = canvas_alloc_item(buf);
+    item->type = ITEM2D_LINE;
+    item->stream_func = canvas_stream_line;
+    vec2i_seti(&item->p0, x0, y0);
+    vec2i_seti(&item->p1, x1, y1);
+    color_setc(&item->c, c);
+    item->font = INVALID_HANDLE;
+    item->width = line_width;
+
+    canvas_record(buf, item);
+}
+
+void gfx_canvas_line3d_mt(uint thread_id, const struct vec4f* p0, const struct vec4f* p1,
+    const struct color* c)
+{
+    struct canvas_cmdbuf* buf = canvas_get_cmdbuf(thread_id);
+    if (buf == NULL || vec3_isequal(p0, p1))
+        return;
+
+    struct canvas_line3d* line = (struct canvas_line3d*)arr_add(&buf->lines3d);
+    if (line == NULL)
+        return;
+    vec4_setv(&line->p0, p0);
+    vec4_setv(&line->p1, p1);
+    color_setc(&line->c, c);
+}
+
+/* draws recorded 3d lines of all threads, consecutive lines with the same color go into one
+ * draw call */
+void canvas_flush_lines3d()
+{
+    gfx_cmdqueue cmdqueue = g_cvs.cmdqueue;
+    struct mat3f ident;
+    int setup = FALSE;
+
+    mat3_set_ident(&ident);
+
+    for (uint i = 0; i < g_cvs.cmdbuf_cnt; i++)   {
+        struct canvas_cmdbuf* buf = &g_cvs.cmdbufs[i];
+        if (!buf->init || buf->lines3d.item_cnt == 0)
+            continue;
+
+        if (!setup) {
+            canvas_3d_switchnormal();
+            gfx_output_setrasterstate(cmdqueue, g_cvs.states.rs_solid);
+            gfx_output_setdepthstencilstate(cmdqueue, g_cvs.states.ds_depthon, 0);
+            gfx_input_setlayout(cmdqueue, g_cvs.shapes.generic);
+            setup = TRUE;
+        }
+
+        const struct canvas_line3d* lines = (const struct canvas_line3d*)buf->lines3d.buffer;
+        uint cnt = (uint)buf->lines3d.item_cnt;
+        uint idx = 0;
+        while (idx < cnt)   {
+            const struct color* c = &lines[idx].c;
+            uint batch_cnt = 1;
+            while (idx + batch_cnt < cnt && batch_cnt < LINE3D_BATCH_MAX &&
+                lines[idx + batch_cnt].c.r == c->r && lines[idx + batch_cnt].c.g == c->g &&
+                lines[idx + batch_cnt].c.b == c->b && lines[idx + batch_cnt].c.a == c->a)
+            {
+                batch_cnt++;
+            }
+
+            uint offset;
+            const uint size = batch_cnt*2*sizeof(struct canvas_vertex3d);
+            struct canvas_vertex3d* verts = (struct canvas_vertex3d*)
+                gfx_contbuffer_map(cmdqueue, &g_cvs.contbuffer, size, &offset);
+            if (verts == NULL)
+                break;
+
+            for (uint k = 0; k < batch_cnt; k++)    {
+                vec3_setv(&verts[2*k].pos, &lines[idx + k].p0);
+                vec3_setv(&verts[2*k + 1].pos, &lines[idx + k].p1);
+            }
+            gfx_contbuffer_unmap(cmdqueue, &g_cvs.contbuffer);
+
+            canvas_set_perobject(cmdqueue, &ident, c, NULL);
+            gfx_draw(cmdqueue, GFX_PRIMITIVE_LINELIST, offset/sizeof(struct canvas_vertex3d),
+                batch_cnt*2, GFX_DRAWCALL_DEBUG);
+            idx += batch_cnt;
+        }
+
+        arr_clear(&buf->lines3d);
+    }
+}
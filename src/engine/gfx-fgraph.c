@@ -0,0 +1,195 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+#include "dhcore/str.h"
+
+#include "fgraph-compile.h"
+#include "gfx-device.h"
+#include "mem-ids.h"
+
+/* physical targets that are not used for this many frames are destroyed */
+#define FG_POOL_KEEPFRAMES 60
+
+/*************************************************************************************************
+ * fwd declarations
+ */
+uint gfx_texture_getbpp(enum gfx_format fmt);
+
+/*************************************************************************************************
+ * inlines
+ */
+INLINE size_t fg_desc_getsize(const struct gfx_fg_texdesc* d)
+{
+    return (size_t)d->width*d->height*gfx_texture_getbpp(d->fmt)/8;
+}
+
+INLINE void fg_target_destroy(struct fg_target* t)
+{
+    if (t->rt != NULL)
+        gfx_destroy_rendertarget(t->rt);
+    if (t->tex != NULL)
+        gfx_destroy_texture(t->tex);
+    t->rt = NULL;
+    t->tex = NULL;
+}
+
+/*************************************************************************************************/
+struct gfx_fgraph* gfx_fg_create()
+{
+    struct gfx_fgraph* fg = (struct gfx_fgraph*)ALLOC(sizeof(struct gfx_fgraph), MID_GFX);
+    if (fg == NULL)
+        return NULL;
+    memset(fg, 0x00, sizeof(struct gfx_fgraph));
+    return fg;
+}
+
+void gfx_fg_destroy(struct gfx_fgraph* fg)
+{
+    ASSERT(fg);
+    gfx_fg_releasepool(fg);
+    FREE(fg);
+}
+
+void gfx_fg_releasepool(struct gfx_fgraph* fg)
+{
+    for (uint i = 0; i < fg->pool_cnt; i++)
+        fg_target_destroy(&fg->pool[i]);
+    fg->pool_cnt = 0;
+}
+
+void gfx_fg_execute(struct gfx_fgraph* fg, gfx_cmdqueue cmdqueue,
+    const struct gfx_view_params* params)
+{
+    if (!fg->compiled)
+        return;
+
+    /* create physical targets of this frame, destroy the ones that are not used anymore */
+    for (uint i = 0; i < fg->pool_cnt; i++)   {
+        struct fg_target* t = &fg->pool[i];
+        if (t->used_frame == fg->frame) {
+            if (t->tex != NULL)
+                continue;
+            t->tex = gfx_create_texturert(t->desc.width, t->desc.height, t->desc.fmt, FALSE);
+            if (t->tex != NULL)
+                t->rt = gfx_create_rendertarget(&t->tex, 1, NULL);
+            if (t->rt == NULL)  {
+                err_print(__FILE__, __LINE__,
+                    "frame-graph execute failed: could not create target");
+                fg_target_destroy(t);
+                return;
+            }
+        }   else if (fg->frame - t->used_frame > FG_POOL_KEEPFRAMES)  {
+            fg_target_destroy(t);
+        }
+    }
+
+    for (uint i = 0; i < fg->res_cnt; i++)    {
+        struct fg_resource* r = &fg->resources[i];
+        if (r->pool_idx != INVALID_INDEX) {
+            r->tex = fg->pool[r->pool_idx].tex;
+            r->rt = fg->pool[r->pool_idx].rt;
+        }
+    }
+
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        struct fg_pass* p = &fg->passes[i];
+        if (!p->culled && p->exec_fn != NULL)
+            p->exec_fn(cmdqueue, fg, params, p->param);
+    }
+}
+
+gfx_texture gfx_fg_gettexture(struct gfx_fgraph* fg, uint res)
+{
+    if (res == INVALID_INDEX)
+        return NULL;
+
+    struct fg_resource* r = &fg->resources[res];
+    if (r->tex == NULL && r->rt != NULL)
+        return (gfx_texture)r->rt->desc.rt.rt_textures[0];
+    return r->tex;
+}
+
+gfx_rendertarget gfx_fg_getrendertarget(struct gfx_fgraph* fg, uint res)
+{
+    return res != INVALID_INDEX ? fg->resources[res].rt : NULL;
+}
+
+void gfx_fg_bindimport(struct gfx_fgraph* fg, uint res, OPTIONAL gfx_texture tex,
+    OPTIONAL gfx_rendertarget rt)
+{
+    if (res == INVALID_INDEX)
+        return;
+
+    struct fg_resource* r = &fg->resources[res];
+    ASSERT(BIT_CHECK(r->flags, FG_RES_IMPORTED));
+    r->tex = tex;
+    r->rt = rt;
+}
+
+void gfx_fg_getstats(struct gfx_fgraph* fg, OUT struct gfx_fg_stats* stats)
+{
+    memset(stats, 0x00, sizeof(struct gfx_fg_stats));
+    stats->pass_cnt = fg->pass_cnt;
+
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        if (fg->passes[i].culled)
+            stats->culled_cnt ++;
+    }
+
+    for (uint i = 0; i < fg->res_cnt; i++)    {
+        struct fg_resource* r = &fg->resources[i];
+        if (r->pool_idx != INVALID_INDEX) {
+            stats->transient_cnt ++;
+            stats->transient_bytes += fg_desc_getsize(&r->desc);
+        }
+    }
+
+    for (uint i = 0; i < fg->pool_cnt; i++)   {
+        struct fg_target* t = &fg->pool[i];
+        if (t->used_frame == fg->frame) {
+            stats->target_cnt ++;
+            stats->target_bytes += fg_desc_getsize(&t->desc);
+        }
+    }
+}
+
+void gfx_fg_dump(struct gfx_fgraph* fg)
+{
+    struct gfx_fg_stats stats;
+    gfx_fg_getstats(fg, &stats);
+
+    log_printf(LOG_TEXT, "frame-graph: %d passes (%d culled), %d transients -> %d targets "
+        "(%dkb -> %dkb)", stats.pass_cnt, stats.culled_cnt, stats.transient_cnt,
+        stats.target_cnt, (uint)(stats.transient_bytes/1024), (uint)(stats.target_bytes/1024));
+
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        struct fg_pass* p = &fg->passes[i];
+        log_printf(LOG_TEXT, "\tpass %d: %s%s", i, p->name, p->culled ? " (culled)" : "");
+    }
+
+    for (uint i = 0; i < fg->res_cnt; i++)    {
+        struct fg_resource* r = &fg->resources[i];
+        if (BIT_CHECK(r->flags, FG_RES_IMPORTED))    {
+            log_printf(LOG_TEXT, "\tres %s: imported, life(%d, %d)", r->name, r->first_pass,
+                r->last_pass);
+        }   else if (r->pool_idx != INVALID_INDEX)   {
+            log_printf(LOG_TEXT, "\tres %s: %dx%d, life(%d, %d), target %d", r->name,
+                r->desc.width, r->desc.height, r->first_pass, r->last_pass, r->pool_idx);
+        }   else    {
+            log_printf(LOG_TEXT, "\tres %s: unused", r->name);
+        }
+    }
+}
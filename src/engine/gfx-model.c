@@ -30,19 +30,29 @@
 
 #define HSEED 2343
 
+/*************************************************************************************************
+ * types
+ */
+/* reads h3dm data from file memory, vertex and index data is handed to buffers without copying */
+struct model_reader
+{
+    const uint8* data;
+    size_t size;
+    size_t offset;
+};
+
 /*************************************************************************************************
  * forward declarations
  */
-int model_loadnode(struct gfx_model_node* node, file_t f, struct allocator* alloc);
-int model_loadmesh(struct gfx_model_mesh* mesh, file_t f, struct allocator* alloc);
-int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
-		struct allocator* tmp_alloc, uint thread_id);
-int model_loadmtl(struct gfx_model_mtl* mtl, file_t f, struct allocator* alloc);
-int model_loadocc(struct gfx_model_occ* occ, file_t f, struct allocator* alloc);
+int model_loadnode(struct gfx_model_node* node, struct model_reader* rd, struct allocator* alloc);
+int model_loadmesh(struct gfx_model_mesh* mesh, struct model_reader* rd, struct allocator* alloc);
+int model_loadgeo(struct gfx_model_geo* geo, struct model_reader* rd, struct allocator* alloc,
+		uint thread_id);
+int model_loadmtl(struct gfx_model_mtl* mtl, struct model_reader* rd, struct allocator* alloc);
+int model_loadocc(struct gfx_model_occ* occ, struct model_reader* rd, struct allocator* alloc);
 
 int model_checkvertid(const uint* vert_ids, uint vert_id_cnt, enum gfx_input_element_id id);
-gfx_buffer model_loadvbuffer(file_t f, uint vert_cnt, uint elem_sz, struct allocator* tmp_alloc,
-                             uint thread_id);
+gfx_buffer model_loadvbuffer(struct model_reader* rd, uint vert_cnt, uint elem_sz, uint thread_id);
 
 void model_unloadgeo(struct gfx_model_geo* geo);
 
@@ -65,16 +75,23 @@ size_t gfx_model_choose_vbuff_size(uint idx);
 /*************************************************************************************************
  * inlines
  */
-INLINE int model_map_issrgb(enum gfx_model_maptype type)
+/* returns pointer to the data at current position and skips it, =NULL if file is truncated */
+INLINE const void* model_readptr(struct model_reader* rd, size_t size)
 {
-    switch (type)   {
-    case GFX_MODEL_DIFFUSEMAP:
-    case GFX_MODEL_EMISSIVEMAP:
-    case GFX_MODEL_REFLECTIONMAP:
-        return TRUE;
-    default:
+    if (rd->offset + size > rd->size)
+        return NULL;
+    const void* p = rd->data + rd->offset;
+    rd->offset += size;
+    return p;
+}
+
+INLINE int model_read(struct model_reader* rd, void* buf, size_t item_sz, size_t cnt)
+{
+    const void* p = model_readptr(rd, item_sz*cnt);
+    if (p == NULL)
         return FALSE;
-    }
+    memcpy(buf, p, item_sz*cnt);
+    return TRUE;
 }
 
 /*************************************************************************************************/
@@ -84,37 +101,63 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 	struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
 	A_SAVE(tmp_alloc);
 
+    /* read the whole file once, and parse it from memory
+     * file memory must be kept until gpu buffers are filled, because they refer to it */
+	file_t f = fio_openmem(tmp_alloc, h3dm_filepath, FALSE, MID_GFX);
+	if (f == NULL)	{
+		err_printf(__FILE__, __LINE__, "load model '%s' failed: could not open file", h3dm_filepath);
+        A_LOAD(tmp_alloc);
+		return NULL;
+	}
+    size_t size;
+    void* data = fio_detachmem(f, &size, NULL);
+    fio_close(f);
+
+    struct gfx_model* model = gfx_model_loadmem(alloc, h3dm_filepath, data, size, thread_id);
+
+    A_FREE(tmp_alloc, data);
+	A_LOAD(tmp_alloc);
+	return model;
+}
+
+struct gfx_model* gfx_model_loadmem(struct allocator* alloc, const char* name, const void* data,
+    size_t size, uint thread_id)
+{
 	struct h3d_header header;
     struct h3d_model h3dmodel;
 	struct gfx_model* model = NULL;
     uint renderable_idx = 0;
     struct stack_alloc stack_mem;
     struct allocator stack_alloc;
+    struct model_reader rd;
     result_t r;
 
     memset(&stack_mem, 0x00, sizeof(stack_mem));
+    memset(&rd, 0x00, sizeof(rd));
 
-	file_t f = fio_openmem(tmp_alloc, h3dm_filepath, FALSE, MID_GFX);
-	if (f == NULL)	{
-		err_printf(__FILE__, __LINE__, "load model '%s' failed: could not open file", h3dm_filepath);
-		goto err_cleanup;
-	}
+    /* vertex and index buffers refer to 'data' until gpu objects are filled */
+    rd.data = (const uint8*)data;
+    rd.size = size;
 
 	/* header */
-    fio_read(f, &header, sizeof(header), 1);
-	if (header.sign != H3D_SIGN || header.type != H3D_MESH)	{
-		err_printf(__FILE__, __LINE__, "load model '%s' failed: invalid file format", h3dm_filepath);
+	if (!model_read(&rd, &header, sizeof(header), 1) ||
+        header.sign != H3D_SIGN || header.type != H3D_MESH)
+    {
+		err_printf(__FILE__, __LINE__, "load model '%s' failed: invalid file format", name);
 		goto err_cleanup;
 	}
 
     if (header.version != H3D_VERSION && header.version != H3D_VERSION_13)  {
         err_printf(__FILE__, __LINE__, "load model '%s' failed: file version not implemented/obsolete",
-            h3dm_filepath);
+            name);
         goto err_cleanup;
     }
 
     /* model */
-    fio_read(f, &h3dmodel, sizeof(h3dmodel), 1);
+    if (!model_read(&rd, &h3dmodel, sizeof(h3dmodel), 1))   {
+        err_printf(__FILE__, __LINE__, "load model '%s' failed: invalid file", name);
+        goto err_cleanup;
+    }
 
     /* calculate size and create stack allocator for proceeding allocations */
     size_t total_sz =
@@ -151,6 +194,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
     }
     memset(model, 0x00, sizeof(struct gfx_model));
     model->alloc = alloc;
+    model->data_size = (uint)total_sz;
 
 	/* nodes */
 	if (h3dmodel.node_cnt > 0)	{
@@ -161,7 +205,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 
 		for (uint i = 0; i < h3dmodel.node_cnt; i++)	{
 			struct gfx_model_node* node = &model->nodes[i];
-			if (!model_loadnode(node, f, &stack_alloc))
+			if (!model_loadnode(node, &rd, &stack_alloc))
 				goto err_cleanup;
 
             /* NOTE: we set root matrix to identity and keep the old one as "root_mat" */
@@ -183,7 +227,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 
 		for (uint i = 0; i < h3dmodel.mesh_cnt; i++)	{
 			struct gfx_model_mesh* mesh = &model->meshes[i];
-			if (!model_loadmesh(mesh, f, &stack_alloc))
+			if (!model_loadmesh(mesh, &rd, &stack_alloc))
 				goto err_cleanup;
 
 			/* assign global indexes */
@@ -203,7 +247,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 		memset(model->geos, 0x00, sizeof(struct gfx_model_geo)*h3dmodel.geo_cnt);
 		for (uint i = 0; i < h3dmodel.geo_cnt; i++)	{
 			struct gfx_model_geo* geo = &model->geos[i];
-			if (!model_loadgeo(geo, f, &stack_alloc, tmp_alloc, thread_id))
+			if (!model_loadgeo(geo, &rd, &stack_alloc, thread_id))
 				goto err_cleanup;
 			model->geo_cnt ++;
 		}
@@ -218,7 +262,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 		memset(model->mtls, 0x00, sizeof(struct gfx_model_mtl)*h3dmodel.mtl_cnt);
 		for (uint i = 0; i < h3dmodel.mtl_cnt; i++)	{
 			struct gfx_model_mtl* mtl = &model->mtls[i];
-			if (!model_loadmtl(mtl, f, &stack_alloc))
+			if (!model_loadmtl(mtl, &rd, &stack_alloc))
                 goto err_cleanup;
 			model->mtl_cnt ++;
 		}
@@ -230,7 +274,7 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
         ASSERT(model->occ);
 
         memset(model->occ, 0x00, sizeof(struct gfx_model_occ));
-        if (!model_loadocc(model->occ, f, &stack_alloc))
+        if (!model_loadocc(model->occ, &rd, &stack_alloc))
             goto err_cleanup;
     }
 
@@ -271,9 +315,6 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
         aabb_pushptf(&model->bb, -0.1f, -0.1f, -0.1f);
     }
 
-    fio_close(f);
-	A_LOAD(tmp_alloc);
-
     if (thread_id != 0) {
         gfx_delayed_waitforobjects(thread_id);
         gfx_delayed_fillobjects(thread_id);
@@ -282,19 +323,22 @@ struct gfx_model* gfx_model_load(struct allocator* alloc, const char* h3dm_filep
 	return model;
 
 err_cleanup:
-	if (f != NULL)
-        fio_close(f);
+    if (thread_id != 0 && gfx_delayed_haspending(thread_id))   {
+        /* gpu objects that are already queued still refer to file memory */
+        gfx_delayed_waitforobjects(thread_id);
+        gfx_delayed_fillobjects(thread_id);
+    }
 	if (model != NULL)
 		gfx_model_unload(model);
     mem_stack_destroy(&stack_mem);
-	A_LOAD(tmp_alloc);
 	return NULL;
 }
 
-int model_loadnode(struct gfx_model_node* node, file_t f, struct allocator* alloc)
+int model_loadnode(struct gfx_model_node* node, struct model_reader* rd, struct allocator* alloc)
 {
 	struct h3d_node h3dnode;
-    fio_read(f, &h3dnode, sizeof(h3dnode), 1);
+    if (!model_read(rd, &h3dnode, sizeof(h3dnode), 1))
+        return FALSE;
 	strcpy(node->name, h3dnode.name);
     node->name_hash = hash_str(h3dnode.name);
 	node->mesh_id = h3dnode.mesh_idx;
@@ -309,16 +353,18 @@ int model_loadnode(struct gfx_model_node* node, file_t f, struct allocator* allo
 		node->child_ids = (uint*)A_ALLOC(alloc, sizeof(uint)*h3dnode.child_cnt, MID_GFX);
 		if (node->child_ids == NULL)
 			return FALSE;
-	 fio_read(f, node->child_ids, sizeof(uint), h3dnode.child_cnt);
+		if (!model_read(rd, node->child_ids, sizeof(uint), h3dnode.child_cnt))
+            return FALSE;
 	}
 	return TRUE;
 }
 
 
-int model_loadmesh(struct gfx_model_mesh* mesh, file_t f, struct allocator* alloc)
+int model_loadmesh(struct gfx_model_mesh* mesh, struct model_reader* rd, struct allocator* alloc)
 {
 	struct h3d_mesh h3dmesh;
-    fio_read(f, &h3dmesh, sizeof(h3dmesh), 1);
+    if (!model_read(rd, &h3dmesh, sizeof(h3dmesh), 1))
+        return FALSE;
 	mesh->geo_id = h3dmesh.geo_idx;
 	mesh->submesh_cnt = h3dmesh.submesh_cnt;
 	if (h3dmesh.submesh_cnt > 0)	{
@@ -328,7 +374,8 @@ int model_loadmesh(struct gfx_model_mesh* mesh, file_t f, struct allocator* allo
 			return FALSE;
 		for (uint i = 0; i < h3dmesh.submesh_cnt; i++)	{
 			struct h3d_submesh h3dsubmesh;
-		    fio_read(f, &h3dsubmesh, sizeof(h3dsubmesh), 1);
+		    if (!model_read(rd, &h3dsubmesh, sizeof(h3dsubmesh), 1))
+                return FALSE;
 			mesh->submeshes[i].mtl_id = h3dsubmesh.mtl_idx;
 			mesh->submeshes[i].subset_id = h3dsubmesh.subset_idx;
 		}
@@ -337,13 +384,14 @@ int model_loadmesh(struct gfx_model_mesh* mesh, file_t f, struct allocator* allo
 }
 
 
-int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
-		struct allocator* tmp_alloc, uint thread_id)
+int model_loadgeo(struct gfx_model_geo* geo, struct model_reader* rd, struct allocator* alloc,
+		uint thread_id)
 {
 	struct h3d_geo h3dgeo;
 	uint v_cnt = 0;
 
-    fio_read(f, &h3dgeo, sizeof(h3dgeo), 1);
+    if (!model_read(rd, &h3dgeo, sizeof(h3dgeo), 1))
+        return FALSE;
 	geo->vert_cnt = h3dgeo.vert_cnt;
 	geo->vert_id_cnt = h3dgeo.vert_id_cnt;
 	geo->tri_cnt = h3dgeo.tri_cnt;
@@ -359,7 +407,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
 
 	for (uint i = 0; i < h3dgeo.subset_cnt; i++)	{
 		struct h3d_geo_subset h3dsubset;
-	    fio_read(f, &h3dsubset, sizeof(h3dsubset), 1);
+	    if (!model_read(rd, &h3dsubset, sizeof(h3dsubset), 1))
+            goto err_cleanup;
 		geo->subsets[i].ib_idx = h3dsubset.ib_idx;
 		geo->subsets[i].idx_cnt = h3dsubset.idx_cnt;
 	}
@@ -368,15 +417,12 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
 	ASSERT(h3dgeo.tri_cnt > 0);
 	uint ibuffer_sz = (geo->ib_type == GFX_INDEX_UINT16) ? sizeof(uint16)*h3dgeo.tri_cnt*3 :
 			sizeof(uint)*h3dgeo.tri_cnt*3;
-	void* indexes = A_ALLOC(tmp_alloc, ibuffer_sz, MID_GFX);
+	const void* indexes = model_readptr(rd, ibuffer_sz);
 	if (indexes == NULL)
 		goto err_cleanup;
 
-    fio_read(f, indexes, ibuffer_sz, 1);
-
  	geo->ibuffer = gfx_create_buffer(GFX_BUFFER_INDEX, GFX_MEMHINT_STATIC, ibuffer_sz, indexes,
         thread_id);
-	A_FREE(tmp_alloc, indexes);
 	if (geo->ibuffer == NULL)
 		goto err_cleanup;
 
@@ -391,8 +437,7 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
 
 	if (has_pos | has_norm | has_coord)	{
 		geo->vbuffers[GFX_MODEL_BUFFER_BASE] =
-				model_loadvbuffer(f, h3dgeo.vert_cnt, sizeof(struct h3d_vertex_base), tmp_alloc,
-                thread_id);
+				model_loadvbuffer(rd, h3dgeo.vert_cnt, sizeof(struct h3d_vertex_base), thread_id);
 		if (geo->vbuffers[GFX_MODEL_BUFFER_BASE] == NULL)
 			goto err_cleanup;
 	}
@@ -408,8 +453,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
     int has_bweight = model_checkvertid(h3dgeo.vert_ids, h3dgeo.vert_id_cnt,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT);
     if (has_bindex | has_bweight)   {
-        geo->vbuffers[GFX_MODEL_BUFFER_SKIN] = model_loadvbuffer(f, h3dgeo.vert_cnt,
-            sizeof(struct h3d_vertex_skin), tmp_alloc, thread_id);
+        geo->vbuffers[GFX_MODEL_BUFFER_SKIN] = model_loadvbuffer(rd, h3dgeo.vert_cnt,
+            sizeof(struct h3d_vertex_skin), thread_id);
         if (geo->vbuffers[GFX_MODEL_BUFFER_BASE] == NULL)
             goto err_cleanup;
     }
@@ -425,8 +470,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
     int has_binorm = model_checkvertid(h3dgeo.vert_ids, h3dgeo.vert_id_cnt,
         GFX_INPUTELEMENT_ID_BINORMAL);
     if (has_tangent | has_binorm)   {
-        geo->vbuffers[GFX_MODEL_BUFFER_NMAP] = model_loadvbuffer(f, h3dgeo.vert_cnt,
-            sizeof(struct h3d_vertex_nmap), tmp_alloc, thread_id);
+        geo->vbuffers[GFX_MODEL_BUFFER_NMAP] = model_loadvbuffer(rd, h3dgeo.vert_cnt,
+            sizeof(struct h3d_vertex_nmap), thread_id);
         if (geo->vbuffers[GFX_MODEL_BUFFER_NMAP] == NULL)
             goto err_cleanup;
     }
@@ -441,8 +486,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
     int has_color = model_checkvertid(h3dgeo.vert_ids, h3dgeo.vert_id_cnt,
         GFX_INPUTELEMENT_ID_COLOR);
     if (has_coord1 | has_color) {
-        geo->vbuffers[GFX_MODEL_BUFFER_EXTRA] = model_loadvbuffer(f, h3dgeo.vert_cnt,
-            sizeof(struct h3d_vertex_extra), tmp_alloc, thread_id);
+        geo->vbuffers[GFX_MODEL_BUFFER_EXTRA] = model_loadvbuffer(rd, h3dgeo.vert_cnt,
+            sizeof(struct h3d_vertex_extra), thread_id);
         if (geo->vbuffers[GFX_MODEL_BUFFER_EXTRA] == NULL)
             goto err_cleanup;
     }
@@ -472,7 +517,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
 		for (uint i = 0; i < h3dgeo.joint_cnt; i++)	{
 			struct h3d_joint h3djoint;
 			struct gfx_model_joint* joint = &geo->skeleton->joints[i];
-		    fio_read(f, &h3djoint, sizeof(h3djoint), 1);
+		    if (!model_read(rd, &h3djoint, sizeof(h3djoint), 1))
+                goto err_cleanup;
 
 			strcpy(joint->name, h3djoint.name);
             joint->name_hash = hash_str(h3djoint.name);
@@ -482,7 +528,8 @@ int model_loadgeo(struct gfx_model_geo* geo, file_t f, struct allocator* alloc,
 			joint->parent_id = h3djoint.parent_idx;
 		}
 
-        fio_read(f, geo->skeleton->init_pose, sizeof(struct mat3f), h3dgeo.joint_cnt);
+        if (!model_read(rd, geo->skeleton->init_pose, sizeof(struct mat3f), h3dgeo.joint_cnt))
+            goto err_cleanup;
 	}
 
     ASSERT(v_cnt > 0);
@@ -549,29 +596,21 @@ int model_checkvertid(const uint* vert_ids, uint vert_id_cnt, enum gfx_input_ele
 	return FALSE;
 }
 
-gfx_buffer model_loadvbuffer(file_t f, uint vert_cnt, uint elem_sz, struct allocator* tmp_alloc,
-                             uint thread_id)
+gfx_buffer model_loadvbuffer(struct model_reader* rd, uint vert_cnt, uint elem_sz, uint thread_id)
 {
 	uint size = vert_cnt * elem_sz;
-    A_SAVE(tmp_alloc);
-	void* buf = A_ALLOC(tmp_alloc, size, MID_GFX);
-	if (buf == NULL)    {
-        A_LOAD(tmp_alloc);
+	const void* buf = model_readptr(rd, size);
+	if (buf == NULL)
 		return NULL;
-    }
-    fio_read(f, buf, elem_sz, vert_cnt);
-
-	gfx_buffer gbuf = gfx_create_buffer(GFX_BUFFER_VERTEX, GFX_MEMHINT_STATIC, size, buf, thread_id);
 
-    A_FREE(tmp_alloc, buf);
-    A_LOAD(tmp_alloc);
-	return gbuf;
+	return gfx_create_buffer(GFX_BUFFER_VERTEX, GFX_MEMHINT_STATIC, size, buf, thread_id);
 }
 
-int model_loadmtl(struct gfx_model_mtl* mtl, file_t f, struct allocator* alloc)
+int model_loadmtl(struct gfx_model_mtl* mtl, struct model_reader* rd, struct allocator* alloc)
 {
 	struct h3d_mtl h3dmtl;
-    fio_read(f, &h3dmtl, sizeof(h3dmtl), 1);
+    if (!model_read(rd, &h3dmtl, sizeof(h3dmtl), 1))
+        return FALSE;
 	color_setf(&mtl->ambient, h3dmtl.ambient[0], h3dmtl.ambient[1], h3dmtl.ambient[2], 1.0f);
 	color_setf(&mtl->diffuse, h3dmtl.diffuse[0], h3dmtl.diffuse[1], h3dmtl.diffuse[2], 1.0f);
 	color_setf(&mtl->specular, h3dmtl.specular[0], h3dmtl.specular[1], h3dmtl.specular[2], 1.0f);
@@ -587,10 +626,12 @@ int model_loadmtl(struct gfx_model_mtl* mtl, file_t f, struct allocator* alloc)
 			return FALSE;
 		for (uint i = 0; i < h3dmtl.texture_cnt; i++)	{
 			struct h3d_texture h3dtex;
-		    fio_read(f, &h3dtex, sizeof(h3dtex), 1);
+		    if (!model_read(rd, &h3dtex, sizeof(h3dtex), 1))
+                return FALSE;
 			/* h3d_texture_type = gfx_model_maptype */
 			mtl->maps[i].type = (enum gfx_model_maptype)h3dtex.type;
 			strcpy(mtl->maps[i].filepath, h3dtex.filepath);
+			mtl->maps[i].path_id = rs_get_pathid(h3dtex.filepath);
 
             /* TODO: this is a workaround for diffuse mapped materials that
              * imports false color values from assimp */
@@ -615,6 +656,21 @@ void gfx_model_unload(struct gfx_model* model)
     A_ALIGNED_FREE(model->alloc, model);
 }
 
+size_t gfx_model_getsize(const struct gfx_model* model)
+{
+    size_t sz = model->data_size;
+    for (uint i = 0; i < model->geo_cnt; i++)   {
+        const struct gfx_model_geo* geo = &model->geos[i];
+        for (uint k = 0; k < GFX_MODEL_BUFFER_CNT; k++)   {
+            if (geo->vbuffers[k] != NULL)
+                sz += geo->vbuffers[k]->desc.buff.size;
+        }
+        if (geo->ibuffer != NULL)
+            sz += geo->ibuffer->desc.buff.size;
+    }
+    return sz;
+}
+
 void model_unloadgeo(struct gfx_model_geo* geo)
 {
 	for (uint i = 0; i < GFX_MODEL_BUFFER_CNT; i++)	{
@@ -650,6 +706,7 @@ struct gfx_model_instance* gfx_model_createinstance(struct allocator* alloc,
         m->geo_cnt*sizeof(struct gfx_model_posegpu) +
         sizeof(uint)*unique_cnt +
         sizeof(int)*m->renderable_cnt +
+        sizeof(uint)*m->node_cnt +
         skeleton_cnt*16 +
         joint_cnt*sizeof(struct mat3f)*3;
 
@@ -726,6 +783,10 @@ struct gfx_model_instance* gfx_model_createinstance(struct allocator* alloc,
     inst->alpha_flags = (int*)A_ALLOC(&stack_alloc, sizeof(int)*m->renderable_cnt, MID_GFX);
     memset(inst->alpha_flags, 0x00, sizeof(int)*m->renderable_cnt);
 
+    /* xform stream indexes, renderer fills them on first draw of each frame */
+    inst->xform_idxs = (uint*)A_ALLOC(&stack_alloc, sizeof(uint)*m->node_cnt, MID_GFX);
+    memset(inst->xform_idxs, 0xff, sizeof(uint)*m->node_cnt);
+
 	/* update data of materials */
 	gfx_model_updatemtls(inst);
 
@@ -851,6 +912,12 @@ uint model_make_rpathflags(const struct gfx_model* model, uint mesh_id, uint sub
 	return flags;
 }
 
+int gfx_model_map_issrgb(enum gfx_model_maptype type)
+{
+    return type == GFX_MODEL_DIFFUSEMAP || type == GFX_MODEL_REFLECTIONMAP ||
+        type == GFX_MODEL_EMISSIVEMAP;
+}
+
 struct gfx_model_mtlgpu* model_load_gpumtl(struct allocator* main_alloc,
         struct allocator* alloc, struct allocator* tmp_alloc, const struct gfx_model_mtl* mtl,
         uint rpath_flags)
@@ -866,14 +933,14 @@ struct gfx_model_mtlgpu* model_load_gpumtl(struct allocator* main_alloc,
     /* load textures */
     for (uint i = 0; i < mtl->map_cnt; i++)	{
     	enum gfx_model_maptype type = mtl->maps[i].type;
-        int srgb = FALSE;
-        if (type == GFX_MODEL_DIFFUSEMAP || type == GFX_MODEL_REFLECTIONMAP ||
-            type == GFX_MODEL_EMISSIVEMAP)
-        {
-            srgb = TRUE;
-        }
+        int srgb = gfx_model_map_issrgb(type);
 
-    	gmtl->textures[type] = rs_load_texture(mtl->maps[i].filepath, 0, srgb, 0);
+        /* textures are usually shared between instances, so try the interned path first */
+        gmtl->textures[type] = rs_addref_byid(mtl->maps[i].path_id, RS_RESOURCE_TEXTURE);
+        if (gmtl->textures[type] == INVALID_HANDLE) {
+    	    gmtl->textures[type] = rs_load_texture(mtl->maps[i].filepath, 0, srgb,
+                RS_LOAD_STREAMMIPS);
+        }
     	if (gmtl->textures[type] == INVALID_HANDLE)	{
     		model_destroy_gpumtl(alloc, gmtl);
     		return NULL;
@@ -1027,6 +1094,7 @@ void gfx_model_updatemtls(struct gfx_model_instance* inst)
             }
 
 			gmtl->invalidate_cb = TRUE;
+			gmtl->cb_hash = hash_murmur32(cb->cpu_buffer, cb->buffer_size, SHADER_HSEED);
 		}
 	}
 
@@ -1034,6 +1102,17 @@ void gfx_model_updatemtls(struct gfx_model_instance* inst)
     model_update_alphaflags(inst);
 }
 
+void gfx_model_requestmips(struct gfx_model_instance* inst, uint mtl_cnt, float screen_size)
+{
+    for (uint i = 0; i < mtl_cnt; i++)    {
+        struct gfx_model_mtlgpu* gmtl = inst->mtls[i];
+        for (uint k = 0; k < GFX_MODEL_MAX_MAPS; k++) {
+            if (gmtl->textures[k] != INVALID_HANDLE)
+                rs_set_texturesize(gmtl->textures[k], screen_size);
+        }
+    }
+}
+
 void gfx_model_setmtl(gfx_cmdqueue cmdqueue, struct gfx_shader* shader,
 		struct gfx_model_instance* inst, uint mtl_id)
 {
@@ -1102,10 +1181,11 @@ void gfx_model_setmtl(gfx_cmdqueue cmdqueue, struct gfx_shader* shader,
 #endif
 }
 
-int model_loadocc(struct gfx_model_occ* occ, file_t f, struct allocator* alloc)
+int model_loadocc(struct gfx_model_occ* occ, struct model_reader* rd, struct allocator* alloc)
 {
     struct h3d_occ h3docc;
-    fio_read(f, &h3docc, sizeof(struct h3d_occ), 1);
+    if (!model_read(rd, &h3docc, sizeof(struct h3d_occ), 1))
+        return FALSE;
 
     strcpy(occ->name, h3docc.name);
     occ->tri_cnt = h3docc.tri_cnt;
@@ -1118,9 +1198,8 @@ int model_loadocc(struct gfx_model_occ* occ, file_t f, struct allocator* alloc)
         return FALSE;
     }
 
-    fio_read(f, occ->indexes, sizeof(uint16), h3docc.tri_cnt*3);
-    fio_read(f, occ->poss, sizeof(struct vec3f), h3docc.vert_cnt);
-    return TRUE;
+    return model_read(rd, occ->indexes, sizeof(uint16), h3docc.tri_cnt*3) &&
+        model_read(rd, occ->poss, sizeof(struct vec3f), h3docc.vert_cnt);
 }
 
 void model_unloadocc(struct gfx_model_occ* occ, struct allocator* alloc)
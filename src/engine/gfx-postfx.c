@@ -69,8 +69,6 @@ struct gfx_pfx_ssao
 
 struct gfx_pfx_upsample
 {
-    gfx_texture tex;    /* must be 2x size of the source */
-    gfx_rendertarget rt;
     uint shader_id;
     gfx_sampler sampl_point;
     gfx_sampler sampl_lin;
@@ -78,9 +76,6 @@ struct gfx_pfx_upsample
 
 struct gfx_pfx_shadow
 {
-    gfx_texture tex; /* can be reused (reference only mode) */
-    gfx_rendertarget rt;
-    int ref_mode;
     int prev_mode;
     gfx_sampler sampl_point;
     gfx_sampler sampl_cmp;
@@ -90,9 +85,6 @@ struct gfx_pfx_shadow
 
 struct gfx_pfx_tonemap
 {
-    gfx_texture tex;
-    gfx_rendertarget rt;
-
     gfx_texture lum_tex;    /* downsampled and mipmapped luminance */
     gfx_texture bright_tex[2]; /* downsampled bright texture */
     gfx_rendertarget lum_rt;
@@ -130,8 +122,6 @@ struct gfx_pfx_tonemap
 
 struct gfx_pfx_fxaa
 {
-    gfx_texture tex;
-    gfx_rendertarget rt;
     uint shader_id;
     gfx_sampler sampl_lin;
 };
@@ -539,43 +529,13 @@ result_t pfx_console_ssao_setparams(uint argc, const char ** argv, void* param)
 /*************************************************************************************************
  * bilateral upsample
  */
-INLINE result_t pfx_upsamplebilateral_creatert(struct gfx_pfx_upsample* pfx,
-    uint width, uint height)
-{
-    pfx->tex = gfx_create_texturert(width, height, GFX_FORMAT_RGBA_UNORM, FALSE);
-    if (pfx->tex == NULL)
-        return RET_FAIL;
-    pfx->rt = gfx_create_rendertarget(&pfx->tex, 1, NULL);
-    if (pfx->rt == NULL)
-        return RET_FAIL;
-    return RET_OK;
-}
-
-INLINE void pfx_upsamplebilateral_releasert(struct gfx_pfx_upsample* pfx)
+struct gfx_pfx_upsample* gfx_pfx_upsamplebilateral_create()
 {
-    if (pfx->rt != NULL)
-        gfx_destroy_rendertarget(pfx->rt);
-    if (pfx->tex != NULL)
-        gfx_destroy_texture(pfx->tex);
-}
-
-struct gfx_pfx_upsample* gfx_pfx_upsamplebilateral_create(uint width, uint height)
-{
-    result_t r;
-
     struct gfx_pfx_upsample* pfx = (struct gfx_pfx_upsample*)ALLOC(sizeof(struct gfx_pfx_upsample),
         MID_GFX);
     ASSERT(pfx);
     memset(pfx, 0x00, sizeof(struct gfx_pfx_upsample));
 
-    /* textures */
-    r = pfx_upsamplebilateral_creatert(pfx, width, height);
-    if (IS_FAIL(r)) {
-        err_print(__FILE__, __LINE__, "pfx-upsample-b init failed: could not create buffers");
-        gfx_pfx_upsamplebilateral_destroy(pfx);
-        return NULL;
-    }
-
     /* shader */
     gfx_shader_beginload(eng_get_lsralloc(), "shaders/fsq.vs", "shaders/upsample-bilateral.ps",
         NULL, 1, "shaders/df-common.inc");
@@ -619,8 +579,6 @@ void gfx_pfx_upsamplebilateral_destroy(struct gfx_pfx_upsample* pfx)
 {
     ASSERT(pfx);
 
-    pfx_upsamplebilateral_releasert(pfx);
-
     if (pfx->sampl_point != NULL)
         gfx_destroy_sampler(pfx->sampl_point);
 
@@ -633,15 +591,16 @@ void gfx_pfx_upsamplebilateral_destroy(struct gfx_pfx_upsample* pfx)
     FREE(pfx);
 }
 
-gfx_texture gfx_pfx_upsamplebilateral_render(gfx_cmdqueue cmdqueue,
+void gfx_pfx_upsamplebilateral_render(gfx_cmdqueue cmdqueue,
     struct gfx_pfx_upsample* pfx, const struct gfx_view_params* params,
     gfx_texture src_tex, gfx_texture depth_tex, gfx_texture norm_tex,   /* 1/2 size */
-    gfx_texture upsample_depthtex, gfx_texture upsample_normtex /* full size */)
+    gfx_texture upsample_depthtex, gfx_texture upsample_normtex, /* full size */
+    gfx_rendertarget rt)
 {
     PRF_OPENSAMPLE("postfx-upsamplebilateral");
     struct gfx_shader* shader = gfx_shader_get(pfx->shader_id);
-    gfx_output_setrendertarget(cmdqueue, pfx->rt);
-    gfx_output_setviewport(cmdqueue, 0, 0, pfx->rt->desc.rt.width, pfx->rt->desc.rt.height);
+    gfx_output_setrendertarget(cmdqueue, rt);
+    gfx_output_setviewport(cmdqueue, 0, 0, rt->desc.rt.width, rt->desc.rt.height);
     gfx_shader_bind(cmdqueue, shader);
 
     /* textures */
@@ -666,64 +625,18 @@ gfx_texture gfx_pfx_upsamplebilateral_render(gfx_cmdqueue cmdqueue,
     gfx_draw_fullscreenquad();
 
     PRF_CLOSESAMPLE();
-    return pfx->tex;
-}
-
-result_t gfx_pfx_upsamplebilateral_resize(struct gfx_pfx_upsample* pfx, uint width, uint height)
-{
-    pfx_upsamplebilateral_releasert(pfx);
-    return pfx_upsamplebilateral_creatert(pfx, width, height);
 }
 
 /*************************************************************************************************
  * shadow-csm
  */
-INLINE result_t pfx_shadowcsm_creatert(struct gfx_pfx_shadow* pfx, uint width, uint height)
-{
-    if (!pfx->ref_mode) {
-        pfx->tex = gfx_create_texturert(width, height, GFX_FORMAT_RGBA_UNORM, FALSE);
-        if (pfx->tex == NULL)
-            return RET_FAIL;
-    }
-
-    pfx->rt = gfx_create_rendertarget(&pfx->tex, 1, NULL);
-    if (pfx->rt == NULL)
-        return RET_FAIL;
-
-    return RET_OK;
-}
-
-INLINE void pfx_shadowcsm_destroyrt(struct gfx_pfx_shadow* pfx)
-{
-    if (!pfx->ref_mode && pfx->tex != NULL)
-        gfx_destroy_texture(pfx->tex);
-
-    if (pfx->rt != NULL)
-        gfx_destroy_rendertarget(pfx->rt);
-}
-
-struct gfx_pfx_shadow* gfx_pfx_shadowcsm_create(uint width, uint height,
-    OPTIONAL gfx_texture reuse_tex /*=NULL*/)
+struct gfx_pfx_shadow* gfx_pfx_shadowcsm_create()
 {
-    result_t r;
     struct gfx_pfx_shadow* pfx = (struct gfx_pfx_shadow*)ALLOC(sizeof(struct gfx_pfx_shadow),
         MID_GFX);
     ASSERT(pfx);
     memset(pfx, 0x00, sizeof(struct gfx_pfx_shadow));
 
-    if (reuse_tex != NULL)  {
-        pfx->tex = reuse_tex;
-        pfx->ref_mode = TRUE;
-    }
-
-    /* textures */
-    r = pfx_shadowcsm_creatert(pfx, width, height);
-    if (IS_FAIL(r))   {
-        err_print(__FILE__, __LINE__, "pfx-shadowcsm init failed: could not create buffers");
-        gfx_pfx_shadowcsm_destroy(pfx);
-        return NULL;
-    }
-
     /* shaders */
     char cascadecnt[16];
     enum gfx_hwver hwver = gfx_get_hwver();
@@ -813,8 +726,6 @@ void gfx_pfx_shadowcsm_destroy(struct gfx_pfx_shadow* pfx)
 {
     ASSERT(pfx);
 
-    pfx_shadowcsm_destroyrt(pfx);
-
     if (pfx->shader_id != 0)
         gfx_shader_unload(pfx->shader_id);
 
@@ -830,8 +741,8 @@ void gfx_pfx_shadowcsm_destroy(struct gfx_pfx_shadow* pfx)
     FREE(pfx);
 }
 
-gfx_texture gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue,
-    struct gfx_pfx_shadow* pfx, const struct gfx_view_params* params, gfx_texture depth_tex)
+void gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_shadow* pfx,
+    const struct gfx_view_params* params, gfx_texture depth_tex, gfx_rendertarget rt)
 {
     PRF_OPENSAMPLE("postfx-csm");
 
@@ -842,8 +753,8 @@ gfx_texture gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue,
         shader = gfx_shader_get(pfx->prev_shaderid);
 
     gfx_cmdqueue_resetsrvs(cmdqueue);
-    gfx_output_setrendertarget(cmdqueue, pfx->rt);
-    gfx_output_setviewport(cmdqueue, 0, 0, pfx->rt->desc.rt.width, pfx->rt->desc.rt.height);
+    gfx_output_setrendertarget(cmdqueue, rt);
+    gfx_output_setviewport(cmdqueue, 0, 0, rt->desc.rt.width, rt->desc.rt.height);
     gfx_shader_bind(cmdqueue, shader);
 
     gfx_texture shadow_tex = gfx_csm_get_shadowtex();
@@ -862,18 +773,18 @@ gfx_texture gfx_pfx_shadowcsm_render(gfx_cmdqueue cmdqueue,
 
     gfx_draw_fullscreenquad();
 
-    PRF_CLOSESAMPLE(); /* postfx-csm */
+    /* target can change between frames */
+    if (pfx->prev_mode)
+        hud_set_image("pfx-csm", (gfx_texture)rt->desc.rt.rt_textures[0]);
 
-    return pfx->tex;
+    PRF_CLOSESAMPLE(); /* postfx-csm */
 }
 
-result_t gfx_pfx_shadowcsm_resize(struct gfx_pfx_shadow* pfx, uint width, uint height)
+int gfx_pfx_shadowcsm_ispreview(struct gfx_pfx_shadow* pfx)
 {
-    pfx_shadowcsm_destroyrt(pfx);
-    return pfx_shadowcsm_creatert(pfx, width, height);
+    return pfx->prev_mode;
 }
 
-
 result_t pfx_console_shadowcsm_prev(uint argc, const char** argv, void* param)
 {
     int enable = TRUE;
@@ -885,7 +796,7 @@ result_t pfx_console_shadowcsm_prev(uint argc, const char** argv, void* param)
     pfx->prev_mode = enable;
 
     if (enable)
-        hud_add_image("pfx-csm", pfx->tex, TRUE, 0, 0, "[CSM]");
+        hud_add_image("pfx-csm", NULL, TRUE, 0, 0, "[CSM]");
     else
         hud_remove_image("pfx-csm");
     return RET_OK;
@@ -896,14 +807,6 @@ result_t pfx_console_shadowcsm_prev(uint argc, const char** argv, void* param)
  */
 INLINE result_t pfx_tonemap_creatert(struct gfx_pfx_tonemap* pfx, uint width, uint height)
 {
-    /* tonemapped output buffer */
-    pfx->tex = gfx_create_texturert(width, height, GFX_FORMAT_RGBA_UNORM, FALSE);
-    if (pfx->tex == NULL)
-        return RET_FAIL;
-    pfx->rt = gfx_create_rendertarget(&pfx->tex, 1, NULL);
-    if (pfx->rt == NULL)
-        return RET_FAIL;
-
     /* mipmapped luminance buffer */
     enum shading_quality sh_quality = gfx_get_params()->shading_quality;
     uint divider = sh_quality == SHADING_QUALITY_HIGH ? 3 : 4;
@@ -1004,10 +907,6 @@ INLINE void pfx_tonemap_destroyrt(struct gfx_pfx_tonemap* pfx)
         gfx_destroy_texture(pfx->bright_tex[1]);
     if (pfx->lum_tex != NULL)
         gfx_destroy_texture(pfx->lum_tex);
-    if (pfx->rt != NULL)
-        gfx_destroy_rendertarget(pfx->rt);
-    if (pfx->tex != NULL)
-        gfx_destroy_texture(pfx->tex);
 }
 
 struct gfx_pfx_tonemap* gfx_pfx_tonemap_create(uint width, uint height, float mid_grey,
@@ -1153,8 +1052,9 @@ void gfx_pfx_tonemap_destroy(struct gfx_pfx_tonemap* pfx)
     FREE(pfx);
 }
 
-gfx_texture gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap* pfx,
-    const struct gfx_view_params* params, gfx_texture hdr_tex, OUT gfx_texture* bloom_tex)
+void gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap* pfx,
+    const struct gfx_view_params* params, gfx_texture hdr_tex, gfx_rendertarget rt,
+    OUT gfx_texture* bloom_tex)
 {
     struct gfx_shader* shader;
 
@@ -1206,8 +1106,8 @@ gfx_texture gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap
 
     /* tonemap pass */
     shader = gfx_shader_get(pfx->shader_id);
-    gfx_output_setrendertarget(cmdqueue, pfx->rt);
-    gfx_output_setviewport(cmdqueue, 0, 0, pfx->tex->desc.tex.width, pfx->tex->desc.tex.height);
+    gfx_output_setrendertarget(cmdqueue, rt);
+    gfx_output_setviewport(cmdqueue, 0, 0, rt->desc.rt.width, rt->desc.rt.height);
     gfx_shader_bind(cmdqueue, shader);
     gfx_shader_bindsamplertexture(cmdqueue, shader, SHADER_NAME(s_lum), pfx->sampl_point,
         pfx->lumadapt_tex[0]);
@@ -1256,7 +1156,6 @@ gfx_texture gfx_pfx_tonemap_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap
         pfx_tonemap_prevlum(cmdqueue, pfx);
 
     PRF_CLOSESAMPLE();  /* pfx-tonemap */
-    return pfx->tex;
 }
 
 void pfx_tonemap_prevlum(gfx_cmdqueue cmdqueue, struct gfx_pfx_tonemap* pfx)
@@ -1373,30 +1272,8 @@ int pfx_tonemap_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride,
 /*************************************************************************************************
  * fxaa
  */
-INLINE result_t pfx_fxaa_creatert(struct gfx_pfx_fxaa* pfx, uint width, uint height)
+struct gfx_pfx_fxaa* gfx_pfx_fxaa_create()
 {
-    pfx->tex = gfx_create_texturert(width, height, GFX_FORMAT_RGBA_UNORM, FALSE);
-    if (pfx->tex == NULL)
-        return RET_FAIL;
-
-    pfx->rt = gfx_create_rendertarget(&pfx->tex, 1, NULL);
-    if (pfx->rt == NULL)
-        return RET_FAIL;
-
-    return RET_OK;
-}
-
-INLINE void pfx_fxaa_destroyrt(struct gfx_pfx_fxaa* pfx)
-{
-    if (pfx->rt != NULL)
-        gfx_destroy_rendertarget(pfx->rt);
-    if (pfx->tex != NULL)
-        gfx_destroy_texture(pfx->tex);
-}
-
-struct gfx_pfx_fxaa* gfx_pfx_fxaa_create(uint width, uint height)
-{
-    result_t r;
     struct gfx_pfx_fxaa* pfx = (struct gfx_pfx_fxaa*)ALLOC(sizeof(struct gfx_pfx_fxaa), MID_GFX);
     if (pfx == NULL)    {
         err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
@@ -1404,14 +1281,6 @@ struct gfx_pfx_fxaa* gfx_pfx_fxaa_create(uint width, uint height)
     }
     memset(pfx, 0x00, sizeof(struct gfx_pfx_fxaa));
 
-    /* textures */
-    r = pfx_fxaa_creatert(pfx, width, height);
-    if (IS_FAIL(r)) {
-        err_print(__FILE__, __LINE__, "pfx-fxaa init failed: could not create buffers");
-        gfx_pfx_fxaa_destroy(pfx);
-        return NULL;
-    }
-
     /* shader */
     struct allocator* lsr_alloc = eng_get_lsralloc();
 
@@ -1502,7 +1371,6 @@ struct gfx_pfx_fxaa* gfx_pfx_fxaa_create(uint width, uint height)
 void gfx_pfx_fxaa_destroy(struct gfx_pfx_fxaa* pfx)
 {
     ASSERT(pfx);
-    pfx_fxaa_destroyrt(pfx);
     if (pfx->shader_id != 0)
         gfx_shader_unload(pfx->shader_id);
     if (pfx->sampl_lin != NULL)
@@ -1511,22 +1379,16 @@ void gfx_pfx_fxaa_destroy(struct gfx_pfx_fxaa* pfx)
     FREE(pfx);
 }
 
-result_t gfx_pfx_fxaa_resize(struct gfx_pfx_fxaa* pfx, uint width, uint height)
-{
-    pfx_fxaa_destroyrt(pfx);
-    return pfx_fxaa_creatert(pfx, width, height);
-}
-
-gfx_texture gfx_pfx_fxaa_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_fxaa* pfx,
-    gfx_texture rgbl_tex)
+void gfx_pfx_fxaa_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_fxaa* pfx,
+    gfx_texture rgbl_tex, gfx_rendertarget rt)
 {
     PRF_OPENSAMPLE("postfx-fxaa");
 
     struct gfx_shader* shader = gfx_shader_get(pfx->shader_id);
-    float texelsz[] = {1.0f/(float)pfx->rt->desc.rt.width, 1.0f/(float)pfx->rt->desc.rt.height};
+    float texelsz[] = {1.0f/(float)rt->desc.rt.width, 1.0f/(float)rt->desc.rt.height};
 
-    gfx_output_setrendertarget(cmdqueue, pfx->rt);
-    gfx_output_setviewport(cmdqueue, 0, 0, pfx->rt->desc.rt.width, pfx->rt->desc.rt.height);
+    gfx_output_setrendertarget(cmdqueue, rt);
+    gfx_output_setviewport(cmdqueue, 0, 0, rt->desc.rt.width, rt->desc.rt.height);
     gfx_shader_bind(cmdqueue, shader);
     gfx_shader_bindsamplertexture(cmdqueue, shader, SHADER_NAME(s_rgbl), pfx->sampl_lin,
         rgbl_tex);
@@ -1536,7 +1398,6 @@ gfx_texture gfx_pfx_fxaa_render(gfx_cmdqueue cmdqueue, struct gfx_pfx_fxaa* pfx,
     gfx_draw_fullscreenquad();
 
     PRF_CLOSESAMPLE();  /* postfx-fxaa */
-    return pfx->tex;
 }
 
 /*************************************************************************************************/
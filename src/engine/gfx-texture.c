@@ -42,10 +42,19 @@ void dds_get_surfaceinfo(uint width, uint height, enum gfx_format fmt,
 		OUT uint* size, OUT uint* rowsize, OUT uint* rowcnt);
 uint gfx_texture_getbpp(enum gfx_format fmt);
 enum gfx_format dds_conv_tosrgb(enum gfx_format fmt);
+gfx_texture dds_load_mem(struct allocator* tmp_alloc, const char* name, uint8* file_data,
+    size_t file_size, int writable, uint first_mipidx, uint size_max, int srgb, uint thread_id,
+    OUT OPTIONAL uint* mip_cnt);
 
 /*************************************************************************************************/
 gfx_texture gfx_texture_loaddds(const char* dds_filepath, uint first_mipidx,
 		int srgb, uint thread_id)
+{
+    return gfx_texture_loaddds_mips(dds_filepath, first_mipidx, 0, srgb, thread_id, NULL);
+}
+
+gfx_texture gfx_texture_loaddds_mips(const char* dds_filepath, uint first_mipidx, uint size_max,
+    int srgb, uint thread_id, OUT OPTIONAL uint* mip_cnt)
 {
 	/* TODO: get tmp allocator based on thread_id */
 	struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
@@ -58,21 +67,48 @@ gfx_texture gfx_texture_loaddds(const char* dds_filepath, uint first_mipidx,
 		return NULL;
 	}
 
-    /* header */
-    uint sign;
-    struct dds_header header;
+    /* detach file memory and parse it in place, mip data is handed to the texture without copying,
+     * so the memory is kept until gpu objects are filled */
+    size_t file_size;
+    uint8* file_data = (uint8*)fio_detachmem(f, &file_size, NULL);
+    fio_close(f);
 
-    fio_read(f, &sign, sizeof(sign), 1);
-    if( sign != DDS_MAGIC )		{
-        A_LOAD(tmp_alloc);
-        err_printf(__FILE__, __LINE__, "load dds '%s' failed: invalid file format", dds_filepath);
+    gfx_texture tex = dds_load_mem(tmp_alloc, dds_filepath, file_data, file_size, TRUE,
+        first_mipidx, size_max, srgb, thread_id, mip_cnt);
+
+	A_FREE(tmp_alloc, file_data);
+	A_LOAD(tmp_alloc);
+	return tex;
+}
+
+gfx_texture gfx_texture_loaddds_mem(const char* name, const void* data, size_t size,
+    uint first_mipidx, uint size_max, int srgb, uint thread_id, OUT OPTIONAL uint* mip_cnt)
+{
+	struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+	A_SAVE(tmp_alloc);
+    gfx_texture tex = dds_load_mem(tmp_alloc, name, (uint8*)data, size, FALSE, first_mipidx,
+        size_max, srgb, thread_id, mip_cnt);
+	A_LOAD(tmp_alloc);
+	return tex;
+}
+
+/* parses dds file data and creates the texture, if 'writable' is FALSE, the data is never
+ * modified (textures that need swizzling are copied to tmp_alloc first) */
+gfx_texture dds_load_mem(struct allocator* tmp_alloc, const char* name, uint8* file_data,
+    size_t file_size, int writable, uint first_mipidx, uint size_max, int srgb, uint thread_id,
+    OUT OPTIONAL uint* mip_cnt)
+{
+    /* header */
+    const size_t hdr_size = sizeof(uint) + sizeof(struct dds_header);
+    if (file_size < hdr_size || *((const uint*)file_data) != DDS_MAGIC)	{
+        err_printf(__FILE__, __LINE__, "load dds '%s' failed: invalid file format", name);
         return NULL;
     }
 
-    fio_read(f, &header, sizeof(header), 1);
+    struct dds_header header;
+    memcpy(&header, file_data + sizeof(uint), sizeof(header));
     if (header.size != sizeof(header) || header.ddspf.size != sizeof(struct dds_pixel_fmt))	{
-        A_LOAD(tmp_alloc);
-        err_printf(__FILE__, __LINE__, "load dds '%s' failed: invalid header", dds_filepath);
+        err_printf(__FILE__, __LINE__, "load dds '%s' failed: invalid header", name);
         return NULL;
     }
 
@@ -81,30 +117,44 @@ gfx_texture gfx_texture_loaddds(const char* dds_filepath, uint first_mipidx,
     if(BIT_CHECK(header.ddspf.flags, DDS_FOURCC) &&
        MAKEFOURCC('D', 'X', '1', '0') == header.ddspf.fourcc)
     {
-        A_LOAD(tmp_alloc);
         err_printf(__FILE__, __LINE__, "load dds '%s' failed:"
-        		"dx10 specific textures are not supported", dds_filepath);
+        		"dx10 specific textures are not supported", name);
         return NULL;
     }
 
-    /* detach memory and read bits */
-    size_t cur_offset = fio_getpos(f);
-    size_t bits_size = fio_getsize(f) - cur_offset;
-    size_t file_size;
-    uint8* file_data = (uint8*)fio_detachmem(f, &file_size, NULL);
-    fio_close(f);
+    /* skip the mips that are larger than requested size */
+    uint file_mipcnt = maxui(1, header.mip_cnt);
+    if (size_max != 0)  {
+        first_mipidx = maxui(first_mipidx,
+            gfx_texture_selectmip(header.width, header.height, file_mipcnt, size_max));
+    }
+    if (mip_cnt != NULL)
+        *mip_cnt = file_mipcnt;
+
+    /* d3d9 argb textures are swizzled in place, so read-only data needs a copy */
+    uint8* bits = file_data + hdr_size;
+    uint bits_size = (uint)(file_size - hdr_size);
+    if (!writable && dds_get_format(&header.ddspf) == GFX_FORMAT_UNKNOWN &&
+        dds_is_argb(&header.ddspf))
+    {
+        bits = (uint8*)A_ALLOC(tmp_alloc, bits_size, MID_GFX);
+        if (bits == NULL)   {
+            err_printf(__FILE__, __LINE__, "load dds '%s' failed: out of memory", name);
+            return NULL;
+        }
+        memcpy(bits, file_data + hdr_size, bits_size);
+    }
 
 	gfx_texture tex = dds_create_texture(tmp_alloc, first_mipidx, srgb, &header,
-        file_data + cur_offset, (uint)bits_size, thread_id);
-
-	A_FREE(tmp_alloc, file_data);
-	A_LOAD(tmp_alloc);
+        bits, bits_size, thread_id);
 
     if (thread_id != 0 && tex != NULL)    {
         gfx_delayed_waitforobjects(thread_id);
         gfx_delayed_fillobjects(thread_id);
     }
 
+    if (bits != file_data + hdr_size)
+        A_FREE(tmp_alloc, bits);
 	return tex;
 }
 
@@ -116,7 +166,7 @@ gfx_texture dds_create_texture(struct allocator* tmp_alloc, uint first_mipidx, i
 	uint depth = header->depth;
 	uint mip_cnt = maxui(1, header->mip_cnt);
 	uint first_mip = minui(first_mipidx, mip_cnt-1);
-	uint target_mip_cnt = mip_cnt - first_mipidx;
+	uint target_mip_cnt = mip_cnt - first_mip;
 	const uint cubemap_all = DDS_CUBEMAP_ALLFACES;
 	enum gfx_texture_type type;
 
@@ -191,17 +241,17 @@ gfx_texture dds_create_texture(struct allocator* tmp_alloc, uint first_mipidx, i
 				data[idx].pitch_row = rowbyte_cnt;
 				data[idx].pitch_slice = 0;
 				idx ++;
+                actual_size += bytes_cnt;   /* only the mips that are loaded */
 			}
 
 			mip_idx ++;
 			src_bits += bytes_cnt;
-            actual_size += bytes_cnt;
 		}
 	}
 
 	/* shrink width, height to match first_mip */
-    int w = maxi(1, (int)floorf(width/powf(2.0f, (float)first_mipidx)));
-    int h = maxi(1, (int)floorf(height/powf(2.0f, (float)first_mipidx)));
+    int w = maxi(1, (int)floorf(width/powf(2.0f, (float)first_mip)));
+    int h = maxi(1, (int)floorf(height/powf(2.0f, (float)first_mip)));
 
 	/* gfx texture creation */
 	gfx_texture tex = gfx_create_texture(type,
@@ -217,6 +267,15 @@ gfx_texture dds_create_texture(struct allocator* tmp_alloc, uint first_mipidx, i
 	return tex;
 }
 
+uint gfx_texture_selectmip(uint width, uint height, uint mip_cnt, float size)
+{
+    uint dim = maxui(width, height);
+    uint mip = 0;
+    while (mip < mip_cnt - 1 && (float)(dim >> (mip + 1)) >= size)
+        mip ++;
+    return mip;
+}
+
 enum gfx_format dds_get_format(const struct dds_pixel_fmt* pf)
 {
     if (BIT_CHECK(pf->flags, DDS_RGB))    {
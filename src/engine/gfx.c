@@ -26,6 +26,7 @@
 #include "gfx-shader.h"
 #include "gfx-font.h"
 #include "gfx-canvas.h"
+#include "gfx-fgraph.h"
 #include "debug-hud.h"
 #include "mem-ids.h"
 #include "scene-mgr.h"
@@ -39,6 +40,7 @@
 #include "gfx-billboard.h"
 #include "res-mgr.h"
 #include "world-mgr.h"
+#include "skin-palette.h"
 
 #include "renderpaths/gfx-fwd.h"
 #include "renderpaths/gfx-deferred.h"
@@ -91,6 +93,26 @@ struct gfx_cull_stats
     uint csm_model_cnt;
 };
 
+/* instance record of a batch node, records of each node are linked while batching and ...
+ * packed together into tb_instances before rendering (see gfx_instances_upload) */
+struct gfx_instance_rec
+{
+    uint xform_idx; /* index of the world matrix in tb_xforms */
+    uint palette_idx;   /* skin palette offset (in bones), for skinned instances */
+    uint next;  /* next record of the same batch node, INVALID_INDEX for the last one */
+};
+
+/* frame-graph resources that are declared by the renderer itself */
+struct gfx_frame_res
+{
+    uint backbuffer;
+    uint passes[GFX_RENDERPASS_MAX];    /* output of each renderpass (bound by render-paths) */
+    uint ldr;   /* tonemapped output */
+    uint aa;    /* fxaa output */
+    uint bloom; /* owned by tonemap postfx, bound on execute */
+    uint final; /* composited into backbuffer */
+};
+
 struct gfx_fs_vertex
 {
     struct vec3f pos;
@@ -128,6 +150,27 @@ struct gfx_renderer
     struct gfx_device_info info;
     int rtv_width;
     int rtv_height;
+
+    /* skinning palette: poses of all passes are packed into one buffer and uploaded once */
+    struct gfx_cblock* tb_skins;
+    struct skin_palette skins;
+    uint skin_bytes;    /* uploaded palette bytes in last frame */
+
+    /* instance stream: world matrices are written once per frame and shared by all passes
+     * batch nodes only reference them through instance records in tb_instances */
+    struct gfx_cblock* tb_xforms;
+    struct gfx_cblock* tb_instances;
+    struct array inst_recs; /* item: gfx_instance_rec (frame memory) */
+    uint xform_frame;   /* increments every frame, see gfx_model_instance.xform_frame */
+    uint xform_cnt; /* written matrix count for current frame */
+    uint xform_bytes;   /* uploaded matrix and instance record bytes in last frame */
+    uint xform_copybytes;   /* bytes that copying matrices per pass and node would upload */
+    int xform_overflow; /* stream could not grow to hold all matrices or instances in last frame */
+
+    /* frame-graph: passes of the frame are declared, compiled and executed every frame */
+    struct gfx_fgraph* fg;
+    struct gfx_frame_res fres;
+    int dump_fgraph;    /* log the compiled graph in next frame */
 };
 
 /*************************************************************************************************
@@ -177,9 +220,37 @@ void gfx_renderpass_additem_transparent(struct scn_render_query* query, enum cmp
 
 void gfx_renderpass_process_sunshadow(struct allocator* alloc, const struct gfx_view_params* params);
 
-/* finally process render passes renders all (batched) passes by order */
-void gfx_process_renderpasses(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
-		const struct gfx_view_params* params);
+/* finally all (batched) passes and postfx are declared in frame-graph, which orders and ...
+ * culls them, render-paths with setup callback can declare multiple passes of their own */
+void gfx_build_framegraph(struct allocator* alloc, const struct gfx_view_params* params);
+void gfx_framepass_rpath(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_tonemap(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_fxaa(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_composite(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_blank(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_billboards(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_debug(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void gfx_framepass_2d(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+
+/* skinning palette, filled while batching and uploaded once before processing render passes */
+int gfx_skins_addpose(struct gfx_model_posegpu* pose);
+void gfx_skins_upload(gfx_cmdqueue cmdqueue);
+
+/* instance stream, matrices are written while batching, records are packed and uploaded ...
+ * once with the matrices before processing render passes */
+result_t gfx_stream_grow(struct gfx_cblock** pcb, const char* tb_name, uint size);
+uint gfx_xforms_add(const struct mat3f* mat);
+uint gfx_xforms_addnode(struct gfx_model_instance* inst, uint node_cnt, uint node_idx,
+    const struct mat3f* mat);
+void gfx_instances_upload(gfx_cmdqueue cmdqueue);
 
 /* data creation/allocation routines for batching/passes */
 struct gfx_renderpass* gfx_renderpass_create(struct allocator* alloc);
@@ -197,6 +268,7 @@ void gfx_destroy_fullscreenquad();
 result_t gfx_console_showcullinfo(uint argc, const char** argv, void* param);
 result_t gfx_console_showdrawinfo(uint argc, const char** argv, void* param);
 result_t gfx_console_showbounds(uint argc, const char** argv, void* param);
+result_t gfx_console_dumpfgraph(uint argc, const char** argv, void* param);
 int gfx_hud_rendercullinfo(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param);
 int gfx_hud_renderdrawinfo(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param);
 
@@ -315,6 +387,32 @@ result_t gfx_init(const struct gfx_params* params)
 		return RET_FAIL;
 	}
 
+    /* skinning palette */
+    g_gfx.tb_skins = gfx_shader_create_cblock_tbuffer(mem_heap(), NULL, "tb_skins",
+        SKIN_PALETTE_BONE_SIZE*GFX_SKIN_PALETTE_MAX);
+    if (g_gfx.tb_skins == NULL) {
+        err_print(__FILE__, __LINE__, "gfx-init failed: could not create skinning palette");
+        return RET_FAIL;
+    }
+    skin_palette_init(&g_gfx.skins, GFX_SKIN_PALETTE_MAX);
+
+    /* instance stream */
+    g_gfx.tb_xforms = gfx_shader_create_cblock_tbuffer(mem_heap(), NULL, "tb_xforms",
+        sizeof(struct vec4f)*3*GFX_XFORMS_INITCNT);
+    g_gfx.tb_instances = gfx_shader_create_cblock_tbuffer(mem_heap(), NULL, "tb_instances",
+        sizeof(struct vec4f)*GFX_INSTANCES_INITCNT);
+    if (g_gfx.tb_xforms == NULL || g_gfx.tb_instances == NULL) {
+        err_print(__FILE__, __LINE__, "gfx-init failed: could not create instance stream");
+        return RET_FAIL;
+    }
+
+    /* frame-graph */
+    g_gfx.fg = gfx_fg_create();
+    if (g_gfx.fg == NULL)   {
+        err_print(__FILE__, __LINE__, "gfx-init failed: could not create frame-graph");
+        return RET_FAIL;
+    }
+
 	/* render path manager */
 	if (IS_FAIL(gfx_rpath_init()) || !gfx_register_renderpaths())	{
 		err_printf(__FILE__, __LINE__, "gfx-init failed: could not initialize render-path system");
@@ -351,7 +449,7 @@ result_t gfx_init(const struct gfx_params* params)
     }
 
     if (BIT_CHECK(params->flags, GFX_FLAG_FXAA))    {
-        g_gfx.fxaa = gfx_pfx_fxaa_create(params->width, params->height);
+        g_gfx.fxaa = gfx_pfx_fxaa_create();
         if (g_gfx.fxaa == NULL) {
             err_print(__FILE__, __LINE__, "gfx-init failed: could not create fxaa postfx");
             return RET_FAIL;
@@ -387,6 +485,8 @@ result_t gfx_init(const struct gfx_params* params)
     con_register_cmd("gfx_cullinfo", gfx_console_showcullinfo, NULL, "gfx_cullinfo [1*/0]");
     con_register_cmd("gfx_drawinfo", gfx_console_showdrawinfo, NULL, "gfx_drawinfo [1*/0]");
     con_register_cmd("gfx_showbounds", gfx_console_showbounds, NULL, "gfx_showbounds [1*/0]");
+    if (BIT_CHECK(eng_get_params()->flags, ENG_FLAG_DEV))
+        con_register_cmd("gfx_dumpfgraph", gfx_console_dumpfgraph, NULL, "gfx_dumpfgraph");
 
     gfx_flush(gfx_get_cmdqueue(0));
 
@@ -420,6 +520,16 @@ void gfx_release()
 
 	gfx_rpath_release();
 
+    if (g_gfx.fg != NULL)
+        gfx_fg_destroy(g_gfx.fg);
+
+    if (g_gfx.tb_skins != NULL)
+        gfx_shader_destroy_cblock(g_gfx.tb_skins);
+    if (g_gfx.tb_xforms != NULL)
+        gfx_shader_destroy_cblock(g_gfx.tb_xforms);
+    if (g_gfx.tb_instances != NULL)
+        gfx_shader_destroy_cblock(g_gfx.tb_instances);
+
 	gfx_canvas_release();
 
 	gfx_font_releasemgr();
@@ -450,7 +560,6 @@ void gfx_render()
     struct gfx_view_params params;
     struct frustum viewfrust;
     struct allocator* tmp_alloc = tsk_get_tmpalloc(0);
-    struct gfx_renderpass* rpass;
     result_t r;
 
     g_gfx.preview_render = FALSE;
@@ -465,6 +574,12 @@ void gfx_render()
 	gfx_reset_framestats(cmdqueue);
     gfx_reset_devstates(cmdqueue);
 
+    skin_palette_begin(&g_gfx.skins);
+
+    g_gfx.xform_frame ++;
+    g_gfx.xform_cnt = 0;
+    g_gfx.xform_overflow = FALSE;
+
     /* render */
     params.width = width;
     params.height = height;
@@ -484,6 +599,8 @@ void gfx_render()
     /* create transparent objects arrays */
     r = arr_create(tmp_alloc, &trans_items, sizeof(struct gfx_transparent_item), 50, 200, MID_GFX);
     r |= arr_create(tmp_alloc, &trans_idxs, sizeof(uint), 50, 200, MID_GFX);
+    r |= arr_create(tmp_alloc, &g_gfx.inst_recs, sizeof(struct gfx_instance_rec), 1024, 1024,
+        MID_GFX);
     ASSERT(IS_OK(r));
 
     /* create primary pass (note that primary pass is actually rendered last in render passes) */
@@ -499,50 +616,183 @@ void gfx_render()
 
     gfx_occ_finish(cmdqueue, &params);
 
-    /* process all render passes */
-    gfx_process_renderpasses(cmdqueue, NULL, &params);
+    /* poses and instances of all passes are gathered by now */
+    gfx_skins_upload(cmdqueue);
+    gfx_instances_upload(cmdqueue);
+
+    /* declare all passes of the frame, compile (cull/alias) and render them */
+    gfx_fg_reset(g_gfx.fg);
+    gfx_build_framegraph(tmp_alloc, &params);
+    if (IS_OK(gfx_fg_compile(g_gfx.fg)))    {
+        if (g_gfx.dump_fgraph)  {
+            gfx_fg_dump(g_gfx.fg);
+            g_gfx.dump_fgraph = FALSE;
+        }
+        gfx_fg_execute(g_gfx.fg, cmdqueue, &params);
+    }   else    {
+        gfx_render_blank(cmdqueue, width, height);
+    }
+
+    A_LOAD(tmp_alloc);	/* free all memory of culling/batching */
+
+    PRF_CLOSESAMPLE();
+}
 
-    /* get possible data from primary render-pass and copy it into backbuffer */
-    rpass = g_gfx.passes[GFX_RENDERPASS_PRIMARY];
-    if (rpass != NULL && rpass->result.rt != NULL)  {
-        gfx_texture bloom_tex;
-        gfx_texture ldr_tex;
-        if (!g_gfx.preview_render)   {
-            /* do additional postfx */
+void gfx_build_framegraph(struct allocator* alloc, const struct gfx_view_params* params)
+{
+    static const char* pass_names[GFX_RENDERPASS_MAX] = {
+        "sunshadow", "spotshadow", "pointshadow", "mirror", "primary", "transparent"
+    };
+    struct gfx_fgraph* fg = g_gfx.fg;
+    struct gfx_frame_res* res = &g_gfx.fres;
+    uint pass;
+
+    res->backbuffer = gfx_fg_import(fg, "backbuffer", NULL, NULL);
+    gfx_fg_setoutput(fg, res->backbuffer);
+
+    /* render passes by order, each one is rendered into it's own resource */
+    for (uint i = 0; i < GFX_RENDERPASS_MAX; i++)   {
+        struct gfx_renderpass* rpass = g_gfx.passes[i];
+        res->passes[i] = INVALID_INDEX;
+        if (rpass == NULL || rpass->subpasses.item_cnt == 0)
+            continue;
+
+        res->passes[i] = gfx_fg_import(fg, pass_names[i], NULL, NULL);
+        for (int k = 0; k < rpass->subpasses.item_cnt; k++) {
+            struct gfx_renderpass_sub* subpass =
+                &((struct gfx_renderpass_sub*)rpass->subpasses.buffer)[k];
+            struct gfx_rpath_data* data = (struct gfx_rpath_data*)A_ALLOC(alloc,
+                sizeof(struct gfx_rpath_data), MID_GFX);
+            ASSERT(data);
+            data->rpath = subpass->rpath;
+            data->batch_items = (struct gfx_batch_item*)subpass->batch_items.buffer;
+            data->batch_cnt = subpass->batch_items.item_cnt;
+            data->userdata = rpass->userdata;
+            data->output_res = res->passes[i];
+            data->result = &rpass->result;
+
+            if (subpass->rpath->setup_fn != NULL)   {
+                subpass->rpath->setup_fn(fg, params, data);
+            }   else    {
+                pass = gfx_fg_addpass(fg, subpass->rpath->name, 0, gfx_framepass_rpath, data);
+                gfx_fg_write(fg, pass, data->output_res);
+            }
+        }
+    }
 
-            /* tonemapping */
-            ldr_tex = gfx_pfx_tonemap_render(cmdqueue, g_gfx.tonemap, &params,
-                (gfx_texture)rpass->result.rt->desc.rt.rt_textures[0], &bloom_tex);
+    /* postfx and composite of primary pass into backbuffer
+     * note: render-paths set preview flag in their setup */
+    uint primary = res->passes[GFX_RENDERPASS_PRIMARY];
+    res->ldr = INVALID_INDEX;
+    res->aa = INVALID_INDEX;
+    res->bloom = INVALID_INDEX;
+    res->final = primary;
+    if (primary != INVALID_INDEX)   {
+        if (!g_gfx.preview_render)  {
+            struct gfx_fg_texdesc desc = {(uint)params->width, (uint)params->height,
+                GFX_FORMAT_RGBA_UNORM};
+
+            res->ldr = gfx_fg_transient(fg, "ldr", &desc);
+            res->bloom = gfx_fg_import(fg, "bloom", NULL, NULL);
+            pass = gfx_fg_addpass(fg, "tonemap", 0, gfx_framepass_tonemap, NULL);
+            gfx_fg_read(fg, pass, primary);
+            gfx_fg_write(fg, pass, res->ldr);
+            gfx_fg_write(fg, pass, res->bloom);
+            res->final = res->ldr;
 
-            /* fxaa */
             if (g_gfx.fxaa != NULL) {
-                gfx_texture aa_tex = gfx_pfx_fxaa_render(cmdqueue, g_gfx.fxaa, ldr_tex);
-                ldr_tex = aa_tex;
+                res->aa = gfx_fg_transient(fg, "aa", &desc);
+                pass = gfx_fg_addpass(fg, "fxaa", 0, gfx_framepass_fxaa, NULL);
+                gfx_fg_read(fg, pass, res->ldr);
+                gfx_fg_write(fg, pass, res->aa);
+                res->final = res->aa;
             }
-        }   else    {
-            ldr_tex = (gfx_texture)rpass->result.rt->desc.rt.rt_textures[0];
-            bloom_tex = NULL;
         }
 
-        gfx_output_setrendertarget(cmdqueue, NULL);
-        gfx_output_setviewportbias(g_gfx.cmdqueue, 0, 0, width, height);
-        gfx_composite_render(g_gfx.cmdqueue, ldr_tex,
-            (gfx_texture)rpass->result.rt->desc.rt.ds_texture, bloom_tex);
+        /* primary is also read for it's depth buffer */
+        pass = gfx_fg_addpass(fg, "composite", 0, gfx_framepass_composite, NULL);
+        gfx_fg_read(fg, pass, res->final);
+        gfx_fg_read(fg, pass, res->bloom);
+        gfx_fg_read(fg, pass, primary);
+        gfx_fg_write(fg, pass, res->backbuffer);
     }   else    {
-        gfx_render_blank(cmdqueue, width, height);
+        pass = gfx_fg_addpass(fg, "blank", 0, gfx_framepass_blank, NULL);
+        gfx_fg_write(fg, pass, res->backbuffer);
     }
 
-    A_LOAD(tmp_alloc);	/* free all memory of culling/batching */
+    /* overlays */
+    pass = gfx_fg_addpass(fg, "billboards", 0, gfx_framepass_billboards, NULL);
+    gfx_fg_write(fg, pass, res->backbuffer);
+    pass = gfx_fg_addpass(fg, "debug", 0, gfx_framepass_debug, NULL);
+    gfx_fg_write(fg, pass, res->backbuffer);
+    pass = gfx_fg_addpass(fg, "2d", 0, gfx_framepass_2d, NULL);
+    gfx_fg_write(fg, pass, res->backbuffer);
+}
 
-    PRF_CLOSESAMPLE();
+/* param: gfx_rpath_data */
+void gfx_framepass_rpath(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_rpath_data* data = (struct gfx_rpath_data*)param;
+    data->rpath->render_fn(cmdqueue, NULL, params, data->batch_items, data->batch_cnt,
+        data->userdata, data->result);
+    gfx_fg_bindimport(fg, data->output_res, NULL, data->result->rt);
+}
+
+void gfx_framepass_tonemap(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_frame_res* res = &g_gfx.fres;
+    gfx_texture bloom_tex;
+    gfx_pfx_tonemap_render(cmdqueue, g_gfx.tonemap, params,
+        gfx_fg_gettexture(fg, res->passes[GFX_RENDERPASS_PRIMARY]),
+        gfx_fg_getrendertarget(fg, res->ldr), &bloom_tex);
+    gfx_fg_bindimport(fg, res->bloom, bloom_tex, NULL);
+}
 
-    gfx_blb_render(cmdqueue, &params);
+void gfx_framepass_fxaa(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_frame_res* res = &g_gfx.fres;
+    gfx_pfx_fxaa_render(cmdqueue, g_gfx.fxaa, gfx_fg_gettexture(fg, res->ldr),
+        gfx_fg_getrendertarget(fg, res->aa));
+}
 
-    /* debug render */
+void gfx_framepass_composite(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_frame_res* res = &g_gfx.fres;
+    gfx_rendertarget primary_rt = gfx_fg_getrendertarget(fg, res->passes[GFX_RENDERPASS_PRIMARY]);
+    if (primary_rt == NULL) {
+        gfx_render_blank(cmdqueue, params->width, params->height);
+        return;
+    }
+
+    gfx_output_setrendertarget(cmdqueue, NULL);
+    gfx_output_setviewportbias(cmdqueue, 0, 0, params->width, params->height);
+    gfx_composite_render(cmdqueue, gfx_fg_gettexture(fg, res->final),
+        (gfx_texture)primary_rt->desc.rt.ds_texture, gfx_fg_gettexture(fg, res->bloom));
+}
+
+void gfx_framepass_blank(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    gfx_render_blank(cmdqueue, params->width, params->height);
+}
+
+void gfx_framepass_billboards(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    gfx_blb_render(cmdqueue, params);
+}
+
+void gfx_framepass_debug(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
     PRF_OPENSAMPLE("debug-render");
-    gfx_canvas_begin3d(cmdqueue, widthf, heightf, &params.viewproj);
+    gfx_canvas_begin3d(cmdqueue, (float)params->width, (float)params->height, &params->viewproj);
     /* component debug render */
-    cmp_debug(0.0f, &params);
+    cmp_debug(0.0f, params);
 
     /* additional debug draw ? */
     if (g_gfx.show_worldbounds) {
@@ -554,13 +804,17 @@ void gfx_render()
     }
 
     if (g_gfx.debug_render_fn != NULL)
-		g_gfx.debug_render_fn(g_gfx.cmdqueue, &params);
+		g_gfx.debug_render_fn(cmdqueue, params);
     gfx_canvas_end3d();
     PRF_CLOSESAMPLE();
+}
 
+void gfx_framepass_2d(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
     PRF_OPENSAMPLE("2d-render");
-	hud_render(g_gfx.cmdqueue);
-	gfx_canvas_render2d(g_gfx.cmdqueue, NULL, widthf, heightf);
+	hud_render(cmdqueue);
+	gfx_canvas_render2d(cmdqueue, NULL, (float)params->width, (float)params->height);
     PRF_CLOSESAMPLE();
 }
 
@@ -616,7 +870,7 @@ int gfx_register_renderpaths()
     rpath.init_fn = gfx_deferred_init;
     rpath.release_fn = gfx_deferred_release;
     rpath.getshader_fn = gfx_deferred_getshader;
-    rpath.render_fn = gfx_deferred_render;
+    rpath.setup_fn = gfx_deferred_setup;
     rpath.resize_fn = gfx_deferred_resize;
 
     rpflags = GFX_RPATH_RAW | GFX_RPATH_ALPHAMAP | GFX_RPATH_DIFFUSEMAP | GFX_RPATH_NORMALMAP |
@@ -631,6 +885,7 @@ int gfx_register_renderpaths()
     rpath.release_fn = gfx_csm_release;
     rpath.getshader_fn = gfx_csm_getshader;
     rpath.render_fn = gfx_csm_render;
+    rpath.setup_fn = gfx_csm_setup;
     rpath.resize_fn = gfx_csm_resize;
     r = gfx_rpath_register(CMP_OBJTYPE_MODEL, rpflags | GFX_RPATH_CSMSHADOW, &rpath);
     if (IS_FAIL(r))
@@ -918,6 +1173,10 @@ void gfx_renderpass_process_sunshadow(struct allocator* alloc, const struct gfx_
     ASSERT(rq != NULL);
     g_gfx.cull_stats.csm_model_cnt = rq->model_cnt;
 
+    /* cull casters against each cascade, casters that don't touch any cascade are skipped */
+    const uint* cascade_masks = gfx_csm_cullcasters(alloc, rq->aabbs, rq->dynamics,
+        rq->caster_ids, rq->aabb_cnt);
+
     for (uint i = 0, cnt = rq->model_cnt; i < cnt; i++)   {
  		struct scn_render_model* rmodel = &rq->models[i];
 		struct gfx_model* gmodel = rmodel->gmodel;
@@ -926,12 +1185,16 @@ void gfx_renderpass_process_sunshadow(struct allocator* alloc, const struct gfx_
 		struct gfx_model_node* mnode = &gmodel->nodes[rmodel->node_idx];
 		struct gfx_model_mesh* mmesh = &gmodel->meshes[mnode->mesh_id];
 
-        /* make unique-id from geometry(pointer) only (no material/texture data needed) */
-#if defined(_X64_)
-        uint unique_id = hash_u64((uint64)&gmodel->geos[mmesh->geo_id]);
-#else
-        uint unique_id = (uint)&gmodel->geos[mmesh->geo_id];
-#endif
+        uint cascade_mask = (cascade_masks != NULL) ?
+            cascade_masks[rmodel->bounds_idx] : 0xffffffff;
+        if (cascade_mask == 0)
+            continue;
+
+        /* make unique-id from geometry(pointer) and cascade mask (no material/texture data needed)
+         * so each batch node only holds instances that are drawn into the same cascades
+         * (mask includes GFX_CSM_CASTER_DYNAMIC, so static and dynamic casters are split too) */
+        uint unique_id = hash_u64((uint64)(uptr_t)&gmodel->geos[mmesh->geo_id] ^
+            ((uint64)cascade_mask << 56));
 
         /* check if whole model has alpha materials, then treat all-solid object differently
          * all-solid objects are drawn with one call
@@ -1019,16 +1282,18 @@ result_t gfx_renderpass_initsubdata(struct allocator* alloc, struct gfx_renderpa
 /**
  * batching algorithm:
  * data:
- * batch(shader_id #1) --> batch_node(unique_id #1)/subidx --> linked_list(instances)
- *                      batch_node(unique_id #2)/subidx --> linked_list(instances)
- * batch(shader_id #2) --> batch_node(unique_id #1)/subidx --> linked_list(instances)
- *                      batch_node(unique_id #2)/subidx --> linked_list(instances)
+ * batch(shader_id #1) --> batch_node(unique_id #1)/subidx --> records(instances)
+ *                      batch_node(unique_id #2)/subidx --> records(instances)
+ * batch(shader_id #2) --> batch_node(unique_id #1)/subidx --> records(instances)
+ *                      batch_node(unique_id #2)/subidx --> records(instances)
  * method: incoming item ...
- *   1) first we search look in shader table, search for shader_id, if not found, create new batch
- *   2) look in batch's unique_id table, if not found, create a new empty batch_node (see data), else ...
- *   3) add new batch_node to batch_item's nodes
- *   4) if the batch_node exists, check if we reach instance_cnt limit in the linked_list of nodes
- *   5) if there is no room for more items, add new batch_node to the linked_list of the first batch node
+ *   1) write item's world matrix to the frame xform stream (once per frame, see gfx_xforms_addnode)
+ *      the stream grows on demand, items are only dropped if it can't grow
+ *   2) first we search look in shader table, search for shader_id, if not found, create new batch
+ *   3) look in batch's unique_id table, if not found, create a new empty batch_node (see data), else ...
+ *   4) add new batch_node to batch_item's nodes
+ *   5) link a new instance record (matrix index, skin offset) to the batch node, records of each
+ *      node are packed together by gfx_instances_upload, so there is no limit on instance count
  */
 void gfx_renderpass_additem_tosubpass(struct allocator* alloc,
     struct gfx_renderpass_sub* rpdata,
@@ -1041,6 +1306,26 @@ void gfx_renderpass_additem_tosubpass(struct allocator* alloc,
 {
     uint shader_id = rpass_item->shader_id;
 
+    /* skinned models that don't fit into the frame's palette are not drawn */
+    struct gfx_model_posegpu* pose = NULL;
+    if (objtype == CMP_OBJTYPE_MODEL)   {
+        pose = ((struct scn_render_model*)ritem)->pose;
+        if (pose != NULL && !gfx_skins_addpose(pose))
+            return;
+    }
+
+    /* write the matrix, instances that don't fit into the xform stream are not drawn */
+    uint xform_idx;
+    if (objtype == CMP_OBJTYPE_MODEL)   {
+        struct scn_render_model* rmodel = (struct scn_render_model*)ritem;
+        xform_idx = gfx_xforms_addnode(rmodel->inst, rmodel->gmodel->node_cnt,
+            rmodel->node_idx, tmat);
+    }   else    {
+        xform_idx = gfx_xforms_add(tmat);
+    }
+    if (xform_idx == INVALID_INDEX)
+        return;
+
     /* find shader-id in the batches */
     struct hashtable_item_chained* item = hashtable_chained_find(&rpdata->shader_table, shader_id);
     struct gfx_batch_item* bitem;
@@ -1054,39 +1339,37 @@ void gfx_renderpass_additem_tosubpass(struct allocator* alloc,
         hashtable_chained_add(&rpdata->shader_table, shader_id, rpdata->batch_items.item_cnt-1);
     }
 
-    /* find unique-id (batch-node) in the batch-item */
+    /* find unique-id (batch-node) in the batch-item
+     * (keep index instead of pointer, nodes buffer may grow) */
     struct hashtable_item_chained* subitem = hashtable_chained_find(&bitem->uid_table, unique_id);
     struct gfx_batch_node* bnode;
     if (subitem != NULL)    {
-        struct gfx_batch_node* bnode_first = (struct gfx_batch_node*)subitem->value;
-        /* the first bnode in the list, is always the last node that we added, so ...
-         * check for instance_cnt of the last_node and see if we need more bnodes */
-        bnode = (bnode_first->bll != NULL) ? (struct gfx_batch_node*)bnode_first->bll->data :
-            bnode_first;
-
-        if (bnode->instance_cnt >= GFX_INSTANCES_MAX)   {
-        	struct gfx_batch_node* bnode_new = (struct gfx_batch_node*)
-                A_ALLOC(alloc, sizeof(struct gfx_batch_node), MID_GFX);
-        	ASSERT(bnode_new);
-            gfx_batch_initnode(alloc, bnode_new, unique_id, sub_idx, ritem);
-            list_add(&bnode_first->bll, &bnode_new->lnode, bnode_new);
-            bnode = bnode_new;
-        }
+        bnode = &((struct gfx_batch_node*)bitem->nodes.buffer)[subitem->value];
     }   else    {
-    	/* this is the first item, add it to the batches and the list */
+    	/* this is the first item, add it to the batches */
         bnode = (struct gfx_batch_node*)arr_add(&bitem->nodes);
         ASSERT(bnode);
         gfx_batch_initnode(alloc, bnode, unique_id, sub_idx, ritem);
-        hashtable_chained_add(&bitem->uid_table, unique_id, (uptr_t)bnode);
-        list_add(&bnode->bll, &bnode->lnode, bnode);
+        hashtable_chained_add(&bitem->uid_table, unique_id, bitem->nodes.item_cnt-1);
     }
 
     /* add an instance to the batch */
-    uint idx = bnode->instance_cnt;
-    bnode->instance_mats[idx] = tmat;
-    if (objtype == CMP_OBJTYPE_MODEL)
-        bnode->poses[idx] = ((struct scn_render_model*)ritem)->pose;
+    struct gfx_instance_rec* rec = (struct gfx_instance_rec*)arr_add(&g_gfx.inst_recs);
+    ASSERT(rec);
+    rec->xform_idx = xform_idx;
+    rec->palette_idx = 0;
+    rec->next = INVALID_INDEX;
+    if (pose != NULL)   {
+        rec->palette_idx = pose->palette_idx;
+        bnode->skinned = TRUE;
+    }
 
+    uint rec_idx = g_gfx.inst_recs.item_cnt - 1;
+    if (bnode->rec_last != INVALID_INDEX)
+        ((struct gfx_instance_rec*)g_gfx.inst_recs.buffer)[bnode->rec_last].next = rec_idx;
+    else
+        bnode->rec_first = rec_idx;
+    bnode->rec_last = rec_idx;
     bnode->instance_cnt++;
 }
 
@@ -1105,34 +1388,174 @@ void gfx_batch_initnode(struct allocator* alloc, struct gfx_batch_node* bnode, u
     uint sub_idx, void* ritem)
 {
     bnode->instance_cnt = 0;
-    bnode->bll = NULL;
-    bnode->lnode.data = NULL;
-    bnode->lnode.next = NULL;
-    bnode->lnode.prev = NULL;
+    bnode->instance_offset = 0;
+    bnode->skinned = FALSE;
+    bnode->rec_first = INVALID_INDEX;
+    bnode->rec_last = INVALID_INDEX;
 
     bnode->unique_id = unique_id;
     bnode->sub_idx = sub_idx;
     bnode->ritem = ritem;
-    bnode->poses[0] = NULL;
-}
-
-void gfx_process_renderpasses(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
-		const struct gfx_view_params* params)
-{
-	for (uint i = 0; i < GFX_RENDERPASS_MAX; i++)	{
-		struct gfx_renderpass* rpass = g_gfx.passes[i];
-		if (rpass != NULL)	{
-			/* go through subpasses and pass them to their render-paths */
-			for (int k = 0; k < rpass->subpasses.item_cnt; k++)	{
-				struct gfx_renderpass_sub* subpass =
-						&((struct gfx_renderpass_sub*)rpass->subpasses.buffer)[k];
-				subpass->rpath->render_fn(cmdqueue, rt,
-                    (const struct gfx_view_params*)params,
-                    (struct gfx_batch_item*)subpass->batch_items.buffer,
-                    subpass->batch_items.item_cnt, rpass->userdata, &rpass->result);
-			}
-		}
-	}
+}
+
+/* packs pose's skinning matrices into the frame palette, once per frame no matter how many passes
+ * draw it. render-paths fetch the offset from pose->palette_idx
+ * returns FALSE if palette is full, the pose must not be drawn in this frame */
+int gfx_skins_addpose(struct gfx_model_posegpu* pose)
+{
+    uint offset = skin_palette_addpose(&g_gfx.skins, pose);
+    if (offset != INVALID_INDEX)    {
+        gfx_cb_set3mv_offset(g_gfx.tb_skins, 0, pose->skin_mats, pose->mat_cnt,
+            offset*SKIN_PALETTE_BONE_SIZE);
+    }
+    return pose->palette_idx != INVALID_INDEX;
+}
+
+void gfx_skins_upload(gfx_cmdqueue cmdqueue)
+{
+    uint size = skin_palette_getbytes(&g_gfx.skins);
+    g_gfx.skin_bytes = size;
+    if (size == 0)
+        return;
+
+    gfx_cb_set_endoffset(g_gfx.tb_skins, size);
+    gfx_shader_updatecblock(cmdqueue, g_gfx.tb_skins);
+}
+
+struct gfx_cblock* gfx_get_skinpalette()
+{
+    return g_gfx.tb_skins;
+}
+
+/* replaces tbuffer with a bigger one (at least twice the size), keeping it's cpu data
+ * render-paths fetch the streams when binding, so it's safe to call before rendering passes */
+result_t gfx_stream_grow(struct gfx_cblock** pcb, const char* tb_name, uint size)
+{
+    struct gfx_cblock* cb = *pcb;
+    size = maxui(size, cb->buffer_size*2);
+
+    struct gfx_cblock* newcb = gfx_shader_create_cblock_tbuffer(mem_heap(), NULL, tb_name, size);
+    if (newcb == NULL)
+        return RET_OUTOFMEMORY;
+
+    memcpy(newcb->cpu_buffer, cb->cpu_buffer, cb->buffer_size);
+    gfx_shader_destroy_cblock(cb);
+    *pcb = newcb;
+    log_printf(LOG_INFO, "gfx: %s grew to %dkb", tb_name, size/1024);
+    return RET_OK;
+}
+
+/* writes matrix into the frame's xform stream and returns it's index
+ * returns INVALID_INDEX if the stream could not grow, the instance must not be drawn */
+uint gfx_xforms_add(const struct mat3f* mat)
+{
+    uint offset = g_gfx.xform_cnt*sizeof(struct vec4f)*3;
+    if (offset + sizeof(struct vec4f)*3 > g_gfx.tb_xforms->buffer_size &&
+        IS_FAIL(gfx_stream_grow(&g_gfx.tb_xforms, "tb_xforms", offset + sizeof(struct vec4f)*3)))
+    {
+        g_gfx.xform_overflow = TRUE;
+        return INVALID_INDEX;
+    }
+
+    uint idx = g_gfx.xform_cnt++;
+    gfx_cb_set3mv_offset(g_gfx.tb_xforms, 0, mat, 1, offset);
+    return idx;
+}
+
+/* writes model node's world matrix into the xform stream, once per frame no matter how many
+ * passes draw it. model instance keeps the index of each node for the current frame */
+uint gfx_xforms_addnode(struct gfx_model_instance* inst, uint node_cnt, uint node_idx,
+    const struct mat3f* mat)
+{
+    if (inst->xform_frame != g_gfx.xform_frame) {
+        inst->xform_frame = g_gfx.xform_frame;
+        memset(inst->xform_idxs, 0xff, sizeof(uint)*node_cnt);
+    }
+
+    uint idx = inst->xform_idxs[node_idx];
+    if (idx == INVALID_INDEX)   {
+        idx = gfx_xforms_add(mat);
+        inst->xform_idxs[node_idx] = idx;
+    }
+    return idx;
+}
+
+/* packs instance records of each batch node next to each other (node->instance_offset), then
+ * uploads records and matrices of all passes once */
+void gfx_instances_upload(gfx_cmdqueue cmdqueue)
+{
+    /* every record is one drawn instance, grow the stream before packing */
+    uint recs_size = g_gfx.inst_recs.item_cnt*sizeof(struct vec4f);
+    if (recs_size > g_gfx.tb_instances->buffer_size &&
+        IS_FAIL(gfx_stream_grow(&g_gfx.tb_instances, "tb_instances", recs_size)))
+    {
+        g_gfx.xform_overflow = TRUE;
+    }
+    uint cnt_max = g_gfx.tb_instances->buffer_size/sizeof(struct vec4f);
+
+    struct vec4f* items = (struct vec4f*)g_gfx.tb_instances->cpu_buffer;
+    const struct gfx_instance_rec* recs = (const struct gfx_instance_rec*)g_gfx.inst_recs.buffer;
+    uint cnt = 0;
+    uint total_cnt = 0;
+
+    for (uint i = 0; i < GFX_RENDERPASS_MAX; i++)   {
+        struct gfx_renderpass* rpass = g_gfx.passes[i];
+        if (rpass == NULL)
+            continue;
+
+        for (int k = 0; k < rpass->subpasses.item_cnt; k++)   {
+            struct gfx_renderpass_sub* subpass =
+                &((struct gfx_renderpass_sub*)rpass->subpasses.buffer)[k];
+            struct gfx_batch_item* bitems = (struct gfx_batch_item*)subpass->batch_items.buffer;
+
+            for (int b = 0; b < subpass->batch_items.item_cnt; b++)   {
+                struct gfx_batch_node* bnodes = (struct gfx_batch_node*)bitems[b].nodes.buffer;
+
+                for (int n = 0; n < bitems[b].nodes.item_cnt; n++)   {
+                    struct gfx_batch_node* bnode = &bnodes[n];
+                    total_cnt += bnode->instance_cnt;
+
+                    if (cnt + bnode->instance_cnt > cnt_max)    {
+                        /* no room, skip drawing the node */
+                        g_gfx.xform_overflow = TRUE;
+                        bnode->instance_cnt = 0;
+                        continue;
+                    }
+
+                    bnode->instance_offset = cnt;
+                    for (uint r = bnode->rec_first; r != INVALID_INDEX; r = recs[r].next) {
+                        vec4_setf(&items[cnt++], (float)recs[r].xform_idx,
+                            (float)recs[r].palette_idx, 0.0f, 0.0f);
+                    }
+                }
+            }
+        }
+    }
+
+    uint xforms_size = g_gfx.xform_cnt*sizeof(struct vec4f)*3;
+    uint insts_size = cnt*sizeof(struct vec4f);
+    g_gfx.xform_bytes = xforms_size + insts_size;
+    g_gfx.xform_copybytes = total_cnt*sizeof(struct vec4f)*3;
+
+    if (xforms_size > 0)    {
+        gfx_cb_set_endoffset(g_gfx.tb_xforms, xforms_size);
+        gfx_shader_updatecblock(cmdqueue, g_gfx.tb_xforms);
+    }
+
+    if (insts_size > 0) {
+        gfx_cb_set_endoffset(g_gfx.tb_instances, insts_size);
+        gfx_shader_updatecblock(cmdqueue, g_gfx.tb_instances);
+    }
+}
+
+struct gfx_cblock* gfx_get_xformstream()
+{
+    return g_gfx.tb_xforms;
+}
+
+struct gfx_cblock* gfx_get_instancestream()
+{
+    return g_gfx.tb_instances;
 }
 
 void gfx_renderpass_additem_transparent(struct scn_render_query* query, enum cmp_obj_type objtype,
@@ -1298,6 +1721,27 @@ int gfx_hud_rendercullinfo(gfx_cmdqueue cmdqueue, int x, int y, int line_stride,
     gfx_canvas_text2dpt(str, x, y, 0);
     y += line_stride;
 
+    uint culled_cnt;
+    const uint* caster_cnts = gfx_csm_get_castercnts(&culled_cnt);
+    strcpy(str, "[gfx:shadowcsm] casters per cascade:");
+    for (uint i = 0, cnt = gfx_csm_get_cascadecnt(); i < cnt; i++)
+        sprintf(str + strlen(str), " %d", caster_cnts[i]);
+    sprintf(str + strlen(str), ", culled: %d", culled_cnt);
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+
+    struct gfx_csm_cachestats cstats;
+    gfx_csm_get_cachestats(&cstats);
+    sprintf(str, "[gfx:shadowcsm] static: %d, dynamic: %d, static layers redrawn: 0x%x, "
+        "copied: 0x%x", cstats.static_cnt, cstats.dynamic_cnt, cstats.redrawn_mask,
+        cstats.copied_mask);
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+    sprintf(str, "[gfx:shadowcsm] draws: %d (static: %d)", cstats.draw_cnt,
+        cstats.static_draw_cnt);
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+
     return y;
 }
 
@@ -1324,8 +1768,9 @@ void gfx_resize(uint width, uint height)
 
     /* resize postfx */
     gfx_pfx_tonemap_resize(g_gfx.tonemap, width, height);
-    if (g_gfx.fxaa != NULL)
-        gfx_pfx_fxaa_resize(g_gfx.fxaa, width, height);
+
+    /* transient targets are recreated with new size on next frame */
+    gfx_fg_releasepool(g_gfx.fg);
 }
 
 result_t gfx_composite_init()
@@ -1430,6 +1875,12 @@ result_t gfx_console_showbounds(uint argc, const char** argv, void* param)
     return RET_OK;
 }
 
+result_t gfx_console_dumpfgraph(uint argc, const char** argv, void* param)
+{
+    g_gfx.dump_fgraph = TRUE;
+    return RET_OK;
+}
+
 int gfx_hud_renderdrawinfo(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param)
 {
     const struct gfx_framestats* s = gfx_get_framestats(g_gfx.cmdqueue);
@@ -1471,6 +1922,26 @@ int gfx_hud_renderdrawinfo(gfx_cmdqueue cmdqueue, int x, int y, int line_stride,
     gfx_canvas_text2dpt(str, x, y, 0);
     y += line_stride;
 
+    sprintf(str, "skin-upload: %dkb%s", g_gfx.skin_bytes/1024,
+        g_gfx.skins.overflow ? " (overflow)" : "");
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+
+    /* compare with the amount that per-pass copy of matrices would upload */
+    sprintf(str, "xform-upload: %dkb (per-pass: %dkb)%s", g_gfx.xform_bytes/1024,
+        g_gfx.xform_copybytes/1024, g_gfx.xform_overflow ? " (overflow)" : "");
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+
+    /* transient memory with and without aliasing */
+    struct gfx_fg_stats fgs;
+    gfx_fg_getstats(g_gfx.fg, &fgs);
+    sprintf(str, "frame-graph: %d passes (%d culled), targets: %d/%d (%dkb/%dkb)", fgs.pass_cnt,
+        fgs.culled_cnt, fgs.target_cnt, fgs.transient_cnt, (uint)(fgs.target_bytes/1024),
+        (uint)(fgs.transient_bytes/1024));
+    gfx_canvas_text2dpt(str, x, y, 0);
+    y += line_stride;
+
     return y;
 }
 
@@ -32,6 +32,7 @@
 #include "mem-ids.h"
 #include "gfx.h"
 #include "gfx-texture.h"
+#include "staging-ring.h"
 
 #ifndef APIENTRY
 #define APIENTRY
@@ -52,6 +53,11 @@
 #define GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
 #define GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049 
 
+/* delayed (loader thread) object creation */
+#define GFX_UPLOAD_BUDGET_DEFAULT 4096  /* kb of object data created per frame */
+#define GFX_STAGING_FRAMES 3    /* staging buffer size = budget*frames, uploads in flight */
+#define GFX_STAGING_NONE STAGING_RING_NONE
+
 /*************************************************************************************************
  * Types
  */
@@ -73,13 +79,14 @@ struct gfx_dev_delayed_item
     struct gfx_dev_delayed_signal* signal;
     struct linked_list lnode;
     void* mapped;
+    uint64 staging_pos; /* position in persistent staging buffer, =GFX_STAGING_NONE if not staged */
 
     union   {
         struct {
             enum gfx_buffer_type type;
             enum gfx_mem_hint memhint;
             uint size;
-            void* data;
+            const void* data;   /* owned by loader, valid until gfx_delayed_fillobjects */
         } buff;
 
         struct {
@@ -92,7 +99,7 @@ struct gfx_dev_delayed_item
             uint array_size;
             uint total_size;
             enum gfx_mem_hint memhint;
-            void* data;
+            const void* data;   /* owned by loader, valid until gfx_delayed_fillobjects */
             struct gfx_subresource_data* subress;
         } tex;
 
@@ -108,6 +115,15 @@ struct gfx_dev_delayed_item
     } params;
 };
 
+/* persistently mapped upload buffer for textures of loader threads (ARB_buffer_storage)
+ * positions are monotonic, buffer offset = position % size (see staging-ring.h) */
+struct gfx_dev_staging
+{
+    GLuint pbo;
+    uint8* mapped;  /* =NULL if not supported */
+    struct staging_ring ring;   /* fence sync objects are GLsync */
+};
+
 struct gfx_device
 {
 	struct gfx_params params;
@@ -124,6 +140,10 @@ struct gfx_device
     mt_event objcreate_event;
     struct array objcreate_signals; /* item: gfx_dev_delayed_signal */
     int release_delayed;
+    uint delayed_bytes_max; /* object data that is created per frame (gfx_delayed_createobjects) */
+    uint delayed_objs_max;  /* =0: unlimited */
+    uint delayed_deferred_cnt;  /* creates that are postponed by the budget */
+    struct gfx_dev_staging staging;
 
     enum gfx_hwver ver;
 };
@@ -161,6 +181,10 @@ gfx_buffer gfx_delayed_createbuffer(enum gfx_buffer_type type, enum gfx_mem_hint
 void gfx_delayed_releaseitem(struct gfx_dev_delayed_item* citem);
 struct gfx_dev_delayed_signal* gfx_delayed_getsignal(uint thread_id);
 struct gfx_dev_delayed_signal* gfx_delayed_createsignal(uint thread_id);
+void gfx_staging_init(uint size);
+void gfx_staging_release();
+void gfx_staging_reclaim();
+void gfx_staging_fence();
 
 void APIENTRY gfx_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
     GLsizei length, const GLchar* message, GLvoid* user_param);
@@ -187,6 +211,27 @@ INLINE void destroy_obj(struct gfx_obj_data* obj)
     mem_pool_free(&g_gfxdev.obj_pool, obj);
 }
 
+/* returns position of the allocated staging memory, =GFX_STAGING_NONE if it doesn't fit */
+INLINE uint64 gfx_staging_alloc(struct gfx_dev_staging* st, uint size)
+{
+    if (st->mapped == NULL)
+        return GFX_STAGING_NONE;
+    return staging_ring_alloc(&st->ring, size);
+}
+
+/* size of the data that is uploaded for the object, used for per-frame budget */
+INLINE uint gfx_delayed_itemsize(const struct gfx_dev_delayed_item* citem)
+{
+    switch (citem->obj->type)   {
+    case GFX_OBJ_BUFFER:
+        return citem->params.buff.size;
+    case GFX_OBJ_TEXTURE:
+        return citem->params.tex.total_size;
+    default:
+        return 0;
+    }
+}
+
 INLINE void shader_output_error(GLuint shader)
 {
 	char err_info[1000];
@@ -320,6 +365,11 @@ result_t gfx_initdev(const struct gfx_params* params)
     if (IS_FAIL(r))
         return RET_OUTOFMEMORY;
 
+    g_gfxdev.delayed_bytes_max = (params->upload_budget != 0 ?
+        params->upload_budget : GFX_UPLOAD_BUDGET_DEFAULT)*1024;
+    g_gfxdev.delayed_objs_max = params->upload_objs_max;
+    gfx_staging_init(g_gfxdev.delayed_bytes_max*GFX_STAGING_FRAMES);
+
 	return RET_OK;
 }
 
@@ -333,6 +383,7 @@ void gfx_releasedev()
         if (s->stream_pbo != 0)
             glDeleteBuffers(1, &s->stream_pbo);
     }
+    gfx_staging_release();
 
     mt_mutex_release(&g_gfxdev.objcreate_mtx);
     if (g_gfxdev.objcreate_event != NULL)
@@ -358,6 +409,7 @@ gfx_inputlayout gfx_delayed_createinputlayout(const struct gfx_input_vbuff_desc*
     if (citem == NULL)
         return NULL;
     memset(citem, 0x00, sizeof(struct gfx_dev_delayed_item));
+    citem->staging_pos = GFX_STAGING_NONE;
 
     /* gfx object */
     gfx_inputlayout obj = create_obj(0, GFX_OBJ_INPUTLAYOUT);
@@ -398,7 +450,7 @@ gfx_inputlayout gfx_delayed_createinputlayout(const struct gfx_input_vbuff_desc*
     struct gfx_dev_delayed_signal* s = gfx_delayed_createsignal(thread_id);
     s->pending_cnt ++;
     citem->signal = s;
-    list_add(&g_gfxdev.objcreates, &citem->lnode, citem);
+    list_addlast(&g_gfxdev.objcreates, &citem->lnode, citem);
     mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
 
     return obj;
@@ -691,12 +743,19 @@ void gfx_destroy_program(gfx_program prog)
 	destroy_obj(prog);
 }
 
-/* runs in main thread */
+/* runs in main thread
+ * Objects are created in request order, until the per-frame budget is used up (at least one object
+ * is created on each call), the rest are postponed to next frames so big loads don't spike a frame */
 void gfx_delayed_createobjects()
 {
     if (!mt_mutex_try(&g_gfxdev.objcreate_mtx))
         return;
 
+    struct gfx_dev_staging* st = &g_gfxdev.staging;
+    uint budget_bytes = 0;
+    uint budget_objs = 0;
+    gfx_staging_reclaim();
+
     struct linked_list* lnode = g_gfxdev.objcreates;
     while (lnode != NULL)   {
         struct gfx_dev_delayed_item* citem = (struct gfx_dev_delayed_item*)lnode->data;
@@ -706,8 +765,15 @@ void gfx_delayed_createobjects()
         struct gfx_dev_delayed_signal* s = citem->signal;
         ASSERT(s);
 
+        uint item_size = gfx_delayed_itemsize(citem);
+        int in_budget = budget_objs == 0 || item_size == 0 ||
+            ((budget_bytes + item_size) <= g_gfxdev.delayed_bytes_max &&
+            (g_gfxdev.delayed_objs_max == 0 || budget_objs < g_gfxdev.delayed_objs_max));
+
         /* important: if not created,then proceed */
-        if (citem->mapped == NULL)  {
+        if (citem->mapped == NULL && !in_budget)    {
+            g_gfxdev.delayed_deferred_cnt ++;
+        }   else if (citem->mapped == NULL)  {
             switch (obj->type)  {
             case GFX_OBJ_BUFFER:
                 {
@@ -732,6 +798,26 @@ void gfx_delayed_createobjects()
                 break;
             case GFX_OBJ_TEXTURE:
                 {
+                    /* stage in persistent buffer, postpone if it's full of uploads in flight.
+                     * textures that are larger than staging buffer use the thread's own pbo */
+                    uint64 pos = gfx_staging_alloc(st, citem->params.tex.total_size);
+                    if (pos != GFX_STAGING_NONE) {
+                        uint offset = (uint)(pos % st->ring.size);
+                        uint subres_cnt = citem->params.tex.mip_cnt*citem->params.tex.array_size;
+                        for (uint i = 0; i < subres_cnt; i++)   {
+                            struct gfx_subresource_data* subres = &citem->params.tex.subress[i];
+                            subres->p = (uint8*)subres->p + offset;
+                        }
+                        citem->staging_pos = pos;
+                        citem->mapped = st->mapped + offset;
+                        s->creates_cnt ++;
+                        break;
+                    }   else if (st->mapped != NULL &&
+                                 citem->params.tex.total_size <= st->ring.size)    {
+                        g_gfxdev.delayed_deferred_cnt ++;
+                        break;
+                    }
+
                     if (s->stream_pbo == 0)
                         glGenBuffers(1, &s->stream_pbo);
                     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->stream_pbo);
@@ -756,6 +842,11 @@ void gfx_delayed_createobjects()
             default:
                 break;
             }
+
+            if (citem->mapped != NULL && item_size != 0)   {
+                budget_bytes += item_size;
+                budget_objs ++;
+            }
         }
 
         /* check if all objects are processed, trigger signal */
@@ -787,11 +878,11 @@ void gfx_delayed_fillobjects(uint thread_id)
                 switch (obj->type)  {
                 case GFX_OBJ_BUFFER:
                     memcpy(citem->mapped, citem->params.buff.data, citem->params.buff.size);
-                    FREE(citem->params.buff.data);
+                    citem->params.buff.data = NULL;
                     break;
                 case GFX_OBJ_TEXTURE:
                     memcpy(citem->mapped, citem->params.tex.data, citem->params.tex.total_size);
-                    FREE(citem->params.tex.data);
+                    citem->params.tex.data = NULL;
                     break;
                 default:
                     break;
@@ -808,10 +899,10 @@ void gfx_delayed_fillobjects(uint thread_id)
 }
 
 /* runs in main thread, final stage: unmaps objects and finalize creation, also does cleanup */
-void gfx_delayed_finalizeobjects()
+int gfx_delayed_finalizeobjects()
 {
     if (!mt_mutex_try(&g_gfxdev.objcreate_mtx))
-        return;
+        return FALSE;
 
     struct linked_list* lnode = g_gfxdev.objunmaps;
     while (lnode != NULL)   {
@@ -827,9 +918,14 @@ void gfx_delayed_finalizeobjects()
                 break;
             case GFX_OBJ_TEXTURE:
                 {
+                    /* staging buffer is coherent and stays mapped, subresources point into it */
                     struct gfx_dev_delayed_signal* s = citem->signal;
-                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->stream_pbo);
-                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                    if (citem->staging_pos != GFX_STAGING_NONE) {
+                        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_gfxdev.staging.pbo);
+                    }   else    {
+                        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->stream_pbo);
+                        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                    }
 
                     obj->api_obj = gfx_create_texture_gl(
                         citem->params.tex.type,
@@ -873,7 +969,13 @@ void gfx_delayed_finalizeobjects()
         lnode = lnext;
     }
 
+    /* fence on every finalize, so staging memory of earlier finalizes that were skipped (no free
+     * fence) is covered too. gfx_staging_fence does nothing if head hasn't moved past last fence */
+    if (g_gfxdev.staging.mapped != NULL)
+        gfx_staging_fence();
+
     mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
+    return TRUE;
 }
 
 /* runs in loader thread */
@@ -885,13 +987,27 @@ void gfx_delayed_waitforobjects(uint thread_id)
         return;
     }
 
+    /* thread didn't queue anything, there is no signal to wait for */
     struct gfx_dev_delayed_signal* s = gfx_delayed_getsignal(thread_id);
-    ASSERT(s);
+    if (s == NULL || s->pending_cnt == 0)   {
+        mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
+        return;
+    }
     s->waiting = TRUE;
     mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
     mt_event_wait(g_gfxdev.objcreate_event, s->signal_id, MT_TIMEOUT_INFINITE);
 }
 
+/* runs in loader thread */
+int gfx_delayed_haspending(uint thread_id)
+{
+    mt_mutex_lock(&g_gfxdev.objcreate_mtx);
+    struct gfx_dev_delayed_signal* s = gfx_delayed_getsignal(thread_id);
+    int pending = (s != NULL && s->pending_cnt > 0);
+    mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
+    return pending;
+}
+
 /* runs in main thread */
 void gfx_delayed_release()
 {
@@ -928,16 +1044,7 @@ void gfx_delayed_release()
 void gfx_delayed_releaseitem(struct gfx_dev_delayed_item* citem)
 {
     switch (citem->obj->type)   {
-    case GFX_OBJ_BUFFER:
-        if (citem->params.buff.data != NULL)    {
-            FREE(citem->params.buff.data);
-        }
-        break;
     case GFX_OBJ_TEXTURE:
-        if (citem->params.tex.data != NULL) {
-            FREE(citem->params.tex.data);
-        }
-
         if (citem->params.tex.subress != NULL)  {
             FREE(citem->params.tex.subress);
         }
@@ -955,6 +1062,122 @@ void gfx_delayed_releaseitem(struct gfx_dev_delayed_item* citem)
     FREE(citem);
 }
 
+void gfx_delayed_setbudget(uint bytes_max, uint objs_max)
+{
+    mt_mutex_lock(&g_gfxdev.objcreate_mtx);
+    g_gfxdev.delayed_bytes_max = bytes_max;
+    g_gfxdev.delayed_objs_max = objs_max;
+    mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
+}
+
+void gfx_delayed_getstats(struct gfx_delayed_stats* stats)
+{
+    memset(stats, 0x00, sizeof(struct gfx_delayed_stats));
+
+    mt_mutex_lock(&g_gfxdev.objcreate_mtx);
+    struct linked_list* lnode = g_gfxdev.objcreates;
+    while (lnode != NULL)   {
+        if (((struct gfx_dev_delayed_item*)lnode->data)->mapped == NULL)
+            stats->pending_cnt ++;
+        lnode = lnode->next;
+    }
+    stats->deferred_cnt = g_gfxdev.delayed_deferred_cnt;
+    stats->bytes_max = g_gfxdev.delayed_bytes_max;
+    stats->objs_max = g_gfxdev.delayed_objs_max;
+    stats->staging_size = g_gfxdev.staging.ring.size;
+    stats->staging_used = staging_ring_getused(&g_gfxdev.staging.ring);
+    mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
+}
+
+void gfx_staging_init(uint size)
+{
+#if defined(GL_ARB_buffer_storage)
+    if (!GLEW_ARB_buffer_storage)
+        return;
+
+    struct gfx_dev_staging* st = &g_gfxdev.staging;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &st->pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->pbo);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, flags);
+    st->mapped = (uint8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (st->mapped == NULL) {
+        log_print(LOG_WARNING, "gfx-device: could not map staging buffer, uploads are not staged");
+        glDeleteBuffers(1, &st->pbo);
+        st->pbo = 0;
+        return;
+    }
+    staging_ring_init(&st->ring, size);
+    log_printf(LOG_INFO, "  staging buffer for background uploads: %dkb", size/1024);
+#endif
+}
+
+void gfx_staging_release()
+{
+    struct gfx_dev_staging* st = &g_gfxdev.staging;
+    struct staging_ring_fence* f;
+    while ((f = staging_ring_oldestfence(&st->ring)) != NULL)   {
+        glDeleteSync((GLsync)f->sync);
+        staging_ring_popfence(&st->ring);
+    }
+
+    if (st->pbo != 0)   {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &st->pbo);
+    }
+    memset(st, 0x00, sizeof(struct gfx_dev_staging));
+}
+
+/* frees staging memory of the uploads that gpu has finished with, never waits */
+void gfx_staging_reclaim()
+{
+    struct gfx_dev_staging* st = &g_gfxdev.staging;
+    struct staging_ring_fence* f;
+    while ((f = staging_ring_oldestfence(&st->ring)) != NULL)   {
+        GLenum r = glClientWaitSync((GLsync)f->sync, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync((GLsync)f->sync);
+        staging_ring_popfence(&st->ring);
+    }
+}
+
+/* fences uploads that are submitted, memory of staged objects that are not finalized yet (still
+ * filled by loaders) is excluded. if all fences are in use, waits for the oldest one */
+void gfx_staging_fence()
+{
+    struct gfx_dev_staging* st = &g_gfxdev.staging;
+    uint64 end = st->ring.head;
+    struct linked_list* lnode = g_gfxdev.objcreates;
+    while (lnode != NULL)   {
+        const struct gfx_dev_delayed_item* citem = (const struct gfx_dev_delayed_item*)lnode->data;
+        if (citem->staging_pos != GFX_STAGING_NONE && citem->staging_pos < end)
+            end = citem->staging_pos;
+        lnode = lnode->next;
+    }
+
+    if (!staging_ring_needfence(&st->ring, end))
+        return;
+
+    if (staging_ring_fencesfull(&st->ring))  {
+        GLsync oldest = (GLsync)staging_ring_oldestfence(&st->ring)->sync;
+        GLenum r;
+        do  {
+            r = glClientWaitSync(oldest, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }   while (r == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(oldest);
+        staging_ring_popfence(&st->ring);
+    }
+
+    staging_ring_pushfence(&st->ring, end)->sync =
+        (uptr_t)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
 gfx_buffer gfx_create_buffer(enum gfx_buffer_type type, enum gfx_mem_hint memhint,
 		uint size, const void* data, uint thread_id)
 {
@@ -998,22 +1221,22 @@ gfx_buffer gfx_delayed_createbuffer(enum gfx_buffer_type type, enum gfx_mem_hint
     if (citem == NULL)
         return NULL;
     memset(citem, 0x00, sizeof(struct gfx_dev_delayed_item));
+    citem->staging_pos = GFX_STAGING_NONE;
     gfx_buffer obj = create_obj(0, GFX_OBJ_BUFFER);
     obj->desc.buff.type = type;
     obj->desc.buff.size = size;
     obj->desc.buff.alignment = g_gfxdev.buffer_alignment;
 
-    void* ndata = ALLOC(size, MID_GFX);
     if (data == NULL)   {
         destroy_obj(obj);
         FREE(citem);
         return NULL;
     }
-    memcpy(ndata, data, size);
 
+    /* no copy: loader keeps the data until it fills the mapped buffer (gfx_delayed_fillobjects) */
     citem->obj = obj;
     citem->thread_id = thread_id;
-    citem->params.buff.data = ndata;
+    citem->params.buff.data = data;
     citem->params.buff.memhint = memhint;
     citem->params.buff.size = size;
     citem->params.buff.type = type;
@@ -1022,7 +1245,7 @@ gfx_buffer gfx_delayed_createbuffer(enum gfx_buffer_type type, enum gfx_mem_hint
     struct gfx_dev_delayed_signal* s = gfx_delayed_createsignal(thread_id);
     s->pending_cnt ++;
     citem->signal = s;
-    list_add(&g_gfxdev.objcreates, &citem->lnode, citem);
+    list_addlast(&g_gfxdev.objcreates, &citem->lnode, citem);
     mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
 
     return obj;
@@ -1170,6 +1393,7 @@ gfx_texture gfx_delayed_createtexture(enum gfx_texture_type type, uint width, ui
     if (citem == NULL)
         return NULL;
     memset(citem, 0x00, sizeof(struct gfx_dev_delayed_item));
+    citem->staging_pos = GFX_STAGING_NONE;
     gfx_buffer obj = create_obj(0, GFX_OBJ_TEXTURE);
 
     GLenum gl_type = 0;
@@ -1188,19 +1412,19 @@ gfx_texture gfx_delayed_createtexture(enum gfx_texture_type type, uint width, ui
     obj->desc.tex.gl_type = gl_type;
     obj->desc.tex.gl_fmt = gl_fmt;
 
-    void* ndata = ALLOC(total_size, MID_GFX);
     if (data == NULL)   {
         destroy_obj(obj);
         FREE(citem);
         return NULL;
     }
-    memcpy(ndata, data[0].p, total_size);
 
+    /* no copy: subresources are contiguous in loader's memory, which is kept until
+     * gfx_delayed_fillobjects */
     citem->obj = obj;
     citem->thread_id = thread_id;
 
     uint subres_cnt = array_size * mip_cnt;
-    citem->params.tex.data = ndata;
+    citem->params.tex.data = data[0].p;
     citem->params.tex.memhint = memhint;
     citem->params.tex.total_size = total_size;
     citem->params.tex.type = type;
@@ -1230,7 +1454,7 @@ gfx_texture gfx_delayed_createtexture(enum gfx_texture_type type, uint width, ui
     s->pending_cnt ++;
     citem->signal = s;
 
-    list_add(&g_gfxdev.objcreates, &citem->lnode, citem);
+    list_addlast(&g_gfxdev.objcreates, &citem->lnode, citem);
     mt_mutex_unlock(&g_gfxdev.objcreate_mtx);
 
     return obj;
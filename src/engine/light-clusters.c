@@ -0,0 +1,205 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include "dhcore/core.h"
+#include "dhcore/vec-math.h"
+
+#include "light-clusters.h"
+
+/* calculates the inclusive tile range that overlaps [vmin, vmax] on one axis
+ * comparisons are written so that NaN bounds (lights that touch the camera plane) are
+ * conservatively binned into all tiles */
+static int light_clusters_tilerange(float vmin, float vmax, uint cnt, float size, uint tile_size,
+    OUT uint* first, OUT uint* last)
+{
+    if (vmin > size || vmax < 0.0f)
+        return FALSE;
+
+    float ts = (float)tile_size;
+    *first = (vmin > 0.0f) ? minui((uint)ceilf(vmin/ts) - 1, cnt - 1) : 0;
+    *last = (vmax < (float)(cnt*tile_size)) ? minui((uint)(vmax/ts), cnt - 1) : cnt - 1;
+    return *first <= *last;
+}
+
+/*************************************************************************************************/
+void light_clusters_init(struct light_clusters* lc, uint width, uint height, uint tile_size,
+    uint slice_cnt, uint cap, uint* cnts, uint16* idxs, uint* tile_cnts, uint tile_stride)
+{
+    memset(lc, 0x00, sizeof(struct light_clusters));
+    lc->width = width;
+    lc->height = height;
+    lc->tile_size = tile_size;
+    lc->cnt_x = (width + tile_size - 1) / tile_size;
+    lc->cnt_y = (height + tile_size - 1) / tile_size;
+    lc->slice_cnt = slice_cnt;
+    lc->cluster_cnt = lc->cnt_x*lc->cnt_y*slice_cnt;
+    lc->cap = cap;
+    lc->cnts = cnts;
+    lc->idxs = idxs;
+    lc->tile_cnts = tile_cnts;
+    lc->tile_stride = tile_stride;
+}
+
+void light_clusters_setdepth(struct light_clusters* lc, float fnear, float ffar)
+{
+    lc->slice_scale = (float)lc->slice_cnt / logf(ffar/fnear);
+    lc->slice_bias = -logf(fnear)*lc->slice_scale;
+}
+
+uint light_clusters_depthslice(const struct light_clusters* lc, float z)
+{
+    if (z <= 0.0f)
+        return 0;
+    float s = floorf(logf(z)*lc->slice_scale + lc->slice_bias);
+    return (uint)clampf(s, 0.0f, (float)(lc->slice_cnt - 1));
+}
+
+int light_clusters_setrange(const struct light_clusters* lc, struct light_range* lr)
+{
+    if (lr->zmax <= 0.0f ||
+        !light_clusters_tilerange(lr->rc[0], lr->rc[2], lc->cnt_x, (float)lc->width,
+            lc->tile_size, &lr->x0, &lr->x1) ||
+        !light_clusters_tilerange(lr->rc[1], lr->rc[3], lc->cnt_y, (float)lc->height,
+            lc->tile_size, &lr->y0, &lr->y1))
+    {
+        return FALSE;
+    }
+
+    lr->s0 = light_clusters_depthslice(lc, lr->zmin);
+    lr->s1 = light_clusters_depthslice(lc, lr->zmax);
+    return TRUE;
+}
+
+uint light_clusters_bin(struct light_clusters* lc, const struct light_range* ranges,
+    uint range_cnt, uint row_start, uint row_end)
+{
+    uint cnt_x = lc->cnt_x;
+    uint slice_cnt = lc->slice_cnt;
+    uint cap = lc->cap;
+    uint stride = lc->tile_stride;
+    uint overflow_cnt = 0;
+
+    /* clusters and tiles of the rows are contiguous */
+    if (row_start >= row_end)
+        return 0;
+    memset(&lc->cnts[row_start*cnt_x*slice_cnt], 0x00,
+        sizeof(uint)*(row_end - row_start)*cnt_x*slice_cnt);
+    for (uint i = row_start*cnt_x, cnt = row_end*cnt_x; i < cnt; i++)
+        lc->tile_cnts[i*stride] = 0;
+
+    for (uint i = 0; i < range_cnt; i++)  {
+        const struct light_range* lr = &ranges[i];
+        if (lr->idx == INVALID_INDEX)
+            continue;
+
+        uint y_end = minui(lr->y1 + 1, row_end);
+        for (uint y = maxui(lr->y0, row_start); y < y_end; y++)   {
+            for (uint x = lr->x0; x <= lr->x1; x++)   {
+                uint tile_idx = x + y*cnt_x;
+                lc->tile_cnts[tile_idx*stride]++;
+
+                for (uint s = lr->s0; s <= lr->s1; s++)   {
+                    uint c = tile_idx*slice_cnt + s;
+                    uint n = lc->cnts[c];
+                    if (n < cap)  {
+                        lc->idxs[c*cap + n] = (uint16)lr->idx;
+                        lc->cnts[c] = n + 1;
+                    }   else    {
+                        overflow_cnt++;
+                    }
+                }
+            }
+        }
+    }
+
+    return overflow_cnt;
+}
+
+uint light_clusters_pack(const struct light_clusters* lc, float* items)
+{
+    uint cap = lc->cap;
+    uint offset = lc->cluster_cnt;
+
+    for (uint c = 0, cnt = lc->cluster_cnt; c < cnt; c++)  {
+        uint light_cnt = lc->cnts[c];
+        const uint16* idxs = &lc->idxs[c*cap];
+        float* header = &items[c*4];
+        float* f = &items[offset*4];
+
+        header[0] = (float)light_cnt;
+        header[1] = (float)offset;
+        header[2] = 0.0f;
+        header[3] = 0.0f;
+        for (uint i = 0; i < light_cnt; i++)
+            f[i] = (float)idxs[i];
+        offset += (light_cnt + 3)/4;
+    }
+
+    return offset;
+}
+
+uint light_clusters_getmaxitems(const struct light_clusters* lc)
+{
+    return lc->cluster_cnt*(1 + (lc->cap + 3)/4);
+}
+
+uint light_clusters_check(const struct light_clusters* lc, const struct light_range* ranges,
+    uint range_cnt)
+{
+    uint slice_cnt = lc->slice_cnt;
+    uint cap = lc->cap;
+    uint ts = lc->tile_size;
+    uint mismatch_cnt = 0;
+
+    for (uint y = 0; y < lc->cnt_y; y++)  {
+        for (uint x = 0; x < lc->cnt_x; x++)  {
+            float tmin_x = (float)(x*ts);
+            float tmin_y = (float)(y*ts);
+            float tmax_x = (float)minui((x + 1)*ts, lc->width);
+            float tmax_y = (float)minui((y + 1)*ts, lc->height);
+            uint tile_idx = x + y*lc->cnt_x;
+
+            for (uint s = 0; s < slice_cnt; s++)  {
+                uint c = tile_idx*slice_cnt + s;
+                uint n = 0;
+                int match = TRUE;
+
+                for (uint k = 0; k < range_cnt && n < cap; k++)   {
+                    const struct light_range* lr = &ranges[k];
+                    if (tmin_x > lr->rc[2] || tmax_x < lr->rc[0] ||
+                        tmin_y > lr->rc[3] || tmax_y < lr->rc[1])
+                    {
+                        continue;
+                    }
+                    if (lr->zmax <= 0.0f || s < light_clusters_depthslice(lc, lr->zmin) ||
+                        s > light_clusters_depthslice(lc, lr->zmax))
+                    {
+                        continue;
+                    }
+
+                    if (n >= lc->cnts[c] || lr->idx != lc->idxs[c*cap + n])  {
+                        match = FALSE;
+                        break;
+                    }
+                    n++;
+                }
+
+                if (!match || n != lc->cnts[c])
+                    mismatch_cnt++;
+            }
+        }
+    }
+
+    return mismatch_cnt;
+}
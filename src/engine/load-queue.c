@@ -0,0 +1,75 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+#include "dhcore/vec-math.h"
+
+#include "load-queue.h"
+
+void load_queue_init(struct load_queue* q)
+{
+    memset(q, 0x00, sizeof(struct load_queue));
+}
+
+uint load_queue_bucket(float priority)
+{
+    uint d = (uint)(maxf(priority, 0.0f)/LOAD_QUEUE_PRIORITY_UNIT);
+    uint bucket = 0;
+    while (d > 0 && bucket < LOAD_QUEUE_BUCKET_CNT-1)    {
+        d >>= 1;
+        bucket ++;
+    }
+    return bucket;
+}
+
+void load_queue_push(struct load_queue* q, struct load_queue_item* item, void* owner, uint bucket,
+    int front)
+{
+    ASSERT(bucket < LOAD_QUEUE_BUCKET_CNT);
+    item->bucket = bucket;
+    if (front)
+        list_add(&q->buckets[bucket], &item->lnode, owner);
+    else
+        list_addlast(&q->buckets[bucket], &item->lnode, owner);
+    q->cnts[bucket] ++;
+}
+
+void load_queue_remove(struct load_queue* q, struct load_queue_item* item)
+{
+    list_remove(&q->buckets[item->bucket], &item->lnode);
+    q->cnts[item->bucket] --;
+}
+
+void* load_queue_pop(struct load_queue* q)
+{
+    for (uint i = 0; i < LOAD_QUEUE_BUCKET_CNT; i++) {
+        if (q->buckets[i] != NULL) {
+            struct linked_list* lnode = q->buckets[i];
+            void* owner = lnode->data;
+            list_remove(&q->buckets[i], lnode);
+            q->cnts[i] --;
+            return owner;
+        }
+    }
+    return NULL;
+}
+
+uint load_queue_getcount(const struct load_queue* q)
+{
+    uint cnt = 0;
+    for (uint i = 0; i < LOAD_QUEUE_BUCKET_CNT; i++)
+        cnt += q->cnts[i];
+    return cnt;
+}
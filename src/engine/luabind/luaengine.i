@@ -213,6 +213,13 @@ public:
     void setParam(const char* name, bool value);
     fl64 getParam(const char* name);
     bool getParamBool(const char* name);
+
+    /* index based access, cache the index from findParam to avoid name lookups */
+    int findParam(const char* name);
+    void setParamByIdx(int idx, fl64 value);
+    void setParamByIdx(int idx, bool value);
+    fl64 getParamByIdx(int idx);
+    bool getParamBoolByIdx(int idx);
 };
 
 /*************************************************************************************************
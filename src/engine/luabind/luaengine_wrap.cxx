@@ -2603,6 +2603,209 @@ fail:
 }
 
 
+static int _wrap_CharacterAnim_findParam(lua_State* L) {
+  int SWIG_arg = 0;
+  CharacterAnim *arg1 = (CharacterAnim *) 0 ;
+  char *arg2 = (char *) 0 ;
+  int result;
+  
+  SWIG_check_num_args("CharacterAnim::findParam",2,2)
+  if(!SWIG_isptrtype(L,1)) SWIG_fail_arg("CharacterAnim::findParam",1,"CharacterAnim *");
+  if(!SWIG_lua_isnilstring(L,2)) SWIG_fail_arg("CharacterAnim::findParam",2,"char const *");
+  
+  if (!SWIG_IsOK(SWIG_ConvertPtr(L,1,(void**)&arg1,SWIGTYPE_p_CharacterAnim,0))){
+    SWIG_fail_ptr("CharacterAnim_findParam",1,SWIGTYPE_p_CharacterAnim);
+  }
+  
+  arg2 = (char *)lua_tostring(L, 2);
+  result = (int)(arg1)->findParam((char const *)arg2);
+  lua_pushnumber(L, (lua_Number) result); SWIG_arg++;
+  return SWIG_arg;
+  
+  if(0) SWIG_fail;
+  
+fail:
+  lua_error(L);
+  return SWIG_arg;
+}
+
+
+static int _wrap_CharacterAnim_setParamByIdx__SWIG_0(lua_State* L) {
+  int SWIG_arg = 0;
+  CharacterAnim *arg1 = (CharacterAnim *) 0 ;
+  int arg2 ;
+  fl64 arg3 ;
+  
+  SWIG_check_num_args("CharacterAnim::setParamByIdx",3,3)
+  if(!SWIG_isptrtype(L,1)) SWIG_fail_arg("CharacterAnim::setParamByIdx",1,"CharacterAnim *");
+  if(!lua_isnumber(L,2)) SWIG_fail_arg("CharacterAnim::setParamByIdx",2,"int");
+  if(!lua_isnumber(L,3)) SWIG_fail_arg("CharacterAnim::setParamByIdx",3,"fl64");
+  
+  if (!SWIG_IsOK(SWIG_ConvertPtr(L,1,(void**)&arg1,SWIGTYPE_p_CharacterAnim,0))){
+    SWIG_fail_ptr("CharacterAnim_setParamByIdx",1,SWIGTYPE_p_CharacterAnim);
+  }
+  
+  arg2 = (int)lua_tonumber(L, 2);
+  arg3 = (fl64)lua_tonumber(L, 3);
+  (arg1)->setParamByIdx(arg2,arg3);
+  
+  return SWIG_arg;
+  
+  if(0) SWIG_fail;
+  
+fail:
+  lua_error(L);
+  return SWIG_arg;
+}
+
+
+static int _wrap_CharacterAnim_setParamByIdx__SWIG_1(lua_State* L) {
+  int SWIG_arg = 0;
+  CharacterAnim *arg1 = (CharacterAnim *) 0 ;
+  int arg2 ;
+  bool arg3 ;
+  
+  SWIG_check_num_args("CharacterAnim::setParamByIdx",3,3)
+  if(!SWIG_isptrtype(L,1)) SWIG_fail_arg("CharacterAnim::setParamByIdx",1,"CharacterAnim *");
+  if(!lua_isnumber(L,2)) SWIG_fail_arg("CharacterAnim::setParamByIdx",2,"int");
+  if(!lua_isboolean(L,3)) SWIG_fail_arg("CharacterAnim::setParamByIdx",3,"bool");
+  
+  if (!SWIG_IsOK(SWIG_ConvertPtr(L,1,(void**)&arg1,SWIGTYPE_p_CharacterAnim,0))){
+    SWIG_fail_ptr("CharacterAnim_setParamByIdx",1,SWIGTYPE_p_CharacterAnim);
+  }
+  
+  arg2 = (int)lua_tonumber(L, 2);
+  arg3 = (lua_toboolean(L, 3)!=0);
+  (arg1)->setParamByIdx(arg2,arg3);
+  
+  return SWIG_arg;
+  
+  if(0) SWIG_fail;
+  
+fail:
+  lua_error(L);
+  return SWIG_arg;
+}
+
+
+static int _wrap_CharacterAnim_setParamByIdx(lua_State* L) {
+  int argc;
+  int argv[4]={
+    1,2,3,4
+  };
+  
+  argc = lua_gettop(L);
+  if (argc == 3) {
+    int _v;
+    {
+      void *ptr;
+      if (SWIG_isptrtype(L,argv[0])==0 || SWIG_ConvertPtr(L,argv[0], (void **) &ptr, SWIGTYPE_p_CharacterAnim, 0)) {
+        _v = 0;
+      } else {
+        _v = 1;
+      }
+    }
+    if (_v) {
+      {
+        _v = lua_isnumber(L,argv[1]);
+      }
+      if (_v) {
+        {
+          _v = lua_isboolean(L,argv[2]);
+        }
+        if (_v) {
+          return _wrap_CharacterAnim_setParamByIdx__SWIG_1(L);
+        }
+      }
+    }
+  }
+  if (argc == 3) {
+    int _v;
+    {
+      void *ptr;
+      if (SWIG_isptrtype(L,argv[0])==0 || SWIG_ConvertPtr(L,argv[0], (void **) &ptr, SWIGTYPE_p_CharacterAnim, 0)) {
+        _v = 0;
+      } else {
+        _v = 1;
+      }
+    }
+    if (_v) {
+      {
+        _v = lua_isnumber(L,argv[1]);
+      }
+      if (_v) {
+        {
+          _v = lua_isnumber(L,argv[2]);
+        }
+        if (_v) {
+          return _wrap_CharacterAnim_setParamByIdx__SWIG_0(L);
+        }
+      }
+    }
+  }
+  
+  SWIG_Lua_pusherrstring(L,"Wrong arguments for overloaded function 'CharacterAnim_setParamByIdx'\n"
+    "  Possible C/C++ prototypes are:\n"
+    "    CharacterAnim::setParamByIdx(int,fl64)\n"
+    "    CharacterAnim::setParamByIdx(int,bool)\n");
+  lua_error(L);return 0;
+}
+
+
+static int _wrap_CharacterAnim_getParamByIdx(lua_State* L) {
+  int SWIG_arg = 0;
+  CharacterAnim *arg1 = (CharacterAnim *) 0 ;
+  int arg2 ;
+  fl64 result;
+  
+  SWIG_check_num_args("CharacterAnim::getParamByIdx",2,2)
+  if(!SWIG_isptrtype(L,1)) SWIG_fail_arg("CharacterAnim::getParamByIdx",1,"CharacterAnim *");
+  if(!lua_isnumber(L,2)) SWIG_fail_arg("CharacterAnim::getParamByIdx",2,"int");
+  
+  if (!SWIG_IsOK(SWIG_ConvertPtr(L,1,(void**)&arg1,SWIGTYPE_p_CharacterAnim,0))){
+    SWIG_fail_ptr("CharacterAnim_getParamByIdx",1,SWIGTYPE_p_CharacterAnim);
+  }
+  
+  arg2 = (int)lua_tonumber(L, 2);
+  result = (fl64)(arg1)->getParamByIdx(arg2);
+  lua_pushnumber(L, (lua_Number) result); SWIG_arg++;
+  return SWIG_arg;
+  
+  if(0) SWIG_fail;
+  
+fail:
+  lua_error(L);
+  return SWIG_arg;
+}
+
+
+static int _wrap_CharacterAnim_getParamBoolByIdx(lua_State* L) {
+  int SWIG_arg = 0;
+  CharacterAnim *arg1 = (CharacterAnim *) 0 ;
+  int arg2 ;
+  bool result;
+  
+  SWIG_check_num_args("CharacterAnim::getParamBoolByIdx",2,2)
+  if(!SWIG_isptrtype(L,1)) SWIG_fail_arg("CharacterAnim::getParamBoolByIdx",1,"CharacterAnim *");
+  if(!lua_isnumber(L,2)) SWIG_fail_arg("CharacterAnim::getParamBoolByIdx",2,"int");
+  
+  if (!SWIG_IsOK(SWIG_ConvertPtr(L,1,(void**)&arg1,SWIGTYPE_p_CharacterAnim,0))){
+    SWIG_fail_ptr("CharacterAnim_getParamBoolByIdx",1,SWIGTYPE_p_CharacterAnim);
+  }
+  
+  arg2 = (int)lua_tonumber(L, 2);
+  result = (bool)(arg1)->getParamBoolByIdx(arg2);
+  lua_pushboolean(L,(int)(result!=0)); SWIG_arg++;
+  return SWIG_arg;
+  
+  if(0) SWIG_fail;
+  
+fail:
+  lua_error(L);
+  return SWIG_arg;
+}
+
+
 static void swig_delete_CharacterAnim(void *obj) {
 CharacterAnim *arg1 = (CharacterAnim *) obj;
 delete arg1;
@@ -2612,6 +2815,10 @@ static swig_lua_method swig_CharacterAnim_methods[] = {
     {"setParam", _wrap_CharacterAnim_setParam}, 
     {"getParam", _wrap_CharacterAnim_getParam}, 
     {"getParamBool", _wrap_CharacterAnim_getParamBool}, 
+    {"findParam", _wrap_CharacterAnim_findParam}, 
+    {"setParamByIdx", _wrap_CharacterAnim_setParamByIdx}, 
+    {"getParamByIdx", _wrap_CharacterAnim_getParamByIdx}, 
+    {"getParamBoolByIdx", _wrap_CharacterAnim_getParamBoolByIdx}, 
     {0,0}
 };
 static swig_lua_attribute swig_CharacterAnim_attributes[] = {
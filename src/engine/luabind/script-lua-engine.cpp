@@ -333,6 +333,113 @@ bool CharacterAnim::getParamBool(const char* name)
     return anim_ctrl_get_paramb(ctrl, inst, name) ? true : false;
 }
 
+int CharacterAnim::findParam(const char* name)
+{
+    if (hdl_ == INVALID_HANDLE || inst_ == NULL) {
+        sct_throwerror("Character animation is empty");
+        return -1;
+    }
+
+    anim_ctrl ctrl = rs_get_animctrl(hdl_);
+    if (ctrl == NULL)
+        return -1;
+
+    uint idx = anim_ctrl_findparam(ctrl, name);
+    if (idx == INVALID_INDEX)   {
+        sct_throwerror("Animation controller parameter '%s' does not exist", name);
+        return -1;
+    }
+    return (int)idx;
+}
+
+void CharacterAnim::setParamByIdx(int idx, fl64 value)
+{
+    if (hdl_ == INVALID_HANDLE || inst_ == NULL) {
+        sct_throwerror("Character animation is empty");
+        return;
+    }
+
+    anim_ctrl_inst inst = *((anim_ctrl_inst*)inst_);
+    if (inst == NULL)
+        return;
+
+    switch (anim_ctrl_get_paramtype_byidx(inst, (uint)idx))   {
+    case ANIM_CTRL_PARAM_FLOAT:
+        anim_ctrl_set_paramf_byidx(inst, (uint)idx, (float)value);
+        break;
+    case ANIM_CTRL_PARAM_INT:
+        anim_ctrl_set_parami_byidx(inst, (uint)idx, (int)value);
+        break;
+    case ANIM_CTRL_PARAM_UNKNOWN:
+        sct_throwerror("Animation controller parameter index '%d' is invalid", idx);
+        break;
+    default:
+        break;
+    }
+}
+
+void CharacterAnim::setParamByIdx(int idx, bool value)
+{
+    if (hdl_ == INVALID_HANDLE || inst_ == NULL) {
+        sct_throwerror("Character animation is empty");
+        return;
+    }
+
+    anim_ctrl_inst inst = *((anim_ctrl_inst*)inst_);
+    if (inst == NULL)
+        return;
+
+    if (anim_ctrl_get_paramtype_byidx(inst, (uint)idx) != ANIM_CTRL_PARAM_BOOLEAN)  {
+        sct_throwerror("Animation controller parameter index '%d' is not boolean", idx);
+        return;
+    }
+
+    anim_ctrl_set_paramb_byidx(inst, (uint)idx, (int)value);
+}
+
+fl64 CharacterAnim::getParamByIdx(int idx)
+{
+    if (hdl_ == INVALID_HANDLE || inst_ == NULL) {
+        sct_throwerror("Character animation is empty");
+        return 0.0;
+    }
+
+    anim_ctrl_inst inst = *((anim_ctrl_inst*)inst_);
+    if (inst == NULL)
+        return 0.0;
+
+    switch (anim_ctrl_get_paramtype_byidx(inst, (uint)idx))   {
+    case ANIM_CTRL_PARAM_FLOAT:
+        return (fl64)anim_ctrl_get_paramf_byidx(inst, (uint)idx);
+    case ANIM_CTRL_PARAM_BOOLEAN:
+        return (fl64)anim_ctrl_get_paramb_byidx(inst, (uint)idx);
+    case ANIM_CTRL_PARAM_INT:
+        return (fl64)anim_ctrl_get_parami_byidx(inst, (uint)idx);
+    default:
+        sct_throwerror("Animation controller parameter index '%d' is invalid", idx);
+        return 0.0;
+    }
+}
+
+bool CharacterAnim::getParamBoolByIdx(int idx)
+{
+    if (hdl_ == INVALID_HANDLE || inst_ == NULL) {
+        sct_throwerror("Character animation is empty");
+        return false;
+    }
+
+    anim_ctrl_inst inst = *((anim_ctrl_inst*)inst_);
+    if (inst == NULL)
+        return false;
+
+    if (anim_ctrl_get_paramtype_byidx(inst, (uint)idx) != ANIM_CTRL_PARAM_BOOLEAN)  {
+        sct_throwerror("Animation controller parameter index '%d' is not boolean", idx);
+        return false;
+    }
+
+    return anim_ctrl_get_paramb_byidx(inst, (uint)idx) ? true : false;
+}
+
 /*************************************************************************************************
  * Object
  */
@@ -0,0 +1,262 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include "dhcore/core.h"
+#include "dhcore/vec-math.h"
+
+#include "pak-archive.h"
+
+#define PAK_ARCHIVE_GROW 256
+
+/*************************************************************************************************/
+result_t pak_archive_create(struct pak_archive* pak, struct allocator* alloc,
+    const char* filepath, enum compress_mode mode)
+{
+    memset(pak, 0x00, sizeof(struct pak_archive));
+
+    pak->f = fio_createdisk(filepath);
+    if (pak->f == NULL) {
+        err_printf(__FILE__, __LINE__, "pak: could not create file '%s'", filepath);
+        return RET_FILE_ERROR;
+    }
+
+    pak->alloc = alloc;
+    pak->writing = TRUE;
+    pak->header.sign = PAK_ARCHIVE_SIGN;
+    pak->header.version = PAK_ARCHIVE_VERSION;
+    pak->header.compress_mode = (uint)mode;
+
+    /* header is written again with the table offset when archive is closed */
+    fio_write(pak->f, &pak->header, sizeof(pak->header), 1);
+    pak->header.table_offset = sizeof(pak->header);
+    return RET_OK;
+}
+
+static struct pak_archive_entry* pak_archive_addentry(struct pak_archive* pak, const char* alias)
+{
+    if (pak->header.entry_cnt == pak->entry_max)    {
+        uint max = pak->entry_max + PAK_ARCHIVE_GROW;
+        struct pak_archive_entry* entries = (struct pak_archive_entry*)
+            A_ALLOC(pak->alloc, sizeof(struct pak_archive_entry)*max, 0);
+        if (entries == NULL)    {
+            err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+            return NULL;
+        }
+        if (pak->entries != NULL)   {
+            memcpy(entries, pak->entries, sizeof(struct pak_archive_entry)*pak->header.entry_cnt);
+            A_FREE(pak->alloc, pak->entries);
+        }
+        pak->entries = entries;
+        pak->entry_max = max;
+    }
+
+    /* lookups are binary searches */
+    uint cnt = pak->header.entry_cnt;
+    if (cnt > 0 && strcmp(pak->entries[cnt - 1].alias, alias) >= 0) {
+        err_printf(__FILE__, __LINE__, "pak: entry '%s' is not in order", alias);
+        return NULL;
+    }
+
+    struct pak_archive_entry* e = &pak->entries[cnt];
+    memset(e, 0x00, sizeof(struct pak_archive_entry));
+    str_safecpy(e->alias, sizeof(e->alias), alias);
+    e->offset = pak->header.table_offset;
+    return e;
+}
+
+result_t pak_archive_put(struct pak_archive* pak, const char* alias, const void* data,
+    enum pak_entry_mode mode, uint stored_size, uint size, uint hash)
+{
+    ASSERT(pak->writing);
+    if (strlen(alias) >= PAK_ARCHIVE_PATH_MAX)  {
+        err_printf(__FILE__, __LINE__, "pak: path '%s' is too long", alias);
+        return RET_INVALIDARG;
+    }
+
+    struct pak_archive_entry* e = pak_archive_addentry(pak, alias);
+    if (e == NULL)
+        return RET_FAIL;
+
+    if (stored_size > 0 && fio_write(pak->f, data, stored_size, 1) != 1)  {
+        err_printf(__FILE__, __LINE__, "pak: could not write '%s'", alias);
+        return RET_FILE_ERROR;
+    }
+
+    e->mode = (uint)mode;
+    e->hash = hash;
+    e->size = size;
+    e->stored_size = stored_size;
+    pak->header.table_offset += stored_size;
+    pak->header.entry_cnt ++;
+    return RET_OK;
+}
+
+result_t pak_archive_copy(struct pak_archive* pak, struct pak_archive* src, uint idx)
+{
+    const struct pak_archive_entry* se = &src->entries[idx];
+    void* data = A_ALLOC(pak->alloc, maxui(se->stored_size, 1), 0);
+    if (data == NULL)   {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        return RET_OUTOFMEMORY;
+    }
+
+    fio_seek(src->f, SEEK_MODE_START, (int)se->offset);
+    result_t r;
+    if (se->stored_size == 0 || fio_read(src->f, data, se->stored_size, 1) == 1)  {
+        r = pak_archive_put(pak, se->alias, data, (enum pak_entry_mode)se->mode, se->stored_size,
+            se->size, se->hash);
+    }   else    {
+        err_printf(__FILE__, __LINE__, "pak: could not read '%s'", se->alias);
+        r = RET_FILE_ERROR;
+    }
+
+    A_FREE(pak->alloc, data);
+    return r;
+}
+
+result_t pak_archive_open(struct pak_archive* pak, struct allocator* alloc, const char* filepath)
+{
+    memset(pak, 0x00, sizeof(struct pak_archive));
+
+    pak->f = fio_opendisk(filepath, TRUE);
+    if (pak->f == NULL) {
+        err_printf(__FILE__, __LINE__, "pak: could not open file '%s'", filepath);
+        return RET_FILE_ERROR;
+    }
+    pak->alloc = alloc;
+
+    size_t file_size = fio_getsize(pak->f);
+    struct pak_archive_header* h = &pak->header;
+    int valid = fio_read(pak->f, h, sizeof(struct pak_archive_header), 1) == 1 &&
+        h->sign == PAK_ARCHIVE_SIGN && h->version == PAK_ARCHIVE_VERSION &&
+        (size_t)h->table_offset + (size_t)h->entry_cnt*sizeof(struct pak_archive_entry) <= file_size;
+
+    if (valid && h->entry_cnt > 0)  {
+        pak->entries = (struct pak_archive_entry*)A_ALLOC(alloc,
+            sizeof(struct pak_archive_entry)*h->entry_cnt, 0);
+        if (pak->entries == NULL)   {
+            err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+            pak_archive_close(pak);
+            return RET_OUTOFMEMORY;
+        }
+        pak->entry_max = h->entry_cnt;
+
+        fio_seek(pak->f, SEEK_MODE_START, (int)h->table_offset);
+        valid = fio_read(pak->f, pak->entries, sizeof(struct pak_archive_entry), h->entry_cnt) ==
+            h->entry_cnt;
+    }
+
+    /* aliases are used as strings and data ranges are read without further checks */
+    for (uint i = 0; valid && i < h->entry_cnt; i++)    {
+        const struct pak_archive_entry* e = &pak->entries[i];
+        valid = memchr(e->alias, 0, sizeof(e->alias)) != NULL &&
+            (i == 0 || strcmp(pak->entries[i - 1].alias, e->alias) < 0) &&
+            (e->mode == PAK_ENTRY_STORED || e->mode == PAK_ENTRY_DEFLATE) &&
+            (e->mode != PAK_ENTRY_STORED || e->stored_size == e->size) &&
+            (size_t)e->offset + e->stored_size <= h->table_offset;
+    }
+
+    if (!valid) {
+        err_printf(__FILE__, __LINE__, "pak: invalid file format '%s'", filepath);
+        pak_archive_close(pak);
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+void pak_archive_close(struct pak_archive* pak)
+{
+    if (pak->f != NULL) {
+        if (pak->writing)   {
+            fio_write(pak->f, pak->entries, sizeof(struct pak_archive_entry),
+                pak->header.entry_cnt);
+            fio_seek(pak->f, SEEK_MODE_START, 0);
+            fio_write(pak->f, &pak->header, sizeof(pak->header), 1);
+        }
+        fio_close(pak->f);
+    }
+
+    if (pak->entries != NULL)
+        A_FREE(pak->alloc, pak->entries);
+    memset(pak, 0x00, sizeof(struct pak_archive));
+}
+
+uint pak_archive_find(const struct pak_archive* pak, const char* alias)
+{
+    uint first = 0;
+    uint last = pak->header.entry_cnt;
+    while (first < last)    {
+        uint mid = (first + last) / 2;
+        int c = strcmp(pak->entries[mid].alias, alias);
+        if (c == 0)
+            return mid;
+        else if (c < 0)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    return INVALID_INDEX;
+}
+
+void* pak_archive_read(struct pak_archive* pak, struct allocator* alloc, uint idx)
+{
+    const struct pak_archive_entry* e = &pak->entries[idx];
+    uint8* data = (uint8*)A_ALLOC(alloc, maxui(e->size, 1), 0);
+    void* stored = (e->mode == PAK_ENTRY_STORED) ? (void*)data :
+        A_ALLOC(alloc, maxui(e->stored_size, 1), 0);
+    if (data == NULL || stored == NULL)  {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        if (data != NULL)
+            A_FREE(alloc, data);
+        return NULL;
+    }
+
+    fio_seek(pak->f, SEEK_MODE_START, (int)e->offset);
+    int valid = e->stored_size == 0 || fio_read(pak->f, stored, e->stored_size, 1) == 1;
+    if (valid && e->mode == PAK_ENTRY_DEFLATE)
+        valid = zip_decompress(data, e->size, stored, e->stored_size) == e->size;
+
+    if (stored != data)
+        A_FREE(alloc, stored);
+    if (!valid) {
+        err_printf(__FILE__, __LINE__, "pak: could not read '%s'", e->alias);
+        A_FREE(alloc, data);
+        return NULL;
+    }
+    return data;
+}
+
+enum pak_entry_mode pak_archive_compress(struct allocator* alloc, const void* data, uint size,
+    enum compress_mode mode, OUT void** compressed, OUT uint* compressed_size)
+{
+    *compressed = NULL;
+    *compressed_size = 0;
+    if (mode == COMPRESS_NONE || size == 0)
+        return PAK_ENTRY_STORED;
+
+    /* output is capped to the input size, data that doesn't shrink fails and is stored */
+    void* buff = A_ALLOC(alloc, size, 0);
+    if (buff == NULL)
+        return PAK_ENTRY_STORED;
+
+    size_t sz = zip_compress(buff, size, data, size, mode);
+    if (sz == 0 || sz >= size)  {
+        A_FREE(alloc, buff);
+        return PAK_ENTRY_STORED;
+    }
+
+    *compressed = buff;
+    *compressed_size = (uint)sz;
+    return PAK_ENTRY_DEFLATE;
+}
@@ -86,6 +86,7 @@ struct phx_rigid_data
 struct phx_prefab_data
 {
     struct allocator* alloc;
+    uint data_size; /* size of the whole memory block, excluding physics sdk objects */
     uint mtl_cnt;
     uint mesh_cnt;
 
@@ -97,6 +98,8 @@ struct phx_prefab_data
 /*************************************************************************************************
  * fwd declarations
  */
+phx_prefab phx_prefab_loadfile(file_t f, const char* name, struct allocator* alloc,
+    struct allocator* tmp_alloc, uint thread_id);
 int phx_prefab_loadshape(struct phx_shape_data* shape, file_t f, struct allocator* alloc);
 struct phx_rigid_data* phx_prefab_loadrigid(file_t f, struct allocator* alloc);
 phx_obj phx_prefab_loadmesh(file_t f, int gpu_mesh, struct allocator* tmp_alloc, uint thread_id);
@@ -113,25 +116,53 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
     file_t f = fio_openmem(tmp_alloc, h3dp_filepath, FALSE, MID_PHX);
     if (f == NULL)  {
         err_printf(__FILE__, __LINE__, "load phx-prefab failed: could not open '%s'", h3dp_filepath);
+        A_LOAD(tmp_alloc);
         return NULL;
     }
 
+    phx_prefab prefab = phx_prefab_loadfile(f, h3dp_filepath, alloc, tmp_alloc, thread_id);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return prefab;
+}
+
+/* 'data' is not copied or freed, it's usually a blob inside a resource bundle */
+phx_prefab phx_prefab_loadmem(const char* name, const void* data, size_t size,
+    struct allocator* alloc, uint thread_id)
+{
+    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+    A_SAVE(tmp_alloc);
+
+    file_t f = fio_attachmem(tmp_alloc, (void*)data, size, name, MID_PHX);
+    if (f == NULL)  {
+        err_printf(__FILE__, __LINE__, "load phx-prefab failed: could not open '%s'", name);
+        A_LOAD(tmp_alloc);
+        return NULL;
+    }
+
+    phx_prefab prefab = phx_prefab_loadfile(f, name, alloc, tmp_alloc, thread_id);
+    fio_detachmem(f, &size, NULL);
+    fio_close(f);
+    A_LOAD(tmp_alloc);
+    return prefab;
+}
+
+/* reads the prefab from an opened file, caller owns 'f' and restores 'tmp_alloc' */
+phx_prefab phx_prefab_loadfile(file_t f, const char* name, struct allocator* alloc,
+    struct allocator* tmp_alloc, uint thread_id)
+{
     /* header */
     struct h3d_header header;
     fio_read(f, &header, sizeof(header), 1);
     if (header.sign != H3D_SIGN || header.version != H3D_VERSION_12)    {
         err_printf(__FILE__, __LINE__, "load phx-prefab failed: unsupported file '%s'",
-            h3dp_filepath);
-        fio_close(f);
-        A_LOAD(tmp_alloc);
+            name);
         return NULL;
     }
 
     if (header.type != H3D_PHX) {
         err_printf(__FILE__, __LINE__, "load phx-prefab failed: invalid h3d file-type '%s'",
-            h3dp_filepath);
-        fio_close(f);
-        A_LOAD(tmp_alloc);
+            name);
         return NULL;
     }
     fio_seek(f, SEEK_MODE_START, header.data_offset);
@@ -151,7 +182,6 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
         sizeof(uint)*h3ddesc.total_shape_mtls;
     if (IS_FAIL(mem_stack_create(alloc, &stack_mem, total_sz, MID_GFX))) {
         err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
-        A_LOAD(tmp_alloc);
         return NULL;
     }
     mem_stack_bindalloc(&stack_mem, &stack_alloc);
@@ -162,6 +192,7 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
     ASSERT(prefab);
     memset(prefab, 0x00, sizeof(struct phx_prefab_data));
     prefab->alloc = alloc;
+    prefab->data_size = (uint)total_sz;
 
     if (h3ddesc.mtl_cnt > 0)    {
         prefab->mtls = (phx_mtl*)A_ALLOC(&stack_alloc, sizeof(phx_mtl)*h3ddesc.mtl_cnt, MID_PHX);
@@ -181,11 +212,9 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
     for (uint i = 0; i < h3ddesc.mtl_cnt; i++)    {
         prefab->mtls[i] = phx_prefab_loadmtl(f);
         if (prefab->mtls[i] == NULL)    {
-            fio_close(f);
-            phx_prefab_unload(prefab);
+                phx_prefab_unload(prefab);
             err_print(__FILE__, __LINE__, "load phx-prefab failed: could not create materials");
-            A_LOAD(tmp_alloc);
-            return NULL;
+                return NULL;
         }
     }
 
@@ -194,11 +223,9 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
     for (uint i = 0; i < h3ddesc.geo_cnt; i++)    {
         prefab->meshes[i] = phx_prefab_loadmesh(f, gpu_mesh, tmp_alloc, thread_id);
         if (prefab->meshes[i] == NULL)  {
-            fio_close(f);
-            phx_prefab_unload(prefab);
+                phx_prefab_unload(prefab);
             err_print(__FILE__, __LINE__, "load phx-prefab failed: could not create meshes");
-            A_LOAD(tmp_alloc);
-            return NULL;
+                return NULL;
         }
     }
 
@@ -208,21 +235,21 @@ phx_prefab phx_prefab_load(const char* h3dp_filepath, struct allocator* alloc, u
         prefab->rigid = phx_prefab_loadrigid(f, &stack_alloc);
         if (prefab->rigid == NULL)  {
             phx_prefab_unload(prefab);
-            fio_close(f);
-            err_print(__FILE__, __LINE__, "load phx-prefab failed: could not create rigid body");
-            A_LOAD(tmp_alloc);
-            return NULL;
+                err_print(__FILE__, __LINE__, "load phx-prefab failed: could not create rigid body");
+                return NULL;
         }
     }
 
-    fio_close(f);
-    A_LOAD(tmp_alloc);
-
     gfx_delayed_waitforobjects(thread_id);
     gfx_delayed_fillobjects(thread_id);
     return prefab;
 }
 
+size_t phx_prefab_getsize(phx_prefab prefab)
+{
+    return prefab->data_size;
+}
+
 void phx_prefab_unload(phx_prefab prefab)
 {
     struct phx_prefab_data* pr = (struct phx_prefab_data*)prefab;
@@ -33,6 +33,7 @@
 #include "script.h"
 #include "phx-device.h"
 #include "world-mgr.h"
+#include "res-mgr.h"
 
 #define AJAX_HEADER	"/json/"
 #define HSEED	2874
@@ -388,6 +389,21 @@ json_t prf_cmd_heapinfo(const char* param1, const char* param2)
     json_additem_toarr(data, prf_cmd_createkeyvalue_n("max-limit", (fl64)stats.limit_bytes, FALSE));
 	json_additem_toarr(data, prf_cmd_createkeyvalue_n("trace-total", (fl64)stats.tracer_alloc_bytes,
         TRUE));
+
+    /* resource memory of all types, per type usage is in buffersmem */
+    struct rs_budget_stats rs_stats;
+    size_t res_used = 0, res_cached = 0, res_budget = 0;
+    rs_get_budgetstats(&rs_stats);
+    for (uint i = RS_RESOURCE_TEXTURE; i < RS_RESOURCE_TYPE_CNT; i++)  {
+        res_used += rs_stats.used[i];
+        res_cached += rs_stats.cached[i];
+        res_budget += rs_stats.budgets[i];
+    }
+    json_additem_toarr(data, prf_cmd_createkeyvalue_n("res-total", (fl64)res_used, TRUE));
+    json_additem_toarr(data, prf_cmd_createkeyvalue_n("res-cached", (fl64)res_cached, TRUE));
+    json_additem_toarr(data, prf_cmd_createkeyvalue_n("res-budget", (fl64)res_budget, FALSE));
+    json_additem_toarr(data, prf_cmd_createkeyvalue_n("res-evicts", (fl64)rs_stats.evict_cnt,
+        FALSE));
 	return root;
 }
 
@@ -421,6 +437,22 @@ json_t prf_cmd_buffersmem(const char* param1, const char* param2)
     json_additem_toarr(data, prf_cmd_createkeyvalue_n("physics", (fl64)px_stats.buff_alloc, TRUE));
     json_additem_toarr(data, prf_cmd_createkeyvalue_n("physics-max", (float)px_stats.buff_max, TRUE));
 
+    /* resource budgets */
+    struct rs_budget_stats rs_stats;
+    rs_get_budgetstats(&rs_stats);
+    for (uint i = RS_RESOURCE_TEXTURE; i < RS_RESOURCE_TYPE_CNT; i++)  {
+        char key[64];
+        const char* type_str = rs_get_typestr((enum rs_resource_type)i);
+        sprintf(key, "res-%s", type_str);
+        json_additem_toarr(data, prf_cmd_createkeyvalue_n(key, (fl64)rs_stats.used[i], TRUE));
+        sprintf(key, "res-%s-cached", type_str);
+        json_additem_toarr(data, prf_cmd_createkeyvalue_n(key, (fl64)rs_stats.cached[i], FALSE));
+        sprintf(key, "res-%s-budget", type_str);
+        json_additem_toarr(data, prf_cmd_createkeyvalue_n(key, (fl64)rs_stats.budgets[i], FALSE));
+    }
+    json_additem_toarr(data, prf_cmd_createkeyvalue_n("res-evicts", (fl64)rs_stats.evict_cnt,
+        FALSE));
+
     return root;
 }
 
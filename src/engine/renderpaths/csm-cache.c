@@ -0,0 +1,74 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <string.h>
+#include "dhcore/core.h"
+#include "dhcore/hash.h"
+
+#include "renderpaths/csm-cache.h"
+
+#define CSM_CACHE_HSEED 7873
+
+void csm_cache_reset(struct csm_cache* cache)
+{
+    memset(cache, 0x00, sizeof(struct csm_cache));
+}
+
+uint csm_cache_addcaster(uint sig, const struct aabb* bounds, uint id)
+{
+    /* sum is order-independent, so casters can come in any order from the scene query */
+    return sig + hash_murmur32(bounds, sizeof(struct aabb), CSM_CACHE_HSEED ^ id);
+}
+
+uint csm_cache_test(const struct csm_cache* cache, const struct mat4f* vps, const uint* sigs,
+    uint cascade_cnt)
+{
+    ASSERT(cascade_cnt <= CSM_CACHE_CASCADES_MAX);
+
+    uint dirty = 0;
+    for (uint i = 0; i < cascade_cnt; i++)  {
+        uint bit = (1u << i);
+        if (!BIT_CHECK(cache->valid_mask, bit) ||
+            cache->sigs[i] != sigs[i] ||
+            memcmp(&cache->vps[i], &vps[i], sizeof(struct mat4f)) != 0)
+        {
+            dirty |= bit;
+        }
+    }
+    return dirty;
+}
+
+void csm_cache_commit(struct csm_cache* cache, const struct mat4f* vps, const uint* sigs,
+    uint mask)
+{
+    for (uint i = 0; i < CSM_CACHE_CASCADES_MAX; i++)  {
+        if (BIT_CHECK(mask, 1u << i))   {
+            mat4_setm(&cache->vps[i], &vps[i]);
+            cache->sigs[i] = sigs[i];
+        }
+    }
+    cache->valid_mask |= mask;
+}
+
+uint csm_cache_copymask(const struct csm_cache* cache, uint dirty, uint cascade_cnt)
+{
+    ASSERT(cascade_cnt <= CSM_CACHE_CASCADES_MAX);
+    return (~cache->shadow_clean | dirty) & ((1u << cascade_cnt) - 1);
+}
+
+void csm_cache_setshadow(struct csm_cache* cache, uint copy_mask, uint dynamic_mask)
+{
+    cache->shadow_clean = (cache->shadow_clean | copy_mask) & ~dynamic_mask;
+}
@@ -17,9 +17,11 @@
 #include "dhcore/task-mgr.h"
 
 #include "renderpaths/gfx-csm.h"
+#include "renderpaths/csm-cache.h"
 
 #include "gfx-device.h"
 #include "gfx.h"
+#include "gfx-fgraph.h"
 #include "engine.h"
 #include "gfx-shader.h"
 #include "mem-ids.h"
@@ -33,14 +35,25 @@
 #include "debug-hud.h"
 
 #define CSM_SHADER_CNT 4
+/* defaults, overridden by gfx init params (csm_xxx) and console */
 #define CSM_CASCADE_CNT 3
 #define CSM_SHADOW_SIZE 1024
 #define CSM_FAR_MAX 50.0f
+#define CSM_SPLIT_LAMBDA 0.75f
+#define CSM_CASCADES_MAX CSM_CACHE_CASCADES_MAX /* limited by c_fovfactors (vec4) in shaders */
+#define CSM_SHADOW_SIZE_MAX 8192
 #define CSM_PREV_SIZE 256
 
 /*************************************************************************************************
  * types
  */
+enum csm_casters
+{
+    CSM_CASTERS_ALL = 0,
+    CSM_CASTERS_STATIC,
+    CSM_CASTERS_DYNAMIC
+};
+
 struct csm_shader
 {
     uint rpath_flags;
@@ -56,33 +69,62 @@ struct ALIGN16 csm_cascade
     float nfar;
 };
 
+/* world-space side planes (right, left, top, bottom) of a cascade volume, in SIMD friendly form */
+struct ALIGN16 csm_cullplanes
+{
+    struct vec4f nx;
+    struct vec4f ny;
+    struct vec4f nz;
+    struct vec4f d;
+    struct vec4f ax;    /* absolute normals, for projecting aabb extents onto the planes */
+    struct vec4f ay;
+    struct vec4f az;
+};
+
 struct gfx_csm
 {
 	float shadowmap_size;	/* width/height of the shadow map */
+    uint shadow_size;
+    uint cascade_cnt;
+    float far_max;  /* maximum view distance that is covered by cascades */
+    float split_lambda; /* 0 = uniform splits, 1 = logarithmic splits */
 	gfx_rendertarget shadow_rt;
 	gfx_rendertarget prev_rt;
 	gfx_texture shadow_tex; /* shadow map (array(d3d10.1+) or cube(d3d10)) */
-	gfx_texture prev_tex[CSM_CASCADE_CNT];
+    gfx_rendertarget static_rt;
+    gfx_texture static_tex; /* cached depth of static casters (array only), copied to shadow map */
+	gfx_texture prev_tex[CSM_CASCADES_MAX];
     uint shader_cnt;
     struct csm_shader shaders[CSM_SHADER_CNT];
-    struct vec4f cascade_planes[CSM_SHADER_CNT*4];  /* 4 planes for each cascade instead of 6 */
+    struct vec4f cascade_planes[CSM_CASCADES_MAX*4];    /* 4 planes for each cascade instead of 6 */
     uint prev_shader;
+    uint clear_shader;  /* clears selected layers of static_tex */
+    uint copy_shader;   /* copies static_tex layers into shadow map */
     struct gfx_cblock* cb_frame;
-    struct gfx_cblock* cb_xforms;
     struct gfx_cblock* cb_frame_gs;
-    struct gfx_cblock* tb_skins;
     gfx_rasterstate rs_bias;
     gfx_rasterstate rs_bias_doublesided;
     gfx_depthstencilstate ds_depth;
-    struct csm_cascade cascades[CSM_CASCADE_CNT];
-    struct frustum cascade_frusts[CSM_CASCADE_CNT];
-    struct mat4f cascade_vps[CSM_CASCADE_CNT];
-    struct mat4f shadow_mats[CSM_CASCADE_CNT];
+    gfx_depthstencilstate ds_always;
+    struct csm_cascade cascades[CSM_CASCADES_MAX];
+    struct frustum cascade_frusts[CSM_CASCADES_MAX];
+    struct mat4f cascade_vps[CSM_CASCADES_MAX];
+    struct mat4f shadow_mats[CSM_CASCADES_MAX];
+    struct csm_cullplanes cull_planes[CSM_CASCADES_MAX];
+    const uint* caster_masks;   /* cascade bits of each caster in this frame (frame memory) */
+    uint caster_cnts[CSM_CASCADES_MAX];  /* stats: casters that touch each cascade */
+    uint caster_culled_cnt; /* stats: casters that touch no cascade */
+    int cache_static;   /* static casters are rendered into static_tex only when invalidated */
+    struct csm_cache cache;
+    uint static_sigs[CSM_CASCADES_MAX];  /* static caster signatures of this frame */
+    uint static_dirty;  /* cascades that need their static layer re-rendered this frame */
+    uint dynamic_layers;    /* cascades that dynamic casters touch this frame */
+    struct gfx_csm_cachestats stats;
     struct aabb frustum_bounds;
     struct vec3f light_dir;
     int debug_csm;
     gfx_sampler sampl_linear;
-    struct gfx_sharedbuffer* sharedbuff;    /* shared buffer for csm drawing pass */
+    gfx_sampler sampl_point;
 };
 
 /*************************************************************************************************
@@ -90,33 +132,42 @@ struct gfx_csm
  */
 result_t csm_create_shadowrt(uint width, uint height);
 void csm_destroy_shadowrt();
+result_t csm_create_staticrt(uint width, uint height);
+void csm_destroy_staticrt();
 result_t csm_create_prevrt(uint width, uint height);
 void csm_destroy_prevrt();
 int csm_load_shaders(struct allocator* alloc);
 void csm_unload_shaders();
 int csm_load_prev_shaders(struct allocator* alloc);
 void csm_unload_prev_shaders();
+int csm_load_fill_shaders(struct allocator* alloc);
+void csm_unload_fill_shaders();
 
 int csm_add_shader(uint shader_id, uint rpath_flags);
 result_t csm_create_states();
 void csm_destroy_states();
 
-void csm_split_range(float nnear, float nfar, float splits[CSM_CASCADE_CNT+1]);
+void csm_split_range(float nnear, float nfar, float lambda, uint cascade_cnt, OUT float* splits);
 void csm_calc_minsphere(struct sphere* bounds, const struct frustum* f, const struct mat3f* view,
     const struct mat3f* view_inv);
 struct mat4f* csm_calc_orthoproj(struct mat4f* r, float w, float h, float zn, float zf);
 struct mat4f* csm_round_mat(struct mat4f* r, const struct mat4f* m, float shadow_size);
+void csm_calc_cullplanes(struct csm_cullplanes* cp, const struct plane vp_planes[6]);
 
-void csm_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader, uint xforms_shared_idx);
+void csm_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode);
 void csm_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader);
-void csm_submit_batchdata(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items,
-        uint batch_cnt, struct gfx_sharedbuffer* shared_buff);
+    struct gfx_shader* shader, uint mask);
+uint csm_renderbatches(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items, uint batch_cnt,
+    uint layer_mask, enum csm_casters casters);
+void csm_fillcascades(gfx_cmdqueue cmdqueue, uint shader_id, gfx_texture src_tex, uint mask);
 void csm_renderpreview(gfx_cmdqueue cmdqueue, const struct gfx_view_params* params);
+void csm_fgpass_render(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
 
 /* console commands */
 result_t csm_console_debugcsm(uint argc, const char** argv, void* param);
+result_t csm_console_cachecsm(uint argc, const char** argv, void* param);
+result_t csm_console_setparams(uint argc, const char** argv, void* param);
 
 /*************************************************************************************************
  * globals
@@ -148,13 +199,40 @@ result_t gfx_csm_init(uint width, uint height)
         return RET_OUTOFMEMORY;
     memset(g_csm, 0x00, sizeof(struct gfx_csm));
 
+    const struct gfx_params* gparams = &eng_get_params()->gfx;
+    g_csm->cascade_cnt = gfx_csm_get_cascadecnt();
+    g_csm->shadow_size = (gparams->csm_size != 0) ?
+        minui(gparams->csm_size, CSM_SHADOW_SIZE_MAX) : CSM_SHADOW_SIZE;
+    g_csm->shadowmap_size = (float)g_csm->shadow_size;
+    g_csm->far_max = (gparams->csm_far > 0.0f) ? gparams->csm_far : CSM_FAR_MAX;
+    if (gparams->csm_lambda == 0.0f)
+        g_csm->split_lambda = CSM_SPLIT_LAMBDA;
+    else
+        g_csm->split_lambda = clampf(gparams->csm_lambda, 0.0f, 1.0f);
+    log_printf(LOG_INFO, "\tcsm: %d cascades, %dx%d, far: %.1f, split-lambda: %.2f",
+        g_csm->cascade_cnt, g_csm->shadow_size, g_csm->shadow_size, g_csm->far_max,
+        g_csm->split_lambda);
+
     /* render targets and buffers */
-	r = csm_create_shadowrt(CSM_SHADOW_SIZE, CSM_SHADOW_SIZE);
+	r = csm_create_shadowrt(g_csm->shadow_size, g_csm->shadow_size);
 	if (IS_FAIL(r))	{
 		err_print(__FILE__, __LINE__, "gfx-csm init failed: could not create shadow map buffers");
 		return RET_FAIL;
 	}
 
+    /* static caster caching needs array shadow maps (fill shaders write layers through GS) */
+    enum gfx_hwver hwver = gfx_get_hwver();
+    if (hwver != GFX_HWVER_D3D10_0 && hwver != GFX_HWVER_GL3_3 && hwver != GFX_HWVER_GL3_2)  {
+        if (IS_FAIL(csm_create_staticrt(g_csm->shadow_size, g_csm->shadow_size)) ||
+            !csm_load_fill_shaders(lsr_alloc))
+        {
+            err_print(__FILE__, __LINE__, "gfx-csm init failed: could not create static cache");
+            return RET_FAIL;
+        }
+        g_csm->cache_static = TRUE;
+    }
+    csm_cache_reset(&g_csm->cache);
+
 	if (BIT_CHECK(eng_get_params()->flags, ENG_FLAG_DEV))	{
         if (!csm_load_prev_shaders(lsr_alloc))  {
             err_print(__FILE__, __LINE__, "gfx-csm init failed: could not load preview shaders");
@@ -169,6 +247,9 @@ result_t gfx_csm_init(uint width, uint height)
 
         /* console commands */
         con_register_cmd("gfx_debugcsm", csm_console_debugcsm, NULL, "gfx_debugcsm [1*/0]");
+        con_register_cmd("gfx_cachecsm", csm_console_cachecsm, NULL, "gfx_cachecsm [1*/0]");
+        con_register_cmd("gfx_csmparams", csm_console_setparams, NULL,
+            "gfx_csmparams [far:F] [lambda:L] [size:N]");
 	}
 
     /* shaders */
@@ -178,26 +259,11 @@ result_t gfx_csm_init(uint width, uint height)
     }
 
     /* cblocks */
-    if (gfx_check_feature(GFX_FEATURE_RANGED_CBUFFERS)) {
-        g_csm->sharedbuff = gfx_sharedbuffer_create(GFX_DEFAULT_RENDER_OBJ_CNT*GFX_INSTANCES_MAX*48);
-        if (g_csm->sharedbuff == NULL)  {
-            err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create uniform buffer");
-            return RET_FAIL;
-        }
-    }
-
     g_csm->cb_frame = gfx_shader_create_cblock(lsr_alloc, tmp_alloc,
         gfx_shader_get(g_csm->shaders[0].shader_id), "cb_frame", NULL);
-    g_csm->cb_xforms = gfx_shader_create_cblock(lsr_alloc, tmp_alloc,
-        gfx_shader_get(g_csm->shaders[0].shader_id), "cb_xforms", g_csm->sharedbuff);
     g_csm->cb_frame_gs = gfx_shader_create_cblock(lsr_alloc, tmp_alloc,
         gfx_shader_get(g_csm->shaders[0].shader_id), "cb_frame_gs", NULL);
-    g_csm->tb_skins = gfx_shader_create_cblock_tbuffer(mem_heap(),
-        gfx_shader_get(gfx_csm_getshader(CMP_OBJTYPE_MODEL, GFX_RPATH_SKINNED | GFX_RPATH_CSMSHADOW)),
-        "tb_skins", sizeof(struct vec4f)*3*GFX_INSTANCES_MAX*GFX_SKIN_BONES_MAX);
-    if (g_csm->cb_frame == NULL || g_csm->cb_xforms == NULL || g_csm->cb_frame_gs == NULL ||
-        g_csm->tb_skins == NULL)
-    {
+    if (g_csm->cb_frame == NULL || g_csm->cb_frame_gs == NULL)  {
         err_print(__FILE__, __LINE__, "gfx-csm init failed: could not create cblocks");
         return RET_FAIL;
     }
@@ -209,31 +275,24 @@ result_t gfx_csm_init(uint width, uint height)
         return RET_FAIL;
     }
 
-    g_csm->shadowmap_size = (float)CSM_SHADOW_SIZE;
-
 	return RET_OK;
 }
 
 void gfx_csm_release()
 {
     if (g_csm != NULL)  {
-        if (g_csm->sharedbuff != NULL)
-            gfx_sharedbuffer_destroy(g_csm->sharedbuff);
-
         csm_destroy_states();
 
         if (g_csm->cb_frame != NULL)
             gfx_shader_destroy_cblock(g_csm->cb_frame);
-        if (g_csm->cb_xforms != NULL)
-            gfx_shader_destroy_cblock(g_csm->cb_xforms);
         if (g_csm->cb_frame_gs != NULL)
             gfx_shader_destroy_cblock(g_csm->cb_frame_gs);
-        if (g_csm->tb_skins != NULL)
-            gfx_shader_destroy_cblock(g_csm->tb_skins);
 
         csm_unload_prev_shaders();
+        csm_unload_fill_shaders();
         csm_unload_shaders();
 	    csm_destroy_shadowrt();
+        csm_destroy_staticrt();
 	    csm_destroy_prevrt();
 
         ALIGNED_FREE(g_csm);
@@ -241,6 +300,27 @@ void gfx_csm_release()
     }
 }
 
+/* csm pass consumes this frame's caster masks and keeps static cache in sync, so it's never
+ * culled even if nothing reads the shadow maps */
+void gfx_csm_setup(struct gfx_fgraph* fg, const struct gfx_view_params* params,
+    struct gfx_rpath_data* data)
+{
+    if (g_csm->debug_csm)
+        gfx_set_previewrenderflag();
+
+    uint pass = gfx_fg_addpass(fg, "csm", GFX_FG_PASS_NOCULL, csm_fgpass_render, data);
+    gfx_fg_write(fg, pass, data->output_res);
+}
+
+/* param: gfx_rpath_data */
+void csm_fgpass_render(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_rpath_data* data = (struct gfx_rpath_data*)param;
+    gfx_csm_render(cmdqueue, NULL, params, data->batch_items, data->batch_cnt, data->userdata,
+        data->result);
+}
+
 void gfx_csm_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
         const struct gfx_view_params* params, struct gfx_batch_item* batch_items, uint batch_cnt,
         void* userdata, OUT struct gfx_rpath_result* result)
@@ -249,23 +329,13 @@ void gfx_csm_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
 
     PRF_OPENSAMPLE("rpath-csm");
 
-    int supports_shared_cbuff = gfx_check_feature(GFX_FEATURE_RANGED_CBUFFERS);
-    if (supports_shared_cbuff)
-        csm_submit_batchdata(cmdqueue, batch_items, batch_cnt, g_csm->sharedbuff);
-
-    gfx_cmdqueue_resetsrvs(cmdqueue);
-    gfx_output_setrendertarget(cmdqueue, g_csm->shadow_rt);
-    gfx_output_setviewport(cmdqueue, 0, 0, CSM_SHADOW_SIZE, CSM_SHADOW_SIZE);
-    gfx_output_setrasterstate(cmdqueue, g_csm->rs_bias);
-    gfx_output_setdepthstencilstate(cmdqueue, g_csm->ds_depth, 0);
-    gfx_output_clearrendertarget(cmdqueue, g_csm->shadow_rt, NULL, 1.0f, 0, GFX_CLEAR_DEPTH);
-
     struct gfx_cblock* cb_frame = g_csm->cb_frame;
     struct gfx_cblock* cb_frame_gs = g_csm->cb_frame_gs;
-    struct mat3f* views[CSM_CASCADE_CNT];
+    uint cascade_cnt = g_csm->cascade_cnt;
+    struct mat3f* views[CSM_CASCADES_MAX];
     float fovfactors[4];
-    float texelsz[4] = {1.0f / (float)CSM_SHADOW_SIZE, 0, 0, 0};
-    for (uint i = 0; i < CSM_CASCADE_CNT && i < 4; i++)    {
+    float texelsz[4] = {1.0f / g_csm->shadowmap_size, 0, 0, 0};
+    for (uint i = 0; i < cascade_cnt; i++)    {
         views[i] = &g_csm->cascades[i].view;
         fovfactors[i] = maxf(g_csm->cascades[i].proj.m11, g_csm->cascades[i].proj.m22);
     }
@@ -273,91 +343,169 @@ void gfx_csm_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
     gfx_cb_set4f(cb_frame, SHADER_NAME(c_texelsz), texelsz);
     gfx_cb_set4f(cb_frame, SHADER_NAME(c_fovfactors), fovfactors);
     gfx_cb_set4f(cb_frame, SHADER_NAME(c_lightdir), g_csm->light_dir.f);
-    gfx_cb_set3mvp(cb_frame, SHADER_NAME(c_views), (const struct mat3f**)views, CSM_CASCADE_CNT);
-    gfx_cb_set4mv(cb_frame, SHADER_NAME(c_cascade_mats), g_csm->cascade_vps, CSM_CASCADE_CNT);
+    gfx_cb_set3mvp(cb_frame, SHADER_NAME(c_views), (const struct mat3f**)views, cascade_cnt);
+    gfx_cb_set4mv(cb_frame, SHADER_NAME(c_cascade_mats), g_csm->cascade_vps, cascade_cnt);
     gfx_shader_updatecblock(cmdqueue, cb_frame);
 
     gfx_cb_set4fv(cb_frame_gs, SHADER_NAME(c_cascade_planes), g_csm->cascade_planes,
-        4*CSM_CASCADE_CNT);
+        4*cascade_cnt);
     gfx_shader_updatecblock(cmdqueue, cb_frame_gs);
 
-    for (uint i = 0; i < batch_cnt; i++)  {
-        struct gfx_batch_item* bitem = &batch_items[i];
-        struct gfx_shader* shader = gfx_shader_get(bitem->shader_id);
-        ASSERT(shader);
-        gfx_shader_bind(cmdqueue, shader);
+    gfx_cmdqueue_resetsrvs(cmdqueue);
+    gfx_output_setviewport(cmdqueue, 0, 0, g_csm->shadow_size, g_csm->shadow_size);
+    gfx_output_setrasterstate(cmdqueue, g_csm->rs_bias);
 
-        /* do not send cb_xforms to shader if we are using shared buffer (bind later before draw) */
-        struct gfx_cblock* cbs[3];
-        uint xforms_shared_idx;
-        if (supports_shared_cbuff)  {
-            cbs[0] = cb_frame;
-            cbs[1] = cb_frame_gs;
-            xforms_shared_idx = 2;
-        }   else    {
-            cbs[0] = cb_frame;
-            cbs[1] = cb_frame_gs;
-            cbs[2] = g_csm->cb_xforms;
-            xforms_shared_idx = 3;
+    uint all_mask = (1u << cascade_cnt) - 1;
+    if (g_csm->cache_static && g_csm->caster_masks != NULL)    {
+        /* re-render invalidated static layers, clean layers keep last frame's depth */
+        uint dirty = g_csm->static_dirty;
+        g_csm->stats.static_draw_cnt = 0;
+        if (dirty != 0) {
+            PRF_OPENSAMPLE("csm-static");
+            gfx_output_setrendertarget(cmdqueue, g_csm->static_rt);
+            if (dirty == all_mask)  {
+                gfx_output_clearrendertarget(cmdqueue, g_csm->static_rt, NULL, 1.0f, 0,
+                    GFX_CLEAR_DEPTH);
+            }   else    {
+                csm_fillcascades(cmdqueue, g_csm->clear_shader, NULL, dirty);
+            }
+
+            gfx_output_setdepthstencilstate(cmdqueue, g_csm->ds_depth, 0);
+            g_csm->stats.static_draw_cnt = csm_renderbatches(cmdqueue, batch_items, batch_cnt,
+                dirty, CSM_CASTERS_STATIC);
+            csm_cache_commit(&g_csm->cache, g_csm->cascade_vps, g_csm->static_sigs, dirty);
+            PRF_CLOSESAMPLE();  /* csm-static */
         }
-        gfx_shader_bindcblocks(cmdqueue, shader, (const struct gfx_cblock**)cbs, xforms_shared_idx);
 
-        /* batch draw */
-        for (int k = 0; k < bitem->nodes.item_cnt; k++)  {
-            struct gfx_batch_node* bnode_first = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
+        /* start from static depth and draw dynamic casters on top, layers that no dynamic caster
+         * has drawn over since their static depth was copied are left as they are */
+        uint copy_mask = csm_cache_copymask(&g_csm->cache, dirty, cascade_cnt);
+        gfx_output_setrendertarget(cmdqueue, g_csm->shadow_rt);
+        if (copy_mask != 0) {
+            PRF_OPENSAMPLE("csm-copy");
+            csm_fillcascades(cmdqueue, g_csm->copy_shader, g_csm->static_tex, copy_mask);
+            PRF_CLOSESAMPLE();
+        }
 
-            csm_preparebatchnode(cmdqueue, bnode_first, shader);
-            if (bnode_first->poses[0] != NULL)  {
-                gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_skins),
-                    g_csm->tb_skins);
-            }
+        PRF_OPENSAMPLE("csm-dynamic");
+        gfx_output_setdepthstencilstate(cmdqueue, g_csm->ds_depth, 0);
+        g_csm->stats.draw_cnt = g_csm->stats.static_draw_cnt +
+            csm_renderbatches(cmdqueue, batch_items, batch_cnt, all_mask, CSM_CASTERS_DYNAMIC);
+        csm_cache_setshadow(&g_csm->cache, copy_mask, g_csm->dynamic_layers);
+        PRF_CLOSESAMPLE();
 
-            struct linked_list* node = bnode_first->bll;
-            while (node != NULL)    {
-                struct gfx_batch_node* bnode = (struct gfx_batch_node*)node->data;
-                csm_drawbatchnode(cmdqueue, bnode, shader, xforms_shared_idx);
-                node = node->next;
-            }
-        }
+        g_csm->stats.redrawn_mask = dirty;
+        g_csm->stats.copied_mask = copy_mask;
+    }   else    {
+        gfx_output_setrendertarget(cmdqueue, g_csm->shadow_rt);
+        gfx_output_setdepthstencilstate(cmdqueue, g_csm->ds_depth, 0);
+        gfx_output_clearrendertarget(cmdqueue, g_csm->shadow_rt, NULL, 1.0f, 0, GFX_CLEAR_DEPTH);
+        g_csm->stats.draw_cnt = csm_renderbatches(cmdqueue, batch_items, batch_cnt, all_mask,
+            CSM_CASTERS_ALL);
+
+        /* cached layers are not maintained in this mode */
+        csm_cache_reset(&g_csm->cache);
+        g_csm->stats.static_draw_cnt = 0;
+        g_csm->stats.redrawn_mask = 0;
+        g_csm->stats.copied_mask = 0;
     }
 
     /* switch back */
     gfx_output_setrasterstate(cmdqueue, NULL);
     gfx_output_setdepthstencilstate(cmdqueue, NULL, 0);
 
+    /* masks are allocated from the frame allocator */
+    g_csm->caster_masks = NULL;
+
     if (g_csm->debug_csm)
         csm_renderpreview(cmdqueue, params);
 
     PRF_CLOSESAMPLE();  /* csm */
 }
 
-/* prepass for submitting per-object (xforms) data to shaders (uniform sharing required)
- * offset/size data will be assigned into meta_data member of each batch */
-void csm_submit_batchdata(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items,
-                          uint batch_cnt, struct gfx_sharedbuffer* shared_buff)
+/* draws batch nodes of the requested caster type into cascades of 'layer_mask'
+ * render target and depth state must be set by the caller, returns number of drawn nodes */
+uint csm_renderbatches(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items, uint batch_cnt,
+    uint layer_mask, enum csm_casters casters)
 {
-    gfx_sharedbuffer_reset(g_csm->sharedbuff);
-    for (uint i = 0; i < batch_cnt; i++)	{
+    uint draw_cnt = 0;
+    struct gfx_cblock* cb_frame = g_csm->cb_frame;
+    struct gfx_cblock* cb_frame_gs = g_csm->cb_frame_gs;
+
+    for (uint i = 0; i < batch_cnt; i++)  {
         struct gfx_batch_item* bitem = &batch_items[i];
+        struct gfx_shader* shader = gfx_shader_get(bitem->shader_id);
+        ASSERT(shader);
+        gfx_shader_bind(cmdqueue, shader);
+
+        const struct gfx_cblock* cbs[] = {cb_frame, cb_frame_gs};
+        gfx_shader_bindcblocks(cmdqueue, shader, cbs, 2);
+
+        /* transforms and instance records are shared with the other passes of the frame */
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_xforms),
+            gfx_get_xformstream());
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_instances),
+            gfx_get_instancestream());
 
-        for (int k = 0; k < bitem->nodes.item_cnt; k++)	{
-            struct gfx_batch_node* bnode_first =
-                &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
-            struct linked_list* node = bnode_first->bll;
-            while (node != NULL)	{
-                struct gfx_batch_node* bnode = (struct gfx_batch_node*)node->data;
-                gfx_cb_set3mvp(g_csm->cb_xforms, SHADER_NAME(c_mats),
-                    bnode->instance_mats, bnode->instance_cnt);
-                bnode->meta_data = gfx_sharedbuffer_write(shared_buff,
-                    cmdqueue, g_csm->cb_xforms->cpu_buffer, 48*bnode->instance_cnt);
-                node = node->next;
+        /* batch draw */
+        for (int k = 0; k < bitem->nodes.item_cnt; k++)  {
+            struct gfx_batch_node* bnode = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
+            if (bnode->instance_cnt == 0)
+                continue;
+
+            /* instances are batched by their cascade mask too (see
+             * gfx_renderpass_process_sunshadow), so all instances of the node share the
+             * mask of the first one */
+            struct scn_render_model* rmodel = (struct scn_render_model*)bnode->ritem;
+            uint mask = (g_csm->caster_masks != NULL) ?
+                g_csm->caster_masks[rmodel->bounds_idx] : 0xffffffff;
+            if (casters != CSM_CASTERS_ALL)   {
+                int is_dynamic = (mask & GFX_CSM_CASTER_DYNAMIC) != 0;
+                if (is_dynamic != (casters == CSM_CASTERS_DYNAMIC))
+                    continue;
             }
-        }	/* for: each batch-item */
+            mask &= layer_mask;
+            if (mask == 0)
+                continue;
+
+            csm_preparebatchnode(cmdqueue, bnode, shader, mask);
+            if (bnode->skinned)  {
+                gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_skins),
+                    gfx_get_skinpalette());
+            }
+
+            csm_drawbatchnode(cmdqueue, bnode);
+            draw_cnt++;
+        }
     }
+
+    return draw_cnt;
+}
+
+/* writes depth into 'mask' layers of the bound shadow target with a fullscreen quad
+ * src_tex == NULL clears the layers, otherwise copies the same layers of src_tex */
+void csm_fillcascades(gfx_cmdqueue cmdqueue, uint shader_id, gfx_texture src_tex, uint mask)
+{
+    struct gfx_shader* shader = gfx_shader_get(shader_id);
+
+    gfx_output_setdepthstencilstate(cmdqueue, g_csm->ds_always, 0);
+    gfx_output_setrasterstate(cmdqueue, g_csm->rs_bias_doublesided);
+    gfx_shader_bind(cmdqueue, shader);
+
+    gfx_shader_setui(shader, SHADER_NAME(c_cascade_mask), mask);
+    gfx_shader_bindconstants(cmdqueue, shader);
+    if (src_tex != NULL)    {
+        gfx_shader_bindsamplertexture(cmdqueue, shader, SHADER_NAME(s_shadowmap),
+            g_csm->sampl_point, src_tex);
+    }
+
+    gfx_draw_fullscreenquad();
+
+    gfx_output_setrasterstate(cmdqueue, g_csm->rs_bias);
 }
 
 void csm_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader)
+    struct gfx_shader* shader, uint mask)
 {
     struct scn_render_model* rmodel = (struct scn_render_model*)bnode->ritem;
     struct gfx_model* gmodel = rmodel->gmodel;
@@ -380,43 +528,20 @@ void csm_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
         }
     }
 
+    gfx_shader_setui(shader, SHADER_NAME(c_cascade_mask), mask);
+    gfx_shader_setui(shader, SHADER_NAME(c_instance_offset), bnode->instance_offset);
+    gfx_shader_bindconstants(cmdqueue, shader);
+
     gfx_input_setlayout(cmdqueue, geo->inputlayout);
 }
 
-void csm_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader, uint xforms_shared_idx)
+void csm_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode)
 {
     struct scn_render_model* rmodel = (struct scn_render_model*)bnode->ritem;
     struct gfx_model* gmodel = rmodel->gmodel;
     struct gfx_model_mesh* mesh = &gmodel->meshes[gmodel->nodes[rmodel->node_idx].mesh_id];
     struct gfx_model_geo* geo = &gmodel->geos[mesh->geo_id];
 
-    /* set transform matricesbind only for shared mode (we have updated the buffer in a prepass) */
-    struct gfx_cblock* cb_xforms = g_csm->cb_xforms;
-    if (cb_xforms->shared_buff != NULL)  {
-        sharedbuffer_pos_t pos = bnode->meta_data;
-        gfx_shader_bindcblock_shared(cmdqueue, shader, g_csm->cb_xforms,
-            cb_xforms->shared_buff->gpu_buff,
-            GFX_SHAREDBUFFER_OFFSET(pos), GFX_SHAREDBUFFER_SIZE(pos), xforms_shared_idx);
-    }   else    {
-        gfx_cb_set3mvp(g_csm->cb_xforms, SHADER_NAME(c_mats), bnode->instance_mats,
-            bnode->instance_cnt);
-        gfx_shader_updatecblock(cmdqueue, g_csm->cb_xforms);
-    }
-
-    /* skin data */
-    if (bnode->poses[0] != NULL)   {
-        struct gfx_cblock* tb_skins = g_csm->tb_skins;
-        for (uint i = 0, cnt = bnode->instance_cnt; i < cnt; i++) {
-            const struct gfx_model_posegpu* pose = bnode->poses[i];
-
-            gfx_cb_set3mv_offset(tb_skins, 0, pose->skin_mats, pose->mat_cnt,
-                i*GFX_SKIN_BONES_MAX*sizeof(struct vec4f)*3);
-        }
-
-        gfx_shader_updatecblock(cmdqueue, tb_skins);
-    }
-
     /* draw */
     if (bnode->sub_idx == INVALID_INDEX)    {
         gfx_draw_indexedinstance(cmdqueue, GFX_PRIMITIVE_TRIANGLELIST, 0, geo->tri_cnt*3,
@@ -456,7 +581,7 @@ result_t csm_create_shadowrt(uint width, uint height)
 	{
 		g_csm->shadow_tex = gfx_create_texturert_cube(width, height, GFX_FORMAT_DEPTH32);
 	}	else	{
-		g_csm->shadow_tex = gfx_create_texturert_arr(width, height, CSM_CASCADE_CNT,
+		g_csm->shadow_tex = gfx_create_texturert_arr(width, height, g_csm->cascade_cnt,
             GFX_FORMAT_DEPTH32);
 	}
 
@@ -478,15 +603,37 @@ void csm_destroy_shadowrt()
 		gfx_destroy_texture(g_csm->shadow_tex);
 }
 
+result_t csm_create_staticrt(uint width, uint height)
+{
+    g_csm->static_tex = gfx_create_texturert_arr(width, height, g_csm->cascade_cnt,
+        GFX_FORMAT_DEPTH32);
+    if (g_csm->static_tex == NULL)
+        return RET_FAIL;
+
+    g_csm->static_rt = gfx_create_rendertarget(NULL, 0, g_csm->static_tex);
+    if (g_csm->static_rt == NULL)
+        return RET_FAIL;
+
+    return RET_OK;
+}
+
+void csm_destroy_staticrt()
+{
+    if (g_csm->static_rt != NULL)
+        gfx_destroy_rendertarget(g_csm->static_rt);
+    if (g_csm->static_tex != NULL)
+        gfx_destroy_texture(g_csm->static_tex);
+}
+
 result_t csm_create_prevrt(uint width, uint height)
 {
-    for (uint i = 0; i < CSM_CASCADE_CNT; i++)    {
+    for (uint i = 0; i < g_csm->cascade_cnt; i++)    {
 	    g_csm->prev_tex[i] = gfx_create_texturert(width, height, GFX_FORMAT_RGBA_UNORM, FALSE);
 	    if (g_csm->prev_tex[i] == NULL)
 		    return RET_FAIL;
     }
 
-	g_csm->prev_rt = gfx_create_rendertarget(g_csm->prev_tex, CSM_CASCADE_CNT, NULL);
+	g_csm->prev_rt = gfx_create_rendertarget(g_csm->prev_tex, g_csm->cascade_cnt, NULL);
 	if (g_csm->prev_rt == NULL)
 		return RET_FAIL;
 
@@ -497,7 +644,7 @@ void csm_destroy_prevrt()
 {
 	if (g_csm->prev_rt != NULL)
 		gfx_destroy_rendertarget(g_csm->prev_rt);
-	for (uint i = 0; i < CSM_CASCADE_CNT; i++)    {
+	for (uint i = 0; i < g_csm->cascade_cnt; i++)    {
         if (g_csm->prev_tex[i] != NULL)
 		    gfx_destroy_texture(g_csm->prev_tex[i]);
     }
@@ -506,25 +653,26 @@ void csm_destroy_prevrt()
 int csm_load_shaders(struct allocator* alloc)
 {
     int r;
-    char max_instances_str[8];
     char cascade_cnt_str[8];
     char max_bones_str[8];
+    char max_verts_str[8];
 
     /* include all extra stuff in rpath flags (because csm-renderer can render them all) */
     uint extra_rpath = GFX_RPATH_DIFFUSEMAP | GFX_RPATH_NORMALMAP | GFX_RPATH_ALPHAMAP |
         GFX_RPATH_REFLECTIONMAP | GFX_RPATH_EMISSIVEMAP | GFX_RPATH_GLOSSMAP | GFX_RPATH_RAW;
 
-    str_itos(max_instances_str, GFX_INSTANCES_MAX);
-    str_itos(cascade_cnt_str, CSM_CASCADE_CNT);
+    str_itos(cascade_cnt_str, g_csm->cascade_cnt);
     str_itos(max_bones_str, GFX_SKIN_BONES_MAX);
+    str_itos(max_verts_str, 3*g_csm->cascade_cnt);  /* GS outputs a triangle per cascade */
 
     /* for normal csm, do not load pixel-shader */
-    gfx_shader_beginload(alloc, "shaders/csm.vs", NULL, "shaders/csm.gs", 1, "shaders/skin.inc");
+    gfx_shader_beginload(alloc, "shaders/csm.vs", NULL, "shaders/csm.gs", 2,
+        "shaders/instance.inc", "shaders/skin.inc");
     r = csm_add_shader(gfx_shader_add("csm-raw", 2, 2,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
-        "_MAX_INSTANCES_", max_instances_str,
-        "_CASCADE_CNT_", cascade_cnt_str),
+        "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str),
         GFX_RPATH_CSMSHADOW | extra_rpath);
     if (!r)
         return FALSE;
@@ -533,8 +681,8 @@ int csm_load_shaders(struct allocator* alloc)
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str,
         "_SKIN_", "1",
         "_MAX_BONES_", max_bones_str),
         GFX_RPATH_CSMSHADOW | GFX_RPATH_SKINNED | extra_rpath);
@@ -543,14 +691,14 @@ int csm_load_shaders(struct allocator* alloc)
     gfx_shader_endload();
 
     /* for alpha-test shaders, load pixel-shader too */
-    gfx_shader_beginload(alloc, "shaders/csm.vs", "shaders/csm.ps", "shaders/csm.gs", 1,
-        "shaders/skin.inc");
+    gfx_shader_beginload(alloc, "shaders/csm.vs", "shaders/csm.ps", "shaders/csm.gs", 2,
+        "shaders/instance.inc", "shaders/skin.inc");
     r = csm_add_shader(gfx_shader_add("csm-alpha", 3, 3,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm",  0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
-        "_MAX_INSTANCES_", max_instances_str,
         "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str,
         "_ALPHAMAP_", "1"),
         GFX_RPATH_CSMSHADOW | GFX_RPATH_ALPHAMAP | extra_rpath);
     if (!r)
@@ -561,8 +709,8 @@ int csm_load_shaders(struct allocator* alloc)
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str,
         "_ALPHAMAP_", "1",
         "_SKIN_", "1",
         "_MAX_BONES_", max_bones_str),
@@ -580,6 +728,39 @@ void csm_unload_shaders()
         gfx_shader_unload(g_csm->shaders[i].shader_id);
 }
 
+int csm_load_fill_shaders(struct allocator* alloc)
+{
+    char cascade_cnt_str[8];
+    char max_verts_str[8];
+    str_itos(cascade_cnt_str, g_csm->cascade_cnt);
+    str_itos(max_verts_str, 3*g_csm->cascade_cnt);
+
+    gfx_shader_beginload(alloc, "shaders/fsq.vs", "shaders/csm-fill.ps", "shaders/csm-fill.gs",
+        0);
+    g_csm->clear_shader = gfx_shader_add("csm-clear", 2, 2,
+        GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
+        GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
+        "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str);
+    g_csm->copy_shader = gfx_shader_add("csm-copy", 2, 3,
+        GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
+        GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
+        "_CASCADE_CNT_", cascade_cnt_str,
+        "_MAX_VERTS_", max_verts_str,
+        "_COPY_", "1");
+    gfx_shader_endload();
+
+    return g_csm->clear_shader != 0 && g_csm->copy_shader != 0;
+}
+
+void csm_unload_fill_shaders()
+{
+    if (g_csm->clear_shader != 0)
+        gfx_shader_unload(g_csm->clear_shader);
+    if (g_csm->copy_shader != 0)
+        gfx_shader_unload(g_csm->copy_shader);
+}
+
 int csm_add_shader(uint shader_id, uint rpath_flags)
 {
     ASSERT(g_csm->shader_cnt < CSM_SHADER_CNT);
@@ -616,6 +797,12 @@ result_t csm_create_states()
     if (g_csm->ds_depth == NULL)
         return RET_FAIL;
 
+    /* fill passes overwrite depth regardless of the current value */
+    dsdesc.depth_func = GFX_CMP_ALWAYS;
+    g_csm->ds_always = gfx_create_depthstencilstate(&dsdesc);
+    if (g_csm->ds_always == NULL)
+        return RET_FAIL;
+
     /* samplers */
     struct gfx_sampler_desc sdesc;
     memcpy(&sdesc, gfx_get_defaultsampler(), sizeof(sdesc));
@@ -626,6 +813,12 @@ result_t csm_create_states()
     if (g_csm->sampl_linear == NULL)
         return RET_FAIL;
 
+    sdesc.filter_min = GFX_FILTER_NEAREST;
+    sdesc.filter_mag = GFX_FILTER_NEAREST;
+    g_csm->sampl_point = gfx_create_sampler(&sdesc);
+    if (g_csm->sampl_point == NULL)
+        return RET_FAIL;
+
     return RET_OK;
 }
 
@@ -633,6 +826,8 @@ void csm_destroy_states()
 {
     if (g_csm->ds_depth != NULL)
         gfx_destroy_depthstencilstate(g_csm->ds_depth);
+    if (g_csm->ds_always != NULL)
+        gfx_destroy_depthstencilstate(g_csm->ds_always);
 
     if (g_csm->rs_bias != NULL)
         gfx_destroy_rasterstate(g_csm->rs_bias);
@@ -642,6 +837,8 @@ void csm_destroy_states()
 
     if (g_csm->sampl_linear != NULL)
         gfx_destroy_sampler(g_csm->sampl_linear);
+    if (g_csm->sampl_point != NULL)
+        gfx_destroy_sampler(g_csm->sampl_point);
 }
 
 void csm_calc_cascadeplanes(struct vec4f* planes, const struct plane vp_planes[6],
@@ -690,7 +887,7 @@ void gfx_csm_prepare(const struct gfx_view_params* params, const struct vec3f* l
     struct mat3f view_inv;
     struct mat4f tex_mat;
     struct mat4f tmp_mat;
-    float splits[CSM_CASCADE_CNT+1];
+    float splits[CSM_CASCADES_MAX+1];
 
     mat3_setf(&view_inv,
         params->view.m11, params->view.m21, params->view.m31,
@@ -703,14 +900,15 @@ void gfx_csm_prepare(const struct gfx_view_params* params, const struct vec3f* l
         0.0f, 0.0f, 1.0f, 0.0f,
         texoffset_x, texoffset_y, 0.0f, 1.0f);
 
-    float csm_far = minf(CSM_FAR_MAX, params->cam->ffar);
-    csm_split_range(params->cam->fnear, csm_far, splits);
+    uint cascade_cnt = g_csm->cascade_cnt;
+    float csm_far = minf(g_csm->far_max, params->cam->ffar);
+    csm_split_range(params->cam->fnear, csm_far, g_csm->split_lambda, cascade_cnt, splits);
 
     /* calculate cascades */
     struct frustum f;   /* frustum points for cascades */
     struct plane vp_planes[6];
 
-    for (uint i = 0; i < CSM_CASCADE_CNT; i++)    {
+    for (uint i = 0; i < cascade_cnt; i++)    {
         cam_calc_frustumcorners(params->cam, (struct vec3f*)f.points, &splits[i], &splits[i+1]);
         csm_calc_minsphere(&g_csm->cascades[i].bounds, &f, &params->view, &view_inv);
         memcpy(&g_csm->cascade_frusts[i], &f, sizeof(f));
@@ -772,6 +970,10 @@ void gfx_csm_prepare(const struct gfx_view_params* params, const struct vec3f* l
 
         csm_round_mat(&g_csm->cascade_vps[i], &g_csm->cascade_vps[i], g_csm->shadowmap_size);
 
+        /* caster culling uses the final (snapped) volume */
+        cam_calc_frustumplanes(vp_planes, &g_csm->cascade_vps[i]);
+        csm_calc_cullplanes(&g_csm->cull_planes[i], vp_planes);
+
         mat4_mul(&g_csm->shadow_mats[i],
             mat3_mul4(&tmp_mat, &view_inv, &g_csm->cascade_vps[i]), &tex_mat);
     }
@@ -782,13 +984,13 @@ void gfx_csm_prepare(const struct gfx_view_params* params, const struct vec3f* l
     aabb_setzero(&g_csm->frustum_bounds);
 
     aabb_from_sphere(&cascade_near, &g_csm->cascades[0].bounds);
-    aabb_from_sphere(&cascade_far, &g_csm->cascades[CSM_CASCADE_CNT-1].bounds);
+    aabb_from_sphere(&cascade_far, &g_csm->cascades[cascade_cnt-1].bounds);
     aabb_merge(&g_csm->frustum_bounds, &cascade_near, &cascade_far);
 
     vec3_setv(&g_csm->light_dir, &dir);
 }
 
-void csm_split_range(float nnear, float nfar, float splits[CSM_CASCADE_CNT+1])
+void csm_split_range(float nnear, float nfar, float lambda, uint cascade_cnt, OUT float* splits)
 {
     /* Practical split scheme:
      *
@@ -797,17 +999,15 @@ void csm_split_range(float nnear, float nfar, float splits[CSM_CASCADE_CNT+1])
      * Ci = CLi*(lambda) + CUi*(1-lambda)
      *
      * lambda scales between logarithmic and uniform */
-    static const float weight = 0.75f;
-
-    for (uint i = 0; i < CSM_CASCADE_CNT; i++)	{
-        float idm = ((float)i) / CSM_CASCADE_CNT;
+    for (uint i = 0; i < cascade_cnt; i++)	{
+        float idm = ((float)i) / (float)cascade_cnt;
         float nlog = nnear * powf(nfar/nnear, idm);
         float nuniform = nnear + (nfar - nnear)*idm;
-        splits[i] = nlog*weight + nuniform*(1.0f - weight);
+        splits[i] = nlog*lambda + nuniform*(1.0f - lambda);
     }
 
     splits[0] = nnear;
-    splits[CSM_CASCADE_CNT] = nfar;
+    splits[cascade_cnt] = nfar;
 }
 
 void csm_calc_minsphere(struct sphere* bounds, const struct frustum* f,
@@ -831,6 +1031,121 @@ void csm_calc_minsphere(struct sphere* bounds, const struct frustum* f,
     sphere_setf(bounds, p.x, p.y, p.z, vec3_len(vec3_sub(&tmp, &f->points[5], &p)) + 0.01f);
 }
 
+void csm_calc_cullplanes(struct csm_cullplanes* cp, const struct plane vp_planes[6])
+{
+    const struct plane* r = &vp_planes[CAM_FRUSTUM_RIGHT];
+    const struct plane* l = &vp_planes[CAM_FRUSTUM_LEFT];
+    const struct plane* t = &vp_planes[CAM_FRUSTUM_TOP];
+    const struct plane* b = &vp_planes[CAM_FRUSTUM_BOTTOM];
+
+    vec4_setf(&cp->nx, r->nx, l->nx, t->nx, b->nx);
+    vec4_setf(&cp->ny, r->ny, l->ny, t->ny, b->ny);
+    vec4_setf(&cp->nz, r->nz, l->nz, t->nz, b->nz);
+    vec4_setf(&cp->d, r->d, l->d, t->d, b->d);
+    vec4_setf(&cp->ax, fabsf(r->nx), fabsf(l->nx), fabsf(t->nx), fabsf(b->nx));
+    vec4_setf(&cp->ay, fabsf(r->ny), fabsf(l->ny), fabsf(t->ny), fabsf(b->ny));
+    vec4_setf(&cp->az, fabsf(r->nz), fabsf(l->nz), fabsf(t->nz), fabsf(b->nz));
+}
+
+/* near/far planes are not tested, casters between the light and the cascade still cast shadows
+ * and the far plane is already extended to the bottom of the world in gfx_csm_prepare */
+#if defined(_SIMD_SSE_)
+const uint* gfx_csm_cullcasters(struct allocator* alloc, const struct aabb* bounds,
+    const int* dynamics, const uint* ids, uint cnt)
+{
+    PRF_OPENSAMPLE("csm-cull");
+
+    memset(g_csm->caster_cnts, 0x00, sizeof(g_csm->caster_cnts));
+    memset(g_csm->static_sigs, 0x00, sizeof(g_csm->static_sigs));
+    g_csm->caster_culled_cnt = 0;
+    g_csm->stats.static_cnt = 0;
+    g_csm->stats.dynamic_cnt = 0;
+    g_csm->dynamic_layers = 0;
+    g_csm->caster_masks = NULL;
+
+    uint* masks = (cnt > 0) ? (uint*)A_ALLOC(alloc, sizeof(uint)*cnt, MID_GFX) : NULL;
+    if (masks == NULL)  {
+        PRF_CLOSESAMPLE();
+        return NULL;
+    }
+
+    uint cascade_cnt = g_csm->cascade_cnt;
+    simd_t _half = _mm_set1_ps(0.5f);
+    simd_t _zero = _mm_setzero_ps();
+    for (uint i = 0; i < cnt; i++)    {
+        simd_t _min = _mm_load_ps(bounds[i].minpt.f);
+        simd_t _max = _mm_load_ps(bounds[i].maxpt.f);
+        simd_t _c = _mm_mul_ps(_mm_add_ps(_min, _max), _half);
+        simd_t _e = _mm_mul_ps(_mm_sub_ps(_max, _min), _half);
+        simd_t _cx = _mm_all_x(_c);
+        simd_t _cy = _mm_all_y(_c);
+        simd_t _cz = _mm_all_z(_c);
+        simd_t _ex = _mm_all_x(_e);
+        simd_t _ey = _mm_all_y(_e);
+        simd_t _ez = _mm_all_z(_e);
+        uint mask = 0;
+
+        for (uint k = 0; k < cascade_cnt; k++)    {
+            const struct csm_cullplanes* p = &g_csm->cull_planes[k];
+
+            /* distance of the box center to 4 planes + projected box extents on the normals */
+            simd_t _d = _mm_mul_ps(_cx, _mm_load_ps(p->nx.f));
+            _d = _mm_madd(_cy, _mm_load_ps(p->ny.f), _d);
+            _d = _mm_madd(_cz, _mm_load_ps(p->nz.f), _d);
+            _d = _mm_add_ps(_d, _mm_load_ps(p->d.f));
+            simd_t _r = _mm_mul_ps(_ex, _mm_load_ps(p->ax.f));
+            _r = _mm_madd(_ey, _mm_load_ps(p->ay.f), _r);
+            _r = _mm_madd(_ez, _mm_load_ps(p->az.f), _r);
+
+            /* box is outside if it's completely behind any of the planes */
+            if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(_d, _r), _zero)) == 0)  {
+                mask |= (1u << k);
+                g_csm->caster_cnts[k]++;
+            }
+        }
+
+        if (mask == 0)  {
+            g_csm->caster_culled_cnt++;
+        }   else if (dynamics != NULL && dynamics[i])   {
+            g_csm->dynamic_layers |= mask;
+            mask |= GFX_CSM_CASTER_DYNAMIC;
+            g_csm->stats.dynamic_cnt++;
+        }   else    {
+            /* static casters sign every cascade they touch, so moving/adding/removing one or
+             * switching it's lod only invalidates those cascades */
+            uint id = (ids != NULL) ? ids[i] : 0;
+            for (uint k = 0; k < cascade_cnt; k++)    {
+                if (BIT_CHECK(mask, 1u << k))   {
+                    g_csm->static_sigs[k] = csm_cache_addcaster(g_csm->static_sigs[k], &bounds[i],
+                        id);
+                }
+            }
+            g_csm->stats.static_cnt++;
+        }
+        masks[i] = mask;
+    }
+
+    g_csm->caster_masks = masks;
+    g_csm->static_dirty = csm_cache_test(&g_csm->cache, g_csm->cascade_vps, g_csm->static_sigs,
+        cascade_cnt);
+    PRF_CLOSESAMPLE();  /* csm-cull */
+    return masks;
+}
+#else
+#error "not implemented"
+#endif
+
+const uint* gfx_csm_get_castercnts(OUT uint* culled_cnt)
+{
+    *culled_cnt = g_csm->caster_culled_cnt;
+    return g_csm->caster_cnts;
+}
+
+void gfx_csm_get_cachestats(OUT struct gfx_csm_cachestats* stats)
+{
+    memcpy(stats, &g_csm->stats, sizeof(struct gfx_csm_cachestats));
+}
+
 struct mat4f* csm_calc_orthoproj(struct mat4f* r, float w, float h, float zn, float zf)
 {
     return mat4_setf(r,
@@ -864,7 +1179,10 @@ struct mat4f* csm_round_mat(struct mat4f* r, const struct mat4f* m, float shadow
 
 uint gfx_csm_get_cascadecnt()
 {
-    return CSM_CASCADE_CNT;
+    /* postfx shaders query this before csm is initialized, so it always comes from init params
+     * (cascade count is fixed after init, because shaders are compiled with it) */
+    uint cnt = eng_get_params()->gfx.csm_cascades;
+    return (cnt != 0) ? minui(cnt, CSM_CASCADES_MAX) : CSM_CASCADE_CNT;
 }
 
 const struct aabb* gfx_csm_get_frustumbounds()
@@ -884,9 +1202,9 @@ gfx_texture gfx_csm_get_shadowtex()
 
 const struct vec4f* gfx_csm_get_cascades(const struct mat3f* view)
 {
-    static struct vec4f cascades[CSM_CASCADE_CNT];
+    static struct vec4f cascades[CSM_CASCADES_MAX];
     struct vec4f center;
-    for (uint i = 0; i < CSM_CASCADE_CNT; i++)    {
+    for (uint i = 0; i < g_csm->cascade_cnt; i++)    {
         const struct sphere* s = &g_csm->cascades[i].bounds;
         vec3_setf(&center, s->x, s->y, s->z);
         vec3_transformsrt(&center, &center, view);
@@ -904,7 +1222,7 @@ result_t csm_console_debugcsm(uint argc, const char** argv, void* param)
         return RET_INVALIDARG;
     g_csm->debug_csm = enable;
 
-    for (int i = 0; i < CSM_CASCADE_CNT; i++)    {
+    for (uint i = 0; i < g_csm->cascade_cnt; i++)    {
         char num[10];
         char alias[32];
         strcat(strcpy(alias, "CSM"), str_itos(num, i));
@@ -917,6 +1235,100 @@ result_t csm_console_debugcsm(uint argc, const char** argv, void* param)
     return RET_OK;
 }
 
+result_t csm_console_cachecsm(uint argc, const char** argv, void* param)
+{
+    int enable = TRUE;
+    if (argc == 1)
+        enable = str_tobool(argv[0]);
+    else if (argc > 1)
+        return RET_INVALIDARG;
+
+    if (enable && g_csm->static_tex == NULL)    {
+        log_print(LOG_WARNING, "csm: static caster caching is not supported on this hardware");
+        return RET_FAIL;
+    }
+
+    g_csm->cache_static = enable;
+    csm_cache_reset(&g_csm->cache);
+    return RET_OK;
+}
+
+result_t csm_console_setparams(uint argc, const char** argv, void* param)
+{
+    float far_max = g_csm->far_max;
+    float lambda = g_csm->split_lambda;
+    uint size = g_csm->shadow_size;
+
+    if (argc == 0 || argc > 3)
+        return RET_INVALIDARG;
+    char arg[256];
+
+    /* extract key/values */
+    for (uint i = 0; i < argc; i++)   {
+        str_safecpy(arg, sizeof(arg), argv[i]);
+        char* seperator = strchr(arg, ':');
+        if (seperator == NULL)
+            return RET_INVALIDARG;
+        *seperator = 0;
+        const char* value = seperator + 1;
+
+        if (str_isequal_nocase(arg, "far"))
+            far_max = maxf(str_tofl32(value), 1.0f);
+        else if (str_isequal_nocase(arg, "lambda"))
+            lambda = clampf(str_tofl32(value), 0.0f, 1.0f);
+        else if (str_isequal_nocase(arg, "size"))
+            size = clampui((uint)str_toint32(value), 128, CSM_SHADOW_SIZE_MAX);
+        else
+            return RET_INVALIDARG;
+    }
+
+    if (size != g_csm->shadow_size)  {
+        /* create the new maps first, so a failure leaves the current ones in place */
+        gfx_rendertarget shadow_rt = g_csm->shadow_rt;
+        gfx_texture shadow_tex = g_csm->shadow_tex;
+        gfx_rendertarget static_rt = g_csm->static_rt;
+        gfx_texture static_tex = g_csm->static_tex;
+        g_csm->shadow_rt = NULL;
+        g_csm->shadow_tex = NULL;
+        g_csm->static_rt = NULL;
+        g_csm->static_tex = NULL;
+
+        result_t r = csm_create_shadowrt(size, size);
+        if (IS_OK(r) && static_tex != NULL)
+            r = csm_create_staticrt(size, size);
+        if (IS_FAIL(r)) {
+            csm_destroy_shadowrt();
+            csm_destroy_staticrt();
+            g_csm->shadow_rt = shadow_rt;
+            g_csm->shadow_tex = shadow_tex;
+            g_csm->static_rt = static_rt;
+            g_csm->static_tex = static_tex;
+            err_printf(__FILE__, __LINE__, "csm: could not create %dx%d shadow maps", size, size);
+            return RET_FAIL;
+        }
+
+        if (shadow_rt != NULL)
+            gfx_destroy_rendertarget(shadow_rt);
+        if (shadow_tex != NULL)
+            gfx_destroy_texture(shadow_tex);
+        if (static_rt != NULL)
+            gfx_destroy_rendertarget(static_rt);
+        if (static_tex != NULL)
+            gfx_destroy_texture(static_tex);
+
+        g_csm->shadow_size = size;
+        g_csm->shadowmap_size = (float)size;
+        csm_cache_reset(&g_csm->cache);
+    }
+
+    /* split and distance changes are picked up by the next gfx_csm_prepare,
+     * cached static layers are invalidated by their matrices */
+    g_csm->far_max = far_max;
+    g_csm->split_lambda = lambda;
+
+    return RET_OK;
+}
+
 int csm_load_prev_shaders(struct allocator* alloc)
 {
     char cascadecnt[10];
@@ -928,12 +1340,12 @@ int csm_load_prev_shaders(struct allocator* alloc)
         g_csm->prev_shader = gfx_shader_add("csm-prev", 2, 2,
             GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
             GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
-            "_CASCADE_CNT_", str_itos(cascadecnt, CSM_CASCADE_CNT), "_D3D10_", "1");
+            "_CASCADE_CNT_", str_itos(cascadecnt, g_csm->cascade_cnt), "_D3D10_", "1");
     }    else   {
         g_csm->prev_shader = gfx_shader_add("csm-prev", 2, 1,
             GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
             GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
-            "_CASCADE_CNT_", str_itos(cascadecnt, CSM_CASCADE_CNT));
+            "_CASCADE_CNT_", str_itos(cascadecnt, g_csm->cascade_cnt));
     }
 
     gfx_shader_endload();
@@ -958,16 +1370,17 @@ void csm_renderpreview(gfx_cmdqueue cmdqueue, const struct gfx_view_params* para
     gfx_shader_bind(cmdqueue, shader);
 
     /* constants */
-    struct vec4f orthoparams[CSM_CASCADE_CNT];
-    float max_fars[CSM_CASCADE_CNT];
-    for (uint i = 0; i < CSM_CASCADE_CNT; i++)    {
+    uint cascade_cnt = g_csm->cascade_cnt;
+    struct vec4f orthoparams[CSM_CASCADES_MAX];
+    float max_fars[CSM_CASCADES_MAX];
+    for (uint i = 0; i < cascade_cnt; i++)    {
         const struct mat4f* ortho = &g_csm->cascades[i].proj;
         vec4_setf(&orthoparams[i], ortho->m11, ortho->m22, ortho->m33, ortho->m43);
         max_fars[i] = g_csm->cascades[i].nfar;
     }
 
-    gfx_shader_set4fv(shader, SHADER_NAME(c_orthoparams), orthoparams, CSM_CASCADE_CNT);
-    gfx_shader_setfv(shader, SHADER_NAME(c_max_far), max_fars, CSM_CASCADE_CNT);
+    gfx_shader_set4fv(shader, SHADER_NAME(c_orthoparams), orthoparams, cascade_cnt);
+    gfx_shader_setfv(shader, SHADER_NAME(c_max_far), max_fars, cascade_cnt);
     gfx_shader_bindconstants(cmdqueue, shader);
 
     /* textures */
@@ -976,6 +1389,4 @@ void csm_renderpreview(gfx_cmdqueue cmdqueue, const struct gfx_view_params* para
 
     /* draw */
     gfx_draw_fullscreenquad();
-
-    gfx_set_previewrenderflag();
 }
@@ -13,6 +13,7 @@
  *
  ***********************************************************************************/
 
+#include <stdio.h>
 #include <smmintrin.h>
 
 #include "dhcore/core.h"
@@ -41,12 +42,14 @@
 #include "cmp-mgr.h"
 #include "prf-mgr.h"
 #include "gfx-postfx.h"
+#include "gfx-fgraph.h"
 #include "debug-hud.h"
 #include "gfx-billboard.h"
 #include "res-mgr.h"
 #include "world-mgr.h"
 
 #include "components/cmp-light.h"
+#include "light-clusters.h"
 
 #define DEFERRED_GBUFFER_SHADERCNT 32
 #define DEFERRED_PREVIEW_SHADERCNT 7
@@ -63,12 +66,16 @@
 #define DEFERRED_GBUFFER_EXTRA 3
 
 #define DEFERRED_MTLS_MAX 4096
-#define DEFERRED_LIGHTS_PERPASS_MAX 28
 #define DEFERRED_LIGHTS_MAX 512
 #define DEFERRED_LIGHTS_TILES_MAX 512
 
 #define DEFERRED_TILE_SIZE 64
 #define DEFERRED_HSEED 8572
+#define DEFERRED_JOBTHREADS_MAX 16
+#define DEFERRED_TILEJOB_LIGHTS_MIN 32  /* below this, binning is cheaper than dispatching jobs */
+#define DEFERRED_CLUSTER_SLICES 16  /* default depth slices per tile */
+#define DEFERRED_CLUSTER_SLICES_MAX 64
+#define DEFERRED_CLUSTER_CAP 32 /* default maximum lights per cluster */
 
 /* SSAO */
 #define SSAO_DEFAULT_RADIUS 0.1f
@@ -94,16 +101,29 @@ enum deferred_shader_group
 struct deferred_light
 {
     float type[4];  /* only index 0 is set to light type */
-    struct vec4f pos_vs;
+    struct vec4f pos_ws;
     struct vec4f atten;
-    struct vec3f dir_vs;
+    struct vec3f dir_ws;
     struct color color;
 };
 
+/* persistent slots of a gpu table (tb_lights, tb_mtls) that survive between frames
+ * entries that are not referenced in the current frame are recycled only when the table is full */
+struct deferred_slots
+{
+    uint cnt;   /* high-water mark, slots [0, cnt) are uploaded to the gpu */
+    uint max;
+    uint* frame_ids;    /* frame that each slot was last referenced in, INVALID_INDEX if free */
+    uint* keys;
+    uint* free_slots;
+    uint free_cnt;
+    struct hashtable_open table;    /* key: entry hash, value: slot */
+    int dirty;  /* some slots are written since the last upload */
+};
+
 struct deferred_shader_tile
 {
-    uint cnt[4];
-    uint idxs[DEFERRED_LIGHTS_PERPASS_MAX];
+    uint cnt[4];    /* x = number of lights that touch the tile (all depth slices) */
 };
 
 struct deferred_tiles
@@ -112,10 +132,28 @@ struct deferred_tiles
     uint cnt_x;
     uint cnt_y;
     struct vec4f* simd_data; /* screen-space SIMD friendly tile rects (count = (tile_count)*2) */
-    struct deferred_shader_tile* light_lists;   /* light index list for each tile */
+    struct deferred_shader_tile* light_lists;   /* light count for each tile */
     struct rect2di* rects;  /* tile rectangles */
-    struct hashtable_open light_table;  /* key: light cmp handle, value: index to lights array */
-    uint light_cnt;   /* keep track of current light count */
+    uint light_cnt;   /* stats: visible lights in the last frame */
+    uint dirty_cnt; /* stats: lights that were repacked in the last frame */
+    uint pair_cnt;  /* stats: tile/light pairs binned in the last frame */
+    uint worker_cnt;    /* stats: workers that binned the tiles in the last frame */
+
+    /* clusters: each tile is split into exponential depth slices (view-space), tile light counts
+     * are kept in light_lists */
+    struct light_clusters clusters;
+    struct gfx_cblock* tb_clusters; /* packed cluster headers and light indexes for the gpu */
+    uint overflow_cnt;  /* stats: cluster/light pairs dropped because a cluster was full */
+};
+
+/* tile rows are split between workers, each worker only writes light lists of its own rows */
+struct deferred_tilejob
+{
+    struct deferred_tiles* tiles;
+    const struct light_range* ranges;
+    uint range_cnt;
+    uint worker_cnt;
+    uint overflow_cnts[DEFERRED_JOBTHREADS_MAX + 1];    /* per worker */
 };
 
 struct ALIGN16 deferred_tile_vertex
@@ -127,11 +165,9 @@ struct ALIGN16 deferred_tile_vertex
 struct gfx_deferred
 {
     struct gfx_cblock* cb_frame;
-    struct gfx_cblock* cb_xforms;
     struct gfx_cblock* tb_mtls;
     struct gfx_cblock* tb_lights;
     struct gfx_cblock* cb_light;
-    struct gfx_cblock* tb_skins;
 
     uint width;
     uint height;
@@ -161,13 +197,23 @@ struct gfx_deferred
     gfx_texture lit_tex;
     gfx_rendertarget lit_rt_result;
 
-    struct hashtable_open mtable;  /* index to mtls */
-    struct array mtls;  /* item: gfx_cblock (raw - no gpu_buffer) */
+    /* lights and materials keep their tbuffer slots across frames and are only repacked when
+     * they change, buffers are uploaded only in frames that something is written to them */
+    uint frame_id;
+    struct deferred_slots light_slots;  /* key: light cmp handle */
+    uint light_versions[DEFERRED_LIGHTS_MAX];   /* cmp_light version of each slot's data */
+    float light_intensities[DEFERRED_LIGHTS_MAX];   /* intensity_mul of each slot's data */
+    struct deferred_slots mtl_slots;    /* key: mtl cblock hash */
 
     enum gfx_deferred_preview_mode prev_mode;
     int debug_tiles;
+    int check_clusters; /* validate cluster assignment against brute-force in the next frame */
+    uint cluster_slices;
+    uint cluster_cap;
 
     struct deferred_tiles tiles;
+    uint job_thread_cnt;
+    int job_threads[DEFERRED_JOBTHREADS_MAX];   /* task threads that tile jobs are dispatched to */
     gfx_buffer tile_buff;   /* item: deferred_tile_vertex */
     gfx_inputlayout tile_il;
 
@@ -176,10 +222,17 @@ struct gfx_deferred
     struct gfx_pfx_upsample* upsample; /* upsample postfx */
     struct gfx_pfx_shadow* shadowcsm; /* csm shadow postfx */
 
-    gfx_texture ssao_result_tmp;    /* temp saved for preview upsampled ssao buffer */
-    reshandle_t light_tex;
+    int ssao_enable;
+    int show_ssao;
+    gfx_texture white_tex;  /* 1x1 white, bound instead of ssao when it's disabled */
+    gfx_rendertarget white_rt;
+
+    /* frame-graph resources of current frame (see gfx_deferred_setup) */
+    uint res_gbuff;
+    uint res_shadows;
+    uint res_ssao;
 
-    struct gfx_sharedbuffer* gbuff_sharedbuff;
+    reshandle_t light_tex;
 };
 
 /*************************************************************************************************
@@ -189,13 +242,10 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc);
 int deferred_addshader(uint shader_id, uint rpath_flags, enum deferred_shader_group group);
 void deferred_unload_gbuffer_shaders();
 
-void deferred_submit_batchdata(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items,
-                               uint batch_cnt, struct gfx_sharedbuffer* shared_buff);
 void deferred_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
     struct gfx_shader* shader, OUT struct gfx_model_geo** pgeo, OUT uint* psubset_idx);
 void deferred_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader, struct gfx_model_geo* geo, uint subset_idx,
-    uint xforms_shared_idx);
+    struct gfx_model_geo* geo, uint subset_idx);
 
 result_t deferred_creategbuffrt(uint width, uint height);
 void deferred_destroygbuffrt();
@@ -219,31 +269,58 @@ void deferred_unload_light_shaders();
 result_t deferred_createlitrt(uint width, uint height);
 void deferred_destroylitrt();
 
-uint deferred_pushmtl(struct gfx_cblock* cb_mtl);
-const struct gfx_cblock* deferred_fetchmtl(int);
+uint deferred_pushmtl(struct gfx_model_mtlgpu* gmtl);
+result_t deferred_createslots(struct deferred_slots* slots, uint max);
+void deferred_destroyslots(struct deferred_slots* slots);
+uint deferred_fetchslot(struct deferred_slots* slots, uint key, OUT int* is_new);
 
 /* console commands */
 result_t deferred_console_setpreview(uint argc, const char** argv, void* param);
 result_t deferred_console_setdebugtiles(uint argc, const char** argv, void* param);
 result_t deferred_console_defshadowprev(uint argc, const char** argv, void* param);
 result_t deferred_console_showssao(uint argc, const char** argv, void* param);
+result_t deferred_console_enablessao(uint argc, const char** argv, void* param);
+result_t deferred_console_lightclusters(uint argc, const char** argv, void* param);
+result_t deferred_console_checkclusters(uint argc, const char** argv, void* param);
 
 /* gbuffer */
 void gfx_deferred_rendergbuffer(gfx_cmdqueue cmdqueue, const struct gfx_view_params* params,
     struct gfx_batch_item* batch_items, uint batch_cnt);
 
+/* frame-graph passes, param: gfx_rpath_data */
+void deferred_fgpass_gbuffer(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void deferred_fgpass_shadows(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void deferred_fgpass_ssao(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void deferred_fgpass_lighting(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+void deferred_fgpass_preview(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param);
+
+/* white texture that replaces ssao when it's disabled */
+result_t deferred_createwhitert();
+void deferred_destroywhitert();
+
 /* tiling/light culling */
 result_t deferred_createtilequad();
 void deferred_destroytilequad();
 result_t deferred_createtiles(struct deferred_tiles* tiles, uint width, uint height);
 void deferred_destroytiles(struct deferred_tiles* tiles);
 void deferred_cleartiles(struct deferred_tiles* tiles);
+result_t deferred_createclusters(struct deferred_tiles* tiles, uint width, uint height,
+    uint slice_cnt, uint cluster_cap);
+void deferred_destroyclusters(struct deferred_tiles* tiles);
 struct vec4f* deferred_calc_lightbounds_simd(struct allocator* alloc, const struct sphere* bounds,
     const struct scn_render_light* lights, uint light_cnt, const struct mat3f* view_inv,
     const struct mat4f* viewprojclip);
 void deferred_processtiles(struct deferred_tiles* tiles, struct allocator* alloc,
-    uint start_idx, uint end_idx, const struct gfx_view_params* params,
-    const struct scn_render_light* lights, const struct sphere* bounds, uint light_cnt);
+    const struct gfx_view_params* params, const struct scn_render_light* lights,
+    const struct sphere* bounds, uint light_cnt);
+void deferred_bintiles(struct deferred_tilejob* job, uint worker_idx);
+void deferred_bintiles_job(void* params, void* result, uint thread_id, uint job_id,
+    int worker_idx);
 
 /* lighting */
 void deferred_renderlights(gfx_cmdqueue cmdqueue, const struct gfx_view_params* params,
@@ -263,6 +340,19 @@ void deferred_drawlights(gfx_cmdqueue cmdqueue, const struct gfx_view_params* pa
  */
 static struct gfx_deferred* g_deferred = NULL;
 
+/*************************************************************************************************
+ * inlines
+ */
+/* inverse of the view matrix (camera world transform) */
+INLINE void deferred_viewinv(struct mat3f* r, const struct gfx_view_params* params)
+{
+    mat3_setf(r,
+        params->view.m11, params->view.m21, params->view.m31,
+        params->view.m12, params->view.m22, params->view.m32,
+        params->view.m13, params->view.m23, params->view.m33,
+        params->cam_pos.x, params->cam_pos.y, params->cam_pos.z);
+}
+
 /*************************************************************************************************/
 uint gfx_deferred_getshader(enum cmp_obj_type obj_type, uint rpath_flags)
 {
@@ -289,6 +379,12 @@ result_t gfx_deferred_init(uint width, uint height)
     g_deferred->height = height;
     g_deferred->light_tex = INVALID_HANDLE;
 
+    const struct gfx_params* gparams = &eng_get_params()->gfx;
+    g_deferred->cluster_slices = (gparams->light_slices != 0) ?
+        minui(gparams->light_slices, DEFERRED_CLUSTER_SLICES_MAX) : DEFERRED_CLUSTER_SLICES;
+    g_deferred->cluster_cap = (gparams->cluster_lights_max != 0) ?
+        minui(gparams->cluster_lights_max, DEFERRED_LIGHTS_MAX) : DEFERRED_CLUSTER_CAP;
+
     log_printf(LOG_INFO, "\tdeferred render-path: loading shaders ...");
 
     /* gbuffer shaders */
@@ -309,18 +405,6 @@ result_t gfx_deferred_init(uint width, uint height)
     g_deferred->cb_frame = gfx_shader_create_cblock(lsr_alloc, tmp_alloc,
         gfx_shader_get(raw_shaderid), "cb_frame", NULL);
 
-    if (gfx_check_feature(GFX_FEATURE_RANGED_CBUFFERS)) {
-        g_deferred->gbuff_sharedbuff =
-            gfx_sharedbuffer_create(GFX_DEFAULT_RENDER_OBJ_CNT*GFX_INSTANCES_MAX*48);
-        if (g_deferred->gbuff_sharedbuff == NULL)  {
-            err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create uniform buffer");
-            return RET_FAIL;
-        }
-    }
-
-    g_deferred->cb_xforms = gfx_shader_create_cblock(lsr_alloc, tmp_alloc,
-        gfx_shader_get(raw_shaderid), "cb_xforms", g_deferred->gbuff_sharedbuff);
-
     g_deferred->tb_mtls = gfx_shader_create_cblock_tbuffer(mem_heap(),
         gfx_shader_get(g_deferred->light_shaders[DEFERRED_LIGHTSHADER_SUN].shader_id), "tb_mtls",
         sizeof(struct vec4f)*5*DEFERRED_MTLS_MAX);
@@ -330,13 +414,10 @@ result_t gfx_deferred_init(uint width, uint height)
     g_deferred->cb_light = gfx_shader_create_cblock(mem_heap(), tmp_alloc,
         gfx_shader_get(g_deferred->light_shaders[DEFERRED_LIGHTSHADER_LOCAL].shader_id), "cb_light",
         NULL);
-    g_deferred->tb_skins = gfx_shader_create_cblock_tbuffer(mem_heap(),
-        gfx_shader_get(gfx_deferred_getshader(CMP_OBJTYPE_MODEL, GFX_RPATH_SKINNED | GFX_RPATH_RAW)),
-        "tb_skins", sizeof(struct vec4f)*3*GFX_INSTANCES_MAX*GFX_SKIN_BONES_MAX);
 
-    if (g_deferred->cb_frame == NULL || g_deferred->cb_xforms == NULL ||
+    if (g_deferred->cb_frame == NULL ||
         g_deferred->tb_mtls == NULL || g_deferred->tb_lights == NULL ||
-        g_deferred->cb_light == NULL || g_deferred->tb_skins == NULL)
+        g_deferred->cb_light == NULL)
     {
         err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create cblocks");
         return RET_FAIL;
@@ -360,15 +441,11 @@ result_t gfx_deferred_init(uint width, uint height)
         return RET_FAIL;
     }
 
-    /* mtl manager */
-    if (IS_FAIL(arr_create(mem_heap(), &g_deferred->mtls, sizeof(struct gfx_cblock*),
-        100, 200, MID_GFX)))
+    /* mtl/light tables */
+    if (IS_FAIL(deferred_createslots(&g_deferred->mtl_slots, DEFERRED_MTLS_MAX)) ||
+        IS_FAIL(deferred_createslots(&g_deferred->light_slots, DEFERRED_LIGHTS_MAX)))
     {
-        err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create mtl buffer");
-        return RET_FAIL;
-    }
-    if (IS_FAIL(hashtable_open_create(mem_heap(), &g_deferred->mtable, 100, 200, MID_GFX))) {
-        err_printf(__FILE__, __LINE__, "gfx-deferred init failed: could not create mtable");
+        err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create slot tables");
         return RET_FAIL;
     }
 
@@ -377,6 +454,8 @@ result_t gfx_deferred_init(uint width, uint height)
         err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create tiles");
         return RET_FAIL;
     }
+    g_deferred->job_thread_cnt = eng_get_jobthreads(g_deferred->job_threads,
+        DEFERRED_JOBTHREADS_MAX);
 
     /* post-fx */
     g_deferred->downsample = gfx_pfx_downsamplewdepth_create(width/2, height/2,
@@ -393,17 +472,23 @@ result_t gfx_deferred_init(uint width, uint height)
         return RET_FAIL;
     }
 
-    g_deferred->upsample = gfx_pfx_upsamplebilateral_create(width, height);
+    g_deferred->upsample = gfx_pfx_upsamplebilateral_create();
     if (g_deferred->upsample == NULL)   {
         err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create upsampleb");
         return RET_FAIL;
     }
-    g_deferred->shadowcsm = gfx_pfx_shadowcsm_create(width, height, NULL);
+    g_deferred->shadowcsm = gfx_pfx_shadowcsm_create();
     if (g_deferred->shadowcsm == NULL)  {
         err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create shadowcsm");
         return RET_FAIL;
     }
 
+    if (IS_FAIL(deferred_createwhitert()))  {
+        err_print(__FILE__, __LINE__, "gfx-deferred init failed: could not create white texture");
+        return RET_FAIL;
+    }
+    g_deferred->ssao_enable = TRUE;
+
     /* light texture */
     g_deferred->light_tex = rs_load_texture("textures/light.dds", 0, TRUE, 0);
     if (g_deferred->light_tex == INVALID_HANDLE)  {
@@ -431,6 +516,11 @@ result_t gfx_deferred_init(uint width, uint height)
         con_register_cmd("gfx_debugtiles", deferred_console_setdebugtiles, NULL,
             "gfx_debugtiles [1*/0]");
         con_register_cmd("gfx_showssao", deferred_console_showssao, NULL, "gfx_showssao [1*/0]");
+        con_register_cmd("gfx_ssao", deferred_console_enablessao, NULL, "gfx_ssao [1*/0]");
+        con_register_cmd("gfx_lightclusters", deferred_console_lightclusters, NULL,
+            "gfx_lightclusters [slices] [lights-per-cluster]");
+        con_register_cmd("gfx_checkclusters", deferred_console_checkclusters, NULL,
+            "gfx_checkclusters");
     }
 
     g_deferred->prev_mode = GFX_DEFERRED_PREVIEW_NONE;
@@ -441,9 +531,6 @@ result_t gfx_deferred_init(uint width, uint height)
 void gfx_deferred_release()
 {
     if (g_deferred != NULL) {
-        if (g_deferred->gbuff_sharedbuff != NULL)
-            gfx_sharedbuffer_destroy(g_deferred->gbuff_sharedbuff);
-
         if (g_deferred->light_tex != INVALID_HANDLE)
             rs_unload(g_deferred->light_tex);
 
@@ -460,11 +547,13 @@ void gfx_deferred_release()
         if (g_deferred->ssao != NULL)
             gfx_pfx_ssao_destroy(g_deferred->ssao);
 
+        deferred_destroywhitert();
+
         /* */
         deferred_destroytiles(&g_deferred->tiles);
 
-        arr_destroy(&g_deferred->mtls);
-        hashtable_open_destroy(&g_deferred->mtable);
+        deferred_destroyslots(&g_deferred->mtl_slots);
+        deferred_destroyslots(&g_deferred->light_slots);
 
         /* render targets */
         deferred_destroyprevbuffrt();
@@ -478,16 +567,12 @@ void gfx_deferred_release()
         /* cblocks */
         if (g_deferred->cb_frame != NULL)
             gfx_shader_destroy_cblock(g_deferred->cb_frame);
-        if (g_deferred->cb_xforms != NULL)
-            gfx_shader_destroy_cblock(g_deferred->cb_xforms);
         if (g_deferred->tb_mtls != NULL)
             gfx_shader_destroy_cblock(g_deferred->tb_mtls);
         if (g_deferred->tb_lights != NULL)
             gfx_shader_destroy_cblock(g_deferred->tb_lights);
         if (g_deferred->cb_light != NULL)
             gfx_shader_destroy_cblock(g_deferred->cb_light);
-        if (g_deferred->tb_skins != NULL)
-            gfx_shader_destroy_cblock(g_deferred->tb_skins);
 
         /* shaders */
         deferred_unload_light_shaders();
@@ -498,51 +583,113 @@ void gfx_deferred_release()
     }
 }
 
-/* userdata: gfx_renderpass_lightdata* */
-void gfx_deferred_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
-    const struct gfx_view_params* params, struct gfx_batch_item* batch_items, uint batch_cnt,
-    void* userdata, OUT struct gfx_rpath_result* result)
+/* declares gbuffer -> (shadows, ssao) -> lighting, shadows and ssao are transient targets
+ * and are culled if lighting doesn't need them (preview or disabled ssao) */
+void gfx_deferred_setup(struct gfx_fgraph* fg, const struct gfx_view_params* params,
+    struct gfx_rpath_data* data)
 {
-    ASSERT(batch_cnt != 0);
+    ASSERT(data->batch_cnt != 0);
+
+    struct gfx_fg_texdesc desc = {g_deferred->width, g_deferred->height, GFX_FORMAT_RGBA_UNORM};
+    uint pass;
+
+    g_deferred->res_gbuff = gfx_fg_import(fg, "gbuffer", NULL, g_deferred->gbuff);
+    pass = gfx_fg_addpass(fg, "gbuffer", 0, deferred_fgpass_gbuffer, data);
+    gfx_fg_write(fg, pass, g_deferred->res_gbuff);
+
+    /* csm postfx, needs shadow maps of sun shadow pass */
+    g_deferred->res_shadows = gfx_fg_transient(fg, "shadows", &desc);
+    pass = gfx_fg_addpass(fg, "df-shadows", 0, deferred_fgpass_shadows, data);
+    gfx_fg_read(fg, pass, g_deferred->res_gbuff);
+    gfx_fg_read(fg, pass, gfx_fg_findres(fg, "sunshadow"));
+    gfx_fg_write(fg, pass, g_deferred->res_shadows);
+    if (gfx_pfx_shadowcsm_ispreview(g_deferred->shadowcsm))
+        gfx_fg_setoutput(fg, g_deferred->res_shadows);
+
+    /* downsample / ssao / upsample postfx */
+    g_deferred->res_ssao = gfx_fg_transient(fg, "ssao", &desc);
+    pass = gfx_fg_addpass(fg, "ssao", 0, deferred_fgpass_ssao, data);
+    gfx_fg_read(fg, pass, g_deferred->res_gbuff);
+    gfx_fg_write(fg, pass, g_deferred->res_ssao);
+    if (g_deferred->show_ssao)
+        gfx_fg_setoutput(fg, g_deferred->res_ssao);
 
-    PRF_OPENSAMPLE("rpath-deferred");
+    if (g_deferred->prev_mode == GFX_DEFERRED_PREVIEW_NONE) {
+        pass = gfx_fg_addpass(fg, "lighting", 0, deferred_fgpass_lighting, data);
+        gfx_fg_read(fg, pass, g_deferred->res_gbuff);
+        gfx_fg_read(fg, pass, g_deferred->res_shadows);
+        if (g_deferred->ssao_enable)
+            gfx_fg_read(fg, pass, g_deferred->res_ssao);
+    }   else    {
+        gfx_set_previewrenderflag();
+        pass = gfx_fg_addpass(fg, "df-preview", 0, deferred_fgpass_preview, data);
+        gfx_fg_read(fg, pass, g_deferred->res_gbuff);
+    }
+    gfx_fg_write(fg, pass, data->output_res);
+}
 
-    /* deferred is a primary pass, so 'userdata' is lightdata */
-    struct gfx_renderpass_lightdata* ldata = (struct gfx_renderpass_lightdata*)userdata;
+void deferred_fgpass_gbuffer(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_rpath_data* data = (struct gfx_rpath_data*)param;
 
-    /* reset */
-    hashtable_open_clear(&g_deferred->mtable);
-    arr_clear(&g_deferred->mtls);
+    /* slots that are not referenced since this id are recycled first */
+    g_deferred->frame_id++;
 
-    /* gbuffer */
-    gfx_deferred_rendergbuffer(cmdqueue, params, batch_items, batch_cnt);
+    gfx_deferred_rendergbuffer(cmdqueue, params, data->batch_items, data->batch_cnt);
+}
 
-    /* csm postfx */
-    gfx_texture shadowcsm_tex = gfx_pfx_shadowcsm_render(cmdqueue, g_deferred->shadowcsm,
-        params, g_deferred->gbuff_depthtex);
+void deferred_fgpass_shadows(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    gfx_pfx_shadowcsm_render(cmdqueue, g_deferred->shadowcsm, params, g_deferred->gbuff_depthtex,
+        gfx_fg_getrendertarget(fg, g_deferred->res_shadows));
+}
 
-    /* downsample / ssao postfx */
+void deferred_fgpass_ssao(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
     gfx_texture downsample_depthtex;
     gfx_texture downsample_tex = gfx_pfx_downsamplewdepth_render(cmdqueue, g_deferred->downsample,
         params, g_deferred->gbuff_tex[DEFERRED_GBUFFER_EXTRA], g_deferred->gbuff_depthtex,
         &downsample_depthtex);
     gfx_texture ssao_small_tex = gfx_pfx_ssao_render(cmdqueue, g_deferred->ssao, 0, params,
         downsample_depthtex, downsample_tex);
-    gfx_texture ssao_tex = gfx_pfx_upsamplebilateral_render(cmdqueue, g_deferred->upsample,
+    gfx_pfx_upsamplebilateral_render(cmdqueue, g_deferred->upsample,
         params, ssao_small_tex, downsample_depthtex, downsample_tex,
-        g_deferred->gbuff_depthtex, g_deferred->gbuff_tex[DEFERRED_GBUFFER_EXTRA]);
-    g_deferred->ssao_result_tmp = ssao_tex;
+        g_deferred->gbuff_depthtex, g_deferred->gbuff_tex[DEFERRED_GBUFFER_EXTRA],
+        gfx_fg_getrendertarget(fg, g_deferred->res_ssao));
 
-    /*********************************************************************************************/
-    if (g_deferred->prev_mode == GFX_DEFERRED_PREVIEW_NONE) {
-        deferred_renderlights(cmdqueue, params, ldata, ssao_tex, shadowcsm_tex);
-        result->rt = g_deferred->lit_rt_result;
-    } else  {
-        deferred_renderpreview(cmdqueue, g_deferred->prev_mode, params);
-        result->rt = g_deferred->prev_rt_result;
-    }
+    /* target can change between frames */
+    if (g_deferred->show_ssao)
+        hud_set_image("ssao", gfx_fg_gettexture(fg, g_deferred->res_ssao));
+}
+
+/* deferred is a primary pass, so 'userdata' is lightdata */
+void deferred_fgpass_lighting(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_rpath_data* data = (struct gfx_rpath_data*)param;
+    struct gfx_renderpass_lightdata* ldata = (struct gfx_renderpass_lightdata*)data->userdata;
+
+    gfx_texture ssao_tex = g_deferred->ssao_enable ?
+        gfx_fg_gettexture(fg, g_deferred->res_ssao) : g_deferred->white_tex;
+    deferred_renderlights(cmdqueue, params, ldata, ssao_tex,
+        gfx_fg_gettexture(fg, g_deferred->res_shadows));
 
-    PRF_CLOSESAMPLE();  /* deferred */
+    data->result->rt = g_deferred->lit_rt_result;
+    gfx_fg_bindimport(fg, data->output_res, NULL, data->result->rt);
+}
+
+void deferred_fgpass_preview(gfx_cmdqueue cmdqueue, struct gfx_fgraph* fg,
+    const struct gfx_view_params* params, void* param)
+{
+    struct gfx_rpath_data* data = (struct gfx_rpath_data*)param;
+
+    deferred_renderpreview(cmdqueue, g_deferred->prev_mode, params);
+
+    data->result->rt = g_deferred->prev_rt_result;
+    gfx_fg_bindimport(fg, data->output_res, NULL, data->result->rt);
 }
 
 void gfx_deferred_rendergbuffer(gfx_cmdqueue cmdqueue, const struct gfx_view_params* params,
@@ -550,10 +697,6 @@ void gfx_deferred_rendergbuffer(gfx_cmdqueue cmdqueue, const struct gfx_view_par
 {
     PRF_OPENSAMPLE("gbuffer");
 
-    int supports_shared_cbuff = gfx_check_feature(GFX_FEATURE_RANGED_CBUFFERS);
-    if (supports_shared_cbuff)
-        deferred_submit_batchdata(cmdqueue, batch_items, batch_cnt, g_deferred->gbuff_sharedbuff);
-
     /*********************************************************************************************/
     struct gfx_cblock* cb_frame = g_deferred->cb_frame;
     gfx_cmdqueue_resetsrvs(cmdqueue);
@@ -574,69 +717,37 @@ void gfx_deferred_rendergbuffer(gfx_cmdqueue cmdqueue, const struct gfx_view_par
         ASSERT(shader);
         gfx_shader_bind(cmdqueue, shader);
 
-        /* do not send cb_xforms to shader if we are using shared buffer (bind later before draw) */
-        struct gfx_cblock* cbs[3];
-        uint xforms_shared_idx;
-        if (supports_shared_cbuff)  {
-            cbs[0] = g_deferred->cb_frame;
-            xforms_shared_idx = 1;
-        }   else    {
-            cbs[0] = g_deferred->cb_frame;
-            cbs[1] = g_deferred->cb_xforms;
-            xforms_shared_idx = 2;
-        }
-        gfx_shader_bindcblocks(cmdqueue, shader, (const struct gfx_cblock**)cbs, xforms_shared_idx);
+        const struct gfx_cblock* cbs[] = {cb_frame};
+        gfx_shader_bindcblocks(cmdqueue, shader, cbs, 1);
+
+        /* transforms and instance records of all passes are already uploaded for the frame */
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_xforms),
+            gfx_get_xformstream());
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_instances),
+            gfx_get_instancestream());
 
         /* batch draw */
         for (int k = 0; k < bitem->nodes.item_cnt; k++)	{
-            struct gfx_batch_node* bnode_first = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
+            struct gfx_batch_node* bnode = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
             struct gfx_model_geo* geo;
             uint subset_idx;
 
-            deferred_preparebatchnode(cmdqueue, bnode_first, shader, &geo, &subset_idx);
-            if (bnode_first->poses[0] != NULL)  {
+            if (bnode->instance_cnt == 0)
+                continue;
+
+            deferred_preparebatchnode(cmdqueue, bnode, shader, &geo, &subset_idx);
+            if (bnode->skinned)  {
                 gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_skins),
-                    g_deferred->tb_skins);
+                    gfx_get_skinpalette());
             }
 
-
-            struct linked_list* node = bnode_first->bll;
-            while (node != NULL)	{
-                struct gfx_batch_node* bnode = (struct gfx_batch_node*)node->data;
-                deferred_drawbatchnode(cmdqueue, bnode, shader, geo, subset_idx, xforms_shared_idx);
-                node = node->next;
-            }
+            deferred_drawbatchnode(cmdqueue, bnode, geo, subset_idx);
         }	/* for: each batch-item */
     }
     gfx_output_setdepthstencilstate(cmdqueue, NULL, 0);
     PRF_CLOSESAMPLE();  /* gbuffer */
 }
 
-/* prepass for submitting per-object (xforms) data to shaders (uniform sharing required)
- * offset/size data will be assigned into meta_data member of each batch */
-void deferred_submit_batchdata(gfx_cmdqueue cmdqueue, struct gfx_batch_item* batch_items,
-                               uint batch_cnt, struct gfx_sharedbuffer* shared_buff)
-{
-    gfx_sharedbuffer_reset(g_deferred->gbuff_sharedbuff);
-    for (uint i = 0; i < batch_cnt; i++)	{
-        struct gfx_batch_item* bitem = &batch_items[i];
-
-        for (int k = 0; k < bitem->nodes.item_cnt; k++)	{
-            struct gfx_batch_node* bnode_first =
-                &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
-            struct linked_list* node = bnode_first->bll;
-            while (node != NULL)	{
-                struct gfx_batch_node* bnode = (struct gfx_batch_node*)node->data;
-                gfx_cb_set3mvp(g_deferred->cb_xforms, SHADER_NAME(c_mats),
-                    bnode->instance_mats, bnode->instance_cnt);
-                bnode->meta_data = gfx_sharedbuffer_write(shared_buff,
-                    cmdqueue, g_deferred->cb_xforms->cpu_buffer, 48*bnode->instance_cnt);
-                node = node->next;
-            }
-        }	/* for: each batch-item */
-    }
-}
-
 result_t gfx_deferred_resize(uint width, uint height)
 {
     result_t r;
@@ -648,14 +759,6 @@ result_t gfx_deferred_resize(uint width, uint height)
     if (IS_FAIL(r))
         return RET_FAIL;
 
-    r = gfx_pfx_upsamplebilateral_resize(g_deferred->upsample, width, height);
-    if (IS_FAIL(r))
-        return RET_FAIL;
-
-    r = gfx_pfx_shadowcsm_resize(g_deferred->shadowcsm, width, height);
-    if (IS_FAIL(r))
-        return RET_FAIL;
-
     deferred_destroygbuffrt();
     r = deferred_creategbuffrt(width, height);
     if (IS_FAIL(r))
@@ -686,62 +789,56 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
 {
     /* gbuffer shaders */
     int r;
-    char max_instances_str[8];
     char max_bones_str[8];
 
-    str_itos(max_instances_str, GFX_INSTANCES_MAX);
     str_itos(max_bones_str, GFX_SKIN_BONES_MAX);
 
     gfx_shader_beginload(alloc, "shaders/df-gbuffer.vs", "shaders/df-gbuffer.ps", NULL,
-        2, "shaders/df-common.inc", "shaders/skin.inc");
+        3, "shaders/df-common.inc", "shaders/instance.inc", "shaders/skin.inc");
     /* raw (nothing) */
-    r = deferred_addshader(gfx_shader_add("def-raw", 3, 1,
+    r = deferred_addshader(gfx_shader_add("def-raw", 3, 0,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
-        GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
-        "_MAX_INSTANCES_", max_instances_str),
+        GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0),
         GFX_RPATH_RAW, DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* raw - skinned */
-    r = deferred_addshader(gfx_shader_add("def-s", 5, 3,
+    r = deferred_addshader(gfx_shader_add("def-s", 5, 2,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_SKIN_", "1",
         "_MAX_BONES_", max_bones_str),
         GFX_RPATH_RAW | GFX_RPATH_SKINNED, DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap */
-    r = deferred_addshader(gfx_shader_add("def-d", 3, 2,
+    r = deferred_addshader(gfx_shader_add("def-d", 3, 1,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
-        "_DIFFUSEMAP_", "1",
-        "_MAX_INSTANCES_", max_instances_str),
+        "_DIFFUSEMAP_", "1"),
         GFX_RPATH_RAW|GFX_RPATH_DIFFUSEMAP, DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - skinned */
-    r = deferred_addshader(gfx_shader_add("def-ds", 5, 4,
+    r = deferred_addshader(gfx_shader_add("def-ds", 5, 3,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str, "_DIFFUSEMAP_", "1", "_SKIN_", "1",
+        "_DIFFUSEMAP_", "1", "_SKIN_", "1",
         "_MAX_BONES_", max_bones_str),
         GFX_RPATH_RAW|GFX_RPATH_DIFFUSEMAP|GFX_RPATH_SKINNED, DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - skinned - alphamap */
-    r = deferred_addshader(gfx_shader_add("def-dsa", 5, 5,
+    r = deferred_addshader(gfx_shader_add("def-dsa", 5, 4,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_DIFFUSEMAP_", "1",
         "_SKIN_", "1",
         "_ALPHAMAP_", "1",
@@ -750,26 +847,24 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - normalmap */
-    r = deferred_addshader(gfx_shader_add("def-dn", 5, 3,
+    r = deferred_addshader(gfx_shader_add("def-dn", 5, 2,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_TANGENT, "vsi_tangent", 1,
         GFX_INPUTELEMENT_ID_BINORMAL, "vsi_binorm", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_DIFFUSEMAP_", "1",
         "_NORMALMAP_", "1"),
         GFX_RPATH_RAW|GFX_RPATH_DIFFUSEMAP|GFX_RPATH_NORMALMAP,
         DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - normalmap - alphamap */
-    r = deferred_addshader(gfx_shader_add("def-dna", 5, 4,
+    r = deferred_addshader(gfx_shader_add("def-dna", 5, 3,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_TANGENT, "vsi_tangent", 1,
         GFX_INPUTELEMENT_ID_BINORMAL, "vsi_binorm", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_DIFFUSEMAP_", "1",
         "_NORMALMAP_", "1",
         "_ALPHAMAP_", "1"),
@@ -777,7 +872,7 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - normalmap - skinned */
-    r = deferred_addshader(gfx_shader_add("def-dnsk", 7, 5,
+    r = deferred_addshader(gfx_shader_add("def-dnsk", 7, 4,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
@@ -785,7 +880,6 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         GFX_INPUTELEMENT_ID_BINORMAL, "vsi_binorm", 2,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_DIFFUSEMAP_", "1",
         "_NORMALMAP_", "1",
         "_SKIN_", "1",
@@ -794,7 +888,7 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* diffusemap - normalmap - skinned - alphamap */
-    r = deferred_addshader(gfx_shader_add("def-dnsa", 7, 6,
+    r = deferred_addshader(gfx_shader_add("def-dnsa", 7, 5,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
@@ -802,7 +896,6 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         GFX_INPUTELEMENT_ID_BINORMAL, "vsi_binorm", 2,
         GFX_INPUTELEMENT_ID_BLENDINDEX, "vsi_blendidxs", 1,
         GFX_INPUTELEMENT_ID_BLENDWEIGHT, "vsi_blendweights", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_DIFFUSEMAP_", "1",
         "_NORMALMAP_", "1",
         "_SKIN_", "1",
@@ -812,13 +905,12 @@ int deferred_load_gbuffer_shaders(struct allocator* alloc)
         DEFERRED_SHADERGROUP_GBUFFER);
     if (!r)   return FALSE;
     /* normalmap */
-    r = deferred_addshader(gfx_shader_add("def-n", 5, 2,
+    r = deferred_addshader(gfx_shader_add("def-n", 5, 1,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
         GFX_INPUTELEMENT_ID_TANGENT, "vsi_tangent", 1,
         GFX_INPUTELEMENT_ID_BINORMAL, "vsi_binorm", 1,
-        "_MAX_INSTANCES_", max_instances_str,
         "_NORMALMAP_", "1"),
         GFX_RPATH_RAW|GFX_RPATH_NORMALMAP,
         DEFERRED_SHADERGROUP_GBUFFER);
@@ -872,8 +964,9 @@ void deferred_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bno
     *pgeo = geo;
     *psubset_idx = subset_idx;
 
-    gfx_shader_setui(shader, SHADER_NAME(c_mtlidx), deferred_pushmtl(inst->mtls[mtl_id]->cb));
+    gfx_shader_setui(shader, SHADER_NAME(c_mtlidx), deferred_pushmtl(inst->mtls[mtl_id]));
     gfx_shader_setf(shader, SHADER_NAME(c_gloss), gmodel->mtls[mtl_id].spec_exp);
+    gfx_shader_setui(shader, SHADER_NAME(c_instance_offset), bnode->instance_offset);
 
     gfx_input_setlayout(cmdqueue, geo->inputlayout);
     gfx_model_setmtl(cmdqueue, shader, inst, mtl_id);
@@ -881,37 +974,11 @@ void deferred_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bno
 }
 
 void deferred_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-    struct gfx_shader* shader, struct gfx_model_geo* geo, uint subset_idx,
-    uint xforms_shared_idx)
+    struct gfx_model_geo* geo, uint subset_idx)
 {
     struct gfx_model_geosubset* subset = &geo->subsets[subset_idx];
 
-    /* set transform matrices, bind only for shared mode (we have updated the buffer in a prepass) */
-    struct gfx_cblock* cb_xforms = g_deferred->cb_xforms;
-    if (cb_xforms->shared_buff != NULL)  {
-        sharedbuffer_pos_t pos = bnode->meta_data;
-        gfx_shader_bindcblock_shared(cmdqueue, shader, g_deferred->cb_xforms,
-            cb_xforms->shared_buff->gpu_buff,
-            GFX_SHAREDBUFFER_OFFSET(pos), GFX_SHAREDBUFFER_SIZE(pos), xforms_shared_idx);
-    }   else    {
-        gfx_cb_set3mvp(cb_xforms, SHADER_NAME(c_mats), bnode->instance_mats, bnode->instance_cnt);
-        gfx_shader_updatecblock(cmdqueue, cb_xforms);
-    }
-
-    /* skin data */
-    if (bnode->poses[0] != NULL)   {
-        struct gfx_cblock* tb_skins = g_deferred->tb_skins;
-        for (uint i = 0, cnt = bnode->instance_cnt; i < cnt; i++) {
-            const struct gfx_model_posegpu* pose = bnode->poses[i];
-
-            gfx_cb_set3mv_offset(tb_skins, 0, pose->skin_mats, pose->mat_cnt,
-                i*GFX_SKIN_BONES_MAX*sizeof(struct vec4f)*3);
-        }
-
-        gfx_shader_updatecblock(cmdqueue, tb_skins);
-    }
-
-    /* draw */
+    /* draw: transforms and skin offsets are fetched from the instance stream by the shader */
     gfx_draw_indexedinstance(cmdqueue, GFX_PRIMITIVE_TRIANGLELIST, subset->ib_idx, subset->idx_cnt,
         geo->ib_type, bnode->instance_cnt, GFX_DRAWCALL_GBUFFER);
 }
@@ -1221,7 +1288,7 @@ void deferred_renderpreview(gfx_cmdqueue cmdqueue, enum gfx_deferred_preview_mod
         gfx_shader_set2f(shader, SHADER_NAME(c_camprops), camprops);
         gfx_shader_bindconstants(cmdqueue, shader);
     }   else if (mode == GFX_DEFERRED_PREVIEW_MTL)   {
-        gfx_shader_setf(shader, SHADER_NAME(c_mtlmax), (float)g_deferred->mtls.item_cnt);
+        gfx_shader_setf(shader, SHADER_NAME(c_mtlmax), (float)g_deferred->mtl_slots.cnt);
         gfx_shader_bindconstants(cmdqueue, shader);
     }
 
@@ -1242,8 +1309,6 @@ void deferred_renderpreview(gfx_cmdqueue cmdqueue, enum gfx_deferred_preview_mod
     gfx_canvas_settextcolor(&g_color_white);
 
     PRF_CLOSESAMPLE(); /* preview */
-
-    gfx_set_previewrenderflag();
 }
 
 result_t deferred_console_setpreview(uint argc, const char** argv, void* param)
@@ -1294,12 +1359,10 @@ int deferred_load_light_shaders(struct allocator* alloc)
 
     char mtlsmax[16];
     char lightsmax[16];
-    char lightidx_max[16];
     char tiles_max[16];
 
     str_itos(mtlsmax, DEFERRED_MTLS_MAX);
     str_itos(lightsmax, DEFERRED_LIGHTS_MAX);
-    str_itos(lightidx_max, DEFERRED_LIGHTS_PERPASS_MAX);
     str_itos(tiles_max, DEFERRED_LIGHTS_TILES_MAX);
 
     gfx_shader_beginload(alloc, "shaders/fsq-pos.vs", "shaders/df-light.ps", NULL, 2,
@@ -1316,13 +1379,12 @@ int deferred_load_light_shaders(struct allocator* alloc)
 
     gfx_shader_beginload(alloc, "shaders/df-light.vs", "shaders/df-light.ps", NULL, 2,
         "shaders/df-common.inc", "shaders/brdf.inc");
-    r = deferred_addshader(gfx_shader_add("dlight-local", 2, 5,
+    r = deferred_addshader(gfx_shader_add("dlight-local", 2, 4,
         GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
         GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord", 0,
         "_MAX_MTLS_", mtlsmax,
         "_LOCAL_LIGHTING_", "1",
         "_MAX_LIGHTS_", lightsmax,
-        "_MAX_LIGHT_INDEXES_", lightidx_max,
         "_MAX_TILES_", tiles_max),
         0, DEFERRED_SHADERGROUP_LIGHT);
     gfx_shader_endload();
@@ -1366,6 +1428,32 @@ void deferred_destroylitrt()
         gfx_destroy_texture(g_deferred->lit_tex);
 }
 
+result_t deferred_createwhitert()
+{
+    g_deferred->white_tex = gfx_create_texturert(1, 1, GFX_FORMAT_RGBA_UNORM, FALSE);
+    if (g_deferred->white_tex == NULL)
+        return RET_FAIL;
+    g_deferred->white_rt = gfx_create_rendertarget(&g_deferred->white_tex, 1, NULL);
+    if (g_deferred->white_rt == NULL)
+        return RET_FAIL;
+
+    gfx_cmdqueue cmdqueue = gfx_get_cmdqueue(0);
+    float clear_clr[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    gfx_output_setrendertarget(cmdqueue, g_deferred->white_rt);
+    gfx_output_clearrendertarget(cmdqueue, g_deferred->white_rt, clear_clr, 1.0f, 0,
+        GFX_CLEAR_COLOR);
+    gfx_output_setrendertarget(cmdqueue, NULL);
+    return RET_OK;
+}
+
+void deferred_destroywhitert()
+{
+    if (g_deferred->white_rt != NULL)
+        gfx_destroy_rendertarget(g_deferred->white_rt);
+    if (g_deferred->white_tex != NULL)
+        gfx_destroy_texture(g_deferred->white_tex);
+}
+
 void deferred_renderlocallights(gfx_cmdqueue cmdqueue, const struct gfx_view_params* params,
     const struct gfx_renderpass_lightdata* lightdata)
 {
@@ -1385,12 +1473,18 @@ void deferred_renderlocallights(gfx_cmdqueue cmdqueue, const struct gfx_view_par
     gfx_shader_bind(cmdqueue, shader);
 
     /* batch/cull */
-    deferred_processtiles(&g_deferred->tiles, tmp_alloc, 0, g_deferred->tiles.cnt, params,
-        lightdata->lights, lightdata->bounds, lightdata->cnt);
-
-    /* push lights to gpu */
-    gfx_shader_updatecblock(cmdqueue, g_deferred->tb_lights);
+    deferred_processtiles(&g_deferred->tiles, tmp_alloc, params, lightdata->lights,
+        lightdata->bounds, lightdata->cnt);
+
+    /* push lights and clusters to gpu, light table is only uploaded if any light is repacked */
+    struct deferred_tiles* tiles = &g_deferred->tiles;
+    if (g_deferred->light_slots.dirty)  {
+        gfx_shader_updatecblock(cmdqueue, g_deferred->tb_lights);
+        g_deferred->light_slots.dirty = FALSE;
+    }
     gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_lights), g_deferred->tb_lights);
+    gfx_shader_updatecblock(cmdqueue, tiles->tb_clusters);
+    gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_clusters), tiles->tb_clusters);
 
     /* set materials */
     gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_mtls), g_deferred->tb_mtls);
@@ -1401,7 +1495,13 @@ void deferred_renderlocallights(gfx_cmdqueue cmdqueue, const struct gfx_view_par
     gfx_shader_set4f(shader, SHADER_NAME(c_projparams), params->projparams.f);
     gfx_shader_setf(shader, SHADER_NAME(c_camfar), params->cam->ffar);
     gfx_shader_set2f(shader, SHADER_NAME(c_rtsz), rtvsz);
+    float cluster_params[] = {tiles->clusters.slice_scale, tiles->clusters.slice_bias,
+        (float)tiles->clusters.slice_cnt, 0.0f};
+    struct mat3f view_inv;
     gfx_shader_set3ui(shader, SHADER_NAME(c_grid), grid);
+    gfx_shader_set4f(shader, SHADER_NAME(c_clusterparams), cluster_params);
+    deferred_viewinv(&view_inv, params);
+    gfx_shader_set3m(shader, SHADER_NAME(c_viewinv), &view_inv);
     gfx_shader_bindcblocks(cmdqueue, shader, (const struct gfx_cblock**)&g_deferred->cb_light, 1);
     gfx_input_setlayout(cmdqueue, g_deferred->tile_il);
 
@@ -1464,8 +1564,11 @@ void deferred_renderlights(gfx_cmdqueue cmdqueue, const struct gfx_view_params*
         GFX_CLEAR_COLOR);
     gfx_output_setviewport(cmdqueue, 0, 0, g_deferred->width, g_deferred->height);
 
-    /* push materials to gpu */
-    gfx_shader_updatecblock(cmdqueue, g_deferred->tb_mtls);
+    /* push materials to gpu, only if new materials are added since the last upload */
+    if (g_deferred->mtl_slots.dirty)    {
+        gfx_shader_updatecblock(cmdqueue, g_deferred->tb_mtls);
+        g_deferred->mtl_slots.dirty = FALSE;
+    }
 
     /* render directional (sun) light */
     deferred_rendersunlight(cmdqueue, params, ssao_tex, shadowcsm_tex);
@@ -1573,38 +1676,89 @@ void deferred_rendersunlight(gfx_cmdqueue cmdqueue, const struct gfx_view_params
     PRF_CLOSESAMPLE();  /* sun light */
 }
 
-uint deferred_pushmtl(struct gfx_cblock* cb_mtl)
+/* materials with identical data share a slot (key is the content hash of the cblock),
+ * data is written to tb_mtls only when a new slot is taken */
+uint deferred_pushmtl(struct gfx_model_mtlgpu* gmtl)
 {
-    /* construct hash and search in mtable and see if we already have it */
-    uint h = hash_murmur32(cb_mtl->cpu_buffer, cb_mtl->buffer_size, SHADER_HSEED);
-    struct hashtable_item* item = hashtable_open_find(&g_deferred->mtable, h);
-    if (item == NULL)   {
-        if (g_deferred->mtls.item_cnt == DEFERRED_MTLS_MAX) {
-            log_print(LOG_WARNING, "deferred materials exceeding specified limit- set to 0");
-            return 0;
-        }
-
-        struct gfx_cblock** pcb = (struct gfx_cblock**)arr_add(&g_deferred->mtls);
-        ASSERT(pcb);
-        *pcb = cb_mtl;
-
-        uint idx = g_deferred->mtls.item_cnt - 1;
-        hashtable_open_add(&g_deferred->mtable, h, idx);
+    struct deferred_slots* slots = &g_deferred->mtl_slots;
+    struct gfx_cblock* cb_mtl = gmtl->cb;
+    int is_new;
+    uint idx = deferred_fetchslot(slots, gmtl->cb_hash, &is_new);
+    if (idx == INVALID_INDEX)   {
+        log_print(LOG_WARNING, "deferred materials exceeding specified limit- set to 0");
+        return 0;
+    }
 
-        /* update data in tb_mtl */
+    if (is_new) {
         gfx_cb_setpv_offset(g_deferred->tb_mtls, 0, cb_mtl->cpu_buffer, cb_mtl->buffer_size,
             idx*cb_mtl->buffer_size);
-
-        return idx;
-    }   else    {
-        return (uint)item->value;
+        g_deferred->tb_mtls->end_offset = slots->cnt*cb_mtl->buffer_size;
     }
+    return idx;
+}
+
+result_t deferred_createslots(struct deferred_slots* slots, uint max)
+{
+    memset(slots, 0x00, sizeof(struct deferred_slots));
+    slots->max = max;
+    slots->frame_ids = (uint*)ALLOC(sizeof(uint)*max, MID_GFX);
+    slots->keys = (uint*)ALLOC(sizeof(uint)*max, MID_GFX);
+    slots->free_slots = (uint*)ALLOC(sizeof(uint)*max, MID_GFX);
+    if (slots->frame_ids == NULL || slots->keys == NULL || slots->free_slots == NULL)
+        return RET_OUTOFMEMORY;
+
+    return hashtable_open_create(mem_heap(), &slots->table, 100, 200, MID_GFX);
 }
 
-const struct gfx_cblock* deferred_fetchmtl(int idx)
+void deferred_destroyslots(struct deferred_slots* slots)
 {
-    ASSERT(idx < (int)g_deferred->mtls.item_cnt);
-    return &((struct gfx_cblock*)g_deferred->mtls.buffer)[idx];
+    if (slots->frame_ids != NULL)
+        FREE(slots->frame_ids);
+    if (slots->keys != NULL)
+        FREE(slots->keys);
+    if (slots->free_slots != NULL)
+        FREE(slots->free_slots);
+    hashtable_open_destroy(&slots->table);
+    memset(slots, 0x00, sizeof(struct deferred_slots));
+}
+
+/* returns the slot of the key and marks it as referenced in the current frame
+ * is_new is set if the slot is newly taken and its data should be (re)written
+ * returns INVALID_INDEX if all slots are referenced in the current frame */
+uint deferred_fetchslot(struct deferred_slots* slots, uint key, OUT int* is_new)
+{
+    uint frame_id = g_deferred->frame_id;
+    struct hashtable_item* item = hashtable_open_find(&slots->table, key);
+    if (item != NULL)   {
+        uint idx = (uint)item->value;
+        slots->frame_ids[idx] = frame_id;
+        *is_new = FALSE;
+        return idx;
+    }
+
+    /* table is full: recycle every slot that is not referenced in this frame */
+    if (slots->free_cnt == 0 && slots->cnt == slots->max) {
+        for (uint i = 0; i < slots->cnt; i++) {
+            uint fid = slots->frame_ids[i];
+            if (fid != frame_id && fid != INVALID_INDEX)  {
+                item = hashtable_open_find(&slots->table, slots->keys[i]);
+                if (item != NULL)
+                    hashtable_open_remove(&slots->table, item);
+                slots->frame_ids[i] = INVALID_INDEX;
+                slots->free_slots[slots->free_cnt++] = i;
+            }
+        }
+        if (slots->free_cnt == 0)
+            return INVALID_INDEX;
+    }
+
+    uint idx = (slots->free_cnt > 0) ? slots->free_slots[--slots->free_cnt] : slots->cnt++;
+    slots->frame_ids[idx] = frame_id;
+    slots->keys[idx] = key;
+    hashtable_open_add(&slots->table, key, idx);
+    slots->dirty = TRUE;
+    *is_new = TRUE;
+    return idx;
 }
 
 
@@ -1677,8 +1831,8 @@ result_t deferred_createtiles(struct deferred_tiles* tiles, uint width, uint hei
         return RET_OUTOFMEMORY;
     memset(tiles->light_lists, 0x00, sizeof(struct deferred_shader_tile)*cnt);
 
-    /* light allocator */
-    r = hashtable_open_create(mem_heap(), &tiles->light_table, 100, 200, MID_GFX);
+    r = deferred_createclusters(tiles, width, height, g_deferred->cluster_slices,
+        g_deferred->cluster_cap);
     if (IS_FAIL(r))
         return r;
 
@@ -1697,70 +1851,123 @@ void deferred_destroytiles(struct deferred_tiles* tiles)
         ALIGNED_FREE(tiles->rects);
     if (tiles->simd_data != NULL)
         ALIGNED_FREE(tiles->simd_data);
-    hashtable_open_destroy(&tiles->light_table);
+    deferred_destroyclusters(tiles);
     deferred_destroytilequad();
 }
 
+result_t deferred_createclusters(struct deferred_tiles* tiles, uint width, uint height,
+    uint slice_cnt, uint cluster_cap)
+{
+    uint cluster_cnt = tiles->cnt*slice_cnt;
+    uint* cnts = (uint*)ALLOC(sizeof(uint)*cluster_cnt, MID_GFX);
+    uint16* idxs = (uint16*)ALLOC(sizeof(uint16)*cluster_cnt*cluster_cap, MID_GFX);
+    if (cnts == NULL || idxs == NULL)   {
+        if (cnts != NULL)
+            FREE(cnts);
+        if (idxs != NULL)
+            FREE(idxs);
+        return RET_OUTOFMEMORY;
+    }
+    memset(cnts, 0x00, sizeof(uint)*cluster_cnt);
+
+    /* tile counts are written into the shader tiles directly */
+    light_clusters_init(&tiles->clusters, width, height, DEFERRED_TILE_SIZE, slice_cnt,
+        cluster_cap, cnts, idxs, &tiles->light_lists[0].cnt[0],
+        sizeof(struct deferred_shader_tile)/sizeof(uint));
+
+    /* gpu buffer holds a header for each cluster and index groups for all clusters at full
+     * capacity, only the used part is uploaded each frame (see light_clusters_pack) */
+    uint item_cnt = light_clusters_getmaxitems(&tiles->clusters);
+    tiles->tb_clusters = gfx_shader_create_cblock_tbuffer(mem_heap(),
+        gfx_shader_get(g_deferred->light_shaders[DEFERRED_LIGHTSHADER_LOCAL].shader_id),
+        "tb_clusters", sizeof(struct vec4f)*item_cnt);
+    if (tiles->tb_clusters == NULL)
+        return RET_FAIL;
+
+    return RET_OK;
+}
+
+void deferred_destroyclusters(struct deferred_tiles* tiles)
+{
+    if (tiles->clusters.cnts != NULL)
+        FREE(tiles->clusters.cnts);
+    if (tiles->clusters.idxs != NULL)
+        FREE(tiles->clusters.idxs);
+    if (tiles->tb_clusters != NULL)
+        gfx_shader_destroy_cblock(tiles->tb_clusters);
+    memset(&tiles->clusters, 0x00, sizeof(tiles->clusters));
+    tiles->tb_clusters = NULL;
+}
+
 void deferred_cleartiles(struct deferred_tiles* tiles)
 {
     for (uint i = 0, cnt = tiles->cnt; i < cnt; i++)
         tiles->light_lists[i].cnt[0] = 0;
-    hashtable_open_clear(&tiles->light_table);
     tiles->light_cnt = 0;
+    tiles->dirty_cnt = 0;
+    tiles->pair_cnt = 0;
+    tiles->overflow_cnt = 0;
 }
 
-uint deferred_createlight(struct deferred_tiles* tiles, const struct scn_render_light* light,
-    const struct mat3f* view)
+/* lights keep their slot in tb_lights while they are visible, data is repacked only if the
+ * light component is changed (version) or its lod intensity is changed
+ * returns INVALID_INDEX if there is no free slot for the light */
+uint deferred_createlight(struct deferred_tiles* tiles, const struct scn_render_light* light)
 {
-    /* search in light_table and see if we already cached light data */
-    uint hash = hash_u64(light->light_hdl);
-    struct hashtable_item* item = hashtable_open_find(&tiles->light_table, hash);
-    if (item != NULL)   {
-        return (uint)item->value;
-    }   else    {
-        uint idx = tiles->light_cnt;
-
-        if (idx == DEFERRED_LIGHTS_MAX) {
-            log_print(LOG_WARNING, "lights exceed maximum limit, reset to 0.");
-            return 0;
-        }
-
-        struct cmp_light* ldata = (struct cmp_light*)cmp_getinstancedata(light->light_hdl);
-        struct deferred_light dlight;
-
-        /* calculate light data (view-space) */
-        dlight.type[0] = (float)ldata->type;
-        vec3_transformsrt(&dlight.pos_vs, &ldata->pos, view);
-        vec4_setf(&dlight.atten, ldata->atten_near, ldata->atten_far, cosf(ldata->atten_narrow),
-            cosf(ldata->atten_wide));
-        vec3_transformsr(&dlight.dir_vs, &ldata->dir, view);
-        /* premultiply lightcolor by intensity */
-        float intensity = ldata->intensity*light->intensity_mul;
-        color_setc(&dlight.color,
-            color_muls(&dlight.color, &ldata->color_lin, intensity));
-        dlight.color.a = intensity;
-
-        /* add to db/tbuffer */
-        gfx_cb_setpv_offset(g_deferred->tb_lights, 0, &dlight, sizeof(dlight), idx*sizeof(dlight));
-        hashtable_open_add(&tiles->light_table, hash, idx);
-        tiles->light_cnt++;
+    struct deferred_slots* slots = &g_deferred->light_slots;
+    struct cmp_light* ldata = (struct cmp_light*)cmp_getinstancedata(light->light_hdl);
+    int is_new;
+    uint idx = deferred_fetchslot(slots, hash_u64(light->light_hdl), &is_new);
+    if (idx == INVALID_INDEX)   {
+        log_print(LOG_WARNING, "lights exceed maximum limit, light is skipped.");
+        return INVALID_INDEX;
+    }
+    tiles->light_cnt++;
 
+    if (!is_new && g_deferred->light_versions[idx] == ldata->version &&
+        g_deferred->light_intensities[idx] == light->intensity_mul)
+    {
         return idx;
     }
+
+    /* calculate light data (world-space) */
+    struct deferred_light dlight;
+    dlight.type[0] = (float)ldata->type;
+    vec3_setv(&dlight.pos_ws, &ldata->pos);
+    vec4_setf(&dlight.atten, ldata->atten_near, ldata->atten_far, cosf(ldata->atten_narrow),
+        cosf(ldata->atten_wide));
+    vec3_setv(&dlight.dir_ws, &ldata->dir);
+    /* premultiply lightcolor by intensity */
+    float intensity = ldata->intensity*light->intensity_mul;
+    color_setc(&dlight.color,
+        color_muls(&dlight.color, &ldata->color_lin, intensity));
+    dlight.color.a = intensity;
+
+    /* add to db/tbuffer */
+    gfx_cb_setpv_offset(g_deferred->tb_lights, 0, &dlight, sizeof(dlight), idx*sizeof(dlight));
+    g_deferred->tb_lights->end_offset = slots->cnt*sizeof(dlight);
+    g_deferred->light_versions[idx] = ldata->version;
+    g_deferred->light_intensities[idx] = light->intensity_mul;
+    slots->dirty = TRUE;
+    tiles->dirty_cnt++;
+
+    return idx;
 }
 
-/* process (cull) batch of tiles and build light lists for each tile
- * start_idx: index of the starting tile
- * end_idx: index of the end tile (=count to process to end)
- */
+/* process (cull) tiles and build light lists for each cluster (tile + depth slice)
+ * instead of testing every cluster against every light, each light is converted to the range of
+ * tiles and depth slices that it overlaps and only those clusters are visited. lights are packed
+ * into tb_lights on the main thread first, then tile rows are binned in parallel on job threads */
 void deferred_processtiles(struct deferred_tiles* tiles, struct allocator* alloc,
-    uint start_idx, uint end_idx, const struct gfx_view_params* params,
-    const struct scn_render_light* lights, const struct sphere* bounds, uint light_cnt)
+    const struct gfx_view_params* params, const struct scn_render_light* lights,
+    const struct sphere* bounds, uint light_cnt)
 {
     PRF_OPENSAMPLE("process-tiles");
 
-    float wh = (float)g_deferred->width * 0.5f;
-    float hh = (float)g_deferred->height * 0.5f;
+    float w = (float)g_deferred->width;
+    float h = (float)g_deferred->height;
+    float wh = w * 0.5f;
+    float hh = h * 0.5f;
 
     /* calculate world->clip space matrix */
     struct mat4f viewprojclip;
@@ -1774,69 +1981,128 @@ void deferred_processtiles(struct deferred_tiles* tiles, struct allocator* alloc
 
     /* calculate inverse-view matrix from view */
     struct mat3f view_inv;
-    mat3_setf(&view_inv,
-        params->view.m11, params->view.m21, params->view.m31,
-        params->view.m12, params->view.m22, params->view.m32,
-        params->view.m13, params->view.m23, params->view.m33,
-        params->cam_pos.x, params->cam_pos.y, params->cam_pos.z);
+    deferred_viewinv(&view_inv, params);
 
     /* calculate screen-space simd-friendly rectangles */
     struct vec4f* r = deferred_calc_lightbounds_simd(alloc, bounds, lights, light_cnt, &view_inv,
         &viewprojclip);
-    if (r == NULL)
+    if (r == NULL)  {
+        PRF_CLOSESAMPLE();
         return;
+    }
 
-    int* cull = (int*)A_ALLOC(alloc, sizeof(int)*light_cnt, MID_GFX);
-    if (cull == NULL)   {
-        A_FREE(alloc, r);
+    struct light_range* ranges = (struct light_range*)
+        A_ALLOC(alloc, sizeof(struct light_range)*light_cnt, MID_GFX);
+    if (ranges == NULL)   {
+        A_ALIGNED_FREE(alloc, r);
+        PRF_CLOSESAMPLE();
         return;
     }
 
-    /* process two lights in each iteration
-     * in each iteration we get a tile and test it with two lights in each subloop iteration */
-    const struct vec4f* tiles_simd = tiles->simd_data;
-    for (uint i = start_idx; i < end_idx; i++)  {
-        simd_t _tmin = _mm_load_ps(tiles_simd[2*i].f);   /* tile_min = x_min, y_min, x_min, y_min */
-        simd_t _tmax = _mm_load_ps(tiles_simd[2*i+1].f); /* tile_max = x_max, y_max, x_max, y_max */
-
-        for (uint k = 0; k < light_cnt; k+=2)  {
-            struct vec4f* v1 = &r[k];				/* v1 = x_min1, y_min1, x_min2, y_min2 */
-            struct vec4f* v2 = &r[k + 1];			/* v2 = x_max1, y_max1, x_max2, y_max2 */
-
-            simd_t _vmin = _mm_load_ps(v1->f);
-            simd_t _vmax = _mm_load_ps(v2->f);
-            simd_t _r1 = _mm_cmpgt_ps(_tmin, _vmax); /* (x_min > x_max1), (y_min > y_max1)
-                                                      * (x_min > x_max2), (y_min > y_max2) */
-            simd_t _r2 = _mm_cmplt_ps(_tmax, _vmin); /* (x_max < x_min1), (y_max < y_min1)
-                                                      * (x_max < x_min2), (y_max < y_min2) */
-
-            simd_t _r = _mm_or_ps(_r1, _r2);    /* OR of two above statements */
-
-            int mask = _mm_movemask_ps(_r);   /* if any values are 0xffffff
-                                                 * then no intersection is occured */
-            cull[k] = (mask & 0x3); /* mask higher bits for rectangle #1  */
-            cull[k+1] = (mask & 0xC); /* mask lower bits for rectangle #2  */
-        }
+    /* exponential depth slices between camera near and far planes */
+    light_clusters_setdepth(&tiles->clusters, params->cam->fnear, params->cam->ffar);
+
+    /* tile and slice range of each light, rects are stored in pairs:
+     * r[k] = (x_min1, y_min1, x_min2, y_min2), r[k+1] = (x_max1, y_max1, x_max2, y_max2) */
+    uint vis_cnt = 0;
+    for (uint k = 0; k < light_cnt; k++)  {
+        const struct vec4f* vmin = &r[k & ~1u];
+        const struct vec4f* vmax = &r[(k & ~1u) + 1];
+        int second = (k & 1);
+        const struct sphere* s = &bounds[lights[k].bounds_idx];
+        struct light_range* lr = &ranges[k];
+        struct vec3f center;
+        struct vec3f center_vs;
+
+        lr->idx = INVALID_INDEX;
+        lr->rc[0] = second ? vmin->z : vmin->x;
+        lr->rc[1] = second ? vmin->w : vmin->y;
+        lr->rc[2] = second ? vmax->z : vmax->x;
+        lr->rc[3] = second ? vmax->w : vmax->y;
+
+        vec3_transformsrt(&center_vs, vec3_setf(&center, s->x, s->y, s->z), &params->view);
+        lr->zmin = center_vs.z - s->r;
+        lr->zmax = center_vs.z + s->r;
+
+        if (!light_clusters_setrange(&tiles->clusters, lr))
+            continue;
+
+        lr->idx = deferred_createlight(tiles, &lights[k]);
+        if (lr->idx == INVALID_INDEX)
+            continue;
+        tiles->pair_cnt += (lr->x1 - lr->x0 + 1)*(lr->y1 - lr->y0 + 1);
+        vis_cnt++;
+    }
 
-        /* gather lights */
-        for (uint k = 0; k < light_cnt; k++)  {
-            if (cull[k] == 0 && tiles->light_lists[i].cnt[0] < DEFERRED_LIGHTS_PERPASS_MAX)   {
-                tiles->light_lists[i].idxs[tiles->light_lists[i].cnt[0]++] =
-                    deferred_createlight(tiles, &lights[k], &params->view);
-            }
-        }
+    /* bin lights into clusters, main thread takes the last share of the rows */
+    struct deferred_tilejob job;
+    memset(&job, 0x00, sizeof(job));
+    job.tiles = tiles;
+    job.ranges = ranges;
+    job.range_cnt = light_cnt;
+
+    uint thread_cnt = (vis_cnt >= DEFERRED_TILEJOB_LIGHTS_MIN) ?
+        minui(g_deferred->job_thread_cnt, tiles->cnt_y - 1) : 0;
+    job.worker_cnt = thread_cnt + 1;
+    uint job_id = 0;
+    if (thread_cnt > 0)   {
+        job_id = tsk_dispatch_exclusive(deferred_bintiles_job, g_deferred->job_threads,
+            thread_cnt, &job, NULL);
+        if (job_id == 0)
+            job.worker_cnt = 1;
+    }
+
+    deferred_bintiles(&job, job.worker_cnt - 1);
+
+    if (job_id != 0)  {
+        tsk_wait(job_id);
+        tsk_destroy(job_id);
+    }
+    tiles->worker_cnt = job.worker_cnt;
+    for (uint i = 0; i < job.worker_cnt; i++)
+        tiles->overflow_cnt += job.overflow_cnts[i];
+
+    tiles->tb_clusters->end_offset = sizeof(struct vec4f)*
+        light_clusters_pack(&tiles->clusters, (float*)tiles->tb_clusters->cpu_buffer);
+
+    /* validate against brute-force assignment (requested from console) */
+    if (g_deferred->check_clusters)   {
+        uint mismatch_cnt = light_clusters_check(&tiles->clusters, ranges, light_cnt);
+        log_printf(mismatch_cnt == 0 ? LOG_INFO : LOG_WARNING,
+            "light clusters: %d clusters checked against brute-force, %d mismatch(es)",
+            tiles->clusters.cluster_cnt, mismatch_cnt);
+        g_deferred->check_clusters = FALSE;
     }
 
     /* debug */
     if (g_deferred->debug_tiles)
         deferred_debugtiles(tiles, r, light_cnt);
 
-    A_FREE(alloc, cull);
+    A_FREE(alloc, ranges);
     A_ALIGNED_FREE(alloc, r);
 
     PRF_CLOSESAMPLE();  /* process-tiles */
 }
 
+/* bins light ranges into the clusters of a single worker's tile rows */
+void deferred_bintiles(struct deferred_tilejob* job, uint worker_idx)
+{
+    struct deferred_tiles* tiles = job->tiles;
+    uint rows = (tiles->cnt_y + job->worker_cnt - 1) / job->worker_cnt;
+    uint row_start = worker_idx*rows;
+    uint row_end = minui(row_start + rows, tiles->cnt_y);
+
+    job->overflow_cnts[worker_idx] = light_clusters_bin(&tiles->clusters, job->ranges,
+        job->range_cnt, row_start, row_end);
+}
+
+/* runs in task threads */
+void deferred_bintiles_job(void* params, void* result, uint thread_id, uint job_id,
+    int worker_idx)
+{
+    deferred_bintiles((struct deferred_tilejob*)params, (uint)worker_idx);
+}
+
 #if defined(_SIMD_SSE_)
 /* gets light data and transforms them into simd friendly bounds in clip-space (or pixel space)
  * @return each result is a pair that contains two 2D bounding boxes (count = light_cnt)
@@ -2038,6 +2304,51 @@ void deferred_debugtiles(struct deferred_tiles* tiles,
         gfx_canvas_text2dpt(num, rc.x + rc.w/2 - 5, rc.y + rc.h/2 - 5, 0);
     }
     gfx_canvas_settextcolor(&g_color_white);
+
+    /* binning stats */
+    char text[128];
+    sprintf(text, "lights: %d (repacked: %d, slots: %d), tile/light pairs: %d, workers: %d",
+        tiles->light_cnt, tiles->dirty_cnt, g_deferred->light_slots.cnt, tiles->pair_cnt,
+        tiles->worker_cnt);
+    gfx_canvas_text2dpt(text, 5, 5, 0);
+    sprintf(text, "clusters: %dx%d, lights-per-cluster: %d, overflow: %d", tiles->cnt,
+        tiles->clusters.slice_cnt, tiles->clusters.cap, tiles->overflow_cnt);
+    if (tiles->overflow_cnt > 0)
+        gfx_canvas_settextcolor(&g_color_red);
+    gfx_canvas_text2dpt(text, 5, 20, 0);
+    gfx_canvas_settextcolor(&g_color_white);
+}
+
+result_t deferred_console_lightclusters(uint argc, const char** argv, void* param)
+{
+    if (argc == 0 || argc > 2)
+        return RET_INVALIDARG;
+
+    uint slice_cnt = clampui((uint)str_toint32(argv[0]), 1, DEFERRED_CLUSTER_SLICES_MAX);
+    uint cap = (argc == 2) ?
+        clampui((uint)str_toint32(argv[1]), 1, DEFERRED_LIGHTS_MAX) : g_deferred->cluster_cap;
+
+    struct deferred_tiles* tiles = &g_deferred->tiles;
+    deferred_destroyclusters(tiles);
+    uint width = g_deferred->width;
+    uint height = g_deferred->height;
+    if (IS_FAIL(deferred_createclusters(tiles, width, height, slice_cnt, cap)))  {
+        err_print(__FILE__, __LINE__, "gfx-deferred: could not create light clusters");
+        deferred_destroyclusters(tiles);
+        deferred_createclusters(tiles, width, height, g_deferred->cluster_slices,
+            g_deferred->cluster_cap);
+        return RET_FAIL;
+    }
+
+    g_deferred->cluster_slices = slice_cnt;
+    g_deferred->cluster_cap = cap;
+    return RET_OK;
+}
+
+result_t deferred_console_checkclusters(uint argc, const char** argv, void* param)
+{
+    g_deferred->check_clusters = TRUE;
+    return RET_OK;
 }
 
 result_t deferred_console_showssao(uint argc, const char** argv, void* param)
@@ -2048,8 +2359,10 @@ result_t deferred_console_showssao(uint argc, const char** argv, void* param)
     else if (argc > 1)
         return RET_INVALIDARG;
 
-    if (enable && g_deferred->ssao_result_tmp != NULL)    {
-        hud_add_image("ssao", g_deferred->ssao_result_tmp, TRUE, 0, 0, "[SSAO]");
+    /* image is set by ssao pass */
+    g_deferred->show_ssao = enable;
+    if (enable)    {
+        hud_add_image("ssao", NULL, TRUE, 0, 0, "[SSAO]");
         hud_add_label("ssao", gfx_pfx_ssao_debugtext, g_deferred->ssao);
     }   else    {
         hud_remove_image("ssao");
@@ -2059,6 +2372,18 @@ result_t deferred_console_showssao(uint argc, const char** argv, void* param)
     return RET_OK;
 }
 
+result_t deferred_console_enablessao(uint argc, const char** argv, void* param)
+{
+    int enable = TRUE;
+    if (argc == 1)
+        enable = str_tobool(argv[0]);
+    else if (argc > 1)
+        return RET_INVALIDARG;
+
+    g_deferred->ssao_enable = enable;
+    return RET_OK;
+}
+
 result_t deferred_createtilequad()
 {
     /* create one tile in screen-space */
@@ -33,7 +33,6 @@ struct gfx_fwd_renderer
 	uint shaderid_raw;
 	uint shaderid_diffmap;
 	struct gfx_cblock* cb_frame;
-	struct gfx_cblock* cb_xforms;
     gfx_depthstencilstate ds;
 };
 
@@ -43,7 +42,7 @@ struct gfx_fwd_renderer
 void gfx_fwd_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
 		struct gfx_shader* shader, OUT struct gfx_model_geo** pgeo, OUT uint* psubset_idx);
 void gfx_fwd_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-		struct gfx_shader* shader, struct gfx_model_geo* geo, uint subset_idx);
+		struct gfx_model_geo* geo, uint subset_idx);
 
 /*************************************************************************************************
  * globals
@@ -68,24 +67,20 @@ result_t gfx_fwd_init(uint width, uint height)
 
 	struct allocator* lsr_alloc = eng_get_lsralloc();
 	struct allocator* tmp_alloc = tsk_get_tmpalloc(0);
-    char max_instances_str[8];
-    str_itos(max_instances_str, GFX_INSTANCES_MAX);
 
 	/* shaders */
-	gfx_shader_beginload(lsr_alloc, "shaders/fwd.vs", "shaders/fwd.ps", NULL, 2,
-        "shaders/common.inc", "shaders/skin.inc");
-	g_fwd->shaderid_raw = gfx_shader_add("fwd-raw", 3, 1,
+	gfx_shader_beginload(lsr_alloc, "shaders/fwd.vs", "shaders/fwd.ps", NULL, 3,
+        "shaders/common.inc", "shaders/instance.inc", "shaders/skin.inc");
+	g_fwd->shaderid_raw = gfx_shader_add("fwd-raw", 3, 0,
 			GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
 			GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
-			GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
-            "_MAX_INSTANCES_", max_instances_str);
+			GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0);
 
-	g_fwd->shaderid_diffmap = gfx_shader_add("fwd-diffmap", 3, 2,
+	g_fwd->shaderid_diffmap = gfx_shader_add("fwd-diffmap", 3, 1,
 			GFX_INPUTELEMENT_ID_POSITION, "vsi_pos", 0,
 			GFX_INPUTELEMENT_ID_NORMAL, "vsi_norm", 0,
 			GFX_INPUTELEMENT_ID_TEXCOORD0, "vsi_coord0", 0,
-			"_DIFFUSEMAP_", "1",
-            "_MAX_INSTANCES_", max_instances_str);
+			"_DIFFUSEMAP_", "1");
 	gfx_shader_endload();
 
     if (g_fwd->shaderid_raw == 0 || g_fwd->shaderid_diffmap == 0)	{
@@ -96,8 +91,7 @@ result_t gfx_fwd_init(uint width, uint height)
 	/* cblocks */
 	struct gfx_shader* shader = gfx_shader_get(g_fwd->shaderid_diffmap);
 	g_fwd->cb_frame = gfx_shader_create_cblock(lsr_alloc, tmp_alloc, shader, "cb_frame", NULL);
-	g_fwd->cb_xforms = gfx_shader_create_cblock(lsr_alloc, tmp_alloc, shader, "cb_xforms", NULL);
-	if (g_fwd->cb_frame == NULL || g_fwd->cb_xforms == NULL)	{
+	if (g_fwd->cb_frame == NULL)	{
 		err_printf(__FILE__, __LINE__, "fwd-renderer init failed: could not crete cblocks");
 		return RET_FAIL;
 	}
@@ -119,8 +113,6 @@ void gfx_fwd_release()
             gfx_destroy_depthstencilstate(g_fwd->ds);
 		if (g_fwd->cb_frame != NULL)
 			gfx_shader_destroy_cblock(g_fwd->cb_frame);
-		if (g_fwd->cb_xforms != NULL)
-			gfx_shader_destroy_cblock(g_fwd->cb_xforms);
 		if (g_fwd->shaderid_raw != 0)
 			gfx_shader_unload(g_fwd->shaderid_raw);
 		if (g_fwd->shaderid_diffmap != 0)
@@ -149,18 +141,20 @@ void gfx_fwd_render(gfx_cmdqueue cmdqueue, gfx_rendertarget rt,
     	ASSERT(shader);
     	gfx_shader_bind(cmdqueue, shader);
 
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_xforms),
+            gfx_get_xformstream());
+        gfx_shader_bindcblock_tbuffer(cmdqueue, shader, SHADER_NAME(tb_instances),
+            gfx_get_instancestream());
+
     	for (int k = 0; k < bitem->nodes.item_cnt; k++)	{
-    		struct gfx_batch_node* bnode_first = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
+    		struct gfx_batch_node* bnode = &((struct gfx_batch_node*)bitem->nodes.buffer)[k];
     		struct gfx_model_geo* geo;
     		uint subset_idx;
-    		gfx_fwd_preparebatchnode(cmdqueue, bnode_first, shader, &geo, &subset_idx);
-
-    		struct linked_list* node = bnode_first->bll;
-    		while (node != NULL)	{
-    			struct gfx_batch_node* bnode = (struct gfx_batch_node*)node->data;
-    			gfx_fwd_drawbatchnode(cmdqueue, bnode, shader, geo, subset_idx);
-    			node = node->next;
-    		}
+    		if (bnode->instance_cnt == 0)
+    			continue;
+
+    		gfx_fwd_preparebatchnode(cmdqueue, bnode, shader, &geo, &subset_idx);
+    		gfx_fwd_drawbatchnode(cmdqueue, bnode, geo, subset_idx);
     	}	/* for: each batch-item */
     }
 }
@@ -177,27 +171,23 @@ void gfx_fwd_preparebatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnod
 	struct gfx_model_mtlgpu* gmtl = inst->mtls[mtl_id];
 	uint subset_idx = mesh->submeshes[bnode->sub_idx].subset_id;
 
-    const struct gfx_cblock* cblocks[] = {g_fwd->cb_frame, g_fwd->cb_xforms, gmtl->cb};
+    const struct gfx_cblock* cblocks[] = {g_fwd->cb_frame, gmtl->cb};
 
 	*pgeo = geo;
 	*psubset_idx = subset_idx;
 
     gfx_input_setlayout(cmdqueue, geo->inputlayout);
     gfx_model_setmtl(cmdqueue, shader, inst, mtl_id);
-    gfx_shader_bindcblocks(cmdqueue, shader, cblocks, 3);
+    gfx_shader_bindcblocks(cmdqueue, shader, cblocks, 2);
+    gfx_shader_setui(shader, SHADER_NAME(c_instance_offset), bnode->instance_offset);
     gfx_shader_bindconstants(cmdqueue, shader);
 }
 
 void gfx_fwd_drawbatchnode(gfx_cmdqueue cmdqueue, struct gfx_batch_node* bnode,
-		struct gfx_shader* shader, struct gfx_model_geo* geo, uint subset_idx)
+		struct gfx_model_geo* geo, uint subset_idx)
 {
 	struct gfx_model_geosubset* subset = &geo->subsets[subset_idx];
 
-    /* set transform matrices */
-	gfx_cb_set3mvp(g_fwd->cb_xforms, SHADER_NAME(c_mats), bnode->instance_mats,
-			bnode->instance_cnt);
-    gfx_shader_updatecblock(cmdqueue, g_fwd->cb_xforms);
-
 	/* draw */
     gfx_draw_indexedinstance(cmdqueue, GFX_PRIMITIVE_TRIANGLELIST, subset->ib_idx, subset->idx_cnt,
     		geo->ib_type, bnode->instance_cnt, GFX_DRAWCALL_FWD);
@@ -24,10 +24,14 @@
 #include "dhcore/mt.h"
 #include "dhcore/linked-list.h"
 #include "dhcore/task-mgr.h"
+#include "dhcore/timer.h"
 #include "mem-ids.h"
 
 #include "engine.h"
 #include "gfx-device.h"
+#include "gfx-canvas.h"
+#include "console.h"
+#include "debug-hud.h"
 
 #include "gfx-texture.h"
 #include "gfx-model.h"
@@ -38,6 +42,12 @@
 #include "components/cmp-anim.h"
 #include "components/cmp-animchar.h"
 #include "phx-prefab.h"
+#include "h3d-types.h"
+#include "load-queue.h"
+#include "tex-lru.h"
+#include "file-map.h"
+
+#include <stdlib.h>
 
 /*************************************************************************************************
  * defines
@@ -46,37 +56,81 @@
 #define GET_ID(hdl)           ((hdl)&0xffffffff)
 #define MAKE_HANDLE(idx, id)  ((((uint64)(idx))<<32) | (((uint64)(id))&0xffffffff))
 #define DICT_BLOCK_SIZE 4096
+#define RS_LOAD_THREADS_MAX 16
+#define RS_TEXSTREAM_INITSIZE 64    /* largest mip that streamed textures are first loaded with */
+#define RS_TEXSTREAM_PRIORITY_SCALE 8192.0f /* mip request priority = scale/screen-size */
+#define RS_TEXSTREAM_WANTED_FRAMES 2    /* frames that a mip request is valid for */
+#define RS_BUNDLE_MAX 16
+#define RS_PACKSRC_BUCKETS 1021
 
 /*************************************************************************************************
  * types
  */
 typedef void (*pfn_unload_res)(void* res);
 
+/* mip residency of streamed textures, mip indexes are relative to the full mip chain of the file */
+struct rs_texstream
+{
+    uint mip_cnt;   /* mips in file, =0 if texture is not streamed (or first mips are not loaded) */
+    uint width;     /* dimensions of mip 0 */
+    uint height;
+    uint base_mip;  /* highest detail mip that is allowed (first_mipidx of the load request) */
+    uint resident_mip;  /* first mip of the loaded texture */
+    uint pending_mip;   /* first mip of queued/loading stream request, =INVALID_INDEX if none */
+    int srgb;
+    float screen_size;  /* largest projected size (pixels) that is requested in wanted_frame */
+    uint wanted_frame;
+    struct tex_lru_link lru;    /* link in least recently viewed list, valid if mip_cnt != 0 */
+};
+
 struct rs_resource
 {
     reshandle_t hdl;
     uint ref_cnt;
     void* ptr;
-    char filepath[128];
+    uint path_id;   /* interned path (hash), filepath string is kept in rs_mgr.paths */
     pfn_unload_res unload_func;
+    struct rs_load_data* ldata; /* pending request in load queue, NULL if not queued */
+    enum rs_resource_type type;
+    size_t bytes;   /* memory used by loaded object */
+    uint used_frame;    /* last frame that resource is fetched or released */
+    int cached; /* unreferenced, but kept in memory until it's evicted by the budget */
+    uint lru_prev;  /* links in cached list of the type (resource indexes), valid if cached */
+    uint lru_next;
+    int failed; /* last load has failed and resource has no data, so it won't be ready */
+    reshandle_t* deps;  /* referenced resources that are loaded along (textures of a model) */
+    uint dep_cnt;
+    struct rs_texstream texstream;
     struct stack node;
 };
 
+/* cold data of the resource, only needed for hot-loading, streaming requests and logs */
+struct rs_path
+{
+    char filepath[128];
+};
+
 struct rs_freeslot_item
 {
     uint idx;
     struct stack node;
 };
 
-enum rs_resource_type
+/* loaded bundle file (h3db), load requests of it's packed files parse them from this memory */
+struct rs_pack
 {
-    RS_RESOURCE_UNKNOWN = 0,
-    RS_RESOURCE_TEXTURE,
-    RS_RESOURCE_MODEL,
-    RS_RESOURCE_PHXPREFAB,
-    RS_RESOURCE_ANIMREEL,
-    RS_RESOURCE_ANIMCTRL,
-    RS_RESOURCE_SCRIPT
+    uint8* data;    /* whole file */
+    uint ref_cnt;   /* load requests that are bound to packed files (+1 while it's being queued) */
+    struct rs_packsrc* srcs;    /* packed files that are registered in rs_mgr.pack_srcs */
+    uint src_cnt;
+};
+
+struct rs_packsrc
+{
+    struct rs_pack* pack;
+    uint path_id;
+    const uint8* data;
+    uint size;
 };
 
 struct rs_load_data
@@ -85,30 +139,52 @@ struct rs_load_data
     enum rs_resource_type type;
     reshandle_t hdl;
     int reload;
+    const struct rs_packsrc* pack_src;  /* file data in a loaded bundle, NULL if loaded by path */
     union   {
         struct {
             uint first_mipidx;
             int srgb;
+            uint size_max;  /* skip mips larger than this, =0 loads every mip */
+            int stream; /* mip change of a streamed texture, previous one is kept until loaded */
+            uint mip_cnt;   /* result: number of mips in file */
         } tex;
     }   params;
-    struct linked_list lnode;
+    struct load_queue_item qitem;
 };
 
-struct rs_load_job_params
+/* every loader thread owns a slot, each slot runs one load job at a time and is refilled as soon
+ * as it's finished, so a big resource doesn't hold back the loads in other threads */
+struct rs_load_slot
 {
-    uint cnt;
-    struct rs_load_data** load_items;
+    uint job_id;    /* =0 if slot is idle */
+    int thread_idx; /* task-mgr thread that the slot is dispatched to */
+    struct rs_load_data* ldata;
+    int cancelled;  /* resource is unloaded while loading, discard the result */
+    void* ptr;      /* result: loaded object, NULL if failed */
+    fl64 load_tm;   /* result: time spent in loader thread (seconds) */
 };
 
-struct rs_load_job_result
+struct rs_load_stats
 {
-    void** ptrs;    /* loaded pointer objects (count = job_params->cnt) */
+    uint loaded_cnt;
+    uint failed_cnt;
+    fl64 load_tm;   /* accumulated loader thread time (seconds) */
+    fl64 busy_tm;   /* accumulated wall time that loaders were working (seconds) */
+    uint64 busy_tick;   /* start tick of current busy period, =0 if loaders are idle */
 };
 
-struct rs_unload_item
+struct rs_texstream_stats
 {
-    reshandle_t hdl;
-    struct linked_list lnode;
+    uint promote_cnt;   /* requests for higher detail mips */
+    uint demote_cnt;    /* requests for lower detail mips, because of memory pressure */
+};
+
+/* resources that are requested while the bundle is recording, tracked for completion */
+struct rs_bundle
+{
+    uint id;    /* =0 if bundle slot is free */
+    struct array hdls;  /* item = reshandle_t */
+    int owns_refs;  /* loaded from file (rs_load_bundle), holds a reference to each resource */
 };
 
 struct rs_mgr
@@ -116,6 +192,7 @@ struct rs_mgr
     int init;
     uint flags;
     struct array ress; /* item = struct rs_resource */
+    struct array paths; /* item = struct rs_path, same index as ress */
     struct stack* freeslots; /* item = struct rs_freeslot_item */
     struct pool_alloc freeslot_pool;
     struct hashtable_chained dict;
@@ -123,15 +200,31 @@ struct rs_mgr
     struct allocator dict_itemalloc;
     struct allocator* alloc;    /* data allocator */
 
-    struct linked_list* load_list; /* data: rs_load_data */
+    struct load_queue load_queue;   /* item owner: rs_load_data */
     struct pool_alloc load_data_pool;   /* item: rs_load_data */
     gfx_texture blank_tex;  /* blank texture for multi-threaded loading */
     uint load_threads_max;
-    uint load_jobid;
-    struct rs_load_job_params job_params;
-    struct rs_load_job_result job_result;
-    uint job_unload_cnt;  /* count for job_unloads */
-    struct linked_list* unload_items; /* data: rs_unload_item, working jobs that needs to be unloaded */
+    struct rs_load_slot load_slots[RS_LOAD_THREADS_MAX];  /* count = load_threads_max */
+    struct rs_load_stats load_stats;
+    int load_debug;
+
+    uint frame;
+    size_t budgets[RS_RESOURCE_TYPE_CNT];   /* =0: unreferenced resources are unloaded immediately */
+    size_t used_bytes[RS_RESOURCE_TYPE_CNT];
+    size_t cached_bytes[RS_RESOURCE_TYPE_CNT];  /* part of used_bytes that is in cached lists */
+    uint cached_cnts[RS_RESOURCE_TYPE_CNT];
+    uint lru_first[RS_RESOURCE_TYPE_CNT];   /* cached resources, most recently used first */
+    uint lru_last[RS_RESOURCE_TYPE_CNT];    /* least recently used, evicted first */
+    uint evict_cnt;
+    struct rs_texstream_stats texstream_stats;
+    struct tex_lru texstream_lru;   /* streamed textures, least recently viewed are demoted first */
+
+    struct rs_bundle bundles[RS_BUNDLE_MAX];
+    uint bundle_rec;    /* index of the recording bundle, =INVALID_INDEX if none */
+    uint bundle_lastid;
+
+    struct hashtable_chained pack_srcs; /* key: path_id, value: rs_packsrc* */
+    uint pack_cnt;  /* loaded bundle files that are still in use */
 };
 
 /*************************************************************************************************
@@ -139,12 +232,23 @@ struct rs_mgr
  */
 static struct rs_mgr g_rs;
 
+static const char* g_rs_typenames[RS_RESOURCE_TYPE_CNT] = {
+    "unknown",
+    "texture",
+    "model",
+    "phxprefab",
+    "animreel",
+    "animctrl",
+    "script"
+};
+
 /*************************************************************************************************
  * forward declarations
  */
-reshandle_t rs_add_resource(const char* filepath, void* ptr, reshandle_t override_hdl,
-                         pfn_unload_res unload_funcs);
-reshandle_t rs_add_todb(const char* filepath, void* ptr, pfn_unload_res unload_funcs);
+reshandle_t rs_add_resource(const char* filepath, enum rs_resource_type type, void* ptr,
+                            reshandle_t override_hdl, pfn_unload_res unload_funcs);
+reshandle_t rs_add_todb(const char* filepath, enum rs_resource_type type, void* ptr,
+                        pfn_unload_res unload_funcs);
 void rs_remove_fromdb(reshandle_t hdl);
 
 void rs_texture_unload(void* tex);
@@ -163,13 +267,33 @@ void rs_script_reload(const char* filepath, reshandle_t hdl, uptr_t param1, uptr
 void rs_animctrl_reload(const char* filepath, reshandle_t hdl, uptr_t param1, uptr_t param2);
 
 reshandle_t rs_animreel_queueload(const char* reel_filepath, reshandle_t override_hdl);
-reshandle_t rs_texture_queueload(const char* tex_filepath, uint first_mipidx, int srgb,
-                                 reshandle_t override_hdl);
+reshandle_t rs_texture_queueload(const char* tex_filepath, uint first_mipidx, uint size_max,
+                                 int srgb, reshandle_t override_hdl);
 reshandle_t rs_animctrl_queueload(const char* ctrl_filepath, reshandle_t override_hdl);
 reshandle_t rs_model_queueload(const char* model_filepath, reshandle_t override_hdl);
 reshandle_t rs_phxprefab_queueload(const char* phx_filepath, reshandle_t override_hdl);
 reshandle_t rs_script_queueload(const char* lua_filepath, reshandle_t override_hdl);
-int rs_search_in_unloads(reshandle_t hdl);
+void rs_collect_load(struct rs_load_slot* slot);
+void rs_evict_overbudget();
+void rs_evict_cached(struct rs_resource* r);
+void rs_texstream_collect(struct rs_resource* r, const struct rs_load_data* ldata, gfx_texture tex);
+void rs_texstream_demote();
+void rs_model_loaddeps(reshandle_t hdl, uint bucket);
+void rs_release_deps(reshandle_t* deps, uint dep_cnt);
+struct rs_bundle* rs_bundle_find(uint bundle_id);
+struct rs_bundle* rs_bundle_create(int owns_refs);
+reshandle_t rs_bundle_loaditem(const struct h3d_bundle_item* item);
+uint rs_bundle_additem(struct array* items, struct array* hdls, reshandle_t hdl);
+void rs_bundle_savecleanup(struct array* items, struct array* hdls, struct array* dep_idxs,
+    struct array* datas);
+void rs_pack_release(struct rs_pack* pack);
+
+result_t rs_console_budget(uint argc, const char** argv, void* param);
+result_t rs_console_uploadbudget(uint argc, const char** argv, void* param);
+result_t rs_console_savebundle(uint argc, const char** argv, void* param);
+
+result_t rs_console_loadinfo(uint argc, const char** argv, void* param);
+int rs_loadinfo_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param);
 
 /*************************************************************************************************
  * Inlines
@@ -184,19 +308,296 @@ INLINE struct rs_resource* rs_resource_get(reshandle_t hdl) {
     return r;
 }
 
-/* if we have an override handle, check in existing queue and see if it's already exists */
-INLINE struct linked_list* rs_loadqueue_search(reshandle_t hdl)
+INLINE const char* rs_resource_path(const struct rs_resource* r)
+{
+    uint idx = (uint)(r - (const struct rs_resource*)g_rs.ress.buffer);
+    return ((const struct rs_path*)g_rs.paths.buffer)[idx].filepath;
+}
+
+/* resolves interned path to the resource handle, =INVALID_HANDLE if it's not in database */
+INLINE reshandle_t rs_find_byid(uint path_id)
+{
+    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict, path_id);
+    if (item == NULL)
+        return INVALID_HANDLE;
+    return ((const struct rs_resource*)g_rs.ress.buffer)[(uint)item->value].hdl;
+}
+
+/* resolves file path to the resource handle, different paths may hash to the same id, so the
+ * path of the found resource is compared with cold path table. fails on collisions, loaders can't
+ * add the file to database in that case */
+INLINE result_t rs_find_bypath(const char* filepath, OUT reshandle_t* phdl)
+{
+    *phdl = rs_find_byid(hash_str(filepath));
+    if (*phdl != INVALID_HANDLE)    {
+        const char* res_filepath = rs_resource_path(rs_resource_get(*phdl));
+        if (!str_isequal(res_filepath, filepath))   {
+            err_printf(__FILE__, __LINE__, "res-mgr: path id collision, '%s' and '%s'", filepath,
+                res_filepath);
+            *phdl = INVALID_HANDLE;
+            return RET_FAIL;
+        }
+    }
+    return RET_OK;
+}
+
+/* memory used by loaded resource object, for budgets */
+INLINE size_t rs_calc_bytes(enum rs_resource_type type, void* ptr)
+{
+    if (ptr == NULL || ptr == g_rs.blank_tex)
+        return 0;
+
+    switch (type)   {
+    case RS_RESOURCE_TEXTURE:
+        return ((gfx_texture)ptr)->desc.tex.size;
+    case RS_RESOURCE_MODEL:
+        return gfx_model_getsize((struct gfx_model*)ptr);
+    case RS_RESOURCE_ANIMREEL:
+        return anim_getsize((anim_reel)ptr);
+    case RS_RESOURCE_ANIMCTRL:
+        return anim_ctrl_getsize((anim_ctrl)ptr);
+    case RS_RESOURCE_PHXPREFAB:
+        return phx_prefab_getsize((phx_prefab)ptr);
+    case RS_RESOURCE_SCRIPT:
+        return sct_getsize((sct_t)ptr);
+    default:
+        return 0;
+    }
+}
+
+/* binds loaded object to the resource and updates memory usage of it's category */
+INLINE void rs_resource_setptr(struct rs_resource* r, void* ptr)
+{
+    g_rs.used_bytes[r->type] -= r->bytes;
+    if (r->cached)
+        g_rs.cached_bytes[r->type] -= r->bytes;
+    r->ptr = ptr;
+    r->bytes = rs_calc_bytes(r->type, ptr);
+    g_rs.used_bytes[r->type] += r->bytes;
+    if (r->cached)
+        g_rs.cached_bytes[r->type] += r->bytes;
+}
+
+/* cached list: resources are array items that may move when the array grows, so links are
+ * indexes. eviction pops from the tail, touching a cached resource moves it to the head */
+INLINE uint rs_resource_idx(const struct rs_resource* r)
+{
+    return (uint)(r - (const struct rs_resource*)g_rs.ress.buffer);
+}
+
+INLINE void rs_cache_link(struct rs_resource* r)
+{
+    struct rs_resource* rss = (struct rs_resource*)g_rs.ress.buffer;
+    uint idx = rs_resource_idx(r);
+    uint first = g_rs.lru_first[r->type];
+
+    r->lru_prev = INVALID_INDEX;
+    r->lru_next = first;
+    if (first != INVALID_INDEX)
+        rss[first].lru_prev = idx;
+    else
+        g_rs.lru_last[r->type] = idx;
+    g_rs.lru_first[r->type] = idx;
+}
+
+INLINE void rs_cache_unlink(struct rs_resource* r)
+{
+    struct rs_resource* rss = (struct rs_resource*)g_rs.ress.buffer;
+    if (r->lru_prev != INVALID_INDEX)
+        rss[r->lru_prev].lru_next = r->lru_next;
+    else
+        g_rs.lru_first[r->type] = r->lru_next;
+    if (r->lru_next != INVALID_INDEX)
+        rss[r->lru_next].lru_prev = r->lru_prev;
+    else
+        g_rs.lru_last[r->type] = r->lru_prev;
+    r->lru_prev = INVALID_INDEX;
+    r->lru_next = INVALID_INDEX;
+}
+
+INLINE void rs_cache_add(struct rs_resource* r)
+{
+    ASSERT(!r->cached);
+    r->cached = TRUE;
+    g_rs.cached_cnts[r->type] ++;
+    g_rs.cached_bytes[r->type] += r->bytes;
+    rs_cache_link(r);
+}
+
+INLINE void rs_cache_remove(struct rs_resource* r)
+{
+    if (r->cached)  {
+        r->cached = FALSE;
+        g_rs.cached_cnts[r->type] --;
+        g_rs.cached_bytes[r->type] -= r->bytes;
+        rs_cache_unlink(r);
+    }
+}
+
+INLINE void rs_resource_addref(struct rs_resource* r)
+{
+    /* revive resource from cache */
+    rs_cache_remove(r);
+    r->ref_cnt ++;
+}
+
+INLINE struct rs_resource* rs_resource_use(reshandle_t hdl)
+{
+    struct rs_resource* r = rs_resource_get(hdl);
+    r->used_frame = g_rs.frame;
+    if (r->cached && g_rs.lru_first[r->type] != rs_resource_idx(r))   {
+        rs_cache_unlink(r);
+        rs_cache_link(r);
+    }
+    return r;
+}
+
+/* resource has it's data (or has failed loading), regardless of it's dependencies */
+INLINE int rs_resource_isloaded(const struct rs_resource* r)
+{
+    return r->failed || (r->ptr != NULL && r->ptr != g_rs.blank_tex);
+}
+
+/* adds a requested resource to the recording bundle (rs_bundle_begin) */
+INLINE void rs_bundle_record(reshandle_t hdl)
+{
+    if (g_rs.bundle_rec == INVALID_INDEX || hdl == INVALID_HANDLE)
+        return;
+
+    reshandle_t* h = (reshandle_t*)arr_add(&g_rs.bundles[g_rs.bundle_rec].hdls);
+    if (h != NULL)
+        *h = hdl;
+}
+
+/* returns file data of the resource if it's packed in a loaded bundle, NULL if it's not */
+INLINE const struct rs_packsrc* rs_pack_findsrc(uint path_id)
 {
-    struct linked_list* lnode = g_rs.load_list;
-    while (lnode != NULL)   {
-        struct rs_load_data* ldata = (struct rs_load_data*)lnode->data;
-        if (ldata->hdl == hdl)
-            return lnode;
-        lnode = lnode->next;
+    if (g_rs.pack_cnt == 0)
+        return NULL;
+    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.pack_srcs, path_id);
+    return item != NULL ? (const struct rs_packsrc*)item->value : NULL;
+}
+
+/* binds load request to packed file data, bundle memory is kept until the request is freed */
+INLINE void rs_loaddata_bindpack(struct rs_load_data* ldata)
+{
+    const struct rs_packsrc* src = rs_pack_findsrc(rs_resource_get(ldata->hdl)->path_id);
+    if (src != NULL)    {
+        src->pack->ref_cnt ++;
+        ldata->pack_src = src;
+    }
+}
+
+INLINE void rs_loaddata_free(struct rs_load_data* ldata)
+{
+    if (ldata->pack_src != NULL)
+        rs_pack_release(ldata->pack_src->pack);
+    mem_pool_free(&g_rs.load_data_pool, ldata);
+}
+
+/* returns the slot that is loading the resource, NULL if it's not being loaded */
+INLINE struct rs_load_slot* rs_loadslot_find(reshandle_t hdl)
+{
+    for (uint i = 0; i < g_rs.load_threads_max; i++) {
+        struct rs_load_slot* slot = &g_rs.load_slots[i];
+        if (slot->job_id != 0 && slot->ldata->hdl == hdl)
+            return slot;
     }
     return NULL;
 }
 
+/* returns pending request of the resource in load queue, NULL if it's not queued */
+INLINE struct rs_load_data* rs_loadqueue_search(reshandle_t hdl)
+{
+    return rs_resource_get(hdl)->ldata;
+}
+
+INLINE uint rs_loadqueue_bucket(float priority)
+{
+    return load_queue_bucket(priority);
+}
+
+INLINE void rs_loadqueue_push(struct rs_load_data* ldata, uint bucket, int front)
+{
+    load_queue_push(&g_rs.load_queue, &ldata->qitem, ldata, bucket, front);
+    rs_resource_get(ldata->hdl)->ldata = ldata;
+}
+
+INLINE void rs_loadqueue_remove(struct rs_load_data* ldata)
+{
+    load_queue_remove(&g_rs.load_queue, &ldata->qitem);
+    rs_resource_get(ldata->hdl)->ldata = NULL;
+}
+
+/* pops the oldest request with the highest priority, NULL if queue is empty */
+INLINE struct rs_load_data* rs_loadqueue_pop()
+{
+    struct rs_load_data* ldata = (struct rs_load_data*)load_queue_pop(&g_rs.load_queue);
+    if (ldata != NULL)
+        rs_resource_get(ldata->hdl)->ldata = NULL;
+    return ldata;
+}
+
+/* highest detail mip that is needed for projected size of the texture */
+INLINE uint rs_texstream_selectmip(const struct rs_texstream* s, float screen_size)
+{
+    return maxui(s->base_mip, gfx_texture_selectmip(s->width, s->height, s->mip_cnt, screen_size));
+}
+
+/* mip that texture should have now, textures that are not viewed recently fall back to the
+ * initial (smallest) mips */
+INLINE uint rs_texstream_targetmip(const struct rs_texstream* s)
+{
+    if (g_rs.frame - s->wanted_frame <= RS_TEXSTREAM_WANTED_FRAMES)
+        return rs_texstream_selectmip(s, s->screen_size);
+    else
+        return rs_texstream_selectmip(s, (float)RS_TEXSTREAM_INITSIZE);
+}
+
+/* estimated gpu memory of the texture if it's first mip was 'mip' (each mip is 1/4 of previous) */
+INLINE fl64 rs_texstream_calcbytes(const struct rs_resource* r, uint mip)
+{
+    uint resident_mip = r->texstream.resident_mip;
+    if (mip <= resident_mip)
+        return (fl64)r->bytes*(fl64)(1u << (2*(resident_mip - mip)));
+    else
+        return (fl64)r->bytes/(fl64)(1u << (2*(mip - resident_mip)));
+}
+
+/* lowers the detail of a mip request until the texture fits in texture budget */
+INLINE uint rs_texstream_fitbudget(const struct rs_resource* r, uint mip)
+{
+    size_t budget = g_rs.budgets[RS_RESOURCE_TEXTURE];
+    if (budget == 0)
+        return mip;
+
+    fl64 used = (fl64)(g_rs.used_bytes[RS_RESOURCE_TEXTURE] - r->bytes);
+    while (mip < r->texstream.resident_mip && used + rs_texstream_calcbytes(r, mip) > (fl64)budget)
+        mip ++;
+    return mip;
+}
+
+/* queues a reload of the texture that starts from 'first_mip', loaded texture replaces current one
+ * when it's ready (see rs_texstream_collect) */
+INLINE void rs_texstream_queue(struct rs_resource* r, uint first_mip, float priority)
+{
+    struct rs_load_data* ldata = (struct rs_load_data*)mem_pool_alloc(&g_rs.load_data_pool);
+    ASSERT(ldata);
+    memset(ldata, 0x00, sizeof(struct rs_load_data));
+
+    str_safecpy(ldata->filepath, sizeof(ldata->filepath), rs_resource_path(r));
+    ldata->hdl = r->hdl;
+    ldata->type = RS_RESOURCE_TEXTURE;
+    ldata->params.tex.first_mipidx = first_mip;
+    ldata->params.tex.srgb = r->texstream.srgb;
+    ldata->params.tex.stream = TRUE;
+    ldata->reload = TRUE;
+    rs_loaddata_bindpack(ldata);
+
+    r->texstream.pending_mip = first_mip;
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(priority), FALSE);
+}
+
 INLINE void rs_register_hotload(const struct rs_load_data* ldata)
 {
     switch (ldata->type)   {
@@ -263,7 +664,12 @@ result_t rs_initmgr(uint flags, uint load_thread_cnt)
     memset(&g_rs, 0x00, sizeof(g_rs));
     log_print(LOG_TEXT, "init res-mgr ...");
 
+    load_queue_init(&g_rs.load_queue);
+    tex_lru_init(&g_rs.texstream_lru, sizeof(struct rs_resource),
+        (uint)offsetof(struct rs_resource, texstream.lru));
+
     r = arr_create(mem_heap(), &g_rs.ress, sizeof(struct rs_resource), 128, 256, MID_RES);
+    r |= arr_create(mem_heap(), &g_rs.paths, sizeof(struct rs_path), 128, 256, MID_RES);
     r |= mem_pool_create(mem_heap(), &g_rs.freeslot_pool, sizeof(struct rs_freeslot_item),
         100, MID_RES);
     r |= mem_pool_create(mem_heap(), &g_rs.dict_itempool, sizeof(struct hashtable_item_chained),
@@ -271,24 +677,28 @@ result_t rs_initmgr(uint flags, uint load_thread_cnt)
     mem_pool_bindalloc(&g_rs.dict_itempool, &g_rs.dict_itemalloc);
     r |= hashtable_chained_create(mem_heap(), &g_rs.dict_itemalloc, &g_rs.dict, 65521, MID_RES);
     r |= mem_pool_create(mem_heap(), &g_rs.load_data_pool, sizeof(struct rs_load_data), 256, MID_RES);
+    r |= hashtable_chained_create(mem_heap(), &g_rs.dict_itemalloc, &g_rs.pack_srcs,
+        RS_PACKSRC_BUCKETS, MID_RES);
     if (IS_FAIL(r)) {
         err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
         return r;
     }
 
-    /* get maximum number of threads available for threaded loading */
+    /* get maximum number of threads available for threaded loading
+     * loader slot N is always dispatched to task thread N */
     if (BIT_CHECK(flags, RS_FLAG_PREPARE_BGLOAD))   {
-        g_rs.load_threads_max = maxui(load_thread_cnt, 1);
-        g_rs.job_params.load_items = (struct rs_load_data**)ALLOC(
-            sizeof(struct rs_load_data*)*load_thread_cnt, MID_RES);
-        g_rs.job_result.ptrs = (void**)ALLOC(sizeof(void*)*load_thread_cnt, MID_RES);
-        if (g_rs.job_params.load_items == NULL || g_rs.job_result.ptrs == NULL)    {
-            err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
-            return RET_OUTOFMEMORY;
-        }
+        g_rs.load_threads_max = minui(maxui(load_thread_cnt, 1), RS_LOAD_THREADS_MAX);
+        for (uint i = 0; i < g_rs.load_threads_max; i++)
+            g_rs.load_slots[i].thread_idx = (int)i;
+        log_printf(LOG_TEXT, "res-mgr: background loading with %d thread(s)", g_rs.load_threads_max);
     }
 
     g_rs.alloc = mem_heap();    /* default allocator is heap */
+    g_rs.bundle_rec = INVALID_INDEX;
+    for (uint i = 0; i < RS_RESOURCE_TYPE_CNT; i++)   {
+        g_rs.lru_first[i] = INVALID_INDEX;
+        g_rs.lru_last[i] = INVALID_INDEX;
+    }
     g_rs.flags = flags;
     g_rs.init = TRUE;
     return RET_OK;
@@ -303,29 +713,31 @@ result_t rs_init_resources()
         return RET_FAIL;
     }
 
+    con_register_cmd("rs_loadinfo", rs_console_loadinfo, NULL, "rs_loadinfo [1*/0]");
+    con_register_cmd("rs_budget", rs_console_budget, NULL, "rs_budget [type] [size(mb)]");
+    con_register_cmd("rs_uploadbudget", rs_console_uploadbudget, NULL,
+        "rs_uploadbudget [size(kb)] [objects]");
+    con_register_cmd("rs_savebundle", rs_console_savebundle, NULL,
+        "rs_savebundle [bundle-id] [filepath]");
+
     return RET_OK;
 }
 
 void rs_releasemgr()
 {
-    struct linked_list* unload_item = g_rs.unload_items;
-    while (unload_item != NULL) {
-        struct linked_list* nitem = unload_item->next;
-        FREE(unload_item->data);
-        unload_item = nitem;
+    for (uint i = 0; i < RS_BUNDLE_MAX; i++)   {
+        if (g_rs.bundles[i].id != 0)
+            arr_destroy(&g_rs.bundles[i].hdls);
     }
 
+    hashtable_chained_destroy(&g_rs.pack_srcs);
     hashtable_chained_destroy(&g_rs.dict);
     mem_pool_destroy(&g_rs.dict_itempool);
     mem_pool_destroy(&g_rs.freeslot_pool);
+    arr_destroy(&g_rs.paths);
     arr_destroy(&g_rs.ress);
     mem_pool_destroy(&g_rs.load_data_pool);
 
-    if (g_rs.job_params.load_items != NULL)
-        FREE(g_rs.job_params.load_items);
-    if (g_rs.job_result.ptrs != NULL)
-        FREE(g_rs.job_result.ptrs);
-
     log_print(LOG_TEXT, "res-mgr released.");
 }
 
@@ -333,74 +745,145 @@ void rs_release_resources()
 {
     gfx_delayed_release();
 
-    /* wait for load task to finish */
-    if (g_rs.load_jobid != 0)   {
-        tsk_wait(g_rs.load_jobid);
-        tsk_destroy(g_rs.load_jobid);
+    if (g_rs.load_debug)    {
+        hud_remove_label("rs-loadinfo");
+        g_rs.load_debug = FALSE;
+    }
+
+    /* unload cached resources, and from now on, unload everything immediately */
+    memset(g_rs.budgets, 0x00, sizeof(g_rs.budgets));
+    struct rs_resource* rss = (struct rs_resource*)g_rs.ress.buffer;
+    for (int i = 0; i < g_rs.ress.item_cnt; i++)   {
+        if (rss[i].hdl != INVALID_HANDLE && rss[i].cached)
+            rs_evict_cached(&rss[i]);
     }
 
-    /* unload everything in queued loads */
-    for (uint i = 0; i < g_rs.job_params.cnt; i++)    {
-        reshandle_t hdl = g_rs.job_params.load_items[i]->hdl;
-        void* ptr = g_rs.job_result.ptrs[i];
-        if (ptr != NULL)    {
-            struct rs_resource* r = rs_resource_get(hdl);
-            r->unload_func(ptr);
+    /* wait for load tasks to finish and unload everything that they have loaded */
+    for (uint i = 0; i < g_rs.load_threads_max; i++)  {
+        struct rs_load_slot* slot = &g_rs.load_slots[i];
+        if (slot->job_id == 0)
+            continue;
+
+        tsk_wait(slot->job_id);
+        tsk_destroy(slot->job_id);
+        if (slot->ptr != NULL)  {
+            struct rs_resource* r = rs_resource_get(slot->ldata->hdl);
+            r->unload_func(slot->ptr);
         }
+        rs_loaddata_free(slot->ldata);
+        slot->job_id = 0;
     }
 
+    /* drop queued requests, so the bundle files that they refer to are freed */
+    struct rs_load_data* ldata;
+    while ((ldata = rs_loadqueue_pop()) != NULL)
+        rs_loaddata_free(ldata);
+
     if (g_rs.blank_tex != NULL) {
         gfx_destroy_texture(g_rs.blank_tex);
         g_rs.blank_tex = NULL;
     }
 }
 
-/* Runs in task threads */
-void rs_threaded_load_fn(void* params, void* result, uint thread_id, uint job_id, int worker_idx)
+/* loose files are mapped and parsed in place, so they are not read into temp memory first
+ * files that can't be mapped (not on disk) are loaded through file-io */
+static gfx_texture rs_texture_loadfile(const char* filepath, uint first_mipidx, uint size_max,
+    int srgb, uint thread_id, OUT OPTIONAL uint* mip_cnt)
 {
-    struct rs_load_job_params* lparams = (struct rs_load_job_params*)params;
-    struct rs_load_job_result* lresult = (struct rs_load_job_result*)result;
+    struct file_map m;
+    if (!fmap_open(&m, filepath))
+        return gfx_texture_loaddds_mips(filepath, first_mipidx, size_max, srgb, thread_id, mip_cnt);
+
+    gfx_texture tex = gfx_texture_loaddds_mem(filepath, m.data, m.size, first_mipidx, size_max,
+        srgb, thread_id, mip_cnt);
+    fmap_close(&m);
+    return tex;
+}
 
-    if (worker_idx >= (int)lparams->cnt)
-        return;
+static struct gfx_model* rs_model_loadfile(const char* filepath, uint thread_id)
+{
+    struct file_map m;
+    if (!fmap_open(&m, filepath))
+        return gfx_model_load(g_rs.alloc, filepath, thread_id);
 
-    util_sleep(100);
+    struct gfx_model* model = gfx_model_loadmem(g_rs.alloc, filepath, m.data, m.size, thread_id);
+    fmap_close(&m);
+    return model;
+}
+
+/* Runs in task threads */
+void rs_threaded_load_fn(void* params, void* result, uint thread_id, uint job_id, int worker_idx)
+{
+    struct rs_load_slot* slot = (struct rs_load_slot*)params;
+    uint64 start_tick = timer_querytick();
 
     void* ptr = NULL;
-    struct rs_load_data* ldata = lparams->load_items[worker_idx];
+    struct rs_load_data* ldata = slot->ldata;
     switch (ldata->type)    {
     case RS_RESOURCE_TEXTURE:
-        ptr = gfx_texture_loaddds(ldata->filepath, ldata->params.tex.first_mipidx,
-            ldata->params.tex.srgb, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = gfx_texture_loaddds_mem(ldata->filepath, ldata->pack_src->data,
+                ldata->pack_src->size, ldata->params.tex.first_mipidx, ldata->params.tex.size_max,
+                ldata->params.tex.srgb, thread_id, &ldata->params.tex.mip_cnt);
+        }   else    {
+            ptr = rs_texture_loadfile(ldata->filepath, ldata->params.tex.first_mipidx,
+                ldata->params.tex.size_max, ldata->params.tex.srgb, thread_id,
+                &ldata->params.tex.mip_cnt);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(texture) \"%s\" - id: %d", ldata->filepath, GET_ID(ldata->hdl));
         break;
     case RS_RESOURCE_MODEL:
-        ptr = gfx_model_load(g_rs.alloc, ldata->filepath, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = gfx_model_loadmem(g_rs.alloc, ldata->filepath, ldata->pack_src->data,
+                ldata->pack_src->size, thread_id);
+        }   else    {
+            ptr = rs_model_loadfile(ldata->filepath, thread_id);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(model) \"%s\" - id: %d", ldata->filepath, GET_ID(ldata->hdl));
         break;
 
     case RS_RESOURCE_ANIMREEL:
-        ptr = anim_load(g_rs.alloc, ldata->filepath, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = anim_loadmem(g_rs.alloc, ldata->filepath, ldata->pack_src->data,
+                ldata->pack_src->size, thread_id);
+        }   else    {
+            ptr = anim_load(g_rs.alloc, ldata->filepath, thread_id);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(anim-reel) \"%s\" - id:%d", ldata->filepath, GET_ID(ldata->hdl));
         break;
 
     case RS_RESOURCE_PHXPREFAB:
-        ptr = phx_prefab_load(ldata->filepath, g_rs.alloc, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = phx_prefab_loadmem(ldata->filepath, ldata->pack_src->data,
+                ldata->pack_src->size, g_rs.alloc, thread_id);
+        }   else    {
+            ptr = phx_prefab_load(ldata->filepath, g_rs.alloc, thread_id);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(physics) \"%s\" - id: %d", ldata->filepath, GET_ID(ldata->hdl));
         break;
 
     case RS_RESOURCE_SCRIPT:
-        ptr = sct_load(ldata->filepath, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = sct_loadmem(ldata->filepath, ldata->pack_src->data, ldata->pack_src->size,
+                thread_id);
+        }   else    {
+            ptr = sct_load(ldata->filepath, thread_id);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(script) \"%s\" - id: %d", ldata->filepath, GET_ID(ldata->hdl));
         break;
 
     case RS_RESOURCE_ANIMCTRL:
-        ptr = anim_ctrl_load(g_rs.alloc, ldata->filepath, thread_id);
+        if (ldata->pack_src != NULL)    {
+            ptr = anim_ctrl_loadmem(g_rs.alloc, ldata->filepath, ldata->pack_src->data,
+                ldata->pack_src->size, thread_id);
+        }   else    {
+            ptr = anim_ctrl_load(g_rs.alloc, ldata->filepath, thread_id);
+        }
         if (ptr != NULL)
             log_printf(LOG_LOAD, "(anim-ctrl) \"%s\" - id: %d", ldata->filepath, GET_ID(ldata->hdl));
         break;
@@ -414,103 +897,195 @@ void rs_threaded_load_fn(void* params, void* result, uint thread_id, uint job_id
         err_clear();
     }
 
-    lresult->ptrs[worker_idx] = ptr;
+    slot->ptr = ptr;
+    slot->load_tm = timer_calctm(start_tick, timer_querytick());
 }
 
-/* Runs in main thread, syncs resources */
+/* Runs in main thread, syncs resources
+ * Finished loads are collected without waiting for the others, and their slots are refilled from
+ * the load queue in the same update, so loader threads are kept busy as long as there is work */
 void rs_update()
 {
-    uint job_id = g_rs.load_jobid;
-    if (job_id != 0)    {
-        if (!tsk_check_finished(job_id))    {
-            gfx_delayed_createobjects();
-            return;
-        }   else    {
-            gfx_delayed_finalizeobjects();
-        }
+    uint slot_cnt = g_rs.load_threads_max;
+    int finished[RS_LOAD_THREADS_MAX];
+    uint busy_cnt = 0;
+
+    /* take the finished jobs before finalizing gpu objects, jobs that are finished after this point
+     * may still have unfinalized objects, so they will be collected on next update */
+    for (uint i = 0; i < slot_cnt; i++)   {
+        uint job_id = g_rs.load_slots[i].job_id;
+        finished[i] = (job_id != 0) ? tsk_check_finished(job_id) : FALSE;
+        busy_cnt += (job_id != 0) ? 1 : 0;
     }
 
-    struct rs_load_job_params* params = &g_rs.job_params;
-    struct rs_load_job_result* result = &g_rs.job_result;
+    if (busy_cnt > 0)   {
+        gfx_delayed_createobjects();
 
-    /* if we already have a job_id, it means that the job is finished
-     * update the database and destroy the task */
-    if (job_id != 0)    {
-        struct rs_load_job_params* params = (struct rs_load_job_params*)tsk_get_params(job_id);
-        struct rs_load_job_result* result = (struct rs_load_job_result*)tsk_get_result(job_id);
+        /* finalize may fail to acquire objects, leave the results for next update */
+        if (gfx_delayed_finalizeobjects())  {
+            for (uint i = 0; i < slot_cnt; i++)   {
+                if (finished[i])    {
+                    rs_collect_load(&g_rs.load_slots[i]);
+                    busy_cnt --;
+                }
+            }
+        }
+    }
 
-        for (uint i = 0; i < params->cnt; i++)    {
-            struct rs_load_data* ldata = params->load_items[i];
-            reshandle_t hdl = ldata->hdl;
+    /* fill idle slots with queued loads and dispatch them (exclusive to the slot's thread) */
+    for (uint i = 0; i < slot_cnt; i++)    {
+        struct rs_load_slot* slot = &g_rs.load_slots[i];
+        if (slot->job_id != 0)
+            continue;
+
+        struct rs_load_data* ldata = rs_loadqueue_pop();
+        if (ldata == NULL)
+            break;
+
+        slot->ldata = ldata;
+        slot->cancelled = FALSE;
+        slot->ptr = NULL;
+        slot->load_tm = 0.0;
+        slot->job_id = tsk_dispatch_exclusive(rs_threaded_load_fn, &slot->thread_idx, 1, slot, slot);
+        if (slot->job_id == 0)  {
+            /* could not dispatch, put it back and try again on next update */
+            rs_loadqueue_push(ldata, ldata->qitem.bucket, TRUE);
+            slot->ldata = NULL;
+            break;
+        }
+        busy_cnt ++;
+    }
 
-            /* check the handle in unload list and unload immediately */
-            int must_unload = rs_search_in_unloads(hdl);
+    /* evict least recently used cached resources from categories that exceed their budget */
+    g_rs.frame ++;
+    rs_evict_overbudget();
+
+    /* track the time that loader threads were busy, for throughput stats */
+    struct rs_load_stats* stats = &g_rs.load_stats;
+    if (busy_cnt > 0 && stats->busy_tick == 0)    {
+        stats->busy_tick = timer_querytick();
+    }   else if (busy_cnt == 0 && stats->busy_tick != 0)  {
+        stats->busy_tm += timer_calctm(stats->busy_tick, timer_querytick());
+        stats->busy_tick = 0;
+    }
+}
 
-            struct rs_resource* r = rs_resource_get(hdl);
-            if (result->ptrs[i] != NULL)    {
-                r->ptr = result->ptrs[i];
+/* update the database with the result of finished load job, and destroy the task */
+void rs_collect_load(struct rs_load_slot* slot)
+{
+    struct rs_load_data* ldata = slot->ldata;
+    reshandle_t hdl = ldata->hdl;
 
-                if (!must_unload)    {
-                    /* register hot-loading */
-                    if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !ldata->reload)
-                        rs_register_hotload(ldata);
+    /* resource is unloaded while loading (and not requested again), unload immediately */
+    struct rs_resource* r = rs_resource_get(hdl);
+    int must_unload = slot->cancelled && r->ref_cnt == 0;
+    if (ldata->type == RS_RESOURCE_TEXTURE)
+        rs_texstream_collect(r, ldata, (gfx_texture)slot->ptr);
 
-                    /* apply reload funcs */
-                    rs_resource_manualreload(ldata);
-                }   else    {
-                    rs_remove_fromdb(hdl);
-                }
-            }   else if (must_unload)   {
-                rs_remove_fromdb(hdl);
-            }
+    if (slot->ptr != NULL)    {
+        rs_resource_setptr(r, slot->ptr);
 
-            mem_pool_free(&g_rs.load_data_pool, params->load_items[i]);
-        }
+        if (!must_unload)    {
+            /* register hot-loading */
+            if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !ldata->reload)
+                rs_register_hotload(ldata);
 
-        /* cleanup */
-        tsk_destroy(job_id);
-    }
-
-    /* fill new params and dispatch the job */
-    struct linked_list* lnode = g_rs.load_list;
-    uint qcnt = 0;
-    while (qcnt < g_rs.load_threads_max && lnode != NULL)    {
-        params->load_items[qcnt++] = (struct rs_load_data*)lnode->data;
-        list_remove(&g_rs.load_list, lnode);
-        lnode = g_rs.load_list;
-    }
-    params->cnt = qcnt;
-
-    /* dispatch to first thread only (exclusive mode) */
-    if (qcnt > 0)   {
-        int thread_cnt = (int)g_rs.load_threads_max;
-        struct allocator* tmp_alloc = tsk_get_tmpalloc(0);
-        int* thread_idxs = (int*)A_ALLOC(tmp_alloc, sizeof(uint)*thread_cnt, MID_RES);
-        ASSERT(thread_idxs);
-        for (int i = 0; i < thread_cnt; i++)
-            thread_idxs[i] = i;
-        g_rs.load_jobid = tsk_dispatch_exclusive(rs_threaded_load_fn, thread_idxs, thread_cnt,
-            params, result);
-        A_FREE(tmp_alloc, thread_idxs);
+            /* apply reload funcs */
+            rs_resource_manualreload(ldata);
+        }   else    {
+            rs_remove_fromdb(hdl);
+        }
+        r->failed = FALSE;
+        g_rs.load_stats.loaded_cnt ++;
     }   else    {
-        g_rs.load_jobid = 0;
+        if (must_unload)
+            rs_remove_fromdb(hdl);
+        else if (!rs_resource_isloaded(r))
+            r->failed = TRUE;
+        g_rs.load_stats.failed_cnt ++;
     }
+    g_rs.load_stats.load_tm += slot->load_tm;
+
+    /* models of a bundle file already have their textures (pre-resolved in rs_load_bundle) */
+    int fanout = (ldata->type == RS_RESOURCE_MODEL && slot->ptr != NULL && !must_unload &&
+        (r->deps == NULL || ldata->reload));
+    uint bucket = ldata->qitem.bucket;
+
+    rs_loaddata_free(ldata);
+    tsk_destroy(slot->job_id);
+    slot->job_id = 0;
+    slot->ldata = NULL;
+    slot->ptr = NULL;
+    slot->cancelled = FALSE;
+
+    /* queue dependencies right away, so idle loader slots pick them up in this same update */
+    if (fanout)
+        rs_model_loaddeps(hdl, bucket);
 }
 
-int rs_search_in_unloads(reshandle_t hdl)
+/* requests textures of a loaded model as separate loads and keeps references to them, they are
+ * queued with the model's priority. on reload, previous dependencies are released afterwards, so
+ * shared textures are not unloaded and loaded again */
+void rs_model_loaddeps(reshandle_t hdl, uint bucket)
 {
-    struct linked_list* unode = g_rs.unload_items;
-    while (unode != NULL)   {
-        struct linked_list* n_unode = unode->next;
-        struct rs_unload_item* uitem = (struct rs_unload_item*)unode->data;
-        if (uitem->hdl == hdl)  {
-            list_remove(&g_rs.unload_items, unode);
-            FREE(uitem);
-            return TRUE;
+    struct rs_resource* r = rs_resource_get(hdl);
+    const struct gfx_model* model = (const struct gfx_model*)r->ptr;
+
+    uint map_cnt = 0;
+    for (uint i = 0; i < model->mtl_cnt; i++)
+        map_cnt += model->mtls[i].map_cnt;
+
+    reshandle_t* deps = NULL;
+    uint dep_cnt = 0;
+    if (map_cnt > 0)    {
+        deps = (reshandle_t*)A_ALLOC(mem_heap(), sizeof(reshandle_t)*map_cnt, MID_RES);
+        if (deps == NULL)
+            return;
+    }
+
+    /* dependencies are owned by the model and not recorded in bundles, rs_bundle_isready checks
+     * them through the model */
+    uint bundle_rec = g_rs.bundle_rec;
+    g_rs.bundle_rec = INVALID_INDEX;
+
+    /* note: loads can grow the database, so 'r' is fetched again after this */
+    for (uint i = 0; i < model->mtl_cnt; i++)  {
+        const struct gfx_model_mtl* mtl = &model->mtls[i];
+        for (uint k = 0; k < mtl->map_cnt; k++)    {
+            const struct gfx_model_map* map = &mtl->maps[k];
+            reshandle_t tex_hdl = rs_addref_byid(map->path_id, RS_RESOURCE_TEXTURE);
+            if (tex_hdl == INVALID_HANDLE)  {
+                tex_hdl = rs_load_texture(map->filepath, 0, gfx_model_map_issrgb(map->type),
+                    RS_LOAD_STREAMMIPS);
+            }
+            if (tex_hdl == INVALID_HANDLE)
+                continue;
+
+            struct rs_load_data* tex_ldata = rs_loadqueue_search(tex_hdl);
+            if (tex_ldata != NULL && tex_ldata->qitem.bucket > bucket)   {
+                rs_loadqueue_remove(tex_ldata);
+                rs_loadqueue_push(tex_ldata, bucket, FALSE);
+            }
+            deps[dep_cnt++] = tex_hdl;
         }
-        unode = n_unode;
     }
-    return FALSE;
+    g_rs.bundle_rec = bundle_rec;
+
+    r = rs_resource_get(hdl);
+    reshandle_t* prev_deps = r->deps;
+    uint prev_cnt = r->dep_cnt;
+    r->deps = deps;
+    r->dep_cnt = dep_cnt;
+    rs_release_deps(prev_deps, prev_cnt);
+}
+
+void rs_release_deps(reshandle_t* deps, uint dep_cnt)
+{
+    if (deps == NULL)
+        return;
+    for (uint i = 0; i < dep_cnt; i++)
+        rs_unload(deps[i]);
+    A_FREE(mem_heap(), deps);
 }
 
 void rs_texture_reload(const char* filepath, uint64 hdl, uptr_t param1, uptr_t param2)
@@ -564,40 +1139,41 @@ reshandle_t rs_load_texture(const char* tex_filepath, uint first_mipidx,
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(tex_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(tex_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
         if (BIT_CHECK(g_rs.flags, RS_FLAG_BGLOADING))   {
-            res_hdl = rs_texture_queueload(tex_filepath, first_mipidx, srgb, res_hdl);
+            res_hdl = rs_texture_queueload(tex_filepath, first_mipidx, 0, srgb, res_hdl);
         }   else    {
             override_hdl =  res_hdl;
             res_hdl = INVALID_HANDLE;
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
     if (res_hdl == INVALID_HANDLE)  {
         if(BIT_CHECK(g_rs.flags, RS_FLAG_BGLOADING))  {
-            res_hdl = rs_texture_queueload(tex_filepath, first_mipidx, srgb, INVALID_HANDLE);
+            res_hdl = rs_texture_queueload(tex_filepath, first_mipidx,
+                BIT_CHECK(flags, RS_LOAD_STREAMMIPS) ? RS_TEXSTREAM_INITSIZE : 0, srgb,
+                INVALID_HANDLE);
         }   else    {
         	/* determine file extension, then load the texture based on that */
         	char ext[128];
         	path_getfileext(ext, tex_filepath);
         	gfx_texture tex = NULL;
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(tex_filepath));
 
-        	if (str_isequal_nocase(ext, "dds"))
-        		tex  = gfx_texture_loaddds(tex_filepath, first_mipidx, srgb, 0);
+            if (src != NULL)    {
+                tex = gfx_texture_loaddds_mem(tex_filepath, src->data, src->size, first_mipidx,
+                    0, srgb, 0, NULL);
+            }   else if (str_isequal_nocase(ext, "dds"))    {
+                tex = rs_texture_loadfile(tex_filepath, first_mipidx, 0, srgb, 0, NULL);
+            }
 
             if (tex == NULL) {
                 log_printf(LOG_WARNING, "res-mgr: loading rs_resource '%s' failed:"
@@ -608,7 +1184,10 @@ reshandle_t rs_load_texture(const char* tex_filepath, uint first_mipidx,
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(tex_filepath, tex, override_hdl, rs_texture_unload);
+            res_hdl = rs_add_resource(tex_filepath, RS_RESOURCE_TEXTURE, tex, override_hdl,
+                rs_texture_unload);
+            if (res_hdl != INVALID_HANDLE)
+                rs_resource_get(res_hdl)->texstream.srgb = srgb;
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))   {
@@ -620,17 +1199,19 @@ reshandle_t rs_load_texture(const char* tex_filepath, uint first_mipidx,
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
-reshandle_t rs_texture_queueload(const char* tex_filepath, uint first_mipidx, int srgb,
-                                 reshandle_t override_hdl)
+reshandle_t rs_texture_queueload(const char* tex_filepath, uint first_mipidx, uint size_max,
+                                 int srgb, reshandle_t override_hdl)
 {
     /* if we have an override handle, check in existing queue and see if it's already exists */
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(tex_filepath, g_rs.blank_tex, override_hdl, rs_texture_unload);
+    reshandle_t hdl = rs_add_resource(tex_filepath, RS_RESOURCE_TEXTURE, g_rs.blank_tex, override_hdl,
+        rs_texture_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -643,10 +1224,13 @@ reshandle_t rs_texture_queueload(const char* tex_filepath, uint first_mipidx, in
     ldata->type = RS_RESOURCE_TEXTURE;
     ldata->params.tex.first_mipidx = first_mipidx;
     ldata->params.tex.srgb = srgb;
+    ldata->params.tex.size_max = size_max;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
+    rs_resource_get(hdl)->texstream.srgb = srgb;
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -659,8 +1243,8 @@ void rs_texture_unload(void* tex)
         gfx_destroy_texture((gfx_texture)tex);
 }
 
-reshandle_t rs_add_resource(const char* filepath, void* ptr, reshandle_t override_hdl,
-    pfn_unload_res unload_func)
+reshandle_t rs_add_resource(const char* filepath, enum rs_resource_type type, void* ptr,
+    reshandle_t override_hdl, pfn_unload_res unload_func)
 {
     reshandle_t res_hdl = override_hdl;
 
@@ -673,29 +1257,32 @@ reshandle_t rs_add_resource(const char* filepath, void* ptr, reshandle_t overrid
         if (rs->hdl != INVALID_HANDLE)
             rs->unload_func(rs->ptr);
 
-        rs->ptr = ptr;
+        rs_resource_setptr(rs, ptr);
         rs->hdl = res_hdl;
         rs->unload_func = unload_func;
-        ASSERT(str_isequal(rs->filepath, filepath));
+        ASSERT(rs->path_id == hash_str(filepath));
     }   else    {
         /* just add it to rs_resource database */
-        res_hdl = rs_add_todb(filepath, ptr, unload_func);
+        res_hdl = rs_add_todb(filepath, type, ptr, unload_func);
         if (res_hdl == INVALID_HANDLE)
             return INVALID_HANDLE;
 
-        hashtable_chained_add(&g_rs.dict, hash_str(filepath), GET_INDEX(res_hdl));
+        hashtable_chained_add(&g_rs.dict, rs_resource_get(res_hdl)->path_id,
+            GET_INDEX(res_hdl));
     }
 
     return res_hdl;
 }
 
-reshandle_t rs_add_todb(const char* filepath, void* ptr, pfn_unload_res unload_func)
+reshandle_t rs_add_todb(const char* filepath, enum rs_resource_type type, void* ptr,
+                        pfn_unload_res unload_func)
 {
     static uint global_id = 0;
     global_id ++;
 
     reshandle_t res_hdl;
     struct rs_resource* rs;
+    struct rs_path* path;
 
     /* if we have freeslots in free-stack, pop it and re-update it */
     struct stack* sitem = stack_pop(&g_rs.freeslots);
@@ -703,18 +1290,33 @@ reshandle_t rs_add_todb(const char* filepath, void* ptr, pfn_unload_res unload_f
         uptr_t idx = (uptr_t)sitem->data;
         res_hdl = MAKE_HANDLE(idx, global_id);
         rs = &((struct rs_resource*)g_rs.ress.buffer)[idx];
+        path = &((struct rs_path*)g_rs.paths.buffer)[idx];
     }   else    {
         res_hdl = MAKE_HANDLE(g_rs.ress.item_cnt, global_id);
         rs = (struct rs_resource*)arr_add(&g_rs.ress);
-        ASSERT(rs);
+        path = (struct rs_path*)arr_add(&g_rs.paths);
+        ASSERT(rs && path);
     }
 
     rs->hdl = res_hdl;
-    rs->ptr = ptr;
+    rs->type = type;
+    rs->bytes = 0;
+    rs->cached = FALSE;
+    rs_resource_setptr(rs, ptr);
     rs->ref_cnt = 1;
     rs->unload_func = unload_func;
+    rs->ldata = NULL;
+    rs->lru_prev = INVALID_INDEX;
+    rs->lru_next = INVALID_INDEX;
+    rs->failed = FALSE;
+    rs->deps = NULL;
+    rs->dep_cnt = 0;
+    rs->used_frame = g_rs.frame;
+    memset(&rs->texstream, 0x00, sizeof(rs->texstream));
+    rs->texstream.pending_mip = INVALID_INDEX;
     ASSERT(strlen(filepath) < 128);
-    str_safecpy(rs->filepath, sizeof(rs->filepath), filepath);
+    rs->path_id = hash_str(filepath);
+    str_safecpy(path->filepath, sizeof(path->filepath), filepath);
 
     return res_hdl;
 }
@@ -735,30 +1337,40 @@ void rs_unload(reshandle_t hdl)
     /* decr reference count, and see if have to release it */
     rs->ref_cnt --;
     if (rs->ref_cnt == 0)   {
-        /* check in pending threaded loads
-         * If exists, it means that there is a loading job queued inside thread that
-         * needs to be unloaded after it's done (see rs_update) */
-        for (uint i = 0, cnt = g_rs.job_params.cnt; i < cnt; i++) {
-            if (g_rs.job_params.load_items[i]->hdl == hdl)  {
-                struct rs_unload_item* uitem = (struct rs_unload_item*)ALLOC(
-                    sizeof(struct rs_unload_item), MID_RES);
-                ASSERT(uitem);
-                uitem->hdl = hdl;
-                list_add(&g_rs.unload_items, &uitem->lnode, uitem);
-                return;
-            }
+        /* keep loaded resource in memory while it's category is within budget, so it can be reused
+         * without loading again. least recently used ones are evicted in rs_update */
+        rs->used_frame = g_rs.frame;
+        if (g_rs.budgets[rs->type] != 0 && g_rs.used_bytes[rs->type] <= g_rs.budgets[rs->type] &&
+            rs->ptr != NULL && rs->ldata == NULL && rs_loadslot_find(hdl) == NULL)
+        {
+            rs_cache_add(rs);
+            return;
+        }
+
+        /* cancel queued load request immediately */
+        struct rs_load_data* ldata = rs_loadqueue_search(hdl);
+        if (ldata != NULL)  {
+            rs_loadqueue_remove(ldata);
+            rs_loaddata_free(ldata);
         }
 
-        /* also search in queued loads and remove from list immediately */
-        struct linked_list* lnode = rs_loadqueue_search(hdl);
-        if (lnode != NULL)  {
-            list_remove(&g_rs.load_list, lnode);
-            mem_pool_free(&g_rs.load_data_pool, lnode->data);
+        /* check in pending threaded loads
+         * If exists, it means that there is a loading job working inside thread that
+         * needs to be unloaded after it's done (see rs_collect_load) */
+        int loading = FALSE;
+        for (uint i = 0; i < g_rs.load_threads_max; i++) {
+            struct rs_load_slot* slot = &g_rs.load_slots[i];
+            if (slot->job_id != 0 && slot->ldata->hdl == hdl)  {
+                slot->cancelled = TRUE;
+                loading = TRUE;
+            }
         }
+        if (loading)
+            return;
 
         /* remove from hot-loading list */
         if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING))
-            fio_mon_unreg(rs->filepath);
+            fio_mon_unreg(rs_resource_path(rs));
 
         rs_remove_fromdb(hdl);
     }
@@ -773,16 +1385,27 @@ void rs_remove_fromdb(reshandle_t hdl)
     struct rs_resource* rs = &((struct rs_resource*)g_rs.ress.buffer)[idx];
     ASSERT(rs->hdl != INVALID_HANDLE);
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(rs->filepath));
+    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict, rs->path_id);
     ASSERT(item);
     hashtable_chained_remove(&g_rs.dict, item);
 
     /* add item to free slots */
     stack_push(&g_rs.freeslots, &rs->node, (void*)idx);
 
+    rs_cache_remove(rs);
+    if (rs->texstream.mip_cnt != 0)
+        tex_lru_remove(&g_rs.texstream_lru, g_rs.ress.buffer, (uint)idx);
+
     rs->unload_func(rs->ptr);
+    rs_resource_setptr(rs, NULL);
     rs->hdl = INVALID_HANDLE;
+
+    /* release dependencies last, unloading them doesn't grow the database, so 'rs' stays valid */
+    reshandle_t* deps = rs->deps;
+    uint dep_cnt = rs->dep_cnt;
+    rs->deps = NULL;
+    rs->dep_cnt = 0;
+    rs_release_deps(deps, dep_cnt);
 }
 
 reshandle_t rs_load_model(const char* model_filepath, uint flags)
@@ -793,13 +1416,8 @@ reshandle_t rs_load_model(const char* model_filepath, uint flags)
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(model_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(model_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
@@ -811,8 +1429,7 @@ reshandle_t rs_load_model(const char* model_filepath, uint flags)
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
@@ -825,9 +1442,13 @@ reshandle_t rs_load_model(const char* model_filepath, uint flags)
         	path_getfileext(ext, model_filepath);
         	struct gfx_model* model = NULL;
 
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(model_filepath));
+
         	/* model files should be 'h3dm' extension */
-        	if (str_isequal_nocase(ext, "h3dm"))
-        		model = gfx_model_load(g_rs.alloc, model_filepath, 0);
+            if (src != NULL)
+                model = gfx_model_loadmem(g_rs.alloc, model_filepath, src->data, src->size, 0);
+        	else if (str_isequal_nocase(ext, "h3dm"))
+        		model = rs_model_loadfile(model_filepath, 0);
 
             if (model == NULL) {
                 log_printf(LOG_WARNING, "res-mgr: loading resource '%s' failed:"
@@ -838,16 +1459,21 @@ reshandle_t rs_load_model(const char* model_filepath, uint flags)
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(model_filepath, model, override_hdl, rs_model_unload);
+            res_hdl = rs_add_resource(model_filepath, RS_RESOURCE_MODEL, model, override_hdl,
+                rs_model_unload);
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))
                 fio_mon_reg(model_filepath, rs_model_reload, res_hdl, 0, 0);
 
             log_printf(LOG_LOAD, "(model) \"%s\" - id: %d", model_filepath, GET_ID(res_hdl));
+
+            if (res_hdl != INVALID_HANDLE)
+                rs_model_loaddeps(res_hdl, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT));
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
@@ -856,7 +1482,8 @@ reshandle_t rs_model_queueload(const char* model_filepath, reshandle_t override_
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(model_filepath, NULL, override_hdl, rs_model_unload);
+    reshandle_t hdl = rs_add_resource(model_filepath, RS_RESOURCE_MODEL, NULL, override_hdl,
+        rs_model_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -868,9 +1495,10 @@ reshandle_t rs_model_queueload(const char* model_filepath, reshandle_t override_
     ldata->hdl = hdl;
     ldata->type = RS_RESOURCE_MODEL;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -890,13 +1518,8 @@ reshandle_t rs_load_animreel(const char* reel_filepath, uint flags)
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(reel_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(reel_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
@@ -908,8 +1531,7 @@ reshandle_t rs_load_animreel(const char* reel_filepath, uint flags)
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
@@ -922,8 +1544,12 @@ reshandle_t rs_load_animreel(const char* reel_filepath, uint flags)
             path_getfileext(ext, reel_filepath);
             anim_reel reel = NULL;
 
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(reel_filepath));
+
             /* model files should be valid extension */
-            if (str_isequal_nocase(ext, "h3da"))
+            if (src != NULL)
+                reel = anim_loadmem(g_rs.alloc, reel_filepath, src->data, src->size, 0);
+            else if (str_isequal_nocase(ext, "h3da"))
                 reel = anim_load(g_rs.alloc, reel_filepath, 0);
 
             if (reel == NULL) {
@@ -935,7 +1561,8 @@ reshandle_t rs_load_animreel(const char* reel_filepath, uint flags)
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(reel_filepath, reel, override_hdl, rs_animreel_unload);
+            res_hdl = rs_add_resource(reel_filepath, RS_RESOURCE_ANIMREEL, reel, override_hdl,
+                rs_animreel_unload);
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))
@@ -945,6 +1572,7 @@ reshandle_t rs_load_animreel(const char* reel_filepath, uint flags)
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
@@ -953,7 +1581,8 @@ reshandle_t rs_animreel_queueload(const char* reel_filepath, reshandle_t overrid
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(reel_filepath, NULL, override_hdl, rs_animreel_unload);
+    reshandle_t hdl = rs_add_resource(reel_filepath, RS_RESOURCE_ANIMREEL, NULL, override_hdl,
+        rs_animreel_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -965,9 +1594,10 @@ reshandle_t rs_animreel_queueload(const char* reel_filepath, reshandle_t overrid
     ldata->hdl = hdl;
     ldata->type = RS_RESOURCE_ANIMREEL;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -986,13 +1616,8 @@ reshandle_t rs_load_animctrl(const char* ctrl_filepath, uint flags)
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(ctrl_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(ctrl_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
@@ -1004,8 +1629,7 @@ reshandle_t rs_load_animctrl(const char* ctrl_filepath, uint flags)
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
@@ -1018,9 +1642,15 @@ reshandle_t rs_load_animctrl(const char* ctrl_filepath, uint flags)
             path_getfileext(ext, ctrl_filepath);
             anim_ctrl ctrl = NULL;
 
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(ctrl_filepath));
+
             /* model files should be valid extension */
-            if (str_isequal_nocase(ext, "json"))
+            if (src != NULL)    {
+                ctrl = anim_ctrl_loadmem((struct allocator*)g_rs.alloc, ctrl_filepath, src->data,
+                    src->size, 0);
+            }   else if (str_isequal_nocase(ext, "json") || str_isequal_nocase(ext, "h3dc"))  {
                 ctrl = anim_ctrl_load((struct allocator*)g_rs.alloc, ctrl_filepath, 0);
+            }
 
             if (ctrl == NULL) {
                 log_printf(LOG_WARNING, "res-mgr: loading rs_resource '%s' failed:"
@@ -1031,7 +1661,8 @@ reshandle_t rs_load_animctrl(const char* ctrl_filepath, uint flags)
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(ctrl_filepath, ctrl, override_hdl, rs_animctrl_unload);
+            res_hdl = rs_add_resource(ctrl_filepath, RS_RESOURCE_ANIMCTRL, ctrl, override_hdl,
+                rs_animctrl_unload);
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))
@@ -1041,6 +1672,7 @@ reshandle_t rs_load_animctrl(const char* ctrl_filepath, uint flags)
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
@@ -1050,7 +1682,8 @@ reshandle_t rs_animctrl_queueload(const char* ctrl_filepath, reshandle_t overrid
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(ctrl_filepath, NULL, override_hdl, rs_animctrl_unload);
+    reshandle_t hdl = rs_add_resource(ctrl_filepath, RS_RESOURCE_ANIMCTRL, NULL, override_hdl,
+        rs_animctrl_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -1062,9 +1695,10 @@ reshandle_t rs_animctrl_queueload(const char* ctrl_filepath, reshandle_t overrid
     ldata->hdl = hdl;
     ldata->type = RS_RESOURCE_ANIMCTRL;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -1083,13 +1717,8 @@ reshandle_t rs_load_script(const char* lua_filepath, uint flags)
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(lua_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(lua_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
@@ -1101,8 +1730,7 @@ reshandle_t rs_load_script(const char* lua_filepath, uint flags)
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
@@ -1115,8 +1743,12 @@ reshandle_t rs_load_script(const char* lua_filepath, uint flags)
             path_getfileext(ext, lua_filepath);
             sct_t script = NULL;
 
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(lua_filepath));
+
             /* model files should be valid extension */
-            if (str_isequal_nocase(ext, "lua"))
+            if (src != NULL)
+                script = sct_loadmem(lua_filepath, src->data, src->size, 0);
+            else if (str_isequal_nocase(ext, "lua"))
                 script = sct_load(lua_filepath, 0);
 
             if (script == NULL) {
@@ -1128,7 +1760,8 @@ reshandle_t rs_load_script(const char* lua_filepath, uint flags)
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(lua_filepath, script, override_hdl, rs_script_unload);
+            res_hdl = rs_add_resource(lua_filepath, RS_RESOURCE_SCRIPT, script, override_hdl,
+                rs_script_unload);
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))
@@ -1138,6 +1771,7 @@ reshandle_t rs_load_script(const char* lua_filepath, uint flags)
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
@@ -1147,7 +1781,8 @@ reshandle_t rs_script_queueload(const char* lua_filepath, reshandle_t override_h
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(lua_filepath, NULL, override_hdl, rs_script_unload);
+    reshandle_t hdl = rs_add_resource(lua_filepath, RS_RESOURCE_SCRIPT, NULL, override_hdl,
+        rs_script_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -1159,9 +1794,10 @@ reshandle_t rs_script_queueload(const char* lua_filepath, reshandle_t override_h
     ldata->hdl = hdl;
     ldata->type = RS_RESOURCE_SCRIPT;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -1180,13 +1816,8 @@ reshandle_t rs_load_phxprefab(const char* phx_filepath, uint flags)
     if (!g_rs.init)
         return INVALID_HANDLE;
 
-    struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.dict,
-        hash_str(phx_filepath));
-    if (item != NULL)   {
-        uint idx = (uint)item->value;
-        struct rs_resource* res = (struct rs_resource*)g_rs.ress.buffer + idx;
-        res_hdl = res->hdl;
-    }
+    if (IS_FAIL(rs_find_bypath(phx_filepath, &res_hdl)))
+        return INVALID_HANDLE;
 
     if (res_hdl != INVALID_HANDLE && BIT_CHECK(flags, RS_LOAD_REFRESH))    {
         /* rs_resource already loaded, but refresh flag is set, so we reload it */
@@ -1198,8 +1829,7 @@ reshandle_t rs_load_phxprefab(const char* phx_filepath, uint flags)
         }
     }   else if (res_hdl != INVALID_HANDLE) {
         /* add ref count */
-        struct rs_resource* ress = (struct rs_resource*)g_rs.ress.buffer;
-        ress[GET_INDEX(res_hdl)].ref_cnt ++;
+        rs_resource_addref(rs_resource_get(res_hdl));
     }
 
     /* rs_resource is not loaded before, so we just have to load it for the first time */
@@ -1212,8 +1842,12 @@ reshandle_t rs_load_phxprefab(const char* phx_filepath, uint flags)
             path_getfileext(ext, phx_filepath);
             phx_prefab prefab = NULL;
 
+            const struct rs_packsrc* src = rs_pack_findsrc(hash_str(phx_filepath));
+
             /* model files should be valid extension */
-            if (str_isequal_nocase(ext, "h3dp"))
+            if (src != NULL)
+                prefab = phx_prefab_loadmem(phx_filepath, src->data, src->size, g_rs.alloc, 0);
+            else if (str_isequal_nocase(ext, "h3dp"))
                 prefab = phx_prefab_load(phx_filepath, g_rs.alloc, 0);
 
             if (prefab == NULL) {
@@ -1225,7 +1859,8 @@ reshandle_t rs_load_phxprefab(const char* phx_filepath, uint flags)
                 return INVALID_HANDLE;
             }
 
-            res_hdl = rs_add_resource(phx_filepath, prefab, override_hdl, rs_phxprefab_unload);
+            res_hdl = rs_add_resource(phx_filepath, RS_RESOURCE_PHXPREFAB, prefab, override_hdl,
+                rs_phxprefab_unload);
 
             /* add to hot-loading files */
             if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING) && !BIT_CHECK(flags, RS_LOAD_REFRESH))
@@ -1235,6 +1870,7 @@ reshandle_t rs_load_phxprefab(const char* phx_filepath, uint flags)
         }
     }
 
+    rs_bundle_record(res_hdl);
     return res_hdl;
 }
 
@@ -1244,7 +1880,8 @@ reshandle_t rs_phxprefab_queueload(const char* phx_filepath, reshandle_t overrid
     if (override_hdl != INVALID_HANDLE && rs_loadqueue_search(override_hdl) != NULL)
         return override_hdl;
 
-    reshandle_t hdl = rs_add_resource(phx_filepath, NULL, override_hdl, rs_phxprefab_unload);
+    reshandle_t hdl = rs_add_resource(phx_filepath, RS_RESOURCE_PHXPREFAB, NULL, override_hdl,
+        rs_phxprefab_unload);
     if (hdl == INVALID_HANDLE)
         return hdl;
 
@@ -1256,9 +1893,10 @@ reshandle_t rs_phxprefab_queueload(const char* phx_filepath, reshandle_t overrid
     ldata->hdl = hdl;
     ldata->type = RS_RESOURCE_PHXPREFAB;
     ldata->reload = (override_hdl != INVALID_HANDLE);
+    rs_loaddata_bindpack(ldata);
 
-    /* push to load list */
-    list_addlast(&g_rs.load_list, &ldata->lnode, ldata);
+    /* push to load queue, with default priority until someone re-prioritizes it */
+    rs_loadqueue_push(ldata, rs_loadqueue_bucket(RS_LOAD_PRIORITY_DEFAULT), FALSE);
 
     return hdl;
 }
@@ -1276,7 +1914,66 @@ void rs_reportleaks()
         const struct rs_resource* r = &rss[i];
         if (r->hdl != INVALID_HANDLE && r->ref_cnt > 0) {
             log_printf(LOG_WARNING, "res-mgr: unreleased \"%s\" (ref_cnt = %d, id = %d)",
-                r->filepath, r->ref_cnt, GET_ID(r->hdl));
+                rs_resource_path(r), r->ref_cnt, GET_ID(r->hdl));
+        }
+    }
+}
+
+void rs_set_loadpriority(reshandle_t hdl, float priority)
+{
+    if (!g_rs.init || hdl == INVALID_HANDLE)
+        return;
+
+    /* only queued requests can be re-prioritized, others are loaded or loading */
+    struct rs_load_data* ldata = rs_loadqueue_search(hdl);
+    if (ldata == NULL)
+        return;
+
+    uint bucket = rs_loadqueue_bucket(priority);
+    if (bucket != ldata->qitem.bucket)    {
+        rs_loadqueue_remove(ldata);
+        rs_loadqueue_push(ldata, bucket, FALSE);
+    }
+}
+
+void rs_set_texturesize(reshandle_t tex_hdl, float screen_size)
+{
+    if (!g_rs.init || tex_hdl == INVALID_HANDLE)
+        return;
+
+    struct rs_resource* r = rs_resource_get(tex_hdl);
+    struct rs_texstream* s = &r->texstream;
+    if (s->mip_cnt == 0)
+        return;
+
+    /* keep the largest request of the frame */
+    if (s->wanted_frame == g_rs.frame && screen_size <= s->screen_size)
+        return;
+    s->wanted_frame = g_rs.frame;
+    s->screen_size = screen_size;
+    tex_lru_touch(&g_rs.texstream_lru, g_rs.ress.buffer, rs_resource_idx(r));
+
+    uint mip = rs_texstream_fitbudget(r, rs_texstream_selectmip(s, screen_size));
+    if (mip >= s->resident_mip)
+        return;
+
+    /* bigger textures on screen are streamed in sooner */
+    float priority = RS_TEXSTREAM_PRIORITY_SCALE/maxf(screen_size, 1.0f);
+    if (s->pending_mip == INVALID_INDEX)    {
+        if (r->ldata == NULL && rs_loadslot_find(tex_hdl) == NULL)    {
+            rs_texstream_queue(r, mip, priority);
+            g_rs.texstream_stats.promote_cnt ++;
+        }
+    }   else if (mip < s->pending_mip && r->ldata != NULL && r->ldata->params.tex.stream)   {
+        /* request is still in the queue, raise it's detail and priority */
+        struct rs_load_data* ldata = r->ldata;
+        ldata->params.tex.first_mipidx = mip;
+        s->pending_mip = mip;
+
+        uint bucket = rs_loadqueue_bucket(priority);
+        if (bucket < ldata->qitem.bucket) {
+            rs_loadqueue_remove(ldata);
+            rs_loadqueue_push(ldata, bucket, FALSE);
         }
     }
 }
@@ -1284,37 +1981,37 @@ void rs_reportleaks()
 sct_s rs_get_script(reshandle_t script_hdl)
 {
     ASSERT(g_rs.init);
-    return (sct_s)rs_resource_get(script_hdl)->ptr;
+    return (sct_s)rs_resource_use(script_hdl)->ptr;
 }
 
 gfx_texture rs_get_texture(reshandle_t tex_hdl)
 {
     ASSERT(g_rs.init);
-    return (gfx_texture)rs_resource_get(tex_hdl)->ptr;
+    return (gfx_texture)rs_resource_use(tex_hdl)->ptr;
 }
 
 phx_prefab rs_get_phxprefab(reshandle_t prefab_hdl)
 {
     ASSERT(g_rs.init);
-    return (phx_prefab)rs_resource_get(prefab_hdl)->ptr;
+    return (phx_prefab)rs_resource_use(prefab_hdl)->ptr;
 }
 
 struct gfx_model* rs_get_model(reshandle_t mdl_hdl)
 {
     ASSERT(g_rs.init);
-    return (struct gfx_model*)rs_resource_get(mdl_hdl)->ptr;
+    return (struct gfx_model*)rs_resource_use(mdl_hdl)->ptr;
 }
 
 anim_reel rs_get_animreel(reshandle_t anim_hdl)
 {
     ASSERT(g_rs.init);
-    return (anim_reel)rs_resource_get(anim_hdl)->ptr;
+    return (anim_reel)rs_resource_use(anim_hdl)->ptr;
 }
 
 anim_ctrl rs_get_animctrl(reshandle_t ctrl_hdl)
 {
     ASSERT(g_rs.init);
-    return (anim_ctrl)rs_resource_get(ctrl_hdl)->ptr;
+    return (anim_ctrl)rs_resource_use(ctrl_hdl)->ptr;
 }
 
 void rs_set_dataalloc(struct allocator* alloc)
@@ -1331,7 +2028,512 @@ const char* rs_get_filepath(reshandle_t hdl)
 {
     if (!g_rs.init)
         return "";
-    return rs_resource_get(hdl)->filepath;
+    return rs_resource_path(rs_resource_get(hdl));
+}
+
+uint rs_get_pathid(const char* filepath)
+{
+    uint path_id = hash_str(filepath);
+#if defined(_DEBUG_)
+    /* ids are resolved without strings later, so report collisions with loaded paths here */
+    if (g_rs.init)  {
+        reshandle_t hdl;
+        rs_find_bypath(filepath, &hdl);
+    }
+#endif
+    return path_id;
+}
+
+reshandle_t rs_addref_byid(uint path_id, enum rs_resource_type type)
+{
+    if (!g_rs.init)
+        return INVALID_HANDLE;
+
+    reshandle_t hdl = rs_find_byid(path_id);
+    if (hdl == INVALID_HANDLE)
+        return INVALID_HANDLE;
+
+    struct rs_resource* r = rs_resource_get(hdl);
+    if (r->type != type)    {
+        log_printf(LOG_WARNING, "res-mgr: resource '%s' is a %s, not a %s", rs_resource_path(r),
+            rs_get_typestr(r->type), rs_get_typestr(type));
+        return INVALID_HANDLE;
+    }
+
+    rs_resource_addref(r);
+    rs_bundle_record(hdl);
+    return hdl;
+}
+
+uint rs_bundle_begin()
+{
+    ASSERT(g_rs.bundle_rec == INVALID_INDEX);
+    if (!g_rs.init || g_rs.bundle_rec != INVALID_INDEX)
+        return 0;
+
+    struct rs_bundle* b = rs_bundle_create(FALSE);
+    if (b == NULL)
+        return 0;
+    g_rs.bundle_rec = (uint)(b - g_rs.bundles);
+    return b->id;
+}
+
+/* takes a free bundle slot, =NULL if there is none */
+struct rs_bundle* rs_bundle_create(int owns_refs)
+{
+    for (uint i = 0; i < RS_BUNDLE_MAX; i++)   {
+        struct rs_bundle* b = &g_rs.bundles[i];
+        if (b->id != 0)
+            continue;
+
+        if (IS_FAIL(arr_create(mem_heap(), &b->hdls, sizeof(reshandle_t), 64, 256, MID_RES)))  {
+            err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+            return NULL;
+        }
+        b->id = ++g_rs.bundle_lastid;
+        b->owns_refs = owns_refs;
+        return b;
+    }
+
+    err_printf(__FILE__, __LINE__, "res-mgr: maximum number of bundles (%d) exceeded",
+        RS_BUNDLE_MAX);
+    return NULL;
+}
+
+void rs_bundle_end()
+{
+    g_rs.bundle_rec = INVALID_INDEX;
+}
+
+struct rs_bundle* rs_bundle_find(uint bundle_id)
+{
+    if (bundle_id == 0)
+        return NULL;
+    for (uint i = 0; i < RS_BUNDLE_MAX; i++)   {
+        if (g_rs.bundles[i].id == bundle_id)
+            return &g_rs.bundles[i];
+    }
+    return NULL;
+}
+
+int rs_bundle_isready(uint bundle_id, OUT OPTIONAL struct rs_bundle_status* status)
+{
+    struct rs_bundle_status s;
+    memset(&s, 0x00, sizeof(s));
+
+    struct rs_bundle* b = rs_bundle_find(bundle_id);
+    if (!g_rs.init || b == NULL)    {
+        if (status != NULL)
+            *status = s;
+        return TRUE;
+    }
+
+    const struct rs_resource* rss = (const struct rs_resource*)g_rs.ress.buffer;
+    const reshandle_t* hdls = (const reshandle_t*)b->hdls.buffer;
+    for (int i = 0; i < b->hdls.item_cnt; i++)  {
+        /* resources that are unloaded since they are requested don't hold back the bundle */
+        uint idx = GET_INDEX(hdls[i]);
+        s.total_cnt ++;
+        if (idx >= (uint)g_rs.ress.item_cnt || rss[idx].hdl != hdls[i])   {
+            s.ready_cnt ++;
+            continue;
+        }
+
+        const struct rs_resource* r = &rss[idx];
+
+        int ready = rs_resource_isloaded(r);
+        int failed = r->failed;
+        for (uint k = 0; k < r->dep_cnt && ready; k++)  {
+            const struct rs_resource* dep = rs_resource_get(r->deps[k]);
+            ready = rs_resource_isloaded(dep);
+            failed |= dep->failed;
+        }
+
+        s.ready_cnt += ready ? 1 : 0;
+        s.failed_cnt += (ready && failed) ? 1 : 0;
+    }
+
+    if (status != NULL)
+        *status = s;
+    return s.ready_cnt == s.total_cnt;
+}
+
+void rs_bundle_destroy(uint bundle_id)
+{
+    struct rs_bundle* b = rs_bundle_find(bundle_id);
+    if (b == NULL)
+        return;
+
+    if (g_rs.bundle_rec == (uint)(b - g_rs.bundles))
+        g_rs.bundle_rec = INVALID_INDEX;
+
+    /* release references of bundle files, skip the resources that are already removed */
+    if (b->owns_refs)   {
+        const reshandle_t* hdls = (const reshandle_t*)b->hdls.buffer;
+        for (int i = 0; i < b->hdls.item_cnt; i++)  {
+            uint idx = GET_INDEX(hdls[i]);
+            if (idx < (uint)g_rs.ress.item_cnt &&
+                ((const struct rs_resource*)g_rs.ress.buffer)[idx].hdl == hdls[i])
+            {
+                rs_unload(hdls[i]);
+            }
+        }
+    }
+
+    arr_destroy(&b->hdls);
+    b->id = 0;
+}
+
+uint rs_load_bundle(const char* h3db_filepath)
+{
+    if (!g_rs.init)
+        return 0;
+
+    /* one read for the whole bundle, packed files are parsed from this memory by the loaders */
+    file_t f = fio_openmem(mem_heap(), h3db_filepath, FALSE, MID_RES);
+    if (f == NULL)  {
+        err_printf(__FILE__, __LINE__, "load bundle '%s' failed: could not open file",
+            h3db_filepath);
+        return 0;
+    }
+    size_t size;
+    uint8* data = (uint8*)fio_detachmem(f, &size, NULL);
+    fio_close(f);
+
+    /* validate tables, items and dependency indexes are used in place */
+    const struct h3d_header* header = (const struct h3d_header*)data;
+    const struct h3d_bundle* hbundle = (const struct h3d_bundle*)(header + 1);
+    const struct h3d_bundle_item* items = (const struct h3d_bundle_item*)(hbundle + 1);
+    const size_t hdr_size = sizeof(struct h3d_header) + sizeof(struct h3d_bundle);
+    int valid = size >= hdr_size && header->sign == H3D_SIGN && header->type == H3D_BUNDLE &&
+        header->version == H3D_VERSION;
+    valid = valid && hdr_size + hbundle->item_cnt*sizeof(struct h3d_bundle_item) +
+        hbundle->dep_cnt*sizeof(uint) <= header->data_offset && header->data_offset <= size;
+
+    const uint* dep_idxs = valid ? (const uint*)(items + hbundle->item_cnt) : NULL;
+    size_t data_size = valid ? size - header->data_offset : 0;
+    for (uint i = 0; valid && i < hbundle->item_cnt; i++)   {
+        const struct h3d_bundle_item* item = &items[i];
+        /* paths are used as strings and ids are used as keys of packed data, both come from file */
+        valid = item->type > RS_RESOURCE_UNKNOWN && item->type < RS_RESOURCE_TYPE_CNT &&
+            memchr(item->filepath, 0, sizeof(item->filepath)) != NULL &&
+            item->path_id == hash_str(item->filepath) &&
+            (size_t)item->offset + item->size <= data_size &&
+            (size_t)item->dep_first + item->dep_cnt <= hbundle->dep_cnt;
+        for (uint k = 0; valid && k < item->dep_cnt; k++)
+            valid = dep_idxs[item->dep_first + k] < hbundle->item_cnt;
+    }
+
+    if (!valid) {
+        A_FREE(mem_heap(), data);
+        err_printf(__FILE__, __LINE__, "load bundle '%s' failed: invalid file format",
+            h3db_filepath);
+        return 0;
+    }
+
+    uint item_cnt = hbundle->item_cnt;
+    struct rs_pack* pack = (struct rs_pack*)A_ALLOC(mem_heap(),
+        sizeof(struct rs_pack) + sizeof(struct rs_packsrc)*item_cnt, MID_RES);
+    reshandle_t* hdls = (reshandle_t*)A_ALLOC(mem_heap(), sizeof(reshandle_t)*(item_cnt + 1),
+        MID_RES);
+    /* bundle isn't recording, so loading a bundle file doesn't interfere with rs_bundle_begin/end
+     * of the caller, resources are still recorded to the caller's bundle like other requests */
+    struct rs_bundle* b = (pack != NULL && hdls != NULL) ? rs_bundle_create(TRUE) : NULL;
+    if (b == NULL) {
+        if (pack != NULL)
+            A_FREE(mem_heap(), pack);
+        if (hdls != NULL)
+            A_FREE(mem_heap(), hdls);
+        A_FREE(mem_heap(), data);
+        err_printf(__FILE__, __LINE__, "load bundle '%s' failed", h3db_filepath);
+        return 0;
+    }
+
+    /* fixup packed file pointers, files that are already packed in another loaded bundle keep
+     * their first source */
+    pack->data = data;
+    pack->ref_cnt = 1;
+    pack->srcs = (struct rs_packsrc*)(pack + 1);
+    pack->src_cnt = 0;
+    const uint8* packed_data = data + header->data_offset;
+    for (uint i = 0; i < item_cnt; i++) {
+        const struct h3d_bundle_item* item = &items[i];
+        if (item->size == 0 || hashtable_chained_find(&g_rs.pack_srcs, item->path_id) != NULL)
+            continue;
+
+        struct rs_packsrc* src = &pack->srcs[pack->src_cnt++];
+        src->pack = pack;
+        src->path_id = item->path_id;
+        src->data = packed_data + item->offset;
+        src->size = item->size;
+        hashtable_chained_add(&g_rs.pack_srcs, item->path_id, (uptr_t)src);
+    }
+    g_rs.pack_cnt ++;
+
+    /* request every item, load requests are bound to packed data while the bundle is alive */
+    for (uint i = 0; i < item_cnt; i++) {
+        hdls[i] = rs_addref_byid(items[i].path_id, (enum rs_resource_type)items[i].type);
+        if (hdls[i] == INVALID_HANDLE)
+            hdls[i] = rs_bundle_loaditem(&items[i]);
+    }
+
+    /* dependencies are already resolved to items, so models don't have to request their textures
+     * by name after they are loaded. resources that already have dependencies are left intact */
+    for (uint i = 0; i < item_cnt; i++) {
+        const struct h3d_bundle_item* item = &items[i];
+        if (item->dep_cnt == 0 || hdls[i] == INVALID_HANDLE ||
+            rs_resource_get(hdls[i])->deps != NULL)
+        {
+            continue;
+        }
+
+        reshandle_t* deps = (reshandle_t*)A_ALLOC(mem_heap(), sizeof(reshandle_t)*item->dep_cnt,
+            MID_RES);
+        if (deps == NULL)
+            continue;
+
+        uint dep_cnt = 0;
+        for (uint k = 0; k < item->dep_cnt; k++)    {
+            reshandle_t dep_hdl = hdls[dep_idxs[item->dep_first + k]];
+            if (dep_hdl != INVALID_HANDLE)  {
+                rs_resource_addref(rs_resource_get(dep_hdl));
+                deps[dep_cnt++] = dep_hdl;
+            }
+        }
+
+        struct rs_resource* r = rs_resource_get(hdls[i]);
+        r->deps = deps;
+        r->dep_cnt = dep_cnt;
+    }
+
+    /* bundle holds the item references, it's the only owner if the array can't grow */
+    for (uint i = 0; i < item_cnt; i++) {
+        if (hdls[i] == INVALID_HANDLE)
+            continue;
+        reshandle_t* h = (reshandle_t*)arr_add(&b->hdls);
+        if (h != NULL)
+            *h = hdls[i];
+        else
+            rs_unload(hdls[i]);
+    }
+
+    A_FREE(mem_heap(), hdls);
+    rs_pack_release(pack);
+
+    log_printf(LOG_LOAD, "(bundle) \"%s\" - %d items, id: %d", h3db_filepath, item_cnt, b->id);
+    return b->id;
+}
+
+reshandle_t rs_bundle_loaditem(const struct h3d_bundle_item* item)
+{
+    switch (item->type) {
+    case RS_RESOURCE_TEXTURE:
+        return rs_load_texture(item->filepath, 0, BIT_CHECK(item->flags, H3D_BUNDLE_SRGB),
+            BIT_CHECK(item->flags, H3D_BUNDLE_STREAMMIPS) ? RS_LOAD_STREAMMIPS : 0);
+    case RS_RESOURCE_MODEL:
+        return rs_load_model(item->filepath, 0);
+    case RS_RESOURCE_PHXPREFAB:
+        return rs_load_phxprefab(item->filepath, 0);
+    case RS_RESOURCE_ANIMREEL:
+        return rs_load_animreel(item->filepath, 0);
+    case RS_RESOURCE_ANIMCTRL:
+        return rs_load_animctrl(item->filepath, 0);
+    case RS_RESOURCE_SCRIPT:
+        return rs_load_script(item->filepath, 0);
+    default:
+        return INVALID_HANDLE;
+    }
+}
+
+/* frees bundle file memory when the last load request that refers to it is finished */
+void rs_pack_release(struct rs_pack* pack)
+{
+    ASSERT(pack->ref_cnt > 0);
+    pack->ref_cnt --;
+    if (pack->ref_cnt > 0)
+        return;
+
+    for (uint i = 0; i < pack->src_cnt; i++)    {
+        struct hashtable_item_chained* item = hashtable_chained_find(&g_rs.pack_srcs,
+            pack->srcs[i].path_id);
+        ASSERT(item && item->value == (uptr_t)&pack->srcs[i]);
+        hashtable_chained_remove(&g_rs.pack_srcs, item);
+    }
+
+    g_rs.pack_cnt --;
+    A_FREE(mem_heap(), pack->data);
+    A_FREE(mem_heap(), pack);
+}
+
+result_t rs_bundle_save(uint bundle_id, const char* h3db_filepath)
+{
+    struct rs_bundle* b = rs_bundle_find(bundle_id);
+    if (!g_rs.init || b == NULL)    {
+        err_printf(__FILE__, __LINE__, "save bundle '%s' failed: invalid bundle", h3db_filepath);
+        return RET_INVALIDARG;
+    }
+
+    /* texture flags and model dependencies are only known after they are loaded */
+    if (!rs_bundle_isready(bundle_id, NULL))    {
+        err_printf(__FILE__, __LINE__, "save bundle '%s' failed: bundle is not loaded yet",
+            h3db_filepath);
+        return RET_FAIL;
+    }
+
+    struct array items; /* item: h3d_bundle_item */
+    struct array hdls;  /* item: reshandle_t, same index as items */
+    struct array dep_idxs;  /* item: uint */
+    struct array datas; /* item: void*, same index as items */
+    memset(&items, 0x00, sizeof(items));
+    memset(&hdls, 0x00, sizeof(hdls));
+    memset(&dep_idxs, 0x00, sizeof(dep_idxs));
+    memset(&datas, 0x00, sizeof(datas));
+    result_t r = arr_create(mem_heap(), &items, sizeof(struct h3d_bundle_item), 64, 256, MID_RES);
+    r |= arr_create(mem_heap(), &hdls, sizeof(reshandle_t), 64, 256, MID_RES);
+    r |= arr_create(mem_heap(), &dep_idxs, sizeof(uint), 64, 256, MID_RES);
+    r |= arr_create(mem_heap(), &datas, sizeof(void*), 64, 256, MID_RES);
+    if (IS_FAIL(r)) {
+        err_printn(__FILE__, __LINE__, RET_OUTOFMEMORY);
+        rs_bundle_savecleanup(&items, &hdls, &dep_idxs, &datas);
+        return RET_OUTOFMEMORY;
+    }
+
+    /* unique resources of the bundle, then their dependencies (items grow while iterating) */
+    const reshandle_t* bhdls = (const reshandle_t*)b->hdls.buffer;
+    for (int i = 0; i < b->hdls.item_cnt; i++)
+        rs_bundle_additem(&items, &hdls, bhdls[i]);
+
+    for (int i = 0; i < items.item_cnt; i++)    {
+        const struct rs_resource* res = rs_resource_get(((const reshandle_t*)hdls.buffer)[i]);
+        uint dep_first = (uint)dep_idxs.item_cnt;
+        for (uint k = 0; k < res->dep_cnt; k++)   {
+            uint idx = rs_bundle_additem(&items, &hdls, res->deps[k]);
+            uint* dep_idx = (idx != INVALID_INDEX) ? (uint*)arr_add(&dep_idxs) : NULL;
+            if (dep_idx != NULL)
+                *dep_idx = idx;
+        }
+
+        struct h3d_bundle_item* item = &((struct h3d_bundle_item*)items.buffer)[i];
+        item->dep_first = dep_first;
+        item->dep_cnt = (uint)dep_idxs.item_cnt - dep_first;
+    }
+
+    /* every item is packed, loaders parse them from bundle memory */
+    struct h3d_bundle_item* bitems = (struct h3d_bundle_item*)items.buffer;
+    uint offset = 0;
+    for (int i = 0; i < items.item_cnt; i++)    {
+        struct h3d_bundle_item* item = &bitems[i];
+        void** pdata = (void**)arr_add(&datas);
+        ASSERT(pdata);
+        *pdata = NULL;
+
+        file_t f = fio_openmem(mem_heap(), item->filepath, FALSE, MID_RES);
+        if (f == NULL)  {
+            log_printf(LOG_WARNING, "res-mgr: could not pack '%s' in bundle, file will be loaded"
+                " by path", item->filepath);
+            continue;
+        }
+        size_t size;
+        *pdata = fio_detachmem(f, &size, NULL);
+        fio_close(f);
+
+        item->offset = offset;
+        item->size = (uint)size;
+        offset += (uint)((size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1));
+    }
+
+    file_t f = fio_createdisk(h3db_filepath);
+    if (f == NULL)  {
+        err_printf(__FILE__, __LINE__, "save bundle failed: could not create file '%s'",
+            h3db_filepath);
+        rs_bundle_savecleanup(&items, &hdls, &dep_idxs, &datas);
+        return RET_FILE_ERROR;
+    }
+
+    static const uint8 zeros[H3D_BUNDLE_ALIGN] = {0};
+    size_t table_size = sizeof(struct h3d_header) + sizeof(struct h3d_bundle) +
+        items.item_cnt*sizeof(struct h3d_bundle_item) + dep_idxs.item_cnt*sizeof(uint);
+    size_t table_pad = ((table_size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1)) -
+        table_size;
+
+    struct h3d_header header;
+    header.sign = H3D_SIGN;
+    header.type = H3D_BUNDLE;
+    header.version = H3D_VERSION;
+    header.data_offset = (uint)(table_size + table_pad);
+
+    struct h3d_bundle hbundle;
+    hbundle.item_cnt = (uint)items.item_cnt;
+    hbundle.dep_cnt = (uint)dep_idxs.item_cnt;
+
+    fio_write(f, &header, sizeof(header), 1);
+    fio_write(f, &hbundle, sizeof(hbundle), 1);
+    fio_write(f, items.buffer, sizeof(struct h3d_bundle_item), items.item_cnt);
+    fio_write(f, dep_idxs.buffer, sizeof(uint), dep_idxs.item_cnt);
+    fio_write(f, zeros, 1, table_pad);
+    for (int i = 0; i < items.item_cnt; i++)    {
+        const void* data = ((void* const*)datas.buffer)[i];
+        if (data == NULL)
+            continue;
+        size_t size = bitems[i].size;
+        fio_write(f, data, size, 1);
+        fio_write(f, zeros, 1, ((size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1)) - size);
+    }
+    fio_close(f);
+
+    log_printf(LOG_TEXT, "res-mgr: saved bundle '%s' - %d items, %dkb packed", h3db_filepath,
+        items.item_cnt, offset/1024);
+    rs_bundle_savecleanup(&items, &hdls, &dep_idxs, &datas);
+    return RET_OK;
+}
+
+void rs_bundle_savecleanup(struct array* items, struct array* hdls, struct array* dep_idxs,
+    struct array* datas)
+{
+    for (int i = 0; i < datas->item_cnt; i++)    {
+        void* data = ((void**)datas->buffer)[i];
+        if (data != NULL)
+            A_FREE(mem_heap(), data);
+    }
+    arr_destroy(datas);
+    arr_destroy(dep_idxs);
+    arr_destroy(hdls);
+    arr_destroy(items);
+}
+
+/* adds resource to bundle items if it's not already added, returns item index,
+ * =INVALID_INDEX if resource is removed */
+uint rs_bundle_additem(struct array* items, struct array* hdls, reshandle_t hdl)
+{
+    uint idx = GET_INDEX(hdl);
+    if (idx >= (uint)g_rs.ress.item_cnt ||
+        ((const struct rs_resource*)g_rs.ress.buffer)[idx].hdl != hdl)
+    {
+        return INVALID_INDEX;
+    }
+
+    const struct rs_resource* r = rs_resource_get(hdl);
+    const struct h3d_bundle_item* bitems = (const struct h3d_bundle_item*)items->buffer;
+    for (int i = 0; i < items->item_cnt; i++)   {
+        if (bitems[i].path_id == r->path_id)
+            return (uint)i;
+    }
+
+    struct h3d_bundle_item* item = (struct h3d_bundle_item*)arr_add(items);
+    reshandle_t* h = (reshandle_t*)arr_add(hdls);
+    if (item == NULL || h == NULL)
+        return INVALID_INDEX;
+
+    memset(item, 0x00, sizeof(struct h3d_bundle_item));
+    str_safecpy(item->filepath, sizeof(item->filepath), rs_resource_path(r));
+    item->path_id = r->path_id;
+    item->type = (uint)r->type;
+    if (r->type == RS_RESOURCE_TEXTURE) {
+        item->flags |= r->texstream.srgb ? H3D_BUNDLE_SRGB : 0;
+        item->flags |= (r->texstream.mip_cnt != 0) ? H3D_BUNDLE_STREAMMIPS : 0;
+    }
+    *h = hdl;
+    return (uint)(items->item_cnt - 1);
 }
 
 void rs_add_flags(uint flags)
@@ -1360,5 +2562,245 @@ void rs_unloadptr(reshandle_t hdl)
 {
     struct rs_resource* r = rs_resource_get(hdl);
     r->unload_func(r->ptr);
-    r->ptr = NULL;
+    rs_resource_setptr(r, NULL);
+}
+
+void rs_evict_overbudget()
+{
+    for (uint i = 0; i < RS_RESOURCE_TYPE_CNT; i++)   {
+        /* evict least recently used cached resources (tail of the list), until we are within
+         * budget */
+        while (g_rs.cached_cnts[i] > 0 && g_rs.used_bytes[i] > g_rs.budgets[i])  {
+            uint lru_idx = g_rs.lru_last[i];
+            ASSERT(lru_idx != INVALID_INDEX);
+            rs_evict_cached(&((struct rs_resource*)g_rs.ress.buffer)[lru_idx]);
+            g_rs.evict_cnt ++;
+        }
+    }
+
+    /* textures are still over budget, drop the high detail mips that are not needed */
+    if (g_rs.budgets[RS_RESOURCE_TEXTURE] != 0 &&
+        g_rs.used_bytes[RS_RESOURCE_TEXTURE] > g_rs.budgets[RS_RESOURCE_TEXTURE])
+    {
+        rs_texstream_demote();
+    }
+}
+
+/* demotes a texture of the least recently viewed list to the mips that it currently needs, returns
+ * memory that will be released. pending demotes are counted, they release memory when loaded */
+static fl64 rs_texstream_demoteitem(uint idx, void* param)
+{
+    struct rs_resource* r = &((struct rs_resource*)g_rs.ress.buffer)[idx];
+    struct rs_texstream* s = &r->texstream;
+    if (s->pending_mip != INVALID_INDEX)    {
+        if (s->pending_mip > s->resident_mip)
+            return (fl64)r->bytes - rs_texstream_calcbytes(r, s->pending_mip);
+        return 0.0;
+    }
+
+    uint mip = rs_texstream_targetmip(s);
+    if (r->ldata != NULL || mip <= s->resident_mip || rs_loadslot_find(r->hdl) != NULL)
+        return 0.0;
+
+    rs_texstream_queue(r, mip, RS_LOAD_PRIORITY_DEFAULT);
+    g_rs.texstream_stats.demote_cnt ++;
+    return (fl64)r->bytes - rs_texstream_calcbytes(r, mip);
+}
+
+/* queues lower detail mips for least recently viewed streamed textures, until the memory that will
+ * be released covers the texture budget overflow. the walk starts from the tail of the viewed list
+ * and stops as soon as the overflow is covered, so recently viewed textures are rarely visited */
+void rs_texstream_demote()
+{
+    fl64 overflow = (fl64)g_rs.used_bytes[RS_RESOURCE_TEXTURE] -
+        (fl64)g_rs.budgets[RS_RESOURCE_TEXTURE];
+    if (overflow > 0.0) {
+        tex_lru_demote(&g_rs.texstream_lru, g_rs.ress.buffer, overflow, rs_texstream_demoteitem,
+            NULL);
+    }
+}
+
+/* updates mip residency of the texture by the result of it's load request */
+void rs_texstream_collect(struct rs_resource* r, const struct rs_load_data* ldata, gfx_texture tex)
+{
+    struct rs_texstream* s = &r->texstream;
+    if (ldata->params.tex.stream)
+        s->pending_mip = INVALID_INDEX;
+
+    if (tex == NULL || (s->mip_cnt == 0 && ldata->params.tex.size_max == 0))
+        return;
+
+    /* new mips replace the previous texture, which is kept until now to avoid blank textures */
+    if (ldata->params.tex.stream && r->ptr != tex)  {
+        r->unload_func(r->ptr);
+        rs_resource_setptr(r, NULL);
+    }
+
+    int streamed = (s->mip_cnt != 0);
+    if (!streamed)    {
+        s->base_mip = minui(ldata->params.tex.first_mipidx, ldata->params.tex.mip_cnt - 1);
+        s->srgb = ldata->params.tex.srgb;
+        s->wanted_frame = g_rs.frame;
+    }
+    s->mip_cnt = ldata->params.tex.mip_cnt;
+    if (!streamed && s->mip_cnt != 0)
+        tex_lru_add(&g_rs.texstream_lru, g_rs.ress.buffer, rs_resource_idx(r));
+    else if (streamed && s->mip_cnt == 0)
+        tex_lru_remove(&g_rs.texstream_lru, g_rs.ress.buffer, rs_resource_idx(r));
+    s->resident_mip = s->mip_cnt - tex->desc.tex.mip_cnt;
+    s->width = tex->desc.tex.width << s->resident_mip;
+    s->height = tex->desc.tex.height << s->resident_mip;
+}
+
+void rs_evict_cached(struct rs_resource* r)
+{
+    ASSERT(r->cached && r->ref_cnt == 0);
+    if (BIT_CHECK(g_rs.flags, RS_FLAG_HOTLOADING))
+        fio_mon_unreg(rs_resource_path(r));
+    rs_remove_fromdb(r->hdl);
+}
+
+void rs_set_budget(enum rs_resource_type type, size_t bytes)
+{
+    ASSERT(type < RS_RESOURCE_TYPE_CNT);
+    g_rs.budgets[type] = bytes;
+}
+
+void rs_get_budgetstats(struct rs_budget_stats* stats)
+{
+    memcpy(stats->used, g_rs.used_bytes, sizeof(g_rs.used_bytes));
+    memcpy(stats->cached, g_rs.cached_bytes, sizeof(g_rs.cached_bytes));
+    memcpy(stats->budgets, g_rs.budgets, sizeof(g_rs.budgets));
+    stats->evict_cnt = g_rs.evict_cnt;
+}
+
+const char* rs_get_typestr(enum rs_resource_type type)
+{
+    ASSERT(type < RS_RESOURCE_TYPE_CNT);
+    return g_rs_typenames[type];
+}
+
+result_t rs_console_budget(uint argc, const char** argv, void* param)
+{
+    if (argc == 0)  {
+        for (uint i = RS_RESOURCE_TEXTURE; i < RS_RESOURCE_TYPE_CNT; i++)  {
+            log_printf(LOG_TEXT, "%s: %dkb / %dkb", g_rs_typenames[i],
+                (uint)(g_rs.used_bytes[i]/1024), (uint)(g_rs.budgets[i]/1024));
+        }
+        return RET_OK;
+    }
+
+    if (argc != 2)
+        return RET_INVALIDARG;
+
+    for (uint i = RS_RESOURCE_TEXTURE; i < RS_RESOURCE_TYPE_CNT; i++)  {
+        if (str_isequal_nocase(argv[0], g_rs_typenames[i]))   {
+            rs_set_budget((enum rs_resource_type)i, (size_t)str_toint32(argv[1])*1024*1024);
+            return RET_OK;
+        }
+    }
+    return RET_INVALIDARG;
+}
+
+result_t rs_console_uploadbudget(uint argc, const char** argv, void* param)
+{
+    struct gfx_delayed_stats stats;
+    gfx_delayed_getstats(&stats);
+
+    if (argc == 0)  {
+        log_printf(LOG_TEXT, "upload budget: %dkb, %d objects (0 = unlimited)",
+            stats.bytes_max/1024, stats.objs_max);
+        return RET_OK;
+    }
+
+    uint objs_max = argc > 1 ? (uint)str_toint32(argv[1]) : stats.objs_max;
+    gfx_delayed_setbudget((uint)str_toint32(argv[0])*1024, objs_max);
+    return RET_OK;
+}
+
+result_t rs_console_savebundle(uint argc, const char** argv, void* param)
+{
+    if (argc != 2)
+        return RET_INVALIDARG;
+    return rs_bundle_save((uint)str_toint32(argv[0]), argv[1]);
+}
+
+result_t rs_console_loadinfo(uint argc, const char** argv, void* param)
+{
+    int show = TRUE;
+    if (argc == 1)
+        show = str_tobool(argv[0]);
+    else if (argc > 1)
+        return RET_INVALIDARG;
+
+    if (show && !g_rs.load_debug)
+        hud_add_label("rs-loadinfo", rs_loadinfo_debugtext, NULL);
+    else if (!show && g_rs.load_debug)
+        hud_remove_label("rs-loadinfo");
+    g_rs.load_debug = show;
+
+    return RET_OK;
+}
+
+int rs_loadinfo_debugtext(gfx_cmdqueue cmdqueue, int x, int y, int line_stride, void* param)
+{
+    char text[128];
+    const struct rs_load_stats* stats = &g_rs.load_stats;
+
+    uint queued_cnt = load_queue_getcount(&g_rs.load_queue);
+
+    uint busy_cnt = 0;
+    for (uint i = 0; i < g_rs.load_threads_max; i++)
+        busy_cnt += (g_rs.load_slots[i].job_id != 0) ? 1 : 0;
+
+    fl64 busy_tm = stats->busy_tm;
+    if (stats->busy_tick != 0)
+        busy_tm += timer_calctm(stats->busy_tick, timer_querytick());
+    uint done_cnt = stats->loaded_cnt + stats->failed_cnt;
+
+    sprintf(text, "[res-mgr] threads: %d/%d, queued: %d, loaded: %d, failed: %d",
+        busy_cnt, g_rs.load_threads_max, queued_cnt, stats->loaded_cnt, stats->failed_cnt);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    sprintf(text, "[res-mgr] throughput: %.1f/s, avg-load: %.1fms",
+        busy_tm > 0.0 ? (fl64)done_cnt/busy_tm : 0.0,
+        done_cnt != 0 ? 1000.0*stats->load_tm/(fl64)done_cnt : 0.0);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    /* queued requests per priority bucket */
+    char* t = text + sprintf(text, "[res-mgr] queue:");
+    for (uint i = 0; i < LOAD_QUEUE_BUCKET_CNT; i++)
+        t += sprintf(t, " %d", g_rs.load_queue.cnts[i]);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    /* texture mip streaming */
+    uint streamed_cnt = 0;
+    uint pending_cnt = 0;
+    const struct rs_resource* rss = (const struct rs_resource*)g_rs.ress.buffer;
+    for (int i = 0; i < g_rs.ress.item_cnt; i++)   {
+        const struct rs_resource* r = &rss[i];
+        if (r->hdl != INVALID_HANDLE && r->texstream.mip_cnt != 0)  {
+            streamed_cnt ++;
+            pending_cnt += (r->texstream.pending_mip != INVALID_INDEX) ? 1 : 0;
+        }
+    }
+    sprintf(text, "[res-mgr] tex-stream: %d, pending: %d, promoted: %d, demoted: %d",
+        streamed_cnt, pending_cnt, g_rs.texstream_stats.promote_cnt,
+        g_rs.texstream_stats.demote_cnt);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    /* gpu object creation of loaders, budgeted per frame */
+    struct gfx_delayed_stats dstats;
+    gfx_delayed_getstats(&dstats);
+    sprintf(text, "[res-mgr] gpu-creates: %d, deferred: %d, staging: %dkb/%dkb",
+        dstats.pending_cnt, dstats.deferred_cnt, dstats.staging_used/1024,
+        dstats.staging_size/1024);
+    gfx_canvas_text2dpt(text, x, y, 0);
+    y += line_stride;
+
+    return y;
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include "dhcore/vec-math.h"
 #include "dhcore/variant.h"
 #include "dhcore/hash-table.h"
+#include "dhcore/hash.h"
 #include "dhcore/stack-alloc.h"
 #include "dhcore/freelist-alloc.h"
 #include "dhcore/stack.h"
@@ -48,6 +49,7 @@
 #include "components/cmp-light.h"
 #include "components/cmp-lodmodel.h"
 #include "components/cmp-camera.h"
+#include "components/cmp-rbody.h"
 
 #define SCN_OBJ_BLOCKSIZE	200
 #define SCN_OCC_NEAR_THRESHOLD 10.0f /* N meters that we always draw occluders */
@@ -117,6 +119,8 @@ void scene_destroy(struct scn_data* s);
 void scene_destroy_objcmps(struct cmp_obj* obj);
 
 void scene_gather_models_csm(struct scn_data* s, struct array* objs);
+int scene_check_dynamiccaster(struct cmp_obj* obj);
+uint scene_get_casterid(struct cmp_obj* obj);
 
 /* object addition + lod */
 uint scene_add_model(struct cmp_obj* obj, uint bounds_idx, uint item_idx, struct array* mats,
@@ -599,6 +603,8 @@ struct scn_render_query* scn_create_query_csm(uint scene_id, struct allocator* a
     struct cmp_obj** spatial_culled_objs;
     uint spatial_culled_cnt;
     struct aabb* bounds = NULL;
+    int* dynamics = NULL;
+    uint* caster_ids = NULL;
     int* culls = NULL;
     uint item_idx = 0;
     uint obj_idx = 0;
@@ -620,14 +626,18 @@ struct scn_render_query* scn_create_query_csm(uint scene_id, struct allocator* a
     }
 
     bounds = (struct aabb*)A_ALIGNED_ALLOC(alloc, sizeof(struct aabb)*spatial_culled_cnt, MID_SCN);
-    if (bounds == NULL)
+    dynamics = (int*)A_ALLOC(alloc, sizeof(int)*spatial_culled_cnt, MID_SCN);
+    caster_ids = (uint*)A_ALLOC(alloc, sizeof(uint)*spatial_culled_cnt, MID_SCN);
+    if (bounds == NULL || dynamics == NULL || caster_ids == NULL)
         goto err_cleanup;
+    memset(caster_ids, 0x00, sizeof(uint)*spatial_culled_cnt);
 
     for (uint i = 0; i < spatial_culled_cnt; i++) {
         struct cmp_obj* obj = spatial_culled_objs[i];
         ASSERT(obj->bounds_cmp != INVALID_HANDLE);
         struct cmp_bounds* b = (struct cmp_bounds*)cmp_getinstancedata(obj->bounds_cmp);
         aabb_setb(&bounds[i], &b->ws_aabb);
+        dynamics[i] = scene_check_dynamiccaster(obj);
     }
 
     /* create models temp array and cull info array */
@@ -648,12 +658,15 @@ struct scn_render_query* scn_create_query_csm(uint scene_id, struct allocator* a
     /* sweep cull test */
     scene_cull_aabbs_sweep(culls, frust_bounds, dir_norm, bounds, 0, spatial_culled_cnt);
 
-    /* gather */
+    /* gather, casters are signed by the model that is drawn after lod is applied */
     for (uint i = 0; i < spatial_culled_cnt; i++) {
         if (culls[i]) {
             struct cmp_obj* obj = spatial_culled_objs[i];
-            item_idx += scene_add_model_shadow(obj, i, item_idx, &tmp_mats, &tmp_models, params,
+            uint cnt = scene_add_model_shadow(obj, i, item_idx, &tmp_mats, &tmp_models, params,
                 &obj_idx);
+            if (cnt > 0)
+                caster_ids[i] = scene_get_casterid(obj);
+            item_idx += cnt;
         }  /* endif: not culled */
     }
 
@@ -663,10 +676,13 @@ struct scn_render_query* scn_create_query_csm(uint scene_id, struct allocator* a
     rq->mats = (struct mat3f*)tmp_mats.buffer;
     rq->model_cnt = tmp_models.item_cnt;
     rq->models = (struct scn_render_model*)tmp_models.buffer;
+    rq->aabb_cnt = spatial_culled_cnt;
+    rq->aabbs = bounds; /* kept for per-cascade caster culling */
+    rq->dynamics = dynamics;    /* kept for static shadow caching */
+    rq->caster_ids = caster_ids;
 
     /* */
     A_FREE(alloc, culls);
-    A_FREE(alloc, bounds);
     arr_destroy(&tmp_objs);
 
     PRF_CLOSESAMPLE();
@@ -675,6 +691,10 @@ struct scn_render_query* scn_create_query_csm(uint scene_id, struct allocator* a
 err_cleanup:
     if (culls != NULL)
         A_FREE(alloc, culls);
+    if (dynamics != NULL)
+        A_FREE(alloc, dynamics);
+    if (caster_ids != NULL)
+        A_FREE(alloc, caster_ids);
     if (bounds != NULL)
         A_ALIGNED_FREE(alloc, bounds);
     arr_destroy(&tmp_models);
@@ -771,6 +791,15 @@ void scn_destroy_query(struct scn_render_query* query)
 	if (query->models != NULL)
 		A_ALIGNED_FREE(alloc, query->models);
 
+    if (query->aabbs != NULL)
+        A_ALIGNED_FREE(alloc, query->aabbs);
+
+    if (query->dynamics != NULL)
+        A_FREE(alloc, query->dynamics);
+
+    if (query->caster_ids != NULL)
+        A_FREE(alloc, query->caster_ids);
+
 	memset(query, 0x00, sizeof(struct scn_render_query));
 	A_FREE(alloc, query);
 }
@@ -887,6 +916,35 @@ void scene_gather_models_csm(struct scn_data* s, struct array* objs)
     }
 }
 
+/* casters that are animated, attached, simulated or have velocity are re-drawn every frame,
+ * the rest are treated as static and cached by csm (moving them just invalidates the cache) */
+int scene_check_dynamiccaster(struct cmp_obj* obj)
+{
+    if (obj->animchar_cmp != INVALID_HANDLE || obj->attach_cmp != INVALID_HANDLE)
+        return TRUE;
+
+    if (obj->rbody_cmp != INVALID_HANDLE)   {
+        struct cmp_rbody* rb = (struct cmp_rbody*)cmp_getinstancedata(obj->rbody_cmp);
+        if (rb->rbody != NULL && rb->rbody->type == PHX_OBJ_RIGID_DYN)
+            return TRUE;
+    }
+
+    if (obj->xform_cmp != INVALID_HANDLE)   {
+        struct cmp_xform* xf = (struct cmp_xform*)cmp_getinstancedata(obj->xform_cmp);
+        if (!vec3_isequal(&xf->vel_lin, &g_vec3_zero) || !vec3_isequal(&xf->vel_ang, &g_vec3_zero))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* model that the caster is drawn with, lod models are separate model components */
+uint scene_get_casterid(struct cmp_obj* obj)
+{
+    struct cmp_model* m = (struct cmp_model*)cmp_getinstancedata(obj->model_shadow_cmp);
+    return hash_u64(obj->model_shadow_cmp) ^ hash_u64(m->model_hdl);
+}
+
 /* unlike models, for each light we have exactly one light-object for scene-manager */
 uint scene_add_light(struct cmp_obj* obj, uint bounds_idx, uint item_idx, struct array* mats,
     struct array* lights, const struct gfx_view_params* params, OUT uint* obj_idx)
@@ -933,9 +991,23 @@ uint scene_add_model(struct cmp_obj* obj, uint bounds_idx, uint item_idx, struct
     if (m->model_hdl == INVALID_HANDLE)
         return 0;
 #endif
+    struct cmp_bounds* b = (struct cmp_bounds*)cmp_getinstancedata(obj->bounds_cmp);
+    struct vec3f d, campos;
+    vec3_setv(&campos, &params->cam_pos);
+    vec3_setf(&d, b->ws_s.x, b->ws_s.y, b->ws_s.z);
+    vec3_sub(&d, &d, &campos);
+    float dist = vec3_len(&d);
+
     struct gfx_model* gmodel = rs_get_model(m->model_hdl);
-    if (gmodel == NULL)
+    if (gmodel == NULL) {
+        /* model is still in background load queue, bring it forward by distance to the viewer */
+        rs_set_loadpriority(m->model_hdl, maxf(dist - b->ws_s.r, 0.0f));
         return 0;
+    }
+
+    /* stream texture mips by projected size of the bounding sphere (pixels) */
+    float screen_size = b->ws_s.r*params->proj.m22*(float)params->height/maxf(dist, b->ws_s.r);
+    gfx_model_requestmips(m->model_inst, gmodel->mtl_cnt, screen_size);
 
     for (uint i = 0, cnt = gmodel->renderable_cnt; i < cnt; i++)  {
         struct scn_render_model* rmodel = (struct scn_render_model*)arr_add(models);
@@ -309,13 +309,19 @@ sct_t sct_load(const char* lua_filepath, uint thread_id)
     void* buff = fio_detachmem(f, &size, NULL);
     fio_close(f);
 
+    sct_t s = sct_loadmem(lua_filepath, buff, size, thread_id);
+    A_FREE(tmp_alloc, buff);
+    A_LOAD(tmp_alloc);
+    return s;
+}
+
+/* 'data' is not copied or freed, it's usually a blob inside a resource bundle */
+sct_t sct_loadmem(const char* name, const void* data, size_t size, uint thread_id)
+{
     /* create lua_state and open libraries */
     lua_State* ls = lua_newstate(alloc_callback, NULL);
     if (ls == NULL) {
-        A_FREE(tmp_alloc, buff);
-        A_LOAD(tmp_alloc);
-        err_printf(__FILE__, __LINE__, "script: could not create lua_State for '%s'",
-            lua_filepath);
+        err_printf(__FILE__, __LINE__, "script: could not create lua_State for '%s'", name);
         return NULL;
     }
     lua_atpanic(ls, panic_callback);
@@ -328,13 +334,10 @@ sct_t sct_load(const char* lua_filepath, uint thread_id)
     luaopen_eng(ls);
 
     /* compile code */
-    int r = luaL_loadbuffer(ls, (const char*)buff, size, lua_filepath);
-    A_FREE(tmp_alloc, buff);
-    A_LOAD(tmp_alloc);
-
+    int r = luaL_loadbuffer(ls, (const char*)data, size, name);
     if (r != 0) {
         err_printf(__FILE__, __LINE__, "script: lua script '%s' failed: %s",
-            lua_filepath, sct_geterror(ls));
+            name, sct_geterror(ls));
         sct_unload(ls);
         return NULL;
     }
@@ -797,6 +800,12 @@ static void sct_removeevents(reshandle_t hdl)
     }
 }
 
+size_t sct_getsize(sct_t s)
+{
+    lua_State* ls = (lua_State*)s;
+    return (size_t)lua_gc(ls, LUA_GCCOUNT, 0)*1024 + (size_t)lua_gc(ls, LUA_GCCOUNTB, 0);
+}
+
 void sct_getmemstats(struct sct_memstats* stats)
 {
     stats->buff_alloc = mem_sizebyid(MID_SCT);
@@ -0,0 +1,58 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+
+#include "skin-palette.h"
+#include "gfx-model.h"
+
+void skin_palette_init(struct skin_palette* pal, uint bone_max)
+{
+    pal->frame = 0;
+    pal->bone_cnt = 0;
+    pal->bone_max = bone_max;
+    pal->overflow = FALSE;
+}
+
+void skin_palette_begin(struct skin_palette* pal)
+{
+    pal->frame ++;
+    pal->bone_cnt = 0;
+    pal->overflow = FALSE;
+}
+
+uint skin_palette_addpose(struct skin_palette* pal, struct gfx_model_posegpu* pose)
+{
+    /* shadow passes draw the same poses as the g-buffer, keep the first offset */
+    if (pose->palette_frame == pal->frame)
+        return INVALID_INDEX;
+
+    pose->palette_frame = pal->frame;
+    if (pal->bone_cnt + pose->mat_cnt > pal->bone_max)  {
+        /* no room, offsets of other poses can't be shared, so the pose is skipped this frame */
+        pose->palette_idx = INVALID_INDEX;
+        pal->overflow = TRUE;
+        return INVALID_INDEX;
+    }
+
+    pose->palette_idx = pal->bone_cnt;
+    pal->bone_cnt += pose->mat_cnt;
+    return pose->palette_idx;
+}
+
+uint skin_palette_getbytes(const struct skin_palette* pal)
+{
+    return pal->bone_cnt*(uint)SKIN_PALETTE_BONE_SIZE;
+}
@@ -0,0 +1,74 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+
+#include "staging-ring.h"
+
+void staging_ring_init(struct staging_ring* ring, uint size)
+{
+    memset(ring, 0x00, sizeof(struct staging_ring));
+    ring->size = size;
+}
+
+uint64 staging_ring_alloc(struct staging_ring* ring, uint size)
+{
+    size = (size + STAGING_RING_ALIGN - 1) & ~(STAGING_RING_ALIGN - 1);
+    if (ring->size == 0 || size > ring->size)
+        return STAGING_RING_NONE;
+
+    /* allocations are not split, skip to the start of the buffer if it doesn't fit at the end */
+    uint64 pos = ring->head;
+    uint offset = (uint)(pos % ring->size);
+    if (offset + size > ring->size)
+        pos += ring->size - offset;
+    if (pos + size - ring->tail > ring->size)
+        return STAGING_RING_NONE;
+
+    ring->head = pos + size;
+    return pos;
+}
+
+int staging_ring_needfence(const struct staging_ring* ring, uint64 end)
+{
+    uint64 last_end = ring->fence_cnt > 0 ?
+        ring->fences[(ring->fence_first + ring->fence_cnt - 1) % STAGING_RING_FENCE_MAX].end :
+        ring->tail;
+    return end > last_end;
+}
+
+struct staging_ring_fence* staging_ring_pushfence(struct staging_ring* ring, uint64 end)
+{
+    ASSERT(ring->fence_cnt < STAGING_RING_FENCE_MAX);
+    struct staging_ring_fence* f =
+        &ring->fences[(ring->fence_first + ring->fence_cnt) % STAGING_RING_FENCE_MAX];
+    f->sync = 0;
+    f->end = end;
+    ring->fence_cnt ++;
+    return f;
+}
+
+struct staging_ring_fence* staging_ring_oldestfence(struct staging_ring* ring)
+{
+    return ring->fence_cnt > 0 ? &ring->fences[ring->fence_first] : NULL;
+}
+
+void staging_ring_popfence(struct staging_ring* ring)
+{
+    ASSERT(ring->fence_cnt > 0);
+    ring->tail = ring->fences[ring->fence_first].end;
+    ring->fence_first = (ring->fence_first + 1) % STAGING_RING_FENCE_MAX;
+    ring->fence_cnt --;
+}
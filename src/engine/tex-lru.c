@@ -0,0 +1,85 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include "dhcore/core.h"
+
+#include "tex-lru.h"
+
+INLINE struct tex_lru_link* tex_lru_getlink(const struct tex_lru* lru, const void* items, uint idx)
+{
+    return (struct tex_lru_link*)((uint8*)items + (size_t)idx*lru->stride + lru->link_offset);
+}
+
+void tex_lru_init(struct tex_lru* lru, uint stride, uint link_offset)
+{
+    lru->first = INVALID_INDEX;
+    lru->last = INVALID_INDEX;
+    lru->cnt = 0;
+    lru->stride = stride;
+    lru->link_offset = link_offset;
+}
+
+void tex_lru_add(struct tex_lru* lru, void* items, uint idx)
+{
+    struct tex_lru_link* link = tex_lru_getlink(lru, items, idx);
+    link->prev = INVALID_INDEX;
+    link->next = lru->first;
+    if (lru->first != INVALID_INDEX)
+        tex_lru_getlink(lru, items, lru->first)->prev = idx;
+    else
+        lru->last = idx;
+    lru->first = idx;
+    lru->cnt ++;
+}
+
+void tex_lru_remove(struct tex_lru* lru, void* items, uint idx)
+{
+    struct tex_lru_link* link = tex_lru_getlink(lru, items, idx);
+    if (link->prev != INVALID_INDEX)
+        tex_lru_getlink(lru, items, link->prev)->next = link->next;
+    else
+        lru->first = link->next;
+    if (link->next != INVALID_INDEX)
+        tex_lru_getlink(lru, items, link->next)->prev = link->prev;
+    else
+        lru->last = link->prev;
+    link->prev = INVALID_INDEX;
+    link->next = INVALID_INDEX;
+    ASSERT(lru->cnt > 0);
+    lru->cnt --;
+}
+
+void tex_lru_touch(struct tex_lru* lru, void* items, uint idx)
+{
+    if (lru->first != idx)  {
+        tex_lru_remove(lru, items, idx);
+        tex_lru_add(lru, items, idx);
+    }
+}
+
+uint tex_lru_demote(const struct tex_lru* lru, const void* items, fl64 overflow,
+    pfn_tex_lru_demote demote_fn, void* param)
+{
+    uint visit_cnt = 0;
+    uint idx = lru->last;
+    while (idx != INVALID_INDEX && overflow > 0.0)   {
+        /* demote_fn may re-link the item, so fetch the next one first */
+        uint prev = tex_lru_getlink(lru, items, idx)->prev;
+        overflow -= demote_fn(idx, param);
+        visit_cnt ++;
+        idx = prev;
+    }
+    return visit_cnt;
+}
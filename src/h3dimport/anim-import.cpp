@@ -19,6 +19,7 @@
 #include "dhcore/json.h"
 
 #include "dheng/h3d-types.h"
+#include "dheng/anim.h"
 
 #include "assimp/cimport.h"
 #include "assimp/postprocess.h"
@@ -215,6 +216,19 @@ int import_anim(const struct import_params* params)
     return r;
 }
 
+int import_animctrl(const struct import_params* params)
+{
+    /* controller layout is owned by the engine, so let it load the json and write the image */
+    if (IS_FAIL(anim_ctrl_compile(params->in_filepath, params->out_filepath)))  {
+        printf(TERM_BOLDRED "Error: failed to compile animation controller '%s'\n" TERM_RESET,
+            params->in_filepath);
+        return FALSE;
+    }
+
+    printf(TERM_BOLDGREEN "ok, saved: \"%s\".\n" TERM_RESET, params->out_filepath);
+    return TRUE;
+}
+
 int import_writeanim(const char* filepath, const struct anim_ext* anim)
 {
     /* write to temp file and move it later */
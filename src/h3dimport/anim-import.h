@@ -20,5 +20,6 @@
 #include "h3dimport.h"
 
 int import_anim(const struct import_params* params);
+int import_animctrl(const struct import_params* params);
 
 #endif /* __ANIMIMPORT_H__ */
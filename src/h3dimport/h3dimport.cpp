@@ -77,6 +77,8 @@ static void cmdline_model(command_t* cmd, void* param)
 }
 static void cmdline_anim(command_t* cmd, void* param)
 {   ((struct import_params*)cmd->data)->type = IMPORT_ANIM;  }
+static void cmdline_animctrl(command_t* cmd, void* param)
+{   ((struct import_params*)cmd->data)->type = IMPORT_ANIMCTRL;  }
 static void cmdline_phx(command_t* cmd, void* param)
 {   
     struct import_params* p = (struct import_params*)cmd->data;
@@ -163,7 +165,8 @@ int main(int argc, char** argv)
     command_init(&cmd, argv[0], FULL_VERSION);    
     command_option_pos(&cmd, "input_file", "input resource file (geometry/anim/physics)", 0,
         cmdline_infile);
-    command_option_pos(&cmd, "output_file", "output h3dx file (h3da/h3dm/h3dp)", 1, cmdline_outfile);
+    command_option_pos(&cmd, "output_file", "output h3dx file (h3da/h3dm/h3dp/h3dc)", 1,
+        cmdline_outfile);
     command_option(&cmd, "-v", "--verbose", "enable verbose mode", cmdline_verbose);
     command_option(&cmd, "-f", "--fps <fps>", "specify fps (frames-per-second) sampling rate of the "
         "animation", cmdline_animfps);
@@ -172,6 +175,8 @@ int main(int argc, char** argv)
     command_option(&cmd, "-m", "--model [name]", "import model, must specify it's name inside resource", 
         cmdline_model);
     command_option(&cmd, "-a", "--animation", "import animation", cmdline_anim);
+    command_option(&cmd, "-A", "--anim-ctrl", "compile animation controller (json) to binary h3dc",
+        cmdline_animctrl);
     command_option(&cmd, "-t", "--texture", "import textures only (from model)", cmdline_tex);
     command_option(&cmd, "-p", "--physics [name]", "import physics data, must specify it's name "
         "inside resource", cmdline_phx);
@@ -230,6 +235,9 @@ int main(int argc, char** argv)
     case IMPORT_ANIM:
         ir = import_anim(&params);
         break;
+    case IMPORT_ANIMCTRL:
+        ir = import_animctrl(&params);
+        break;
     case IMPORT_TEXTURE:
         ir = import_texture(&params);
         break;
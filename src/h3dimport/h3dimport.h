@@ -32,7 +32,8 @@ enum import_type
     IMPORT_MODEL,
     IMPORT_ANIM,
     IMPORT_TEXTURE,
-    IMPORT_PHX
+    IMPORT_PHX,
+    IMPORT_ANIMCTRL
 };
 
 enum coord_type
@@ -17,8 +17,15 @@
 #include <stdio.h>
 #include "dhcore/core.h"
 #include "dhcore/zip.h"
-#include "dhcore/pak-file.h"
 #include "dhcore/commander.h"
+#include "dhcore/array.h"
+#include "dhcore/hash.h"
+#include "dhcore/hwinfo.h"
+#include "dhcore/task-mgr.h"
+
+#include "dheng/h3d-types.h"
+#include "dheng/res-mgr.h"
+#include "dheng/pak-archive.h"
 
 #if defined(_LINUX_) || defined(_OSX_)
 #include <dirent.h>
@@ -28,6 +35,9 @@
 
 #define VERSION     "1.0"
 #define FILE_SIZE_WARNING_THRESHOLD     (64*1024*1024)
+#define PAKI_THREADS_MAX    32
+#define PAKI_HASH_SEED      0x70616b69  /*paki*/
+#define PAKI_TMP_SIZE       (64*1024)
 
 /* application input arguments */
 enum PAKI_USAGE
@@ -35,7 +45,9 @@ enum PAKI_USAGE
     PAKI_USAGE_EXTRACT = (1 << 0),
     PAKI_USAGE_COMPRESS = (1 << 1),
     PAKI_USAGE_VERBOSE = (1 << 2),
-    PAKI_USAGE_LIST = (1 << 3)
+    PAKI_USAGE_LIST = (1 << 3),
+    PAKI_USAGE_UPDATE = (1 << 4),
+    PAKI_USAGE_BUNDLE = (1 << 5)
 };
 
 struct paki_args
@@ -47,15 +59,57 @@ struct paki_args
     uint err_cnt;
     uint warn_cnt;
     uint file_cnt;
+    uint thread_cnt;    /* compression threads, =0 uses cpu core count */
+};
+
+/* input file, it's content is read, hashed and compressed in worker threads ahead of pak
+ * write-out, main thread is the only writer */
+struct paki_entry
+{
+    char filepath[DH_PATH_MAX];
+    char alias[DH_PATH_MAX];    /* path inside pak, entries are sorted by alias */
+    uint job_id;
+    int failed;
+    size_t size;
+    uint hash;  /* hash of the file content, for incremental updates */
+    int packed; /* content is already compressed (BCn dds, ogg, png, jpg) */
+    enum compress_mode compress_mode;
+    struct pak_archive* prev;   /* previous pak for incremental updates, can be NULL */
+    uint prev_idx;  /* entry of previous pak with the same content, =INVALID_INDEX if changed */
+    enum pak_entry_mode mode;
+    void* data; /* data as it goes into the pak (compressed or raw), freed after write */
+    uint stored_size;
+};
+
+/* resource of a bundle that is built offline, data is the whole file */
+struct paki_bitem
+{
+    struct h3d_bundle_item item;
+    void* data;
+};
+
+/* bounded reader for scanning h3dm files */
+struct paki_reader
+{
+    const uint8* data;
+    size_t size;
+    size_t offset;
 };
 
 /* fwd declarations */
-result_t archive_put(struct pak_file* pak, struct paki_args* args, const char* srcfilepath, 
-    const char* destfilealias);
-result_t compress_directory(struct pak_file* pak, struct paki_args* args, const char* subdir);
+result_t gather_directory(struct array* entries, struct paki_args* args, const char* subdir);
+uint process_entries(struct pak_archive* pak, struct paki_args* args,
+    struct paki_entry* entries, uint entry_cnt);
+void read_entry_task(void* params, void* result, uint thread_id, uint job_id, int worker_idx);
+int detect_packed(const uint8* data, size_t size);
 void save_pak(struct paki_args* args);
 void load_pak(struct paki_args* args);
 void list_pak(struct paki_args* args);
+void save_bundle(struct paki_args* args);
+uint bundle_additem(struct array* items, struct paki_args* args, const char* root,
+    const char* filepath, uint type, uint flags);
+uint bundle_gettype(const char* filepath);
+int bundle_scanmodel(const uint8* data, size_t size, struct array* maps);
 
 /* callbacks for command line parsing */
 static void cmdline_extract(command_t* self, void* param)
@@ -80,6 +134,15 @@ static void cmdline_verbose(command_t* self, void* param)
 {   BIT_ADD(((struct paki_args*)self->data)->usage, PAKI_USAGE_VERBOSE);    }
 static void cmdline_list(command_t* self, void* param)
 {   BIT_ADD(((struct paki_args*)self->data)->usage, PAKI_USAGE_LIST);    }
+static void cmdline_update(command_t* self, void* param)
+{   BIT_ADD(((struct paki_args*)self->data)->usage, PAKI_USAGE_UPDATE);    }
+static void cmdline_bundle(command_t* self, void* param)
+{   BIT_ADD(((struct paki_args*)self->data)->usage, PAKI_USAGE_BUNDLE);    }
+static void cmdline_jobs(command_t* self, void* param)
+{
+    struct paki_args* args = (struct paki_args*)self->data;
+    args->thread_cnt = (uint)maxi(str_toint32(self->arg), 0);
+}
 static void cmdline_pakfile(command_t* self, void* param)
 {   
     struct paki_args* args = (struct paki_args*)self->data;
@@ -109,7 +172,15 @@ int main(int argc, char** argv)
     command_option(&cmd, "-x", "--extract", "extract a file from pak", cmdline_extract);
     command_option(&cmd, "-c", "--compress", "compress a directory into pak", cmdline_compress);
     command_option(&cmd, "-z", "--zmode <mode>", "define compression mode, "
-        "compression modes are (none, normal, best, fast)", cmdline_compressmode);
+        "compression modes are (none, normal, best, fast), already compressed files "
+        "(BCn dds, ogg, png, jpg) are always stored", cmdline_compressmode);
+    command_option(&cmd, "-u", "--update", "only compress files that are changed, unchanged "
+        "files are copied from existing pakfile", cmdline_update);
+    command_option(&cmd, "-b", "--bundle", "build a resource bundle (h3db) instead of pak, 'path' is "
+        "a list file with one resource path per line (relative to list file's directory), "
+        "textures can have 'srgb' and 'stream' options after the path", cmdline_bundle);
+    command_option(&cmd, "-j", "--jobs <count>", "number of threads that compress input files "
+        "(default: cpu core count)", cmdline_jobs);
     cmd.data = &args;
     command_parse(&cmd, argc, argv, NULL);
     command_free(&cmd);
@@ -121,14 +192,17 @@ int main(int argc, char** argv)
     if (args.pakfile[0] == 0 ||
         ((BIT_CHECK(args.usage, PAKI_USAGE_EXTRACT) +
           BIT_CHECK(args.usage, PAKI_USAGE_COMPRESS) +
-          BIT_CHECK(args.usage, PAKI_USAGE_LIST)) != 1))
+          BIT_CHECK(args.usage, PAKI_USAGE_LIST) +
+          BIT_CHECK(args.usage, PAKI_USAGE_BUNDLE)) != 1))
     {
         printf(TERM_BOLDRED "Invalid arguments\n" TERM_RESET);
         core_release(FALSE);
         return -1;
     }
 
-    if (BIT_CHECK(args.usage, PAKI_USAGE_EXTRACT) || BIT_CHECK(args.usage, PAKI_USAGE_COMPRESS)) {
+    if (BIT_CHECK(args.usage, PAKI_USAGE_EXTRACT) || BIT_CHECK(args.usage, PAKI_USAGE_COMPRESS) ||
+        BIT_CHECK(args.usage, PAKI_USAGE_BUNDLE))
+    {
         if (str_isempty(args.path)) {
             printf(TERM_BOLDRED "'path' argument is not provided\n" TERM_RESET);
             core_release(FALSE);
@@ -143,6 +217,8 @@ int main(int argc, char** argv)
         load_pak(&args);
     } else if(BIT_CHECK(args.usage, PAKI_USAGE_LIST))	{
     	list_pak(&args);
+    }   else if (BIT_CHECK(args.usage, PAKI_USAGE_BUNDLE))  {
+        save_bundle(&args);
     }
 
 #if defined(_DEBUG_)
@@ -153,39 +229,294 @@ int main(int argc, char** argv)
     return 0;
 }
 
+static int entry_cmp(const void* a, const void* b)
+{
+    return strcmp(((const struct paki_entry*)a)->alias, ((const struct paki_entry*)b)->alias);
+}
+
 void save_pak(struct paki_args* args)
 {
     result_t r;
-    struct pak_file pak;
+    struct pak_archive pak;
+    struct pak_archive prev;
+    struct array entries;
+    char tmp_filepath[DH_PATH_MAX];
 
     path_norm(args->pakfile, args->pakfile);
     path_norm(args->path, args->path);
+    strcat(strcpy(tmp_filepath, args->pakfile), ".tmp");
+    memset(&prev, 0x00, sizeof(prev));
 
-    r = pak_create(&pak, mem_heap(), args->pakfile, args->compress_mode, 0);
+    /* gather input files first and sort them, so archives are the same regardless of
+     * directory listing order */
+    r = arr_create(mem_heap(), &entries, sizeof(struct paki_entry), 256, 1024, 0);
+    if (IS_FAIL(r)) {
+        printf(TERM_BOLDRED "Not enough memory.\n" TERM_RESET);
+        return;
+    }
+
+    r = gather_directory(&entries, args, "");
     if (IS_FAIL(r))     {
-        err_sendtolog(FALSE);
+        arr_destroy(&entries);
         return;
     }
+    struct paki_entry* ents = (struct paki_entry*)entries.buffer;
+    uint ent_cnt = (uint)entries.item_cnt;
+    qsort(ents, ent_cnt, sizeof(struct paki_entry), entry_cmp);
+
+    /* incremental: entries of existing pak that have the same content are copied as is */
+    if (BIT_CHECK(args->usage, PAKI_USAGE_UPDATE))  {
+        file_t pf = fio_opendisk(args->pakfile, TRUE);
+        if (pf != NULL) {
+            fio_close(pf);
+            if (IS_FAIL(pak_archive_open(&prev, mem_heap(), args->pakfile)))    {
+                printf(TERM_BOLDYELLOW "Existing pak '%s' is not valid, rebuilding all files.\n"
+                    TERM_RESET, args->pakfile);
+                err_clear();
+                args->warn_cnt ++;
+            }
+        }
+    }
+
+    for (uint i = 0; i < ent_cnt; i++)  {
+        ents[i].compress_mode = args->compress_mode;
+        ents[i].prev = prev.f != NULL ? &prev : NULL;
+    }
 
+    /* files are compressed on worker threads, main thread writes them to pak in order */
+    struct hwinfo hwinfo;
+    hw_getinfo(&hwinfo, HWINFO_ALL);
+    uint thread_cnt = args->thread_cnt != 0 ? args->thread_cnt : hwinfo.cpu_core_cnt;
+    thread_cnt = minui(maxui(thread_cnt, 1), PAKI_THREADS_MAX);
+    if (IS_FAIL(tsk_initmgr(thread_cnt, 0, PAKI_TMP_SIZE, 0)))  {
+        err_sendtolog(FALSE);
+        pak_archive_close(&prev);
+        arr_destroy(&entries);
+        return;
+    }
+    args->thread_cnt = thread_cnt;
 
-    r = compress_directory(&pak, args, "");
+    /* new pak is written next to the previous one, because unchanged entries are read from it */
+    r = pak_archive_create(&pak, mem_heap(), tmp_filepath, args->compress_mode);
     if (IS_FAIL(r))     {
         err_sendtolog(FALSE);
-        pak_close(&pak);
+        tsk_releasemgr();
+        pak_archive_close(&prev);
+        arr_destroy(&entries);
         return;
     }
 
-    pak_close(&pak);
+    uint reused_cnt = process_entries(&pak, args, ents, ent_cnt);
+    int uptodate = prev.f != NULL && args->err_cnt == 0 && reused_cnt == ent_cnt &&
+        pak_archive_getcount(&prev) == ent_cnt;
+    pak_archive_close(&pak);
+    pak_archive_close(&prev);
+
+    uint stored_cnt = 0;
+    size_t total_sz = 0;
+    size_t stored_sz = 0;
+    for (uint i = 0; i < ent_cnt; i++)  {
+        total_sz += ents[i].size;
+        stored_sz += ents[i].stored_size;
+        if (ents[i].mode == PAK_ENTRY_STORED && !ents[i].failed)
+            stored_cnt ++;
+    }
+
+    tsk_releasemgr();
+    arr_destroy(&entries);
+
+    if (uptodate)   {
+        remove(tmp_filepath);
+        printf(TERM_BOLDWHITE "Pak '%s' is up to date (%d file(s))\n" TERM_RESET,
+            args->pakfile, ent_cnt);
+        return;
+    }
+
+    remove(args->pakfile);
+    if (rename(tmp_filepath, args->pakfile) != 0)   {
+        printf(TERM_BOLDRED "Saving pak failed: could not rename '%s' to '%s'.\n" TERM_RESET,
+            tmp_filepath, args->pakfile);
+        return;
+    }
 
     // report
     printf(TERM_BOLDWHITE "Saved pak: '%s'\nTotal %d file(s) - %d Error(s), %d Warning(s)\n" TERM_RESET,
                args->pakfile, args->file_cnt, args->err_cnt, args->warn_cnt);
+    printf(TERM_WHITE "%dkb -> %dkb, %d file(s) stored without compression, %d file(s) copied "
+        "from previous pak\n" TERM_RESET, (uint)(total_sz/1024), (uint)(stored_sz/1024),
+        stored_cnt, reused_cnt);
+}
+
+/* reads and compresses entries on worker threads (N files ahead) and puts them into pak in
+ * sorted order, returns number of entries that are copied from previous pak */
+uint process_entries(struct pak_archive* pak, struct paki_args* args,
+    struct paki_entry* entries, uint entry_cnt)
+{
+    int thread_idxs[PAKI_THREADS_MAX];
+    uint thread_cnt = args->thread_cnt;
+    uint reused_cnt = 0;
+    for (uint i = 0; i < thread_cnt; i++)
+        thread_idxs[i] = (int)i;
+
+    /* entry i is always processed by thread (i % thread_cnt), so the next entry of a thread is
+     * dispatched as soon as it's previous one is written */
+    for (uint i = 0; i < minui(thread_cnt, entry_cnt); i++)   {
+        entries[i].job_id = tsk_dispatch_exclusive(read_entry_task, &thread_idxs[i], 1,
+            &entries[i], &entries[i]);
+    }
+
+    for (uint i = 0; i < entry_cnt; i++)    {
+        struct paki_entry* e = &entries[i];
+        if (e->job_id != 0) {
+            tsk_wait(e->job_id);
+            tsk_destroy(e->job_id);
+            e->job_id = 0;
+        }   else    {
+            read_entry_task(e, e, 0, 0, 0);  /* could not dispatch, process it here */
+        }
+
+        uint next = i + thread_cnt;
+        if (next < entry_cnt)   {
+            entries[next].job_id = tsk_dispatch_exclusive(read_entry_task,
+                &thread_idxs[i % thread_cnt], 1, &entries[next], &entries[next]);
+        }
+
+        if (e->failed)  {
+            printf(TERM_BOLDRED "Reading file '%s' failed: file may not exist or locked.\n"
+                TERM_RESET, e->filepath);
+            args->err_cnt ++;
+            continue;
+        }
+
+        if (e->size > FILE_SIZE_WARNING_THRESHOLD)   {
+            printf(TERM_BOLDYELLOW "File '%s' have %dmb of size, which may be too large.\n"
+                TERM_RESET, e->filepath, (uint)(e->size/(1024*1024)));
+            args->warn_cnt ++;
+        }
+
+        result_t r;
+        if (e->prev_idx != INVALID_INDEX)   {
+            r = pak_archive_copy(pak, e->prev, e->prev_idx);
+            reused_cnt ++;
+        }   else    {
+            r = pak_archive_put(pak, e->alias, e->data, e->mode, e->stored_size, (uint)e->size,
+                e->hash);
+            A_FREE(mem_heap(), e->data);
+            e->data = NULL;
+        }
+
+        if (IS_OK(r) && BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE))     {
+            printf("%s%s\n", e->alias, e->prev_idx != INVALID_INDEX ? " (unchanged)" :
+                (e->mode == PAK_ENTRY_STORED ? " (stored)" : ""));
+        }   else if (IS_FAIL(r))  {
+            err_sendtolog(FALSE);
+            args->err_cnt ++;
+        }
+    }
+
+    return reused_cnt;
+}
+
+/* runs in worker threads, only reads the previous pak's entry table */
+void read_entry_task(void* params, void* result, uint thread_id, uint job_id, int worker_idx)
+{
+    struct paki_entry* e = (struct paki_entry*)params;
+    e->failed = TRUE;
+    e->prev_idx = INVALID_INDEX;
+
+    file_t f = fio_opendisk(e->filepath, TRUE);
+    if (f == NULL)
+        return;
+
+    e->size = fio_getsize(f);
+    uint8* data = (uint8*)A_ALLOC(mem_heap(), maxui((uint)e->size, 1), 0);
+    if (data == NULL || (e->size > 0 && fio_read(f, data, e->size, 1) != 1))  {
+        if (data != NULL)
+            A_FREE(mem_heap(), data);
+        fio_close(f);
+        return;
+    }
+    fio_close(f);
+
+    struct hash_incr hash;
+    hash_murmurincr_begin(&hash, PAKI_HASH_SEED);
+    hash_murmurincr_add(&hash, data, e->size);
+    e->hash = hash_murmurincr_end(&hash);
+    e->packed = detect_packed(data, e->size);
+    e->failed = FALSE;
+
+    /* unchanged content: previous entry is copied without compressing again, as long as it was
+     * compressed the same way */
+    if (e->prev != NULL)    {
+        uint idx = pak_archive_find(e->prev, e->alias);
+        if (idx != INVALID_INDEX)   {
+            const struct pak_archive_entry* pe = pak_archive_getentry(e->prev, idx);
+            int same_mode = e->packed ? pe->mode == PAK_ENTRY_STORED :
+                e->prev->header.compress_mode == (uint)e->compress_mode;
+            if (pe->hash == e->hash && pe->size == (uint)e->size && same_mode)   {
+                e->prev_idx = idx;
+                e->mode = (enum pak_entry_mode)pe->mode;
+                e->stored_size = pe->stored_size;
+                A_FREE(mem_heap(), data);
+                return;
+            }
+        }
+    }
+
+    /* already compressed formats are stored as is, compressing them again only costs load time */
+    void* compressed = NULL;
+    uint compressed_sz = 0;
+    e->mode = e->packed ? PAK_ENTRY_STORED :
+        pak_archive_compress(mem_heap(), data, (uint)e->size, e->compress_mode, &compressed,
+        &compressed_sz);
+    if (e->mode == PAK_ENTRY_DEFLATE)   {
+        A_FREE(mem_heap(), data);
+        e->data = compressed;
+        e->stored_size = compressed_sz;
+    }   else    {
+        e->data = data;
+        e->stored_size = (uint)e->size;
+    }
+}
+
+/* detects file formats that already have compressed data, by their header */
+int detect_packed(const uint8* data, size_t size)
+{
+    /* dds: block compressed (BCn) formats have fourcc pixel format (offset 84) */
+    if (size >= 88 && memcmp(data, "DDS ", 4) == 0)    {
+        const char* fourcc = (const char*)data + 84;
+        return memcmp(fourcc, "DXT", 3) == 0 || memcmp(fourcc, "ATI", 3) == 0 ||
+            memcmp(fourcc, "BC", 2) == 0;
+    }
+
+    if (size >= 4 && memcmp(data, "OggS", 4) == 0)
+        return TRUE;
+    if (size >= 4 && memcmp(data, "\x89PNG", 4) == 0)
+        return TRUE;
+    if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff)
+        return TRUE;
+    return FALSE;
+}
+
+static void add_entry(struct array* entries, struct paki_args* args, const char* srcfilepath,
+    const char* destfilealias)
+{
+    struct paki_entry* e = (struct paki_entry*)arr_add(entries);
+    if (e == NULL)  {
+        printf(TERM_BOLDRED "Not enough memory.\n" TERM_RESET);
+        args->err_cnt ++;
+        return;
+    }
+
+    memset(e, 0x00, sizeof(struct paki_entry));
+    str_safecpy(e->filepath, sizeof(e->filepath), srcfilepath);
+    path_tounix(e->alias, destfilealias);
+    args->file_cnt ++;
 }
 
 #if defined(_LINUX_) || defined(_OSX_)
-result_t compress_directory(struct pak_file* pak, struct paki_args* args, const char* subdir)
+result_t gather_directory(struct array* entries, struct paki_args* args, const char* subdir)
 {
-    result_t r;
     char directory[DH_PATH_MAX];
     char filepath[DH_PATH_MAX];
     char fullfilepath[DH_PATH_MAX];
@@ -202,7 +533,7 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
         return RET_FAIL;
     }
 
-    /* read directory recuresively, and compress files into pak */
+    /* read directory recuresively, and collect files */
     struct dirent* ent = readdir(dir);
     while (ent != NULL)     {
         if (!str_isequal(ent->d_name, ".") && !str_isequal(ent->d_name, ".."))    {
@@ -211,21 +542,14 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
                strcpy(filepath, subdir);
 
             if (ent->d_type != DT_DIR)  {
-                // put the file into the archive
+                // add the file to archive entries
                 path_join(filepath, filepath, ent->d_name, NULL);
                 path_join(fullfilepath, directory, ent->d_name, NULL);
-                r = archive_put(pak, args, fullfilepath, filepath);
-                if (IS_OK(r) && BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE))     {
-                    puts(filepath);
-                }   else if (IS_FAIL(r))  {
-                    err_sendtolog(FALSE);
-                    args->err_cnt ++;
-                }
-                args->file_cnt ++;
+                add_entry(entries, args, fullfilepath, filepath);
             }   else    {
                 // it's a directory, recurse
                 path_join(filepath, filepath, ent->d_name, NULL);
-                compress_directory(pak, args, filepath);
+                gather_directory(entries, args, filepath);
             }
         }
         ent = readdir(dir);
@@ -235,9 +559,8 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
     return RET_OK;
 }
 #elif defined(_WIN_)
-result_t compress_directory(struct pak_file* pak, struct paki_args* args, const char* subdir)
+result_t gather_directory(struct array* entries, struct paki_args* args, const char* subdir)
 {
-    result_t r;
     char directory[DH_PATH_MAX];
     char filepath[DH_PATH_MAX];
     char fullfilepath[DH_PATH_MAX];
@@ -257,7 +580,7 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
         return RET_FAIL;
     }
 
-    /* read directory recuresively, and compress files into pak */
+    /* read directory recuresively, and collect files */
     BOOL fr = TRUE;
     while (fr)     {
         if (!str_isequal(fdata.cFileName, ".") && !str_isequal(fdata.cFileName, ".."))    {
@@ -267,22 +590,14 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
             }
 
             if (!BIT_CHECK(fdata.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))  {
-                /* put the file into the archive */
+                /* add the file to archive entries */
                 path_join(filepath, filepath, fdata.cFileName, NULL);
                 path_join(fullfilepath, directory, fdata.cFileName, NULL);
-
-                r = archive_put(pak, args, fullfilepath, filepath);
-                if (IS_OK(r) && BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE))     {
-                    puts(filepath);
-                }   else if (IS_FAIL(r))  {
-                    err_sendtolog(FALSE);
-                    args->err_cnt ++;
-                }
-                args->file_cnt ++;
+                add_entry(entries, args, fullfilepath, filepath);
             }   else    {
                 /* it's a directory, recurse */
                 path_join(filepath, filepath, fdata.cFileName, NULL);
-                compress_directory(pak, args, filepath);
+                gather_directory(entries, args, filepath);
             }
         }
         fr = FindNextFile(find_hdl, &fdata);
@@ -293,80 +608,51 @@ result_t compress_directory(struct pak_file* pak, struct paki_args* args, const
 }
 #endif
 
-result_t archive_put(struct pak_file* pak, struct paki_args* args,
-                     const char* srcfilepath, const char* destfilealias)
-{
-    result_t r;
-
-    file_t f = fio_opendisk(srcfilepath, TRUE);
-    if (f == NULL)     {
-        printf(TERM_BOLDRED "Packing file '%s' failed: file may not exist or locked.\n" TERM_RESET,
-        		srcfilepath);
-        return RET_FILE_ERROR;
-    }
-
-    if (fio_getsize(f) > FILE_SIZE_WARNING_THRESHOLD)   {
-        printf(TERM_BOLDYELLOW "File '%s' have %dmb of size, which may be too large.\n" TERM_RESET,
-        		srcfilepath, (uint)fio_getsize(f)/(1024*1024));
-        args->warn_cnt ++;
-    }
-
-    char alias[DH_PATH_MAX];
-    r = pak_putfile(pak, mem_heap(), f, path_tounix(alias, destfilealias));
-    fio_close(f);
-
-    return r;
-}
-
 void load_pak(struct paki_args* args)
 {
     result_t r;
-    struct pak_file pak;
+    struct pak_archive pak;
     char filename[DH_PATH_MAX];
 
     path_norm(args->pakfile, args->pakfile);
     path_tounix(args->path, args->path);
 
-    r = pak_open(&pak, mem_heap(), args->pakfile, 0);
+    r = pak_archive_open(&pak, mem_heap(), args->pakfile);
     if (IS_FAIL(r))     {
         err_sendtolog(FALSE);
         return;
     }
 
-    uint file_id = pak_findfile(&pak, args->path);
+    uint file_id = pak_archive_find(&pak, args->path);
     if (file_id == INVALID_INDEX)   {
         printf(TERM_BOLDRED "Extract failed: file '%s' not found in pak.\n" TERM_RESET, args->path);
-        pak_close(&pak);
+        pak_archive_close(&pak);
         return;
     }
 
+    void* buffer = pak_archive_read(&pak, mem_heap(), file_id);
+    if (buffer == NULL)   {
+        pak_archive_close(&pak);
+        err_sendtolog(FALSE);
+        return;
+    }
+    size_t size = pak_archive_getentry(&pak, file_id)->size;
+    pak_archive_close(&pak);
+
     path_getfullfilename(filename, args->path);
     file_t f = fio_createdisk(filename);
     if (f == NULL)     {
         printf(TERM_BOLDRED "Extract failed: could not create '%s' for writing.\n" TERM_RESET,
         		filename);
-        pak_close(&pak);
-        err_sendtolog(FALSE);
-        return;
-    }
-
-    file_t src_file = pak_getfile(&pak, mem_heap(), mem_heap(), file_id, 0);
-    if (src_file == NULL)   {
-        pak_close(&pak);
-        fio_close(f);
+        A_FREE(mem_heap(), buffer);
         err_sendtolog(FALSE);
         return;
     }
 
-    size_t size;
-    struct allocator* alloc;
-    void* buffer = fio_detachmem(src_file, &size, &alloc);
     fio_write(f, buffer, size, 1);
-    A_FREE(alloc, buffer);
+    A_FREE(mem_heap(), buffer);
     fio_close(f);
 
-    pak_close(&pak);
-
     if (BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE)) {
         printf(TERM_WHITE "%s -> %s\n" TERM_RESET, args->path, filename);
     }
@@ -380,29 +666,386 @@ void load_pak(struct paki_args* args)
 void list_pak(struct paki_args* args)
 {
 	result_t r;
-    struct pak_file pak;
-    r = pak_open(&pak, mem_heap(), args->pakfile, 0);
+    struct pak_archive pak;
+    r = pak_archive_open(&pak, mem_heap(), args->pakfile);
     if (IS_FAIL(r))     {
         err_sendtolog(FALSE);
         return;
     }
 
-    uint cnt = INVALID_INDEX;
-	char* filelist = pak_createfilelist(&pak, mem_heap(), &cnt);
-    pak_close(&pak);
+    uint cnt = pak_archive_getcount(&pak);
 	if (cnt == 0)	{
 		printf(TERM_BOLDWHITE "There are no files in the pak '%s'.\n" TERM_RESET, args->pakfile);
-		return;
-	}
-
-	if (filelist == NULL)	{
-		printf(TERM_BOLDRED "Not enough memory.\n" TERM_RESET);
+        pak_archive_close(&pak);
 		return;
 	}
 
 	for (uint i = 0; i < cnt; i++)	{
-		printf(TERM_WHITE "%s\n" TERM_RESET, filelist + i*DH_PATH_MAX);
+        const struct pak_archive_entry* e = pak_archive_getentry(&pak, i);
+        if (BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE)) {
+            printf(TERM_WHITE "%s (%s, %u -> %u bytes)\n" TERM_RESET, e->alias,
+                e->mode == PAK_ENTRY_STORED ? "stored" : "deflate", e->size, e->stored_size);
+        }   else    {
+		    printf(TERM_WHITE "%s\n" TERM_RESET, e->alias);
+        }
 	}
 	printf(TERM_BOLDWHITE "Total %d files in '%s'.\n" TERM_RESET, cnt, args->pakfile);
-	FREE(filelist);
+    pak_archive_close(&pak);
+}
+
+/* bundle files are the same as the ones saved by rs_bundle_save, so levels can be packed without
+ * running the engine. model textures are found by scanning h3dm files and linked as dependencies */
+void save_bundle(struct paki_args* args)
+{
+    char root[DH_PATH_MAX];
+    struct array items; /* item: paki_bitem */
+    struct array dep_idxs;  /* item: uint */
+
+    path_norm(args->pakfile, args->pakfile);
+    path_norm(args->path, args->path);
+    path_getdir(root, args->path);
+
+    file_t lf = fio_opendisk(args->path, TRUE);
+    if (lf == NULL) {
+        printf(TERM_BOLDRED "Creating bundle failed: could not open list file '%s'.\n" TERM_RESET,
+            args->path);
+        return;
+    }
+
+    size_t list_sz = fio_getsize(lf);
+    char* list = (char*)A_ALLOC(mem_heap(), list_sz + 1, 0);
+    result_t r = arr_create(mem_heap(), &items, sizeof(struct paki_bitem), 64, 256, 0);
+    r |= arr_create(mem_heap(), &dep_idxs, sizeof(uint), 64, 256, 0);
+    if (list == NULL || IS_FAIL(r))    {
+        printf(TERM_BOLDRED "Not enough memory.\n" TERM_RESET);
+        fio_close(lf);
+        if (list != NULL)
+            A_FREE(mem_heap(), list);
+        arr_destroy(&items);
+        arr_destroy(&dep_idxs);
+        return;
+    }
+    fio_read(lf, list, list_sz, 1);
+    list[list_sz] = 0;
+    fio_close(lf);
+
+    /* list items: "<path> [srgb] [stream]", empty lines and lines that start with '#' are skipped */
+    char* line = list;
+    while (line != NULL && *line != 0)  {
+        char* next = strchr(line, '\n');
+        if (next != NULL)
+            *next++ = 0;
+
+        char* tok = strtok(line, " \t\r");
+        if (tok != NULL && tok[0] != '#')  {
+            char filepath[DH_PATH_MAX];
+            path_tounix(filepath, tok);
+            uint flags = 0;
+            while ((tok = strtok(NULL, " \t\r")) != NULL)   {
+                if (str_isequal_nocase(tok, "srgb"))
+                    flags |= H3D_BUNDLE_SRGB;
+                else if (str_isequal_nocase(tok, "stream"))
+                    flags |= H3D_BUNDLE_STREAMMIPS;
+                else
+                    printf(TERM_BOLDYELLOW "Unknown option '%s' for '%s'.\n" TERM_RESET, tok, filepath);
+            }
+
+            uint type = bundle_gettype(filepath);
+            if (type != RS_RESOURCE_UNKNOWN)   {
+                bundle_additem(&items, args, root, filepath, type, flags);
+            }   else    {
+                printf(TERM_BOLDRED "Unknown resource type '%s'.\n" TERM_RESET, filepath);
+                args->err_cnt ++;
+            }
+        }
+        line = next;
+    }
+    A_FREE(mem_heap(), list);
+
+    /* textures of models, items grow while iterating.
+     * texture flags follow rs_model_loaddeps (srgb by map type, mips are streamed) */
+    struct array maps;  /* item: h3d_texture */
+    if (IS_FAIL(arr_create(mem_heap(), &maps, sizeof(struct h3d_texture), 8, 16, 0)))
+        args->err_cnt ++;
+    for (int i = 0; i < items.item_cnt && args->err_cnt == 0; i++)    {
+        struct paki_bitem* bi = &((struct paki_bitem*)items.buffer)[i];
+        bi->item.dep_first = (uint)dep_idxs.item_cnt;
+        if (bi->item.type != RS_RESOURCE_MODEL)
+            continue;
+
+        arr_clear(&maps);
+        if (!bundle_scanmodel((const uint8*)bi->data, bi->item.size, &maps))    {
+            printf(TERM_BOLDRED "Reading model '%s' failed: invalid file format.\n" TERM_RESET,
+                bi->item.filepath);
+            args->err_cnt ++;
+            break;
+        }
+
+        char filepath[DH_PATH_MAX];
+        for (int k = 0; k < maps.item_cnt; k++) {
+            const struct h3d_texture* tex = &((const struct h3d_texture*)maps.buffer)[k];
+            uint flags = H3D_BUNDLE_STREAMMIPS;
+            if (tex->type == H3D_TEXTURE_DIFFUSE || tex->type == H3D_TEXTURE_REFLECTION ||
+                tex->type == H3D_TEXTURE_EMISSIVE)
+            {
+                flags |= H3D_BUNDLE_SRGB;
+            }
+            uint idx = bundle_additem(&items, args, root, path_tounix(filepath, tex->filepath),
+                RS_RESOURCE_TEXTURE, flags);
+            uint* dep_idx = (idx != INVALID_INDEX) ? (uint*)arr_add(&dep_idxs) : NULL;
+            if (dep_idx != NULL)
+                *dep_idx = idx;
+        }
+
+        /* items may have moved */
+        bi = &((struct paki_bitem*)items.buffer)[i];
+        bi->item.dep_cnt = (uint)dep_idxs.item_cnt - bi->item.dep_first;
+    }
+    arr_destroy(&maps);
+
+    struct paki_bitem* bitems = (struct paki_bitem*)items.buffer;
+    uint item_cnt = (uint)items.item_cnt;
+    file_t f = NULL;
+    if (args->err_cnt == 0 && item_cnt > 0) {
+        f = fio_createdisk(args->pakfile);
+        if (f == NULL)  {
+            printf(TERM_BOLDRED "Creating bundle failed: could not create '%s'.\n" TERM_RESET,
+                args->pakfile);
+            args->err_cnt ++;
+        }
+    }
+
+    if (f != NULL)  {
+        static const uint8 zeros[H3D_BUNDLE_ALIGN] = {0};
+        size_t table_size = sizeof(struct h3d_header) + sizeof(struct h3d_bundle) +
+            item_cnt*sizeof(struct h3d_bundle_item) + dep_idxs.item_cnt*sizeof(uint);
+        size_t table_pad = ((table_size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1)) -
+            table_size;
+
+        struct h3d_header header;
+        header.sign = H3D_SIGN;
+        header.type = H3D_BUNDLE;
+        header.version = H3D_VERSION;
+        header.data_offset = (uint)(table_size + table_pad);
+
+        struct h3d_bundle hbundle;
+        hbundle.item_cnt = item_cnt;
+        hbundle.dep_cnt = (uint)dep_idxs.item_cnt;
+
+        uint offset = 0;
+        for (uint i = 0; i < item_cnt; i++) {
+            bitems[i].item.offset = offset;
+            offset += (bitems[i].item.size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1);
+        }
+
+        fio_write(f, &header, sizeof(header), 1);
+        fio_write(f, &hbundle, sizeof(hbundle), 1);
+        for (uint i = 0; i < item_cnt; i++)
+            fio_write(f, &bitems[i].item, sizeof(struct h3d_bundle_item), 1);
+        fio_write(f, dep_idxs.buffer, sizeof(uint), dep_idxs.item_cnt);
+        fio_write(f, zeros, 1, table_pad);
+        for (uint i = 0; i < item_cnt; i++) {
+            uint size = bitems[i].item.size;
+            fio_write(f, bitems[i].data, size, 1);
+            fio_write(f, zeros, 1, ((size + H3D_BUNDLE_ALIGN - 1) & ~(H3D_BUNDLE_ALIGN - 1)) - size);
+        }
+        fio_close(f);
+    }
+
+    for (uint i = 0; i < item_cnt; i++)
+        A_FREE(mem_heap(), bitems[i].data);
+    arr_destroy(&dep_idxs);
+    arr_destroy(&items);
+
+    // report
+    printf(TERM_BOLDWHITE "%s bundle: '%s'\nTotal %d file(s) - %d Error(s), %d Warning(s)\n"
+        TERM_RESET, args->err_cnt == 0 ? "Saved" : "Failed", args->pakfile, item_cnt,
+        args->err_cnt, args->warn_cnt);
+}
+
+/* reads the file into a new item if it's not already added, returns item index,
+ * =INVALID_INDEX if failed */
+uint bundle_additem(struct array* items, struct paki_args* args, const char* root,
+    const char* filepath, uint type, uint flags)
+{
+    struct paki_bitem* bitems = (struct paki_bitem*)items->buffer;
+    uint path_id = hash_str(filepath);
+    for (int i = 0; i < items->item_cnt; i++)   {
+        if (bitems[i].item.path_id == path_id && str_isequal(bitems[i].item.filepath, filepath))
+            return (uint)i;
+    }
+
+    if (strlen(filepath) >= sizeof(bitems->item.filepath))   {
+        printf(TERM_BOLDRED "Path '%s' is too long for bundles.\n" TERM_RESET, filepath);
+        args->err_cnt ++;
+        return INVALID_INDEX;
+    }
+
+    char fullpath[DH_PATH_MAX];
+    path_join(fullpath, root, filepath, NULL);
+    file_t f = fio_opendisk(fullpath, TRUE);
+    if (f == NULL)  {
+        printf(TERM_BOLDRED "Reading file '%s' failed: file may not exist or locked.\n"
+            TERM_RESET, fullpath);
+        args->err_cnt ++;
+        return INVALID_INDEX;
+    }
+
+    size_t size = fio_getsize(f);
+    struct paki_bitem* bi = (struct paki_bitem*)arr_add(items);
+    void* data = A_ALLOC(mem_heap(), size + 1, 0);
+    if (bi == NULL || data == NULL)  {
+        printf(TERM_BOLDRED "Not enough memory.\n" TERM_RESET);
+        if (bi != NULL)
+            items->item_cnt --;
+        if (data != NULL)
+            A_FREE(mem_heap(), data);
+        fio_close(f);
+        args->err_cnt ++;
+        return INVALID_INDEX;
+    }
+    fio_read(f, data, size, 1);
+    fio_close(f);
+
+    memset(bi, 0x00, sizeof(struct paki_bitem));
+    strcpy(bi->item.filepath, filepath);
+    bi->item.path_id = path_id;
+    bi->item.type = type;
+    bi->item.flags = flags;
+    bi->item.size = (uint)size;
+    bi->data = data;
+
+    if (size > FILE_SIZE_WARNING_THRESHOLD)   {
+        printf(TERM_BOLDYELLOW "File '%s' have %dmb of size, which may be too large.\n" TERM_RESET,
+            fullpath, (uint)(size/(1024*1024)));
+        args->warn_cnt ++;
+    }
+    if (BIT_CHECK(args->usage, PAKI_USAGE_VERBOSE))
+        printf("%s\n", filepath);
+    return (uint)(items->item_cnt - 1);
+}
+
+/* resource types by file extension, same as the ones that rs_load_XXXX accept */
+uint bundle_gettype(const char* filepath)
+{
+    char ext[DH_PATH_MAX];
+    path_getfileext(ext, filepath);
+    if (str_isequal_nocase(ext, "dds"))
+        return RS_RESOURCE_TEXTURE;
+    else if (str_isequal_nocase(ext, "h3dm"))
+        return RS_RESOURCE_MODEL;
+    else if (str_isequal_nocase(ext, "h3dp"))
+        return RS_RESOURCE_PHXPREFAB;
+    else if (str_isequal_nocase(ext, "h3da"))
+        return RS_RESOURCE_ANIMREEL;
+    else if (str_isequal_nocase(ext, "json") || str_isequal_nocase(ext, "h3dc"))
+        return RS_RESOURCE_ANIMCTRL;
+    else if (str_isequal_nocase(ext, "lua"))
+        return RS_RESOURCE_SCRIPT;
+    return RS_RESOURCE_UNKNOWN;
+}
+
+static int bundle_read(struct paki_reader* rd, void* buf, size_t size)
+{
+    if (size > rd->size - rd->offset)
+        return FALSE;
+    if (buf != NULL)
+        memcpy(buf, rd->data + rd->offset, size);
+    rd->offset += size;
+    return TRUE;
+}
+
+static int bundle_hasvertid(const struct h3d_geo* geo, uint id)
+{
+    for (uint i = 0; i < minui(geo->vert_id_cnt, GFX_INPUTELEMENT_ID_CNT); i++)  {
+        if (geo->vert_ids[i] == id)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* collects texture maps of a h3dm file, the file is walked in the same order as
+ * gfx_model_loadmem without creating anything */
+int bundle_scanmodel(const uint8* data, size_t size, struct array* maps)
+{
+    struct paki_reader rd;
+    rd.data = data;
+    rd.size = size;
+    rd.offset = 0;
+
+    struct h3d_header header;
+    struct h3d_model h3dmodel;
+    if (!bundle_read(&rd, &header, sizeof(header)) || header.sign != H3D_SIGN ||
+        header.type != H3D_MESH ||
+        (header.version != H3D_VERSION && header.version != H3D_VERSION_13) ||
+        !bundle_read(&rd, &h3dmodel, sizeof(h3dmodel)))
+    {
+        return FALSE;
+    }
+
+    for (uint i = 0; i < h3dmodel.node_cnt; i++)    {
+        struct h3d_node node;
+        if (!bundle_read(&rd, &node, sizeof(node)) ||
+            !bundle_read(&rd, NULL, sizeof(uint)*(size_t)node.child_cnt))
+        {
+            return FALSE;
+        }
+    }
+
+    for (uint i = 0; i < h3dmodel.mesh_cnt; i++)    {
+        struct h3d_mesh mesh;
+        if (!bundle_read(&rd, &mesh, sizeof(mesh)) ||
+            !bundle_read(&rd, NULL, sizeof(struct h3d_submesh)*(size_t)mesh.submesh_cnt))
+        {
+            return FALSE;
+        }
+    }
+
+    for (uint i = 0; i < h3dmodel.geo_cnt; i++) {
+        struct h3d_geo geo;
+        if (!bundle_read(&rd, &geo, sizeof(geo)))
+            return FALSE;
+
+        size_t vert_cnt = geo.vert_cnt;
+        size_t sz = sizeof(struct h3d_geo_subset)*(size_t)geo.subset_cnt +
+            (geo.ib_isui32 ? sizeof(uint) : sizeof(uint16))*(size_t)geo.tri_cnt*3;
+        if (bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_POSITION) ||
+            bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_NORMAL) ||
+            bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_TEXCOORD0))
+        {
+            sz += sizeof(struct h3d_vertex_base)*vert_cnt;
+        }
+        if (bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_BLENDINDEX) ||
+            bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_BLENDWEIGHT))
+        {
+            sz += sizeof(struct h3d_vertex_skin)*vert_cnt;
+        }
+        if (bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_TANGENT) ||
+            bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_BINORMAL))
+        {
+            sz += sizeof(struct h3d_vertex_nmap)*vert_cnt;
+        }
+        if (bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_TEXCOORD1) ||
+            bundle_hasvertid(&geo, GFX_INPUTELEMENT_ID_COLOR))
+        {
+            sz += sizeof(struct h3d_vertex_extra)*vert_cnt;
+        }
+        sz += (sizeof(struct h3d_joint) + sizeof(struct mat3f))*(size_t)geo.joint_cnt;
+        if (!bundle_read(&rd, NULL, sz))
+            return FALSE;
+    }
+
+    for (uint i = 0; i < h3dmodel.mtl_cnt; i++) {
+        struct h3d_mtl mtl;
+        if (!bundle_read(&rd, &mtl, sizeof(mtl)))
+            return FALSE;
+        for (uint k = 0; k < mtl.texture_cnt; k++)  {
+            struct h3d_texture* tex = (struct h3d_texture*)arr_add(maps);
+            if (tex == NULL || !bundle_read(&rd, tex, sizeof(struct h3d_texture)))
+                return FALSE;
+            tex->filepath[sizeof(tex->filepath) - 1] = 0;
+        }
+    }
+
+    return TRUE;
 }
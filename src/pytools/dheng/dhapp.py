@@ -97,11 +97,20 @@ class InitParams(Structure):
             ('adapter_id', c_uint),
             ('width', c_uint),
             ('height', c_uint),
-            ('refresh_rate', c_uint)]
+            ('refresh_rate', c_uint),
+            ('upload_budget', c_uint),
+            ('upload_objs_max', c_uint),
+            ('light_slices', c_uint),
+            ('cluster_lights_max', c_uint),
+            ('csm_cascades', c_uint),
+            ('csm_size', c_uint),
+            ('csm_far', c_float),
+            ('csm_lambda', c_float)]
 
     _fields_ = [\
         ('flags', c_uint),
         ('console_lines_max', c_uint),
+        ('load_threads_max', c_uint),
         ('gfx', GfxParams),
         ('dev', DevParams),
         ('phx', PhxParams),
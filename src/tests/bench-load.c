@@ -0,0 +1,205 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/* headless load-throughput benchmark
+ * files are loaded by slots that are dispatched to task threads the same way res-mgr does it
+ * (see rs_update), each load reads the file and hashes it's contents in place of parsing.
+ * continuously refilled slots are compared with batch dispatch, that waits for the whole batch
+ * before starting the next one. the file set mixes many small files with a few big ones
+ * usage: dhtests --bench-load [file-count] [threads] */
+
+#include <stdio.h>
+#include "dhcore/core.h"
+#include "dhcore/file-io.h"
+#include "dhcore/task-mgr.h"
+#include "dhcore/vec-math.h"
+#include "dhcore/timer.h"
+#include "dhcore/hash.h"
+#include "dhcore/util.h"
+
+#include "mem-ids.h"
+#include "tests.h"
+
+#define BENCH_THREADS_MAX 16
+#define BENCH_SMALL_SIZE (16*1024)
+#define BENCH_BIG_SIZE (2*1024*1024)
+#define BENCH_BIG_STRIDE 16 /* every Nth file is big */
+#define BENCH_POLL_MS 1 /* main thread checks the slots with this interval (a very fast frame) */
+
+struct bench_slot
+{
+    uint job_id;    /* =0 if slot is idle */
+    int thread_idx;
+    uint file_idx;
+    uint checksum;  /* result */
+    fl64 load_tm;   /* result */
+};
+
+struct bench_result
+{
+    fl64 tm;
+    fl64 load_tm;
+    uint checksum;
+};
+
+static void bench_filepath(char* filepath, uint idx)
+{
+    sprintf(filepath, "bench-load-%u.bin", idx);
+}
+
+static uint bench_filesize(uint idx)
+{
+    return (idx % BENCH_BIG_STRIDE) == BENCH_BIG_STRIDE - 1 ? BENCH_BIG_SIZE : BENCH_SMALL_SIZE;
+}
+
+static int bench_createfiles(uint file_cnt, uint64* total_bytes)
+{
+    static uint8 data[BENCH_BIG_SIZE];
+    for (uint i = 0; i < sizeof(data); i++)
+        data[i] = (uint8)(i*31 + (i >> 8));
+
+    *total_bytes = 0;
+    for (uint i = 0; i < file_cnt; i++)   {
+        char filepath[64];
+        bench_filepath(filepath, i);
+        FILE* f = fopen(filepath, "wb");
+        if (f == NULL)
+            return FALSE;
+        data[0] = (uint8)i;
+        size_t sz = bench_filesize(i);
+        int r = fwrite(data, 1, sz, f) == sz;
+        fclose(f);
+        if (!r)
+            return FALSE;
+        *total_bytes += sz;
+    }
+    return TRUE;
+}
+
+static void bench_removefiles(uint file_cnt)
+{
+    for (uint i = 0; i < file_cnt; i++)   {
+        char filepath[64];
+        bench_filepath(filepath, i);
+        remove(filepath);
+    }
+}
+
+/* Runs in task threads */
+static void bench_load_fn(void* params, void* result, uint thread_id, uint job_id,
+                          int worker_idx)
+{
+    struct bench_slot* slot = (struct bench_slot*)params;
+    uint64 start_tick = timer_querytick();
+    struct allocator* tmp_alloc = tsk_get_tmpalloc(thread_id);
+    char filepath[64];
+    bench_filepath(filepath, slot->file_idx);
+
+    slot->checksum = 0;
+    A_SAVE(tmp_alloc);
+    file_t f = fio_openmem(tmp_alloc, filepath, FALSE, MID_RES);
+    if (f != NULL)  {
+        size_t size;
+        void* buff = fio_detachmem(f, &size, NULL);
+        slot->checksum = hash_murmur32(buff, size, slot->file_idx);
+        A_FREE(tmp_alloc, buff);
+        fio_close(f);
+    }
+    A_LOAD(tmp_alloc);
+
+    slot->load_tm = timer_calctm(start_tick, timer_querytick());
+}
+
+/* batched: idle slots are filled only when all of them are idle */
+static void bench_run(struct bench_slot* slots, uint slot_cnt, uint file_cnt, int batched,
+                      struct bench_result* result)
+{
+    uint next_idx = 0;
+    uint done_cnt = 0;
+    uint64 start_tick = timer_querytick();
+    memset(result, 0x00, sizeof(struct bench_result));
+
+    while (done_cnt < file_cnt)   {
+        uint busy_cnt = 0;
+        for (uint i = 0; i < slot_cnt; i++)   {
+            struct bench_slot* slot = &slots[i];
+            if (slot->job_id != 0 && tsk_check_finished(slot->job_id))  {
+                tsk_destroy(slot->job_id);
+                slot->job_id = 0;
+                result->checksum ^= slot->checksum;
+                result->load_tm += slot->load_tm;
+                done_cnt ++;
+            }
+            busy_cnt += (slot->job_id != 0) ? 1 : 0;
+        }
+
+        if (!batched || busy_cnt == 0)  {
+            for (uint i = 0; i < slot_cnt && next_idx < file_cnt; i++)  {
+                struct bench_slot* slot = &slots[i];
+                if (slot->job_id != 0)
+                    continue;
+                slot->file_idx = next_idx;
+                slot->job_id = tsk_dispatch_exclusive(bench_load_fn, &slot->thread_idx, 1, slot,
+                    slot);
+                if (slot->job_id == 0)
+                    break;
+                next_idx ++;
+            }
+        }
+
+        util_sleep(BENCH_POLL_MS);
+    }
+
+    result->tm = timer_calctm(start_tick, timer_querytick());
+}
+
+static void bench_print(const char* name, const struct bench_result* r, uint file_cnt,
+                        uint64 total_bytes, uint thread_cnt)
+{
+    printf("    %-8s %u loads in %.3fs: %.1f loads/s, %.1f MB/s, loaders busy %.0f%%\n", name,
+        file_cnt, r->tm, (fl64)file_cnt/r->tm, (fl64)total_bytes/(1024.0*1024.0)/r->tm,
+        100.0*r->load_tm/(r->tm*(fl64)thread_cnt));
+}
+
+int bench_load(uint file_cnt, uint thread_cnt)
+{
+    struct bench_slot slots[BENCH_THREADS_MAX];
+    struct bench_result batched;
+    struct bench_result continuous;
+    uint64 total_bytes;
+
+    thread_cnt = minui(thread_cnt, BENCH_THREADS_MAX);
+    memset(slots, 0x00, sizeof(slots));
+    for (uint i = 0; i < thread_cnt; i++)
+        slots[i].thread_idx = (int)i;
+
+    printf("bench-load: %u files, %u thread(s)\n", file_cnt, thread_cnt);
+    if (!bench_createfiles(file_cnt, &total_bytes))  {
+        puts("    could not create benchmark files");
+        bench_removefiles(file_cnt);
+        return FALSE;
+    }
+
+    bench_run(slots, thread_cnt, file_cnt, TRUE, &batched);
+    bench_print("batched", &batched, file_cnt, total_bytes, thread_cnt);
+    bench_run(slots, thread_cnt, file_cnt, FALSE, &continuous);
+    bench_print("slots", &continuous, file_cnt, total_bytes, thread_cnt);
+    printf("    speedup: %.2fx\n", batched.tm/continuous.tm);
+
+    bench_removefiles(file_cnt);
+
+    /* both runs must have loaded the same data */
+    return batched.checksum == continuous.checksum;
+}
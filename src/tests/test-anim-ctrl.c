@@ -0,0 +1,235 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stddef.h>
+#include "dhcore/core.h"
+#include "dhcore/str.h"
+
+#include "anim-ctrl.h"
+#include "h3d-types.h"
+#include "tests.h"
+
+#define CHAIN_STATES 10
+#define CHAIN_LAYERS 2
+#define CHAIN_FILE "test-anim-ctrl.json"
+#define CHAIN_BINFILE "test-anim-ctrl.h3dc"
+#define BAD_FILE "test-anim-ctrl-bad.json"
+
+/* synthetic controller: a chain of states s0 -> s1 -> ... connected with instant (zero duration)
+ * transitions that all fire on the same 'go' parameter, duplicated in two layers */
+static char* chain_json(char* json)
+{
+    char* s = json;
+    s += sprintf(s, "{\"reel\": \"synthetic.h3da\", "
+        "\"params\": [{\"name\": \"go\", \"type\": \"bool\", \"value\": false}], "
+        "\"clips\": [{\"name\": \"idle\"}], \"states\": [");
+    for (uint i = 0; i < CHAIN_STATES; i++)    {
+        s += sprintf(s, "%s{\"name\": \"s%u\", \"sequence\": {\"type\": \"clip\", \"id\": 0}, "
+            "\"transitions\": [", i != 0 ? ", " : "", i);
+        if (i != CHAIN_STATES - 1)
+            s += sprintf(s, "%u", i);
+        s += sprintf(s, "]}");
+    }
+
+    s += sprintf(s, "], \"transitions\": [");
+    for (uint i = 0; i < CHAIN_STATES - 1; i++)    {
+        s += sprintf(s, "%s{\"duration\": 0, \"owner\": %u, \"target\": %u, \"groups\": "
+            "[{\"conditions\": [{\"type\": \"param\", \"param\": 0, \"predicate\": \"==\", "
+            "\"value-type\": \"bool\", \"value\": true}]}]}", i != 0 ? ", " : "", i, i + 1);
+    }
+
+    s += sprintf(s, "], \"layers\": [");
+    for (uint i = 0; i < CHAIN_LAYERS; i++)    {
+        s += sprintf(s, "%s{\"name\": \"layer%u\", \"default\": 0, \"states\": [",
+            i != 0 ? ", " : "", i);
+        for (uint k = 0; k < CHAIN_STATES; k++)
+            s += sprintf(s, "%s%u", k != 0 ? ", " : "", k);
+        s += sprintf(s, "]}");
+    }
+    sprintf(s, "]}");
+    return json;
+}
+
+/* same as state resolve part of anim_ctrl_update, returns eval count of the update */
+static uint chain_update(anim_ctrl ctrl, anim_ctrl_inst inst, float tm)
+{
+    inst->eval_cnt = 0;
+    for (uint i = 0; i < ctrl->layer_cnt; i++)
+        anim_ctrl_resolve(ctrl, inst, i, tm);
+    return inst->eval_cnt;
+}
+
+int test_anim_ctrl_switches()
+{
+    static char json[16*1024];
+    TEST_CHECK(test_writefile(CHAIN_FILE, chain_json(json)));
+
+    anim_ctrl ctrl = anim_ctrl_load(mem_heap(), CHAIN_FILE, 0);
+    TEST_CHECK(ctrl != NULL);
+    anim_ctrl_inst inst = anim_ctrl_allocinstance(mem_heap(), ctrl);
+    TEST_CHECK(inst != NULL);
+
+    int r = FALSE;
+    uint go = anim_ctrl_findparam(ctrl, "go");
+    uint evals;
+    uint state_idx = 0;
+    uint total_evals = 0;
+    uint update_cnt = 0;
+
+    /* no condition is met: a single check per layer */
+    evals = chain_update(ctrl, inst, 0.0f);
+    printf("    idle: %u eval(s)\n", evals);
+    if (evals != CHAIN_LAYERS || inst->layers[0].state_idx != 0)
+        goto cleanup;
+
+    /* every state fires: each hop starts and finishes a transition (2 switches), chain is cut
+     * at ANIM_CTRL_SWITCH_MAX switches per layer, other layers are not re-evaluated */
+    anim_ctrl_set_paramb_byidx(inst, go, TRUE);
+    while (state_idx != CHAIN_STATES - 1 && update_cnt < CHAIN_STATES)   {
+        evals = chain_update(ctrl, inst, 0.0f);
+        uint hops = minui(ANIM_CTRL_SWITCH_MAX/2, CHAIN_STATES - 1 - state_idx);
+        uint expected = (hops*2 < ANIM_CTRL_SWITCH_MAX) ? (hops*2 + 1) : ANIM_CTRL_SWITCH_MAX;
+        state_idx += hops;
+        printf("    chained update %u: %u eval(s), state s%u\n", update_cnt, evals,
+            inst->layers[0].state_idx);
+
+        for (uint i = 0; i < CHAIN_LAYERS; i++)    {
+            if (inst->layers[i].state_idx != state_idx ||
+                inst->layers[i].transition_idx != INVALID_INDEX)
+            {
+                goto cleanup;
+            }
+        }
+        if (evals != expected*CHAIN_LAYERS)
+            goto cleanup;
+
+        total_evals += evals;
+        update_cnt ++;
+    }
+
+    printf("    chain of %d states settled in %u update(s), %u eval(s)\n", CHAIN_STATES,
+        update_cnt, total_evals);
+    r = (state_idx == CHAIN_STATES - 1);
+
+cleanup:
+    anim_ctrl_freeinstance(inst);
+    anim_ctrl_unload(ctrl);
+    remove(CHAIN_FILE);
+    return r;
+}
+
+/* loads a precompiled copy of 'bin' with one transition target overwritten, returns the result */
+static anim_ctrl load_patched(const uint8* bin, size_t bin_sz, uint transition_idx,
+                              uint target_idx)
+{
+    static uint8 patched[64*1024];
+    if (bin_sz > sizeof(patched))
+        return NULL;
+    memcpy(patched, bin, bin_sz);
+
+    /* block pointers are offsets in the file */
+    uint8* data = patched + sizeof(struct h3d_header) + sizeof(struct h3d_animctrl);
+    const struct anim_ctrl_data* dctrl = (const struct anim_ctrl_data*)data;
+    struct anim_ctrl_transition* trans = (struct anim_ctrl_transition*)
+        (data + (uptr_t)dctrl->transitions);
+    trans[transition_idx].target_state_idx = target_idx;
+
+    FILE* f = fopen(CHAIN_BINFILE, "wb");
+    if (f == NULL)
+        return NULL;
+    fwrite(patched, bin_sz, 1, f);
+    fclose(f);
+    return anim_ctrl_load(mem_heap(), CHAIN_BINFILE, 0);
+}
+
+int test_anim_ctrl_bin()
+{
+    static char json[16*1024];
+    static uint8 bin[64*1024];
+    TEST_CHECK(test_writefile(CHAIN_FILE, chain_json(json)));
+    TEST_CHECK(IS_OK(anim_ctrl_compile(CHAIN_FILE, CHAIN_BINFILE)));
+
+    anim_ctrl jctrl = anim_ctrl_load(mem_heap(), CHAIN_FILE, 0);
+    anim_ctrl bctrl = anim_ctrl_load(mem_heap(), CHAIN_BINFILE, 0);
+    anim_ctrl bad = NULL;
+    size_t bin_sz = 0;
+    int r = FALSE;
+
+    FILE* f = fopen(CHAIN_BINFILE, "rb");
+    if (f != NULL)  {
+        bin_sz = fread(bin, 1, sizeof(bin), f);
+        fclose(f);
+    }
+
+    if (jctrl == NULL || bctrl == NULL || bin_sz == 0)
+        goto cleanup;
+
+    /* roundtrip keeps every table and index */
+    if (bctrl->state_cnt != jctrl->state_cnt || bctrl->transition_cnt != jctrl->transition_cnt ||
+        bctrl->layer_cnt != jctrl->layer_cnt || bctrl->param_cnt != jctrl->param_cnt ||
+        !str_isequal(bctrl->reel_filepath, jctrl->reel_filepath) ||
+        anim_ctrl_findparam(bctrl, "go") != 0)
+    {
+        goto cleanup;
+    }
+    for (uint i = 0; i < jctrl->state_cnt; i++)    {
+        if (!str_isequal(bctrl->states[i].name, jctrl->states[i].name) ||
+            bctrl->states[i].transition_cnt != jctrl->states[i].transition_cnt)
+        {
+            goto cleanup;
+        }
+    }
+    for (uint i = 0; i < jctrl->transition_cnt; i++)   {
+        if (bctrl->transitions[i].target_state_idx != jctrl->transitions[i].target_state_idx ||
+            bctrl->transitions[i].groups[0].items[0].param_idx != 0)
+        {
+            goto cleanup;
+        }
+    }
+    printf("    roundtrip: %u states, %u transitions, %u bytes\n", bctrl->state_cnt,
+        bctrl->transition_cnt, (uint)bin_sz);
+
+    /* out of range indexes are rejected instead of being followed at update time */
+    bad = load_patched(bin, bin_sz, 0, CHAIN_STATES);
+    if (bad != NULL)
+        goto cleanup;
+    bad = load_patched(bin, bin_sz, CHAIN_STATES - 2, INVALID_INDEX);
+    if (bad != NULL)
+        goto cleanup;
+
+    /* json goes through the same checks: default state out of range */
+    if (!test_writefile(BAD_FILE, "{\"reel\": \"synthetic.h3da\", "
+        "\"clips\": [{\"name\": \"idle\"}], "
+        "\"states\": [{\"name\": \"s0\", \"sequence\": {\"type\": \"clip\", \"id\": 0}}], "
+        "\"layers\": [{\"name\": \"layer0\", \"default\": 1, \"states\": [0]}]}"))
+    {
+        goto cleanup;
+    }
+    bad = anim_ctrl_load(mem_heap(), BAD_FILE, 0);
+    r = (bad == NULL);
+
+cleanup:
+    if (bad != NULL)
+        anim_ctrl_unload(bad);
+    if (jctrl != NULL)
+        anim_ctrl_unload(jctrl);
+    if (bctrl != NULL)
+        anim_ctrl_unload(bctrl);
+    remove(CHAIN_FILE);
+    remove(CHAIN_BINFILE);
+    remove(BAD_FILE);
+    return r;
+}
@@ -0,0 +1,92 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "renderpaths/csm-cache.h"
+#include "tests.h"
+
+int test_csm_cache()
+{
+    struct csm_cache cache;
+    struct mat4f vps[CSM_CACHE_CASCADES_MAX];
+    uint sigs[CSM_CACHE_CASCADES_MAX];
+    struct aabb b1;
+    struct aabb b2;
+    const uint cascade_cnt = 3;
+    const uint all_mask = (1u << cascade_cnt) - 1;
+
+    memset(vps, 0x00, sizeof(vps));
+    for (uint i = 0; i < CSM_CACHE_CASCADES_MAX; i++) {
+        vps[i].m11 = vps[i].m22 = vps[i].m33 = vps[i].m44 = 1.0f;
+        vps[i].m41 = (float)i;
+    }
+    memset(&b1, 0x00, sizeof(b1));
+    memset(&b2, 0x00, sizeof(b2));
+    b1.maxpt.x = b1.maxpt.y = b1.maxpt.z = 1.0f;
+    b2.minpt.x = 5.0f;
+    b2.maxpt.x = b2.maxpt.y = b2.maxpt.z = 6.0f;
+
+    /* signatures don't depend on caster order, but on bounds and drawn model (lod) */
+    TEST_CHECK(csm_cache_addcaster(csm_cache_addcaster(0, &b1, 10), &b2, 20) ==
+        csm_cache_addcaster(csm_cache_addcaster(0, &b2, 20), &b1, 10));
+    TEST_CHECK(csm_cache_addcaster(0, &b1, 10) != csm_cache_addcaster(0, &b1, 11));
+    TEST_CHECK(csm_cache_addcaster(0, &b1, 10) != csm_cache_addcaster(0, &b2, 10));
+
+    for (uint i = 0; i < CSM_CACHE_CASCADES_MAX; i++)
+        sigs[i] = csm_cache_addcaster(0, &b1, i);
+
+    /* nothing is cached after reset */
+    csm_cache_reset(&cache);
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == all_mask);
+    csm_cache_commit(&cache, vps, sigs, all_mask);
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == 0);
+
+    /* caster (or it's lod) changes only invalidate the cascades it touches */
+    uint sig1 = sigs[1];
+    sigs[1] = csm_cache_addcaster(sigs[1], &b2, 7);
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == 0x2);
+    sigs[1] = sig1;
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == 0);
+
+    /* snapped cascade matrix moves */
+    vps[2].m41 += 0.5f;
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == 0x4);
+    csm_cache_commit(&cache, vps, sigs, 0x4);
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == 0);
+
+    /* shadow map layers are copied from static layers only if dynamic casters drew over them
+     * or the static layer is re-rendered */
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == all_mask);
+    csm_cache_setshadow(&cache, all_mask, 0x1);
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == 0x1);
+    TEST_CHECK(csm_cache_copymask(&cache, 0x4, cascade_cnt) == 0x5);
+    csm_cache_setshadow(&cache, 0x5, 0);
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == 0);
+    TEST_CHECK(csm_cache_copymask(&cache, 0x2, cascade_cnt) == 0x2);
+
+    /* a dynamic caster that leaves a cascade still needs one copy to erase it */
+    csm_cache_setshadow(&cache, 0, 0x2);
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == 0x2);
+    csm_cache_setshadow(&cache, 0x2, 0);
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == 0);
+
+    csm_cache_reset(&cache);
+    TEST_CHECK(csm_cache_copymask(&cache, 0, cascade_cnt) == all_mask);
+    TEST_CHECK(csm_cache_test(&cache, vps, sigs, cascade_cnt) == all_mask);
+
+    return TRUE;
+}
@@ -0,0 +1,199 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "fgraph-compile.h"
+#include "tests.h"
+
+#define TEST_FG_WIDTH   1280
+#define TEST_FG_HEIGHT  720
+
+/* resources of the test frame */
+struct test_fg_frame
+{
+    uint sunshadow;
+    uint gbuffer;
+    uint shadows;
+    uint ssao;
+    uint primary;
+    uint ldr;
+    uint bloom;
+    uint aa;
+    uint backbuffer;
+    uint ssao_pass;
+};
+
+/* declares the same frame that gfx_build_framegraph and gfx_deferred_setup do:
+ * csm -> gbuffer -> (df-shadows, ssao) -> lighting -> tonemap -> fxaa -> composite -> 2d */
+static void test_fg_declare(struct gfx_fgraph* fg, struct test_fg_frame* f, int ssao_enable,
+    int show_ssao)
+{
+    struct gfx_fg_texdesc desc = {TEST_FG_WIDTH, TEST_FG_HEIGHT, GFX_FORMAT_RGBA_UNORM};
+    uint pass;
+
+    gfx_fg_reset(fg);
+    f->backbuffer = gfx_fg_import(fg, "backbuffer", NULL, NULL);
+    gfx_fg_setoutput(fg, f->backbuffer);
+
+    f->sunshadow = gfx_fg_import(fg, "sunshadow", NULL, NULL);
+    pass = gfx_fg_addpass(fg, "csm", 0, NULL, NULL);
+    gfx_fg_write(fg, pass, f->sunshadow);
+
+    f->primary = gfx_fg_import(fg, "primary", NULL, NULL);
+    f->gbuffer = gfx_fg_import(fg, "gbuffer", NULL, NULL);
+    pass = gfx_fg_addpass(fg, "gbuffer", 0, NULL, NULL);
+    gfx_fg_write(fg, pass, f->gbuffer);
+
+    f->shadows = gfx_fg_transient(fg, "shadows", &desc);
+    pass = gfx_fg_addpass(fg, "df-shadows", 0, NULL, NULL);
+    gfx_fg_read(fg, pass, f->gbuffer);
+    gfx_fg_read(fg, pass, gfx_fg_findres(fg, "sunshadow"));
+    gfx_fg_write(fg, pass, f->shadows);
+
+    f->ssao = gfx_fg_transient(fg, "ssao", &desc);
+    f->ssao_pass = gfx_fg_addpass(fg, "ssao", 0, NULL, NULL);
+    gfx_fg_read(fg, f->ssao_pass, f->gbuffer);
+    gfx_fg_write(fg, f->ssao_pass, f->ssao);
+    if (show_ssao)
+        gfx_fg_setoutput(fg, f->ssao);
+
+    pass = gfx_fg_addpass(fg, "lighting", 0, NULL, NULL);
+    gfx_fg_read(fg, pass, f->gbuffer);
+    gfx_fg_read(fg, pass, f->shadows);
+    if (ssao_enable)
+        gfx_fg_read(fg, pass, f->ssao);
+    gfx_fg_write(fg, pass, f->primary);
+
+    f->ldr = gfx_fg_transient(fg, "ldr", &desc);
+    f->bloom = gfx_fg_import(fg, "bloom", NULL, NULL);
+    pass = gfx_fg_addpass(fg, "tonemap", 0, NULL, NULL);
+    gfx_fg_read(fg, pass, f->primary);
+    gfx_fg_write(fg, pass, f->ldr);
+    gfx_fg_write(fg, pass, f->bloom);
+
+    f->aa = gfx_fg_transient(fg, "aa", &desc);
+    pass = gfx_fg_addpass(fg, "fxaa", 0, NULL, NULL);
+    gfx_fg_read(fg, pass, f->ldr);
+    gfx_fg_write(fg, pass, f->aa);
+
+    pass = gfx_fg_addpass(fg, "composite", 0, NULL, NULL);
+    gfx_fg_read(fg, pass, f->aa);
+    gfx_fg_read(fg, pass, f->bloom);
+    gfx_fg_read(fg, pass, f->primary);
+    gfx_fg_write(fg, pass, f->backbuffer);
+
+    pass = gfx_fg_addpass(fg, "2d", 0, NULL, NULL);
+    gfx_fg_write(fg, pass, f->backbuffer);
+}
+
+static uint test_fg_culledcnt(const struct gfx_fgraph* fg)
+{
+    uint cnt = 0;
+    for (uint i = 0; i < fg->pass_cnt; i++)   {
+        if (fg->passes[i].culled)
+            cnt ++;
+    }
+    return cnt;
+}
+
+int test_fgraph()
+{
+    static struct gfx_fgraph fg;
+    struct test_fg_frame f;
+    memset(&fg, 0x00, sizeof(fg));
+
+    /* everything contributes to the backbuffer */
+    test_fg_declare(&fg, &f, TRUE, FALSE);
+    TEST_CHECK(IS_OK(gfx_fg_compile(&fg)));
+    TEST_CHECK(fg.pass_cnt == 9);
+    TEST_CHECK(test_fg_culledcnt(&fg) == 0);
+
+    /* lifetimes: first and last living pass that touch each resource, outputs live to the end */
+    TEST_CHECK(fg.resources[f.sunshadow].first_pass == 0);
+    TEST_CHECK(fg.resources[f.sunshadow].last_pass == 2);
+    TEST_CHECK(fg.resources[f.gbuffer].first_pass == 1 && fg.resources[f.gbuffer].last_pass == 4);
+    TEST_CHECK(fg.resources[f.shadows].first_pass == 2 && fg.resources[f.shadows].last_pass == 4);
+    TEST_CHECK(fg.resources[f.ssao].first_pass == 3 && fg.resources[f.ssao].last_pass == 4);
+    TEST_CHECK(fg.resources[f.ldr].first_pass == 5 && fg.resources[f.ldr].last_pass == 6);
+    TEST_CHECK(fg.resources[f.aa].first_pass == 6 && fg.resources[f.aa].last_pass == 7);
+    TEST_CHECK(fg.resources[f.backbuffer].first_pass == 7);
+    TEST_CHECK(fg.resources[f.backbuffer].last_pass == (int)fg.pass_cnt);
+
+    /* shared targets: shadows and ssao overlap, ldr takes the target of shadows after lighting
+     * and aa takes the target of ssao, imports never get a target */
+    TEST_CHECK(fg.pool_cnt == 2);
+    TEST_CHECK(fg.resources[f.shadows].pool_idx != fg.resources[f.ssao].pool_idx);
+    TEST_CHECK(fg.resources[f.ldr].pool_idx == fg.resources[f.shadows].pool_idx);
+    TEST_CHECK(fg.resources[f.aa].pool_idx == fg.resources[f.ssao].pool_idx);
+    TEST_CHECK(fg.resources[f.gbuffer].pool_idx == INVALID_INDEX);
+    TEST_CHECK(fg.resources[f.backbuffer].pool_idx == INVALID_INDEX);
+
+    /* ssao disabled: nothing reads it, so the pass and it's target go away */
+    test_fg_declare(&fg, &f, FALSE, FALSE);
+    TEST_CHECK(IS_OK(gfx_fg_compile(&fg)));
+    TEST_CHECK(gfx_fg_isculled(&fg, f.ssao_pass));
+    TEST_CHECK(test_fg_culledcnt(&fg) == 1);
+    TEST_CHECK(fg.resources[f.ssao].first_pass == -1);
+    TEST_CHECK(fg.resources[f.ssao].pool_idx == INVALID_INDEX);
+    TEST_CHECK(fg.resources[f.gbuffer].last_pass == 4);
+    TEST_CHECK(fg.resources[f.ldr].pool_idx == fg.resources[f.shadows].pool_idx);
+    TEST_CHECK(fg.resources[f.aa].pool_idx != fg.resources[f.ldr].pool_idx);
+    TEST_CHECK(fg.pool_cnt == 2);
+
+    /* ssao preview keeps the pass alive even if lighting doesn't read it */
+    test_fg_declare(&fg, &f, FALSE, TRUE);
+    TEST_CHECK(IS_OK(gfx_fg_compile(&fg)));
+    TEST_CHECK(!gfx_fg_isculled(&fg, f.ssao_pass));
+    TEST_CHECK(fg.resources[f.ssao].last_pass == (int)fg.pass_cnt);
+    TEST_CHECK(fg.resources[f.aa].pool_idx != fg.resources[f.ssao].pool_idx);
+
+    /* transients with different descriptions never share a target */
+    gfx_fg_reset(&fg);
+    struct gfx_fg_texdesc full = {TEST_FG_WIDTH, TEST_FG_HEIGHT, GFX_FORMAT_RGBA_UNORM};
+    struct gfx_fg_texdesc half = {TEST_FG_WIDTH/2, TEST_FG_HEIGHT/2, GFX_FORMAT_RGBA_UNORM};
+    uint out = gfx_fg_import(&fg, "backbuffer", NULL, NULL);
+    uint t1 = gfx_fg_transient(&fg, "t1", &full);
+    uint t2 = gfx_fg_transient(&fg, "t2", &half);
+    gfx_fg_setoutput(&fg, out);
+    uint p1 = gfx_fg_addpass(&fg, "p1", 0, NULL, NULL);
+    gfx_fg_write(&fg, p1, t1);
+    uint p2 = gfx_fg_addpass(&fg, "p2", 0, NULL, NULL);
+    gfx_fg_read(&fg, p2, t1);
+    gfx_fg_write(&fg, p2, out);
+    uint p3 = gfx_fg_addpass(&fg, "p3", 0, NULL, NULL);
+    gfx_fg_write(&fg, p3, t2);
+    uint p4 = gfx_fg_addpass(&fg, "p4", 0, NULL, NULL);
+    gfx_fg_read(&fg, p4, t2);
+    gfx_fg_write(&fg, p4, out);
+    uint p5 = gfx_fg_addpass(&fg, "p5", GFX_FG_PASS_NOCULL, NULL, NULL);
+    uint p6 = gfx_fg_addpass(&fg, "p6", 0, NULL, NULL);
+    gfx_fg_write(&fg, p6, gfx_fg_transient(&fg, "unused", &full));
+    TEST_CHECK(IS_OK(gfx_fg_compile(&fg)));
+    TEST_CHECK(fg.pool_cnt == 2);
+    TEST_CHECK(fg.resources[t1].pool_idx != fg.resources[t2].pool_idx);
+    TEST_CHECK(!gfx_fg_isculled(&fg, p5));
+    TEST_CHECK(gfx_fg_isculled(&fg, p6));
+
+    /* declaration overflow fails the compile instead of dropping passes silently */
+    gfx_fg_reset(&fg);
+    for (uint i = 0; i < GFX_FG_PASSES_MAX; i++)
+        gfx_fg_addpass(&fg, "pass", 0, NULL, NULL);
+    TEST_CHECK(gfx_fg_addpass(&fg, "overflow", 0, NULL, NULL) == INVALID_INDEX);
+    TEST_CHECK(IS_FAIL(gfx_fg_compile(&fg)));
+
+    return TRUE;
+}
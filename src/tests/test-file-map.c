@@ -0,0 +1,51 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "file-map.h"
+#include "tests.h"
+
+int test_file_map()
+{
+    const char* text = "mapped file contents";
+    struct file_map m;
+
+    TEST_CHECK(test_writefile("test-file-map.txt", text));
+    TEST_CHECK(test_writefile("test-file-map-empty.txt", ""));
+
+    /* relative paths are searched in data directories, then as they are */
+    fmap_cleardirs();
+    fmap_adddir("no-such-dir");
+    fmap_adddir(".");
+    TEST_CHECK(fmap_open(&m, "test-file-map.txt"));
+    TEST_CHECK(m.size == strlen(text));
+    TEST_CHECK(memcmp(m.data, text, m.size) == 0);
+    fmap_close(&m);
+    TEST_CHECK(m.data == NULL && m.size == 0);
+
+    fmap_cleardirs();
+    TEST_CHECK(fmap_open(&m, "test-file-map.txt"));
+    fmap_close(&m);
+
+    /* loaders fall back to file-io for these */
+    TEST_CHECK(!fmap_open(&m, "test-file-map-missing.txt"));
+    TEST_CHECK(m.data == NULL);
+    TEST_CHECK(!fmap_open(&m, "test-file-map-empty.txt"));
+
+    return TRUE;
+}
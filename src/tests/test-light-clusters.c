@@ -0,0 +1,145 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "light-clusters.h"
+#include "tests.h"
+
+#define TEST_LC_WIDTH   1000
+#define TEST_LC_HEIGHT  600
+#define TEST_LC_TILE    64
+#define TEST_LC_SLICES  16
+#define TEST_LC_LIGHTS  200
+
+static uint test_lc_rand(uint* seed)
+{
+    *seed = *seed*1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+static float test_lc_randf(uint* seed, float vmin, float vmax)
+{
+    return vmin + (vmax - vmin)*(float)(test_lc_rand(seed) & 0xffff)/65535.0f;
+}
+
+/* bins ranges with 'worker_cnt' row groups like gfx-deferred does, returns overflow count */
+static uint test_lc_bin(struct light_clusters* lc, const struct light_range* ranges,
+    uint range_cnt, uint worker_cnt)
+{
+    uint rows = (lc->cnt_y + worker_cnt - 1) / worker_cnt;
+    uint overflow_cnt = 0;
+    for (uint i = 0; i < worker_cnt; i++)   {
+        uint row_start = i*rows;
+        uint row_end = row_start + rows < lc->cnt_y ? row_start + rows : lc->cnt_y;
+        overflow_cnt += light_clusters_bin(lc, ranges, range_cnt, row_start, row_end);
+    }
+    return overflow_cnt;
+}
+
+int test_light_clusters()
+{
+    static uint cnts[16*10*TEST_LC_SLICES];
+    static uint16 idxs[16*10*TEST_LC_SLICES*32];
+    static uint tile_cnts[16*10*4];
+    static float items[16*10*TEST_LC_SLICES*(1 + 32/4)*4];
+    struct light_range ranges[TEST_LC_LIGHTS];
+    struct light_clusters lc;
+
+    light_clusters_init(&lc, TEST_LC_WIDTH, TEST_LC_HEIGHT, TEST_LC_TILE, TEST_LC_SLICES, 32,
+        cnts, idxs, tile_cnts, 4);
+    light_clusters_setdepth(&lc, 0.1f, 1000.0f);
+    TEST_CHECK(lc.cnt_x == 16 && lc.cnt_y == 10);
+    TEST_CHECK(lc.cluster_cnt == 16*10*TEST_LC_SLICES);
+    TEST_CHECK(light_clusters_getmaxitems(&lc)*4 == sizeof(items)/sizeof(float));
+
+    /* slices are monotonic between near and far planes */
+    TEST_CHECK(light_clusters_depthslice(&lc, -1.0f) == 0);
+    TEST_CHECK(light_clusters_depthslice(&lc, 0.1f) == 0);
+    TEST_CHECK(light_clusters_depthslice(&lc, 999.0f) == TEST_LC_SLICES - 1);
+    TEST_CHECK(light_clusters_depthslice(&lc, 5000.0f) == TEST_LC_SLICES - 1);
+    TEST_CHECK(light_clusters_depthslice(&lc, 1.0f) < light_clusters_depthslice(&lc, 100.0f));
+
+    /* random lights, some of them partially off-screen or behind the camera */
+    uint seed = 0x5eed;
+    uint vis_cnt = 0;
+    for (uint i = 0; i < TEST_LC_LIGHTS; i++)  {
+        struct light_range* lr = &ranges[i];
+        float x = test_lc_randf(&seed, -100.0f, TEST_LC_WIDTH + 100.0f);
+        float y = test_lc_randf(&seed, -100.0f, TEST_LC_HEIGHT + 100.0f);
+        float sz = test_lc_randf(&seed, 1.0f, 200.0f);
+        float z = test_lc_randf(&seed, -10.0f, 800.0f);
+        float r = test_lc_randf(&seed, 0.5f, 20.0f);
+        lr->rc[0] = x - sz;
+        lr->rc[1] = y - sz;
+        lr->rc[2] = x + sz;
+        lr->rc[3] = y + sz;
+        lr->zmin = z - r;
+        lr->zmax = z + r;
+        lr->idx = light_clusters_setrange(&lc, lr) ? i : INVALID_INDEX;
+        if (lr->idx != INVALID_INDEX)
+            vis_cnt++;
+    }
+    TEST_CHECK(vis_cnt > 0 && vis_cnt < TEST_LC_LIGHTS);
+
+    /* binning matches brute-force for any row split */
+    TEST_CHECK(test_lc_bin(&lc, ranges, TEST_LC_LIGHTS, 1) == 0);
+    TEST_CHECK(light_clusters_check(&lc, ranges, TEST_LC_LIGHTS) == 0);
+    uint pair_cnt = 0;
+    for (uint i = 0; i < lc.cluster_cnt; i++)
+        pair_cnt += cnts[i];
+    TEST_CHECK(pair_cnt > 0);
+
+    TEST_CHECK(test_lc_bin(&lc, ranges, TEST_LC_LIGHTS, 3) == 0);
+    TEST_CHECK(light_clusters_check(&lc, ranges, TEST_LC_LIGHTS) == 0);
+
+    /* a wrong index is caught */
+    uint c = 0;
+    while (cnts[c] == 0)
+        c++;
+    idxs[c*lc.cap] ^= 1;
+    TEST_CHECK(light_clusters_check(&lc, ranges, TEST_LC_LIGHTS) == 1);
+
+    /* packed headers point to the light indexes of each cluster */
+    test_lc_bin(&lc, ranges, TEST_LC_LIGHTS, 1);
+    uint item_cnt = light_clusters_pack(&lc, items);
+    TEST_CHECK(item_cnt >= lc.cluster_cnt && item_cnt <= light_clusters_getmaxitems(&lc));
+    for (uint i = 0; i < lc.cluster_cnt; i++)   {
+        const float* h = &items[i*4];
+        TEST_CHECK((uint)h[0] == cnts[i]);
+        for (uint k = 0; k < cnts[i]; k++)
+            TEST_CHECK((uint)items[(uint)h[1]*4 + k] == idxs[i*lc.cap + k]);
+    }
+
+    /* tile counts have the caller's stride */
+    uint tile_total = 0;
+    for (uint i = 0; i < lc.cnt_x*lc.cnt_y; i++)
+        tile_total += tile_cnts[i*4];
+    TEST_CHECK(tile_total > 0 && tile_total <= pair_cnt);
+
+    /* full clusters drop lights and the reference keeps the same order up to capacity */
+    light_clusters_init(&lc, TEST_LC_WIDTH, TEST_LC_HEIGHT, TEST_LC_TILE, 4, 2, cnts, idxs,
+        tile_cnts, 4);
+    light_clusters_setdepth(&lc, 0.1f, 1000.0f);
+    for (uint i = 0; i < TEST_LC_LIGHTS; i++)  {
+        if (ranges[i].idx != INVALID_INDEX)
+            light_clusters_setrange(&lc, &ranges[i]);
+    }
+    TEST_CHECK(test_lc_bin(&lc, ranges, TEST_LC_LIGHTS, 2) > 0);
+    TEST_CHECK(light_clusters_check(&lc, ranges, TEST_LC_LIGHTS) == 0);
+
+    return TRUE;
+}
@@ -0,0 +1,111 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include "dhcore/core.h"
+
+#include "load-queue.h"
+#include "tests.h"
+
+#define LQ_ITEMS 8
+
+struct lq_req
+{
+    uint id;
+    struct load_queue_item qitem;
+};
+
+/* pops everything and writes request ids into order, returns pop count */
+static uint lq_drain(struct load_queue* q, uint* order, uint max_cnt)
+{
+    uint cnt = 0;
+    struct lq_req* req;
+    while (cnt < max_cnt && (req = (struct lq_req*)load_queue_pop(q)) != NULL)
+        order[cnt++] = req->id;
+    return cnt;
+}
+
+int test_load_queue()
+{
+    struct load_queue q;
+    struct lq_req reqs[LQ_ITEMS];
+    uint order[LQ_ITEMS];
+
+    for (uint i = 0; i < LQ_ITEMS; i++)
+        reqs[i].id = i;
+
+    /* bucket mapping: first bucket spans one unit, each next one doubles */
+    TEST_CHECK(load_queue_bucket(-5.0f) == 0);
+    TEST_CHECK(load_queue_bucket(0.0f) == 0);
+    TEST_CHECK(load_queue_bucket(LOAD_QUEUE_PRIORITY_UNIT - 0.1f) == 0);
+    TEST_CHECK(load_queue_bucket(LOAD_QUEUE_PRIORITY_UNIT) == 1);
+    TEST_CHECK(load_queue_bucket(LOAD_QUEUE_PRIORITY_UNIT*2.0f) == 2);
+    TEST_CHECK(load_queue_bucket(LOAD_QUEUE_PRIORITY_UNIT*4.0f - 0.1f) == 2);
+    TEST_CHECK(load_queue_bucket(1.0e9f) == LOAD_QUEUE_BUCKET_CNT - 1);
+
+    /* empty queue */
+    load_queue_init(&q);
+    TEST_CHECK(load_queue_pop(&q) == NULL);
+    TEST_CHECK(load_queue_getcount(&q) == 0);
+
+    /* FIFO inside a bucket, lower buckets first */
+    load_queue_push(&q, &reqs[0].qitem, &reqs[0], 3, FALSE);
+    load_queue_push(&q, &reqs[1].qitem, &reqs[1], 1, FALSE);
+    load_queue_push(&q, &reqs[2].qitem, &reqs[2], 3, FALSE);
+    load_queue_push(&q, &reqs[3].qitem, &reqs[3], 0, FALSE);
+    load_queue_push(&q, &reqs[4].qitem, &reqs[4], 1, FALSE);
+    TEST_CHECK(load_queue_getcount(&q) == 5);
+    TEST_CHECK(q.cnts[1] == 2 && q.cnts[3] == 2);
+    TEST_CHECK(lq_drain(&q, order, LQ_ITEMS) == 5);
+    TEST_CHECK(order[0] == 3 && order[1] == 1 && order[2] == 4 && order[3] == 0 && order[4] == 2);
+    TEST_CHECK(load_queue_getcount(&q) == 0);
+
+    /* front push jumps ahead of older requests in the same bucket (requeued dependencies) */
+    load_queue_push(&q, &reqs[0].qitem, &reqs[0], 2, FALSE);
+    load_queue_push(&q, &reqs[1].qitem, &reqs[1], 2, FALSE);
+    load_queue_push(&q, &reqs[2].qitem, &reqs[2], 2, TRUE);
+    TEST_CHECK(lq_drain(&q, order, LQ_ITEMS) == 3);
+    TEST_CHECK(order[0] == 2 && order[1] == 0 && order[2] == 1);
+
+    /* cancellation: remove head, middle and tail of a bucket */
+    for (uint i = 0; i < 6; i++)
+        load_queue_push(&q, &reqs[i].qitem, &reqs[i], 4, FALSE);
+    load_queue_remove(&q, &reqs[0].qitem);
+    load_queue_remove(&q, &reqs[3].qitem);
+    load_queue_remove(&q, &reqs[5].qitem);
+    TEST_CHECK(q.cnts[4] == 3);
+    TEST_CHECK(load_queue_getcount(&q) == 3);
+    TEST_CHECK(lq_drain(&q, order, LQ_ITEMS) == 3);
+    TEST_CHECK(order[0] == 1 && order[1] == 2 && order[2] == 4);
+
+    /* cancelling the only item leaves the bucket empty */
+    load_queue_push(&q, &reqs[7].qitem, &reqs[7], 6, FALSE);
+    load_queue_remove(&q, &reqs[7].qitem);
+    TEST_CHECK(q.buckets[6] == NULL && q.cnts[6] == 0);
+    TEST_CHECK(load_queue_pop(&q) == NULL);
+
+    /* re-prioritize: remove + push moves the request to the end of its new bucket */
+    load_queue_push(&q, &reqs[0].qitem, &reqs[0], 1, FALSE);
+    load_queue_push(&q, &reqs[1].qitem, &reqs[1], 5, FALSE);
+    load_queue_push(&q, &reqs[2].qitem, &reqs[2], 1, FALSE);
+    load_queue_remove(&q, &reqs[1].qitem);
+    load_queue_push(&q, &reqs[1].qitem, &reqs[1], 1, FALSE);
+    TEST_CHECK(reqs[1].qitem.bucket == 1);
+    TEST_CHECK(q.cnts[1] == 3 && q.cnts[5] == 0);
+    TEST_CHECK(lq_drain(&q, order, LQ_ITEMS) == 3);
+    TEST_CHECK(order[0] == 0 && order[1] == 2 && order[2] == 1);
+
+    return TRUE;
+}
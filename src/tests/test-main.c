@@ -0,0 +1,127 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+/* cpu-only tests for engine units that don't need a graphics device
+ * usage: dhtests [test-name]
+ *        dhtests --bench-load [file-count] [threads] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "dhcore/core.h"
+#include "dhcore/file-io.h"
+#include "dhcore/task-mgr.h"
+#include "dhcore/vec-math.h"
+#include "dhcore/hwinfo.h"
+
+#include "tests.h"
+
+#define TESTS_TMP_SIZE  (4*1024*1024)
+#define BENCH_LOAD_FILES 512
+
+struct test_desc
+{
+    const char* name;
+    pfn_test test_fn;
+};
+
+static const struct test_desc g_tests[] = {
+    {"anim-ctrl-switches", test_anim_ctrl_switches},
+    {"anim-ctrl-bin", test_anim_ctrl_bin},
+    {"csm-cache", test_csm_cache},
+    {"fgraph", test_fgraph},
+    {"file-map", test_file_map},
+    {"light-clusters", test_light_clusters},
+    {"load-queue", test_load_queue},
+    {"pak-archive", test_pak_archive},
+    {"skin-palette", test_skin_palette},
+    {"staging-ring", test_staging_ring},
+    {"tex-lru", test_tex_lru}
+};
+
+/*************************************************************************************************/
+void test_fail(const char* file, uint line, const char* expr)
+{
+    printf("    check failed: %s (%s:%u)\n", expr, file, line);
+}
+
+int test_writefile(const char* filepath, const char* text)
+{
+    FILE* f = fopen(filepath, "wb");
+    if (f == NULL)
+        return FALSE;
+    size_t sz = strlen(text);
+    int r = fwrite(text, 1, sz, f) == sz;
+    fclose(f);
+    return r;
+}
+
+static int run_tests(const char* filter)
+{
+    uint run_cnt = 0;
+    uint fail_cnt = 0;
+    for (uint i = 0; i < sizeof(g_tests)/sizeof(struct test_desc); i++) {
+        if (filter != NULL && !str_isequal(filter, g_tests[i].name))
+            continue;
+
+        printf("%s ...\n", g_tests[i].name);
+        int ok = g_tests[i].test_fn();
+        if (!ok)    {
+            fail_cnt ++;
+            if (err_haserrors())
+                printf("    %s\n", err_getstring());
+        }
+        err_clear();
+        printf("%s: %s\n", g_tests[i].name, ok ? "ok" : "FAILED");
+        run_cnt ++;
+    }
+
+    printf("%u test(s), %u failed\n", run_cnt, fail_cnt);
+    return fail_cnt == 0 && run_cnt > 0;
+}
+
+int main(int argc, char** argv)
+{
+    int bench = argc > 1 && str_isequal(argv[1], "--bench-load");
+    const char* filter = (!bench && argc > 1) ? argv[1] : NULL;
+
+    core_init(CORE_INIT_ALL);
+    log_outputconsole(TRUE);
+
+    /* tests run in main thread, benchmark loads in task threads like the engine does */
+    uint thread_cnt = 0;
+    if (bench)  {
+        struct hwinfo hwinfo;
+        hw_getinfo(&hwinfo, HWINFO_ALL);
+        thread_cnt = maxui(argc > 3 ? (uint)atoi(argv[3]) : hwinfo.cpu_core_cnt - 1, 1);
+    }
+
+    /* synthetic test data is written to current directory */
+    fio_addvdir(".", FALSE);
+    if (IS_FAIL(tsk_initmgr(thread_cnt, 0, TESTS_TMP_SIZE, 0)))   {
+        puts("Error: could not init task manager");
+        core_release(FALSE);
+        return 1;
+    }
+
+    int r;
+    if (bench)
+        r = bench_load(argc > 2 ? (uint)atoi(argv[2]) : BENCH_LOAD_FILES, thread_cnt);
+    else
+        r = run_tests(filter);
+
+    tsk_releasemgr();
+    core_release(FALSE);
+    return r ? 0 : 1;
+}
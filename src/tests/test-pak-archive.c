@@ -0,0 +1,124 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "pak-archive.h"
+#include "tests.h"
+
+#define TEST_PAK_TEXT_SIZE  4096
+
+static int test_pak_checkentry(struct pak_archive* pak, const char* alias, const void* data,
+    uint size)
+{
+    uint idx = pak_archive_find(pak, alias);
+    TEST_CHECK(idx != INVALID_INDEX);
+    TEST_CHECK(pak_archive_getentry(pak, idx)->size == size);
+
+    void* r = pak_archive_read(pak, mem_heap(), idx);
+    TEST_CHECK(r != NULL);
+    int equal = memcmp(r, data, size) == 0;
+    A_FREE(mem_heap(), r);
+    TEST_CHECK(equal);
+    return TRUE;
+}
+
+int test_pak_archive()
+{
+    struct pak_archive pak;
+    struct pak_archive pak2;
+    char text[TEST_PAK_TEXT_SIZE];
+    uint8 noise[1024];
+
+    for (uint i = 0; i < TEST_PAK_TEXT_SIZE; i++)
+        text[i] = "pak archive "[i % 12];
+    uint seed = 0x12345678;
+    for (uint i = 0; i < sizeof(noise); i++)    {
+        seed = seed*1664525 + 1013904223;
+        noise[i] = (uint8)(seed >> 24);
+    }
+
+    /* compressible data is deflated, noise doesn't get smaller and is stored */
+    void* ztext;
+    uint ztext_sz;
+    void* znoise;
+    uint znoise_sz;
+    TEST_CHECK(pak_archive_compress(mem_heap(), text, sizeof(text), COMPRESS_NORMAL, &ztext,
+        &ztext_sz) == PAK_ENTRY_DEFLATE);
+    TEST_CHECK(ztext_sz < sizeof(text));
+    TEST_CHECK(pak_archive_compress(mem_heap(), noise, sizeof(noise), COMPRESS_NORMAL, &znoise,
+        &znoise_sz) == PAK_ENTRY_STORED);
+    TEST_CHECK(znoise == NULL);
+    TEST_CHECK(pak_archive_compress(mem_heap(), text, sizeof(text), COMPRESS_NONE, &znoise,
+        &znoise_sz) == PAK_ENTRY_STORED);
+
+    TEST_CHECK(IS_OK(pak_archive_create(&pak, mem_heap(), "test-pak.pak", COMPRESS_NORMAL)));
+    TEST_CHECK(IS_OK(pak_archive_put(&pak, "a/empty.txt", NULL, PAK_ENTRY_STORED, 0, 0, 1)));
+    TEST_CHECK(IS_OK(pak_archive_put(&pak, "a/noise.bin", noise, PAK_ENTRY_STORED,
+        sizeof(noise), sizeof(noise), 2)));
+    TEST_CHECK(IS_OK(pak_archive_put(&pak, "b/text.txt", ztext, PAK_ENTRY_DEFLATE, ztext_sz,
+        sizeof(text), 3)));
+    /* entries are kept sorted for lookups */
+    TEST_CHECK(IS_FAIL(pak_archive_put(&pak, "a/late.txt", noise, PAK_ENTRY_STORED, 1, 1, 4)));
+    pak_archive_close(&pak);
+    A_FREE(mem_heap(), ztext);
+    err_clear();
+
+    TEST_CHECK(IS_OK(pak_archive_open(&pak, mem_heap(), "test-pak.pak")));
+    TEST_CHECK(pak_archive_getcount(&pak) == 3);
+    TEST_CHECK(pak_archive_find(&pak, "a/late.txt") == INVALID_INDEX);
+    TEST_CHECK(pak_archive_find(&pak, "c") == INVALID_INDEX);
+    TEST_CHECK(test_pak_checkentry(&pak, "a/empty.txt", "", 0));
+    TEST_CHECK(test_pak_checkentry(&pak, "a/noise.bin", noise, sizeof(noise)));
+    TEST_CHECK(test_pak_checkentry(&pak, "b/text.txt", text, sizeof(text)));
+
+    /* copies keep compressed bytes and hashes (incremental builds) */
+    TEST_CHECK(IS_OK(pak_archive_create(&pak2, mem_heap(), "test-pak2.pak", COMPRESS_NORMAL)));
+    for (uint i = 0; i < pak_archive_getcount(&pak); i++)
+        TEST_CHECK(IS_OK(pak_archive_copy(&pak2, &pak, i)));
+    pak_archive_close(&pak2);
+
+    TEST_CHECK(IS_OK(pak_archive_open(&pak2, mem_heap(), "test-pak2.pak")));
+    for (uint i = 0; i < pak_archive_getcount(&pak); i++)  {
+        const struct pak_archive_entry* e1 = pak_archive_getentry(&pak, i);
+        const struct pak_archive_entry* e2 = pak_archive_getentry(&pak2, i);
+        TEST_CHECK(str_isequal(e1->alias, e2->alias));
+        TEST_CHECK(e1->mode == e2->mode && e1->hash == e2->hash);
+        TEST_CHECK(e1->size == e2->size && e1->stored_size == e2->stored_size);
+    }
+    TEST_CHECK(test_pak_checkentry(&pak2, "b/text.txt", text, sizeof(text)));
+    pak_archive_close(&pak2);
+    pak_archive_close(&pak);
+
+    /* entry table that points outside of the file is rejected */
+    FILE* f = fopen("test-pak.pak", "r+b");
+    TEST_CHECK(f != NULL);
+    struct pak_archive_header h;
+    fread(&h, sizeof(h), 1, f);
+    h.entry_cnt = 1000;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, f);
+    fclose(f);
+    TEST_CHECK(IS_FAIL(pak_archive_open(&pak, mem_heap(), "test-pak.pak")));
+    TEST_CHECK(pak.f == NULL && pak.entries == NULL);
+    err_clear();
+
+    TEST_CHECK(test_writefile("test-pak-text.pak", "not a pak file, not a pak file"));
+    TEST_CHECK(IS_FAIL(pak_archive_open(&pak, mem_heap(), "test-pak-text.pak")));
+    err_clear();
+
+    return TRUE;
+}
@@ -0,0 +1,88 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "dhcore/core.h"
+
+#include "skin-palette.h"
+#include "gfx-model.h"
+#include "gfx.h"
+#include "tests.h"
+
+#define SKIN_MODELS 4
+#define SKIN_INSTANCES 4    /* instances of each model, they end up in the same batch node */
+#define SKIN_BONES 40
+#define SKIN_PASSES 4   /* g-buffer + 3 shadow cascades */
+
+/* upload size of the old scheme: every pass writes each batch node's instances at fixed
+ * GFX_SKIN_BONES_MAX stride and uploads the node's buffer up to the last instance */
+static uint fixedstride_bytes()
+{
+    uint node_bones = (SKIN_INSTANCES - 1)*GFX_SKIN_BONES_MAX + SKIN_BONES;
+    return SKIN_PASSES*SKIN_MODELS*node_bones*(uint)SKIN_PALETTE_BONE_SIZE;
+}
+
+int test_skin_palette()
+{
+    struct gfx_model_posegpu poses[SKIN_MODELS*SKIN_INSTANCES];
+    struct skin_palette pal;
+    memset(poses, 0x00, sizeof(poses));
+    for (uint i = 0; i < SKIN_MODELS*SKIN_INSTANCES; i++)
+        poses[i].mat_cnt = SKIN_BONES;
+
+    skin_palette_init(&pal, GFX_SKIN_PALETTE_MAX);
+    skin_palette_begin(&pal);
+
+    /* all passes batch every pose, only the first one writes matrices */
+    uint writes = 0;
+    for (uint p = 0; p < SKIN_PASSES; p++)  {
+        for (uint i = 0; i < SKIN_MODELS*SKIN_INSTANCES; i++)  {
+            uint offset = skin_palette_addpose(&pal, &poses[i]);
+            if (offset != INVALID_INDEX)    {
+                TEST_CHECK(p == 0 && offset == i*SKIN_BONES);
+                writes ++;
+            }
+            TEST_CHECK(poses[i].palette_idx == i*SKIN_BONES);
+        }
+    }
+    TEST_CHECK(writes == SKIN_MODELS*SKIN_INSTANCES);
+
+    uint bytes = skin_palette_getbytes(&pal);
+    uint old_bytes = fixedstride_bytes();
+    printf("    skin upload: %u bytes packed, %u bytes with fixed-stride passes (%.1fx)\n", bytes,
+        old_bytes, (float)old_bytes/(float)bytes);
+    TEST_CHECK(bytes == SKIN_MODELS*SKIN_INSTANCES*SKIN_BONES*(uint)SKIN_PALETTE_BONE_SIZE);
+    TEST_CHECK(bytes*SKIN_PASSES <= old_bytes);
+    TEST_CHECK(!pal.overflow);
+
+    /* next frame packs from the start again */
+    skin_palette_begin(&pal);
+    TEST_CHECK(skin_palette_getbytes(&pal) == 0);
+    TEST_CHECK(skin_palette_addpose(&pal, &poses[3]) == 0);
+
+    /* a pose that fills the palette exactly fits, the next one is dropped for the frame */
+    for (uint i = 0; i < SKIN_MODELS*SKIN_INSTANCES; i++)
+        poses[i].palette_frame = 0;
+    skin_palette_init(&pal, SKIN_BONES*2);
+    skin_palette_begin(&pal);
+    TEST_CHECK(skin_palette_addpose(&pal, &poses[0]) == 0);
+    TEST_CHECK(skin_palette_addpose(&pal, &poses[1]) == SKIN_BONES);
+    TEST_CHECK(skin_palette_addpose(&pal, &poses[2]) == INVALID_INDEX);
+    TEST_CHECK(poses[2].palette_idx == INVALID_INDEX && pal.overflow);
+    TEST_CHECK(skin_palette_getbytes(&pal) == SKIN_BONES*2*(uint)SKIN_PALETTE_BONE_SIZE);
+
+    return TRUE;
+}
@@ -0,0 +1,91 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include "dhcore/core.h"
+
+#include "staging-ring.h"
+#include "tests.h"
+
+#define RING_SIZE (16*STAGING_RING_ALIGN)
+
+int test_staging_ring()
+{
+    struct staging_ring ring;
+
+    /* unsupported staging never allocates */
+    staging_ring_init(&ring, 0);
+    TEST_CHECK(staging_ring_alloc(&ring, 16) == STAGING_RING_NONE);
+
+    staging_ring_init(&ring, RING_SIZE);
+
+    /* sizes are aligned, allocations that are bigger than the ring are refused */
+    TEST_CHECK(staging_ring_alloc(&ring, 1) == 0);
+    TEST_CHECK(staging_ring_alloc(&ring, STAGING_RING_ALIGN) == STAGING_RING_ALIGN);
+    TEST_CHECK(staging_ring_alloc(&ring, RING_SIZE + 1) == STAGING_RING_NONE);
+    TEST_CHECK(staging_ring_getused(&ring) == 2*STAGING_RING_ALIGN);
+
+    /* nothing is fenced yet, a finalize that doesn't move head needs no new fence */
+    TEST_CHECK(staging_ring_needfence(&ring, ring.head));
+    staging_ring_pushfence(&ring, ring.head)->sync = 1;
+    TEST_CHECK(!staging_ring_needfence(&ring, ring.head));
+
+    /* fill the ring, without signaled fences memory is not reused */
+    TEST_CHECK(staging_ring_alloc(&ring, 12*STAGING_RING_ALIGN) == 2*STAGING_RING_ALIGN);
+    TEST_CHECK(staging_ring_needfence(&ring, ring.head));
+    staging_ring_pushfence(&ring, ring.head)->sync = 2;
+    TEST_CHECK(staging_ring_alloc(&ring, 4*STAGING_RING_ALIGN) == STAGING_RING_NONE);
+
+    /* first fence is signaled: 2 blocks at the start are free, but 4 blocks don't fit at the end
+     * (2 left) and the skipped tail + 4 blocks exceed the ring */
+    TEST_CHECK(staging_ring_oldestfence(&ring)->sync == 1);
+    staging_ring_popfence(&ring);
+    TEST_CHECK(ring.tail == 2*STAGING_RING_ALIGN);
+    TEST_CHECK(staging_ring_alloc(&ring, 4*STAGING_RING_ALIGN) == STAGING_RING_NONE);
+    TEST_CHECK(staging_ring_alloc(&ring, 2*STAGING_RING_ALIGN) == 14*STAGING_RING_ALIGN);
+
+    /* second fence is signaled, next allocation wraps to the start of the buffer */
+    staging_ring_pushfence(&ring, ring.head)->sync = 3;
+    staging_ring_popfence(&ring);
+    staging_ring_popfence(&ring);
+    TEST_CHECK(staging_ring_oldestfence(&ring) == NULL);
+    TEST_CHECK(staging_ring_getused(&ring) == 0);
+    uint64 pos = staging_ring_alloc(&ring, 4*STAGING_RING_ALIGN);
+    TEST_CHECK(pos == RING_SIZE && pos % RING_SIZE == 0);
+
+    /* fence slots run out: the device waits for the oldest one, then fences the new memory */
+    for (uint i = 0; i < STAGING_RING_FENCE_MAX; i++)  {
+        TEST_CHECK(staging_ring_alloc(&ring, 1) != STAGING_RING_NONE);
+        TEST_CHECK(!staging_ring_fencesfull(&ring));
+        staging_ring_pushfence(&ring, ring.head)->sync = 10 + i;
+    }
+    TEST_CHECK(staging_ring_fencesfull(&ring));
+    TEST_CHECK(staging_ring_alloc(&ring, 1) != STAGING_RING_NONE);
+    TEST_CHECK(staging_ring_needfence(&ring, ring.head));
+    TEST_CHECK(staging_ring_oldestfence(&ring)->sync == 10);
+    staging_ring_popfence(&ring);
+    staging_ring_pushfence(&ring, ring.head)->sync = 20;
+    TEST_CHECK(ring.fence_cnt == STAGING_RING_FENCE_MAX);
+    TEST_CHECK(staging_ring_oldestfence(&ring)->sync == 11);
+
+    /* all fences signaled, the whole ring is free. allocation skips the end of the buffer */
+    while (staging_ring_oldestfence(&ring) != NULL)
+        staging_ring_popfence(&ring);
+    TEST_CHECK(ring.tail == ring.head);
+    pos = staging_ring_alloc(&ring, 8*STAGING_RING_ALIGN);
+    TEST_CHECK(pos != STAGING_RING_NONE && pos % RING_SIZE == 0);
+
+    return TRUE;
+}
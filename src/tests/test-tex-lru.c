@@ -0,0 +1,113 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "dhcore/core.h"
+
+#include "tex-lru.h"
+#include "tests.h"
+
+#define LRU_TEXTURES 8
+
+struct lru_tex
+{
+    fl64 release_bytes;   /* memory that is released by demoting, =0 if texture needs it's mips */
+    struct tex_lru_link link;
+};
+
+struct lru_visit
+{
+    struct lru_tex* texs;
+    uint order[LRU_TEXTURES];
+    uint cnt;
+};
+
+static fl64 lru_demote(uint idx, void* param)
+{
+    struct lru_visit* v = (struct lru_visit*)param;
+    v->order[v->cnt++] = idx;
+    fl64 bytes = v->texs[idx].release_bytes;
+    v->texs[idx].release_bytes = 0.0;
+    return bytes;
+}
+
+int test_tex_lru()
+{
+    struct lru_tex texs[LRU_TEXTURES];
+    struct tex_lru lru;
+    struct lru_visit v;
+
+    memset(texs, 0x00, sizeof(texs));
+    tex_lru_init(&lru, sizeof(struct lru_tex), (uint)offsetof(struct lru_tex, link));
+
+    /* textures are added as they get loaded, then some are viewed again */
+    for (uint i = 0; i < LRU_TEXTURES; i++)  {
+        texs[i].release_bytes = 1024.0;
+        tex_lru_add(&lru, texs, i);
+    }
+    TEST_CHECK(lru.cnt == LRU_TEXTURES);
+    TEST_CHECK(lru.first == LRU_TEXTURES - 1 && lru.last == 0);
+
+    tex_lru_touch(&lru, texs, 0);
+    tex_lru_touch(&lru, texs, 3);
+    tex_lru_touch(&lru, texs, 3);   /* already first */
+    TEST_CHECK(lru.first == 3 && lru.last == 1);
+    TEST_CHECK(lru.cnt == LRU_TEXTURES);
+
+    /* overflow of 2.5 textures demotes three least recently viewed ones and stops */
+    memset(&v, 0x00, sizeof(v));
+    v.texs = texs;
+    TEST_CHECK(tex_lru_demote(&lru, texs, 2560.0, lru_demote, &v) == 3);
+    TEST_CHECK(v.cnt == 3 && v.order[0] == 1 && v.order[1] == 2 && v.order[2] == 4);
+
+    /* textures that can't be demoted are skipped, the walk continues to more recent ones */
+    texs[6].release_bytes = 0.0;
+    memset(&v, 0x00, sizeof(v));
+    v.texs = texs;
+    TEST_CHECK(tex_lru_demote(&lru, texs, 2048.0, lru_demote, &v) == 6);
+    TEST_CHECK(v.order[3] == 5 && v.order[4] == 6 && v.order[5] == 7);
+
+    /* no overflow, nothing is visited */
+    memset(&v, 0x00, sizeof(v));
+    v.texs = texs;
+    TEST_CHECK(tex_lru_demote(&lru, texs, 0.0, lru_demote, &v) == 0);
+
+    /* unloading textures unlinks them from head, middle and tail */
+    tex_lru_remove(&lru, texs, 3);
+    tex_lru_remove(&lru, texs, 5);
+    tex_lru_remove(&lru, texs, 1);
+    TEST_CHECK(lru.cnt == LRU_TEXTURES - 3);
+    TEST_CHECK(lru.first == 0 && lru.last == 2);
+
+    for (uint i = 0; i < LRU_TEXTURES; i++)
+        texs[i].release_bytes = 1.0;
+    memset(&v, 0x00, sizeof(v));
+    v.texs = texs;
+    TEST_CHECK(tex_lru_demote(&lru, texs, 100.0, lru_demote, &v) == LRU_TEXTURES - 3);
+    TEST_CHECK(v.order[0] == 2 && v.order[1] == 4 && v.order[2] == 6 && v.order[3] == 7 &&
+        v.order[4] == 0);
+
+    /* removing everything leaves an empty list */
+    tex_lru_remove(&lru, texs, 0);
+    tex_lru_remove(&lru, texs, 2);
+    tex_lru_remove(&lru, texs, 4);
+    tex_lru_remove(&lru, texs, 6);
+    tex_lru_remove(&lru, texs, 7);
+    TEST_CHECK(lru.cnt == 0 && lru.first == INVALID_INDEX && lru.last == INVALID_INDEX);
+
+    return TRUE;
+}
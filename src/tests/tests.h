@@ -0,0 +1,49 @@
+/***********************************************************************************
+ * Copyright (c) 2013, Sepehr Taghdisian
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ ***********************************************************************************/
+
+#ifndef __TESTS_H__
+#define __TESTS_H__
+
+#include <stdio.h>
+#include "dhcore/types.h"
+
+/* tests return TRUE on success, failing checks print the expression and return FALSE */
+typedef int (*pfn_test)();
+
+#define TEST_CHECK(expr)    \
+    if (!(expr))  { test_fail(__FILE__, __LINE__, #expr);  return FALSE; }
+
+void test_fail(const char* file, uint line, const char* expr);
+
+/* writes text into a file in current directory, used for synthetic test data */
+int test_writefile(const char* filepath, const char* text);
+
+/* load-throughput benchmark (bench-load.c), returns TRUE if runs loaded the same data */
+int bench_load(uint file_cnt, uint thread_cnt);
+
+/* tests */
+int test_anim_ctrl_switches();
+int test_anim_ctrl_bin();
+int test_csm_cache();
+int test_fgraph();
+int test_file_map();
+int test_light_clusters();
+int test_load_queue();
+int test_pak_archive();
+int test_skin_palette();
+int test_staging_ring();
+int test_tex_lru();
+
+#endif /* __TESTS_H__ */